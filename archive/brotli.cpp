@@ -1,43 +1,98 @@
 // SPDX-FileCopyrightText: 2024 David Zero <zero-one@zer0-one.net>
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "archive/brotli.h"
 
+#include "util/string.h"
+
 #include <brotli/decode.h>
+#include <brotli/encode.h>
 #include <tl/expected.hpp>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <span>
+#include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace archive {
+namespace {
+
+bool is_valid_quality(int quality) {
+    return quality >= BROTLI_MIN_QUALITY && quality <= BROTLI_MAX_QUALITY;
+}
+
+// Runs the encoder until it's consumed all of its input and, if finishing,
+// ended the stream, growing out as needed.
+tl::expected<void, BrotliError> compress_into(
+        BrotliEncoderState *state, std::span<std::byte const> data, BrotliEncoderOperation op, std::string &out) {
+    constexpr auto kChunkSize = std::size_t{64} * 1024;
+
+    std::size_t avail_in = data.size();
+    auto const *next_in = reinterpret_cast<std::uint8_t const *>(data.data());
+    while (true) {
+        auto const written = out.size();
+        util::resize_uninitialized(out, written + kChunkSize);
+        std::size_t avail_out = kChunkSize;
+        auto *next_out = reinterpret_cast<std::uint8_t *>(out.data() + written);
+        auto const ok = BrotliEncoderCompressStream(state, op, &avail_in, &next_in, &avail_out, &next_out, nullptr);
+        out.resize(out.size() - avail_out);
+        if (ok == BROTLI_FALSE) {
+            return tl::unexpected{BrotliError::BrotliInternalError};
+        }
+
+        if (BrotliEncoderHasMoreOutput(state) == BROTLI_TRUE) {
+            continue;
+        }
+
+        if (op == BROTLI_OPERATION_FINISH ? BrotliEncoderIsFinished(state) == BROTLI_TRUE : avail_in == 0) {
+            return {};
+        }
+    }
+}
+
+} // namespace
+
+struct BrotliEncoder::Impl {
+    std::unique_ptr<BrotliEncoderState, decltype(&BrotliEncoderDestroyInstance)> state{
+            nullptr, &BrotliEncoderDestroyInstance};
+    std::string out;
+};
 
 std::string_view to_string(BrotliError err) {
     switch (err) {
         case BrotliError::DecoderState:
             return "Failed to create brotli decoder state";
+        case BrotliError::EncoderState:
+            return "Failed to create brotli encoder state";
         case BrotliError::InputCorrupt:
             return "Input is corrupt or truncated";
         case BrotliError::InputEmpty:
             return "Input is empty";
+        case BrotliError::InvalidQuality:
+            return "Invalid compression quality";
         case BrotliError::MaximumOutputLengthExceeded:
             return "Output buffer exceeded maximum allowed length";
         case BrotliError::BrotliInternalError:
-            return "Decode failure";
+            return "Internal brotli error";
     }
 
     return "Unknown error";
 }
 
-tl::expected<std::vector<std::byte>, BrotliError> brotli_decode(std::span<std::byte const> const input) {
+tl::expected<void, BrotliError> brotli_decode(std::span<std::byte const> const input, std::string &out) {
     if (input.empty()) {
         return tl::unexpected{BrotliError::InputEmpty};
     }
 
+    // Brotli has no way of resetting a decoder, so unlike w/ zlib and zstd,
+    // there's nothing to gain from keeping them around.
     std::unique_ptr<BrotliDecoderState, decltype(&BrotliDecoderDestroyInstance)> br_state(
             BrotliDecoderCreateInstance(nullptr, nullptr, nullptr), BrotliDecoderDestroyInstance);
 
@@ -48,27 +103,32 @@ tl::expected<std::vector<std::byte>, BrotliError> brotli_decode(std::span<std::b
     // Cap output buffer at 1GB. If we hit this, something fishy is probably
     // going on, and we should bail before we OOM.
     std::size_t constexpr kMaxOutSize = 1000000000;
-    std::size_t constexpr kChunkSize = 131072; // Matches the zstd chunk size
-
-    std::vector<std::byte> out;
+    std::size_t constexpr kMinOutSize = 131072; // Matches the zstd chunk size
 
     std::size_t avail_in = input.size();
     auto const *next_in = reinterpret_cast<std::uint8_t const *>(input.data());
-    std::size_t total_out = 0;
 
-    BrotliDecoderResult res = BROTLI_DECODER_RESULT_ERROR;
+    // Brotli streams don't say how large their output is, so the output is
+    // decoded straight into a buffer that grows geometrically.
+    out.clear();
+    util::resize_uninitialized(out, std::min(std::max(input.size() * 4, kMinOutSize), kMaxOutSize));
+    std::size_t written = 0;
 
-    std::vector<std::byte> intermediate_buf(kChunkSize);
+    BrotliDecoderResult res = BROTLI_DECODER_RESULT_ERROR;
 
     while (res != BROTLI_DECODER_RESULT_SUCCESS) {
-        std::size_t avail_out = kChunkSize;
-        auto *next_out = reinterpret_cast<std::uint8_t *>(intermediate_buf.data());
-
-        if (out.size() >= kMaxOutSize) {
-            return tl::unexpected{BrotliError::MaximumOutputLengthExceeded};
+        if (written == out.size()) {
+            if (out.size() >= kMaxOutSize) {
+                return tl::unexpected{BrotliError::MaximumOutputLengthExceeded};
+            }
+            util::resize_uninitialized(out, std::min(out.size() * 2, kMaxOutSize));
         }
 
-        res = BrotliDecoderDecompressStream(br_state.get(), &avail_in, &next_in, &avail_out, &next_out, &total_out);
+        std::size_t avail_out = out.size() - written;
+        auto *next_out = reinterpret_cast<std::uint8_t *>(out.data() + written);
+
+        res = BrotliDecoderDecompressStream(br_state.get(), &avail_in, &next_in, &avail_out, &next_out, nullptr);
+        written = out.size() - avail_out;
 
         // Because we provide the whole input up-front, there's no reason we
         // would ever block on needing more input, except for corrupt data
@@ -86,11 +146,74 @@ tl::expected<std::vector<std::byte>, BrotliError> brotli_decode(std::span<std::b
 
             return tl::unexpected{BrotliError::BrotliInternalError};
         }
+    }
+
+    out.resize(written);
+    return {};
+}
+
+tl::expected<std::vector<std::byte>, BrotliError> brotli_decode(std::span<std::byte const> const input) {
+    std::string out;
+    if (auto res = brotli_decode(input, out); !res) {
+        return tl::unexpected{res.error()};
+    }
+
+    auto const *data = reinterpret_cast<std::byte const *>(out.data());
+    return std::vector<std::byte>(data, data + out.size());
+}
+
+BrotliEncoder::BrotliEncoder(std::unique_ptr<Impl> impl) : impl_{std::move(impl)} {}
+BrotliEncoder::~BrotliEncoder() = default;
+BrotliEncoder::BrotliEncoder(BrotliEncoder &&) noexcept = default;
+BrotliEncoder &BrotliEncoder::operator=(BrotliEncoder &&) noexcept = default;
+
+tl::expected<BrotliEncoder, BrotliError> BrotliEncoder::create(int quality) {
+    if (!is_valid_quality(quality)) {
+        return tl::unexpected{BrotliError::InvalidQuality};
+    }
+
+    auto impl = std::make_unique<Impl>();
+    impl->state.reset(BrotliEncoderCreateInstance(nullptr, nullptr, nullptr));
+    if (impl->state == nullptr) {
+        return tl::unexpected{BrotliError::EncoderState};
+    }
+
+    BrotliEncoderSetParameter(impl->state.get(), BROTLI_PARAM_QUALITY, static_cast<std::uint32_t>(quality));
+    return BrotliEncoder{std::move(impl)};
+}
+
+tl::expected<void, BrotliError> BrotliEncoder::write(std::span<std::byte const> data) {
+    return compress_into(impl_->state.get(), data, BROTLI_OPERATION_PROCESS, impl_->out);
+}
+
+tl::expected<void, BrotliError> BrotliEncoder::finish() {
+    return compress_into(impl_->state.get(), {}, BROTLI_OPERATION_FINISH, impl_->out);
+}
+
+std::string BrotliEncoder::take() {
+    return std::exchange(impl_->out, {});
+}
+
+tl::expected<std::string, BrotliError> brotli_encode(std::span<std::byte const> const input, int quality) {
+    if (!is_valid_quality(quality)) {
+        return tl::unexpected{BrotliError::InvalidQuality};
+    }
 
-        // TODO(zero-one): Replace with insert_range() when support is better
-        out.insert(out.end(), intermediate_buf.begin(), intermediate_buf.end() - avail_out);
+    std::string out;
+    auto size = BrotliEncoderMaxCompressedSize(input.size());
+    util::resize_uninitialized(out, size);
+    auto const ok = BrotliEncoderCompress(quality,
+            BROTLI_DEFAULT_WINDOW,
+            BROTLI_DEFAULT_MODE,
+            input.size(),
+            reinterpret_cast<std::uint8_t const *>(input.data()),
+            &size,
+            reinterpret_cast<std::uint8_t *>(out.data()));
+    if (ok == BROTLI_FALSE) {
+        return tl::unexpected{BrotliError::BrotliInternalError};
     }
 
+    out.resize(size);
     return out;
 }
 
@@ -1,4 +1,5 @@
 // SPDX-FileCopyrightText: 2024 David Zero <zero-one@zer0-one.net>
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
@@ -9,7 +10,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <span>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -17,8 +20,10 @@ namespace archive {
 
 enum class BrotliError : std::uint8_t {
     DecoderState,
+    EncoderState,
     InputCorrupt,
     InputEmpty,
+    InvalidQuality,
     MaximumOutputLengthExceeded,
     BrotliInternalError,
 };
@@ -27,6 +32,43 @@ std::string_view to_string(BrotliError);
 
 tl::expected<std::vector<std::byte>, BrotliError> brotli_decode(std::span<std::byte const>);
 
+// Decodes into out, replacing its contents, so that an existing string can be
+// filled w/o copying the output to it afterwards. The input can't be in out.
+tl::expected<void, BrotliError> brotli_decode(std::span<std::byte const>, std::string &out);
+
+// Qualities range from 0 (fastest) to 11 (smallest output). 11 is what brotli
+// defaults to, but it's slow enough that anything compressing on the fly
+// should use something lower.
+inline constexpr int kBrotliDefaultQuality = 11;
+
+// Compresses data that arrives in chunks into a single stream. The compressed
+// data is available as soon as the encoder produces it, but most of it won't
+// be produced until the encoder is finished.
+class BrotliEncoder {
+public:
+    static tl::expected<BrotliEncoder, BrotliError> create(int quality = kBrotliDefaultQuality);
+
+    ~BrotliEncoder();
+    BrotliEncoder(BrotliEncoder &&) noexcept;
+    BrotliEncoder &operator=(BrotliEncoder &&) noexcept;
+
+    tl::expected<void, BrotliError> write(std::span<std::byte const>);
+
+    // Ends the stream. Nothing can be written after this.
+    tl::expected<void, BrotliError> finish();
+
+    // Takes the compressed data produced so far.
+    std::string take();
+
+private:
+    struct Impl;
+    explicit BrotliEncoder(std::unique_ptr<Impl>);
+    std::unique_ptr<Impl> impl_;
+};
+
+tl::expected<std::string, BrotliError> brotli_encode(
+        std::span<std::byte const>, int quality = kBrotliDefaultQuality);
+
 } // namespace archive
 
 #endif
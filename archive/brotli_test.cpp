@@ -1,4 +1,5 @@
 // SPDX-FileCopyrightText: 2024 David Zero <zero-one@zer0-one.net>
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
@@ -8,16 +9,22 @@
 
 #include <tl/expected.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstdint>
 #include <span>
 #include <string>
+#include <string_view>
 
 namespace {
 std::span<std::byte const> as_bytes(std::span<std::uint8_t const> s) {
     return {reinterpret_cast<std::byte const *>(s.data()), s.size()};
 }
+
+std::span<std::byte const> as_bytes(std::string_view s) {
+    return {reinterpret_cast<std::byte const *>(s.data()), s.size()};
+}
 } // namespace
 
 int main() {
@@ -96,5 +103,67 @@ int main() {
         a.expect(ret->empty());
     });
 
+    s.add_test("into a string", [](etest::IActions &a) {
+        constexpr auto kCompress = std::to_array<std::uint8_t>(
+                {0x1f, 0x0d, 0x00, 0xf8, 0xa5, 0x40, 0xc2, 0xaa, 0x10, 0x49, 0xea, 0x16, 0x85, 0x9c, 0x32, 0x00});
+
+        std::string out{"replaced"};
+        a.expect(brotli_decode(as_bytes(kCompress), out).has_value());
+        a.expect_eq(out, "This is a test");
+    });
+
+    s.add_test("growing output", [](etest::IActions &a) {
+        // python -c "print('A' * 300000, end='')" | brotli, which is larger
+        // than the initial guess for the output size.
+        constexpr auto kCompress = std::to_array<std::uint8_t>(
+                {0x5b, 0xdf, 0x93, 0x84, 0x5f, 0x22, 0x28, 0x1e, 0x0b, 0x04, 0x32, 0x17, 0x09, 0x00});
+
+        std::string out;
+        a.expect(brotli_decode(as_bytes(kCompress), out).has_value());
+        a.expect(out == std::string(300000, 'A'));
+    });
+
+    s.add_test("encode, round-trip", [](etest::IActions &a) {
+        std::string const expected = "p { color: green; }\n" + std::string(1000, 'a') + "p { color: green; }\n";
+        for (int quality : {0, 5, kBrotliDefaultQuality}) {
+            auto encoded = brotli_encode(as_bytes(expected), quality);
+            a.require(encoded.has_value());
+            a.expect(encoded->size() < expected.size());
+
+            std::string out;
+            a.expect(brotli_decode(as_bytes(*encoded), out).has_value());
+            a.expect_eq(out, expected);
+        }
+    });
+
+    s.add_test("encode, invalid quality", [](etest::IActions &a) {
+        auto const hello = as_bytes(std::string_view{"hello"});
+        a.expect_eq(brotli_encode(hello, 12), tl::unexpected{BrotliError::InvalidQuality});
+        a.expect_eq(BrotliEncoder::create(-1).error(), BrotliError::InvalidQuality);
+    });
+
+    s.add_test("encoder, chunked", [](etest::IActions &a) {
+        std::string expected;
+        for (int i = 0; i < 20000; ++i) {
+            expected += "<li>item " + std::to_string(i) + "</li>";
+        }
+
+        auto encoder = BrotliEncoder::create(5);
+        a.require(encoder.has_value());
+
+        std::string encoded;
+        auto const data = as_bytes(expected);
+        for (std::size_t i = 0; i < data.size(); i += 1000) {
+            a.require(encoder->write(data.subspan(i, std::min(std::size_t{1000}, data.size() - i))).has_value());
+            encoded += encoder->take();
+        }
+        a.require(encoder->finish().has_value());
+        encoded += encoder->take();
+
+        std::string out;
+        a.expect(brotli_decode(as_bytes(encoded), out).has_value());
+        a.expect(out == expected);
+    });
+
     return s.run();
 }
@@ -0,0 +1,162 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "archive/brotli.h"
+#include "archive/zlib.h"
+#include "archive/zstd.h"
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+std::span<std::byte const> as_bytes(std::string_view s) {
+    return {reinterpret_cast<std::byte const *>(s.data()), s.size()};
+}
+
+std::vector<std::string> load_corpus(std::filesystem::path const &root) {
+    std::vector<std::string> files;
+    for (auto const &entry : std::filesystem::recursive_directory_iterator(root)) {
+        auto const extension = entry.path().extension();
+        if (!entry.is_regular_file() || (extension != ".html" && extension != ".htm" && extension != ".css")) {
+            continue;
+        }
+
+        std::ifstream file{entry.path(), std::ios::binary};
+        files.emplace_back(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+    }
+    return files;
+}
+
+// Compresses every file on its own, like cached responses are, and then
+// decompresses them all again.
+void run(std::string_view name,
+        std::span<std::string const> files,
+        std::function<std::string(std::string const &)> const &encode,
+        std::function<std::string(std::string const &)> const &decode) {
+    std::size_t in_size = 0;
+    std::size_t out_size = 0;
+    std::vector<std::string> encoded;
+    encoded.reserve(files.size());
+
+    auto const start = std::chrono::steady_clock::now();
+    for (auto const &file : files) {
+        encoded.push_back(encode(file));
+        in_size += file.size();
+        out_size += encoded.back().size();
+    }
+    std::chrono::duration<double> const encode_time = std::chrono::steady_clock::now() - start;
+
+    auto const decode_start = std::chrono::steady_clock::now();
+    for (auto const &e : encoded) {
+        static_cast<void>(decode(e));
+    }
+    std::chrono::duration<double> const decode_time = std::chrono::steady_clock::now() - decode_start;
+
+    auto const mb = static_cast<double>(in_size) / 1'000'000.;
+    std::cout << name << ": ratio " << static_cast<double>(in_size) / static_cast<double>(out_size) << ", encode "
+              << mb / encode_time.count() << " MB/s, decode " << mb / decode_time.count() << " MB/s\n";
+}
+
+} // namespace
+
+// Measures the compression ratio and speed of every encoder over a corpus of
+// HTML and CSS files.
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <directory w/ html and css files>\n";
+        return 1;
+    }
+
+    auto const files = load_corpus(argv[1]);
+    if (files.empty()) {
+        std::cerr << "No html or css files found in " << argv[1] << '\n';
+        return 1;
+    }
+
+    std::cout << files.size() << " files\n";
+
+    using namespace archive;
+    for (int level : {1, kZstdDefaultLevel, 9, 19}) {
+        run("zstd " + std::to_string(level),
+                files,
+                [level](std::string const &f) { return *zstd_encode(as_bytes(f), level); },
+                [](std::string const &f) {
+                    std::string out;
+                    static_cast<void>(zstd_decode(as_bytes(f), out));
+                    return out;
+                });
+    }
+
+    for (int level : {1, kZlibDefaultLevel, 9}) {
+        run("gzip " + std::to_string(level),
+                files,
+                [level](std::string const &f) { return *zlib_encode(as_bytes(f), ZlibMode::Gzip, level); },
+                [](std::string const &f) {
+                    std::string out;
+                    static_cast<void>(zlib_decode(as_bytes(f), ZlibMode::Gzip, out));
+                    return out;
+                });
+    }
+
+    for (int quality : {1, 5, 9, kBrotliDefaultQuality}) {
+        run("brotli " + std::to_string(quality),
+                files,
+                [quality](std::string const &f) { return *brotli_encode(as_bytes(f), quality); },
+                [](std::string const &f) {
+                    std::string out;
+                    static_cast<void>(brotli_decode(as_bytes(f), out));
+                    return out;
+                });
+    }
+
+    // The dictionary is trained on every other file, and measured on the rest,
+    // so that it's not just remembering the files it's compressing.
+    std::vector<std::string_view> training;
+    std::vector<std::string> testing;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        if (i % 2 == 0) {
+            training.emplace_back(files[i]);
+        } else {
+            testing.push_back(files[i]);
+        }
+    }
+
+    auto trained = zstd_train_dictionary(training);
+    if (!trained) {
+        std::cerr << "Dictionary training failed: " << to_string(trained.error()) << '\n';
+        return 0;
+    }
+
+    std::cout << "\nDictionary of " << trained->size() << " bytes, measured on " << testing.size() << " files\n";
+    for (int level : {1, kZstdDefaultLevel, 9, 19}) {
+        run("zstd " + std::to_string(level),
+                testing,
+                [level](std::string const &f) { return *zstd_encode(as_bytes(f), level); },
+                [](std::string const &f) {
+                    std::string out;
+                    static_cast<void>(zstd_decode(as_bytes(f), out));
+                    return out;
+                });
+
+        auto dictionary = ZstdDictionary::create(*trained, level);
+        run("zstd " + std::to_string(level) + " w/ dictionary",
+                testing,
+                [&dictionary](std::string const &f) { return *zstd_encode(as_bytes(f), *dictionary); },
+                [&dictionary](std::string const &f) {
+                    std::string out;
+                    static_cast<void>(zstd_decode(as_bytes(f), out, *dictionary));
+                    return out;
+                });
+    }
+}
@@ -4,24 +4,137 @@
 
 #include "archive/zlib.h"
 
+#include "util/string.h"
+
 #include <tl/expected.hpp>
 #include <zconf.h>
 #include <zlib.h>
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <span>
 #include <string>
 #include <utility>
 #include <vector>
 
 namespace archive {
+namespace {
 
-tl::expected<std::vector<std::byte>, ZlibError> zlib_decode(std::span<std::byte const> data, ZlibMode mode) {
-    z_stream s{
-            .next_in = reinterpret_cast<Bytef const *>(data.data()),
-            .avail_in = static_cast<uInt>(data.size()),
-    };
+// Streams are reset between uses instead of being recreated, which saves
+// reallocating the inflate state and its window for every call.
+class Inflater {
+public:
+    Inflater() = default;
+    ~Inflater() {
+        if (initialized_) {
+            inflateEnd(&s_);
+        }
+    }
+
+    Inflater(Inflater const &) = delete;
+    Inflater &operator=(Inflater const &) = delete;
+
+    tl::expected<z_stream *, ZlibError> get(int window_bits) {
+        if (!initialized_) {
+            if (auto error = inflateInit2(&s_, window_bits); error != Z_OK) {
+                return tl::unexpected{ZlibError{.message = "inflateInit2", .code = error}};
+            }
+            initialized_ = true;
+        } else if (auto error = inflateReset2(&s_, window_bits); error != Z_OK) {
+            return tl::unexpected{ZlibError{.message = "inflateReset2", .code = error}};
+        }
+
+        return &s_;
+    }
+
+private:
+    z_stream s_{};
+    bool initialized_{false};
+};
+
+// Gzip ends w/ the size of the uncompressed data modulo 2^32, which is only
+// trusted as far as deflate's maximum compression ratio allows.
+std::optional<std::size_t> gzip_size_hint(std::span<std::byte const> data) {
+    // A 10-byte header, at least 2 bytes of deflate data, and the 8-byte trailer.
+    if (data.size() < 20) {
+        return std::nullopt;
+    }
+
+    auto const trailer = data.last(4);
+    auto const size = static_cast<std::uint32_t>(trailer[0]) | static_cast<std::uint32_t>(trailer[1]) << 8
+            | static_cast<std::uint32_t>(trailer[2]) << 16 | static_cast<std::uint32_t>(trailer[3]) << 24;
+    constexpr std::size_t kMaxDeflateRatio = 1032;
+    if (size > data.size() * kMaxDeflateRatio) {
+        return std::nullopt;
+    }
+
+    return size;
+}
+
+// See zlib_decode for what the window bits mean.
+int window_bits(ZlibMode mode) {
+    constexpr int kWindowBits = 15;
+    return mode == ZlibMode::Gzip ? kWindowBits + 16 : kWindowBits;
+}
+
+ZlibError error_from(z_stream const &s, char const *function, int code) {
+    return ZlibError{.message = s.msg != nullptr ? s.msg : function, .code = code};
+}
+
+// Runs deflate until it's consumed all of its input and, if finishing, ended
+// the stream, growing out as needed.
+tl::expected<void, ZlibError> deflate_into(z_stream &s, std::span<std::byte const> data, int flush, std::string &out) {
+    constexpr auto kChunkSize = std::size_t{64} * 1024;
+    constexpr auto kMaxAvailIn = std::size_t{std::numeric_limits<uInt>::max()};
+
+    s.next_in = reinterpret_cast<Bytef const *>(data.data());
+    while (true) {
+        // Huge inputs are handed to deflate in pieces, as it counts w/ uInt.
+        auto const avail_in = std::min(data.size(), kMaxAvailIn);
+        s.avail_in = static_cast<uInt>(avail_in);
+        auto const piece_flush = avail_in == data.size() ? flush : Z_NO_FLUSH;
+
+        auto const written = out.size();
+        util::resize_uninitialized(out, written + kChunkSize);
+        s.next_out = reinterpret_cast<Bytef *>(out.data() + written);
+        s.avail_out = static_cast<uInt>(kChunkSize);
+        auto const ret = deflate(&s, piece_flush);
+        out.resize(out.size() - s.avail_out);
+        data = data.subspan(avail_in - s.avail_in);
+
+        if (ret == Z_STREAM_END) {
+            return {};
+        }
+
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            return tl::unexpected{error_from(s, "deflate", ret)};
+        }
+
+        // Done once all input's been consumed and deflate had output to spare.
+        if (data.empty() && s.avail_out != 0 && flush == Z_NO_FLUSH) {
+            return {};
+        }
+    }
+}
+
+} // namespace
+
+struct ZlibEncoder::Impl {
+    Impl() = default;
+    ~Impl() { deflateEnd(&s); }
 
+    Impl(Impl const &) = delete;
+    Impl &operator=(Impl const &) = delete;
+
+    z_stream s{};
+    std::string out;
+};
+
+tl::expected<void, ZlibError> zlib_decode(std::span<std::byte const> data, ZlibMode mode, std::string &out) {
     // https://github.com/madler/zlib/blob/v1.2.13/zlib.h#L832
     // The windowBits parameter is the base two logarithm of the
     // maximum window size (the size of the history buffer). It
@@ -41,34 +154,111 @@ tl::expected<std::vector<std::byte>, ZlibError> zlib_decode(std::span<std::byte
         }
     }();
     constexpr int kWindowBits = 15;
-    if (auto error = inflateInit2(&s, kWindowBits + zlib_mode); error != Z_OK) {
-        return tl::unexpected{ZlibError{.message = "inflateInit2", .code = error}};
+    thread_local Inflater inflater;
+    auto stream = inflater.get(kWindowBits + zlib_mode);
+    if (!stream) {
+        return tl::unexpected{std::move(stream).error()};
     }
 
-    std::vector<std::byte> out{};
-    std::string buf{};
-    constexpr auto kZlibInflateChunkSize = std::size_t{64} * 1024; // Chosen by a fair dice roll.
-    buf.resize(kZlibInflateChunkSize);
-    do {
-        s.next_out = reinterpret_cast<Bytef *>(buf.data());
-        s.avail_out = static_cast<uInt>(buf.size());
+    auto &s = **stream;
+    s.next_in = reinterpret_cast<Bytef const *>(data.data());
+    s.avail_in = static_cast<uInt>(data.size());
+
+    // Zlib streams don't say how large their output is, so it's guessed, and
+    // the output grows geometrically if the guess was too small.
+    constexpr auto kMinOutSize = std::size_t{64} * 1024;
+    constexpr auto kMaxAvailOut = std::size_t{std::numeric_limits<uInt>::max()};
+    auto const size_hint = mode == ZlibMode::Gzip ? gzip_size_hint(data) : std::nullopt;
+
+    out.clear();
+    util::resize_uninitialized(out, size_hint.value_or(std::max(data.size() * 4, kMinOutSize)));
+    std::size_t written = 0;
+    while (true) {
+        if (written == out.size()) {
+            util::resize_uninitialized(out, std::max(out.size() * 2, kMinOutSize));
+        }
+
+        auto const avail_out = std::min(out.size() - written, kMaxAvailOut);
+        s.next_out = reinterpret_cast<Bytef *>(out.data() + written);
+        s.avail_out = static_cast<uInt>(avail_out);
         int ret = inflate(&s, Z_NO_FLUSH);
+        written += avail_out - s.avail_out;
         if (ret != Z_OK && ret != Z_STREAM_END) {
             std::string msg;
             if (s.msg != nullptr) {
                 msg = s.msg;
             }
-            inflateEnd(&s);
             return tl::unexpected{ZlibError{.message = std::move(msg), .code = ret}};
         }
 
-        uInt inflated_bytes = static_cast<uInt>(buf.size()) - s.avail_out;
-        auto const *buf_ptr = reinterpret_cast<std::byte const *>(buf.data());
-        out.insert(out.end(), buf_ptr, buf_ptr + inflated_bytes);
-    } while (s.avail_out == 0);
+        if (ret == Z_STREAM_END || s.avail_out != 0) {
+            break;
+        }
+    }
+
+    out.resize(written);
+    return {};
+}
+
+tl::expected<std::vector<std::byte>, ZlibError> zlib_decode(std::span<std::byte const> data, ZlibMode mode) {
+    std::string out;
+    if (auto res = zlib_decode(data, mode, out); !res) {
+        return tl::unexpected{std::move(res).error()};
+    }
+
+    auto const *bytes = reinterpret_cast<std::byte const *>(out.data());
+    return std::vector<std::byte>(bytes, bytes + out.size());
+}
+
+ZlibEncoder::ZlibEncoder(std::unique_ptr<Impl> impl) : impl_{std::move(impl)} {}
+ZlibEncoder::~ZlibEncoder() = default;
+ZlibEncoder::ZlibEncoder(ZlibEncoder &&) noexcept = default;
+ZlibEncoder &ZlibEncoder::operator=(ZlibEncoder &&) noexcept = default;
+
+tl::expected<ZlibEncoder, ZlibError> ZlibEncoder::create(ZlibMode mode, int level) {
+    // deflateEnd is fine to call on a stream that failed to initialize, so
+    // the Impl can be created before that.
+    auto impl = std::make_unique<Impl>();
+    constexpr int kMemLevel = 8;
+    if (auto error = deflateInit2(&impl->s, level, Z_DEFLATED, window_bits(mode), kMemLevel, Z_DEFAULT_STRATEGY);
+            error != Z_OK) {
+        return tl::unexpected{ZlibError{.message = "deflateInit2", .code = error}};
+    }
+
+    return ZlibEncoder{std::move(impl)};
+}
+
+tl::expected<void, ZlibError> ZlibEncoder::write(std::span<std::byte const> data) {
+    if (data.empty()) {
+        return {};
+    }
+
+    return deflate_into(impl_->s, data, Z_NO_FLUSH, impl_->out);
+}
+
+tl::expected<void, ZlibError> ZlibEncoder::finish() {
+    return deflate_into(impl_->s, {}, Z_FINISH, impl_->out);
+}
+
+std::string ZlibEncoder::take() {
+    return std::exchange(impl_->out, {});
+}
+
+tl::expected<std::string, ZlibError> zlib_encode(std::span<std::byte const> data, ZlibMode mode, int level) {
+    auto encoder = ZlibEncoder::create(mode, level);
+    if (!encoder) {
+        return tl::unexpected{std::move(encoder).error()};
+    }
+
+    if (auto res = encoder->write(data); !res) {
+        return tl::unexpected{std::move(res).error()};
+    }
+
+    if (auto res = encoder->finish(); !res) {
+        return tl::unexpected{std::move(res).error()};
+    }
 
-    inflateEnd(&s);
-    return out;
+    return encoder->take();
 }
 
 } // namespace archive
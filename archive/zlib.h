@@ -9,6 +9,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <span>
 #include <string>
 #include <vector>
@@ -27,6 +28,40 @@ enum class ZlibMode : std::uint8_t {
 
 tl::expected<std::vector<std::byte>, ZlibError> zlib_decode(std::span<std::byte const>, ZlibMode);
 
+// Decodes into out, replacing its contents, so that an existing string can be
+// filled w/o copying the output to it afterwards. The input can't be in out.
+tl::expected<void, ZlibError> zlib_decode(std::span<std::byte const>, ZlibMode, std::string &out);
+
+// Levels range from 0 (no compression) to 9 (smallest output).
+inline constexpr int kZlibDefaultLevel = 6;
+
+// Compresses data that arrives in chunks into a single stream. The compressed
+// data is available as soon as the encoder produces it, but most of it won't
+// be produced until the encoder is finished.
+class ZlibEncoder {
+public:
+    static tl::expected<ZlibEncoder, ZlibError> create(ZlibMode, int level = kZlibDefaultLevel);
+
+    ~ZlibEncoder();
+    ZlibEncoder(ZlibEncoder &&) noexcept;
+    ZlibEncoder &operator=(ZlibEncoder &&) noexcept;
+
+    tl::expected<void, ZlibError> write(std::span<std::byte const>);
+
+    // Ends the stream. Nothing can be written after this.
+    tl::expected<void, ZlibError> finish();
+
+    // Takes the compressed data produced so far.
+    std::string take();
+
+private:
+    struct Impl;
+    explicit ZlibEncoder(std::unique_ptr<Impl>);
+    std::unique_ptr<Impl> impl_;
+};
+
+tl::expected<std::string, ZlibError> zlib_encode(std::span<std::byte const>, ZlibMode, int level = kZlibDefaultLevel);
+
 } // namespace archive
 
 #endif
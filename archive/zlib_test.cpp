@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <span>
+#include <string>
 #include <string_view>
 
 using namespace archive;
@@ -30,6 +31,16 @@ constexpr auto kGzippedCss =
 constexpr auto kZlibbedCss =
         "\x78\x5e\x2b\x50\xa8\x56\x48\xcb\xcf\x2b\xd1\x2d\xce\xac\x4a\xb5\x52\x30\x34\x32\x4e\xcd\xb5\x56\xa8\xe5\x02\x00\x63\xc3\x07\x6f"sv;
 
+// 200'000 'a's, deflated and wrapped in the given header and trailer.
+std::string deflated_as(std::string_view header, std::string_view trailer) {
+    std::string data{header};
+    data += "\xed\xc1\x31\x01\x00\x00\x00\xc2\xa0\xac\xeb\x5f\xc2\x0c\xfe\x40\x01"sv;
+    data.append(193, '\0');
+    data += "\xaf\x01"sv;
+    data += trailer;
+    return data;
+}
+
 } // namespace
 
 int main() {
@@ -50,5 +61,86 @@ int main() {
         a.expect(std::ranges::equal(res.value(), as_bytes(kExpected)));
     });
 
+    s.add_test("into a string", [](etest::IActions &a) {
+        // Decoding the formats one after the other resets the reused stream
+        // between them.
+        std::string out{"replaced"};
+        a.expect(zlib_decode(as_bytes(kGzippedCss), ZlibMode::Gzip, out).has_value());
+        a.expect_eq(out, kExpected);
+        a.expect(zlib_decode(as_bytes(kZlibbedCss), ZlibMode::Zlib, out).has_value());
+        a.expect_eq(out, kExpected);
+        a.expect(!zlib_decode(as_bytes(kZlibbedCss), ZlibMode::Gzip, out).has_value());
+        a.expect(zlib_decode(as_bytes(kGzippedCss), ZlibMode::Gzip, out).has_value());
+        a.expect_eq(out, kExpected);
+    });
+
+    s.add_test("large output", [](etest::IActions &a) {
+        std::string const expected(200'000, 'a');
+        std::string out;
+
+        auto const zlibbed = deflated_as("\x78\xda"sv, "\xcc\xee\x16\x99"sv);
+        a.expect(zlib_decode(as_bytes(zlibbed), ZlibMode::Zlib, out).has_value());
+        a.expect(out == expected);
+
+        // Sized using the trailer.
+        auto const gzipped =
+                deflated_as("\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03"sv, "\x9b\x53\x69\xe0\x40\x0d\x03\x00"sv);
+        a.expect(zlib_decode(as_bytes(gzipped), ZlibMode::Gzip, out).has_value());
+        a.expect(out == expected);
+
+        auto res = zlib_decode(as_bytes(gzipped), ZlibMode::Gzip);
+        a.require(res.has_value());
+        a.expect(std::ranges::equal(*res, as_bytes(expected)));
+    });
+
+    s.add_test("encode, round-trip", [](etest::IActions &a) {
+        std::string const expected = std::string{kExpected} + std::string(1000, 'a') + std::string{kExpected};
+        for (auto mode : {ZlibMode::Zlib, ZlibMode::Gzip}) {
+            for (int level : {0, 1, kZlibDefaultLevel, 9}) {
+                auto encoded = zlib_encode(as_bytes(expected), mode, level);
+                a.require(encoded.has_value());
+
+                std::string out;
+                a.expect(zlib_decode(as_bytes(*encoded), mode, out).has_value());
+                a.expect_eq(out, expected);
+            }
+        }
+    });
+
+    s.add_test("encode, gzip header", [](etest::IActions &a) {
+        auto encoded = zlib_encode(as_bytes(kExpected), ZlibMode::Gzip);
+        a.require(encoded.has_value());
+        a.expect(encoded->starts_with("\x1f\x8b"sv));
+        a.expect(!zlib_decode(as_bytes(*encoded), ZlibMode::Zlib).has_value());
+    });
+
+    s.add_test("encode, invalid level", [](etest::IActions &a) {
+        a.expect(!zlib_encode(as_bytes(kExpected), ZlibMode::Gzip, 10).has_value());
+        a.expect(!ZlibEncoder::create(ZlibMode::Zlib, -2).has_value());
+    });
+
+    s.add_test("encoder, chunked", [](etest::IActions &a) {
+        std::string expected;
+        for (int i = 0; i < 20000; ++i) {
+            expected += "<li>item " + std::to_string(i) + "</li>";
+        }
+
+        auto encoder = ZlibEncoder::create(ZlibMode::Gzip);
+        a.require(encoder.has_value());
+
+        std::string encoded;
+        auto const data = as_bytes(expected);
+        for (std::size_t i = 0; i < data.size(); i += 1000) {
+            a.require(encoder->write(data.subspan(i, std::min(std::size_t{1000}, data.size() - i))).has_value());
+            encoded += encoder->take();
+        }
+        a.require(encoder->finish().has_value());
+        encoded += encoder->take();
+
+        std::string out;
+        a.expect(zlib_decode(as_bytes(encoded), ZlibMode::Gzip, out).has_value());
+        a.expect(out == expected);
+    });
+
     return s.run();
 }
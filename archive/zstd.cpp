@@ -5,99 +5,327 @@
 
 #include "archive/zstd.h"
 
+#include "util/string.h"
+
 #include <tl/expected.hpp>
+#include <zdict.h>
 #include <zstd.h>
 
+#include <algorithm>
 #include <climits>
 #include <cstddef>
 #include <cstdlib>
 #include <memory>
 #include <span>
+#include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace archive {
+namespace {
+
+bool is_valid_level(int level) {
+    return level >= ZSTD_minCLevel() && level <= ZSTD_maxCLevel();
+}
+
+tl::expected<void, ZstdError> decode(
+        std::span<std::byte const> const input, std::string &out, ZSTD_DDict const *ddict) {
+    if (input.empty()) {
+        return tl::unexpected{ZstdError::InputEmpty};
+    }
+
+    // Contexts are kept around and reset between uses, since creating one
+    // allocates several large tables.
+    thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+
+    if (dctx == nullptr) {
+        return tl::unexpected{ZstdError::DecompressionContext};
+    }
+
+    ZSTD_DCtx_reset(dctx.get(), ZSTD_reset_session_only);
+    if (ZSTD_isError(ZSTD_DCtx_refDDict(dctx.get(), ddict)) != 0u) {
+        return tl::unexpected{ZstdError::InvalidDictionary};
+    }
+
+    // Cap output buffer at 1GB. If we hit this, something fishy is probably
+    // going on, and we should bail before we OOM.
+    std::size_t constexpr kMaxOutSize = 1000000000;
+
+    // The frame header usually says how large the output will be, and if not,
+    // the output grows geometrically from a guess.
+    std::size_t capacity = 0;
+    if (auto const content_size = ZSTD_getFrameContentSize(input.data(), input.size());
+            content_size != ZSTD_CONTENTSIZE_UNKNOWN && content_size != ZSTD_CONTENTSIZE_ERROR) {
+        if (content_size > kMaxOutSize) {
+            return tl::unexpected{ZstdError::MaximumOutputLengthExceeded};
+        }
+        capacity = static_cast<std::size_t>(content_size);
+    } else {
+        capacity = std::min(std::max(input.size() * 4, ZSTD_DStreamOutSize()), kMaxOutSize);
+    }
+
+    static_assert(CHAR_BIT == 8, "zstd requires 8-bit input");
+    ZSTD_inBuffer in_buf = {input.data(), input.size_bytes(), 0};
+
+    out.clear();
+    util::resize_uninitialized(out, capacity);
+    std::size_t written = 0;
+    std::size_t ret = 0;
+
+    while (true) {
+        if (written == out.size()) {
+            if (out.size() == kMaxOutSize) {
+                return tl::unexpected{ZstdError::MaximumOutputLengthExceeded};
+            }
+            util::resize_uninitialized(out, std::min(std::max(out.size() * 2, ZSTD_DStreamOutSize()), kMaxOutSize));
+        }
+
+        ZSTD_outBuffer out_buf = {out.data(), out.size(), written};
+        ret = ZSTD_decompressStream(dctx.get(), &out_buf, &in_buf);
+
+        if (ZSTD_isError(ret) != 0u) {
+            return tl::unexpected{ZstdError::ZstdInternalError};
+        }
+
+        written = out_buf.pos;
+
+        // Either all frames are done, or the decoder has flushed everything it
+        // could from the input, but it wasn't enough to finish the last frame.
+        if (in_buf.pos == in_buf.size && (ret == 0 || out_buf.pos < out_buf.size)) {
+            break;
+        }
+    }
+
+    if (ret != 0) {
+        return tl::unexpected{ZstdError::DecodeEarlyTermination};
+    }
+
+    out.resize(written);
+    return {};
+}
+
+// The level is ignored if there's a dictionary, as it was digested for one.
+tl::expected<std::string, ZstdError> encode(
+        std::span<std::byte const> const input, int level, ZSTD_CDict const *cdict) {
+    // Like w/ decoding, the context is reused, which matters a lot when
+    // compressing lots of small inputs.
+    thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(), &ZSTD_freeCCtx);
+    if (cctx == nullptr) {
+        return tl::unexpected{ZstdError::CompressionContext};
+    }
+
+    ZSTD_CCtx_reset(cctx.get(), ZSTD_reset_session_and_parameters);
+    ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, level);
+    if (ZSTD_isError(ZSTD_CCtx_refCDict(cctx.get(), cdict)) != 0u) {
+        return tl::unexpected{ZstdError::InvalidDictionary};
+    }
+
+    // Unlike the streaming encoder, this records the size of the input in the
+    // frame, which lets the decoder size its output up front.
+    std::string out;
+    util::resize_uninitialized(out, ZSTD_compressBound(input.size()));
+    auto const size = ZSTD_compress2(cctx.get(), out.data(), out.size(), input.data(), input.size());
+    if (ZSTD_isError(size) != 0u) {
+        return tl::unexpected{ZstdError::ZstdInternalError};
+    }
+
+    out.resize(size);
+    return out;
+}
+
+} // namespace
+
+struct ZstdDictionary::Impl {
+    std::unique_ptr<ZSTD_CDict, decltype(&ZSTD_freeCDict)> cdict{nullptr, &ZSTD_freeCDict};
+    std::unique_ptr<ZSTD_DDict, decltype(&ZSTD_freeDDict)> ddict{nullptr, &ZSTD_freeDDict};
+};
+
+struct ZstdEncoder::Impl {
+    std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx{nullptr, &ZSTD_freeCCtx};
+    std::string out;
+};
 
 std::string_view to_string(ZstdError err) {
     switch (err) {
+        case ZstdError::CompressionContext:
+            return "Failed to create zstd compression context";
         case ZstdError::DecodeEarlyTermination:
             return "Decoding terminated early; input is likely truncated";
         case ZstdError::DecompressionContext:
             return "Failed to create zstd decompression context";
+        case ZstdError::DictionaryTraining:
+            return "Failed to train dictionary";
         case ZstdError::InputEmpty:
             return "Input is empty";
+        case ZstdError::InvalidDictionary:
+            return "Invalid dictionary";
+        case ZstdError::InvalidLevel:
+            return "Invalid compression level";
         case ZstdError::MaximumOutputLengthExceeded:
             return "Output buffer exceeded maximum allowed length";
         case ZstdError::ZstdInternalError:
-            return "Decode failure";
+            return "Internal zstd error";
     }
 
     return "Unknown error";
 }
 
+tl::expected<void, ZstdError> zstd_decode(std::span<std::byte const> const input, std::string &out) {
+    return decode(input, out, nullptr);
+}
+
+tl::expected<void, ZstdError> zstd_decode(
+        std::span<std::byte const> const input, std::string &out, ZstdDictionary const &dictionary) {
+    return decode(input, out, dictionary.impl_->ddict.get());
+}
+
 tl::expected<std::vector<std::byte>, ZstdError> zstd_decode(std::span<std::byte const> const input) {
-    if (input.empty()) {
-        return tl::unexpected{ZstdError::InputEmpty};
+    std::string out;
+    if (auto res = zstd_decode(input, out); !res) {
+        return tl::unexpected{res.error()};
     }
 
-    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+    auto const *data = reinterpret_cast<std::byte const *>(out.data());
+    return std::vector<std::byte>(data, data + out.size());
+}
 
-    if (dctx == nullptr) {
-        return tl::unexpected{ZstdError::DecompressionContext};
+tl::expected<std::vector<std::byte>, ZstdError> zstd_train_dictionary(
+        std::span<std::string_view const> samples, std::size_t max_size) {
+    // The trainer wants the samples back to back.
+    std::string concatenated;
+    std::vector<std::size_t> sizes;
+    sizes.reserve(samples.size());
+    for (auto sample : samples) {
+        concatenated += sample;
+        sizes.push_back(sample.size());
     }
 
-    // Cap output buffer at 1GB. If we hit this, something fishy is probably
-    // going on, and we should bail before we OOM.
-    std::size_t constexpr kMaxOutSize = 1000000000;
+    std::vector<std::byte> dictionary(max_size);
+    auto const size = ZDICT_trainFromBuffer(dictionary.data(),
+            dictionary.size(),
+            concatenated.data(),
+            sizes.data(),
+            static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(size) != 0u) {
+        return tl::unexpected{ZstdError::DictionaryTraining};
+    }
 
-    std::size_t const chunk_size = ZSTD_DStreamOutSize();
+    dictionary.resize(size);
+    return dictionary;
+}
 
-    std::vector<std::byte> out;
+ZstdDictionary::ZstdDictionary(std::unique_ptr<Impl> impl) : impl_{std::move(impl)} {}
+ZstdDictionary::~ZstdDictionary() = default;
+ZstdDictionary::ZstdDictionary(ZstdDictionary &&) noexcept = default;
+ZstdDictionary &ZstdDictionary::operator=(ZstdDictionary &&) noexcept = default;
 
-    static_assert(CHAR_BIT == 8, "zstd requires 8-bit input");
-    ZSTD_inBuffer in_buf = {input.data(), input.size_bytes(), 0};
+tl::expected<ZstdDictionary, ZstdError> ZstdDictionary::create(std::span<std::byte const> dictionary, int level) {
+    if (!is_valid_level(level)) {
+        return tl::unexpected{ZstdError::InvalidLevel};
+    }
 
-    std::size_t count = 0;
-    std::size_t last_ret = 0;
-    std::size_t last_pos = 0;
+    auto impl = std::make_unique<Impl>();
+    impl->cdict.reset(ZSTD_createCDict(dictionary.data(), dictionary.size(), level));
+    impl->ddict.reset(ZSTD_createDDict(dictionary.data(), dictionary.size()));
+    if (impl->cdict == nullptr || impl->ddict == nullptr) {
+        return tl::unexpected{ZstdError::InvalidDictionary};
+    }
 
-    while (in_buf.pos < in_buf.size) {
-        count++;
+    return ZstdDictionary{std::move(impl)};
+}
 
-        if ((chunk_size * count) > kMaxOutSize) {
-            return tl::unexpected{ZstdError::MaximumOutputLengthExceeded};
-        }
+std::uint32_t ZstdDictionary::id() const {
+    return ZSTD_getDictID_fromCDict(impl_->cdict.get());
+}
 
-        out.resize(chunk_size * count);
+ZstdEncoder::ZstdEncoder(std::unique_ptr<Impl> impl) : impl_{std::move(impl)} {}
+ZstdEncoder::~ZstdEncoder() = default;
+ZstdEncoder::ZstdEncoder(ZstdEncoder &&) noexcept = default;
+ZstdEncoder &ZstdEncoder::operator=(ZstdEncoder &&) noexcept = default;
 
-        ZSTD_outBuffer out_buf = {out.data() + (chunk_size * (count - 1)), chunk_size, 0};
+tl::expected<ZstdEncoder, ZstdError> ZstdEncoder::create(int level) {
+    if (!is_valid_level(level)) {
+        return tl::unexpected{ZstdError::InvalidLevel};
+    }
+
+    auto impl = std::make_unique<Impl>();
+    impl->cctx.reset(ZSTD_createCCtx());
+    if (impl->cctx == nullptr) {
+        return tl::unexpected{ZstdError::CompressionContext};
+    }
 
-        std::size_t const ret = ZSTD_decompressStream(dctx.get(), &out_buf, &in_buf);
+    if (ZSTD_isError(ZSTD_CCtx_setParameter(impl->cctx.get(), ZSTD_c_compressionLevel, level)) != 0u) {
+        return tl::unexpected{ZstdError::InvalidLevel};
+    }
 
+    return ZstdEncoder{std::move(impl)};
+}
+
+tl::expected<ZstdEncoder, ZstdError> ZstdEncoder::create(ZstdDictionary const &dictionary) {
+    auto impl = std::make_unique<Impl>();
+    impl->cctx.reset(ZSTD_createCCtx());
+    if (impl->cctx == nullptr) {
+        return tl::unexpected{ZstdError::CompressionContext};
+    }
+
+    if (ZSTD_isError(ZSTD_CCtx_refCDict(impl->cctx.get(), dictionary.impl_->cdict.get())) != 0u) {
+        return tl::unexpected{ZstdError::InvalidDictionary};
+    }
+
+    return ZstdEncoder{std::move(impl)};
+}
+
+tl::expected<void, ZstdError> ZstdEncoder::write(std::span<std::byte const> data) {
+    ZSTD_inBuffer in_buf = {data.data(), data.size(), 0};
+    while (in_buf.pos < in_buf.size) {
+        auto &out = impl_->out;
+        auto const written = out.size();
+        util::resize_uninitialized(out, written + ZSTD_CStreamOutSize());
+        ZSTD_outBuffer out_buf = {out.data(), out.size(), written};
+        auto const ret = ZSTD_compressStream2(impl_->cctx.get(), &out_buf, &in_buf, ZSTD_e_continue);
+        out.resize(out_buf.pos);
         if (ZSTD_isError(ret) != 0u) {
             return tl::unexpected{ZstdError::ZstdInternalError};
         }
-
-        last_ret = ret;
-        last_pos = out_buf.pos;
     }
 
-    if (last_ret != 0) {
-        return tl::unexpected{ZstdError::DecodeEarlyTermination};
-    }
+    return {};
+}
 
-    std::size_t out_size = 0;
+tl::expected<void, ZstdError> ZstdEncoder::finish() {
+    ZSTD_inBuffer in_buf = {nullptr, 0, 0};
+    std::size_t remaining = 0;
+    do {
+        auto &out = impl_->out;
+        auto const written = out.size();
+        util::resize_uninitialized(out, written + ZSTD_CStreamOutSize());
+        ZSTD_outBuffer out_buf = {out.data(), out.size(), written};
+        remaining = ZSTD_compressStream2(impl_->cctx.get(), &out_buf, &in_buf, ZSTD_e_end);
+        out.resize(out_buf.pos);
+        if (ZSTD_isError(remaining) != 0u) {
+            return tl::unexpected{ZstdError::ZstdInternalError};
+        }
+    } while (remaining != 0);
 
-    if (count == 1) {
-        out_size = last_pos;
-    } else {
-        out_size = last_pos == 0 ? chunk_size * count : (chunk_size * count) - (chunk_size - last_pos);
+    return {};
+}
+
+std::string ZstdEncoder::take() {
+    return std::exchange(impl_->out, {});
+}
+
+tl::expected<std::string, ZstdError> zstd_encode(std::span<std::byte const> const input, int level) {
+    if (!is_valid_level(level)) {
+        return tl::unexpected{ZstdError::InvalidLevel};
     }
 
-    // Shrink buffer to match what we actually decoded
-    out.resize(out_size);
+    return encode(input, level, nullptr);
+}
 
-    return out;
+tl::expected<std::string, ZstdError> zstd_encode(
+        std::span<std::byte const> const input, ZstdDictionary const &dictionary) {
+    return encode(input, kZstdDefaultLevel, dictionary.impl_->cdict.get());
 }
 
 } // namespace archive
@@ -10,16 +10,22 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <span>
+#include <string>
 #include <string_view>
 #include <vector>
 
 namespace archive {
 
 enum class ZstdError : std::uint8_t {
+    CompressionContext,
     DecodeEarlyTermination,
     DecompressionContext,
+    DictionaryTraining,
     InputEmpty,
+    InvalidDictionary,
+    InvalidLevel,
     MaximumOutputLengthExceeded,
     ZstdInternalError,
 };
@@ -28,6 +34,82 @@ std::string_view to_string(ZstdError);
 
 tl::expected<std::vector<std::byte>, ZstdError> zstd_decode(std::span<std::byte const>);
 
+// Decodes into out, replacing its contents, so that an existing string can be
+// filled w/o copying the output to it afterwards. The input can't be in out.
+tl::expected<void, ZstdError> zstd_decode(std::span<std::byte const>, std::string &out);
+
+// Levels range from 1 (fastest) to 22 (smallest output). Negative levels trade
+// even more of the compression ratio for speed.
+inline constexpr int kZstdDefaultLevel = 3;
+
+// Trains a dictionary of at most max_size bytes on samples of the kind of data
+// that'll be compressed w/ it. The dictionary is meant to be stored, and both
+// the encoder and decoder need to be given the same one.
+tl::expected<std::vector<std::byte>, ZstdError> zstd_train_dictionary(
+        std::span<std::string_view const> samples, std::size_t max_size = 112 * 1024);
+
+// A dictionary that's been digested for use. Small inputs that share a lot w/
+// each other, like pages from the same site, compress a lot better w/ one, as
+// what they share doesn't have to be repeated in every one of them.
+class ZstdDictionary {
+public:
+    // The dictionary is digested for compressing at a specific level, which
+    // encoders using it will use instead of their own.
+    static tl::expected<ZstdDictionary, ZstdError> create(
+            std::span<std::byte const> dictionary, int level = kZstdDefaultLevel);
+
+    ~ZstdDictionary();
+    ZstdDictionary(ZstdDictionary &&) noexcept;
+    ZstdDictionary &operator=(ZstdDictionary &&) noexcept;
+
+    // Identifies the dictionary. Frames compressed w/ it contain this id.
+    std::uint32_t id() const;
+
+private:
+    friend class ZstdEncoder;
+    friend tl::expected<void, ZstdError> zstd_decode(std::span<std::byte const>, std::string &, ZstdDictionary const &);
+    friend tl::expected<std::string, ZstdError> zstd_encode(std::span<std::byte const>, ZstdDictionary const &);
+
+    struct Impl;
+    explicit ZstdDictionary(std::unique_ptr<Impl>);
+    std::unique_ptr<Impl> impl_;
+};
+
+tl::expected<void, ZstdError> zstd_decode(std::span<std::byte const>, std::string &out, ZstdDictionary const &);
+
+// Compresses data that arrives in chunks into a single frame. The compressed
+// data is available as soon as the encoder produces it, but most of it won't
+// be produced until the encoder is finished.
+class ZstdEncoder {
+public:
+    static tl::expected<ZstdEncoder, ZstdError> create(int level = kZstdDefaultLevel);
+
+    // The dictionary must outlive the encoder.
+    static tl::expected<ZstdEncoder, ZstdError> create(ZstdDictionary const &);
+
+    ~ZstdEncoder();
+    ZstdEncoder(ZstdEncoder &&) noexcept;
+    ZstdEncoder &operator=(ZstdEncoder &&) noexcept;
+
+    tl::expected<void, ZstdError> write(std::span<std::byte const>);
+
+    // Ends the frame. Nothing can be written after this.
+    tl::expected<void, ZstdError> finish();
+
+    // Takes the compressed data produced so far.
+    std::string take();
+
+private:
+    struct Impl;
+    explicit ZstdEncoder(std::unique_ptr<Impl>);
+    std::unique_ptr<Impl> impl_;
+};
+
+tl::expected<std::string, ZstdError> zstd_encode(std::span<std::byte const>, int level = kZstdDefaultLevel);
+
+// Compresses at the level the dictionary was digested for.
+tl::expected<std::string, ZstdError> zstd_encode(std::span<std::byte const>, ZstdDictionary const &);
+
 } // namespace archive
 
 #endif
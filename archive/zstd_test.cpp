@@ -9,23 +9,42 @@
 
 #include <tl/expected.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstdint>
 #include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace {
 std::span<std::byte const> as_bytes(std::span<std::uint8_t const> s) {
     return {reinterpret_cast<std::byte const *>(s.data()), s.size()};
 }
+
+std::span<std::byte const> as_bytes(std::string_view s) {
+    return {reinterpret_cast<std::byte const *>(s.data()), s.size()};
+}
+
+// Pages w/ a lot of shared boilerplate, like the ones from a single site.
+std::string page(int i) {
+    auto const n = std::to_string(i);
+    return "<!DOCTYPE html><html lang=en><head><meta charset=utf-8><title>Article " + n
+            + "</title><link rel=stylesheet href=/style.css><script src=/app.js defer></script></head>"
+              "<body><header><nav><a href=/>Home</a> <a href=/about>About</a> <a href=/archive>Archive</a></nav>"
+              "</header><main><article><h1>Article number "
+            + n + "</h1><p>This is the body of article " + n
+            + ", which isn't very long.</p></article></main><footer><p>Copyright, all rights reserved.</p>"
+              "</footer></body></html>";
+}
 } // namespace
 
 int main() {
     etest::Suite s{"zstd"};
 
     using namespace archive;
+    using namespace std::literals;
 
     s.add_test("trivial decode", [](etest::IActions &a) {
         constexpr auto kCompress = std::to_array<std::uint8_t>({0x28,
@@ -264,5 +283,137 @@ int main() {
         a.expect_eq(ret.error(), ZstdError::DecodeEarlyTermination);
     });
 
+    // "hello hello hello hello hello hello hello\n" w/ its size in the frame header.
+    static constexpr auto kHelloWithSize = std::to_array<std::uint8_t>({
+            0x28, 0xb5, 0x2f, 0xfd, 0x24, 0x2a, 0x6d, 0x00, 0x00, 0x38, 0x68, 0x65, 0x6c, //
+            0x6c, 0x6f, 0x20, 0x0a, 0x01, 0x00, 0x42, 0x96, 0x22, 0x75, 0x17, 0xc9, 0xf3,
+    });
+    static constexpr std::string_view kHello = "hello hello hello hello hello hello hello\n";
+
+    s.add_test("known content size", [](etest::IActions &a) {
+        std::string out{"replaced"};
+        a.expect(zstd_decode(as_bytes(kHelloWithSize), out).has_value());
+        a.expect_eq(out, kHello);
+
+        auto ret = zstd_decode(as_bytes(kHelloWithSize));
+        a.require(ret.has_value());
+        a.expect_eq(std::string(reinterpret_cast<char const *>(ret->data()), ret->size()), kHello);
+    });
+
+    s.add_test("known content size, truncated", [](etest::IActions &a) {
+        std::string out;
+        auto ret = zstd_decode(as_bytes(kHelloWithSize).first(kHelloWithSize.size() - 4), out);
+        a.expect_eq(ret, tl::unexpected{ZstdError::DecodeEarlyTermination});
+    });
+
+    s.add_test("concatenated frames", [](etest::IActions &a) {
+        // The first frame's size is only a hint for the whole output.
+        std::vector<std::uint8_t> frames(kHelloWithSize.begin(), kHelloWithSize.end());
+        frames.insert(frames.end(), kHelloWithSize.begin(), kHelloWithSize.end());
+
+        std::string out;
+        a.expect(zstd_decode(as_bytes(frames), out).has_value());
+        a.expect_eq(out, std::string{kHello} + std::string{kHello});
+    });
+
+    s.add_test("encode, round-trip", [](etest::IActions &a) {
+        auto const expected = page(1) + page(2) + page(3);
+        for (int level : {-5, 1, kZstdDefaultLevel, 19}) {
+            auto encoded = zstd_encode(as_bytes(expected), level);
+            a.require(encoded.has_value());
+            a.expect(encoded->size() < expected.size());
+
+            std::string out;
+            a.expect(zstd_decode(as_bytes(*encoded), out).has_value());
+            a.expect_eq(out, expected);
+        }
+    });
+
+    s.add_test("encode, invalid level", [](etest::IActions &a) {
+        a.expect_eq(zstd_encode(as_bytes("hello"sv), 23), tl::unexpected{ZstdError::InvalidLevel});
+        a.expect_eq(ZstdEncoder::create(23).error(), ZstdError::InvalidLevel);
+    });
+
+    s.add_test("encode, empty input", [](etest::IActions &a) {
+        // An empty frame is still a frame.
+        auto encoded = zstd_encode({});
+        a.require(encoded.has_value());
+        std::string out{"replaced"};
+        a.expect(zstd_decode(as_bytes(*encoded), out).has_value());
+        a.expect_eq(out, "");
+    });
+
+    s.add_test("encoder, chunked", [](etest::IActions &a) {
+        std::string expected;
+        for (int i = 0; i < 1000; ++i) {
+            expected += page(i);
+        }
+
+        auto encoder = ZstdEncoder::create();
+        a.require(encoder.has_value());
+
+        // Output is taken as it's produced, like it would be if it was written
+        // to disk.
+        std::string encoded;
+        auto const data = as_bytes(expected);
+        for (std::size_t i = 0; i < data.size(); i += 1000) {
+            a.require(encoder->write(data.subspan(i, std::min(std::size_t{1000}, data.size() - i))).has_value());
+            encoded += encoder->take();
+        }
+        a.require(encoder->finish().has_value());
+        encoded += encoder->take();
+
+        std::string out;
+        a.expect(zstd_decode(as_bytes(encoded), out).has_value());
+        a.expect(out == expected);
+    });
+
+    s.add_test("dictionary", [](etest::IActions &a) {
+        std::vector<std::string> samples;
+        for (int i = 0; i < 500; ++i) {
+            samples.push_back(page(i));
+        }
+        std::vector<std::string_view> const sample_views(samples.begin(), samples.end());
+
+        auto trained = zstd_train_dictionary(sample_views, 4096);
+        a.require(trained.has_value());
+        auto dictionary = ZstdDictionary::create(*trained);
+        a.require(dictionary.has_value());
+        a.expect(dictionary->id() != 0);
+
+        // A page the dictionary hasn't seen.
+        auto const expected = page(1234);
+        auto independent = zstd_encode(as_bytes(expected));
+        a.require(independent.has_value());
+
+        auto encoder = ZstdEncoder::create(*dictionary);
+        a.require(encoder.has_value());
+        a.require(encoder->write(as_bytes(expected)).has_value());
+        a.require(encoder->finish().has_value());
+        auto const with_dictionary = encoder->take();
+        a.expect(with_dictionary.size() * 3 < independent->size());
+
+        std::string out;
+        a.expect(zstd_decode(as_bytes(with_dictionary), out, *dictionary).has_value());
+        a.expect_eq(out, expected);
+
+        auto one_shot = zstd_encode(as_bytes(expected), *dictionary);
+        a.require(one_shot.has_value());
+        a.expect(one_shot->size() * 3 < independent->size());
+        a.expect(zstd_decode(as_bytes(*one_shot), out, *dictionary).has_value());
+        a.expect_eq(out, expected);
+
+        // Not decodable w/o the dictionary, but the decoder forgets about it
+        // between uses.
+        a.expect(!zstd_decode(as_bytes(with_dictionary), out).has_value());
+        a.expect(zstd_decode(as_bytes(*independent), out).has_value());
+        a.expect_eq(out, expected);
+    });
+
+    s.add_test("dictionary, too few samples", [](etest::IActions &a) {
+        std::vector<std::string_view> const samples{"a"sv, "b"sv};
+        a.expect_eq(zstd_train_dictionary(samples), tl::unexpected{ZstdError::DictionaryTraining});
+    });
+
     return s.run();
 }
@@ -9,35 +9,153 @@
 #include <cstddef>
 #include <cstdint>
 #include <optional>
+#include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
 
 namespace azm::amd64 {
 
+// The registers are listed in encoding order.
+enum class Reg8 : std::uint8_t {
+    Al,
+    Cl,
+    Dl,
+    Bl,
+    Spl,
+    Bpl,
+    Sil,
+    Dil,
+    R8b,
+    R9b,
+    R10b,
+    R11b,
+    R12b,
+    R13b,
+    R14b,
+    R15b,
+};
+
+enum class Reg16 : std::uint8_t {
+    Ax,
+    Cx,
+    Dx,
+    Bx,
+    Sp,
+    Bp,
+    Si,
+    Di,
+    R8w,
+    R9w,
+    R10w,
+    R11w,
+    R12w,
+    R13w,
+    R14w,
+    R15w,
+};
+
 enum class Reg32 : std::uint8_t {
     Eax,
     Ecx,
     Edx,
     Ebx,
+    Esp,
+    Ebp,
+    Esi,
+    Edi,
+    R8d,
+    R9d,
+    R10d,
+    R11d,
+    R12d,
+    R13d,
+    R14d,
+    R15d,
+};
+
+enum class Reg64 : std::uint8_t {
+    Rax,
+    Rcx,
+    Rdx,
+    Rbx,
+    Rsp,
+    Rbp,
+    Rsi,
+    Rdi,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15,
+};
+
+struct Imm8 {
+    std::uint8_t v{};
 };
 
 struct Imm32 {
     std::uint32_t v{};
 };
 
-constexpr std::optional<std::uint8_t> register_index(Reg32 reg) {
-    switch (reg) {
-        case Reg32::Eax:
-            return std::uint8_t{0};
-        case Reg32::Ecx:
-            return std::uint8_t{1};
-        case Reg32::Edx:
-            return std::uint8_t{2};
-        case Reg32::Ebx:
-            return std::uint8_t{3};
-    }
-    return std::nullopt;
+struct Imm64 {
+    std::uint64_t v{};
+};
+
+// [base + index + disp]
+struct Mem {
+    Reg64 base{};
+    std::optional<Reg64> index{};
+    std::int32_t disp{};
+};
+
+// The condition codes used by Jcc and SETcc.
+enum class Condition : std::uint8_t {
+    Overflow = 0x0,
+    NotOverflow = 0x1,
+    Below = 0x2,
+    AboveOrEqual = 0x3,
+    Equal = 0x4,
+    NotEqual = 0x5,
+    BelowOrEqual = 0x6,
+    Above = 0x7,
+    Sign = 0x8,
+    NotSign = 0x9,
+    Less = 0xc,
+    GreaterOrEqual = 0xd,
+    LessOrEqual = 0xe,
+    Greater = 0xf,
+};
+
+constexpr Condition negate(Condition c) {
+    // The conditions come in pairs only differing in the lowest bit.
+    return static_cast<Condition>(static_cast<std::uint8_t>(c) ^ 1);
+}
+
+template<typename Reg>
+requires std::is_same_v<Reg, Reg8> || std::is_same_v<Reg, Reg16> || std::is_same_v<Reg, Reg32>
+        || std::is_same_v<Reg, Reg64>
+constexpr std::optional<std::uint8_t> register_index(Reg reg) {
+    auto const idx = static_cast<std::uint8_t>(reg);
+    if (idx >= 16) {
+        return std::nullopt;
+    }
+    return idx;
+}
+
+constexpr Reg8 low_byte(Reg32 reg) {
+    return static_cast<Reg8>(reg);
+}
+
+constexpr Reg16 low_word(Reg32 reg) {
+    return static_cast<Reg16>(reg);
+}
+
+constexpr Reg64 full_width(Reg32 reg) {
+    return static_cast<Reg64>(reg);
 }
 
 struct Label {
@@ -58,6 +176,7 @@ struct Label {
 class Assembler {
 public:
     [[nodiscard]] std::vector<std::uint8_t> take_assembled() { return std::exchange(assembled_, {}); }
+    std::size_t size() const { return assembled_.size(); }
 
     Label label() const { return Label::linked(assembled_.size()); }
     Label unlinked_label() const { return Label::unlinked(); }
@@ -87,9 +206,71 @@ public:
             return;
         }
 
-        emit(0x81);
-        mod_rm(0b11, 0, register_index(dst).value());
-        emit(imm32);
+        group1(0, dst, imm32);
+    }
+
+    void add(Reg32 dst, Reg32 src) { op_rm_reg(0x01, dst, src); }
+    void add(Reg64 dst, Imm32 imm32) { group1(0, dst, imm32); }
+
+    void and_(Reg32 dst, Imm32 imm32) { group1(4, dst, imm32); }
+    void and_(Reg32 dst, Reg32 src) { op_rm_reg(0x21, dst, src); }
+
+    void call(Label &label) {
+        // CALL rel32
+        emit(0xe8);
+        rel32(label);
+    }
+
+    void call(Reg64 target) {
+        // CALL r/m64
+        rex(false, 0, 0, index(target));
+        emit(0xff);
+        mod_rm(0b11, 2, index(target) & 7);
+    }
+
+    void cdq() { emit(0x99); }
+
+    void cmp(Reg32 lhs, Imm32 imm32) { group1(7, lhs, imm32); }
+    void cmp(Reg32 lhs, Reg32 rhs) { op_rm_reg(0x39, lhs, rhs); }
+    void cmp(Reg64 lhs, Reg64 rhs) { op_rm_reg(0x39, lhs, rhs); }
+
+    void cmp(Reg64 lhs, Mem const &rhs) {
+        // CMP r64, r/m64
+        rex(true, index(lhs), rhs);
+        emit(0x3b);
+        mod_rm(index(lhs), rhs);
+    }
+
+    // EDX:EAX / src, unsigned.
+    void div(Reg32 src) { group3(6, src); }
+    // EDX:EAX / src, signed.
+    void idiv(Reg32 src) { group3(7, src); }
+
+    void imul(Reg32 dst, Reg32 src) {
+        // IMUL r32, r/m32
+        rex(false, index(dst), 0, index(src));
+        emit(0x0f);
+        emit(0xaf);
+        mod_rm(0b11, index(dst) & 7, index(src) & 7);
+    }
+
+    void jcc(Condition condition, Label &label) {
+        auto const cc = static_cast<std::uint8_t>(condition);
+        if (auto const *linked = std::get_if<Label::Linked>(&label.v)) {
+            auto const jmp_dst = static_cast<std::ptrdiff_t>(linked->offset - assembled_.size());
+            static constexpr int kShortInstructionSize = 2;
+            if (jmp_dst >= (-128 + kShortInstructionSize) && jmp_dst <= 0) {
+                // Jcc rel8
+                emit(0x70 + cc);
+                emit(static_cast<std::uint8_t>(jmp_dst) - kShortInstructionSize);
+                return;
+            }
+        }
+
+        // Jcc rel32
+        emit(0x0f);
+        emit(0x80 + cc);
+        rel32(label);
     }
 
     void jmp(Label &label) {
@@ -116,21 +297,116 @@ public:
         emit(Imm32{0xdeadbeef});
     }
 
+    void lea(Reg64 dst, Mem const &src) {
+        // LEA r64, m
+        rex(true, index(dst), src);
+        emit(0x8d);
+        mod_rm(index(dst), src);
+    }
+
     void mov(Reg32 dst, Imm32 imm32) {
         auto idx = register_index(dst);
         assert(idx.has_value());
-        emit(0xb8 + idx.value());
+        rex(false, 0, 0, idx.value());
+        emit(0xb8 + (idx.value() & 7));
+        emit(imm32);
+    }
+
+    void mov(Reg64 dst, Imm64 imm64) {
+        // MOV r64, imm64
+        rex(true, 0, 0, index(dst));
+        emit(0xb8 + (index(dst) & 7));
+        emit(Imm32{static_cast<std::uint32_t>(imm64.v)});
+        emit(Imm32{static_cast<std::uint32_t>(imm64.v >> 32)});
+    }
+
+    void mov(Reg32 dst, Reg32 src) { op_rm_reg(0x89, dst, src); }
+    void mov(Reg64 dst, Reg64 src) { op_rm_reg(0x89, dst, src); }
+
+    void mov(Reg32 dst, Mem const &src) { load(false, 0x8b, index(dst), src); }
+    void mov(Reg64 dst, Mem const &src) { load(true, 0x8b, index(dst), src); }
+    void mov(Mem const &dst, Reg32 src) { load(false, 0x89, index(src), dst); }
+    void mov(Mem const &dst, Reg64 src) { load(true, 0x89, index(src), dst); }
+
+    void mov(Mem const &dst, Imm32 imm32) {
+        // MOV r/m32, imm32
+        load(false, 0xc7, 0, dst);
         emit(imm32);
     }
 
+    void movsx(Reg32 dst, Reg8 src) { extend(0xbe, index(dst), index(src)); }
+    void movsx(Reg32 dst, Reg16 src) { extend(0xbf, index(dst), index(src)); }
+    void movzx(Reg32 dst, Reg8 src) { extend(0xb6, index(dst), index(src)); }
+
+    void or_(Reg32 dst, Imm32 imm32) { group1(1, dst, imm32); }
+    void or_(Reg32 dst, Reg32 src) { op_rm_reg(0x09, dst, src); }
+
+    void pop(Reg64 dst) {
+        rex(false, 0, 0, index(dst));
+        emit(0x58 + (index(dst) & 7));
+    }
+
+    void pop(Mem const &dst) { load(false, 0x8f, 0, dst); }
+
+    void push(Reg64 src) {
+        rex(false, 0, 0, index(src));
+        emit(0x50 + (index(src) & 7));
+    }
+
+    void push(Mem const &src) { load(false, 0xff, 6, src); }
+
+    // Fills RCX quadwords at [RDI] w/ RAX.
+    void rep_stosq() {
+        emit(0xf3);
+        emit(0x48);
+        emit(0xab);
+    }
+
     void ret() { emit(0xc3); }
 
+    // Rotates and shifts by CL.
+    void rol(Reg32 dst) { group2(0, dst); }
+    void ror(Reg32 dst) { group2(1, dst); }
+    void sar(Reg32 dst) { group2(7, dst); }
+    void shl(Reg32 dst) { group2(4, dst); }
+    void shr(Reg32 dst) { group2(5, dst); }
+
+    void rol(Reg32 dst, Imm8 imm8) { group2(0, dst, imm8); }
+    void ror(Reg32 dst, Imm8 imm8) { group2(1, dst, imm8); }
+    void sar(Reg32 dst, Imm8 imm8) { group2(7, dst, imm8); }
+    void shl(Reg32 dst, Imm8 imm8) { group2(4, dst, imm8); }
+    void shr(Reg32 dst, Imm8 imm8) { group2(5, dst, imm8); }
+
+    void setcc(Condition condition, Reg8 dst) {
+        // SETcc r/m8
+        byte_rex(0, index(dst));
+        emit(0x0f);
+        emit(0x90 + static_cast<std::uint8_t>(condition));
+        mod_rm(0b11, 0, index(dst) & 7);
+    }
+
+    void sub(Reg32 dst, Imm32 imm32) { group1(5, dst, imm32); }
+    void sub(Reg32 dst, Reg32 src) { op_rm_reg(0x29, dst, src); }
+    void sub(Reg64 dst, Imm32 imm32) { group1(5, dst, imm32); }
+
+    void test(Reg32 lhs, Reg32 rhs) { op_rm_reg(0x85, lhs, rhs); }
+
     void ud2() {
         emit(0x0f);
         emit(0x0b);
     }
 
+    void xor_(Reg32 dst, Imm32 imm32) { group1(6, dst, imm32); }
+    void xor_(Reg32 dst, Reg32 src) { op_rm_reg(0x31, dst, src); }
+
 private:
+    template<typename Reg>
+    static std::uint8_t index(Reg reg) {
+        auto idx = register_index(reg);
+        assert(idx.has_value());
+        return idx.value();
+    }
+
     void emit(std::uint8_t byte) { assembled_.push_back(byte); }
     void emit(Imm32 imm32) {
         for (auto i = 0; i < 4; ++i) {
@@ -139,6 +415,18 @@ private:
         }
     }
 
+    void rel32(Label &label) {
+        if (auto const *linked = std::get_if<Label::Linked>(&label.v)) {
+            static constexpr int kImmSize = 4;
+            auto const dst = static_cast<std::ptrdiff_t>(linked->offset - assembled_.size());
+            emit(Imm32{static_cast<std::uint32_t>(dst - kImmSize)});
+            return;
+        }
+
+        std::get<Label::Unlinked>(label.v).patch_offsets.push_back(assembled_.size());
+        emit(Imm32{0xdeadbeef});
+    }
+
     void mod_rm(std::uint8_t mod, std::uint8_t reg, std::uint8_t rm) {
         assert(mod < 4);
         assert(reg < 8);
@@ -146,6 +434,110 @@ private:
         emit((mod << 6) | (reg << 3) | rm);
     }
 
+    // ModR/M, and SIB and displacement if needed, for a memory operand.
+    void mod_rm(std::uint8_t reg, Mem const &m) {
+        auto const base = index(m.base) & 7;
+        std::uint8_t mod = 0b10;
+        if (m.disp == 0 && base != 0b101) {
+            mod = 0b00;
+        } else if (m.disp >= -128 && m.disp <= 127) {
+            mod = 0b01;
+        }
+
+        if (m.index.has_value() || base == 0b100) {
+            // rm = 0b100 means a SIB byte follows, and index = 0b100 in the
+            // SIB byte means there's no index.
+            mod_rm(mod, reg & 7, 0b100);
+            auto const idx = m.index.has_value() ? index(*m.index) : std::uint8_t{0b100};
+            assert(!m.index.has_value() || *m.index != Reg64::Rsp);
+            emit(static_cast<std::uint8_t>(((idx & 7) << 3) | base));
+        } else {
+            mod_rm(mod, reg & 7, base);
+        }
+
+        if (mod == 0b01) {
+            emit(static_cast<std::uint8_t>(m.disp));
+        } else if (mod == 0b10) {
+            emit(Imm32{static_cast<std::uint32_t>(m.disp)});
+        }
+    }
+
+    void rex(bool w, std::uint8_t reg, std::uint8_t idx, std::uint8_t rm) {
+        std::uint8_t const bits = (w ? 0b1000 : 0) | ((reg >> 3) << 2) | ((idx >> 3) << 1) | (rm >> 3);
+        if (bits != 0) {
+            emit(0x40 | bits);
+        }
+    }
+
+    void rex(bool w, std::uint8_t reg, Mem const &m) {
+        rex(w, reg, m.index.has_value() ? index(*m.index) : std::uint8_t{0}, index(m.base));
+    }
+
+    // Byte registers 4-7 mean AH, CH, DH, and BH w/o a REX prefix, and SPL,
+    // BPL, SIL, and DIL w/ one.
+    void byte_rex(std::uint8_t reg, std::uint8_t rm) {
+        if (reg >= 8 || rm >= 4) {
+            emit(0x40 | ((reg >> 3) << 2) | (rm >> 3));
+        }
+    }
+
+    // OP r/m, reg
+    template<typename Reg>
+    void op_rm_reg(std::uint8_t opcode, Reg rm, Reg reg) {
+        rex(std::is_same_v<Reg, Reg64>, index(reg), 0, index(rm));
+        emit(opcode);
+        mod_rm(0b11, index(reg) & 7, index(rm) & 7);
+    }
+
+    // OP reg, m or OP m, reg
+    void load(bool w, std::uint8_t opcode, std::uint8_t reg, Mem const &m) {
+        rex(w, reg, m);
+        emit(opcode);
+        mod_rm(reg, m);
+    }
+
+    // ADD, OR, AND, SUB, XOR, and CMP w/ an immediate.
+    template<typename Reg>
+    void group1(std::uint8_t op, Reg dst, Imm32 imm32) {
+        rex(std::is_same_v<Reg, Reg64>, 0, 0, index(dst));
+        emit(0x81);
+        mod_rm(0b11, op, index(dst) & 7);
+        emit(imm32);
+    }
+
+    // Rotates and shifts.
+    void group2(std::uint8_t op, Reg32 dst) {
+        rex(false, 0, 0, index(dst));
+        emit(0xd3);
+        mod_rm(0b11, op, index(dst) & 7);
+    }
+
+    void group2(std::uint8_t op, Reg32 dst, Imm8 imm8) {
+        rex(false, 0, 0, index(dst));
+        emit(0xc1);
+        mod_rm(0b11, op, index(dst) & 7);
+        emit(imm8.v);
+    }
+
+    // Unsigned and signed division.
+    void group3(std::uint8_t op, Reg32 src) {
+        rex(false, 0, 0, index(src));
+        emit(0xf7);
+        mod_rm(0b11, op, index(src) & 7);
+    }
+
+    // MOVZX and MOVSX
+    void extend(std::uint8_t opcode, std::uint8_t reg, std::uint8_t rm) {
+        if (opcode == 0xbf) {
+            rex(false, reg, 0, rm);
+        } else {
+            byte_rex(reg, rm);
+        }
+        emit(0x0f);
+        emit(opcode);
+        mod_rm(0b11, reg & 7, rm & 7);
+    }
+
     std::vector<std::uint8_t> assembled_;
 };
 
@@ -23,6 +23,8 @@ int main() {
         a.expect_eq(register_index(Reg32::Ecx), 1);
         a.expect_eq(register_index(Reg32::Edx), 2);
         a.expect_eq(register_index(Reg32::Ebx), 3);
+        a.expect_eq(register_index(Reg32::R15d), 15);
+        a.expect_eq(register_index(Reg64::R8), 8);
         // NOLINTNEXTLINE(clang-analyzer-optin.core.EnumCastOutOfRange)
         a.expect_eq(register_index(static_cast<Reg32>(std::underlying_type_t<Reg32>{30})), std::nullopt);
     });
@@ -43,6 +45,213 @@ int main() {
         a.expect_eq(assembler.take_assembled(), CodeVec{0x81, 0xc3, 0x42, 0, 0, 0});
     });
 
+    s.add_test("ADD/SUB/AND/OR/XOR/CMP reg, reg", [](etest::IActions &a) {
+        Assembler assembler;
+
+        assembler.add(Reg32::Esi, Reg32::R9d);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x44, 0x01, 0xce});
+        assembler.sub(Reg32::Eax, Reg32::Ecx);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x29, 0xc8});
+        assembler.and_(Reg32::Edi, Reg32::Esi);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x21, 0xf7});
+        assembler.or_(Reg32::Eax, Reg32::Edx);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x09, 0xd0});
+        assembler.xor_(Reg32::R11d, Reg32::R8d);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x45, 0x31, 0xc3});
+        assembler.cmp(Reg32::Esi, Reg32::R11d);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x44, 0x39, 0xde});
+        assembler.cmp(Reg64::Rax, Reg64::R13);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x4c, 0x39, 0xe8});
+        assembler.test(Reg32::R8d, Reg32::Esi);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x41, 0x85, 0xf0});
+    });
+
+    s.add_test("ADD/SUB/AND/OR/XOR/CMP reg, imm32", [](etest::IActions &a) {
+        Assembler assembler;
+
+        assembler.add(Reg32::R10d, Imm32{5});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x41, 0x81, 0xc2, 5, 0, 0, 0});
+        assembler.add(Reg64::Rsp, Imm32{8});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x48, 0x81, 0xc4, 8, 0, 0, 0});
+        assembler.sub(Reg64::Rsp, Imm32{8});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x48, 0x81, 0xec, 8, 0, 0, 0});
+        assembler.or_(Reg32::R8d, Imm32{0xff});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x41, 0x81, 0xc8, 0xff, 0, 0, 0});
+        assembler.cmp(Reg32::Esi, Imm32{0xffff'ffff});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x81, 0xfe, 0xff, 0xff, 0xff, 0xff});
+    });
+
+    s.add_test("MUL/DIV", [](etest::IActions &a) {
+        Assembler assembler;
+
+        assembler.imul(Reg32::R10d, Reg32::Edi);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x44, 0x0f, 0xaf, 0xd7});
+        assembler.cdq();
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x99});
+        assembler.div(Reg32::R9d);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x41, 0xf7, 0xf1});
+        assembler.idiv(Reg32::Esi);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0xf7, 0xfe});
+    });
+
+    s.add_test("Shifts and rotates", [](etest::IActions &a) {
+        Assembler assembler;
+
+        assembler.rol(Reg32::Esi);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0xd3, 0xc6});
+        assembler.ror(Reg32::R8d);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x41, 0xd3, 0xc8});
+        assembler.shr(Reg32::R11d);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x41, 0xd3, 0xeb});
+        assembler.shl(Reg32::R10d, Imm8{3});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x41, 0xc1, 0xe2, 3});
+        assembler.sar(Reg32::Esi, Imm8{31});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0xc1, 0xfe, 31});
+    });
+
+    s.add_test("SETcc, MOVZX, MOVSX", [](etest::IActions &a) {
+        Assembler assembler;
+
+        assembler.setcc(Condition::Equal, Reg8::Al);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x0f, 0x94, 0xc0});
+        // SIL requires a REX prefix, or it would be DH.
+        assembler.setcc(Condition::Less, Reg8::Sil);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x40, 0x0f, 0x9c, 0xc6});
+        assembler.setcc(Condition::Above, Reg8::R10b);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x41, 0x0f, 0x97, 0xc2});
+
+        assembler.movzx(Reg32::Eax, Reg8::Al);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x0f, 0xb6, 0xc0});
+        assembler.movzx(Reg32::Edi, Reg8::Dil);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x40, 0x0f, 0xb6, 0xff});
+        assembler.movsx(Reg32::Esi, Reg8::Sil);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x40, 0x0f, 0xbe, 0xf6});
+        assembler.movsx(Reg32::R8d, Reg16::R8w);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x45, 0x0f, 0xbf, 0xc0});
+    });
+
+    s.add_test("Jcc", [](etest::IActions &a) {
+        Assembler assembler;
+
+        auto back = assembler.label();
+        assembler.jcc(Condition::NotEqual, back);
+        auto forward = assembler.unlinked_label();
+        assembler.jcc(Condition::GreaterOrEqual, forward);
+        assembler.ud2();
+        assembler.link(forward);
+
+        a.expect_eq(assembler.take_assembled(),
+                CodeVec{
+                        0x75, // jne rel8
+                        0xfe, // -2
+                        0x0f, // jge rel32
+                        0x8d,
+                        0x02, // 2
+                        0x00,
+                        0x00,
+                        0x00,
+                        0x0f, // ud2
+                        0x0b,
+                });
+
+        a.expect_eq(negate(Condition::Less), Condition::GreaterOrEqual);
+        a.expect_eq(negate(Condition::Equal), Condition::NotEqual);
+        a.expect_eq(negate(Condition::Above), Condition::BelowOrEqual);
+    });
+
+    s.add_test("CALL", [](etest::IActions &a) {
+        Assembler assembler;
+
+        auto back = assembler.label();
+        auto forward = assembler.unlinked_label();
+        assembler.call(forward);
+        assembler.call(back);
+        assembler.link(forward);
+        assembler.call(Reg64::Rax);
+        assembler.call(Reg64::R11);
+
+        a.expect_eq(assembler.take_assembled(),
+                CodeVec{0xe8, 5, 0, 0, 0, 0xe8, 0xf6, 0xff, 0xff, 0xff, 0xff, 0xd0, 0x41, 0xff, 0xd3});
+    });
+
+    s.add_test("LEA", [](etest::IActions &a) {
+        Assembler assembler;
+
+        assembler.lea(Reg64::Rbx, Mem{.base = Reg64::Rbx, .disp = 0x100});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x48, 0x8d, 0x9b, 0x00, 0x01, 0, 0});
+        assembler.lea(Reg64::Rdx, Mem{.base = Reg64::Rbx, .disp = -8});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x48, 0x8d, 0x53, 0xf8});
+    });
+
+    s.add_test("MOV w/ memory operands", [](etest::IActions &a) {
+        Assembler assembler;
+
+        assembler.mov(Reg32::Esi, Mem{.base = Reg64::Rbx, .disp = 16});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x8b, 0x73, 0x10});
+        assembler.mov(Reg32::R8d, Mem{.base = Reg64::R12, .index = Reg64::Rax, .disp = -4});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x45, 0x8b, 0x44, 0x04, 0xfc});
+        assembler.mov(Reg64::R12, Mem{.base = Reg64::R14, .disp = 24});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x4d, 0x8b, 0x66, 0x18});
+        assembler.mov(Mem{.base = Reg64::Rbx, .disp = 0x1000}, Reg32::R11d);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x44, 0x89, 0x9b, 0x00, 0x10, 0, 0});
+        assembler.mov(Mem{.base = Reg64::Rbx, .disp = 8}, Reg64::Rsi);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x48, 0x89, 0x73, 0x08});
+        assembler.mov(Mem{.base = Reg64::Rbx, .disp = 8}, Imm32{0xdeadbeef});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0xc7, 0x43, 0x08, 0xef, 0xbe, 0xad, 0xde});
+
+        // No displacement.
+        assembler.mov(Reg64::Rax, Mem{.base = Reg64::Rbx});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x48, 0x8b, 0x03});
+        // RBP and R13 as the base always need a displacement.
+        assembler.mov(Reg64::Rax, Mem{.base = Reg64::R13});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x49, 0x8b, 0x45, 0x00});
+        assembler.mov(Reg64::Rax, Mem{.base = Reg64::Rbp, .index = Reg64::R9});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x4a, 0x8b, 0x44, 0x0d, 0x00});
+        // RSP and R12 as the base always need a SIB byte.
+        assembler.mov(Reg64::Rax, Mem{.base = Reg64::Rsp});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x48, 0x8b, 0x04, 0x24});
+        assembler.mov(Reg64::Rax, Mem{.base = Reg64::R12});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x49, 0x8b, 0x04, 0x24});
+    });
+
+    s.add_test("MOV r, r", [](etest::IActions &a) {
+        Assembler assembler;
+
+        assembler.mov(Reg32::Esi, Reg32::R8d);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x44, 0x89, 0xc6});
+        assembler.mov(Reg64::R14, Reg64::Rdi);
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x49, 0x89, 0xfe});
+    });
+
+    s.add_test("MOV r64, imm64", [](etest::IActions &a) {
+        Assembler assembler;
+
+        assembler.mov(Reg64::Rax, Imm64{0x1122'3344'5566'7788});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x48, 0xb8, 0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11});
+        assembler.mov(Reg64::R11, Imm64{1});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x49, 0xbb, 1, 0, 0, 0, 0, 0, 0, 0});
+    });
+
+    s.add_test("PUSH/POP", [](etest::IActions &a) {
+        Assembler assembler;
+
+        assembler.push(Reg64::Rbx);
+        assembler.push(Reg64::R15);
+        assembler.pop(Reg64::Rbp);
+        assembler.pop(Reg64::R12);
+        assembler.push(Mem{.base = Reg64::Rdi});
+        assembler.pop(Mem{.base = Reg64::R14});
+        a.expect_eq(assembler.take_assembled(),
+                CodeVec{0x53, 0x41, 0x57, 0x5d, 0x41, 0x5c, 0xff, 0x37, 0x41, 0x8f, 0x06});
+    });
+
+    s.add_test("REP STOSQ", [](etest::IActions &a) {
+        Assembler assembler;
+
+        assembler.rep_stosq();
+        a.expect_eq(assembler.take_assembled(), CodeVec{0xf3, 0x48, 0xab});
+    });
+
     s.add_test("JMP, backwards", [](etest::IActions &a) {
         Assembler assembler;
 
@@ -120,6 +329,9 @@ int main() {
 
         assembler.mov(Reg32::Edx, Imm32{0x1234});
         a.expect_eq(assembler.take_assembled(), CodeVec{0xba, 0x34, 0x12, 0, 0});
+
+        assembler.mov(Reg32::R9d, Imm32{42});
+        a.expect_eq(assembler.take_assembled(), CodeVec{0x41, 0xb9, 42, 0, 0, 0});
     });
 
     s.add_test("RET", [](etest::IActions &a) {
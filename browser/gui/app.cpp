@@ -10,7 +10,9 @@
 #include "dom/xpath.h"
 #include "engine/engine.h"
 #include "geom/geom.h"
+#include "gfx/canvas_command_saver.h"
 #include "gfx/color.h"
+#include "gfx/command_recording.h"
 #include "gfx/opengl_canvas.h"
 #include "gfx/sfml_canvas.h"
 #include "layout/layout_box.h"
@@ -18,12 +20,16 @@
 #include "protocol/handler_factory.h"
 #include "protocol/in_memory_cache.h"
 #include "protocol/response.h"
+#include "render/display_list.h"
 #include "render/render.h"
 #include "type/sfml.h"
 #include "type/type.h"
 #include "uri/uri.h"
 
+#include <SFML/Graphics/BlendMode.hpp>
 #include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/Graphics/View.hpp>
 #include <SFML/Window/Cursor.hpp>
 #include <SFML/Window/Event.hpp>
 #include <SFML/Window/Keyboard.hpp>
@@ -44,6 +50,8 @@
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <fstream>
+#include <ios>
 #include <iostream>
 #include <memory>
 #include <optional>
@@ -52,6 +60,7 @@
 #include <string>
 #include <string_view>
 #include <thread>
+#include <tuple>
 #include <utility>
 #include <variant>
 
@@ -217,6 +226,19 @@ std::unique_ptr<type::IType> create_font_system() {
     return type;
 }
 
+render::ImageLookup image_lookup(engine::PageState const &page) {
+    return [&images = page.images](dom::Element const &element) -> std::optional<render::ImagePixels> {
+        auto it = images.find(&element);
+        if (it == images.end()) {
+            return std::nullopt;
+        }
+
+        auto const &image = *it->second;
+        return render::ImagePixels{
+                static_cast<int>(image.width), static_cast<int>(image.height), image.rgba, image.id};
+    };
+}
+
 } // namespace
 
 // Latest Firefox ESR user agent (on Windows). This matches what the Tor browser does.
@@ -227,7 +249,7 @@ App::App(std::string browser_title, std::string start_page_hint, bool load_start
       browser_title_{std::move(browser_title)},
       window_{sf::VideoMode({kDefaultResolutionX, kDefaultResolutionY}), browser_title_},
       url_buf_{std::move(start_page_hint)},
-      canvas_{std::make_unique<gfx::SfmlCanvas>(window_, static_cast<type::SfmlType &>(engine_.font_system()))} {
+      canvas_{std::make_unique<gfx::SfmlCanvas>(surface_, static_cast<type::SfmlType &>(engine_.font_system()))} {
     window_.setIcon({16, 16}, kBrowserIcon.data());
     if (!ImGui::SFML::Init(window_)) {
         spdlog::critical("imgui-sfml initialization failed");
@@ -242,7 +264,7 @@ App::App(std::string browser_title, std::string start_page_hint, bool load_start
         ImGui::GetIO().IniFilename = nullptr;
     }
 
-    canvas_->set_viewport_size(window_.getSize().x, window_.getSize().y);
+    resize_surface(window_.getSize().x, window_.getSize().y);
 
     if (load_start_page) {
         ensure_has_scheme(url_buf_);
@@ -263,11 +285,14 @@ void App::set_scale(unsigned scale) {
     // Only resize the window if the user hasn't resized it.
     if (window_size.x == kDefaultResolutionX && window_size.y == kDefaultResolutionY) {
         window_.setSize({kDefaultResolutionX * scale_, kDefaultResolutionY * scale_});
-        canvas_->set_viewport_size(window_.getSize().x, window_.getSize().y);
+        resize_surface(window_.getSize().x, window_.getSize().y);
     }
+
+    damage_.invalidate_all();
 }
 
 void App::step() {
+    auto const frame_start = std::chrono::steady_clock::now();
     while (auto event = window_.pollEvent()) {
         // ImGui needs a few iterations to do what it wants to do. This was
         // pretty much picked at random after I still occasionally got
@@ -278,7 +303,7 @@ void App::step() {
         if (event->is<sf::Event::Closed>()) {
             window_.close();
         } else if (auto const *resized = event->getIf<sf::Event::Resized>()) {
-            canvas_->set_viewport_size(resized->size.x, resized->size.y);
+            resize_surface(resized->size.x, resized->size.y);
             if (maybe_page_) {
                 engine_.relayout(**maybe_page_, make_options());
                 on_layout_updated();
@@ -306,6 +331,7 @@ void App::step() {
                 }
                 case sf::Keyboard::Key::F1: {
                     render_debug_ = !render_debug_;
+                    damage_.invalidate_all();
                     spdlog::info("Render debug: {}", render_debug_);
                     break;
                 }
@@ -403,12 +429,19 @@ void App::step() {
         }
     }
 
-    if (process_iterations_ == 0) {
+    // Images are decoded in the background, and the page is laid out again
+    // when any of them are done.
+    if (maybe_page_ && engine_.poll_images(page(), make_options())) {
+        update_display_list();
+    }
+
+    // Nothing to do if neither the page nor the overlay has changed.
+    if (process_iterations_ == 0 && !damage_.has_damage()) {
         // The sleep duration was picked at random.
         std::this_thread::sleep_for(std::chrono::milliseconds{5});
         return;
     }
-    process_iterations_ -= 1;
+    process_iterations_ = std::max(process_iterations_ - 1, 0);
 
     run_overlay();
     run_nav_widget();
@@ -416,14 +449,25 @@ void App::step() {
         run_debug_widget();
     }
 
-    if (!maybe_page_ || (**maybe_page_).layout == std::nullopt) {
-        canvas_->clear(gfx::Color{255, 255, 255});
+    if (selected_canvas_ == Canvas::OpenGL) {
+        if (!maybe_page_ || (**maybe_page_).layout == std::nullopt) {
+            canvas_->clear(gfx::Color{255, 255, 255});
+        } else {
+            render_layout();
+        }
+        static_cast<gfx::OpenGLCanvas &>(*canvas_).flush();
+        last_paint_area_ = std::int64_t{window_.getSize().x} * window_.getSize().y;
+        std::ignore = damage_.take();
     } else {
-        render_layout();
+        update_surface();
+        window_.clear();
+        window_.draw(sf::Sprite{surface_.getTexture()});
     }
 
     render_overlay();
     show_render_surface();
+    last_frame_time_ =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - frame_start);
 }
 
 int App::run() {
@@ -452,6 +496,9 @@ void App::navigate() {
 
     spdlog::info("Navigating to '{}'", uri->uri);
     browse_history_.push(*uri);
+    // The display list points into the layout of the page we're leaving.
+    display_list_ = {};
+    damage_.invalidate_all();
     maybe_page_ = engine_.navigate(*std::move(uri), make_options());
 
     // Make sure the displayed url is still correct if we followed any redirects.
@@ -569,6 +616,13 @@ void App::on_page_loaded() {
 void App::on_layout_updated() {
     reset_scroll();
     nav_widget_extra_info_.clear();
+    update_display_list();
+}
+
+void App::update_display_list() {
+    display_list_ = page().layout ? render::build_display_list(*page().layout, image_lookup(page()))
+                                  : render::DisplayList{};
+    damage_.invalidate_all();
 }
 
 layout::LayoutBox const *App::get_hovered_node(geom::Position document_position) const {
@@ -576,12 +630,7 @@ layout::LayoutBox const *App::get_hovered_node(geom::Position document_position)
         return nullptr;
     }
 
-    auto const &maybe_layout = page().layout;
-    if (!maybe_layout.has_value()) {
-        return nullptr;
-    }
-
-    return layout::box_at_position(*maybe_layout, document_position);
+    return page().layout_index.box_at(document_position);
 }
 
 geom::Position App::to_document_position(geom::Position window_position) const {
@@ -591,6 +640,7 @@ geom::Position App::to_document_position(geom::Position window_position) const {
 
 void App::reset_scroll() {
     canvas_->add_translation(0, -scroll_offset_y_);
+    damage_.scroll(-scroll_offset_y_ * static_cast<int>(scale_));
     scroll_offset_y_ = 0;
 }
 
@@ -622,6 +672,7 @@ void App::scroll(int pixels) {
     }
 
     canvas_->add_translation(0, pixels);
+    damage_.scroll(pixels * static_cast<int>(scale_));
     scroll_offset_y_ += pixels;
 }
 
@@ -649,6 +700,13 @@ void App::run_nav_widget() {
 }
 
 void App::run_debug_widget() const {
+    ImGui::Text("Frame time: %.2f ms", static_cast<double>(last_frame_time_.count()) / 1000.);
+    ImGui::Text("Painted: %lld px", static_cast<long long>(last_paint_area_));
+    if (selected_canvas_ == Canvas::OpenGL) {
+        auto const stats = static_cast<gfx::OpenGLCanvas const &>(*canvas_).glyph_stats();
+        ImGui::Text("Glyph cache hit rate: %.1f%%", stats.hit_rate() * 100.);
+    }
+
     ImGui::TextUnformatted("Print");
     ImGui::BeginDisabled(!maybe_page_.has_value());
 
@@ -690,11 +748,103 @@ void App::run_debug_widget() const {
         std::cout << "\nLayout:\n" << to_string(*layout) << '\n';
     }
 
+    ImGui::TextUnformatted("Save");
+    if (ImGui::Button("Paint recording")) {
+        save_paint_recording();
+    }
+
     ImGui::EndDisabled();
 
     ImGui::EndDisabled();
 }
 
+// Records painting the entire page so that it can be replayed w/o loading it,
+// e.g. using //gfx:command_recording_bench.
+void App::save_paint_recording() const {
+    gfx::CanvasCommandSaver saver;
+    auto [width, height] = window_.getSize();
+    saver.set_viewport_size(static_cast<int>(width), static_cast<int>(height));
+    saver.set_scale(static_cast<int>(scale_));
+    render::replay(saver, display_list_);
+
+    static constexpr char const *kFilename = "paint_recording.hcr";
+    auto const recording = gfx::serialize_commands(saver.take_commands());
+    std::ofstream os{kFilename, std::ios::binary};
+    if (!os.write(reinterpret_cast<char const *>(recording.data()), static_cast<std::streamsize>(recording.size()))) {
+        spdlog::error("Unable to write {}", kFilename);
+        return;
+    }
+
+    spdlog::info("Saved a paint recording of {} bytes to {}", recording.size(), kFilename);
+}
+
+void App::resize_surface(unsigned width, unsigned height) {
+    if (!surface_.resize({width, height}) || !scroll_scratch_.resize({width, height})) {
+        spdlog::critical("Unable to create a {}x{} render surface", width, height);
+        std::abort();
+    }
+
+    window_.setView(sf::View{sf::FloatRect{{0, 0}, {static_cast<float>(width), static_cast<float>(height)}}});
+    canvas_->set_viewport_size(static_cast<int>(width), static_cast<int>(height));
+    damage_.resize({0, 0, static_cast<int>(width), static_cast<int>(height)});
+}
+
+void App::update_surface() {
+    auto repaint = damage_.take();
+    last_paint_area_ = 0;
+    if (repaint.empty()) {
+        return;
+    }
+
+    if (repaint.scroll_dy != 0) {
+        scroll_scratch_.update(surface_.getTexture());
+        sf::Sprite moved{scroll_scratch_};
+        moved.setPosition({0.f, static_cast<float>(repaint.scroll_dy)});
+        surface_.draw(moved, sf::BlendNone);
+    }
+
+    // The debug rendering isn't built for partial repaints.
+    if (render_debug_) {
+        auto [width, height] = surface_.getSize();
+        repaint.areas = {geom::Rect{0, 0, static_cast<int>(width), static_cast<int>(height)}};
+    }
+
+    for (auto const &area : repaint.areas) {
+        paint_area(area);
+        last_paint_area_ += std::int64_t{area.width} * area.height;
+    }
+
+    surface_.display();
+}
+
+void App::paint_area(geom::Rect const &surface_area) {
+    // Only touch the pixels in the damaged area.
+    auto const size = sf::Vector2f{surface_.getSize()};
+    auto view = surface_.getView();
+    view.setScissor({{static_cast<float>(surface_area.x) / size.x, static_cast<float>(surface_area.y) / size.y},
+            {static_cast<float>(surface_area.width) / size.x, static_cast<float>(surface_area.height) / size.y}});
+    surface_.setView(view);
+
+    // The canvas is translated by the scroll offset, so we paint in document coordinates.
+    auto const scale = static_cast<int>(scale_);
+    auto const left = surface_area.left() / scale;
+    auto const top = surface_area.top() / scale - scroll_offset_y_;
+    auto const right = (surface_area.right() + scale - 1) / scale;
+    auto const bottom = (surface_area.bottom() + scale - 1) / scale - scroll_offset_y_;
+    geom::Rect const document_area{left, top, right - left, bottom - top};
+
+    if (!maybe_page_ || (**maybe_page_).layout == std::nullopt) {
+        canvas_->fill_rect(document_area, gfx::Color{255, 255, 255});
+    } else if (render_debug_) {
+        render::debug::render_layout_depth(*canvas_, *page().layout);
+    } else {
+        render::repaint(*canvas_, display_list_, document_area);
+    }
+
+    view.setScissor({{0.f, 0.f}, {1.f, 1.f}});
+    surface_.setView(view);
+}
+
 void App::render_layout() {
     assert(maybe_page_);
 
@@ -711,7 +861,8 @@ void App::render_layout() {
                 std::optional{geom::Rect{0,
                         -scroll_offset_y_,
                         static_cast<int>(window_.getSize().x),
-                        static_cast<int>(window_.getSize().y)}});
+                        static_cast<int>(window_.getSize().y)}},
+                image_lookup(page()));
     }
 }
 
@@ -727,14 +878,15 @@ void App::switch_canvas() {
     reset_scroll();
     if (selected_canvas_ == Canvas::OpenGL) {
         selected_canvas_ = Canvas::Sfml;
-        canvas_ = std::make_unique<gfx::SfmlCanvas>(window_, static_cast<type::SfmlType &>(engine_.font_system()));
+        canvas_ = std::make_unique<gfx::SfmlCanvas>(surface_, static_cast<type::SfmlType &>(engine_.font_system()));
     } else {
         selected_canvas_ = Canvas::OpenGL;
-        canvas_ = std::make_unique<gfx::OpenGLCanvas>();
+        canvas_ = std::make_unique<gfx::OpenGLCanvas>(&glyphs_);
     }
     canvas_->set_scale(scale_);
     auto [width, height] = window_.getSize();
     canvas_->set_viewport_size(width, height);
+    damage_.invalidate_all();
 }
 
 engine::Options App::make_options() const {
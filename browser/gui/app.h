@@ -7,17 +7,23 @@
 
 #include "engine/engine.h"
 #include "geom/geom.h"
+#include "gfx/freetype_glyph_rasterizer.h"
 #include "gfx/icanvas.h"
 #include "layout/layout_box.h"
 #include "protocol/response.h"
+#include "render/damage_tracker.h"
+#include "render/display_list.h"
 #include "uri/uri.h"
 #include "util/history.h"
 
+#include <SFML/Graphics/RenderTexture.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
+#include <SFML/Graphics/Texture.hpp>
 #include <SFML/System/Clock.hpp>
 #include <SFML/Window/Cursor.hpp>
 #include <tl/expected.hpp>
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -51,9 +57,24 @@ private:
         Sfml,
     };
 
+    // The SFML canvas paints the page into a retained surface where only the
+    // damaged parts are repainted before it's presented along with the overlay.
+    // The OpenGL canvas paints directly to the window, repainting everything.
+    sf::RenderTexture surface_{};
+    // Textures can't be drawn onto themselves, so scrolling goes through this.
+    sf::Texture scroll_scratch_{};
+    render::DisplayList display_list_{};
+    render::DamageTracker damage_{};
+
     Canvas selected_canvas_{Canvas::Sfml};
+    // Used by the OpenGL canvas, which draws text using a glyph atlas.
+    gfx::FreeTypeGlyphRasterizer glyphs_;
     std::unique_ptr<gfx::ICanvas> canvas_;
 
+    // Shown in the debug widget.
+    std::chrono::microseconds last_frame_time_{};
+    std::int64_t last_paint_area_{};
+
     // The scroll offset is the opposite of the current translation of the web page.
     // When we scroll "down", the web page is translated "up".
     int scroll_offset_y_{};
@@ -74,6 +95,7 @@ private:
     void on_navigation_failure(protocol::ErrorCode);
     void on_page_loaded();
     void on_layout_updated();
+    void update_display_list();
 
     void navigate();
     void layout();
@@ -93,6 +115,11 @@ private:
     void run_nav_widget();
     void run_debug_widget() const;
 
+    void save_paint_recording() const;
+    void resize_surface(unsigned width, unsigned height);
+    void update_surface();
+    void paint_area(geom::Rect const &surface_area);
+
     void render_layout();
     void render_overlay();
     void show_render_surface();
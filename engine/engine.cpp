@@ -4,6 +4,10 @@
 
 #include "engine/engine.h"
 
+#include "engine/image.h"
+#include "engine/image_cache.h"
+#include "engine/worker_pool.h"
+
 #include "archive/zlib.h"
 #include "archive/zstd.h"
 #include "css/default.h"
@@ -13,7 +17,10 @@
 #include "dom/dom.h"
 #include "dom/xpath.h"
 #include "html/parser.h"
+#include "img/scale.h"
 #include "layout/layout.h"
+#include "layout/spatial_index.h"
+#include "protocol/iprotocol_handler.h"
 #include "protocol/response.h"
 #include "style/style.h"
 #include "uri/uri.h"
@@ -21,12 +28,20 @@
 #include <spdlog/spdlog.h>
 #include <tl/expected.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <cstddef>
+#include <cstdint>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -47,27 +62,27 @@ namespace {
 
     if (encoding == "gzip" || encoding == "x-gzip" || encoding == "deflate") {
         auto zlib_mode = encoding == "deflate" ? archive::ZlibMode::Zlib : archive::ZlibMode::Gzip;
-        auto decoded = archive::zlib_decode(body_view, zlib_mode);
-        if (!decoded) {
-            auto const &err = decoded.error();
+        std::string decoded;
+        if (auto res = archive::zlib_decode(body_view, zlib_mode, decoded); !res) {
+            auto const &err = res.error();
             spdlog::error("Failed {}-decoding of '{}': '{}: {}'", *encoding, uri.uri, err.code, err.message);
             return false;
         }
 
-        response.body.assign(reinterpret_cast<char const *>(decoded->data()), decoded->size());
+        response.body = std::move(decoded);
         return true;
     }
 
     if (encoding == "zstd") {
-        auto decoded = archive::zstd_decode(body_view);
-        if (!decoded) {
-            auto const &err = decoded.error();
+        std::string decoded;
+        if (auto res = archive::zstd_decode(body_view, decoded); !res) {
+            auto const &err = res.error();
             spdlog::error(
                     "Failed {}-decoding of '{}': '{}: {}'", *encoding, uri.uri, static_cast<int>(err), to_string(err));
             return false;
         }
 
-        response.body.assign(reinterpret_cast<char const *>(decoded->data()), decoded->size());
+        response.body = std::move(decoded);
         return true;
     }
 
@@ -75,6 +90,129 @@ namespace {
     return false;
 }
 
+Engine::LoadResult load_following_redirects(protocol::IProtocolHandler &protocol_handler, uri::Uri uri) {
+    static constexpr int kMaxRedirects = 10;
+
+    auto is_redirect = [](int status_code) {
+        return status_code == 301 || status_code == 302 || status_code == 307 || status_code == 308;
+    };
+
+    int redirect_count = 0;
+    auto response = protocol_handler.handle(uri);
+    while (response.has_value() && is_redirect(response->status_line.status_code)) {
+        ++redirect_count;
+        auto location = response->headers.get("Location");
+        if (!location) {
+            return {
+                    .response = tl::unexpected{protocol::Error{
+                            protocol::ErrorCode::InvalidResponse, std::move(response->status_line)}},
+                    .uri_after_redirects = std::move(uri),
+            };
+        }
+
+        spdlog::info("Following {} redirect from {} to {}", response->status_line.status_code, uri.uri, *location);
+        auto new_uri = uri::Uri::parse(std::string(*location), uri);
+        if (!new_uri) {
+            return {
+                    .response = tl::unexpected{protocol::Error{
+                            protocol::ErrorCode::InvalidResponse, std::move(response->status_line)}},
+                    .uri_after_redirects = std::move(uri),
+            };
+        }
+
+        uri = *std::move(new_uri);
+        response = protocol_handler.handle(uri);
+        if (redirect_count > kMaxRedirects) {
+            return {
+                    .response = tl::unexpected{protocol::Error{
+                            protocol::ErrorCode::RedirectLimit, std::move(response->status_line)}},
+                    .uri_after_redirects = std::move(uri),
+            };
+        }
+    }
+
+    return {std::move(response), std::move(uri)};
+}
+
+std::optional<DecodedImage> fetch_image(
+        protocol::IProtocolHandler &protocol_handler, uri::Uri uri, std::optional<img::ImageSize> max_size) {
+    spdlog::info("Downloading image from {}", uri.uri);
+    auto res = load_following_redirects(protocol_handler, std::move(uri));
+    auto &image_data = res.response;
+    auto const &image_url = res.uri_after_redirects;
+
+    if (!image_data.has_value()) {
+        spdlog::warn("Error {} downloading {}", static_cast<int>(image_data.error().err), image_url.uri);
+        return std::nullopt;
+    }
+
+    if ((image_url.scheme == "http" || image_url.scheme == "https") && image_data->status_line.status_code != 200) {
+        spdlog::warn("Error {}: {} downloading {}",
+                image_data->status_line.status_code,
+                image_data->status_line.reason,
+                image_url.uri);
+        return std::nullopt;
+    }
+
+    if (!try_decompress_response_body(image_url, *image_data)) {
+        return std::nullopt;
+    }
+
+    auto image = decode_image(std::as_bytes(std::span{image_data->body}), max_size);
+    if (!image) {
+        spdlog::warn("Unable to decode image from {}", image_url.uri);
+        return std::nullopt;
+    }
+
+    // 0 is for images that didn't come from here.
+    static std::atomic<std::uint64_t> next_image_id{1};
+    image->id = next_image_id.fetch_add(1, std::memory_order_relaxed);
+    return image;
+}
+
+// Images w/ both a width and a height attribute are decoded at no more than
+// that size, as there's no point in keeping more pixels than will be shown.
+std::optional<img::ImageSize> max_image_size(dom::Element const &img) {
+    auto parse = [&](std::string const &attribute) -> std::optional<std::uint32_t> {
+        auto it = img.attributes.find(attribute);
+        if (it == img.attributes.end()) {
+            return std::nullopt;
+        }
+
+        auto const &value = it->second;
+        std::uint32_t result{};
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+        if (ec != std::errc{} || ptr != value.data() + value.size() || result == 0) {
+            return std::nullopt;
+        }
+
+        return result;
+    };
+
+    auto width = parse("width");
+    auto height = parse("height");
+    if (!width || !height) {
+        return std::nullopt;
+    }
+
+    return img::ImageSize{*width, *height};
+}
+
+layout::LayoutOptions to_layout_options(PageState const &state) {
+    return {
+            .intrinsic_size = [&images = state.images](dom::Element const &element)
+                    -> std::optional<layout::IntrinsicSize> {
+                auto it = images.find(&element);
+                if (it == images.end()) {
+                    return std::nullopt;
+                }
+
+                auto const &image = *it->second;
+                return layout::IntrinsicSize{static_cast<int>(image.width), static_cast<int>(image.height)};
+            },
+    };
+}
+
 css::MediaQuery::Context to_media_context(Options opts) {
     return {
             .window_width = opts.layout_width,
@@ -172,62 +310,105 @@ tl::expected<std::unique_ptr<PageState>, NavigationError> Engine::navigate(uri::
         state->stylesheet.splice(future_rules.get());
     }
 
+    // Cached images are filled in right away, and the rest are started after
+    // the page has been laid out so that they don't delay the text showing up.
+    auto imgs = dom::nodes_by_xpath(state->dom.html(), "//img"sv);
+    std::erase_if(imgs, [](auto const *img) { return !img->attributes.contains("src"); });
+    for (auto const *img : imgs) {
+        auto const &src = img->attributes.at("src");
+        auto image_url = uri::Uri::parse(src, state->uri);
+        if (!image_url) {
+            spdlog::warn("Failed to parse src '{}', skipping image", src);
+            continue;
+        }
+
+        ImageCacheKey key{.url = *std::move(image_url), .max_size = max_image_size(*img)};
+        if (auto image = image_cache_.get(key)) {
+            state->images.emplace(img, std::move(image));
+            continue;
+        }
+
+        state->pending_images->waiting[std::move(key)].push_back(img);
+    }
+
     spdlog::info("Styling dom w/ {} rules", state->stylesheet.rules.size());
-    state->layout_width = opts.layout_width;
-    state->styled = style::style_tree(state->dom.html_node, state->stylesheet, to_media_context(opts));
-    state->layout = layout::create_layout(*state->styled, state->layout_width, *type_);
+    relayout(*state, opts);
 
+    load_images(*state);
     return state;
 }
 
 void Engine::relayout(PageState &state, Options opts) {
     state.layout_width = opts.layout_width;
     state.styled = style::style_tree(state.dom.html_node, state.stylesheet, to_media_context(opts));
-    state.layout = layout::create_layout(*state.styled, state.layout_width, *type_);
+    state.layout = layout::create_layout(*state.styled, state.layout_width, *type_, to_layout_options(state));
+    state.layout_index = state.layout ? layout::SpatialIndex{*state.layout} : layout::SpatialIndex{};
 }
 
-Engine::LoadResult Engine::load(uri::Uri uri) {
-    static constexpr int kMaxRedirects = 10;
-
-    auto is_redirect = [](int status_code) {
-        return status_code == 301 || status_code == 302 || status_code == 307 || status_code == 308;
-    };
+bool Engine::poll_images(PageState &state, Options opts) {
+    auto &pending = *state.pending_images;
+    decltype(pending.done) done;
+    {
+        std::scoped_lock lock{pending.mutex};
+        done.swap(pending.done);
+    }
 
-    int redirect_count = 0;
-    auto response = protocol_handler_->handle(uri);
-    while (response.has_value() && is_redirect(response->status_line.status_code)) {
-        ++redirect_count;
-        auto location = response->headers.get("Location");
-        if (!location) {
-            return {
-                    .response = tl::unexpected{protocol::Error{
-                            protocol::ErrorCode::InvalidResponse, std::move(response->status_line)}},
-                    .uri_after_redirects = std::move(uri),
-            };
+    bool changed = false;
+    for (auto &[key, image] : done) {
+        auto waiting = pending.waiting.extract(key);
+        if (!image || waiting.empty()) {
+            continue;
         }
 
-        spdlog::info("Following {} redirect from {} to {}", response->status_line.status_code, uri.uri, *location);
-        auto new_uri = uri::Uri::parse(std::string(*location), uri);
-        if (!new_uri) {
-            return {
-                    .response = tl::unexpected{protocol::Error{
-                            protocol::ErrorCode::InvalidResponse, std::move(response->status_line)}},
-                    .uri_after_redirects = std::move(uri),
-            };
+        for (auto const *img : waiting.mapped()) {
+            state.images.insert_or_assign(img, image);
         }
 
-        uri = *std::move(new_uri);
-        response = protocol_handler_->handle(uri);
-        if (redirect_count > kMaxRedirects) {
-            return {
-                    .response = tl::unexpected{protocol::Error{
-                            protocol::ErrorCode::RedirectLimit, std::move(response->status_line)}},
-                    .uri_after_redirects = std::move(uri),
-            };
-        }
+        image_cache_.put(std::move(key), std::move(image));
+        changed = true;
     }
 
-    return {std::move(response), std::move(uri)};
+    if (changed) {
+        relayout(state, opts);
+    }
+
+    return changed;
+}
+
+void Engine::load_images(PageState &state) {
+    if (state.pending_images->waiting.empty()) {
+        return;
+    }
+
+    if (!image_decoders_) {
+        image_decoders_ = std::make_unique<WorkerPool>(std::clamp(std::thread::hardware_concurrency(), 1u, 4u));
+    }
+
+    spdlog::info("Loading {} images", state.pending_images->waiting.size());
+    for (auto const &waiting : state.pending_images->waiting) {
+        image_decoders_->post([protocol_handler = protocol_handler_,
+                                      pending = std::weak_ptr{state.pending_images},
+                                      key = waiting.first]() mutable {
+            // Skip images for pages that have been navigated away from.
+            if (pending.expired()) {
+                return;
+            }
+
+            auto image = fetch_image(*protocol_handler, key.url, key.max_size);
+            auto pending_images = pending.lock();
+            if (!pending_images) {
+                return;
+            }
+
+            std::scoped_lock lock{pending_images->mutex};
+            pending_images->done.emplace_back(std::move(key),
+                    image ? std::make_shared<DecodedImage const>(*std::move(image)) : nullptr);
+        });
+    }
+}
+
+Engine::LoadResult Engine::load(uri::Uri uri) {
+    return load_following_redirects(*protocol_handler_, std::move(uri));
 }
 
 } // namespace engine
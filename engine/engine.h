@@ -6,9 +6,14 @@
 #ifndef ENGINE_ENGINE_H_
 #define ENGINE_ENGINE_H_
 
+#include "engine/image.h"
+#include "engine/image_cache.h"
+#include "engine/worker_pool.h"
+
 #include "css/style_sheet.h"
 #include "dom/dom.h"
 #include "layout/layout_box.h"
+#include "layout/spatial_index.h"
 #include "protocol/iprotocol_handler.h"
 #include "protocol/response.h"
 #include "style/styled_node.h"
@@ -18,9 +23,13 @@
 
 #include <tl/expected.hpp>
 
+#include <cstddef>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace engine {
 
@@ -30,6 +39,16 @@ struct Options {
     bool dark_mode{false};
 };
 
+// Images being fetched and decoded for a page.
+struct PendingImages {
+    // The elements waiting for each image. Only used by the Engine's thread.
+    std::unordered_map<ImageCacheKey, std::vector<dom::Element const *>, ImageCacheKeyHash> waiting{};
+
+    // Written to by the decoding threads. Images that failed to load are null.
+    std::mutex mutex{};
+    std::vector<std::pair<ImageCacheKey, std::shared_ptr<DecodedImage const>>> done{};
+};
+
 struct PageState {
     uri::Uri uri{};
     protocol::Response response{};
@@ -37,7 +56,13 @@ struct PageState {
     css::StyleSheet stylesheet{};
     std::unique_ptr<style::StyledNode> styled{};
     std::optional<layout::LayoutBox> layout{};
+    // Rebuilt together with the layout, as it points into it.
+    layout::SpatialIndex layout_index{};
     int layout_width{};
+    // The images shown by <img> elements, laid out at their intrinsic sizes.
+    // Images still loading are laid out as their alt text.
+    std::unordered_map<dom::Element const *, std::shared_ptr<DecodedImage const>> images{};
+    std::shared_ptr<PendingImages> pending_images{std::make_shared<PendingImages>()};
 };
 
 struct NavigationError {
@@ -47,14 +72,23 @@ struct NavigationError {
 
 class Engine {
 public:
+    // Decoded images are kept around within this many bytes of pixels.
+    static constexpr std::size_t kImageCacheBudget = std::size_t{256} * 1024 * 1024;
+
     explicit Engine(std::unique_ptr<protocol::IProtocolHandler> protocol_handler,
             std::unique_ptr<type::IType> type = std::make_unique<type::NaiveType>())
         : protocol_handler_{std::move(protocol_handler)}, type_{std::move(type)} {}
 
+    // Images not already in the cache are loaded in the background after the
+    // page has been laid out, see poll_images.
     [[nodiscard]] tl::expected<std::unique_ptr<PageState>, NavigationError> navigate(uri::Uri, Options = {});
 
     void relayout(PageState &, Options);
 
+    // Adds the images that finished loading since the last call to the page,
+    // and lays it out again if there were any. Returns true if it did.
+    bool poll_images(PageState &, Options);
+
     struct [[nodiscard]] LoadResult {
         tl::expected<protocol::Response, protocol::Error> response;
         uri::Uri uri_after_redirects;
@@ -63,9 +97,17 @@ public:
 
     type::IType &font_system() { return *type_; }
 
+    ImageCache const &image_cache() const { return image_cache_; }
+
 private:
-    std::unique_ptr<protocol::IProtocolHandler> protocol_handler_{};
+    void load_images(PageState &);
+
+    // Shared w/ the image loading jobs, as they can't refer to the Engine, which may be moved.
+    std::shared_ptr<protocol::IProtocolHandler> protocol_handler_{};
     std::unique_ptr<type::IType> type_{};
+    ImageCache image_cache_{kImageCacheBudget};
+    // Started when the first image is loaded.
+    std::unique_ptr<WorkerPool> image_decoders_{};
 };
 
 } // namespace engine
@@ -10,6 +10,8 @@
 #include "dom/xpath.h"
 #include "etest/etest.h"
 #include "gfx/color.h"
+#include "img/qoi.h"
+#include "layout/layout_box.h"
 #include "protocol/iprotocol_handler.h"
 #include "protocol/response.h"
 #include "style/styled_node.h"
@@ -20,17 +22,22 @@
 #include <tl/expected.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <map>
 #include <memory>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
+#include <variant>
 #include <vector>
 
 using namespace std::literals;
 using etest::expect;
 using etest::expect_eq;
 using etest::require;
+using etest::require_eq;
 using protocol::ErrorCode;
 using protocol::Response;
 
@@ -53,6 +60,35 @@ bool contains(std::vector<css::Rule> const &stylesheet, css::Rule const &rule) {
     return std::ranges::find(stylesheet, rule) != end(stylesheet);
 }
 
+// NOLINTNEXTLINE(misc-no-recursion)
+layout::LayoutBox const *find_box(layout::LayoutBox const &box, dom::Element const &element) {
+    if (box.node != nullptr && std::get_if<dom::Element>(&box.node->node) == &element) {
+        return &box;
+    }
+
+    for (auto const &child : box.children) {
+        if (auto const *found = find_box(child, element)) {
+            return found;
+        }
+    }
+
+    return nullptr;
+}
+
+// Images are decoded in the background, so this waits a while for them.
+bool wait_for_images(engine::Engine &e, engine::PageState &page) {
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!e.poll_images(page, {})) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return true;
+}
+
 } // namespace
 
 int main() {
@@ -514,5 +550,70 @@ int main() {
         expect(page.has_value());
     });
 
+    etest::test("<img> is loaded in the background", [] {
+        std::vector<unsigned char> const pixels(std::size_t{20} * 30 * 4, 0xAB);
+        auto const qoi = img::Qoi::encode(20, 30, pixels);
+
+        Responses responses;
+        responses["hax://example.com"s] = Response{
+                .status_line = {.status_code = 200},
+                .body{"<html><body><img src=a.qoi alt=hello></body></html>"},
+        };
+        responses["hax://example.com/a.qoi"s] = Response{
+                .status_line = {.status_code = 200},
+                .body{reinterpret_cast<char const *>(qoi.data()), qoi.size()},
+        };
+        engine::Engine e{std::make_unique<FakeProtocolHandler>(std::move(responses))};
+
+        auto page = e.navigate(uri::Uri::parse("hax://example.com").value()).value();
+        auto const &img = *dom::nodes_by_xpath(page->dom.html(), "//img").at(0);
+        auto const *box = find_box(*page->layout, img);
+        require(box != nullptr);
+        expect(box->text() == "hello"sv);
+        expect(page->images.empty());
+
+        require(wait_for_images(e, *page));
+        require_eq(page->images.size(), std::size_t{1});
+        auto const &image = *page->images.at(&img);
+        expect_eq(image.width, 20u);
+        expect_eq(image.height, 30u);
+        expect_eq(image.rgba, pixels);
+
+        box = find_box(*page->layout, img);
+        require(box != nullptr);
+        expect_eq(box->dimensions.content.width, 20);
+        expect_eq(box->dimensions.content.height, 30);
+        expect_eq(e.image_cache().size(), std::size_t{1});
+
+        // The second time around, the image is in the cache.
+        auto again = e.navigate(uri::Uri::parse("hax://example.com").value()).value();
+        auto const &cached = *dom::nodes_by_xpath(again->dom.html(), "//img").at(0);
+        expect_eq(again->images.at(&cached).get(), &image);
+        expect(again->pending_images->waiting.empty());
+        expect_eq(find_box(*again->layout, cached)->dimensions.content.width, 20);
+    });
+
+    etest::test("<img> that fails to load", [] {
+        Responses responses;
+        responses["hax://example.com"s] = Response{
+                .status_line = {.status_code = 200},
+                .body{"<html><body><img src=a.png alt=hello><img src=b.png></body></html>"},
+        };
+        responses["hax://example.com/a.png"s] = Response{.status_line = {.status_code = 200}, .body{"not a png"}};
+        responses["hax://example.com/b.png"s] = tl::unexpected{protocol::Error{ErrorCode::Unresolved}};
+        engine::Engine e{std::make_unique<FakeProtocolHandler>(std::move(responses))};
+
+        auto page = e.navigate(uri::Uri::parse("hax://example.com").value()).value();
+        auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!page->pending_images->waiting.empty() && std::chrono::steady_clock::now() < deadline) {
+            expect(!e.poll_images(*page, {}));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        expect(page->pending_images->waiting.empty());
+        expect(page->images.empty());
+        expect_eq(e.image_cache().size(), std::size_t{0});
+    });
+
     return etest::run_all_tests();
 }
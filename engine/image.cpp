@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "engine/image.h"
+
+#include "img/gif.h"
+#include "img/jpeg.h"
+#include "img/png.h"
+#include "img/qoi.h"
+#include "img/scale.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+using namespace std::literals;
+
+namespace engine {
+namespace {
+
+bool starts_with(std::span<std::byte const> data, std::string_view magic) {
+    return data.size() >= magic.size()
+            && std::ranges::equal(data.first(magic.size()), magic, {}, {}, [](char c) { return std::byte(c); });
+}
+
+std::istringstream to_stream(std::span<std::byte const> data) {
+    return std::istringstream{std::string{reinterpret_cast<char const *>(data.data()), data.size()}};
+}
+
+template<typename ImageT>
+DecodedImage to_decoded(ImageT image) {
+    return DecodedImage{.width = image.width, .height = image.height, .rgba = std::move(image.bytes)};
+}
+
+std::optional<DecodedImage> decode_gif(std::span<std::byte const> data, std::optional<img::ImageSize> max_size) {
+    auto gif = img::Gif::from(to_stream(data));
+    if (!gif || gif->frames.empty()) {
+        return std::nullopt;
+    }
+
+    // The first frame always covers the whole canvas.
+    auto &frame = gif->frames.front();
+    img::ImageSize const size{gif->width, gif->height};
+    if (!max_size || img::fit_within(size, *max_size) == size) {
+        return DecodedImage{.width = size.width, .height = size.height, .rgba = std::move(frame.bytes)};
+    }
+
+    img::Downscaler downscaler{size, img::fit_within(size, *max_size)};
+    auto const row_size = std::size_t{size.width} * 4;
+    for (std::uint32_t y = 0; y < size.height; ++y) {
+        downscaler.add_row(std::span{frame.bytes}.subspan(y * row_size, row_size));
+    }
+
+    auto const scaled = downscaler.size();
+    return DecodedImage{.width = scaled.width, .height = scaled.height, .rgba = downscaler.take()};
+}
+
+} // namespace
+
+std::optional<ImageFormat> sniff_image_format(std::span<std::byte const> data) {
+    // https://mimesniff.spec.whatwg.org/#matching-an-image-type-pattern
+    if (starts_with(data, "\x89PNG\r\n\x1A\n"sv)) {
+        return ImageFormat::Png;
+    }
+
+    if (starts_with(data, "\xFF\xD8\xFF"sv)) {
+        return ImageFormat::Jpeg;
+    }
+
+    if (starts_with(data, "GIF87a"sv) || starts_with(data, "GIF89a"sv)) {
+        return ImageFormat::Gif;
+    }
+
+    // https://qoiformat.org/qoi-specification.pdf
+    if (starts_with(data, "qoif"sv)) {
+        return ImageFormat::Qoi;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<DecodedImage> decode_image(std::span<std::byte const> data, std::optional<img::ImageSize> max_size) {
+    auto format = sniff_image_format(data);
+    if (!format) {
+        return std::nullopt;
+    }
+
+    switch (*format) {
+        case ImageFormat::Png: {
+            auto png = max_size ? img::Png::from(to_stream(data), *max_size) : img::Png::from(to_stream(data));
+            return png ? std::optional{to_decoded(*std::move(png))} : std::nullopt;
+        }
+        case ImageFormat::Jpeg: {
+            auto jpeg = max_size ? img::Jpeg::from(data, *max_size) : img::Jpeg::from(data);
+            return jpeg ? std::optional{to_decoded(*std::move(jpeg))} : std::nullopt;
+        }
+        case ImageFormat::Gif:
+            return decode_gif(data, max_size);
+        case ImageFormat::Qoi: {
+            auto qoi = max_size ? img::Qoi::from(data, *max_size) : img::Qoi::from(data);
+            return qoi ? std::optional{to_decoded(*std::move(qoi))} : std::nullopt;
+        }
+    }
+
+    return std::nullopt;
+}
+
+} // namespace engine
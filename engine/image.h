@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef ENGINE_IMAGE_H_
+#define ENGINE_IMAGE_H_
+
+#include "img/scale.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace engine {
+
+enum class ImageFormat : std::uint8_t {
+    Png,
+    Jpeg,
+    Gif,
+    Qoi,
+};
+
+// Picks the decoder based on the magic bytes at the start of the data, as
+// servers can't be trusted to send the right Content-Type.
+std::optional<ImageFormat> sniff_image_format(std::span<std::byte const>);
+
+struct DecodedImage {
+    std::uint32_t width{};
+    std::uint32_t height{};
+    std::vector<unsigned char> rgba{};
+    // Unique for every image loaded by an Engine, and 0 otherwise.
+    std::uint64_t id{};
+
+    [[nodiscard]] bool operator==(DecodedImage const &) const = default;
+};
+
+// Decodes the image, scaled down to fit in max_size if there is one. Only the
+// first frame of animated GIFs is decoded.
+std::optional<DecodedImage> decode_image(
+        std::span<std::byte const>, std::optional<img::ImageSize> max_size = std::nullopt);
+
+} // namespace engine
+
+#endif
@@ -0,0 +1,64 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "engine/image_cache.h"
+
+#include "engine/image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace engine {
+
+std::size_t ImageCacheKeyHash::operator()(ImageCacheKey const &key) const {
+    auto hash = std::hash<std::string>{}(key.url.uri);
+    if (key.max_size) {
+        auto const size = (std::uint64_t{key.max_size->width} << 32) | key.max_size->height;
+        hash ^= std::hash<std::uint64_t>{}(size) + 0x9e37'79b9 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+std::shared_ptr<DecodedImage const> ImageCache::get(ImageCacheKey const &key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return nullptr;
+    }
+
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->second;
+}
+
+void ImageCache::put(ImageCacheKey key, std::shared_ptr<DecodedImage const> image) {
+    if (auto it = index_.find(key); it != index_.end()) {
+        memory_usage_ -= it->second->second->rgba.size();
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+
+    auto const bytes = image->rgba.size();
+    if (bytes > budget_bytes_) {
+        return;
+    }
+
+    evict_until_within(budget_bytes_ - bytes);
+    entries_.emplace_front(std::move(key), std::move(image));
+    index_.emplace(entries_.front().first, entries_.begin());
+    memory_usage_ += bytes;
+}
+
+void ImageCache::evict_until_within(std::size_t budget_bytes) {
+    while (memory_usage_ > budget_bytes) {
+        auto const &[key, image] = entries_.back();
+        memory_usage_ -= image->rgba.size();
+        index_.erase(key);
+        entries_.pop_back();
+    }
+}
+
+} // namespace engine
@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef ENGINE_IMAGE_CACHE_H_
+#define ENGINE_IMAGE_CACHE_H_
+
+#include "engine/image.h"
+
+#include "img/scale.h"
+#include "uri/uri.h"
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace engine {
+
+// The same image may be decoded at several sizes.
+struct ImageCacheKey {
+    uri::Uri url{};
+    std::optional<img::ImageSize> max_size{};
+
+    [[nodiscard]] bool operator==(ImageCacheKey const &) const = default;
+};
+
+struct ImageCacheKeyHash {
+    std::size_t operator()(ImageCacheKey const &) const;
+};
+
+// Decoded images, keeping the most recently used ones within a budget of
+// pixel bytes. Images are shared w/ the pages showing them, so evicting one
+// only frees its memory once no page uses it anymore.
+class ImageCache {
+public:
+    explicit ImageCache(std::size_t budget_bytes) : budget_bytes_{budget_bytes} {}
+
+    // Marks the image as the most recently used one.
+    [[nodiscard]] std::shared_ptr<DecodedImage const> get(ImageCacheKey const &);
+
+    // Images larger than the whole budget aren't kept.
+    void put(ImageCacheKey, std::shared_ptr<DecodedImage const>);
+
+    [[nodiscard]] std::size_t memory_usage() const { return memory_usage_; }
+    [[nodiscard]] std::size_t size() const { return entries_.size(); }
+
+private:
+    using Entry = std::pair<ImageCacheKey, std::shared_ptr<DecodedImage const>>;
+
+    void evict_until_within(std::size_t budget_bytes);
+
+    std::size_t budget_bytes_{};
+    std::size_t memory_usage_{};
+    // Most recently used first.
+    std::list<Entry> entries_;
+    std::unordered_map<ImageCacheKey, std::list<Entry>::iterator, ImageCacheKeyHash> index_;
+};
+
+} // namespace engine
+
+#endif
@@ -0,0 +1,102 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "engine/image_cache.h"
+
+#include "engine/image.h"
+
+#include "etest/etest2.h"
+#include "img/scale.h"
+#include "uri/uri.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+using engine::DecodedImage;
+using engine::ImageCache;
+using engine::ImageCacheKey;
+
+namespace {
+
+ImageCacheKey key(std::string url, std::optional<img::ImageSize> max_size = std::nullopt) {
+    return ImageCacheKey{.url = uri::Uri::parse(std::move(url)).value(), .max_size = max_size};
+}
+
+std::shared_ptr<DecodedImage const> image(std::size_t bytes) {
+    return std::make_shared<DecodedImage const>(DecodedImage{.rgba = std::vector<unsigned char>(bytes)});
+}
+
+} // namespace
+
+int main() {
+    etest::Suite s;
+
+    s.add_test("get and put", [](etest::IActions &a) {
+        ImageCache cache{100};
+        a.expect_eq(cache.get(key("https://example.com/a.png")), nullptr);
+
+        auto a_png = image(10);
+        cache.put(key("https://example.com/a.png"), a_png);
+        a.expect_eq(cache.get(key("https://example.com/a.png")), a_png);
+        a.expect_eq(cache.get(key("https://example.com/b.png")), nullptr);
+        a.expect_eq(cache.memory_usage(), std::size_t{10});
+    });
+
+    s.add_test("sizes are cached separately", [](etest::IActions &a) {
+        ImageCache cache{100};
+        auto full = image(40);
+        auto thumbnail = image(4);
+        cache.put(key("https://example.com/a.png"), full);
+        cache.put(key("https://example.com/a.png", img::ImageSize{1, 1}), thumbnail);
+
+        a.expect_eq(cache.get(key("https://example.com/a.png")), full);
+        a.expect_eq(cache.get(key("https://example.com/a.png", img::ImageSize{1, 1})), thumbnail);
+        a.expect_eq(cache.get(key("https://example.com/a.png", img::ImageSize{2, 2})), nullptr);
+        a.expect_eq(cache.memory_usage(), std::size_t{44});
+    });
+
+    s.add_test("replacing an image", [](etest::IActions &a) {
+        ImageCache cache{100};
+        cache.put(key("https://example.com/a.png"), image(40));
+        auto replacement = image(20);
+        cache.put(key("https://example.com/a.png"), replacement);
+
+        a.expect_eq(cache.get(key("https://example.com/a.png")), replacement);
+        a.expect_eq(cache.size(), std::size_t{1});
+        a.expect_eq(cache.memory_usage(), std::size_t{20});
+    });
+
+    s.add_test("the least recently used images are evicted", [](etest::IActions &a) {
+        ImageCache cache{100};
+        cache.put(key("https://example.com/a.png"), image(40));
+        cache.put(key("https://example.com/b.png"), image(40));
+        // Now b is the least recently used one.
+        a.expect(cache.get(key("https://example.com/a.png")) != nullptr);
+
+        cache.put(key("https://example.com/c.png"), image(40));
+        a.expect(cache.get(key("https://example.com/a.png")) != nullptr);
+        a.expect_eq(cache.get(key("https://example.com/b.png")), nullptr);
+        a.expect(cache.get(key("https://example.com/c.png")) != nullptr);
+        a.expect_eq(cache.memory_usage(), std::size_t{80});
+
+        // Several can be evicted to make room for a larger one.
+        cache.put(key("https://example.com/d.png"), image(100));
+        a.expect_eq(cache.size(), std::size_t{1});
+        a.expect_eq(cache.memory_usage(), std::size_t{100});
+    });
+
+    s.add_test("images larger than the budget aren't kept", [](etest::IActions &a) {
+        ImageCache cache{100};
+        cache.put(key("https://example.com/a.png"), image(10));
+        cache.put(key("https://example.com/b.png"), image(101));
+
+        a.expect_eq(cache.get(key("https://example.com/b.png")), nullptr);
+        a.expect(cache.get(key("https://example.com/a.png")) != nullptr);
+        a.expect_eq(cache.memory_usage(), std::size_t{10});
+    });
+
+    return s.run();
+}
@@ -0,0 +1,93 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "engine/image.h"
+
+#include "etest/etest2.h"
+#include "img/png.h"
+#include "img/qoi.h"
+#include "img/scale.h"
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+using engine::DecodedImage;
+using engine::ImageFormat;
+
+namespace {
+
+std::span<std::byte const> as_bytes(std::string_view s) {
+    return std::as_bytes(std::span{s});
+}
+
+// 2x2, w/ a different color in each corner.
+std::vector<unsigned char> const kPixels{
+        0x10, 0x20, 0x30, 0xFF, 0x40, 0x50, 0x60, 0xFF, //
+        0x70, 0x80, 0x90, 0xFF, 0xA0, 0xB0, 0xC0, 0xFF, //
+};
+
+// 1x1, red.
+auto const kGif = "GIF89a\1\0\1\0\x80\0\0\xFF\0\0\0\0\0,\0\0\0\0\1\0\1\0\0\2\2\x44\1\0;"s;
+
+} // namespace
+
+int main() {
+    etest::Suite s;
+
+    s.add_test("sniff_image_format", [](etest::IActions &a) {
+        a.expect_eq(engine::sniff_image_format(as_bytes("\x89PNG\r\n\x1A\n..."sv)), ImageFormat::Png);
+        a.expect_eq(engine::sniff_image_format(as_bytes("\xFF\xD8\xFF\xE0"sv)), ImageFormat::Jpeg);
+        a.expect_eq(engine::sniff_image_format(as_bytes("GIF87a"sv)), ImageFormat::Gif);
+        a.expect_eq(engine::sniff_image_format(as_bytes("GIF89a"sv)), ImageFormat::Gif);
+        a.expect_eq(engine::sniff_image_format(as_bytes("qoif"sv)), ImageFormat::Qoi);
+
+        a.expect_eq(engine::sniff_image_format(as_bytes(""sv)), std::nullopt);
+        a.expect_eq(engine::sniff_image_format(as_bytes("\x89PNG"sv)), std::nullopt);
+        a.expect_eq(engine::sniff_image_format(as_bytes("GIF88a"sv)), std::nullopt);
+        a.expect_eq(engine::sniff_image_format(as_bytes("<html>"sv)), std::nullopt);
+    });
+
+    s.add_test("decode_image, png", [](etest::IActions &a) {
+        std::ostringstream ss;
+        a.require(img::Png::write(ss, 2, 2, kPixels));
+        auto const png = std::move(ss).str();
+
+        a.expect_eq(engine::decode_image(as_bytes(png)), DecodedImage{2, 2, kPixels});
+        auto scaled = engine::decode_image(as_bytes(png), img::ImageSize{1, 1});
+        a.require(scaled.has_value());
+        a.expect_eq(scaled->width, 1u);
+        a.expect_eq(scaled->height, 1u);
+    });
+
+    s.add_test("decode_image, qoi", [](etest::IActions &a) {
+        auto const qoi = img::Qoi::encode(2, 2, kPixels);
+
+        a.expect_eq(engine::decode_image(qoi), DecodedImage{2, 2, kPixels});
+        a.expect_eq(engine::decode_image(qoi, img::ImageSize{1, 1}),
+                DecodedImage{1, 1, {0x58, 0x68, 0x78, 0xFF}});
+    });
+
+    s.add_test("decode_image, gif", [](etest::IActions &a) {
+        a.expect_eq(engine::decode_image(as_bytes(kGif)), DecodedImage{1, 1, {0xFF, 0, 0, 0xFF}});
+        a.expect_eq(engine::decode_image(as_bytes(kGif), img::ImageSize{10, 10}),
+                DecodedImage{1, 1, {0xFF, 0, 0, 0xFF}});
+    });
+
+    s.add_test("decode_image, broken", [](etest::IActions &a) {
+        a.expect_eq(engine::decode_image(as_bytes("hello"sv)), std::nullopt);
+        a.expect_eq(engine::decode_image(as_bytes("\x89PNG\r\n\x1A\n"sv)), std::nullopt);
+        a.expect_eq(engine::decode_image(as_bytes("\xFF\xD8\xFF"sv)), std::nullopt);
+        a.expect_eq(engine::decode_image(as_bytes("GIF89a"sv)), std::nullopt);
+        a.expect_eq(engine::decode_image(as_bytes("qoif"sv)), std::nullopt);
+    });
+
+    return s.run();
+}
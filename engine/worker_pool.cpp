@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "engine/worker_pool.h"
+
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <utility>
+
+namespace engine {
+
+WorkerPool::WorkerPool(unsigned threads) {
+    workers_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.emplace_back([this](std::stop_token const &stop) { run(stop); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    // Stop all of them before joining any, so that no thread picks up more
+    // jobs while waiting for the others.
+    for (auto &worker : workers_) {
+        worker.request_stop();
+    }
+}
+
+void WorkerPool::post(std::function<void()> job) {
+    {
+        std::scoped_lock lock{mutex_};
+        jobs_.push_back(std::move(job));
+    }
+
+    job_posted_.notify_one();
+}
+
+void WorkerPool::run(std::stop_token const &stop) {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock{mutex_};
+            if (!job_posted_.wait(lock, stop, [this] { return !jobs_.empty(); }) || stop.stop_requested()) {
+                return;
+            }
+
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        job();
+    }
+}
+
+} // namespace engine
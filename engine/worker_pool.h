@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef ENGINE_WORKER_POOL_H_
+#define ENGINE_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace engine {
+
+// Runs jobs in the order they were posted on a fixed number of threads. Jobs
+// that haven't started when the pool is destroyed are dropped, and the ones
+// that have are waited for.
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned threads);
+    ~WorkerPool();
+
+    WorkerPool(WorkerPool const &) = delete;
+    WorkerPool &operator=(WorkerPool const &) = delete;
+    WorkerPool(WorkerPool &&) = delete;
+    WorkerPool &operator=(WorkerPool &&) = delete;
+
+    void post(std::function<void()>);
+
+private:
+    void run(std::stop_token const &);
+
+    std::mutex mutex_;
+    std::condition_variable_any job_posted_;
+    std::deque<std::function<void()>> jobs_;
+    // Last, so that the threads are stopped before anything they use goes away.
+    std::vector<std::jthread> workers_;
+};
+
+} // namespace engine
+
+#endif
@@ -0,0 +1,48 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "engine/worker_pool.h"
+
+#include "etest/etest2.h"
+
+#include <atomic>
+#include <future>
+#include <vector>
+
+int main() {
+    etest::Suite s;
+
+    s.add_test("jobs are run", [](etest::IActions &a) {
+        engine::WorkerPool pool{2};
+        std::atomic<int> count{0};
+        std::promise<void> done;
+        for (int i = 0; i < 10; ++i) {
+            pool.post([&] {
+                if (++count == 10) {
+                    done.set_value();
+                }
+            });
+        }
+
+        done.get_future().wait();
+        a.expect_eq(count.load(), 10);
+    });
+
+    s.add_test("jobs are run in order", [](etest::IActions &a) {
+        std::vector<int> order;
+        std::promise<void> done;
+        {
+            engine::WorkerPool pool{1};
+            for (int i = 0; i < 5; ++i) {
+                pool.post([&order, i] { order.push_back(i); });
+            }
+            pool.post([&] { done.set_value(); });
+            done.get_future().wait();
+        }
+
+        a.expect_eq(order, std::vector{0, 1, 2, 3, 4});
+    });
+
+    return s.run();
+}
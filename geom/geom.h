@@ -76,6 +76,26 @@ struct Rect {
         };
     }
 
+    // The smallest rect containing both rects. Empty rects don't contribute.
+    [[nodiscard]] constexpr Rect united(Rect const &other) const {
+        if (other.empty()) {
+            return *this;
+        }
+
+        if (empty()) {
+            return other;
+        }
+
+        auto new_left = std::min(left(), other.left());
+        auto new_top = std::min(top(), other.top());
+        return Rect{
+                new_left,
+                new_top,
+                std::max(right(), other.right()) - new_left,
+                std::max(bottom(), other.bottom()) - new_top,
+        };
+    }
+
     [[nodiscard]] constexpr bool contains(Position const &p) const {
         bool inside_horizontally = p.x >= left() && p.x <= right();
         bool inside_vertically = p.y >= top() && p.y <= bottom();
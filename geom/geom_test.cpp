@@ -113,6 +113,23 @@ int main() {
         expect_eq(Rect{}, r.intersected({11, 11, 1, 1}));
     });
 
+    etest::test("Rect::united", [] {
+        Rect r{0, 0, 10, 10};
+
+        // Uniting with self should be a no-op.
+        expect_eq(r, r.united(r));
+
+        expect_eq(r, r.united({3, 4, 5, 5}));
+        expect_eq(Rect{0, 0, 18, 15}, r.united({8, 5, 10, 10}));
+        expect_eq(Rect{-2, -2, 12, 12}, r.united({-2, -2, 4, 4}));
+        expect_eq(Rect{0, 0, 30, 30}, r.united({20, 20, 10, 10}));
+
+        // Empty rects don't contribute.
+        expect_eq(r, r.united({}));
+        expect_eq(r, r.united({100, 100, 0, 5}));
+        expect_eq(r, Rect{}.united(r));
+    });
+
     etest::test("Rect::contains", [] {
         Rect r{0, 0, 10, 10};
         expect(r.contains({0, 0}));
@@ -0,0 +1,123 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "geom/rtree.h"
+
+#include "geom/geom.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace geom {
+namespace {
+
+// Unlike Rect::united, this keeps empty rects inside of the bounds so that
+// e.g. zero-width boxes can still be found by position.
+constexpr Rect bounds_of(Rect const &a, Rect const &b) {
+    auto left = std::min(a.left(), b.left());
+    auto top = std::min(a.top(), b.top());
+    return Rect{left, top, std::max(a.right(), b.right()) - left, std::max(a.bottom(), b.bottom()) - top};
+}
+
+constexpr long long center_x(Rect const &r) {
+    return 2LL * r.x + r.width;
+}
+
+constexpr long long center_y(Rect const &r) {
+    return 2LL * r.y + r.height;
+}
+
+} // namespace
+
+RTree::RTree(std::span<Rect const> rects) {
+    if (rects.empty()) {
+        return;
+    }
+
+    items_.resize(rects.size());
+    std::iota(items_.begin(), items_.end(), std::uint32_t{0});
+
+    // Sort-Tile-Recursive: Split the rects into vertical slices by their
+    // horizontal center, and then sort each slice by the vertical center, so
+    // that nearby rects end up in the same leaves.
+    auto const leaf_count = (rects.size() + kFanout - 1) / kFanout;
+    auto const slice_count = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(leaf_count))));
+    auto const slice_size = slice_count * kFanout;
+    std::ranges::sort(items_, {}, [&](std::uint32_t i) { return center_x(rects[i]); });
+    for (std::size_t i = 0; i < items_.size(); i += slice_size) {
+        auto slice_end = items_.begin() + static_cast<std::ptrdiff_t>(std::min(i + slice_size, items_.size()));
+        std::ranges::sort(items_.begin() + static_cast<std::ptrdiff_t>(i), slice_end, {}, [&](std::uint32_t idx) {
+            return center_y(rects[idx]);
+        });
+    }
+
+    std::vector<Rect> leaves;
+    leaves.reserve(items_.size());
+    for (auto item : items_) {
+        leaves.push_back(rects[item]);
+    }
+    levels_.push_back(std::move(leaves));
+
+    while (levels_.back().size() > 1) {
+        auto const &below = levels_.back();
+        std::vector<Rect> level;
+        level.reserve((below.size() + kFanout - 1) / kFanout);
+        for (std::size_t i = 0; i < below.size(); i += kFanout) {
+            auto bounds = below[i];
+            for (std::size_t j = i + 1; j < std::min(i + kFanout, below.size()); ++j) {
+                bounds = bounds_of(bounds, below[j]);
+            }
+            level.push_back(bounds);
+        }
+        levels_.push_back(std::move(level));
+    }
+}
+
+std::vector<std::size_t> RTree::query(Rect const &rect) const {
+    return query([&rect](Rect const &r) { return !r.intersected(rect).empty(); });
+}
+
+std::vector<std::size_t> RTree::query(Position p) const {
+    return query([p](Rect const &r) { return r.contains(p); });
+}
+
+template<typename Predicate>
+std::vector<std::size_t> RTree::query(Predicate const &matches) const {
+    std::vector<std::size_t> result;
+    if (levels_.empty()) {
+        return result;
+    }
+
+    // (level, node) pairs left to visit.
+    std::vector<std::pair<std::size_t, std::size_t>> to_visit{{levels_.size() - 1, 0}};
+    while (!to_visit.empty()) {
+        auto [level, node] = to_visit.back();
+        to_visit.pop_back();
+        if (!matches(levels_[level][node])) {
+            continue;
+        }
+
+        if (level == 0) {
+            result.push_back(items_[node]);
+            continue;
+        }
+
+        auto const first_child = node * kFanout;
+        auto const last_child = std::min(first_child + kFanout, levels_[level - 1].size());
+        for (auto child = first_child; child < last_child; ++child) {
+            to_visit.emplace_back(level - 1, child);
+        }
+    }
+
+    std::ranges::sort(result);
+    return result;
+}
+
+} // namespace geom
@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef GEOM_RTREE_H_
+#define GEOM_RTREE_H_
+
+#include "geom/geom.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace geom {
+
+// A static R-tree, bulk-loaded using Sort-Tile-Recursive packing. Queries
+// return the indices the rects had when the tree was built, in ascending order.
+class RTree {
+public:
+    RTree() = default;
+    explicit RTree(std::span<Rect const>);
+
+    // Everything with a non-empty intersection with the rect.
+    [[nodiscard]] std::vector<std::size_t> query(Rect const &) const;
+    // Everything containing the position, edges included.
+    [[nodiscard]] std::vector<std::size_t> query(Position) const;
+
+    [[nodiscard]] std::size_t size() const { return items_.size(); }
+    [[nodiscard]] bool empty() const { return items_.empty(); }
+
+private:
+    static constexpr std::size_t kFanout = 16;
+
+    // The nodes of every level, leaves first. The children of node n in a
+    // level are nodes [n * kFanout, (n + 1) * kFanout) in the level below it.
+    std::vector<std::vector<Rect>> levels_;
+    // The original index of every leaf.
+    std::vector<std::uint32_t> items_;
+
+    template<typename Predicate>
+    std::vector<std::size_t> query(Predicate const &) const;
+};
+
+} // namespace geom
+
+#endif
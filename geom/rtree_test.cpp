@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "geom/rtree.h"
+
+#include "geom/geom.h"
+
+#include "etest/etest2.h"
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+using geom::Position;
+using geom::Rect;
+using geom::RTree;
+
+namespace {
+
+std::vector<std::size_t> brute_force(std::vector<Rect> const &rects, Rect const &query) {
+    std::vector<std::size_t> result;
+    for (std::size_t i = 0; i < rects.size(); ++i) {
+        if (!rects[i].intersected(query).empty()) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+std::vector<std::size_t> brute_force(std::vector<Rect> const &rects, Position p) {
+    std::vector<std::size_t> result;
+    for (std::size_t i = 0; i < rects.size(); ++i) {
+        if (rects[i].contains(p)) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+int main() {
+    etest::Suite s{"geom/rtree"};
+
+    s.add_test("empty", [](etest::IActions &a) {
+        RTree tree;
+        a.expect(tree.empty());
+        a.expect(tree.query(Rect{0, 0, 100, 100}).empty());
+        a.expect(tree.query(Position{0, 0}).empty());
+    });
+
+    s.add_test("rect query", [](etest::IActions &a) {
+        std::vector<Rect> rects{{0, 0, 10, 10}, {20, 20, 10, 10}, {5, 5, 20, 20}};
+        RTree tree{rects};
+        a.expect_eq(tree.size(), std::size_t{3});
+        a.expect_eq(tree.query(Rect{0, 0, 1, 1}), std::vector<std::size_t>{0});
+        a.expect_eq(tree.query(Rect{6, 6, 2, 2}), std::vector<std::size_t>{0, 2});
+        a.expect_eq(tree.query(Rect{0, 0, 100, 100}), std::vector<std::size_t>{0, 1, 2});
+        // Touching isn't intersecting.
+        a.expect(tree.query(Rect{30, 30, 5, 5}).empty());
+    });
+
+    s.add_test("position query", [](etest::IActions &a) {
+        std::vector<Rect> rects{{0, 0, 10, 10}, {20, 20, 10, 10}, {5, 5, 0, 20}};
+        RTree tree{rects};
+        a.expect_eq(tree.query(Position{10, 10}), std::vector<std::size_t>{0});
+        a.expect_eq(tree.query(Position{5, 5}), std::vector<std::size_t>{0, 2});
+        a.expect_eq(tree.query(Position{5, 25}), std::vector<std::size_t>{2});
+        a.expect(tree.query(Position{15, 15}).empty());
+    });
+
+    s.add_test("matches brute force", [](etest::IActions &a) {
+        std::mt19937 rng{1234}; // NOLINT(cert-msc32-c,cert-msc51-cpp): Deterministic on purpose.
+        std::uniform_int_distribution<int> pos{0, 5000};
+        std::uniform_int_distribution<int> size{0, 200};
+
+        std::vector<Rect> rects;
+        for (int i = 0; i < 2000; ++i) {
+            rects.push_back(Rect{pos(rng), pos(rng), size(rng), size(rng)});
+        }
+        RTree tree{rects};
+
+        for (int i = 0; i < 200; ++i) {
+            auto query = Rect{pos(rng), pos(rng), size(rng), size(rng)};
+            a.expect_eq(tree.query(query), brute_force(rects, query));
+
+            auto p = Position{pos(rng), pos(rng)};
+            a.expect_eq(tree.query(p), brute_force(rects, p));
+        }
+    });
+
+    return s.run();
+}
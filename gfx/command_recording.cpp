@@ -0,0 +1,481 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "gfx/command_recording.h"
+
+#include "gfx/canvas_command_saver.h"
+#include "gfx/color.h"
+#include "gfx/font.h"
+#include "gfx/icanvas.h"
+
+#include "geom/geom.h"
+
+#include <tl/expected.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace gfx {
+namespace {
+
+constexpr auto kMagic = std::to_array<std::uint8_t>({'H', 'C', 'R'});
+constexpr std::uint8_t kVersion = 1;
+
+// These are persisted, so existing values mustn't change.
+enum class Op : std::uint8_t {
+    SetViewportSize = 0,
+    SetScale = 1,
+    AddTranslation = 2,
+    Clear = 3,
+    FillRect = 4,
+    DrawRect = 5,
+    DrawTextWithFontOptions = 6,
+    DrawText = 7,
+    DrawPixels = 8,
+};
+
+enum DrawRectFlags : std::uint8_t {
+    kHasBorders = 1 << 0,
+    kHasCorners = 1 << 1,
+};
+
+std::uint8_t to_bits(FontStyle s) {
+    return static_cast<std::uint8_t>((s.bold ? 1 : 0) | (s.italic ? 2 : 0) | (s.strikethrough ? 4 : 0)
+            | (s.underlined ? 8 : 0));
+}
+
+FontStyle from_bits(std::uint8_t bits) {
+    return {
+            .bold = (bits & 1) != 0,
+            .italic = (bits & 2) != 0,
+            .strikethrough = (bits & 4) != 0,
+            .underlined = (bits & 8) != 0,
+    };
+}
+
+class Writer {
+public:
+    void u8(std::uint8_t v) { out_.push_back(v); }
+
+    // LEB128
+    void uvarint(std::uint64_t v) {
+        while (v >= 0x80) {
+            u8(static_cast<std::uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        u8(static_cast<std::uint8_t>(v));
+    }
+
+    // Zigzag-encoded so that small negative numbers stay small.
+    void svarint(std::int64_t v) {
+        uvarint((static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63));
+    }
+
+    void color(Color c) {
+        u8(c.r);
+        u8(c.g);
+        u8(c.b);
+        u8(c.a);
+    }
+
+    void bytes(std::span<std::uint8_t const> b) {
+        uvarint(b.size());
+        out_.insert(out_.end(), b.begin(), b.end());
+    }
+
+    // Positions are written relative to the previous one.
+    void position(geom::Position p) {
+        svarint(std::int64_t{p.x} - last_.x);
+        svarint(std::int64_t{p.y} - last_.y);
+        last_ = p;
+    }
+
+    void rect(geom::Rect const &r) {
+        position(r.position());
+        svarint(r.width);
+        svarint(r.height);
+    }
+
+    std::vector<std::uint8_t> take() { return std::move(out_); }
+
+private:
+    std::vector<std::uint8_t> out_;
+    geom::Position last_{};
+};
+
+// Reading past the end sets the error and returns zeroes, so that the error
+// only has to be checked once per command.
+class Reader {
+public:
+    explicit Reader(std::span<std::uint8_t const> data) : data_{data} {}
+
+    std::uint8_t u8() {
+        if (pos_ >= data_.size()) {
+            error_ = RecordingError::AbruptEof;
+            return 0;
+        }
+        return data_[pos_++];
+    }
+
+    std::uint64_t uvarint() {
+        std::uint64_t v{};
+        for (int shift = 0; shift < 64; shift += 7) {
+            auto b = u8();
+            v |= std::uint64_t{b & 0x7Fu} << shift;
+            if ((b & 0x80) == 0) {
+                return v;
+            }
+        }
+
+        error_ = RecordingError::InvalidCommand;
+        return 0;
+    }
+
+    std::int64_t svarint() {
+        auto v = uvarint();
+        return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+    }
+
+    int i32() { return static_cast<int>(svarint()); }
+
+    Color color() {
+        auto r = u8();
+        auto g = u8();
+        auto b = u8();
+        auto a = u8();
+        return {r, g, b, a};
+    }
+
+    std::span<std::uint8_t const> bytes() {
+        auto size = uvarint();
+        if (size > data_.size() - pos_) {
+            error_ = RecordingError::AbruptEof;
+            return {};
+        }
+
+        auto b = data_.subspan(pos_, size);
+        pos_ += size;
+        return b;
+    }
+
+    geom::Position position() {
+        last_ = {static_cast<int>(last_.x + svarint()), static_cast<int>(last_.y + svarint())};
+        return last_;
+    }
+
+    geom::Rect rect() {
+        auto p = position();
+        auto w = i32();
+        auto h = i32();
+        return {p.x, p.y, w, h};
+    }
+
+    void fail(RecordingError e) { error_ = e; }
+    [[nodiscard]] std::optional<RecordingError> error() const { return error_; }
+    [[nodiscard]] bool at_end() const { return pos_ == data_.size(); }
+
+private:
+    std::span<std::uint8_t const> data_;
+    std::size_t pos_{};
+    geom::Position last_{};
+    std::optional<RecordingError> error_;
+};
+
+class StringTable {
+public:
+    std::uint64_t index_of(std::string_view s) {
+        auto [it, inserted] = indices_.try_emplace(std::string{s}, strings_.size());
+        if (inserted) {
+            strings_.emplace_back(s);
+        }
+        return it->second;
+    }
+
+    std::vector<std::string> const &strings() const { return strings_; }
+
+private:
+    std::map<std::string, std::uint64_t, std::less<>> indices_;
+    std::vector<std::string> strings_;
+};
+
+class CommandWriter {
+public:
+    CommandWriter(Writer &w, StringTable &strings) : w_{w}, strings_{strings} {}
+
+    void operator()(SetViewportSizeCmd const &cmd) {
+        op(Op::SetViewportSize);
+        w_.svarint(cmd.width);
+        w_.svarint(cmd.height);
+    }
+
+    void operator()(SetScaleCmd const &cmd) {
+        op(Op::SetScale);
+        w_.svarint(cmd.scale);
+    }
+
+    void operator()(AddTranslationCmd const &cmd) {
+        op(Op::AddTranslation);
+        w_.svarint(cmd.dx);
+        w_.svarint(cmd.dy);
+    }
+
+    void operator()(ClearCmd const &cmd) {
+        op(Op::Clear);
+        w_.color(cmd.color);
+    }
+
+    void operator()(FillRectCmd const &cmd) {
+        op(Op::FillRect);
+        w_.rect(cmd.rect);
+        w_.color(cmd.color);
+    }
+
+    void operator()(DrawRectCmd const &cmd) {
+        op(Op::DrawRect);
+        std::uint8_t flags{};
+        flags |= cmd.borders != Borders{} ? kHasBorders : 0;
+        flags |= cmd.corners != Corners{} ? kHasCorners : 0;
+        w_.u8(flags);
+        w_.rect(cmd.rect);
+        w_.color(cmd.color);
+
+        if ((flags & kHasBorders) != 0) {
+            for (auto const *b : {&cmd.borders.left, &cmd.borders.right, &cmd.borders.top, &cmd.borders.bottom}) {
+                w_.color(b->color);
+                w_.svarint(b->size);
+            }
+        }
+
+        if ((flags & kHasCorners) != 0) {
+            for (auto const *c : {&cmd.corners.top_left,
+                         &cmd.corners.top_right,
+                         &cmd.corners.bottom_left,
+                         &cmd.corners.bottom_right}) {
+                w_.svarint(c->horizontal);
+                w_.svarint(c->vertical);
+            }
+        }
+    }
+
+    void operator()(DrawTextWithFontOptionsCmd const &cmd) {
+        op(Op::DrawTextWithFontOptions);
+        text(cmd.position, cmd.text, cmd.size, cmd.style, cmd.color);
+        w_.uvarint(cmd.font_options.size());
+        for (auto const &font : cmd.font_options) {
+            w_.uvarint(strings_.index_of(font));
+        }
+    }
+
+    void operator()(DrawTextCmd const &cmd) {
+        op(Op::DrawText);
+        text(cmd.position, cmd.text, cmd.size, cmd.style, cmd.color);
+        w_.uvarint(strings_.index_of(cmd.font));
+    }
+
+    void operator()(DrawPixelsCmd const &cmd) {
+        op(Op::DrawPixels);
+        w_.rect(cmd.rect);
+        w_.bytes(cmd.rgba_data);
+    }
+
+private:
+    void op(Op o) { w_.u8(static_cast<std::uint8_t>(o)); }
+
+    void text(geom::Position p, std::string_view text, int size, FontStyle style, Color color) {
+        w_.position(p);
+        w_.uvarint(strings_.index_of(text));
+        w_.svarint(size);
+        w_.u8(to_bits(style));
+        w_.color(color);
+    }
+
+    Writer &w_;
+    StringTable &strings_;
+};
+
+class CommandReader {
+public:
+    CommandReader(Reader &r, std::vector<std::string> const &strings) : r_{r}, strings_{strings} {}
+
+    std::optional<CanvasCommand> read() {
+        switch (static_cast<Op>(r_.u8())) {
+            case Op::SetViewportSize: {
+                auto width = r_.i32();
+                auto height = r_.i32();
+                return SetViewportSizeCmd{width, height};
+            }
+            case Op::SetScale:
+                return SetScaleCmd{r_.i32()};
+            case Op::AddTranslation: {
+                auto dx = r_.i32();
+                auto dy = r_.i32();
+                return AddTranslationCmd{dx, dy};
+            }
+            case Op::Clear:
+                return ClearCmd{r_.color()};
+            case Op::FillRect: {
+                auto rect = r_.rect();
+                return FillRectCmd{rect, r_.color()};
+            }
+            case Op::DrawRect:
+                return draw_rect();
+            case Op::DrawTextWithFontOptions: {
+                DrawTextWithFontOptionsCmd cmd;
+                text(cmd);
+                auto count = r_.uvarint();
+                for (std::uint64_t i = 0; i < count && !r_.error(); ++i) {
+                    cmd.font_options.push_back(string());
+                }
+                return cmd;
+            }
+            case Op::DrawText: {
+                DrawTextCmd cmd;
+                text(cmd);
+                cmd.font = string();
+                return cmd;
+            }
+            case Op::DrawPixels: {
+                auto rect = r_.rect();
+                auto bytes = r_.bytes();
+                return DrawPixelsCmd{rect, {bytes.begin(), bytes.end()}};
+            }
+        }
+
+        r_.fail(RecordingError::InvalidCommand);
+        return std::nullopt;
+    }
+
+private:
+    DrawRectCmd draw_rect() {
+        DrawRectCmd cmd;
+        auto flags = r_.u8();
+        cmd.rect = r_.rect();
+        cmd.color = r_.color();
+
+        if ((flags & kHasBorders) != 0) {
+            for (auto *b : {&cmd.borders.left, &cmd.borders.right, &cmd.borders.top, &cmd.borders.bottom}) {
+                b->color = r_.color();
+                b->size = r_.i32();
+            }
+        }
+
+        if ((flags & kHasCorners) != 0) {
+            for (auto *c : {&cmd.corners.top_left,
+                         &cmd.corners.top_right,
+                         &cmd.corners.bottom_left,
+                         &cmd.corners.bottom_right}) {
+                c->horizontal = r_.i32();
+                c->vertical = r_.i32();
+            }
+        }
+
+        return cmd;
+    }
+
+    template<typename T>
+    void text(T &cmd) {
+        cmd.position = r_.position();
+        cmd.text = string();
+        cmd.size = r_.i32();
+        cmd.style = from_bits(r_.u8());
+        cmd.color = r_.color();
+    }
+
+    std::string string() {
+        auto index = r_.uvarint();
+        if (index >= strings_.size()) {
+            r_.fail(RecordingError::InvalidStringIndex);
+            return {};
+        }
+        return strings_[index];
+    }
+
+    Reader &r_;
+    std::vector<std::string> const &strings_;
+};
+
+} // namespace
+
+// Layout:
+// * magic and version
+// * string count, then each string as its size followed by its bytes
+// * command count, then each command as its Op followed by its fields
+std::vector<std::uint8_t> serialize_commands(std::span<CanvasCommand const> commands) {
+    StringTable strings;
+    Writer body;
+    CommandWriter command_writer{body, strings};
+    for (auto const &command : commands) {
+        std::visit(command_writer, command);
+    }
+
+    Writer out;
+    for (auto b : kMagic) {
+        out.u8(b);
+    }
+    out.u8(kVersion);
+
+    out.uvarint(strings.strings().size());
+    for (auto const &s : strings.strings()) {
+        out.bytes({reinterpret_cast<std::uint8_t const *>(s.data()), s.size()});
+    }
+
+    out.uvarint(commands.size());
+    auto result = out.take();
+    auto encoded_commands = body.take();
+    result.insert(result.end(), encoded_commands.begin(), encoded_commands.end());
+    return result;
+}
+
+tl::expected<std::vector<CanvasCommand>, RecordingError> deserialize_commands(std::span<std::uint8_t const> data) {
+    Reader r{data};
+    for (auto b : kMagic) {
+        if (r.u8() != b) {
+            return tl::unexpected{r.error().value_or(RecordingError::InvalidMagic)};
+        }
+    }
+
+    if (auto version = r.u8(); version != kVersion) {
+        return tl::unexpected{r.error().value_or(RecordingError::UnsupportedVersion)};
+    }
+
+    std::vector<std::string> strings;
+    auto const string_count = r.uvarint();
+    for (std::uint64_t i = 0; i < string_count && !r.error(); ++i) {
+        auto s = r.bytes();
+        strings.emplace_back(reinterpret_cast<char const *>(s.data()), s.size());
+    }
+
+    std::vector<CanvasCommand> commands;
+    auto const command_count = r.uvarint();
+    CommandReader command_reader{r, strings};
+    for (std::uint64_t i = 0; i < command_count && !r.error(); ++i) {
+        auto command = command_reader.read();
+        if (!command || r.error()) {
+            break;
+        }
+        commands.push_back(*std::move(command));
+    }
+
+    if (auto error = r.error()) {
+        return tl::unexpected{*error};
+    }
+
+    if (!r.at_end()) {
+        return tl::unexpected{RecordingError::TrailingData};
+    }
+
+    return commands;
+}
+
+} // namespace gfx
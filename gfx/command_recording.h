@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef GFX_COMMAND_RECORDING_H_
+#define GFX_COMMAND_RECORDING_H_
+
+#include "gfx/canvas_command_saver.h"
+
+#include <tl/expected.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace gfx {
+
+enum class RecordingError : std::uint8_t {
+    AbruptEof,
+    InvalidMagic,
+    UnsupportedVersion,
+    InvalidCommand,
+    InvalidStringIndex,
+    TrailingData,
+};
+
+// A compact binary format for recorded canvas commands, e.g. for benchmarking
+// painting w/o having to load and lay out a page first.
+//
+// All strings (text and font names) are deduplicated into a string table that
+// commands refer to by index, and positions are stored as deltas from the
+// previous command's position, which keeps them small when they're written
+// as variable-length integers.
+[[nodiscard]] std::vector<std::uint8_t> serialize_commands(std::span<CanvasCommand const>);
+[[nodiscard]] tl::expected<std::vector<CanvasCommand>, RecordingError> deserialize_commands(
+        std::span<std::uint8_t const>);
+
+} // namespace gfx
+
+#endif
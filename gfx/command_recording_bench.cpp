@@ -0,0 +1,69 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "gfx/command_recording.h"
+
+#include "gfx/canvas_command_saver.h"
+#include "gfx/freetype_glyph_rasterizer.h"
+#include "gfx/software_canvas.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// Replays a paint recording into a software canvas as fast as possible, e.g.
+// to benchmark painting w/o having to load or lay out a page. Pass a filename
+// to save the final frame as a PNG, e.g. to use as a golden frame.
+//
+// Usage: command_recording_bench <recording> [iterations] [output.png]
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <recording> [iterations] [output.png]\n";
+        return 1;
+    }
+
+    std::ifstream is{argv[1], std::ios::binary};
+    std::vector<std::uint8_t> recording{std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+    auto commands = gfx::deserialize_commands(recording);
+    if (!commands) {
+        std::cerr << "Unable to load recording " << argv[1] << ", error " << static_cast<int>(commands.error())
+                  << '\n';
+        return 1;
+    }
+
+    int const iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+    gfx::FreeTypeGlyphRasterizer glyphs;
+    gfx::SoftwareCanvas canvas{&glyphs};
+
+    // The first frame also fills the glyph cache.
+    auto start = std::chrono::steady_clock::now();
+    gfx::replay_commands(canvas, *commands);
+    auto const first_frame = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        gfx::replay_commands(canvas, *commands);
+    }
+    auto const frames = std::chrono::steady_clock::now() - start;
+
+    using Ms = std::chrono::duration<double, std::milli>;
+    std::cout << commands->size() << " commands, " << recording.size() << " bytes, " << canvas.width() << "x"
+              << canvas.height() << '\n';
+    std::cout << "first frame: " << Ms{first_frame}.count() << "ms\n";
+    if (iterations > 0) {
+        std::cout << "frame: " << Ms{frames}.count() / iterations << "ms avg over " << iterations << " frames\n";
+    }
+
+    if (argc > 3) {
+        std::ofstream os{argv[3], std::ios::binary};
+        if (!canvas.write_png(os)) {
+            std::cerr << "Unable to write " << argv[3] << '\n';
+            return 1;
+        }
+    }
+}
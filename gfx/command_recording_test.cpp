@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "gfx/command_recording.h"
+
+#include "gfx/canvas_command_saver.h"
+#include "gfx/color.h"
+#include "gfx/font.h"
+#include "gfx/icanvas.h"
+#include "gfx/software_canvas.h"
+
+#include "etest/etest2.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+std::vector<gfx::CanvasCommand> record_page() {
+    gfx::CanvasCommandSaver saver;
+    saver.set_viewport_size(100, 60);
+    saver.set_scale(2);
+    saver.clear({0xFF, 0xFF, 0xFF});
+    saver.add_translation(0, -10);
+    for (int i = 0; i < 5; ++i) {
+        saver.fill_rect({i * 10, i * 12, 8, 8}, {0x10, 0x20, 0x30, 0x80});
+    }
+    saver.draw_rect({5, 5, 20, 10},
+            {0xAA, 0xBB, 0xCC},
+            {.left{{0xFF, 0, 0}, 1}, .right{{0, 0xFF, 0}, 2}, .top{{0, 0, 0xFF}, 3}, .bottom{{}, 4}},
+            {.top_left{3, 4}, .bottom_right{1, 2}});
+    saver.draw_rect({-5, -5, 1, 1}, {}, {}, {});
+    saver.draw_text({1, 2}, "hello"sv, gfx::Font{"arial"}, {12}, {.bold = true}, {1, 2, 3});
+    std::vector<gfx::Font> fonts{{"arial"}, {"comic sans"}};
+    saver.draw_text({1, 20}, "hello"sv, fonts, {14}, {.italic = true, .underlined = true}, {4, 5, 6});
+    std::vector<std::uint8_t> pixels{1, 2, 3, 4, 5, 6, 7, 8};
+    saver.draw_pixels({40, 40, 2, 1}, pixels);
+    return saver.take_commands();
+}
+
+} // namespace
+
+int main() {
+    etest::Suite s{"gfx/command_recording"};
+
+    s.add_test("round trip", [](etest::IActions &a) {
+        auto commands = record_page();
+        auto recording = gfx::serialize_commands(commands);
+        a.expect_eq(gfx::deserialize_commands(recording), commands);
+    });
+
+    s.add_test("empty", [](etest::IActions &a) {
+        auto recording = gfx::serialize_commands({});
+        a.expect_eq(recording.size(), std::size_t{6});
+        a.expect_eq(gfx::deserialize_commands(recording), std::vector<gfx::CanvasCommand>{});
+    });
+
+    s.add_test("strings are deduplicated and coordinates are small", [](etest::IActions &a) {
+        std::vector<gfx::CanvasCommand> commands;
+        for (int i = 0; i < 100; ++i) {
+            commands.emplace_back(gfx::DrawTextCmd{{1000, 10'000 + i * 20}, "some text", "arial", 16, {}, {}});
+        }
+
+        auto recording = gfx::serialize_commands(commands);
+        // Op, 2 position bytes (except for the first one), text index, size,
+        // style, color, and font index.
+        a.expect(recording.size() < 100 * 11 + 32);
+        a.expect_eq(gfx::deserialize_commands(recording), commands);
+    });
+
+    s.add_test("errors", [](etest::IActions &a) {
+        auto recording = gfx::serialize_commands(record_page());
+
+        auto bad_magic = recording;
+        bad_magic[0] = 'X';
+        a.expect_eq(gfx::deserialize_commands(bad_magic), tl::unexpected{gfx::RecordingError::InvalidMagic});
+
+        auto bad_version = recording;
+        bad_version[3] = 0xFF;
+        a.expect_eq(
+                gfx::deserialize_commands(bad_version), tl::unexpected{gfx::RecordingError::UnsupportedVersion});
+
+        for (std::size_t size = 0; size < recording.size(); ++size) {
+            a.expect_eq(gfx::deserialize_commands(std::span{recording}.first(size)),
+                    tl::unexpected{gfx::RecordingError::AbruptEof});
+        }
+
+        auto trailing = recording;
+        trailing.push_back(0);
+        a.expect_eq(gfx::deserialize_commands(trailing), tl::unexpected{gfx::RecordingError::TrailingData});
+
+        // 0 strings, 1 command w/ an invalid op.
+        std::vector<std::uint8_t> invalid_op{'H', 'C', 'R', 1, 0, 1, 0xFF};
+        a.expect_eq(gfx::deserialize_commands(invalid_op), tl::unexpected{gfx::RecordingError::InvalidCommand});
+
+        // 0 strings, 1 DrawText command referencing string 0.
+        std::vector<std::uint8_t> invalid_string{'H', 'C', 'R', 1, 0, 1, 7, 0, 0, 0};
+        a.expect_eq(gfx::deserialize_commands(invalid_string),
+                tl::unexpected{gfx::RecordingError::InvalidStringIndex});
+    });
+
+    // Replaying a recording has to paint exactly what the original commands
+    // did, which is what makes recordings useful as golden frames.
+    s.add_test("replay", [](etest::IActions &a) {
+        auto commands = record_page();
+        gfx::SoftwareCanvas expected;
+        gfx::replay_commands(expected, commands);
+
+        auto replayed_commands = gfx::deserialize_commands(gfx::serialize_commands(commands));
+        a.require(replayed_commands.has_value());
+        gfx::SoftwareCanvas replayed;
+        gfx::replay_commands(replayed, *replayed_commands);
+
+        a.expect_eq(replayed.width(), 100);
+        a.expect(std::ranges::equal(expected.pixels(), replayed.pixels()));
+    });
+
+    return s.run();
+}
@@ -0,0 +1,137 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "gfx/freetype_glyph_rasterizer.h"
+
+#include "gfx/font.h"
+#include "gfx/iglyph_rasterizer.h"
+
+#include "type/font_index.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_SYNTHESIS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace gfx {
+namespace {
+
+std::vector<std::uint8_t> coverage_from(FT_Bitmap const &bitmap) {
+    auto const width = static_cast<std::size_t>(bitmap.width);
+    std::vector<std::uint8_t> coverage(width * bitmap.rows);
+    for (unsigned y = 0; y < bitmap.rows; ++y) {
+        auto const *row = bitmap.buffer + static_cast<std::ptrdiff_t>(y) * bitmap.pitch;
+        auto *dst = coverage.data() + y * width;
+        if (bitmap.pixel_mode == FT_PIXEL_MODE_MONO) {
+            for (std::size_t x = 0; x < width; ++x) {
+                dst[x] = (row[x / 8] & (0x80 >> (x % 8))) != 0 ? 0xFF : 0;
+            }
+        } else {
+            std::copy_n(row, width, dst);
+        }
+    }
+
+    return coverage;
+}
+
+FT_Face open_face(FT_Library library, type::FontFace const *font) {
+    FT_Face ft_face = nullptr;
+    if (font == nullptr || FT_New_Face(library, font->path.c_str(), font->index, &ft_face) != 0) {
+        return nullptr;
+    }
+
+    return ft_face;
+}
+
+} // namespace
+
+FreeTypeGlyphRasterizer::FreeTypeGlyphRasterizer() {
+    if (FT_Init_FreeType(&library_) != 0) {
+        library_ = nullptr;
+    }
+}
+
+FreeTypeGlyphRasterizer::~FreeTypeGlyphRasterizer() {
+    if (library_ != nullptr) {
+        // This also frees all faces.
+        FT_Done_FreeType(library_);
+    }
+}
+
+std::optional<Glyph> FreeTypeGlyphRasterizer::rasterize(
+        std::span<Font const> fonts, FontSize size, FontStyle style, char32_t codepoint) const {
+    if (library_ == nullptr) {
+        return std::nullopt;
+    }
+
+    std::scoped_lock lock{mtx_};
+    FT_Face ft_face = nullptr;
+    for (auto const &font : fonts) {
+        if (ft_face = face(font.font); ft_face != nullptr) {
+            break;
+        }
+    }
+
+    if (ft_face == nullptr && (ft_face = fallback_face()) == nullptr) {
+        return std::nullopt;
+    }
+
+    if (FT_Set_Pixel_Sizes(ft_face, 0, static_cast<FT_UInt>(std::max(size.px, 1))) != 0
+            || FT_Load_Char(ft_face, codepoint, FT_LOAD_DEFAULT) != 0) {
+        return std::nullopt;
+    }
+
+    auto *slot = ft_face->glyph;
+    // Bold and italic are synthesized, like SFML does.
+    if (style.italic) {
+        FT_GlyphSlot_Oblique(slot);
+    }
+
+    if (style.bold) {
+        FT_GlyphSlot_Embolden(slot);
+    }
+
+    if (FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL) != 0) {
+        return std::nullopt;
+    }
+
+    auto const ascender = static_cast<int>(ft_face->size->metrics.ascender >> 6);
+    return Glyph{
+            .x_offset = slot->bitmap_left,
+            .y_offset = ascender - slot->bitmap_top,
+            .width = static_cast<int>(slot->bitmap.width),
+            .height = static_cast<int>(slot->bitmap.rows),
+            .advance = static_cast<int>(slot->advance.x >> 6),
+            .coverage = coverage_from(slot->bitmap),
+    };
+}
+
+FT_Face FreeTypeGlyphRasterizer::face(std::string_view font) const {
+    if (auto it = faces_.find(font); it != faces_.end()) {
+        return it->second;
+    }
+
+    return faces_.emplace(std::string{font}, open_face(library_, type::FontIndex::system().find(font))).first->second;
+}
+
+FT_Face FreeTypeGlyphRasterizer::fallback_face() const {
+    if (fallback_) {
+        return *fallback_;
+    }
+
+    fallback_ = open_face(library_, type::FontIndex::system().find("sans-serif"));
+    return *fallback_;
+}
+
+} // namespace gfx
@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef GFX_FREETYPE_GLYPH_RASTERIZER_H_
+#define GFX_FREETYPE_GLYPH_RASTERIZER_H_
+
+#include "gfx/font.h"
+#include "gfx/iglyph_rasterizer.h"
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// NOLINTBEGIN(bugprone-reserved-identifier): FreeType's names, not ours.
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+// NOLINTEND(bugprone-reserved-identifier)
+
+namespace gfx {
+
+// Rasterizes glyphs w/ FreeType, looking fonts up in the system's font index.
+// Glyphs missing from the requested fonts are taken from the sans-serif font.
+class FreeTypeGlyphRasterizer final : public IGlyphRasterizer {
+public:
+    FreeTypeGlyphRasterizer();
+    ~FreeTypeGlyphRasterizer() override;
+
+    FreeTypeGlyphRasterizer(FreeTypeGlyphRasterizer const &) = delete;
+    FreeTypeGlyphRasterizer &operator=(FreeTypeGlyphRasterizer const &) = delete;
+
+    [[nodiscard]] std::optional<Glyph> rasterize(
+            std::span<Font const>, FontSize, FontStyle, char32_t codepoint) const override;
+
+private:
+    FT_FaceRec_ *face(std::string_view font) const;
+    FT_FaceRec_ *fallback_face() const;
+
+    // FreeType objects may not be used from several threads at once.
+    mutable std::mutex mtx_;
+    FT_LibraryRec_ *library_{nullptr};
+    // Fonts that couldn't be found are cached as nullptr.
+    mutable std::map<std::string, FT_FaceRec_ *, std::less<>> faces_;
+    mutable std::optional<FT_FaceRec_ *> fallback_;
+};
+
+} // namespace gfx
+
+#endif
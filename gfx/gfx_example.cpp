@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "gfx/color.h"
+#include "gfx/freetype_glyph_rasterizer.h"
 #include "gfx/icanvas.h"
 #include "gfx/opengl_canvas.h"
 #include "gfx/sfml_canvas.h"
@@ -31,12 +32,16 @@ int main(int argc, char **argv) {
     }
 
     type::SfmlType type;
+    gfx::FreeTypeGlyphRasterizer glyphs;
 
+    gfx::OpenGLCanvas *gl_canvas{nullptr};
     auto canvas = [&]() -> std::unique_ptr<gfx::ICanvas> {
         if (argc == 2 && argv[1] == "--sf"sv) {
             return std::make_unique<gfx::SfmlCanvas>(window, type);
         }
-        return std::make_unique<gfx::OpenGLCanvas>();
+        auto c = std::make_unique<gfx::OpenGLCanvas>(&glyphs);
+        gl_canvas = c.get();
+        return c;
     }();
 
     canvas->set_viewport_size(window.getSize().x, window.getSize().y);
@@ -86,6 +91,10 @@ int main(int argc, char **argv) {
                 {100, 100, 100, 0xff, 200, 200, 200, 0xff, 50, 50, 50, 0xff, 200, 0, 0, 0xff});
         canvas->draw_pixels({1, 1, 2, 2}, px);
 
+        if (gl_canvas != nullptr) {
+            gl_canvas->flush();
+        }
+
         window.display();
     }
 }
@@ -0,0 +1,169 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "gfx/glyph_atlas.h"
+
+#include "gfx/font.h"
+#include "gfx/iglyph_rasterizer.h"
+
+#include "geom/geom.h"
+#include "unicode/util.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace gfx {
+
+TextRun GlyphAtlas::layout(
+        geom::Position p, std::string_view text, std::span<Font const> fonts, FontSize size, FontStyle style) {
+    auto const fonts_id = font_id(fonts);
+
+    TextRun run;
+    int pen_x = p.x;
+    for (auto codepoint : unicode::CodePointView{text}) {
+        auto const g = glyph(fonts_id, fonts, size, style, static_cast<char32_t>(codepoint));
+        if (g.width > 0 && g.height > 0) {
+            run.quads.push_back(GlyphQuad{
+                    .page = g.page,
+                    .src{g.x, g.y, g.width, g.height},
+                    .dst{pen_x + g.x_offset, p.y + g.y_offset, g.width, g.height},
+            });
+        }
+
+        pen_x += g.advance;
+    }
+
+    std::ranges::stable_sort(run.quads, {}, &GlyphQuad::page);
+    run.advance = pen_x - p.x;
+
+    // Without font metrics the decorations are placed relative to the font
+    // size, which is close enough for the fonts we use.
+    auto const thickness = std::max(1, size.px / 14);
+    if (style.underlined) {
+        run.decorations.push_back({p.x, p.y + size.px * 9 / 10, run.advance, thickness});
+    }
+
+    if (style.strikethrough) {
+        run.decorations.push_back({p.x, p.y + size.px / 2, run.advance, thickness});
+    }
+
+    return run;
+}
+
+AtlasGlyph GlyphAtlas::glyph(std::span<Font const> fonts, FontSize size, FontStyle style, char32_t codepoint) {
+    return glyph(font_id(fonts), fonts, size, style, codepoint);
+}
+
+std::uint32_t GlyphAtlas::font_id(std::span<Font const> fonts) {
+    std::string key;
+    for (auto const &font : fonts) {
+        key += font.font;
+        key += '\0';
+    }
+
+    auto const next_id = static_cast<std::uint32_t>(font_ids_.size());
+    return font_ids_.try_emplace(std::move(key), next_id).first->second;
+}
+
+AtlasGlyph GlyphAtlas::glyph(
+        std::uint32_t fonts_id, std::span<Font const> fonts, FontSize size, FontStyle style, char32_t codepoint) {
+    GlyphKey const key{fonts_id, size.px, style.bold, style.italic, codepoint};
+    if (auto it = glyphs_.find(key); it != glyphs_.end()) {
+        ++stats_.hits;
+        if (it->second.width > 0 && it->second.height > 0) {
+            pages_[it->second.page].last_used = ++clock_;
+        }
+        return it->second;
+    }
+
+    ++stats_.misses;
+    auto rasterized = rasterizer_->rasterize(fonts, size, style, codepoint).value_or(Glyph{});
+    // Glyphs larger than a page are clipped. That's not going to happen at any
+    // reasonable font size.
+    auto const w = std::min(rasterized.width, opts_.page_size);
+    auto const h = std::min(rasterized.height, opts_.page_size);
+
+    AtlasGlyph entry{
+            .width = w,
+            .height = h,
+            .x_offset = rasterized.x_offset,
+            .y_offset = rasterized.y_offset,
+            .advance = rasterized.advance,
+    };
+
+    if (w > 0 && h > 0) {
+        entry.page = page_with_room(w, h);
+        auto &page = pages_[entry.page];
+        entry.x = page.shelf_x;
+        entry.y = page.shelf_y;
+        for (int y = 0; y < h; ++y) {
+            auto const *src = rasterized.coverage.data() + static_cast<std::size_t>(y) * rasterized.width;
+            auto const dst = static_cast<std::size_t>(entry.y + y) * opts_.page_size + entry.x;
+            std::copy_n(src, w, page.coverage.begin() + static_cast<std::ptrdiff_t>(dst));
+        }
+
+        page.shelf_x += w;
+        page.shelf_height = std::max(page.shelf_height, h);
+        page.last_used = ++clock_;
+        ++page.generation;
+    }
+
+    return glyphs_.emplace(key, entry).first->second;
+}
+
+std::size_t GlyphAtlas::page_with_room(int width, int height) {
+    auto const page_size = opts_.page_size;
+    auto fits = [&](Page &page) {
+        if (page.shelf_x + width > page_size) {
+            page.shelf_x = 0;
+            page.shelf_y += page.shelf_height;
+            page.shelf_height = 0;
+        }
+        return page.shelf_y + height <= page_size;
+    };
+
+    if (!pages_.empty() && fits(pages_[current_page_])) {
+        return current_page_;
+    }
+
+    auto const evictable = [this](Page const &page) {
+        return page.last_used <= pinned_since_;
+    };
+
+    auto victim = std::ranges::min_element(pages_, {}, [&](Page const &page) {
+        return evictable(page) ? page.last_used : std::numeric_limits<std::uint64_t>::max();
+    });
+
+    if (pages_.size() < opts_.max_pages || victim == pages_.end() || !evictable(*victim)) {
+        pages_.push_back(Page{
+                .coverage = std::vector<std::uint8_t>(static_cast<std::size_t>(page_size) * page_size),
+        });
+        current_page_ = pages_.size() - 1;
+        return current_page_;
+    }
+
+    current_page_ = static_cast<std::size_t>(std::distance(pages_.begin(), victim));
+    std::erase_if(glyphs_, [this](auto const &entry) {
+        auto const &g = entry.second;
+        return g.page == current_page_ && g.width > 0 && g.height > 0;
+    });
+
+    std::ranges::fill(victim->coverage, std::uint8_t{0});
+    victim->shelf_x = 0;
+    victim->shelf_y = 0;
+    victim->shelf_height = 0;
+    ++victim->generation;
+    ++stats_.evictions;
+    return current_page_;
+}
+
+} // namespace gfx
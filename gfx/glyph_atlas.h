@@ -0,0 +1,148 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef GFX_GLYPH_ATLAS_H_
+#define GFX_GLYPH_ATLAS_H_
+
+#include "gfx/font.h"
+#include "gfx/iglyph_rasterizer.h"
+
+#include "geom/geom.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace gfx {
+
+struct GlyphAtlasOptions {
+    // Pages are square, page_size x page_size 8-bit coverage bitmaps.
+    int page_size{1024};
+    // The least recently used page is evicted when a glyph doesn't fit and
+    // there are already this many pages.
+    std::size_t max_pages{4};
+};
+
+struct GlyphAtlasStats {
+    std::size_t hits{};
+    std::size_t misses{};
+    std::size_t evictions{};
+
+    [[nodiscard]] double hit_rate() const {
+        auto const lookups = hits + misses;
+        return lookups == 0 ? 0. : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+
+    [[nodiscard]] bool operator==(GlyphAtlasStats const &) const = default;
+};
+
+// Where a rasterized glyph lives in the atlas.
+struct AtlasGlyph {
+    std::size_t page{};
+    int x{};
+    int y{};
+    int width{};
+    int height{};
+    int x_offset{};
+    int y_offset{};
+    int advance{};
+};
+
+// One glyph of a text run: the part of an atlas page to copy, and where to.
+struct GlyphQuad {
+    std::size_t page{};
+    geom::Rect src{};
+    geom::Rect dst{};
+
+    [[nodiscard]] bool operator==(GlyphQuad const &) const = default;
+};
+
+struct TextRun {
+    // Sorted by page so that each page can be drawn in one go.
+    std::vector<GlyphQuad> quads;
+    // Underlines and strikethroughs.
+    std::vector<geom::Rect> decorations;
+    int advance{};
+};
+
+// Rasterizes glyphs once per (fonts, size, style, code point) and packs them
+// into pages of coverage that canvases can draw from, either directly or by
+// uploading them as textures.
+class GlyphAtlas {
+public:
+    explicit GlyphAtlas(IGlyphRasterizer const &rasterizer, GlyphAtlasOptions opts = {})
+        : rasterizer_{&rasterizer}, opts_{opts} {}
+
+    // Positions are in pixels, and no scaling is done.
+    [[nodiscard]] TextRun layout(geom::Position, std::string_view, std::span<Font const>, FontSize, FontStyle);
+    [[nodiscard]] AtlasGlyph glyph(std::span<Font const>, FontSize, FontStyle, char32_t);
+
+    // Glyphs are pinned from when they're handed out until unpin() is called.
+    // Pages w/ pinned glyphs are never evicted, so quads that haven't been
+    // drawn yet stay valid. The page limit is exceeded if nothing else can be
+    // evicted.
+    void unpin() { pinned_since_ = clock_; }
+
+    [[nodiscard]] int page_size() const { return opts_.page_size; }
+    [[nodiscard]] std::size_t page_count() const { return pages_.size(); }
+    [[nodiscard]] std::span<std::uint8_t const> page(std::size_t i) const { return pages_[i].coverage; }
+    // Changes whenever the content of the page changes, e.g. so that textures
+    // know when to be uploaded again.
+    [[nodiscard]] std::uint64_t page_generation(std::size_t i) const { return pages_[i].generation; }
+
+    [[nodiscard]] GlyphAtlasStats const &stats() const { return stats_; }
+
+private:
+    struct GlyphKey {
+        std::uint32_t fonts{};
+        int size{};
+        bool bold{};
+        bool italic{};
+        char32_t codepoint{};
+
+        [[nodiscard]] bool operator==(GlyphKey const &) const = default;
+    };
+
+    struct GlyphKeyHash {
+        std::size_t operator()(GlyphKey const &k) const {
+            auto h = std::hash<std::uint64_t>{}((std::uint64_t{k.fonts} << 32) | k.codepoint);
+            return h ^ (std::hash<int>{}(k.size * 4 + (k.bold ? 2 : 0) + (k.italic ? 1 : 0)) << 1);
+        }
+    };
+
+    struct Page {
+        std::vector<std::uint8_t> coverage;
+        std::uint64_t generation{};
+        std::uint64_t last_used{};
+        int shelf_x{};
+        int shelf_y{};
+        int shelf_height{};
+    };
+
+    [[nodiscard]] std::uint32_t font_id(std::span<Font const>);
+    [[nodiscard]] AtlasGlyph glyph(std::uint32_t fonts_id, std::span<Font const>, FontSize, FontStyle, char32_t);
+    // Returns the page w/ room for a glyph of this size, evicting one if needed.
+    [[nodiscard]] std::size_t page_with_room(int width, int height);
+
+    IGlyphRasterizer const *rasterizer_;
+    GlyphAtlasOptions opts_;
+    std::vector<Page> pages_;
+    // The page new glyphs are packed into.
+    std::size_t current_page_{};
+    std::unordered_map<GlyphKey, AtlasGlyph, GlyphKeyHash> glyphs_;
+    std::map<std::string, std::uint32_t, std::less<>> font_ids_;
+    GlyphAtlasStats stats_;
+    std::uint64_t clock_{};
+    std::uint64_t pinned_since_{};
+};
+
+} // namespace gfx
+
+#endif
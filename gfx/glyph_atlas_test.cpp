@@ -0,0 +1,142 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "gfx/glyph_atlas.h"
+
+#include "gfx/font.h"
+#include "gfx/iglyph_rasterizer.h"
+
+#include "etest/etest2.h"
+#include "geom/geom.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+// Every glyph is a 4x5 block filled w/ its code point, and spaces are empty.
+class BlockGlyphs : public gfx::IGlyphRasterizer {
+public:
+    std::optional<gfx::Glyph> rasterize(
+            std::span<gfx::Font const>, gfx::FontSize, gfx::FontStyle, char32_t codepoint) const override {
+        ++calls;
+        if (codepoint == U' ') {
+            return gfx::Glyph{.advance = 2};
+        }
+
+        return gfx::Glyph{
+                .x_offset = 1,
+                .y_offset = 2,
+                .width = 4,
+                .height = 5,
+                .advance = 5,
+                .coverage = std::vector<std::uint8_t>(20, static_cast<std::uint8_t>(codepoint)),
+        };
+    }
+
+    mutable int calls{};
+};
+
+gfx::Font const kFont{"block"};
+
+} // namespace
+
+int main() {
+    etest::Suite s{"gfx/glyph_atlas"};
+
+    s.add_test("layout", [](etest::IActions &a) {
+        BlockGlyphs glyphs;
+        gfx::GlyphAtlas atlas{glyphs};
+
+        auto run = atlas.layout({10, 20}, "a b", {{kFont}}, {10}, {});
+        a.expect_eq(run.advance, 12);
+        a.expect(run.decorations.empty());
+        a.expect_eq(run.quads,
+                std::vector<gfx::GlyphQuad>{
+                        {.page = 0, .src{0, 0, 4, 5}, .dst{11, 22, 4, 5}},
+                        {.page = 0, .src{4, 0, 4, 5}, .dst{18, 22, 4, 5}},
+                });
+
+        a.expect_eq(atlas.page_count(), std::size_t{1});
+        auto page = atlas.page(0);
+        a.expect_eq(page[0], std::uint8_t{'a'});
+        a.expect_eq(page[4], std::uint8_t{'b'});
+        a.expect_eq(page[8], std::uint8_t{0});
+    });
+
+    s.add_test("decorations", [](etest::IActions &a) {
+        BlockGlyphs glyphs;
+        gfx::GlyphAtlas atlas{glyphs};
+
+        auto run = atlas.layout({0, 0}, "ab", {{kFont}}, {20}, {.strikethrough = true, .underlined = true});
+        a.expect_eq(run.decorations, std::vector<geom::Rect>{{0, 18, 10, 1}, {0, 10, 10, 1}});
+    });
+
+    s.add_test("glyphs are only rasterized once", [](etest::IActions &a) {
+        BlockGlyphs glyphs;
+        gfx::GlyphAtlas atlas{glyphs};
+
+        std::ignore = atlas.layout({}, "aaa", {{kFont}}, {10}, {});
+        a.expect_eq(glyphs.calls, 1);
+        a.expect_eq(atlas.stats(), gfx::GlyphAtlasStats{.hits = 2, .misses = 1});
+
+        // Different sizes, styles, and fonts are different glyphs.
+        std::ignore = atlas.layout({}, "a", {{kFont}}, {11}, {});
+        std::ignore = atlas.layout({}, "a", {{kFont}}, {10}, {.bold = true});
+        std::ignore = atlas.layout({}, "a", {{gfx::Font{"other"}}}, {10}, {});
+        a.expect_eq(glyphs.calls, 4);
+
+        std::ignore = atlas.layout({}, "a", {{kFont}}, {10}, {});
+        a.expect_eq(glyphs.calls, 4);
+        a.expect_eq(atlas.stats().hit_rate(), 3. / 7.);
+    });
+
+    s.add_test("least recently used page is evicted", [](etest::IActions &a) {
+        BlockGlyphs glyphs;
+        // 2 glyphs per page.
+        gfx::GlyphAtlas atlas{glyphs, {.page_size = 8, .max_pages = 2}};
+
+        std::ignore = atlas.layout({}, "abcd", {{kFont}}, {10}, {});
+        atlas.unpin();
+        a.expect_eq(atlas.page_count(), std::size_t{2});
+        auto const generation = atlas.page_generation(0);
+
+        // Touching the first page makes the second one the eviction candidate.
+        a.expect_eq(atlas.glyph({{kFont}}, {10}, {}, U'a').page, std::size_t{0});
+        atlas.unpin();
+        a.expect_eq(atlas.glyph({{kFont}}, {10}, {}, U'e').page, std::size_t{1});
+        a.expect_eq(atlas.stats().evictions, std::size_t{1});
+        a.expect_eq(atlas.page_count(), std::size_t{2});
+        a.expect_eq(atlas.page_generation(0), generation);
+
+        // c and d have to be rasterized again.
+        auto const calls = glyphs.calls;
+        std::ignore = atlas.glyph({{kFont}}, {10}, {}, U'a');
+        std::ignore = atlas.glyph({{kFont}}, {10}, {}, U'c');
+        a.expect_eq(glyphs.calls, calls + 1);
+    });
+
+    s.add_test("pinned pages aren't evicted", [](etest::IActions &a) {
+        BlockGlyphs glyphs;
+        gfx::GlyphAtlas atlas{glyphs, {.page_size = 8, .max_pages = 2}};
+
+        auto run = atlas.layout({}, "abcdef", {{kFont}}, {10}, {});
+        a.expect_eq(atlas.page_count(), std::size_t{3});
+        a.expect_eq(atlas.stats().evictions, std::size_t{0});
+        a.expect_eq(run.quads.size(), std::size_t{6});
+        a.expect_eq(run.quads[5].page, std::size_t{2});
+
+        // Once unpinned, pages are reused again.
+        atlas.unpin();
+        std::ignore = atlas.glyph({{kFont}}, {10}, {}, U'g');
+        a.expect_eq(atlas.page_count(), std::size_t{3});
+        a.expect_eq(atlas.stats().evictions, std::size_t{1});
+    });
+
+    return s.run();
+}
@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef GFX_IGLYPH_RASTERIZER_H_
+#define GFX_IGLYPH_RASTERIZER_H_
+
+#include "gfx/font.h"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace gfx {
+
+// An 8-bit coverage mask for a single codepoint.
+struct Glyph {
+    // Offset from the pen position to the top-left corner of the bitmap. The
+    // pen is at the top of the line box, like the position passed to draw_text.
+    int x_offset{};
+    int y_offset{};
+    int width{};
+    int height{};
+    // How far to move the pen after drawing this glyph.
+    int advance{};
+    std::vector<std::uint8_t> coverage{};
+
+    [[nodiscard]] bool operator==(Glyph const &) const = default;
+};
+
+class IGlyphRasterizer {
+public:
+    virtual ~IGlyphRasterizer() = default;
+
+    // Rasterizes the codepoint using the first font that can be loaded. This
+    // may be called from several threads at once.
+    [[nodiscard]] virtual std::optional<Glyph> rasterize(
+            std::span<Font const>, FontSize, FontStyle, char32_t codepoint) const = 0;
+};
+
+} // namespace gfx
+
+#endif
@@ -5,8 +5,12 @@
 #include "gfx/opengl_canvas.h"
 
 #include "gfx/color.h"
+#include "gfx/font.h"
+#include "gfx/glyph_atlas.h"
 #include "gfx/icanvas.h"
+#include "gfx/iglyph_rasterizer.h"
 #include "gfx/opengl_shader.h"
+#include "gfx/rect_batch.h"
 
 #include "geom/geom.h"
 
@@ -14,97 +18,275 @@
 
 #include <array>
 #include <cassert>
+#include <cstddef>
+#include <span>
+#include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 namespace gfx {
 namespace {
-#include "gfx/basic_vertex_shader.h"
+#include "gfx/rect_batch_vertex_shader.h"
 #include "gfx/rect_fragment_shader.h"
+#include "gfx/text_batch_vertex_shader.h"
+#include "gfx/text_fragment_shader.h"
+
+std::string_view const rect_vertex_shader{
+        reinterpret_cast<char const *>(gfx_rect_batch_shader_vert), gfx_rect_batch_shader_vert_len};
+std::string_view const rect_fragment_shader{
+        reinterpret_cast<char const *>(gfx_rect_shader_frag), gfx_rect_shader_frag_len};
+std::string_view const text_vertex_shader{
+        reinterpret_cast<char const *>(gfx_text_batch_shader_vert), gfx_text_batch_shader_vert_len};
+std::string_view const text_fragment_shader{
+        reinterpret_cast<char const *>(gfx_text_shader_frag), gfx_text_shader_frag_len};
+
+// rect_shader.frag is shared w/ the non-batched SFML canvas, so the batching
+// bits are opted into here.
+constexpr std::string_view kBatchFragmentShaderPrefix = "#version 140\n#define RECT_BATCH\n";
+
+std::string rect_batch_vertex_shader_source() {
+    return "#version 140\n#define VEC4S_PER_INSTANCE " + std::to_string(RectBatch::kVec4sPerInstance) + "\n"
+            + std::string{rect_vertex_shader};
+}
+
+constexpr std::size_t kTexelsPerGlyph = 3;
+
+OpenGLShader create_shader(std::string_view vertex_src, std::string_view fragment_src) {
+    auto shader = OpenGLShader::create(vertex_src, fragment_src);
+    assert(shader.has_value());
+    return std::move(shader).value();
+}
+
+std::array<float, 2> to_arr2(int a, int b) {
+    return {static_cast<float>(a), static_cast<float>(b)};
+}
+
+std::array<float, 4> to_color_arr(Color c) {
+    return {static_cast<float>(c.r) / 255.f,
+            static_cast<float>(c.g) / 255.f,
+            static_cast<float>(c.b) / 255.f,
+            static_cast<float>(c.a) / 255.f};
+}
+
+void append_edges(std::vector<float> &out, geom::Rect const &r) {
+    out.insert(out.end(),
+            {static_cast<float>(r.left()),
+                    static_cast<float>(r.top()),
+                    static_cast<float>(r.right()),
+                    static_cast<float>(r.bottom())});
+}
 
-std::string_view const vertex_shader{reinterpret_cast<char const *>(gfx_basic_shader_vert), gfx_basic_shader_vert_len};
-std::string_view const fragment_shader{reinterpret_cast<char const *>(gfx_rect_shader_frag), gfx_rect_shader_frag_len};
 } // namespace
 
-OpenGLCanvas::OpenGLCanvas()
-    : border_shader_{[] {
-          auto shader = OpenGLShader::create(vertex_shader, fragment_shader);
-          assert(shader.has_value());
-          return std::move(shader).value();
-      }()} {
+OpenGLCanvas::OpenGLCanvas(IGlyphRasterizer const *glyphs)
+    : rect_shader_{create_shader(rect_batch_vertex_shader_source(),
+              std::string{kBatchFragmentShaderPrefix} + std::string{rect_fragment_shader})},
+      text_shader_{create_shader(text_vertex_shader, text_fragment_shader)} {
+    if (glyphs != nullptr) {
+        atlas_.emplace(*glyphs);
+    }
+
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Everything the shaders need is fetched from the instance buffer, so no
+    // vertex attributes are set up, but a vertex array still has to be bound
+    // when drawing.
+    glGenVertexArrays(1, &vertex_array_);
+
+    glGenBuffers(1, &instance_buffer_);
+    glBindBuffer(GL_TEXTURE_BUFFER, instance_buffer_);
+    glGenTextures(1, &instance_texture_);
+    glBindTexture(GL_TEXTURE_BUFFER, instance_texture_);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instance_buffer_);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    GLint max_texels{};
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    max_instance_texels_ = static_cast<std::size_t>(max_texels);
+}
+
+OpenGLCanvas::~OpenGLCanvas() {
+    for (auto const &page : page_textures_) {
+        glDeleteTextures(1, &page.id);
+    }
+    glDeleteTextures(1, &instance_texture_);
+    glDeleteBuffers(1, &instance_buffer_);
+    glDeleteVertexArrays(1, &vertex_array_);
 }
 
 void OpenGLCanvas::set_viewport_size(int width, int height) {
+    // Anything batched was meant for the old viewport.
+    flush();
     size_x_ = width;
     size_y_ = height;
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0, width, height, 0, -1.0, 1.0);
     glViewport(0, 0, width, height);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
 }
 
 void OpenGLCanvas::clear(Color c) {
+    // Anything batched would be cleared away right after being drawn.
+    rect_batch_.clear();
+    text_batch_.clear();
+    if (atlas_) {
+        atlas_->unpin();
+    }
+
     glClearColor(c.r / 255.f, c.g / 255.f, c.b / 255.f, c.a / 255.f);
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
 void OpenGLCanvas::fill_rect(geom::Rect const &rect, Color color) {
+    make_room_for_rect();
     auto translated{rect.translated(translation_x_, translation_y_)};
-    auto scaled{translated.scaled(scale_)};
-    glColor4ub(color.r, color.g, color.b, color.a);
-    glRecti(scaled.x, scaled.y, scaled.x + scaled.width, scaled.y + scaled.height);
+    rect_batch_.add(translated.scaled(scale_), color);
 }
 
 void OpenGLCanvas::draw_rect(
         geom::Rect const &rect, Color const &color, Borders const &borders, Corners const &corners) {
+    make_room_for_rect();
     auto translated{rect.translated(translation_x_, translation_y_)};
-    auto inner_rect{translated.scaled(scale_)};
-    auto outer_rect{
-            inner_rect.expanded({borders.left.size, borders.right.size, borders.top.size, borders.bottom.size})};
-
-    static constexpr auto kToArr2 = [](int a, int b) {
-        return std::array<float, 2>{static_cast<float>(a), static_cast<float>(b)};
-    };
-
-    static constexpr auto kToColorArr = [](gfx::Color c) {
-        return std::array<float, 4>{static_cast<float>(c.r) / 255.f,
-                static_cast<float>(c.g) / 255.f,
-                static_cast<float>(c.b) / 255.f,
-                static_cast<float>(c.a) / 255.f};
-    };
-
-    border_shader_.enable();
-    border_shader_.set_uniform("resolution", kToArr2(size_x_, size_y_));
-
-    border_shader_.set_uniform("inner_top_left", kToArr2(inner_rect.left(), inner_rect.top()));
-    border_shader_.set_uniform("inner_top_right", kToArr2(inner_rect.right(), inner_rect.top()));
-    border_shader_.set_uniform("inner_bottom_left", kToArr2(inner_rect.left(), inner_rect.bottom()));
-    border_shader_.set_uniform("inner_bottom_right", kToArr2(inner_rect.right(), inner_rect.bottom()));
-
-    border_shader_.set_uniform("outer_top_left", kToArr2(outer_rect.left(), outer_rect.top()));
-    border_shader_.set_uniform("outer_top_right", kToArr2(outer_rect.right(), outer_rect.top()));
-    border_shader_.set_uniform("outer_bottom_left", kToArr2(outer_rect.left(), outer_rect.bottom()));
-    border_shader_.set_uniform("outer_bottom_right", kToArr2(outer_rect.right(), outer_rect.bottom()));
-
-    border_shader_.set_uniform("top_left_radii", kToArr2(corners.top_left.horizontal, corners.top_left.vertical));
-    border_shader_.set_uniform("top_right_radii", kToArr2(corners.top_right.horizontal, corners.top_right.vertical));
-    border_shader_.set_uniform(
-            "bottom_left_radii", kToArr2(corners.bottom_left.horizontal, corners.bottom_left.vertical));
-    border_shader_.set_uniform(
-            "bottom_right_radii", kToArr2(corners.bottom_right.horizontal, corners.bottom_right.vertical));
-
-    border_shader_.set_uniform("left_border_color", kToColorArr(borders.left.color));
-    border_shader_.set_uniform("right_border_color", kToColorArr(borders.right.color));
-    border_shader_.set_uniform("top_border_color", kToColorArr(borders.top.color));
-    border_shader_.set_uniform("bottom_border_color", kToColorArr(borders.bottom.color));
-    border_shader_.set_uniform("inner_rect_color", kToColorArr(color));
-
-    glRecti(outer_rect.left(), outer_rect.top(), outer_rect.right(), outer_rect.bottom());
-    border_shader_.disable();
+    rect_batch_.add(translated.scaled(scale_), color, borders, corners);
+}
+
+void OpenGLCanvas::draw_text(geom::Position p,
+        std::string_view text,
+        std::span<Font const> fonts,
+        FontSize size,
+        FontStyle style,
+        Color color) {
+    if (!atlas_ || color.a == 0) {
+        return;
+    }
+
+    flush_rects();
+    p = p.translated(translation_x_, translation_y_).scaled(scale_);
+    size.px *= scale_;
+
+    auto const run = atlas_->layout(p, text, fonts, size, style);
+    auto const rgba = to_color_arr(color);
+    for (auto const &quad : run.quads) {
+        // Each batch of glyphs is drawn from a single atlas page.
+        if (quad.page != text_batch_page_ || text_batch_.size() / 4 + kTexelsPerGlyph > max_instance_texels_) {
+            flush_text();
+            text_batch_page_ = quad.page;
+        }
+
+        append_edges(text_batch_, quad.dst);
+        append_edges(text_batch_, quad.src);
+        text_batch_.insert(text_batch_.end(), rgba.begin(), rgba.end());
+    }
+
+    for (auto const &decoration : run.decorations) {
+        make_room_for_rect();
+        rect_batch_.add(decoration, color);
+    }
+}
+
+void OpenGLCanvas::draw_text(
+        geom::Position p, std::string_view text, Font font, FontSize size, FontStyle style, Color color) {
+    draw_text(p, text, std::span<Font const>{{font}}, size, style, color);
+}
+
+void OpenGLCanvas::flush() {
+    // At most one of these will have anything in it.
+    flush_rects();
+    flush_text();
+}
+
+void OpenGLCanvas::make_room_for_rect() {
+    // Text has to be drawn first so that things are drawn in the right order.
+    flush_text();
+    if ((rect_batch_.size() + 1) * RectBatch::kVec4sPerInstance > max_instance_texels_) {
+        flush_rects();
+    }
+}
+
+void OpenGLCanvas::flush_rects() {
+    if (rect_batch_.empty()) {
+        return;
+    }
+
+    upload_instances(rect_batch_.data());
+    rect_shader_.enable();
+    rect_shader_.set_uniform("resolution", to_arr2(size_x_, size_y_));
+    rect_shader_.set_uniform("rects", 0);
+
+    glBindVertexArray(vertex_array_);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(rect_batch_.size()));
+    glBindVertexArray(0);
+
+    rect_shader_.disable();
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    rect_batch_.clear();
+}
+
+void OpenGLCanvas::flush_text() {
+    if (text_batch_.empty()) {
+        return;
+    }
+
+    assert(atlas_.has_value());
+    if (page_textures_.size() <= text_batch_page_) {
+        page_textures_.resize(text_batch_page_ + 1);
+    }
+
+    // Upload the atlas page if it's new or has changed since it was last used.
+    auto &page = page_textures_[text_batch_page_];
+    auto const generation = atlas_->page_generation(text_batch_page_);
+    auto const page_size = atlas_->page_size();
+    glActiveTexture(GL_TEXTURE1);
+    bool const is_new = page.id == 0;
+    if (is_new) {
+        glGenTextures(1, &page.id);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, page.id);
+    if (is_new || page.generation != generation) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D,
+                0,
+                GL_R8,
+                page_size,
+                page_size,
+                0,
+                GL_RED,
+                GL_UNSIGNED_BYTE,
+                atlas_->page(text_batch_page_).data());
+        page.generation = generation;
+    }
+
+    upload_instances(text_batch_);
+    text_shader_.enable();
+    text_shader_.set_uniform("resolution", to_arr2(size_x_, size_y_));
+    text_shader_.set_uniform("glyphs", 0);
+    text_shader_.set_uniform("page", 1);
+
+    glBindVertexArray(vertex_array_);
+    auto const glyphs = text_batch_.size() / 4 / kTexelsPerGlyph;
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(glyphs));
+    glBindVertexArray(0);
+
+    text_shader_.disable();
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    text_batch_.clear();
+
+    // Nothing references the atlas anymore.
+    atlas_->unpin();
+}
+
+void OpenGLCanvas::upload_instances(std::span<float const> data) {
+    glBindBuffer(GL_TEXTURE_BUFFER, instance_buffer_);
+    glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(data.size_bytes()), data.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, instance_texture_);
 }
 
 } // namespace gfx
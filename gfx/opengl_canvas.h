@@ -1,4 +1,4 @@
-// SPDX-FileCopyrightText: 2021-2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2021-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
@@ -9,19 +9,34 @@
 
 #include "gfx/color.h"
 #include "gfx/font.h"
+#include "gfx/glyph_atlas.h"
 #include "gfx/icanvas.h"
+#include "gfx/iglyph_rasterizer.h"
+#include "gfx/rect_batch.h"
 
 #include "geom/geom.h"
 
+#include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <span>
 #include <string_view>
+#include <vector>
 
 namespace gfx {
 
+// Rects and glyphs are collected into batches that are drawn using a single
+// instanced draw call when flush() is called, or when something forces the
+// batch to be drawn early, like switching between drawing rects and text, the
+// viewport size changing, or the batch growing too large.
 class OpenGLCanvas final : public ICanvas {
 public:
-    OpenGLCanvas();
+    // Text isn't drawn unless a glyph rasterizer is provided.
+    explicit OpenGLCanvas(IGlyphRasterizer const *glyphs = nullptr);
+    ~OpenGLCanvas() override;
+
+    OpenGLCanvas(OpenGLCanvas const &) = delete;
+    OpenGLCanvas &operator=(OpenGLCanvas const &) = delete;
 
     void set_viewport_size(int width, int height) override;
     constexpr void set_scale(int scale) override { scale_ = scale; }
@@ -34,12 +49,44 @@ public:
     void clear(Color) override;
     void fill_rect(geom::Rect const &, Color) override;
     void draw_rect(geom::Rect const &, Color const &, Borders const &, Corners const &) override;
-    void draw_text(geom::Position, std::string_view, std::span<Font const>, FontSize, FontStyle, Color) override {}
-    void draw_text(geom::Position, std::string_view, Font, FontSize, FontStyle, Color) override {}
+    void draw_text(geom::Position, std::string_view, std::span<Font const>, FontSize, FontStyle, Color) override;
+    void draw_text(geom::Position, std::string_view, Font, FontSize, FontStyle, Color) override;
     void draw_pixels(geom::Rect const &, std::span<std::uint8_t const>) override {}
 
+    // Draws everything that's been batched up. Has to be called before the
+    // frame is presented.
+    void flush();
+
+    [[nodiscard]] GlyphAtlasStats glyph_stats() const { return atlas_ ? atlas_->stats() : GlyphAtlasStats{}; }
+
 private:
-    OpenGLShader border_shader_;
+    struct PageTexture {
+        std::uint32_t id{};
+        std::uint64_t generation{};
+    };
+
+    void make_room_for_rect();
+    void flush_rects();
+    void flush_text();
+    void upload_instances(std::span<float const>);
+
+    OpenGLShader rect_shader_;
+    OpenGLShader text_shader_;
+    RectBatch rect_batch_;
+
+    std::optional<GlyphAtlas> atlas_;
+    std::vector<PageTexture> page_textures_;
+    // Destination rect, source rect, and color for each glyph.
+    std::vector<float> text_batch_;
+    std::size_t text_batch_page_{};
+
+    // How many vec4s fit in the instance buffer.
+    std::size_t max_instance_texels_{};
+
+    // Really GLuints, see OpenGLShader.
+    std::uint32_t vertex_array_{};
+    std::uint32_t instance_buffer_{};
+    std::uint32_t instance_texture_{};
 
     int size_x_{};
     int size_y_{};
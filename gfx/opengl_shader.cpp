@@ -104,5 +104,11 @@ void OpenGLShader::set_uniform(char const *name, std::span<float const, 4> data)
     glUniform4f(loc, data[0], data[1], data[2], data[3]);
 }
 
+void OpenGLShader::set_uniform(char const *name, int data) {
+    auto loc = glGetUniformLocation(program_, name);
+    assert(loc != -1);
+    glUniform1i(loc, data);
+}
+
 } // namespace gfx
 // NOLINTEND(readability-make-member-function-const)
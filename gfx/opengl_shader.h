@@ -32,6 +32,7 @@ public:
     void disable();
     void set_uniform(char const *name, std::span<float const, 2>);
     void set_uniform(char const *name, std::span<float const, 4>);
+    void set_uniform(char const *name, int);
 
     std::uint32_t id() const { return program_; }
 
@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "gfx/rect_batch.h"
+
+#include "gfx/color.h"
+#include "gfx/icanvas.h"
+
+#include "geom/geom.h"
+
+#include <array>
+#include <span>
+#include <type_traits>
+
+namespace gfx {
+namespace {
+
+// The instance data is uploaded as-is, so there mustn't be any padding.
+static_assert(std::is_standard_layout_v<RectInstance>);
+static_assert(sizeof(RectInstance) == RectBatch::kVec4sPerInstance * 4 * sizeof(float));
+
+std::array<float, 4> to_edges(geom::Rect const &r) {
+    return {static_cast<float>(r.left()),
+            static_cast<float>(r.top()),
+            static_cast<float>(r.right()),
+            static_cast<float>(r.bottom())};
+}
+
+std::array<float, 4> to_radii(Radii const &a, Radii const &b) {
+    return {static_cast<float>(a.horizontal),
+            static_cast<float>(a.vertical),
+            static_cast<float>(b.horizontal),
+            static_cast<float>(b.vertical)};
+}
+
+std::array<float, 4> to_color(Color c) {
+    return {static_cast<float>(c.r) / 255.f,
+            static_cast<float>(c.g) / 255.f,
+            static_cast<float>(c.b) / 255.f,
+            static_cast<float>(c.a) / 255.f};
+}
+
+} // namespace
+
+void RectBatch::add(geom::Rect const &rect, Color color) {
+    auto edges = to_edges(rect);
+    auto c = to_color(color);
+    instances_.push_back(RectInstance{
+            .outer = edges,
+            .inner = edges,
+            .inner_color = c,
+            .top_color = c,
+            .right_color = c,
+            .bottom_color = c,
+            .left_color = c,
+    });
+}
+
+void RectBatch::add(geom::Rect const &rect, Color color, Borders const &borders, Corners const &corners) {
+    auto outer = rect.expanded({borders.left.size, borders.right.size, borders.top.size, borders.bottom.size});
+    instances_.push_back(RectInstance{
+            .outer = to_edges(outer),
+            .inner = to_edges(rect),
+            .top_radii = to_radii(corners.top_left, corners.top_right),
+            .bottom_radii = to_radii(corners.bottom_left, corners.bottom_right),
+            .inner_color = to_color(color),
+            .top_color = to_color(borders.top.color),
+            .right_color = to_color(borders.right.color),
+            .bottom_color = to_color(borders.bottom.color),
+            .left_color = to_color(borders.left.color),
+    });
+}
+
+std::span<float const> RectBatch::data() const {
+    return {reinterpret_cast<float const *>(instances_.data()), instances_.size() * kVec4sPerInstance * 4};
+}
+
+} // namespace gfx
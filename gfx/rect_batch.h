@@ -0,0 +1,64 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef GFX_RECT_BATCH_H_
+#define GFX_RECT_BATCH_H_
+
+#include "gfx/color.h"
+#include "gfx/icanvas.h"
+
+#include "geom/geom.h"
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace gfx {
+
+// Everything rect_shader.frag needs to draw one rect, laid out as the vec4s
+// the batched vertex shader fetches per instance.
+struct RectInstance {
+    // left, top, right, bottom
+    std::array<float, 4> outer{};
+    std::array<float, 4> inner{};
+    // top-left x, y, top-right x, y
+    std::array<float, 4> top_radii{};
+    // bottom-left x, y, bottom-right x, y
+    std::array<float, 4> bottom_radii{};
+    // Colors w/ each component in [0, 1].
+    std::array<float, 4> inner_color{};
+    std::array<float, 4> top_color{};
+    std::array<float, 4> right_color{};
+    std::array<float, 4> bottom_color{};
+    std::array<float, 4> left_color{};
+
+    [[nodiscard]] bool operator==(RectInstance const &) const = default;
+};
+
+// Accumulates rects so that they can be drawn using a single instanced draw
+// call instead of one draw call per rect. Knows nothing about OpenGL, so it's
+// testable w/o a GPU.
+class RectBatch {
+public:
+    static constexpr std::size_t kVec4sPerInstance = sizeof(RectInstance) / sizeof(std::array<float, 4>);
+
+    // The rect is expected to already be in viewport coordinates.
+    void add(geom::Rect const &, Color);
+    void add(geom::Rect const &, Color, Borders const &, Corners const &);
+
+    [[nodiscard]] bool empty() const { return instances_.empty(); }
+    [[nodiscard]] std::size_t size() const { return instances_.size(); }
+    [[nodiscard]] std::span<RectInstance const> instances() const { return instances_; }
+    [[nodiscard]] std::span<float const> data() const;
+
+    void clear() { instances_.clear(); }
+
+private:
+    std::vector<RectInstance> instances_;
+};
+
+} // namespace gfx
+
+#endif
@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+// The #version and VEC4S_PER_INSTANCE (gfx::RectBatch::kVec4sPerInstance) are
+// prepended by gfx::OpenGLCanvas so that they can't get out of sync w/ the C++.
+
+uniform vec2 resolution;
+
+// gfx::RectInstance, VEC4S_PER_INSTANCE texels per instance.
+uniform samplerBuffer rects;
+
+flat out vec2 inner_top_left;
+flat out vec2 inner_top_right;
+flat out vec2 inner_bottom_left;
+flat out vec2 inner_bottom_right;
+
+flat out vec2 outer_top_left;
+flat out vec2 outer_top_right;
+flat out vec2 outer_bottom_left;
+flat out vec2 outer_bottom_right;
+
+flat out vec2 top_left_radii;
+flat out vec2 top_right_radii;
+flat out vec2 bottom_left_radii;
+flat out vec2 bottom_right_radii;
+
+flat out vec4 left_border_color;
+flat out vec4 right_border_color;
+flat out vec4 top_border_color;
+flat out vec4 bottom_border_color;
+flat out vec4 inner_rect_color;
+
+void main() {
+    int base = gl_InstanceID * VEC4S_PER_INSTANCE;
+    vec4 outer = texelFetch(rects, base);
+    vec4 inner = texelFetch(rects, base + 1);
+    vec4 top_radii = texelFetch(rects, base + 2);
+    vec4 bottom_radii = texelFetch(rects, base + 3);
+    inner_rect_color = texelFetch(rects, base + 4);
+    top_border_color = texelFetch(rects, base + 5);
+    right_border_color = texelFetch(rects, base + 6);
+    bottom_border_color = texelFetch(rects, base + 7);
+    left_border_color = texelFetch(rects, base + 8);
+
+    inner_top_left = inner.xy;
+    inner_top_right = inner.zy;
+    inner_bottom_left = inner.xw;
+    inner_bottom_right = inner.zw;
+
+    outer_top_left = outer.xy;
+    outer_top_right = outer.zy;
+    outer_bottom_left = outer.xw;
+    outer_bottom_right = outer.zw;
+
+    top_left_radii = top_radii.xy;
+    top_right_radii = top_radii.zw;
+    bottom_left_radii = bottom_radii.xy;
+    bottom_right_radii = bottom_radii.zw;
+
+    // The rect is drawn as a triangle strip w/ 4 vertices covering the outer rect.
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    vec2 pos = mix(outer.xy, outer.zw, corner);
+    gl_Position = vec4(pos.x / resolution.x * 2.0 - 1.0, 1.0 - pos.y / resolution.y * 2.0, 0.0, 1.0);
+}
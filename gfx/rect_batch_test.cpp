@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "gfx/rect_batch.h"
+
+#include "gfx/color.h"
+#include "gfx/icanvas.h"
+
+#include "etest/etest2.h"
+
+#include <array>
+#include <cstddef>
+
+int main() {
+    etest::Suite s{"gfx/rect_batch"};
+
+    s.add_test("empty", [](etest::IActions &a) {
+        gfx::RectBatch batch;
+        a.expect(batch.empty());
+        a.expect_eq(batch.size(), std::size_t{0});
+        a.expect(batch.data().empty());
+    });
+
+    s.add_test("filled rect", [](etest::IActions &a) {
+        gfx::RectBatch batch;
+        batch.add({10, 20, 30, 40}, gfx::Color{0xFF, 0, 0xFF, 0});
+
+        std::array<float, 4> const edges{10.f, 20.f, 40.f, 60.f};
+        std::array<float, 4> const color{1.f, 0.f, 1.f, 0.f};
+        a.expect_eq(batch.size(), std::size_t{1});
+        a.expect_eq(batch.instances()[0],
+                gfx::RectInstance{
+                        .outer = edges,
+                        .inner = edges,
+                        .inner_color = color,
+                        .top_color = color,
+                        .right_color = color,
+                        .bottom_color = color,
+                        .left_color = color,
+                });
+    });
+
+    s.add_test("bordered rect", [](etest::IActions &a) {
+        gfx::RectBatch batch;
+        gfx::Borders borders{
+                .left{{0xFF, 0, 0}, 1},
+                .right{{0, 0xFF, 0}, 2},
+                .top{{0, 0, 0xFF}, 3},
+                .bottom{{0, 0, 0}, 4},
+        };
+        gfx::Corners corners{.top_left{1, 2}, .top_right{3, 4}, .bottom_left{5, 6}, .bottom_right{7, 8}};
+        batch.add({10, 10, 10, 10}, gfx::Color{0xFF, 0xFF, 0xFF}, borders, corners);
+
+        a.expect_eq(batch.instances()[0],
+                gfx::RectInstance{
+                        .outer{9.f, 7.f, 22.f, 24.f},
+                        .inner{10.f, 10.f, 20.f, 20.f},
+                        .top_radii{1.f, 2.f, 3.f, 4.f},
+                        .bottom_radii{5.f, 6.f, 7.f, 8.f},
+                        .inner_color{1.f, 1.f, 1.f, 1.f},
+                        .top_color{0.f, 0.f, 1.f, 1.f},
+                        .right_color{0.f, 1.f, 0.f, 1.f},
+                        .bottom_color{0.f, 0.f, 0.f, 1.f},
+                        .left_color{1.f, 0.f, 0.f, 1.f},
+                });
+    });
+
+    s.add_test("many rects, one batch", [](etest::IActions &a) {
+        gfx::RectBatch batch;
+        for (int i = 0; i < 1000; ++i) {
+            batch.add({i, i, 1, 1}, gfx::Color{});
+        }
+
+        a.expect_eq(batch.size(), std::size_t{1000});
+        a.expect_eq(batch.data().size(), 1000 * gfx::RectBatch::kVec4sPerInstance * 4);
+        // The data is laid out instance after instance.
+        auto data = batch.data();
+        auto const stride = gfx::RectBatch::kVec4sPerInstance * 4;
+        a.expect_eq(data[999 * stride], 999.f);
+        a.expect_eq(data[999 * stride + 2], 1000.f);
+
+        batch.clear();
+        a.expect(batch.empty());
+        a.expect(batch.data().empty());
+    });
+
+    return s.run();
+}
@@ -4,30 +4,38 @@
 
 uniform vec2 resolution;
 
+// When drawing batches of rects, the per-rect values are passed along from
+// rect_batch_shader.vert instead of being set as uniforms.
+#ifdef RECT_BATCH
+#define RECT_INPUT flat in
+#else
+#define RECT_INPUT uniform
+#endif
+
 // Corner position, inner rectangle
-uniform vec2 inner_top_left;
-uniform vec2 inner_top_right;
-uniform vec2 inner_bottom_left;
-uniform vec2 inner_bottom_right;
+RECT_INPUT vec2 inner_top_left;
+RECT_INPUT vec2 inner_top_right;
+RECT_INPUT vec2 inner_bottom_left;
+RECT_INPUT vec2 inner_bottom_right;
 
 // Corner position, outer rectangle
-uniform vec2 outer_top_left;
-uniform vec2 outer_top_right;
-uniform vec2 outer_bottom_left;
-uniform vec2 outer_bottom_right;
+RECT_INPUT vec2 outer_top_left;
+RECT_INPUT vec2 outer_top_right;
+RECT_INPUT vec2 outer_bottom_left;
+RECT_INPUT vec2 outer_bottom_right;
 
 // Corner radii of outer rectangle
-uniform vec2 top_left_radii;
-uniform vec2 top_right_radii;
-uniform vec2 bottom_left_radii;
-uniform vec2 bottom_right_radii;
+RECT_INPUT vec2 top_left_radii;
+RECT_INPUT vec2 top_right_radii;
+RECT_INPUT vec2 bottom_left_radii;
+RECT_INPUT vec2 bottom_right_radii;
 
 // Colors
-uniform vec4 left_border_color;
-uniform vec4 right_border_color;
-uniform vec4 top_border_color;
-uniform vec4 bottom_border_color;
-uniform vec4 inner_rect_color;
+RECT_INPUT vec4 left_border_color;
+RECT_INPUT vec4 right_border_color;
+RECT_INPUT vec4 top_border_color;
+RECT_INPUT vec4 bottom_border_color;
+RECT_INPUT vec4 inner_rect_color;
 
 // Gets the position of the fragment in screen coordinates
 vec2 get_frag_pos() {
@@ -155,7 +163,7 @@ void main() {
 
         // Adjust position for corners of inner rectangle with respect to the max radius
         // This is needed to get a good transition between colors
-        vec2 inner_top_left_inward = top_left_inward_pos(inner_top_left, max_inner_bottom_left_radii);
+        vec2 inner_top_left_inward = top_left_inward_pos(inner_top_left, max_inner_top_left_radii);
         vec2 inner_top_right_inward = top_right_inward_pos(inner_top_right, max_inner_top_right_radii);
         vec2 inner_bottom_left_inward = bottom_left_inward_pos(inner_bottom_left, max_inner_bottom_left_radii);
         vec2 inner_bottom_right_inward = bottom_right_inward_pos(inner_bottom_right, max_inner_bottom_right_radii);
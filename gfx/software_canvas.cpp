@@ -0,0 +1,459 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "gfx/software_canvas.h"
+
+#include "gfx/color.h"
+#include "gfx/font.h"
+#include "gfx/glyph_atlas.h"
+#include "gfx/icanvas.h"
+#include "img/pixel_kernels.h"
+#include "img/png.h"
+
+#include "geom/geom.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GFX_SOFTWARE_CANVAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace gfx {
+namespace {
+
+// Packs a color so that its in-memory representation is RGBA regardless of
+// the host's endianness.
+constexpr std::uint32_t pack(Color c) {
+    return std::bit_cast<std::uint32_t>(std::array<std::uint8_t, 4>{c.r, c.g, c.b, c.a});
+}
+
+constexpr Color unpack(std::uint32_t pixel) {
+    auto bytes = std::bit_cast<std::array<std::uint8_t, 4>>(pixel);
+    return {bytes[0], bytes[1], bytes[2], bytes[3]};
+}
+
+// Exact rounded division by 255 for values up to 255 * 255.
+constexpr std::uint8_t div255(unsigned v) {
+    v += 128;
+    return static_cast<std::uint8_t>((v + (v >> 8)) >> 8);
+}
+
+static_assert(div255(255 * 255) == 255);
+static_assert(div255(127) == 0);
+static_assert(div255(128) == 1);
+
+constexpr Color premultiplied(Color c) {
+    return {div255(unsigned{c.r} * c.a), div255(unsigned{c.g} * c.a), div255(unsigned{c.b} * c.a), c.a};
+}
+
+// Source-over blending of a non-premultiplied color onto the premultiplied
+// destination.
+constexpr std::uint32_t blend(std::uint32_t dst, Color src) {
+    auto const d = std::bit_cast<std::array<std::uint8_t, 4>>(dst);
+    unsigned const a = src.a;
+    unsigned const inv = 255 - a;
+    return std::bit_cast<std::uint32_t>(std::array<std::uint8_t, 4>{
+            div255(src.r * a + d[0] * inv),
+            div255(src.g * a + d[1] * inv),
+            div255(src.b * a + d[2] * inv),
+            div255(255 * a + d[3] * inv),
+    });
+}
+
+void blend_span(std::uint32_t *dst, std::size_t count, Color src) {
+    std::size_t i = 0;
+#ifdef GFX_SOFTWARE_CANVAS_SSE2
+    // Every 16-bit lane holds s * a + d * (255 - a) + 128, which is at most
+    // 255 * 255 + 128 and fits without overflow.
+    static constexpr auto kLane = [](unsigned v) {
+        return static_cast<short>(static_cast<std::uint16_t>(v + 128));
+    };
+    unsigned const a = src.a;
+    auto const s = _mm_set_epi16(kLane(255 * a),
+            kLane(src.b * a),
+            kLane(src.g * a),
+            kLane(src.r * a),
+            kLane(255 * a),
+            kLane(src.b * a),
+            kLane(src.g * a),
+            kLane(src.r * a));
+    auto const inv = _mm_set1_epi16(static_cast<short>(255 - a));
+    auto const zero = _mm_setzero_si128();
+
+    auto blend_lanes = [&](__m128i d) {
+        auto v = _mm_add_epi16(_mm_mullo_epi16(d, inv), s);
+        return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+    };
+
+    for (; i + 4 <= count; i += 4) {
+        auto *p = reinterpret_cast<__m128i *>(dst + i);
+        auto const d = _mm_loadu_si128(p);
+        auto const lo = blend_lanes(_mm_unpacklo_epi8(d, zero));
+        auto const hi = blend_lanes(_mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        dst[i] = blend(dst[i], src);
+    }
+}
+
+struct Point {
+    float x{};
+    float y{};
+};
+
+// z-component of the cross product of (a - o) and (b - o).
+constexpr float cross(Point o, Point a, Point b) {
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+// Matches is_point_inside_quadrilateral in rect_shader.frag.
+constexpr bool is_inside_quadrilateral(Point p, Point a, Point b, Point c, Point d) {
+    return cross(a, p, b) * cross(d, p, c) <= 0.f && cross(a, p, d) * cross(b, p, c) <= 0.f;
+}
+
+struct CornerRadii {
+    float x{};
+    float y{};
+
+    [[nodiscard]] constexpr bool is_rounded() const { return x > 0.f && y > 0.f; }
+    [[nodiscard]] constexpr float max() const { return std::max(x, y); }
+};
+
+constexpr bool is_inside_ellipse(Point p, Point origin, CornerRadii r) {
+    auto dx = (p.x - origin.x) / r.x;
+    auto dy = (p.y - origin.y) / r.y;
+    return dx * dx + dy * dy <= 1.f;
+}
+
+struct RoundedRect {
+    Point top_left{};
+    Point top_right{};
+    Point bottom_left{};
+    Point bottom_right{};
+    CornerRadii top_left_radii{};
+    CornerRadii top_right_radii{};
+    CornerRadii bottom_left_radii{};
+    CornerRadii bottom_right_radii{};
+
+    // Matches is_inside_rounded_rect in rect_shader.frag, except that a corner
+    // with a zero radius in either direction is square as per CSS instead of
+    // dividing by zero.
+    [[nodiscard]] constexpr bool contains(Point p) const {
+        if (!is_inside_quadrilateral(p, top_left, top_right, bottom_right, bottom_left)) {
+            return false;
+        }
+
+        if (top_left_radii.is_rounded()) {
+            Point c{top_left.x + top_left_radii.x, top_left.y + top_left_radii.y};
+            if (p.x <= c.x && p.y <= c.y && !is_inside_ellipse(p, c, top_left_radii)) {
+                return false;
+            }
+        }
+
+        if (top_right_radii.is_rounded()) {
+            Point c{top_right.x - top_right_radii.x, top_right.y + top_right_radii.y};
+            if (p.x >= c.x && p.y <= c.y && !is_inside_ellipse(p, c, top_right_radii)) {
+                return false;
+            }
+        }
+
+        if (bottom_left_radii.is_rounded()) {
+            Point c{bottom_left.x + bottom_left_radii.x, bottom_left.y - bottom_left_radii.y};
+            if (p.x <= c.x && p.y >= c.y && !is_inside_ellipse(p, c, bottom_left_radii)) {
+                return false;
+            }
+        }
+
+        if (bottom_right_radii.is_rounded()) {
+            Point c{bottom_right.x - bottom_right_radii.x, bottom_right.y - bottom_right_radii.y};
+            if (p.x >= c.x && p.y >= c.y && !is_inside_ellipse(p, c, bottom_right_radii)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+constexpr Point to_point(int x, int y) {
+    return {static_cast<float>(x), static_cast<float>(y)};
+}
+
+constexpr CornerRadii to_radii(Radii r) {
+    return {static_cast<float>(r.horizontal), static_cast<float>(r.vertical)};
+}
+
+} // namespace
+
+void SoftwareCanvas::set_viewport_size(int width, int height) {
+    width_ = std::max(width, 0);
+    height_ = std::max(height, 0);
+    pixels_.assign(static_cast<std::size_t>(width_) * height_, 0);
+}
+
+void SoftwareCanvas::clear(Color c) {
+    std::ranges::fill(pixels_, pack(premultiplied(c)));
+}
+
+void SoftwareCanvas::fill_rect(geom::Rect const &rect, Color c) {
+    fill_clipped(to_device(rect), c);
+}
+
+void SoftwareCanvas::draw_rect(
+        geom::Rect const &rect, Color const &color, Borders const &borders, Corners const &corners) {
+    auto const inner = to_device(rect);
+    auto const outer = inner.expanded({borders.left.size, borders.right.size, borders.top.size, borders.bottom.size});
+
+    bool const has_borders = borders.left.size > 0 || borders.right.size > 0 || borders.top.size > 0
+            || borders.bottom.size > 0;
+    if (!has_borders && corners == Corners{}) {
+        fill_clipped(inner, color);
+        return;
+    }
+
+    RoundedRect const outer_shape{
+            .top_left = to_point(outer.left(), outer.top()),
+            .top_right = to_point(outer.right(), outer.top()),
+            .bottom_left = to_point(outer.left(), outer.bottom()),
+            .bottom_right = to_point(outer.right(), outer.bottom()),
+            .top_left_radii = to_radii(corners.top_left),
+            .top_right_radii = to_radii(corners.top_right),
+            .bottom_left_radii = to_radii(corners.bottom_left),
+            .bottom_right_radii = to_radii(corners.bottom_right),
+    };
+
+    auto const shrink = [](CornerRadii r, int dx, int dy) {
+        return CornerRadii{std::max(r.x - static_cast<float>(dx), 0.f), std::max(r.y - static_cast<float>(dy), 0.f)};
+    };
+    RoundedRect const inner_shape{
+            .top_left = to_point(inner.left(), inner.top()),
+            .top_right = to_point(inner.right(), inner.top()),
+            .bottom_left = to_point(inner.left(), inner.bottom()),
+            .bottom_right = to_point(inner.right(), inner.bottom()),
+            .top_left_radii = shrink(outer_shape.top_left_radii, borders.left.size, borders.top.size),
+            .top_right_radii = shrink(outer_shape.top_right_radii, borders.right.size, borders.top.size),
+            .bottom_left_radii = shrink(outer_shape.bottom_left_radii, borders.left.size, borders.bottom.size),
+            .bottom_right_radii = shrink(outer_shape.bottom_right_radii, borders.right.size, borders.bottom.size),
+    };
+
+    // The inner corners are moved inwards by their largest radius to get a
+    // good transition between the border colors.
+    auto const tl_in = inner_shape.top_left_radii.max();
+    auto const tr_in = inner_shape.top_right_radii.max();
+    auto const bl_in = inner_shape.bottom_left_radii.max();
+    auto const br_in = inner_shape.bottom_right_radii.max();
+    Point const inner_top_left{inner_shape.top_left.x + tl_in, inner_shape.top_left.y + tl_in};
+    Point const inner_top_right{inner_shape.top_right.x - tr_in, inner_shape.top_right.y + tr_in};
+    Point const inner_bottom_left{inner_shape.bottom_left.x + bl_in, inner_shape.bottom_left.y - bl_in};
+    Point const inner_bottom_right{inner_shape.bottom_right.x - br_in, inner_shape.bottom_right.y - br_in};
+
+    auto const color_at = [&](Point p) -> std::optional<Color> {
+        if (inner_shape.contains(p)) {
+            return color;
+        }
+
+        if (!outer_shape.contains(p)) {
+            return std::nullopt;
+        }
+
+        if (is_inside_quadrilateral(
+                    p, outer_shape.top_left, outer_shape.top_right, inner_top_right, inner_top_left)) {
+            return borders.top.color;
+        }
+
+        if (is_inside_quadrilateral(
+                    p, outer_shape.top_right, outer_shape.bottom_right, inner_bottom_right, inner_top_right)) {
+            return borders.right.color;
+        }
+
+        if (is_inside_quadrilateral(
+                    p, outer_shape.bottom_right, outer_shape.bottom_left, inner_bottom_left, inner_bottom_right)) {
+            return borders.bottom.color;
+        }
+
+        if (is_inside_quadrilateral(
+                    p, outer_shape.bottom_left, outer_shape.top_left, inner_top_left, inner_bottom_left)) {
+            return borders.left.color;
+        }
+
+        return std::nullopt;
+    };
+
+    auto const clipped = outer.intersected({0, 0, width_, height_});
+    if (clipped.empty()) {
+        return;
+    }
+
+    // Rows strictly between the inner corners have a straight run of inner
+    // color that can be filled without classifying each pixel.
+    auto const straight_top = inner_shape.top_left.y
+            + std::max(inner_shape.top_left_radii.y, inner_shape.top_right_radii.y);
+    auto const straight_bottom = inner_shape.bottom_left.y
+            - std::max(inner_shape.bottom_left_radii.y, inner_shape.bottom_right_radii.y);
+    auto const run_begin = std::clamp(inner.left(), clipped.left(), clipped.right());
+    auto const run_end = std::clamp(inner.right(), clipped.left(), clipped.right());
+    auto const color_pixel = pack(color);
+
+    for (int y = clipped.top(); y < clipped.bottom(); ++y) {
+        auto const center_y = static_cast<float>(y) + 0.5f;
+        bool const has_run = center_y > straight_top && center_y < straight_bottom && run_begin < run_end;
+
+        for (int x = clipped.left(); x < clipped.right(); ++x) {
+            if (has_run && x == run_begin) {
+                fill_span(run_begin, y, run_end - run_begin, color_pixel, color.a);
+                x = run_end - 1;
+                continue;
+            }
+
+            if (auto c = color_at({static_cast<float>(x) + 0.5f, center_y})) {
+                blend_pixel(x, y, *c);
+            }
+        }
+    }
+}
+
+void SoftwareCanvas::draw_text(geom::Position p,
+        std::string_view text,
+        std::span<Font const> fonts,
+        FontSize size,
+        FontStyle style,
+        Color color) {
+    if (!atlas_ || color.a == 0) {
+        return;
+    }
+
+    p = p.translated(tx_, ty_).scaled(scale_);
+    size.px *= scale_;
+
+    auto const run = atlas_->layout(p, text, fonts, size, style);
+    auto const page_size = static_cast<std::size_t>(atlas_->page_size());
+    for (auto const &quad : run.quads) {
+        auto const coverage = atlas_->page(quad.page);
+        auto const clipped = quad.dst.intersected({0, 0, width_, height_});
+        for (int y = clipped.top(); y < clipped.bottom(); ++y) {
+            auto const row = static_cast<std::size_t>(quad.src.y + y - quad.dst.y) * page_size;
+            for (int x = clipped.left(); x < clipped.right(); ++x) {
+                if (auto const cov = coverage[row + quad.src.x + x - quad.dst.x]; cov != 0) {
+                    auto c = color;
+                    c.a = div255(unsigned{color.a} * cov);
+                    blend_pixel(x, y, c);
+                }
+            }
+        }
+    }
+
+    // Everything's been drawn, so nothing has to be kept around.
+    atlas_->unpin();
+
+    for (auto const &decoration : run.decorations) {
+        fill_clipped(decoration, color);
+    }
+}
+
+void SoftwareCanvas::draw_text(
+        geom::Position p, std::string_view text, Font font, FontSize size, FontStyle style, Color color) {
+    draw_text(p, text, std::span<Font const>{{font}}, size, style, color);
+}
+
+// Unlike the other canvases, the image is scaled along with everything else
+// using nearest-neighbour sampling.
+void SoftwareCanvas::draw_pixels(geom::Rect const &rect, std::span<std::uint8_t const> rgba_data) {
+    if (rect.empty() || rgba_data.size() != static_cast<std::size_t>(rect.width) * rect.height * 4) {
+        return;
+    }
+
+    auto const dst = to_device(rect);
+    auto const clipped = dst.intersected({0, 0, width_, height_});
+    for (int y = clipped.top(); y < clipped.bottom(); ++y) {
+        auto const src_y = (y - dst.top()) / scale_;
+        auto const *src_row = rgba_data.data() + static_cast<std::size_t>(src_y) * rect.width * 4;
+        auto *dst_row = pixels_.data() + static_cast<std::size_t>(y) * width_;
+        for (int x = clipped.left(); x < clipped.right(); ++x) {
+            auto const *src = src_row + static_cast<std::size_t>((x - dst.left()) / scale_) * 4;
+            Color const c{src[0], src[1], src[2], src[3]};
+            if (c.a == 0xFF) {
+                dst_row[x] = pack(c);
+            } else if (c.a != 0) {
+                dst_row[x] = blend(dst_row[x], c);
+            }
+        }
+    }
+}
+
+Color SoftwareCanvas::pixel_at(int x, int y) const {
+    return unpack(pixels_[static_cast<std::size_t>(y) * width_ + x]);
+}
+
+bool SoftwareCanvas::write_png(std::ostream &os) const {
+    // PNGs store colors w/o premultiplied alpha.
+    std::vector<std::uint8_t> rgba(pixels().size());
+    img::pixels::unpremultiply(pixels(), rgba.data());
+    return img::Png::write(os, static_cast<std::uint32_t>(width_), static_cast<std::uint32_t>(height_), rgba);
+}
+
+void SoftwareCanvas::blit(SoftwareCanvas const &src, geom::Position p) {
+    auto const clipped = geom::Rect{p.x, p.y, src.width_, src.height_}.intersected({0, 0, width_, height_});
+    for (int y = clipped.top(); y < clipped.bottom(); ++y) {
+        auto const *src_row = src.pixels_.data() + static_cast<std::size_t>(y - p.y) * src.width_;
+        auto *dst_row = pixels_.data() + static_cast<std::size_t>(y) * width_;
+        std::copy_n(src_row + (clipped.left() - p.x), clipped.width, dst_row + clipped.left());
+    }
+}
+
+void SoftwareCanvas::fill_span(int x, int y, int length, std::uint32_t pixel, std::uint8_t alpha) {
+    auto *dst = pixels_.data() + static_cast<std::size_t>(y) * width_ + x;
+    if (alpha == 0xFF) {
+        std::fill_n(dst, length, pixel);
+    } else if (alpha != 0) {
+        blend_span(dst, static_cast<std::size_t>(length), unpack(pixel));
+    }
+}
+
+void SoftwareCanvas::fill_clipped(geom::Rect const &rect, Color c) {
+    auto const clipped = rect.intersected({0, 0, width_, height_});
+    if (clipped.empty() || c.a == 0) {
+        return;
+    }
+
+    auto const pixel = pack(c);
+    if (c.a == 0xFF && clipped.left() == 0 && clipped.width == width_) {
+        std::fill_n(pixels_.data() + static_cast<std::size_t>(clipped.top()) * width_,
+                static_cast<std::size_t>(clipped.width) * clipped.height,
+                pixel);
+        return;
+    }
+
+    for (int y = clipped.top(); y < clipped.bottom(); ++y) {
+        fill_span(clipped.left(), y, clipped.width, pixel, c.a);
+    }
+}
+
+void SoftwareCanvas::blend_pixel(int x, int y, Color c) {
+    auto &dst = pixels_[static_cast<std::size_t>(y) * width_ + x];
+    if (c.a == 0xFF) {
+        dst = pack(c);
+    } else if (c.a != 0) {
+        dst = blend(dst, c);
+    }
+}
+
+geom::Rect SoftwareCanvas::to_device(geom::Rect const &rect) const {
+    return rect.translated(tx_, ty_).scaled(scale_);
+}
+
+} // namespace gfx
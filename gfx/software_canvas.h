@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef GFX_SOFTWARE_CANVAS_H_
+#define GFX_SOFTWARE_CANVAS_H_
+
+#include "gfx/color.h"
+#include "gfx/font.h"
+#include "gfx/glyph_atlas.h"
+#include "gfx/icanvas.h"
+#include "gfx/iglyph_rasterizer.h"
+
+#include "geom/geom.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace gfx {
+
+// A canvas that rasterizes into an in-memory RGBA buffer without needing a
+// window or a GPU, e.g. for tests, screenshots, and headless rendering.
+class SoftwareCanvas final : public ICanvas {
+public:
+    // Text isn't drawn unless a glyph rasterizer is provided.
+    explicit SoftwareCanvas(IGlyphRasterizer const *glyphs = nullptr, GlyphAtlasOptions atlas_opts = {}) {
+        if (glyphs != nullptr) {
+            atlas_.emplace(*glyphs, atlas_opts);
+        }
+    }
+
+    void set_viewport_size(int width, int height) override;
+    void set_scale(int scale) override { scale_ = scale; }
+    void add_translation(int dx, int dy) override {
+        tx_ += dx;
+        ty_ += dy;
+    }
+    void clear(Color) override;
+    void fill_rect(geom::Rect const &, Color) override;
+    void draw_rect(geom::Rect const &, Color const &, Borders const &, Corners const &) override;
+    void draw_text(geom::Position, std::string_view, std::span<Font const>, FontSize, FontStyle, Color) override;
+    void draw_text(geom::Position, std::string_view, Font, FontSize, FontStyle, Color) override;
+    void draw_pixels(geom::Rect const &, std::span<std::uint8_t const> rgba_data) override;
+
+    [[nodiscard]] int width() const { return width_; }
+    [[nodiscard]] int height() const { return height_; }
+
+    // Pixels in row-major RGBA byte order. Colors are premultiplied by their
+    // alpha, which only matters if the canvas isn't cleared to an opaque color.
+    // The same goes for pixel_at.
+    [[nodiscard]] std::span<std::uint8_t const> pixels() const {
+        return {reinterpret_cast<std::uint8_t const *>(pixels_.data()), pixels_.size() * 4};
+    }
+    [[nodiscard]] Color pixel_at(int x, int y) const;
+
+    // PNGs don't use premultiplied alpha, so the colors are converted back.
+    [[nodiscard]] bool write_png(std::ostream &) const;
+
+    // Copies the pixels of another canvas as-is, without any blending, scaling,
+    // or translation.
+    void blit(SoftwareCanvas const &, geom::Position);
+
+    [[nodiscard]] GlyphAtlasStats glyph_stats() const { return atlas_ ? atlas_->stats() : GlyphAtlasStats{}; }
+
+private:
+    // Fills or blends a run of pixels in one row, already clipped to the canvas.
+    void fill_span(int x, int y, int length, std::uint32_t pixel, std::uint8_t alpha);
+    void fill_clipped(geom::Rect const &, Color);
+    void blend_pixel(int x, int y, Color);
+
+    [[nodiscard]] geom::Rect to_device(geom::Rect const &) const;
+
+    std::optional<GlyphAtlas> atlas_;
+
+    int width_{};
+    int height_{};
+    int scale_{1};
+    int tx_{};
+    int ty_{};
+    std::vector<std::uint32_t> pixels_;
+};
+
+} // namespace gfx
+
+#endif
@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "gfx/software_canvas.h"
+
+#include "gfx/color.h"
+#include "gfx/font.h"
+#include "gfx/freetype_glyph_rasterizer.h"
+#include "gfx/icanvas.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string_view>
+
+namespace {
+
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+constexpr int kIterations = 20;
+
+void run(std::string_view name, std::int64_t pixels_per_iteration, std::function<void()> const &draw) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        draw();
+    }
+    auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    auto mpix_per_second = static_cast<double>(pixels_per_iteration) * kIterations / duration.count() / 1e6;
+    std::cout << name << ": " << mpix_per_second << " Mpx/s\n";
+}
+
+} // namespace
+
+// Draws the kinds of things a page consists of into a 1080p software canvas
+// and reports the throughput. Pass a filename to save the result as a PNG.
+int main(int argc, char **argv) {
+    gfx::FreeTypeGlyphRasterizer glyphs;
+    gfx::SoftwareCanvas canvas{&glyphs};
+    canvas.set_viewport_size(kWidth, kHeight);
+
+    constexpr std::int64_t kScreen = std::int64_t{kWidth} * kHeight;
+    run("clear", kScreen, [&] { canvas.clear(gfx::Color{0xFF, 0xFF, 0xFF}); });
+    run("fill_rect, opaque", kScreen / 4, [&] { canvas.fill_rect({100, 100, kWidth / 2, kHeight / 2}, {0, 0x80, 0}); });
+    run("fill_rect, translucent", kScreen / 4, [&] {
+        canvas.fill_rect({300, 200, kWidth / 2, kHeight / 2}, {0, 0, 0xFF, 0x60});
+    });
+
+    gfx::Borders const borders{
+            .left{{0xFF, 0, 0}, 4},
+            .right{{0, 0xFF, 0}, 4},
+            .top{{0, 0, 0xFF}, 4},
+            .bottom{{0, 0, 0}, 4},
+    };
+    gfx::Corners const corners{{20, 20}, {20, 20}, {20, 20}, {20, 20}};
+    run("draw_rect, bordered and rounded", std::int64_t{808} * 408, [&] {
+        canvas.draw_rect({500, 500, 800, 400}, {0xEE, 0xEE, 0xEE}, borders, corners);
+    });
+
+    static constexpr std::string_view kText = "The quick brown fox jumps over the lazy dog.";
+    static constexpr int kLines = 40;
+    run("draw_text", kLines * static_cast<std::int64_t>(kText.size()) * 16 * 16, [&] {
+        for (int line = 0; line < kLines; ++line) {
+            canvas.draw_text({10, 10 + line * 20}, kText, gfx::Font{"dejavusans"}, {16}, {}, {0, 0, 0});
+        }
+    });
+    std::cout << "glyph cache hit rate: " << canvas.glyph_stats().hit_rate() * 100. << "%\n";
+
+    if (argc > 1) {
+        std::ofstream os{argv[1], std::ios::binary};
+        if (!canvas.write_png(os)) {
+            std::cerr << "Unable to write " << argv[1] << '\n';
+            return 1;
+        }
+    }
+}
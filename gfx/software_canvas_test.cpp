@@ -0,0 +1,255 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "gfx/software_canvas.h"
+
+#include "gfx/color.h"
+#include "gfx/font.h"
+#include "gfx/icanvas.h"
+#include "gfx/iglyph_rasterizer.h"
+
+#include "etest/etest2.h"
+#include "img/png.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <vector>
+
+using gfx::Color;
+
+namespace {
+
+constexpr auto kWhite = Color{0xFF, 0xFF, 0xFF};
+constexpr auto kRed = Color{0xFF, 0, 0};
+constexpr auto kBlue = Color{0, 0, 0xFF};
+constexpr auto kTransparent = Color{0, 0, 0, 0};
+
+// Every glyph is a solid 2x3 block one pixel below the top of the line.
+class BlockGlyphs : public gfx::IGlyphRasterizer {
+public:
+    std::optional<gfx::Glyph> rasterize(
+            std::span<gfx::Font const>, gfx::FontSize, gfx::FontStyle, char32_t codepoint) const override {
+        ++calls;
+        if (codepoint == U' ') {
+            return gfx::Glyph{.advance = 3};
+        }
+
+        return gfx::Glyph{
+                .x_offset = 0,
+                .y_offset = 1,
+                .width = 2,
+                .height = 3,
+                .advance = 3,
+                .coverage = std::vector<std::uint8_t>(6, 0xFF),
+        };
+    }
+
+    mutable int calls{};
+};
+
+gfx::SoftwareCanvas make_canvas(int width, int height, gfx::IGlyphRasterizer const *glyphs = nullptr) {
+    gfx::SoftwareCanvas canvas{glyphs};
+    canvas.set_viewport_size(width, height);
+    canvas.clear(kWhite);
+    return canvas;
+}
+
+} // namespace
+
+int main() {
+    etest::Suite s{"gfx/software_canvas"};
+
+    s.add_test("viewport and clear", [](etest::IActions &a) {
+        gfx::SoftwareCanvas canvas;
+        canvas.set_viewport_size(3, 2);
+        a.expect_eq(canvas.width(), 3);
+        a.expect_eq(canvas.height(), 2);
+        a.expect_eq(canvas.pixels().size(), std::size_t{3 * 2 * 4});
+        a.expect_eq(canvas.pixel_at(2, 1), kTransparent);
+
+        canvas.clear(kRed);
+        a.expect_eq(canvas.pixel_at(0, 0), kRed);
+        a.expect_eq(canvas.pixel_at(2, 1), kRed);
+        a.expect_eq(canvas.pixels()[0], std::uint8_t{0xFF});
+        a.expect_eq(canvas.pixels()[1], std::uint8_t{0});
+        a.expect_eq(canvas.pixels()[3], std::uint8_t{0xFF});
+    });
+
+    s.add_test("clear, premultiplied alpha", [](etest::IActions &a) {
+        gfx::SoftwareCanvas canvas;
+        canvas.set_viewport_size(2, 2);
+        canvas.clear({0xFF, 0, 0, 0x80});
+        a.expect_eq(canvas.pixel_at(1, 1), Color{0x80, 0, 0, 0x80});
+
+        // Blending onto it gives the same result as blending straight colors.
+        canvas.fill_rect({0, 0, 1, 1}, {0, 0, 0xFF, 0x80});
+        a.expect_eq(canvas.pixel_at(0, 0), Color{0x40, 0, 0x80, 0xC0});
+    });
+
+    s.add_test("fill_rect, clipped", [](etest::IActions &a) {
+        auto canvas = make_canvas(4, 4);
+        canvas.fill_rect({2, -1, 10, 2}, kRed);
+        a.expect_eq(canvas.pixel_at(1, 0), kWhite);
+        a.expect_eq(canvas.pixel_at(2, 0), kRed);
+        a.expect_eq(canvas.pixel_at(3, 0), kRed);
+        a.expect_eq(canvas.pixel_at(3, 1), kWhite);
+
+        // Entirely outside the canvas.
+        canvas.fill_rect({-5, -5, 2, 2}, kBlue);
+        canvas.fill_rect({5, 5, 2, 2}, kBlue);
+        a.expect_eq(canvas.pixel_at(0, 0), kWhite);
+        a.expect_eq(canvas.pixel_at(3, 3), kWhite);
+    });
+
+    s.add_test("fill_rect, blending", [](etest::IActions &a) {
+        // Wide enough to exercise both the vectorized and the scalar tail.
+        auto canvas = make_canvas(7, 1);
+        canvas.fill_rect({0, 0, 7, 1}, {0, 0, 0, 0x80});
+        for (int x = 0; x < 7; ++x) {
+            a.expect_eq(canvas.pixel_at(x, 0), Color{0x7F, 0x7F, 0x7F, 0xFF});
+        }
+
+        canvas.fill_rect({0, 0, 7, 1}, kTransparent);
+        a.expect_eq(canvas.pixel_at(3, 0), Color{0x7F, 0x7F, 0x7F, 0xFF});
+
+        gfx::SoftwareCanvas transparent;
+        transparent.set_viewport_size(5, 1);
+        transparent.fill_rect({0, 0, 5, 1}, {0xFF, 0, 0, 0x40});
+        a.expect_eq(transparent.pixel_at(0, 0), Color{0x40, 0, 0, 0x40});
+        a.expect_eq(transparent.pixel_at(4, 0), Color{0x40, 0, 0, 0x40});
+    });
+
+    s.add_test("translation and scale", [](etest::IActions &a) {
+        auto canvas = make_canvas(8, 8);
+        canvas.set_scale(2);
+        canvas.add_translation(1, 1);
+        canvas.fill_rect({0, 0, 1, 1}, kRed);
+        a.expect_eq(canvas.pixel_at(1, 1), kWhite);
+        a.expect_eq(canvas.pixel_at(2, 2), kRed);
+        a.expect_eq(canvas.pixel_at(3, 3), kRed);
+        a.expect_eq(canvas.pixel_at(4, 4), kWhite);
+    });
+
+    s.add_test("draw_rect, borders", [](etest::IActions &a) {
+        auto canvas = make_canvas(10, 10);
+        gfx::Borders borders{
+                .left{kBlue, 1},
+                .right{kBlue, 1},
+                .top{kRed, 2},
+                .bottom{kRed, 1},
+        };
+        canvas.draw_rect({2, 3, 4, 4}, kTransparent, borders, {});
+
+        a.expect_eq(canvas.pixel_at(3, 1), kRed);
+        a.expect_eq(canvas.pixel_at(4, 2), kRed);
+        a.expect_eq(canvas.pixel_at(1, 5), kBlue);
+        a.expect_eq(canvas.pixel_at(6, 5), kBlue);
+        a.expect_eq(canvas.pixel_at(4, 7), kRed);
+        // The inner rect is transparent.
+        a.expect_eq(canvas.pixel_at(4, 5), kWhite);
+        // Outside of the rect.
+        a.expect_eq(canvas.pixel_at(0, 0), kWhite);
+        a.expect_eq(canvas.pixel_at(7, 5), kWhite);
+        a.expect_eq(canvas.pixel_at(4, 8), kWhite);
+    });
+
+    s.add_test("draw_rect, rounded corners", [](etest::IActions &a) {
+        auto canvas = make_canvas(10, 10);
+        gfx::Corners corners{
+                .top_left{4, 4},
+                .top_right{4, 4},
+                .bottom_left{4, 4},
+                .bottom_right{4, 4},
+        };
+        canvas.draw_rect({0, 0, 10, 10}, kRed, {}, corners);
+
+        a.expect_eq(canvas.pixel_at(0, 0), kWhite);
+        a.expect_eq(canvas.pixel_at(9, 0), kWhite);
+        a.expect_eq(canvas.pixel_at(0, 9), kWhite);
+        a.expect_eq(canvas.pixel_at(9, 9), kWhite);
+        a.expect_eq(canvas.pixel_at(5, 0), kRed);
+        a.expect_eq(canvas.pixel_at(0, 5), kRed);
+        a.expect_eq(canvas.pixel_at(5, 5), kRed);
+    });
+
+    s.add_test("draw_text", [](etest::IActions &a) {
+        BlockGlyphs glyphs;
+        auto canvas = make_canvas(12, 6, &glyphs);
+        canvas.draw_text({1, 0}, "aa a", gfx::Font{"arial"}, {10}, {}, kBlue);
+
+        // 'a' at x 1, 4, and 10 w/ a space in between.
+        a.expect_eq(canvas.pixel_at(1, 0), kWhite);
+        a.expect_eq(canvas.pixel_at(1, 1), kBlue);
+        a.expect_eq(canvas.pixel_at(2, 3), kBlue);
+        a.expect_eq(canvas.pixel_at(3, 2), kWhite);
+        a.expect_eq(canvas.pixel_at(4, 2), kBlue);
+        a.expect_eq(canvas.pixel_at(7, 2), kWhite);
+        a.expect_eq(canvas.pixel_at(10, 2), kBlue);
+        a.expect_eq(canvas.pixel_at(2, 4), kWhite);
+
+        // Each glyph is only rasterized once.
+        a.expect_eq(glyphs.calls, 2);
+        canvas.draw_text({0, 0}, "a", gfx::Font{"arial"}, {10}, {}, kRed);
+        a.expect_eq(glyphs.calls, 2);
+        canvas.draw_text({0, 0}, "a", gfx::Font{"arial"}, {10}, {.bold = true}, kRed);
+        a.expect_eq(glyphs.calls, 3);
+        a.expect_eq(canvas.glyph_stats().misses, std::size_t{3});
+    });
+
+    s.add_test("draw_text, no rasterizer", [](etest::IActions &a) {
+        auto canvas = make_canvas(4, 4);
+        canvas.draw_text({0, 0}, "a", gfx::Font{"arial"}, {10}, {}, kBlue);
+        a.expect_eq(canvas.pixel_at(0, 1), kWhite);
+    });
+
+    s.add_test("draw_text, underline", [](etest::IActions &a) {
+        BlockGlyphs glyphs;
+        auto canvas = make_canvas(8, 12, &glyphs);
+        canvas.draw_text({0, 0}, "aa", gfx::Font{"arial"}, {10}, {.underlined = true}, kRed);
+        a.expect_eq(canvas.pixel_at(5, 9), kRed);
+        a.expect_eq(canvas.pixel_at(6, 9), kWhite);
+    });
+
+    s.add_test("draw_pixels", [](etest::IActions &a) {
+        auto canvas = make_canvas(4, 4);
+        std::array<std::uint8_t, 8> const rgba{0xFF, 0, 0, 0xFF, 0, 0, 0, 0};
+        canvas.draw_pixels({1, 1, 2, 1}, rgba);
+        a.expect_eq(canvas.pixel_at(1, 1), kRed);
+        a.expect_eq(canvas.pixel_at(2, 1), kWhite);
+
+        // Mismatched sizes are ignored.
+        canvas.draw_pixels({0, 0, 4, 4}, rgba);
+        a.expect_eq(canvas.pixel_at(0, 0), kWhite);
+    });
+
+    s.add_test("write_png", [](etest::IActions &a) {
+        auto canvas = make_canvas(3, 2);
+        canvas.fill_rect({1, 1, 1, 1}, kBlue);
+
+        std::stringstream ss;
+        a.require(canvas.write_png(ss));
+        auto png = img::Png::from(ss);
+        a.require(png.has_value());
+        a.expect_eq(png->width, std::uint32_t{3});
+        a.expect_eq(png->height, std::uint32_t{2});
+        a.expect(std::ranges::equal(png->bytes, canvas.pixels()));
+    });
+
+    s.add_test("write_png, translucent", [](etest::IActions &a) {
+        gfx::SoftwareCanvas canvas;
+        canvas.set_viewport_size(1, 1);
+        canvas.clear({0xFF, 0x80, 0, 0x80});
+
+        std::stringstream ss;
+        a.require(canvas.write_png(ss));
+        auto png = img::Png::from(ss);
+        a.require(png.has_value());
+        a.expect_eq(png->bytes, std::vector<std::uint8_t>{0xFF, 0x80, 0, 0x80});
+    });
+
+    return s.run();
+}
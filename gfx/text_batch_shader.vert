@@ -0,0 +1,27 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#version 140
+
+uniform vec2 resolution;
+
+// 3 texels per glyph: destination rect, source rect in the atlas page, and
+// color. Rects are stored as left, top, right, bottom.
+uniform samplerBuffer glyphs;
+
+out vec2 page_pos;
+flat out vec4 color;
+
+void main() {
+    int base = gl_InstanceID * 3;
+    vec4 dst = texelFetch(glyphs, base);
+    vec4 src = texelFetch(glyphs, base + 1);
+    color = texelFetch(glyphs, base + 2);
+
+    // The glyph is drawn as a triangle strip w/ 4 vertices covering dst.
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    vec2 pos = mix(dst.xy, dst.zw, corner);
+    page_pos = mix(src.xy, src.zw, corner);
+    gl_Position = vec4(pos.x / resolution.x * 2.0 - 1.0, 1.0 - pos.y / resolution.y * 2.0, 0.0, 1.0);
+}
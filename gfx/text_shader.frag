@@ -0,0 +1,17 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#version 140
+
+// A page of the glyph atlas, w/ the coverage in the red channel.
+uniform sampler2D page;
+
+in vec2 page_pos;
+flat in vec4 color;
+
+void main() {
+    // Glyphs are drawn unscaled, so each fragment maps to exactly one texel.
+    float coverage = texelFetch(page, ivec2(page_pos), 0).r;
+    gl_FragColor = vec4(color.rgb, color.a * coverage);
+}
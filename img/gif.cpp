@@ -1,14 +1,21 @@
-// SPDX-FileCopyrightText: 2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2023-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "img/gif.h"
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 using namespace std::literals;
@@ -16,6 +23,29 @@ using namespace std::literals;
 namespace img {
 namespace {
 
+// Every frame is composited onto a canvas of the full image size, so that's
+// limited, as is the total size of the frames kept.
+constexpr std::size_t kMaxPixelCount{8192 * 8192};
+constexpr std::size_t kMaxFrameBytes{std::size_t{1} << 30};
+
+constexpr int kMaxCodeSize = 12;
+
+std::optional<std::uint8_t> read_u8(std::istream &is) {
+    std::uint8_t value{};
+    if (!is.read(reinterpret_cast<char *>(&value), sizeof(value))) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<std::uint16_t> read_le16(std::istream &is) {
+    std::array<std::uint8_t, 2> bytes{};
+    if (!is.read(reinterpret_cast<char *>(bytes.data()), bytes.size())) {
+        return std::nullopt;
+    }
+    return static_cast<std::uint16_t>(bytes[0] | bytes[1] << 8);
+}
+
 // 18. Logical Screen Descriptor
 //
 //       7 6 5 4 3 2 1 0        Field Name                    Type
@@ -84,16 +114,18 @@ struct ScreenDescriptor {
     }
 };
 
+// 19. Global Color Table, and 21. Local Color Table
+//
 // This block contains a color table, which is a sequence of bytes representing
 // red-green-blue color triplets. If present, it contains a number of bytes
 // equal to 3 x 2^(Size of Global Color Table+1).
-struct GlobalColorTable {
+struct ColorTable {
     std::vector<std::uint8_t> data{};
 
-    static std::optional<GlobalColorTable> from(std::istream &is, std::uint8_t size) {
+    static std::optional<ColorTable> from(std::istream &is, std::uint8_t size) {
         // 2^1 == 2 << 0, so no +1 here.
         int actual_size = 3 * (2 << size);
-        GlobalColorTable table;
+        ColorTable table;
         table.data.resize(actual_size);
         if (!is.read(reinterpret_cast<char *>(table.data.data()), table.data.size())) {
             return std::nullopt;
@@ -103,6 +135,432 @@ struct GlobalColorTable {
     }
 };
 
+// 23. Graphic Control Extension
+//
+//      7 6 5 4 3 2 1 0        Field Name                    Type
+//     +---------------+
+//  0  |               |       Block Size                    Byte
+//     +---------------+
+//  1  |     |     | | |       <Packed Fields>               See below
+//     +---------------+
+//  2  |               |       Delay Time                    Unsigned
+//     +-             -+
+//  3  |               |
+//     +---------------+
+//  4  |               |       Transparent Color Index       Byte
+//     +---------------+
+//
+//     +---------------+
+//  0  |               |       Block Terminator              Byte
+//     +---------------+
+//
+//      <Packed Fields>  =     Reserved                      3 Bits
+//                             Disposal Method               3 Bits
+//                             User Input Flag               1 Bit
+//                             Transparent Color Flag        1 Bit
+struct GraphicControl {
+    enum class Disposal : std::uint8_t {
+        None,
+        Background,
+        Previous,
+    };
+
+    Disposal disposal{};
+    // In hundredths of a second.
+    std::uint16_t delay{};
+    std::optional<std::uint8_t> transparent_index{};
+
+    static std::optional<GraphicControl> from(std::istream &is) {
+        auto block_size = read_u8(is);
+        auto packed_fields = read_u8(is);
+        auto delay = read_le16(is);
+        auto transparent_index = read_u8(is);
+        auto terminator = read_u8(is);
+        if (block_size != 4 || !packed_fields || !delay || !transparent_index || terminator != 0) {
+            return std::nullopt;
+        }
+
+        GraphicControl control{.delay = *delay};
+        // 0 is no disposal specified, 1 is leaving the frame in place, and
+        // 4-7 are undefined.
+        switch ((*packed_fields & 0b0001'1100) >> 2) {
+            case 2:
+                control.disposal = Disposal::Background;
+                break;
+            case 3:
+                control.disposal = Disposal::Previous;
+                break;
+            default:
+                control.disposal = Disposal::None;
+                break;
+        }
+
+        if ((*packed_fields & 0b0000'0001) != 0) {
+            control.transparent_index = *transparent_index;
+        }
+
+        return control;
+    }
+};
+
+// 20. Image Descriptor
+//
+//      7 6 5 4 3 2 1 0        Field Name                    Type
+//     +---------------+
+//  0  |               |       Image Separator               Byte
+//     +---------------+
+//  1  |               |       Image Left Position           Unsigned
+//     +-             -+
+//  2  |               |
+//     +---------------+
+//  3  |               |       Image Top Position            Unsigned
+//     +-             -+
+//  4  |               |
+//     +---------------+
+//  5  |               |       Image Width                   Unsigned
+//     +-             -+
+//  6  |               |
+//     +---------------+
+//  7  |               |       Image Height                  Unsigned
+//     +-             -+
+//  8  |               |
+//     +---------------+
+//  9  | | | |   |     |       <Packed Fields>               See below
+//     +---------------+
+//
+//      <Packed Fields>  =      Local Color Table Flag        1 Bit
+//                              Interlace Flag                1 Bit
+//                              Sort Flag                     1 Bit
+//                              Reserved                      2 Bits
+//                              Size of Local Color Table     3 Bits
+//
+// The separator is read before this is.
+struct ImageDescriptor {
+    std::uint16_t x{};
+    std::uint16_t y{};
+    std::uint16_t width{};
+    std::uint16_t height{};
+
+    bool local_color_table{};
+    bool interlaced{};
+    std::uint8_t size_of_local_color_table{};
+
+    static std::optional<ImageDescriptor> from(std::istream &is) {
+        auto x = read_le16(is);
+        auto y = read_le16(is);
+        auto width = read_le16(is);
+        auto height = read_le16(is);
+        auto packed_fields = read_u8(is);
+        if (!x || !y || !width || !height || !packed_fields) {
+            return std::nullopt;
+        }
+
+        return ImageDescriptor{
+                .x = *x,
+                .y = *y,
+                .width = *width,
+                .height = *height,
+                .local_color_table = (*packed_fields & 0b1000'0000) != 0,
+                .interlaced = (*packed_fields & 0b0100'0000) != 0,
+                .size_of_local_color_table = static_cast<std::uint8_t>(*packed_fields & 0b0000'0111),
+        };
+    }
+};
+
+// 15. Data Sub-blocks
+//
+// Data is split into blocks of up to 255 bytes, each prefixed by its size,
+// and ended by an empty block.
+std::optional<std::vector<std::uint8_t>> read_sub_blocks(std::istream &is) {
+    std::vector<std::uint8_t> data;
+    while (true) {
+        auto size = read_u8(is);
+        if (!size) {
+            return std::nullopt;
+        }
+
+        if (*size == 0) {
+            return data;
+        }
+
+        auto const old_size = data.size();
+        data.resize(old_size + *size);
+        if (!is.read(reinterpret_cast<char *>(data.data() + old_size), *size)) {
+            return std::nullopt;
+        }
+    }
+}
+
+bool skip_sub_blocks(std::istream &is) {
+    while (true) {
+        auto size = read_u8(is);
+        if (!size) {
+            return false;
+        }
+
+        if (*size == 0) {
+            return true;
+        }
+
+        if (!is.ignore(*size)) {
+            return false;
+        }
+    }
+}
+
+// Appendix F. Variable-Length-Code LZW Compression
+//
+// Decodes color indices into `out`, returning how many were decoded. Like in
+// browsers, broken data ends the decoding, keeping what was decoded before it.
+std::size_t lzw_decode(std::span<std::uint8_t const> data, int min_code_size, std::span<std::uint8_t> out) {
+    // Every code is a previous code w/ one more index appended, so strings are
+    // stored as that previous code, and written back to front.
+    struct Entry {
+        std::uint16_t prefix{};
+        std::uint16_t length{};
+        std::uint8_t first{};
+        std::uint8_t last{};
+    };
+
+    std::array<Entry, 1 << kMaxCodeSize> table{};
+    auto const clear_code = 1 << min_code_size;
+    auto const end_code = clear_code + 1;
+    for (int i = 0; i < clear_code; ++i) {
+        auto const index = static_cast<std::uint8_t>(i);
+        table[static_cast<std::size_t>(i)] = Entry{.length = 1, .first = index, .last = index};
+    }
+
+    std::size_t written = 0;
+    auto write = [&](std::size_t code) {
+        auto const length = table[code].length;
+        auto const n = std::min(std::size_t{length}, out.size() - written);
+        // Skip the end of the string if it doesn't fit.
+        for (std::size_t i = length; i > n; --i) {
+            code = table[code].prefix;
+        }
+
+        for (std::size_t i = n; i > 0; --i) {
+            out[written + i - 1] = table[code].last;
+            code = table[code].prefix;
+        }
+
+        written += n;
+    };
+
+    int code_size = min_code_size + 1;
+    int next_code = end_code + 1;
+    std::optional<int> previous;
+
+    std::uint32_t bits = 0;
+    int bit_count = 0;
+    std::size_t pos = 0;
+    while (written < out.size()) {
+        while (bit_count < code_size) {
+            if (pos == data.size()) {
+                return written;
+            }
+            bits |= std::uint32_t{data[pos++]} << bit_count;
+            bit_count += 8;
+        }
+
+        auto const code = static_cast<int>(bits & ((1u << code_size) - 1));
+        bits >>= code_size;
+        bit_count -= code_size;
+
+        if (code == clear_code) {
+            code_size = min_code_size + 1;
+            next_code = end_code + 1;
+            previous.reset();
+            continue;
+        }
+
+        if (code == end_code) {
+            break;
+        }
+
+        if (!previous) {
+            if (code > clear_code) {
+                break;
+            }
+            write(static_cast<std::size_t>(code));
+            previous = code;
+            continue;
+        }
+
+        std::uint8_t first{};
+        if (code < next_code) {
+            first = table[static_cast<std::size_t>(code)].first;
+        } else if (code == next_code) {
+            // The string being defined, i.e. the previous one w/ its own first
+            // index appended.
+            first = table[static_cast<std::size_t>(*previous)].first;
+        } else {
+            break;
+        }
+
+        // Once the table is full, codes are used as they are until the next
+        // clear code.
+        if (next_code < (1 << kMaxCodeSize)) {
+            auto const &prefix = table[static_cast<std::size_t>(*previous)];
+            table[static_cast<std::size_t>(next_code)] = Entry{
+                    .prefix = static_cast<std::uint16_t>(*previous),
+                    .length = static_cast<std::uint16_t>(prefix.length + 1),
+                    .first = prefix.first,
+                    .last = first,
+            };
+            ++next_code;
+            if (next_code == (1 << code_size) && code_size < kMaxCodeSize) {
+                ++code_size;
+            }
+        }
+
+        write(static_cast<std::size_t>(code));
+        previous = code;
+    }
+
+    return written;
+}
+
+// Interlaced images store every 8th row starting at 0, then every 8th row
+// starting at 4, then every 4th starting at 2, and then every 2nd starting at 1.
+std::vector<std::uint32_t> interlaced_rows(std::uint32_t height) {
+    std::vector<std::uint32_t> rows;
+    rows.reserve(height);
+    for (auto [start, step] : {std::pair{0u, 8u}, std::pair{4u, 8u}, std::pair{2u, 4u}, std::pair{1u, 2u}}) {
+        for (auto row = start; row < height; row += step) {
+            rows.push_back(row);
+        }
+    }
+    return rows;
+}
+
+struct Rect {
+    std::uint32_t x{};
+    std::uint32_t y{};
+    std::uint32_t width{};
+    std::uint32_t height{};
+
+    [[nodiscard]] bool empty() const { return width == 0 || height == 0; }
+
+    [[nodiscard]] Rect united(Rect const &other) const {
+        if (empty()) {
+            return other;
+        }
+
+        if (other.empty()) {
+            return *this;
+        }
+
+        auto const left = std::min(x, other.x);
+        auto const top = std::min(y, other.y);
+        auto const right = std::max(x + width, other.x + other.width);
+        auto const bottom = std::max(y + height, other.y + other.height);
+        return {left, top, right - left, bottom - top};
+    }
+};
+
+// Composites frames onto a canvas, keeping track of what changes between
+// them.
+class Compositor {
+public:
+    Compositor(std::uint32_t width, std::uint32_t height)
+        : width_{width}, height_{height}, canvas_(std::size_t{width} * height * 4) {}
+
+    // Draws a frame and returns the changes since the previous one.
+    Gif::Frame draw(ImageDescriptor const &image,
+            std::span<std::uint8_t const> indices,
+            std::span<std::uint8_t const> color_table,
+            std::optional<GraphicControl> const &control) {
+        // Frames are allowed to extend past the canvas, but those parts aren't
+        // shown.
+        Rect const frame{
+                std::min<std::uint32_t>(image.x, width_),
+                std::min<std::uint32_t>(image.y, height_),
+                std::min<std::uint32_t>(image.width, width_ - std::min<std::uint32_t>(image.x, width_)),
+                std::min<std::uint32_t>(image.height, height_ - std::min<std::uint32_t>(image.y, height_)),
+        };
+
+        auto const disposal = control ? control->disposal : GraphicControl::Disposal::None;
+        if (disposal == GraphicControl::Disposal::Previous) {
+            saved_ = copy(frame);
+        }
+
+        auto const rows = image.interlaced ? interlaced_rows(image.height) : std::vector<std::uint32_t>{};
+        // Not a valid index if there's no transparency.
+        int const transparent_index = control && control->transparent_index ? *control->transparent_index : -1;
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            auto const row = static_cast<std::uint32_t>(i / image.width);
+            auto const x = static_cast<std::uint32_t>(i % image.width);
+            auto const y = image.interlaced ? rows[row] : row;
+            auto const index = indices[i];
+            if (x >= frame.width || y >= frame.height || index == transparent_index
+                    || std::size_t{index} * 3 + 2 >= color_table.size()) {
+                continue;
+            }
+
+            auto *px = canvas_.data() + ((std::size_t{frame.y} + y) * width_ + frame.x + x) * 4;
+            px[0] = color_table[std::size_t{index} * 3];
+            px[1] = color_table[std::size_t{index} * 3 + 1];
+            px[2] = color_table[std::size_t{index} * 3 + 2];
+            px[3] = 0xFF;
+        }
+
+        // The first frame is drawn onto a blank canvas, so it's the only one
+        // that needs to cover all of it.
+        auto const changed = first_frame_ ? Rect{0, 0, width_, height_} : frame.united(disposed_);
+        first_frame_ = false;
+        Gif::Frame result{
+                .x = changed.x,
+                .y = changed.y,
+                .width = changed.width,
+                .height = changed.height,
+                .bytes = copy(changed),
+                .delay = std::chrono::milliseconds{control ? control->delay * 10 : 0},
+        };
+
+        // Clean up after the frame so that the next one is drawn onto the
+        // right thing.
+        disposed_ = {};
+        if (disposal == GraphicControl::Disposal::Background) {
+            // Browsers clear to transparent rather than to the background
+            // color, so we do too.
+            paste(frame, std::vector<unsigned char>(std::size_t{frame.width} * frame.height * 4));
+            disposed_ = frame;
+        } else if (disposal == GraphicControl::Disposal::Previous) {
+            paste(frame, saved_);
+            disposed_ = frame;
+        }
+
+        return result;
+    }
+
+private:
+    std::vector<unsigned char> copy(Rect const &rect) const {
+        std::vector<unsigned char> bytes;
+        bytes.reserve(std::size_t{rect.width} * rect.height * 4);
+        for (auto y = rect.y; y < rect.y + rect.height; ++y) {
+            auto const *row = canvas_.data() + (std::size_t{y} * width_ + rect.x) * 4;
+            bytes.insert(bytes.end(), row, row + std::size_t{rect.width} * 4);
+        }
+        return bytes;
+    }
+
+    void paste(Rect const &rect, std::span<unsigned char const> bytes) {
+        auto const row_size = std::size_t{rect.width} * 4;
+        for (std::uint32_t y = 0; y < rect.height; ++y) {
+            std::ranges::copy(bytes.subspan(y * row_size, row_size),
+                    canvas_.begin() + static_cast<std::ptrdiff_t>(((std::size_t{rect.y} + y) * width_ + rect.x) * 4));
+        }
+    }
+
+    std::uint32_t width_{};
+    std::uint32_t height_{};
+    std::vector<unsigned char> canvas_;
+    std::vector<unsigned char> saved_;
+    Rect disposed_{};
+    bool first_frame_{true};
+};
+
 } // namespace
 
 // https://www.w3.org/Graphics/GIF/spec-gif87.txt
@@ -140,19 +598,155 @@ std::optional<Gif> Gif::from(std::istream &is) {
         return std::nullopt;
     }
 
-    std::optional<GlobalColorTable> global_color_table;
+    std::optional<ColorTable> global_color_table;
     if (screen->global_color_table) {
-        global_color_table = GlobalColorTable::from(is, screen->size_of_global_color_table);
+        global_color_table = ColorTable::from(is, screen->size_of_global_color_table);
         if (!global_color_table) {
             return std::nullopt;
         }
     }
 
-    return Gif{
+    Gif gif{
             .version = version,
             .width = screen->width,
             .height = screen->height,
     };
+
+    if (std::size_t{gif.width} * gif.height > kMaxPixelCount) {
+        return std::nullopt;
+    }
+
+    std::span<std::uint8_t const> const global_colors = global_color_table
+            ? std::span<std::uint8_t const>{global_color_table->data}
+            : std::span<std::uint8_t const>{};
+
+    Compositor compositor{gif.width, gif.height};
+    std::optional<GraphicControl> control;
+    std::vector<std::uint8_t> indices;
+    std::size_t frame_bytes = 0;
+    while (auto separator = read_u8(is)) {
+        if (*separator == 0x3B) {
+            // 27. Trailer
+            break;
+        }
+
+        if (*separator == 0x21) {
+            // 24. Extensions.
+            auto label = read_u8(is);
+            if (!label) {
+                break;
+            }
+
+            if (*label == 0xF9) {
+                control = GraphicControl::from(is);
+                if (!control) {
+                    break;
+                }
+            } else if (!skip_sub_blocks(is)) {
+                break;
+            }
+            continue;
+        }
+
+        if (*separator != 0x2C) {
+            break;
+        }
+
+        auto image = ImageDescriptor::from(is);
+        if (!image) {
+            break;
+        }
+
+        std::optional<ColorTable> local_color_table;
+        if (image->local_color_table) {
+            local_color_table = ColorTable::from(is, image->size_of_local_color_table);
+            if (!local_color_table) {
+                break;
+            }
+        }
+
+        // 22. Table Based Image Data
+        auto min_code_size = read_u8(is);
+        if (!min_code_size || *min_code_size < 1 || *min_code_size >= kMaxCodeSize) {
+            break;
+        }
+
+        auto data = read_sub_blocks(is);
+        if (!data) {
+            break;
+        }
+
+        indices.resize(std::size_t{image->width} * image->height);
+        auto const decoded = lzw_decode(*data, *min_code_size, indices);
+        auto frame = compositor.draw(*image,
+                std::span{indices}.first(decoded),
+                local_color_table ? std::span<std::uint8_t const>{local_color_table->data} : global_colors,
+                control);
+        control.reset();
+
+        frame_bytes += frame.bytes.size();
+        if (frame_bytes > kMaxFrameBytes) {
+            break;
+        }
+
+        gif.frames.push_back(std::move(frame));
+    }
+
+    return gif;
+}
+
+GifPlayer::GifPlayer(Gif gif) : gif_{std::move(gif)}, canvas_(std::size_t{gif_.width} * gif_.height * 4) {
+    for (std::size_t i = 0; i < gif_.frames.size(); ++i) {
+        apply(gif_.frames[i]);
+        if (i % kKeyframeInterval == 0) {
+            keyframes_.push_back(canvas_);
+        }
+    }
+
+    if (!gif_.frames.empty()) {
+        current_ = gif_.frames.size() - 1;
+    }
+}
+
+std::span<unsigned char const> GifPlayer::frame(std::size_t frame) {
+    assert(frame < gif_.frames.size());
+    if (current_ == frame) {
+        return canvas_;
+    }
+
+    // Continue from the current frame if it's on the way, and from the closest
+    // keyframe otherwise.
+    auto const keyframe = frame / kKeyframeInterval;
+    auto next = keyframe * kKeyframeInterval + 1;
+    if (current_ && *current_ < frame && *current_ >= keyframe * kKeyframeInterval) {
+        next = *current_ + 1;
+    } else {
+        canvas_ = keyframes_[keyframe];
+    }
+
+    for (; next <= frame; ++next) {
+        apply(gif_.frames[next]);
+    }
+
+    current_ = frame;
+    return canvas_;
+}
+
+std::size_t GifPlayer::memory_usage() const {
+    std::size_t bytes = canvas_.size() + keyframes_.size() * canvas_.size();
+    for (auto const &frame : gif_.frames) {
+        bytes += frame.bytes.size();
+    }
+    return bytes;
+}
+
+void GifPlayer::apply(Gif::Frame const &frame) {
+    auto const row_size = std::size_t{frame.width} * 4;
+    for (std::uint32_t y = 0; y < frame.height; ++y) {
+        std::copy_n(frame.bytes.data() + y * row_size,
+                row_size,
+                canvas_.data() + ((std::size_t{frame.y} + y) * gif_.width + frame.x) * 4);
+    }
 }
 
 } // namespace img
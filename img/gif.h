@@ -5,9 +5,13 @@
 #ifndef IMG_GIF_H_
 #define IMG_GIF_H_
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <iosfwd>
 #include <optional>
+#include <span>
+#include <vector>
 
 namespace img {
 
@@ -18,16 +22,62 @@ public:
         Gif89a,
     };
 
+    // The part of the canvas that changed since the previous frame, and what
+    // it looks like after compositing. The first frame covers the whole canvas,
+    // which starts out transparent.
+    struct Frame {
+        std::uint32_t x{};
+        std::uint32_t y{};
+        std::uint32_t width{};
+        std::uint32_t height{};
+        std::vector<unsigned char> bytes{};
+        std::chrono::milliseconds delay{};
+
+        [[nodiscard]] bool operator==(Frame const &) const = default;
+    };
+
+    // Decoding stops at the first broken or missing block, keeping the frames
+    // decoded before it.
     static std::optional<Gif> from(std::istream &&is) { return from(is); }
     static std::optional<Gif> from(std::istream &is);
 
     Version version{};
     std::uint32_t width{};
     std::uint32_t height{};
+    std::vector<Frame> frames{};
 
     [[nodiscard]] bool operator==(Gif const &) const = default;
 };
 
+// Replays the frames of a Gif. A full copy of every kKeyframeInterval'th
+// frame is kept so that seeking only has to apply a few frames' worth of
+// changes, and playing the frames in order applies one per frame.
+class GifPlayer {
+public:
+    static constexpr std::size_t kKeyframeInterval = 16;
+
+    explicit GifPlayer(Gif);
+
+    std::uint32_t width() const { return gif_.width; }
+    std::uint32_t height() const { return gif_.height; }
+    std::size_t frame_count() const { return gif_.frames.size(); }
+    std::chrono::milliseconds delay(std::size_t frame) const { return gif_.frames[frame].delay; }
+
+    // The RGBA pixels of a frame, valid until the next call.
+    std::span<unsigned char const> frame(std::size_t);
+
+    // Roughly how many bytes of pixels are kept around.
+    std::size_t memory_usage() const;
+
+private:
+    void apply(Gif::Frame const &);
+
+    Gif gif_;
+    std::vector<std::vector<unsigned char>> keyframes_;
+    std::vector<unsigned char> canvas_;
+    std::optional<std::size_t> current_;
+};
+
 } // namespace img
 
 #endif
@@ -0,0 +1,182 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "img/gif.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+constexpr std::uint16_t kNoCode = 0xFFFF;
+
+std::string le16(unsigned v) {
+    return {static_cast<char>(v & 0xFF), static_cast<char>(v >> 8)};
+}
+
+// LZW-compresses 8-bit indices, clearing the table whenever it fills up.
+std::string lzw_encode(std::vector<std::uint8_t> const &indices) {
+    std::vector<std::uint16_t> table(4096 * 256, kNoCode);
+    std::string out;
+    std::uint32_t bits = 0;
+    int bit_count = 0;
+    int code_size = 9;
+    auto emit = [&](unsigned code) {
+        bits |= code << bit_count;
+        bit_count += code_size;
+        while (bit_count >= 8) {
+            out += static_cast<char>(bits & 0xFF);
+            bits >>= 8;
+            bit_count -= 8;
+        }
+    };
+
+    unsigned next_code = 258;
+    emit(256);
+    unsigned prefix = indices[0];
+    for (std::size_t i = 1; i < indices.size(); ++i) {
+        auto &entry = table[prefix * 256 + indices[i]];
+        if (entry != kNoCode) {
+            prefix = entry;
+            continue;
+        }
+
+        emit(prefix);
+        if (next_code == (1u << code_size) && code_size < 12) {
+            ++code_size;
+        }
+
+        if (next_code < 4096) {
+            entry = static_cast<std::uint16_t>(next_code++);
+        } else {
+            emit(256);
+            std::ranges::fill(table, kNoCode);
+            next_code = 258;
+            code_size = 9;
+        }
+        prefix = indices[i];
+    }
+
+    emit(prefix);
+    emit(257);
+    if (bit_count > 0) {
+        out += static_cast<char>(bits & 0xFF);
+    }
+    return out;
+}
+
+// An animation of a gradient background w/ a noisy sprite moving over it, so
+// every frame after the first only covers a part of the canvas.
+std::string make_animation(unsigned width, unsigned height, unsigned frames, unsigned sprite_size) {
+    auto gif = "GIF89a"s + le16(width) + le16(height) + "\xF7\0\0"s;
+    for (int i = 0; i < 256; ++i) {
+        gif += static_cast<char>(i);
+        gif += static_cast<char>(255 - i);
+        gif += static_cast<char>(i * 7);
+    }
+
+    auto add_frame = [&](unsigned x, unsigned y, unsigned w, unsigned h, std::vector<std::uint8_t> const &indices) {
+        gif += "\x21\xF9\x04\x04\x02\0\0\0"s; // Do not dispose, 20ms delay.
+        gif += ',' + le16(x) + le16(y) + le16(w) + le16(h);
+        gif += "\0\x08"s;
+        auto const data = lzw_encode(indices);
+        for (std::size_t i = 0; i < data.size(); i += 255) {
+            auto const block = data.substr(i, 255);
+            gif += static_cast<char>(block.size());
+            gif += block;
+        }
+        gif += '\0';
+    };
+
+    std::vector<std::uint8_t> background;
+    for (unsigned y = 0; y < height; ++y) {
+        for (unsigned x = 0; x < width; ++x) {
+            background.push_back(static_cast<std::uint8_t>((x + y) / 8));
+        }
+    }
+    add_frame(0, 0, width, height, background);
+
+    std::uint32_t noise = 1;
+    for (unsigned i = 1; i < frames; ++i) {
+        std::vector<std::uint8_t> sprite;
+        for (unsigned p = 0; p < sprite_size * sprite_size; ++p) {
+            noise = noise * 1664525 + 1013904223;
+            sprite.push_back(static_cast<std::uint8_t>(p / sprite_size * 2 + (noise >> 30)));
+        }
+        add_frame(i * 7 % (width - sprite_size), i * 3 % (height - sprite_size), sprite_size, sprite_size, sprite);
+    }
+
+    return gif + ';';
+}
+
+template<typename F>
+double seconds(int iterations, F &&f) {
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        f();
+    }
+    std::chrono::duration<double> const duration = std::chrono::steady_clock::now() - start;
+    return duration.count() / iterations;
+}
+
+} // namespace
+
+// Measures decoding animated GIFs and playing them back. Pass a file to use
+// that instead of a generated animation.
+int main(int argc, char **argv) {
+    int const iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    std::string data;
+    if (argc > 1) {
+        std::ifstream file{argv[1], std::ios::binary};
+        std::stringstream ss;
+        ss << file.rdbuf();
+        data = std::move(ss).str();
+    } else {
+        data = make_animation(1280, 720, 300, 256);
+    }
+
+    std::optional<img::Gif> gif;
+    auto const decode = seconds(iterations, [&] { gif = img::Gif::from(std::istringstream{data}); });
+    if (!gif || gif->frames.empty()) {
+        std::cerr << "Unable to decode GIF\n";
+        return 1;
+    }
+
+    auto const canvas_size = std::size_t{gif->width} * gif->height * 4;
+    auto const frame_count = gif->frames.size();
+    img::GifPlayer player{*std::move(gif)};
+
+    std::size_t checksum = 0;
+    auto const play = seconds(iterations, [&] {
+        for (std::size_t i = 0; i < player.frame_count(); ++i) {
+            checksum += player.frame(i)[0];
+        }
+    });
+    auto const seek = seconds(iterations, [&] {
+        for (std::size_t i = 0; i < player.frame_count(); ++i) {
+            checksum += player.frame(i * 7919 % player.frame_count())[0];
+        }
+    });
+
+    auto const decoded_mb = static_cast<double>(canvas_size * frame_count) / 1'000'000.;
+    std::cout << player.width() << "x" << player.height() << ", " << frame_count << " frames, " << data.size()
+              << " bytes (checksum " << checksum << ")\n";
+    std::cout << "  decode: " << decode * 1000 << " ms, " << decoded_mb / decode << " MB/s of composited frames\n";
+    std::cout << "  play in order: " << static_cast<double>(frame_count) / play << " frames/s\n";
+    std::cout << "  play in random order: " << static_cast<double>(frame_count) / seek << " frames/s\n";
+    std::cout << "  memory: " << player.memory_usage() / 1'000'000. << " MB, vs " << decoded_mb
+              << " MB for every frame\n";
+}
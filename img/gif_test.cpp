@@ -1,4 +1,4 @@
-// SPDX-FileCopyrightText: 2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2023-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
@@ -6,15 +6,150 @@
 
 #include "etest/etest.h"
 
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
+using etest::expect;
 using etest::expect_eq;
+using etest::require;
 using img::Gif;
 
 using namespace std::literals;
 
+namespace {
+
+// Appendix F, from the encoding side. Emitting a clear code when the table
+// fills up is optional, so both ways are supported.
+std::string lzw_encode(std::vector<std::uint8_t> const &indices, int min_code_size, bool clear_when_full = true) {
+    std::string out;
+    std::uint32_t bits = 0;
+    int bit_count = 0;
+    int code_size = min_code_size + 1;
+    auto emit = [&](int code) {
+        bits |= static_cast<std::uint32_t>(code) << bit_count;
+        bit_count += code_size;
+        while (bit_count >= 8) {
+            out += static_cast<char>(bits & 0xFF);
+            bits >>= 8;
+            bit_count -= 8;
+        }
+    };
+
+    int const clear_code = 1 << min_code_size;
+    int next_code = clear_code + 2;
+    std::map<std::pair<int, std::uint8_t>, int> table;
+    emit(clear_code);
+
+    int prefix = indices[0];
+    for (std::size_t i = 1; i < indices.size(); ++i) {
+        if (auto it = table.find({prefix, indices[i]}); it != table.end()) {
+            prefix = it->second;
+            continue;
+        }
+
+        emit(prefix);
+        // The decoder adds its entries one code later, so the code size grows
+        // one code later too.
+        if (next_code == (1 << code_size) && code_size < 12) {
+            ++code_size;
+        }
+
+        if (next_code < 4096) {
+            table[{prefix, indices[i]}] = next_code++;
+        } else if (clear_when_full) {
+            emit(clear_code);
+            table.clear();
+            next_code = clear_code + 2;
+            code_size = min_code_size + 1;
+        }
+        prefix = indices[i];
+    }
+
+    emit(prefix);
+    emit(clear_code + 1);
+    if (bit_count > 0) {
+        out += static_cast<char>(bits & 0xFF);
+    }
+    return out;
+}
+
+std::string le16(int v) {
+    return {static_cast<char>(v & 0xFF), static_cast<char>(v >> 8)};
+}
+
+struct TestFrame {
+    int x{};
+    int y{};
+    int width{};
+    int height{};
+    std::vector<std::uint8_t> indices;
+    int disposal{};
+    std::optional<std::uint8_t> transparent_index;
+    int delay{};
+    bool interlaced{};
+    int min_code_size{2};
+    bool clear_when_full{true};
+};
+
+// Makes a GIF w/ a 4-color global color table.
+std::string make_gif(int width, int height, std::vector<TestFrame> const &frames) {
+    auto gif = "GIF89a"s + le16(width) + le16(height) + "\x81\0\0"s;
+    gif += "\x10\x20\x30\x40\x50\x60\x70\x80\x90\xA0\xB0\xC0"s;
+    for (auto const &frame : frames) {
+        gif += "\x21\xF9\x04"s;
+        gif += static_cast<char>(frame.disposal << 2 | (frame.transparent_index ? 1 : 0));
+        gif += le16(frame.delay);
+        gif += static_cast<char>(frame.transparent_index.value_or(0));
+        gif += '\0';
+
+        gif += ',' + le16(frame.x) + le16(frame.y) + le16(frame.width) + le16(frame.height);
+        gif += frame.interlaced ? '\x40' : '\0';
+        gif += static_cast<char>(frame.min_code_size);
+        auto const data = lzw_encode(frame.indices, frame.min_code_size, frame.clear_when_full);
+        for (std::size_t i = 0; i < data.size(); i += 255) {
+            auto const block = data.substr(i, 255);
+            gif += static_cast<char>(block.size());
+            gif += block;
+        }
+        gif += '\0';
+    }
+    return gif + ';';
+}
+
+std::vector<unsigned char> to_rgba(std::vector<std::uint8_t> const &indices) {
+    static constexpr std::array<std::array<unsigned char, 4>, 4> kColors{{
+            {0x10, 0x20, 0x30, 0xFF},
+            {0x40, 0x50, 0x60, 0xFF},
+            {0x70, 0x80, 0x90, 0xFF},
+            {0xA0, 0xB0, 0xC0, 0xFF},
+    }};
+
+    std::vector<unsigned char> rgba;
+    for (auto index : indices) {
+        rgba.insert(rgba.end(), kColors[index].begin(), kColors[index].end());
+    }
+    return rgba;
+}
+
+std::vector<std::uint8_t> noise(std::size_t size, unsigned colors, unsigned seed = 1) {
+    std::vector<std::uint8_t> indices;
+    for (std::size_t i = 0; i < size; ++i) {
+        seed = seed * 1103515245 + 12345;
+        indices.push_back(static_cast<std::uint8_t>((seed >> 16) % colors));
+    }
+    return indices;
+}
+
+} // namespace
+
 int main() {
     etest::test("invalid signatures", [] {
         expect_eq(Gif::from(std::stringstream{"GIF87"s}), std::nullopt);
@@ -54,5 +189,171 @@ int main() {
         expect_eq(Gif::from(std::stringstream{"GIF89a\1\0\1\0\x80\0\0\1\2\3\1\2\3"s}), expected);
     });
 
+    etest::test("header w/o any frames", [] {
+        auto gif = Gif::from(std::stringstream{"GIF89a\1\0\1\0\x80\0\0\1\2\3\1\2\3;"s});
+        require(gif.has_value());
+        expect(gif->frames.empty());
+    });
+
+    etest::test("1x1 transparent pixel", [] {
+        auto gif = Gif::from(std::stringstream{"GIF89a\1\0\1\0\x80\0\0\xFF\xFF\xFF\0\0\0"
+                                               "\x21\xF9\x04\x01\0\0\0\0"
+                                               "\x2C\0\0\0\0\1\0\1\0\0\x02\x02\x44\x01\0\x3B"s});
+        require(gif.has_value());
+        require(gif->frames.size() == 1);
+        expect_eq(gif->frames[0], Gif::Frame{.width = 1, .height = 1, .bytes = {0, 0, 0, 0}});
+    });
+
+    etest::test("lzw", [] {
+        // Runs are encoded using codes that aren't in the table yet.
+        std::vector<std::uint8_t> runs(60 * 40, 2);
+        for (std::size_t i = 0; i < runs.size(); i += 37) {
+            runs[i] = 1;
+        }
+
+        for (auto const &indices : {runs, noise(60 * 40, 4)}) {
+            auto const data = make_gif(60, 40, {{.width = 60, .height = 40, .indices = indices}});
+            auto gif = Gif::from(std::stringstream{data});
+            require(gif.has_value());
+            require(gif->frames.size() == 1);
+            expect_eq(gif->frames[0].bytes, to_rgba(indices));
+        }
+    });
+
+    etest::test("lzw, full table", [] {
+        // 8-bit codes fill the 4096-entry table quickly.
+        auto const indices = noise(200 * 200, 4);
+        for (bool clear_when_full : {true, false}) {
+            auto gif = Gif::from(std::stringstream{make_gif(200,
+                    200,
+                    {{
+                            .width = 200,
+                            .height = 200,
+                            .indices = indices,
+                            .min_code_size = 8,
+                            .clear_when_full = clear_when_full,
+                    }})});
+            require(gif.has_value());
+            require(gif->frames.size() == 1);
+            expect_eq(gif->frames[0].bytes, to_rgba(indices));
+        }
+    });
+
+    etest::test("interlaced", [] {
+        // Rows 0, 8, 4, 2, 6, 1, 3, 5, 7, 9.
+        std::vector<std::uint8_t> const interlaced{0, 1, 2, 1, 2, 0, 0, 0, 0, 3};
+        std::vector<std::uint8_t> const rows{0, 0, 1, 0, 2, 0, 2, 0, 1, 3};
+        auto gif = Gif::from(std::stringstream{
+                make_gif(1, 10, {{.width = 1, .height = 10, .indices = interlaced, .interlaced = true}})});
+        require(gif.has_value());
+        require(gif->frames.size() == 1);
+        expect_eq(gif->frames[0].bytes, to_rgba(rows));
+    });
+
+    etest::test("frames only contain what changed", [] {
+        auto gif = Gif::from(std::stringstream{make_gif(4,
+                4,
+                {
+                        {.width = 4, .height = 4, .indices = std::vector<std::uint8_t>(16, 0), .delay = 5},
+                        {.x = 1, .y = 2, .width = 2, .height = 1, .indices = {1, 2}, .delay = 10},
+                        // Partly off-canvas.
+                        {.x = 3, .y = 3, .width = 2, .height = 2, .indices = {3, 3, 3, 3}},
+                })});
+        require(gif.has_value());
+        require(gif->frames.size() == 3);
+        expect_eq(gif->frames[0].bytes, to_rgba(std::vector<std::uint8_t>(16, 0)));
+        expect_eq(gif->frames[0].delay, 50ms);
+        expect_eq(gif->frames[1],
+                Gif::Frame{.x = 1, .y = 2, .width = 2, .height = 1, .bytes = to_rgba({1, 2}), .delay = 100ms});
+        expect_eq(gif->frames[2], Gif::Frame{.x = 3, .y = 3, .width = 1, .height = 1, .bytes = to_rgba({3})});
+    });
+
+    etest::test("transparency and disposal", [] {
+        auto const transparent = std::vector<unsigned char>{0, 0, 0, 0};
+        auto gif = Gif::from(std::stringstream{make_gif(2,
+                1,
+                {
+                        // Index 3 is transparent, leaving the canvas transparent.
+                        {.width = 2, .height = 1, .indices = {0, 3}, .transparent_index = 3},
+                        // Restore to background, i.e. transparent.
+                        {.width = 1, .height = 1, .indices = {1}, .disposal = 2},
+                        // Restore to previous.
+                        {.x = 1, .width = 1, .height = 1, .indices = {2}, .disposal = 3},
+                        {.width = 0, .height = 0, .indices = {0}},
+                })});
+        require(gif.has_value());
+        require(gif->frames.size() == 4);
+
+        auto first = to_rgba({0});
+        first.insert(first.end(), transparent.begin(), transparent.end());
+        expect_eq(gif->frames[0].bytes, first);
+        expect_eq(gif->frames[1], Gif::Frame{.width = 1, .height = 1, .bytes = to_rgba({1})});
+        // The area cleared after the previous frame is part of this one.
+        auto third = transparent;
+        auto const drawn = to_rgba({2});
+        third.insert(third.end(), drawn.begin(), drawn.end());
+        expect_eq(gif->frames[2], Gif::Frame{.width = 2, .height = 1, .bytes = third});
+        expect_eq(gif->frames[3], Gif::Frame{.x = 1, .width = 1, .height = 1, .bytes = transparent});
+    });
+
+    etest::test("truncated data keeps the frames before it", [] {
+        auto const full = make_gif(4,
+                4,
+                {
+                        {.width = 4, .height = 4, .indices = std::vector<std::uint8_t>(16, 1)},
+                        {.width = 4, .height = 4, .indices = noise(16, 4)},
+                });
+        for (std::size_t size = full.size() - 5; size > 40; --size) {
+            auto gif = Gif::from(std::stringstream{full.substr(0, size)});
+            require(gif.has_value());
+            expect(gif->frames.size() <= 1);
+        }
+        expect_eq(Gif::from(std::stringstream{full})->frames.size(), std::size_t{2});
+    });
+
+    etest::test("player", [] {
+        // Enough frames for a few keyframes, each moving a pixel along.
+        std::vector<TestFrame> frames{{.width = 8, .height = 8, .indices = std::vector<std::uint8_t>(64, 0)}};
+        for (int i = 1; i < 40; ++i) {
+            frames.push_back({.x = i % 8, .y = i / 8 % 8, .width = 1, .height = 1, .indices = {3}, .delay = i});
+        }
+
+        auto gif = Gif::from(std::stringstream{make_gif(8, 8, frames)});
+        require(gif.has_value());
+        require(gif->frames.size() == 40);
+
+        auto expected_frame = [](std::size_t frame) {
+            std::vector<std::uint8_t> indices(64, 0);
+            for (std::size_t i = 1; i <= frame; ++i) {
+                indices[i % 64] = 3;
+            }
+            return to_rgba(indices);
+        };
+
+        img::GifPlayer player{*std::move(gif)};
+        expect_eq(player.frame_count(), std::size_t{40});
+        expect_eq(player.width(), 8u);
+        expect_eq(player.delay(3), 30ms);
+
+        // In order, backwards, and skipping around.
+        for (std::size_t i = 0; i < 40; ++i) {
+            auto frame = player.frame(i);
+            expect_eq(std::vector<unsigned char>(frame.begin(), frame.end()), expected_frame(i));
+        }
+
+        for (std::size_t i = 40; i > 0; --i) {
+            auto frame = player.frame(i - 1);
+            expect_eq(std::vector<unsigned char>(frame.begin(), frame.end()), expected_frame(i - 1));
+        }
+
+        for (std::size_t i : {std::size_t{33}, std::size_t{2}, std::size_t{17}, std::size_t{18}, std::size_t{31}}) {
+            auto frame = player.frame(i);
+            expect_eq(std::vector<unsigned char>(frame.begin(), frame.end()), expected_frame(i));
+        }
+
+        // 3 keyframes, the current frame, and the changes between frames.
+        expect(player.memory_usage() < 64 * 4 * 5 + 40 * 4);
+    });
+
     return etest::run_all_tests();
 }
@@ -16,11 +16,13 @@
 #include <SFML/Window/VideoMode.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -43,6 +45,11 @@ struct PixelDataGetter {
     std::vector<unsigned char> const *operator()(T const &img) {
         return &img.bytes;
     }
+
+    // The first frame covers the entire image.
+    std::vector<unsigned char> const *operator()(img::Gif const &gif) {
+        return gif.frames.empty() ? nullptr : &gif.frames[0].bytes;
+    }
 };
 } // namespace
 
@@ -82,7 +89,7 @@ int main(int argc, char **argv) {
         fs.clear();
         fs.seekg(0);
 
-        if (auto jpeg = img::Jpeg::thumbnail_from(fs)) {
+        if (auto jpeg = img::Jpeg::from(fs)) {
             return *jpeg;
         }
 
@@ -127,6 +134,13 @@ int main(int argc, char **argv) {
     type::SfmlType type;
     gfx::SfmlCanvas canvas{window, type};
 
+    std::optional<img::GifPlayer> animation;
+    if (auto const *gif = std::get_if<img::Gif>(&img); gif != nullptr && gif->frames.size() > 1) {
+        animation.emplace(*gif);
+    }
+    std::size_t frame = 0;
+    auto next_frame_at = std::chrono::steady_clock::now();
+
     bool running = true;
     while (running) {
         while (auto event = window.pollEvent()) {
@@ -137,8 +151,20 @@ int main(int argc, char **argv) {
             }
         }
 
+        std::span<unsigned char const> pixels = bytes;
+        if (animation) {
+            auto const now = std::chrono::steady_clock::now();
+            if (now >= next_frame_at) {
+                frame = (frame + 1) % animation->frame_count();
+                // Like browsers, treat really short delays as 100ms.
+                auto const delay = animation->delay(frame);
+                next_frame_at = now + (delay <= 10ms ? 100ms : delay);
+            }
+            pixels = animation->frame(frame);
+        }
+
         canvas.clear(gfx::Color{});
-        canvas.draw_pixels({0, 0, static_cast<int>(width), static_cast<int>(height)}, bytes);
+        canvas.draw_pixels({0, 0, static_cast<int>(width), static_cast<int>(height)}, pixels);
         window.display();
     }
 }
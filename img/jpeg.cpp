@@ -4,12 +4,21 @@
 
 #include "img/jpeg.h"
 
+#include "img/jpeg_kernels.h"
+#include "img/scale.h"
+
+#include <algorithm>
+#include <array>
 #include <bit>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <istream>
+#include <memory>
 #include <optional>
+#include <span>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -133,8 +142,1210 @@ struct App0Jfif {
     }
 };
 
+
+// Zigzag index -> natural (row-major) index.
+constexpr std::array<std::uint8_t, 64> kZigzag{
+        0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, //
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28, //
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, //
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63, //
+};
+
+constexpr std::size_t div_ceil(std::size_t a, std::size_t b) {
+    return (a + b - 1) / b;
+}
+
+// Coefficients are kept around for the entire image so that progressive scans
+// can refine them, so this is limited to avoid huge allocations.
+constexpr std::size_t kMaxPixelCount{8192 * 8192};
+
+class ByteReader {
+public:
+    explicit ByteReader(std::span<std::uint8_t const> data) : data_{data} {}
+
+    [[nodiscard]] std::size_t position() const { return pos_; }
+    [[nodiscard]] bool empty() const { return pos_ == data_.size(); }
+
+    std::optional<std::uint8_t> u8() {
+        if (empty()) {
+            return std::nullopt;
+        }
+        return data_[pos_++];
+    }
+
+    std::optional<std::uint16_t> be16() {
+        if (data_.size() - pos_ < 2) {
+            return std::nullopt;
+        }
+        auto const v = static_cast<std::uint16_t>(data_[pos_] << 8 | data_[pos_ + 1]);
+        pos_ += 2;
+        return v;
+    }
+
+    std::optional<std::span<std::uint8_t const>> bytes(std::size_t n) {
+        if (data_.size() - pos_ < n) {
+            return std::nullopt;
+        }
+        auto const v = data_.subspan(pos_, n);
+        pos_ += n;
+        return v;
+    }
+
+    // Marker segments start w/ their length, which includes the length field.
+    std::optional<ByteReader> segment() {
+        auto length = be16();
+        if (!length || *length < 2) {
+            return std::nullopt;
+        }
+        return bytes(*length - 2).transform([](auto data) { return ByteReader{data}; });
+    }
+
+    // Skips to just after the next marker, ignoring entropy-coded data, and
+    // returns its code.
+    std::optional<std::uint8_t> next_marker() {
+        while (pos_ + 1 < data_.size()) {
+            if (data_[pos_] != 0xFF) {
+                ++pos_;
+                continue;
+            }
+
+            auto const code = data_[pos_ + 1];
+            // Stuffed zeros, restart markers, and fill bytes aren't real markers.
+            if (code == 0x00 || (code >= 0xD0 && code <= 0xD7) || code == 0xFF) {
+                ++pos_;
+                continue;
+            }
+
+            pos_ += 2;
+            return code;
+        }
+
+        pos_ = data_.size();
+        return std::nullopt;
+    }
+
+    void seek(std::size_t pos) { pos_ = std::min(pos, data_.size()); }
+
+private:
+    std::span<std::uint8_t const> data_;
+    std::size_t pos_{};
+};
+
+// Reads entropy-coded data, removing stuffed zeros. Reaching a marker or the
+// end of the data makes it return zeros, which is what libjpeg does too, so
+// truncated images decode w/ their missing parts in gray.
+class BitReader {
+public:
+    BitReader(std::span<std::uint8_t const> data, std::size_t pos) : data_{data}, pos_{pos} {}
+
+    // Where the next unbuffered byte is.
+    [[nodiscard]] std::size_t position() const { return pos_; }
+
+    // n has to be in [1, 32].
+    std::uint32_t peek(int n) {
+        if (count_ < n) {
+            fill();
+        }
+        return static_cast<std::uint32_t>(bits_ >> (64 - n));
+    }
+
+    void skip(int n) {
+        bits_ <<= n;
+        count_ -= n;
+    }
+
+    std::uint32_t get(int n) {
+        if (n == 0) {
+            return 0;
+        }
+        auto const v = peek(n);
+        skip(n);
+        return v;
+    }
+
+    bool get_bit() { return get(1) != 0; }
+
+    // Reads an s-bit value, where values w/ the top bit clear are negative.
+    int receive_extend(int s) {
+        if (s == 0) {
+            return 0;
+        }
+
+        auto const v = static_cast<int>(get(s));
+        return v < (1 << (s - 1)) ? v - (1 << s) + 1 : v;
+    }
+
+    // Drops any buffered bits and skips past the restart marker that should
+    // come next.
+    void restart() {
+        bits_ = 0;
+        count_ = 0;
+        hit_marker_ = false;
+        while (pos_ + 1 < data_.size() && data_[pos_] == 0xFF && data_[pos_ + 1] == 0xFF) {
+            ++pos_;
+        }
+
+        if (pos_ + 1 < data_.size() && data_[pos_] == 0xFF && data_[pos_ + 1] >= 0xD0 && data_[pos_ + 1] <= 0xD7) {
+            pos_ += 2;
+        }
+    }
+
+private:
+    void fill() {
+        while (count_ <= 56) {
+            bits_ |= std::uint64_t{next_byte()} << (56 - count_);
+            count_ += 8;
+        }
+    }
+
+    std::uint8_t next_byte() {
+        if (hit_marker_ || pos_ >= data_.size()) {
+            return 0;
+        }
+
+        auto const b = data_[pos_];
+        if (b != 0xFF) {
+            ++pos_;
+            return b;
+        }
+
+        if (pos_ + 1 < data_.size() && data_[pos_ + 1] == 0x00) {
+            pos_ += 2;
+            return 0xFF;
+        }
+
+        hit_marker_ = true;
+        return 0;
+    }
+
+    std::span<std::uint8_t const> data_;
+    std::size_t pos_{};
+    std::uint64_t bits_{};
+    int count_{};
+    bool hit_marker_{false};
+};
+
+class HuffmanTable {
+public:
+    static std::optional<HuffmanTable> parse(ByteReader &r) {
+        auto counts = r.bytes(16);
+        if (!counts) {
+            return std::nullopt;
+        }
+
+        std::size_t total{};
+        for (auto count : *counts) {
+            total += count;
+        }
+
+        auto symbols = r.bytes(total);
+        if (!symbols || total > 256) {
+            return std::nullopt;
+        }
+
+        HuffmanTable table{};
+        std::ranges::copy(*symbols, table.symbols_.begin());
+
+        // Codes are assigned in order of increasing length, and each code is
+        // the previous one plus 1, w/ a 0 appended for every extra bit.
+        std::int32_t code = 0;
+        std::int32_t k = 0;
+        for (int length = 1; length <= 16; ++length) {
+            auto const count = (*counts)[static_cast<std::size_t>(length - 1)];
+            table.offset_[static_cast<std::size_t>(length)] = k - code;
+            for (int i = 0; i < count; ++i, ++code, ++k) {
+                // Too many codes for this length to fit in it.
+                if (code >= (1 << length)) {
+                    return std::nullopt;
+                }
+
+                if (length <= kFastBits) {
+                    auto const first = static_cast<std::size_t>(code) << (kFastBits - length);
+                    auto const entries = std::size_t{1} << (kFastBits - length);
+                    auto const symbol = (*symbols)[static_cast<std::size_t>(k)];
+                    auto const entry = static_cast<std::uint16_t>(length << 8 | symbol);
+                    std::fill_n(table.fast_.begin() + static_cast<std::ptrdiff_t>(first), entries, entry);
+                }
+            }
+
+            table.max_code_[static_cast<std::size_t>(length)] = count > 0 ? code - 1 : -1;
+            code <<= 1;
+        }
+
+        return table;
+    }
+
+    // Returns the next symbol, or nullopt if the bits don't match any code.
+    std::optional<std::uint8_t> decode(BitReader &r) const {
+        auto const bits = r.peek(16);
+        if (auto const entry = fast_[bits >> (16 - kFastBits)]; entry != 0) {
+            r.skip(entry >> 8);
+            return static_cast<std::uint8_t>(entry);
+        }
+
+        for (int length = kFastBits + 1; length <= 16; ++length) {
+            auto const code = static_cast<std::int32_t>(bits >> (16 - length));
+            if (code <= max_code_[static_cast<std::size_t>(length)]) {
+                r.skip(length);
+                return symbols_[static_cast<std::size_t>(code + offset_[static_cast<std::size_t>(length)])];
+            }
+        }
+
+        return std::nullopt;
+    }
+
+private:
+    static constexpr int kFastBits = 9;
+
+    // Indexed by the next kFastBits bits. The code length is in the high byte
+    // and the symbol in the low one, or it's 0 for codes longer than that.
+    std::array<std::uint16_t, 1 << kFastBits> fast_{};
+    // The largest code of each length, or -1 if there are none.
+    std::array<std::int32_t, 17> max_code_{};
+    // Added to a code of a given length to get the index of its symbol.
+    std::array<std::int32_t, 17> offset_{};
+    std::array<std::uint8_t, 256> symbols_{};
+};
+
+struct Component {
+    std::uint8_t id{};
+    std::size_t h{};
+    std::size_t v{};
+    std::uint8_t quant_table{};
+    std::uint8_t dc_table{};
+    std::uint8_t ac_table{};
+    int dc_pred{};
+
+    // Quantization tables can change between scans, so the one used is
+    // latched when the component first appears in a scan.
+    std::optional<jpeg::IdctTable> idct_table;
+    std::array<std::uint16_t, 64> quant{};
+
+    // Size in samples.
+    std::size_t width{};
+    std::size_t height{};
+    // The blocks covering the component, which is what non-interleaved scans
+    // go through.
+    std::size_t used_blocks_x{};
+    std::size_t used_blocks_y{};
+    // The blocks in the MCUs covering the image, which may have padding.
+    std::size_t blocks_x{};
+    std::size_t blocks_y{};
+    // 64 coefficients in natural order per block. Progressive images refine
+    // them over several scans, so they're kept for every block, but blocks in
+    // sequential images are done after a single scan, so only the row of MCUs
+    // being decoded is kept.
+    std::vector<std::int16_t> coefficients;
+    std::size_t coefficient_rows{};
+
+    // The samples, w/ every block scaled down to the decoder's block size.
+    std::vector<std::uint8_t> samples;
+    std::size_t samples_stride{};
+
+    std::span<std::int16_t, 64> block(std::size_t x, std::size_t y) {
+        return std::span<std::int16_t, 64>{coefficients.data() + ((y % coefficient_rows) * blocks_x + x) * 64, 64};
+    }
+};
+
+struct Scan {
+    std::vector<Component *> components;
+    std::uint8_t spectral_start{};
+    std::uint8_t spectral_end{};
+    std::uint8_t successive_high{};
+    std::uint8_t successive_low{};
+};
+
+class Decoder {
+public:
+    explicit Decoder(std::optional<ImageSize> max_size) : max_size_{max_size} {}
+
+    std::optional<Jpeg> decode(std::span<std::uint8_t const> data) {
+        if (!advance(data, false)) {
+            return std::nullopt;
+        }
+
+        return image();
+    }
+
+    // Decodes as much of the data as possible. If more data is coming, the
+    // segment or scan that's only partially there is left for the next call,
+    // which has to be given the same data w/ more appended to it.
+    bool advance(std::span<std::uint8_t const> data, bool more_data_coming) {
+        ByteReader r{data};
+        r.seek(pos_);
+        if (pos_ == 0) {
+            if (more_data_coming && data.size() < 2) {
+                return true;
+            }
+
+            if (r.be16() != StartOfImage::kMarker) {
+                return false;
+            }
+            pos_ = r.position();
+        }
+
+        while (!done_) {
+            auto marker = r.next_marker();
+            if (!marker) {
+                // Truncated, but what's there can still be shown.
+                break;
+            }
+
+            if (more_data_coming && !is_complete(*marker, r)) {
+                break;
+            }
+
+            switch (*marker) {
+                case 0xC0: // SOF0, baseline.
+                case 0xC1: // SOF1, extended sequential.
+                case 0xC2: { // SOF2, progressive.
+                    auto segment = r.segment();
+                    if (!segment || !parse_frame(*segment, *marker == 0xC2)) {
+                        return false;
+                    }
+                    break;
+                }
+                // Lossless, hierarchical, and arithmetic-coded JPEGs.
+                case 0xC3:
+                case 0xC5:
+                case 0xC6:
+                case 0xC7:
+                case 0xC9:
+                case 0xCA:
+                case 0xCB:
+                case 0xCD:
+                case 0xCE:
+                case 0xCF:
+                    return false;
+                case 0xC4: { // DHT
+                    auto segment = r.segment();
+                    if (!segment || !parse_huffman_tables(*segment)) {
+                        return false;
+                    }
+                    break;
+                }
+                case 0xDB: { // DQT
+                    auto segment = r.segment();
+                    if (!segment || !parse_quantization_tables(*segment)) {
+                        return false;
+                    }
+                    break;
+                }
+                case 0xDD: { // DRI
+                    auto segment = r.segment();
+                    auto interval = segment ? segment->be16() : std::nullopt;
+                    if (!interval) {
+                        return false;
+                    }
+                    restart_interval_ = *interval;
+                    break;
+                }
+                case 0xDA: { // SOS
+                    auto segment = r.segment();
+                    if (!segment) {
+                        return false;
+                    }
+
+                    auto scan = parse_scan(*segment);
+                    if (!scan) {
+                        return false;
+                    }
+
+                    BitReader bits{data, r.position()};
+                    if (!decode_scan(*scan, bits)) {
+                        return false;
+                    }
+                    r.seek(bits.position());
+                    ++scans_decoded_;
+                    break;
+                }
+                case 0xEE: { // APP14
+                    auto segment = r.segment();
+                    if (!segment) {
+                        return false;
+                    }
+                    parse_adobe(*segment);
+                    break;
+                }
+                case 0xD8: // SOI
+                case 0x01: // TEM
+                    break;
+                case 0xD9: // EOI
+                    done_ = true;
+                    break;
+                default:
+                    // APPn, COM, and other segments we don't care about.
+                    if (!r.segment()) {
+                        return false;
+                    }
+                    break;
+            }
+
+            pos_ = r.position();
+            scan_end_search_ = 0;
+        }
+
+        return true;
+    }
+
+    // The image as of the last scan decoded.
+    std::optional<Jpeg> image() {
+        if (components_.empty() || !seen_scan_) {
+            return std::nullopt;
+        }
+
+        return to_rgba();
+    }
+
+    [[nodiscard]] bool done() const { return done_; }
+    [[nodiscard]] std::size_t scans_decoded() const { return scans_decoded_; }
+
+
+private:
+    // Whether all of the marker's data is there. Scans are only complete once
+    // the marker following their entropy-coded data has been seen.
+    bool is_complete(std::uint8_t marker, ByteReader r) {
+        if (marker == 0xD8 || marker == 0xD9 || marker == 0x01) {
+            return true;
+        }
+
+        auto const length = r.be16();
+        if (!length) {
+            return false;
+        }
+
+        // Broken, which the segment parsing will reject.
+        if (*length < 2) {
+            return true;
+        }
+
+        if (!r.bytes(*length - 2)) {
+            return false;
+        }
+
+        if (marker != 0xDA) {
+            return true;
+        }
+
+        r.seek(std::max(r.position(), scan_end_search_));
+        if (r.next_marker()) {
+            return true;
+        }
+
+        // The last byte could be the start of a marker, so it's searched again.
+        scan_end_search_ = r.position() - 1;
+        return false;
+    }
+
+    bool parse_quantization_tables(ByteReader &r) {
+        while (!r.empty()) {
+            auto pq_tq = r.u8();
+            if (!pq_tq) {
+                return false;
+            }
+
+            auto const precision = *pq_tq >> 4;
+            auto const id = *pq_tq & 0xF;
+            if (precision > 1 || id > 3) {
+                return false;
+            }
+
+            auto &table = quant_tables_[static_cast<std::size_t>(id)];
+            for (auto natural : kZigzag) {
+                auto value = precision == 0 ? r.u8().transform([](auto b) -> std::uint16_t { return b; }) : r.be16();
+                if (!value) {
+                    return false;
+                }
+                table[natural] = *value;
+            }
+        }
+
+        return true;
+    }
+
+    bool parse_huffman_tables(ByteReader &r) {
+        while (!r.empty()) {
+            auto tc_th = r.u8();
+            if (!tc_th) {
+                return false;
+            }
+
+            auto const table_class = *tc_th >> 4;
+            auto const id = *tc_th & 0xF;
+            if (table_class > 1 || id > 3) {
+                return false;
+            }
+
+            auto table = HuffmanTable::parse(r);
+            if (!table) {
+                return false;
+            }
+
+            auto &tables = table_class == 0 ? dc_tables_ : ac_tables_;
+            tables[static_cast<std::size_t>(id)] = std::move(table);
+        }
+
+        return true;
+    }
+
+    bool parse_frame(ByteReader &r, bool progressive) {
+        if (!components_.empty()) {
+            return false;
+        }
+
+        progressive_ = progressive;
+        auto precision = r.u8();
+        auto height = r.be16();
+        auto width = r.be16();
+        auto component_count = r.u8();
+        // A height of 0 means that it's defined by a DNL marker after the
+        // first scan, which isn't supported.
+        if (precision != 8 || !height || !width || *height == 0 || *width == 0
+                || (component_count != 1 && component_count != 3)) {
+            return false;
+        }
+
+        width_ = *width;
+        height_ = *height;
+        if (width_ * height_ > kMaxPixelCount) {
+            return false;
+        }
+
+        for (std::uint8_t i = 0; i < *component_count; ++i) {
+            auto id = r.u8();
+            auto sampling = r.u8();
+            auto quant_table = r.u8();
+            if (!id || !sampling || !quant_table || *quant_table > 3) {
+                return false;
+            }
+
+            std::size_t const h = *sampling >> 4;
+            std::size_t const v = *sampling & 0xF;
+            if (h < 1 || h > 4 || v < 1 || v > 4) {
+                return false;
+            }
+
+            components_.push_back(Component{.id = *id, .h = h, .v = v, .quant_table = *quant_table});
+        }
+
+        for (auto const &c : components_) {
+            max_h_ = std::max(max_h_, c.h);
+            max_v_ = std::max(max_v_, c.v);
+        }
+
+        // Scaling down by up to 8x is done by only using the lower frequencies
+        // of each block, w/ anything left over handled by a downscaler at the
+        // end. The downscaler only gets the samples fully inside the image.
+        if (max_size_) {
+            auto const target = fit_within(
+                    {static_cast<std::uint32_t>(width_), static_cast<std::uint32_t>(height_)}, *max_size_);
+            for (std::size_t block_size : {1, 2, 4}) {
+                if (width_ * block_size / 8 >= target.width && height_ * block_size / 8 >= target.height) {
+                    block_size_ = block_size;
+                    break;
+                }
+            }
+        }
+
+        mcus_x_ = div_ceil(width_, 8 * max_h_);
+        mcus_y_ = div_ceil(height_, 8 * max_v_);
+        for (auto &c : components_) {
+            // Only integral upsampling factors are supported.
+            if (max_h_ % c.h != 0 || max_v_ % c.v != 0) {
+                return false;
+            }
+
+            c.width = div_ceil(width_ * c.h, max_h_);
+            c.height = div_ceil(height_ * c.v, max_v_);
+            c.used_blocks_x = div_ceil(c.width, 8);
+            c.used_blocks_y = div_ceil(c.height, 8);
+            c.blocks_x = mcus_x_ * c.h;
+            c.blocks_y = mcus_y_ * c.v;
+            c.coefficient_rows = progressive_ ? c.blocks_y : c.v;
+            c.coefficients.resize(c.blocks_x * c.coefficient_rows * 64);
+            // Components missing from the image end up gray.
+            c.samples_stride = c.blocks_x * block_size_;
+            c.samples.resize(c.samples_stride * c.blocks_y * block_size_, 128);
+        }
+
+        return true;
+    }
+
+    std::optional<Scan> parse_scan(ByteReader &r) {
+        auto component_count = r.u8();
+        if (components_.empty() || !component_count || *component_count < 1 || *component_count > 4) {
+            return std::nullopt;
+        }
+
+        Scan scan{};
+        for (std::uint8_t i = 0; i < *component_count; ++i) {
+            auto id = r.u8();
+            auto tables = r.u8();
+            if (!id || !tables) {
+                return std::nullopt;
+            }
+
+            auto it = std::ranges::find(components_, *id, &Component::id);
+            if (it == components_.end() || std::ranges::find(scan.components, &*it) != scan.components.end()) {
+                return std::nullopt;
+            }
+
+            it->dc_table = *tables >> 4;
+            it->ac_table = *tables & 0xF;
+            if (it->dc_table > 3 || it->ac_table > 3) {
+                return std::nullopt;
+            }
+
+            if (!it->idct_table) {
+                it->quant = quant_tables_[it->quant_table];
+                it->idct_table = jpeg::make_idct_table(it->quant);
+            }
+
+            scan.components.push_back(&*it);
+        }
+
+        auto spectral_start = r.u8();
+        auto spectral_end = r.u8();
+        auto successive = r.u8();
+        if (!spectral_start || !spectral_end || !successive) {
+            return std::nullopt;
+        }
+
+        scan.spectral_start = *spectral_start;
+        scan.spectral_end = *spectral_end;
+        scan.successive_high = *successive >> 4;
+        scan.successive_low = *successive & 0xF;
+
+        if (!progressive_) {
+            scan.spectral_start = 0;
+            scan.spectral_end = 63;
+            scan.successive_high = 0;
+            scan.successive_low = 0;
+        } else if (scan.spectral_start > scan.spectral_end || scan.spectral_end > 63 || scan.successive_high > 13
+                || scan.successive_low > 13
+                // DC and AC coefficients are never mixed in a scan, and AC
+                // scans only have a single component.
+                || (scan.spectral_start == 0 && scan.spectral_end != 0)
+                || (scan.spectral_start != 0 && scan.components.size() != 1)) {
+            return std::nullopt;
+        }
+
+        // Check that all tables needed are there.
+        bool const needs_dc = !progressive_ || (scan.spectral_start == 0 && scan.successive_high == 0);
+        bool const needs_ac = !progressive_ || scan.spectral_start != 0;
+        for (auto const *c : scan.components) {
+            if ((needs_dc && !dc_tables_[c->dc_table]) || (needs_ac && !ac_tables_[c->ac_table])) {
+                return std::nullopt;
+            }
+        }
+
+        return scan;
+    }
+
+    void parse_adobe(ByteReader &r) {
+        auto identifier = r.bytes(5);
+        if (!identifier || !std::ranges::equal(*identifier, "Adobe"sv)) {
+            return;
+        }
+
+        // Version, flags0, and flags1 come before the transform.
+        if (!r.bytes(6)) {
+            return;
+        }
+
+        adobe_transform_ = r.u8();
+    }
+
+    // https://www.w3.org/Graphics/JPEG/itu-t81.pdf, Annex G for the
+    // progressive bits.
+    bool decode_scan(Scan const &scan, BitReader &bits) {
+        seen_scan_ = true;
+        eob_run_ = 0;
+        for (auto *c : scan.components) {
+            c->dc_pred = 0;
+        }
+
+        std::size_t mcu = 0;
+        auto handle_restart = [&] {
+            if (restart_interval_ != 0 && mcu != 0 && mcu % restart_interval_ == 0) {
+                bits.restart();
+                eob_run_ = 0;
+                for (auto *c : scan.components) {
+                    c->dc_pred = 0;
+                }
+            }
+            ++mcu;
+        };
+
+        // Non-interleaved scans go through the blocks of a single component
+        // one by one, w/o any MCU padding.
+        if (scan.components.size() == 1) {
+            auto &c = *scan.components[0];
+            for (std::size_t y = 0; y < c.used_blocks_y; ++y) {
+                for (std::size_t x = 0; x < c.used_blocks_x; ++x) {
+                    handle_restart();
+                    if (!decode_block(scan, c, c.block(x, y), bits)) {
+                        return false;
+                    }
+                }
+
+                if (!progressive_) {
+                    transform_blocks(c, y, y + 1);
+                }
+            }
+            return true;
+        }
+
+        for (std::size_t mcu_y = 0; mcu_y < mcus_y_; ++mcu_y) {
+            for (std::size_t mcu_x = 0; mcu_x < mcus_x_; ++mcu_x) {
+                handle_restart();
+                for (auto *c : scan.components) {
+                    for (std::size_t v = 0; v < c->v; ++v) {
+                        for (std::size_t h = 0; h < c->h; ++h) {
+                            if (!decode_block(scan, *c, c->block(mcu_x * c->h + h, mcu_y * c->v + v), bits)) {
+                                return false;
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (!progressive_) {
+                for (auto *c : scan.components) {
+                    transform_blocks(*c, mcu_y * c->v, (mcu_y + 1) * c->v);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool decode_block(Scan const &scan, Component &c, std::span<std::int16_t, 64> block, BitReader &bits) {
+        if (!progressive_) {
+            return decode_block_baseline(c, block, bits);
+        }
+
+        if (scan.spectral_start == 0) {
+            if (scan.successive_high == 0) {
+                return decode_dc_first(c, block, bits, scan.successive_low);
+            }
+
+            // DC refinement.
+            if (bits.get_bit()) {
+                block[0] = static_cast<std::int16_t>(block[0] | (1 << scan.successive_low));
+            }
+            return true;
+        }
+
+        if (scan.successive_high == 0) {
+            return decode_ac_first(scan, c, block, bits);
+        }
+
+        return decode_ac_refine(scan, c, block, bits);
+    }
+
+    bool decode_dc(Component &c, BitReader &bits) {
+        auto size = dc_tables_[c.dc_table]->decode(bits);
+        if (!size || *size > 16) {
+            return false;
+        }
+
+        // Valid DC values fit in 16 bits, and wrapping keeps broken images
+        // from overflowing the predictor.
+        c.dc_pred = static_cast<std::int16_t>(c.dc_pred + bits.receive_extend(*size));
+        return true;
+    }
+
+    bool decode_block_baseline(Component &c, std::span<std::int16_t, 64> block, BitReader &bits) {
+        std::ranges::fill(block, std::int16_t{0});
+        if (!decode_dc(c, bits)) {
+            return false;
+        }
+        block[0] = static_cast<std::int16_t>(c.dc_pred);
+
+        auto const &ac = *ac_tables_[c.ac_table];
+        for (std::size_t k = 1; k < 64;) {
+            auto rs = ac.decode(bits);
+            if (!rs) {
+                return false;
+            }
+
+            auto const run = *rs >> 4;
+            auto const size = *rs & 0xF;
+            if (size == 0) {
+                if (run != 15) {
+                    break; // End of block.
+                }
+                k += 16;
+                continue;
+            }
+
+            k += run;
+            if (k > 63) {
+                return false;
+            }
+
+            block[kZigzag[k++]] = static_cast<std::int16_t>(bits.receive_extend(size));
+        }
+
+        return true;
+    }
+
+    bool decode_dc_first(Component &c, std::span<std::int16_t, 64> block, BitReader &bits, int successive_low) {
+        if (!decode_dc(c, bits)) {
+            return false;
+        }
+
+        block[0] = static_cast<std::int16_t>(c.dc_pred * (1 << successive_low));
+        return true;
+    }
+
+    bool decode_ac_first(Scan const &scan, Component &c, std::span<std::int16_t, 64> block, BitReader &bits) {
+        if (eob_run_ > 0) {
+            --eob_run_;
+            return true;
+        }
+
+        auto const &ac = *ac_tables_[c.ac_table];
+        for (std::size_t k = scan.spectral_start; k <= scan.spectral_end; ++k) {
+            auto rs = ac.decode(bits);
+            if (!rs) {
+                return false;
+            }
+
+            auto const run = *rs >> 4;
+            auto const size = *rs & 0xF;
+            if (size == 0) {
+                if (run < 15) {
+                    // End of band, for this and the following eob_run_ blocks.
+                    eob_run_ = (1u << run) - 1 + bits.get(run);
+                    break;
+                }
+                k += 15;
+                continue;
+            }
+
+            k += run;
+            if (k > 63) {
+                return false;
+            }
+
+            block[kZigzag[k]] = static_cast<std::int16_t>(bits.receive_extend(size) * (1 << scan.successive_low));
+        }
+
+        return true;
+    }
+
+    bool decode_ac_refine(Scan const &scan, Component &c, std::span<std::int16_t, 64> block, BitReader &bits) {
+        auto const bit = 1 << scan.successive_low;
+        auto refine = [&](std::int16_t &coefficient) {
+            if (bits.get_bit() && (coefficient & bit) == 0) {
+                coefficient = static_cast<std::int16_t>(coefficient + (coefficient > 0 ? bit : -bit));
+            }
+        };
+
+        std::size_t k = scan.spectral_start;
+        if (eob_run_ > 0) {
+            --eob_run_;
+            for (; k <= scan.spectral_end; ++k) {
+                if (auto &coefficient = block[kZigzag[k]]; coefficient != 0) {
+                    refine(coefficient);
+                }
+            }
+            return true;
+        }
+
+        auto const &ac = *ac_tables_[c.ac_table];
+        while (k <= scan.spectral_end) {
+            auto rs = ac.decode(bits);
+            if (!rs) {
+                return false;
+            }
+
+            auto run = *rs >> 4;
+            auto const size = *rs & 0xF;
+            int value = 0;
+            if (size == 0) {
+                if (run < 15) {
+                    eob_run_ = (1u << run) - 1 + bits.get(run);
+                    // Refine whatever's left of this block.
+                    run = 64;
+                }
+                // Otherwise, it's a run of 16 zeros, which is handled like any
+                // other run, but w/o a new coefficient at the end.
+            } else {
+                if (size != 1) {
+                    return false;
+                }
+                value = bits.get_bit() ? bit : -bit;
+            }
+
+            // Skip `run` zero coefficients, refining the non-zero ones passed
+            // on the way, and place the new coefficient after them.
+            while (k <= scan.spectral_end) {
+                auto &coefficient = block[kZigzag[k++]];
+                if (coefficient != 0) {
+                    refine(coefficient);
+                } else if (run == 0) {
+                    coefficient = static_cast<std::int16_t>(value);
+                    break;
+                } else {
+                    --run;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // Turns the coefficients of the block rows [first, last) into samples.
+    void transform_blocks(Component &c, std::size_t first, std::size_t last) const {
+        static constexpr jpeg::IdctTable kNoTable{};
+        auto const kernels = jpeg::best_kernels();
+        auto const &table = c.idct_table ? *c.idct_table : kNoTable;
+        for (std::size_t y = first; y < std::min(last, c.used_blocks_y); ++y) {
+            for (std::size_t x = 0; x < c.used_blocks_x; ++x) {
+                auto *out = c.samples.data() + (y * c.samples_stride + x) * block_size_;
+                if (block_size_ == 8) {
+                    jpeg::idct(kernels, c.block(x, y), table, out, c.samples_stride);
+                } else {
+                    jpeg::idct_scaled(c.block(x, y), c.quant, block_size_, out, c.samples_stride);
+                }
+            }
+        }
+    }
+
+    // Upsamples row y of a component to full resolution, using the same
+    // triangle filters as libjpeg for 2x upsampling, and box filters
+    // otherwise.
+    void upsample_row(Component const &c, std::size_t y, std::span<std::uint8_t> out, std::vector<int> &scratch) const {
+        auto const width = div_ceil(c.width * block_size_, 8);
+        auto const height = div_ceil(c.height * block_size_, 8);
+        auto const h_factor = max_h_ / c.h;
+        auto const v_factor = max_v_ / c.v;
+        auto const row_at = [&](std::size_t row) {
+            return std::span{c.samples}.subspan(std::min(row, height - 1) * c.samples_stride, width);
+        };
+
+        if (h_factor == 1 && v_factor == 1) {
+            std::ranges::copy(row_at(y).first(out.size()), out.begin());
+            return;
+        }
+
+        if ((h_factor != 1 && h_factor != 2) || (v_factor != 1 && v_factor != 2)) {
+            auto const row = row_at(y / v_factor);
+            for (std::size_t x = 0; x < out.size(); ++x) {
+                out[x] = row[x / h_factor];
+            }
+            return;
+        }
+
+        // Vertical pass, scaled by 4 if upsampling vertically.
+        auto &sums = scratch;
+        sums.resize(width);
+        auto const nearest = row_at(y / v_factor);
+        if (v_factor == 1) {
+            std::ranges::copy(nearest, sums.begin());
+        } else {
+            auto const source_y = y / 2;
+            auto const next_nearest = y % 2 == 0 ? row_at(source_y == 0 ? 0 : source_y - 1) : row_at(source_y + 1);
+            for (std::size_t x = 0; x < width; ++x) {
+                sums[x] = nearest[x] * 3 + next_nearest[x];
+            }
+        }
+
+        if (h_factor == 1) {
+            auto const bias = y % 2 == 0 ? 1 : 2;
+            for (std::size_t x = 0; x < out.size(); ++x) {
+                out[x] = static_cast<std::uint8_t>((sums[x] + bias) >> 2);
+            }
+            return;
+        }
+
+        // Horizontal pass, w/ the edge samples repeated.
+        auto const last = width - 1;
+        for (std::size_t x = 0; x < out.size(); ++x) {
+            auto const source_x = x / 2;
+            auto const neighbour_x = x % 2 == 0 ? (source_x == 0 ? 0 : source_x - 1) : std::min(source_x + 1, last);
+            auto const neighbour = sums[neighbour_x];
+            auto const sum = sums[source_x] * 3 + neighbour;
+            if (v_factor == 1) {
+                out[x] = static_cast<std::uint8_t>((sum + (x % 2 == 0 ? 1 : 2)) >> 2);
+            } else {
+                out[x] = static_cast<std::uint8_t>((sum + (x % 2 == 0 ? 8 : 7)) >> 4);
+            }
+        }
+    }
+
+    std::optional<Jpeg> to_rgba() {
+        if (progressive_) {
+            for (auto &c : components_) {
+                transform_blocks(c, 0, c.used_blocks_y);
+            }
+        }
+
+        auto const width = div_ceil(width_ * block_size_, 8);
+        auto const height = div_ceil(height_ * block_size_, 8);
+        std::array<std::vector<std::uint8_t>, 3> rows{};
+        for (std::size_t i = 0; i < components_.size(); ++i) {
+            rows[i].resize(width);
+        }
+
+        // Adobe's transform flag takes precedence, and w/o it, component ids
+        // spelling out RGB are the only hint that it's not YCbCr.
+        bool const is_rgb = components_.size() == 3
+                && (adobe_transform_ ? *adobe_transform_ == 0
+                                     : (components_[0].id == 'R' && components_[1].id == 'G'
+                                               && components_[2].id == 'B'));
+
+        // Whatever scaling the IDCT couldn't do is done a row at a time. The
+        // IDCT rounds the size up, so the last row and column of samples can
+        // be partially outside of the image. Those are left out when
+        // downscaling so that they don't distort it.
+        ImageSize const size{static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height)};
+        auto const output_size = max_size_
+                ? fit_within({static_cast<std::uint32_t>(width_), static_cast<std::uint32_t>(height_)}, *max_size_)
+                : size;
+        std::optional<Downscaler> downscaler;
+        std::vector<unsigned char> rgba;
+        ImageSize cropped = size;
+        if (output_size != size) {
+            cropped = {static_cast<std::uint32_t>(width_ * block_size_ / 8),
+                    static_cast<std::uint32_t>(height_ * block_size_ / 8)};
+            downscaler.emplace(cropped, output_size);
+            rgba.resize(width * 4);
+        } else {
+            rgba.resize(width * height * 4);
+        }
+
+        auto const kernels = jpeg::best_kernels();
+        std::vector<int> scratch;
+        for (std::size_t y = 0; y < cropped.height; ++y) {
+            for (std::size_t i = 0; i < components_.size(); ++i) {
+                upsample_row(components_[i], y, rows[i], scratch);
+            }
+
+            auto *out = rgba.data() + (downscaler ? 0 : y * width * 4);
+            if (components_.size() == 1) {
+                for (std::size_t x = 0; x < width; ++x) {
+                    std::memset(out + x * 4, rows[0][x], 3);
+                    out[x * 4 + 3] = 0xFF;
+                }
+            } else if (is_rgb) {
+                for (std::size_t x = 0; x < width; ++x) {
+                    out[x * 4] = rows[0][x];
+                    out[x * 4 + 1] = rows[1][x];
+                    out[x * 4 + 2] = rows[2][x];
+                    out[x * 4 + 3] = 0xFF;
+                }
+            } else {
+                jpeg::ycbcr_to_rgba(kernels, rows[0], rows[1], rows[2], out);
+            }
+
+            if (downscaler) {
+                downscaler->add_row(std::span{rgba}.first(std::size_t{cropped.width} * 4));
+            }
+        }
+
+        return Jpeg{
+                .width = output_size.width,
+                .height = output_size.height,
+                .bytes = downscaler ? downscaler->take() : std::move(rgba),
+        };
+    }
+
+    std::optional<ImageSize> max_size_;
+    // Where the next call to advance picks up.
+    std::size_t pos_{};
+    // How far the search for the end of a partially received scan has gotten.
+    std::size_t scan_end_search_{};
+    bool done_{false};
+    std::size_t scans_decoded_{};
+    // How many samples each block is turned into in either direction.
+    std::size_t block_size_{8};
+
+    std::array<std::array<std::uint16_t, 64>, 4> quant_tables_{};
+    std::array<std::optional<HuffmanTable>, 4> dc_tables_{};
+    std::array<std::optional<HuffmanTable>, 4> ac_tables_{};
+    std::size_t restart_interval_{};
+    std::optional<std::uint8_t> adobe_transform_;
+
+    bool progressive_{false};
+    bool seen_scan_{false};
+    std::size_t width_{};
+    std::size_t height_{};
+    std::size_t max_h_{};
+    std::size_t max_v_{};
+    std::size_t mcus_x_{};
+    std::size_t mcus_y_{};
+    std::vector<Component> components_;
+    std::uint32_t eob_run_{};
+};
+
 } // namespace
 
+std::optional<Jpeg> Jpeg::from(std::istream &is) {
+    std::ostringstream ss;
+    ss << is.rdbuf();
+    auto const data = std::move(ss).str();
+    return from(std::as_bytes(std::span{data}));
+}
+
+std::optional<Jpeg> Jpeg::from(std::istream &is, ImageSize max_size) {
+    std::ostringstream ss;
+    ss << is.rdbuf();
+    auto const data = std::move(ss).str();
+    return from(std::as_bytes(std::span{data}), max_size);
+}
+
+std::optional<Jpeg> Jpeg::from(std::span<std::byte const> data) {
+    return Decoder{std::nullopt}.decode({reinterpret_cast<std::uint8_t const *>(data.data()), data.size()});
+}
+
+std::optional<Jpeg> Jpeg::from(std::span<std::byte const> data, ImageSize max_size) {
+    return Decoder{max_size}.decode({reinterpret_cast<std::uint8_t const *>(data.data()), data.size()});
+}
+
+struct JpegDecoder::Impl {
+    std::vector<std::uint8_t> data;
+    Decoder decoder{std::nullopt};
+    bool failed{false};
+};
+
+JpegDecoder::JpegDecoder() : impl_{std::make_unique<Impl>()} {}
+JpegDecoder::~JpegDecoder() = default;
+
+JpegDecoder::JpegDecoder(JpegDecoder &&) noexcept = default;
+JpegDecoder &JpegDecoder::operator=(JpegDecoder &&) noexcept = default;
+
+bool JpegDecoder::feed(std::span<std::byte const> data) {
+    auto &d = *impl_;
+    if (d.failed) {
+        return false;
+    }
+
+    if (d.decoder.done()) {
+        return true;
+    }
+
+    auto const *bytes = reinterpret_cast<std::uint8_t const *>(data.data());
+    d.data.insert(d.data.end(), bytes, bytes + data.size());
+    d.failed = !d.decoder.advance(d.data, true);
+    return !d.failed;
+}
+
+std::size_t JpegDecoder::scans_decoded() const {
+    return impl_->decoder.scans_decoded();
+}
+
+bool JpegDecoder::done() const {
+    return impl_->decoder.done();
+}
+
+std::optional<Jpeg> JpegDecoder::image() {
+    return impl_->decoder.image();
+}
+
 std::optional<Jpeg> Jpeg::thumbnail_from(std::istream &is) {
     std::uint16_t marker{};
     if (!read_be(is, marker) || marker != StartOfImage::kMarker) {
@@ -2,9 +2,17 @@
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
+#ifndef IMG_JPEG_H_
+#define IMG_JPEG_H_
+
+#include "img/scale.h"
+
+#include <cstddef>
 #include <cstdint>
 #include <iosfwd>
+#include <memory>
 #include <optional>
+#include <span>
 #include <vector>
 
 namespace img {
@@ -13,6 +21,19 @@ namespace img {
 // https://www.w3.org/Graphics/JPEG/itu-t81.pdf
 class Jpeg {
 public:
+    // Decodes baseline and progressive Huffman-coded JPEGs w/ 1 (grayscale) or
+    // 3 (YCbCr or RGB) components.
+    static std::optional<Jpeg> from(std::istream &&is) { return from(is); }
+    static std::optional<Jpeg> from(std::istream &);
+    static std::optional<Jpeg> from(std::span<std::byte const>);
+
+    // Decodes the image scaled down to fit in max_size. Scaling by up to 8x
+    // is done by decoding fewer frequencies, and sequential images are only
+    // kept a row of blocks at a time at full size.
+    static std::optional<Jpeg> from(std::istream &&is, ImageSize max_size) { return from(is, max_size); }
+    static std::optional<Jpeg> from(std::istream &, ImageSize max_size);
+    static std::optional<Jpeg> from(std::span<std::byte const>, ImageSize max_size);
+
     static std::optional<Jpeg> thumbnail_from(std::istream &&is) { return thumbnail_from(is); }
     static std::optional<Jpeg> thumbnail_from(std::istream &);
 
@@ -23,4 +44,32 @@ public:
     [[nodiscard]] bool operator==(Jpeg const &) const = default;
 };
 
+// Decodes a JPEG as its data comes in. Progressive JPEGs get sharper w/ every
+// scan, so they can be shown as soon as their first scan is done.
+class JpegDecoder {
+public:
+    JpegDecoder();
+    ~JpegDecoder();
+
+    JpegDecoder(JpegDecoder &&) noexcept;
+    JpegDecoder &operator=(JpegDecoder &&) noexcept;
+
+    // Returns false if the data is broken, after which nothing more is decoded.
+    bool feed(std::span<std::byte const>);
+
+    [[nodiscard]] std::size_t scans_decoded() const;
+    [[nodiscard]] bool done() const;
+
+    // The image as of the last scan decoded, or nothing before the first one.
+    // This converts the whole image every time, so it's best only called when
+    // scans_decoded has changed.
+    [[nodiscard]] std::optional<Jpeg> image();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
 } // namespace img
+
+#endif
@@ -0,0 +1,101 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "img/jpeg.h"
+#include "img/jpeg_kernels.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+template<typename F>
+double mb_per_s(std::size_t bytes, int iterations, F &&f) {
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        f();
+    }
+    std::chrono::duration<double> const duration = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(bytes) * iterations / duration.count() / 1'000'000.;
+}
+
+char const *name(img::jpeg::Kernels kernels) {
+    switch (kernels) {
+        case img::jpeg::Kernels::Scalar:
+            return "scalar";
+        case img::jpeg::Kernels::Sse2:
+            return "sse2";
+        case img::jpeg::Kernels::Avx2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+// Measures the throughput of the IDCT and color conversion kernels, and of
+// decoding a JPEG if one is given, in MB of output per second.
+int main(int argc, char **argv) {
+    int const iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    constexpr std::size_t kBlocks = 4096;
+    std::vector<std::array<std::int16_t, 64>> blocks(kBlocks);
+    std::uint32_t noise = 1;
+    for (auto &block : blocks) {
+        for (std::size_t i = 0; i < block.size(); ++i) {
+            noise = noise * 1664525 + 1013904223;
+            block[i] = static_cast<std::int16_t>(static_cast<int>(noise >> 24) / static_cast<int>(1 + i) - 64);
+        }
+    }
+
+    std::array<std::uint16_t, 64> quant{};
+    quant.fill(4);
+    auto const table = img::jpeg::make_idct_table(quant);
+    std::vector<std::uint8_t> samples(kBlocks * 64);
+    std::vector<std::uint8_t> rgba(samples.size() * 4);
+
+    for (auto kernels : img::jpeg::available_kernels()) {
+        auto const idct = mb_per_s(samples.size(), iterations * 10, [&] {
+            for (std::size_t i = 0; i < kBlocks; ++i) {
+                img::jpeg::idct(kernels, blocks[i], table, samples.data() + i * 64, 8);
+            }
+        });
+        auto const color = mb_per_s(rgba.size(), iterations * 10, [&] {
+            img::jpeg::ycbcr_to_rgba(kernels, samples, samples, samples, rgba.data()); //
+        });
+        std::cout << name(kernels) << "\n";
+        std::cout << "  idct: " << idct << " MB/s\n";
+        std::cout << "  ycbcr to rgba: " << color << " MB/s\n";
+    }
+
+    if (argc < 2) {
+        std::cout << "Pass a JPEG to also measure decoding it\n";
+        return 0;
+    }
+
+    std::ifstream file{argv[1], std::ios::binary};
+    std::stringstream ss;
+    ss << file.rdbuf();
+    auto const data = std::move(ss).str();
+    auto jpeg = img::Jpeg::from(std::as_bytes(std::span{data}));
+    if (!jpeg) {
+        std::cerr << "Unable to decode " << argv[1] << '\n';
+        return 1;
+    }
+
+    auto const decode = mb_per_s(jpeg->bytes.size(), iterations, [&] {
+        jpeg = img::Jpeg::from(std::as_bytes(std::span{data})); //
+    });
+    std::cout << argv[1] << " " << jpeg->width << "x" << jpeg->height << ", " << data.size() << " bytes\n";
+    std::cout << "  decode: " << decode << " MB/s\n";
+}
@@ -6,6 +6,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <span>
 #include <sstream>
 #include <string>
 #include <tuple>
@@ -15,5 +16,6 @@ extern "C" int LLVMFuzzerTestOneInput(std::uint8_t const *data, std::size_t size
 extern "C" int LLVMFuzzerTestOneInput(std::uint8_t const *data, std::size_t size) {
     std::ignore = img::Jpeg::thumbnail_from( //
             std::stringstream{std::string{reinterpret_cast<char const *>(data), size}});
+    std::ignore = img::Jpeg::from(std::span{reinterpret_cast<std::byte const *>(data), size});
     return 0;
 }
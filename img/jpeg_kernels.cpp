@@ -0,0 +1,397 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "img/jpeg_kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numbers>
+#include <span>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define IMG_JPEG_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define IMG_JPEG_AVX2
+#include <immintrin.h>
+#endif
+
+// Fusing multiplies and adds in only some of the kernels would make their
+// output differ.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#endif
+
+namespace img::jpeg {
+namespace {
+
+constexpr std::array kAvailableKernels{
+        Kernels::Scalar,
+#ifdef IMG_JPEG_SSE2
+        Kernels::Sse2,
+#endif
+#ifdef IMG_JPEG_AVX2
+        Kernels::Avx2,
+#endif
+};
+
+// Each backend provides a vector type w/ the arithmetic operators, and the
+// loads and stores needed by the kernels. Stores to bytes clamp to [0, 255] and
+// round to nearest, w/ ties to even.
+struct Scalar {
+    using V = float;
+    static constexpr std::size_t kLanes = 1;
+
+    static V splat(float f) { return f; }
+    static V load(float const *p) { return *p; }
+    static V load(std::int16_t const *p) { return static_cast<float>(*p); }
+    static V load(std::uint8_t const *p) { return static_cast<float>(*p); }
+    static void store(float *p, V v) { *p = v; }
+
+    static std::uint8_t to_byte(V v) { return static_cast<std::uint8_t>(std::lrint(std::clamp(v, 0.f, 255.f))); }
+    static void store_bytes(std::uint8_t *p, V v) { *p = to_byte(v); }
+    static void store_rgba(std::uint8_t *p, V r, V g, V b) {
+        p[0] = to_byte(r);
+        p[1] = to_byte(g);
+        p[2] = to_byte(b);
+        p[3] = 255;
+    }
+};
+
+#ifdef IMG_JPEG_SSE2
+struct Sse2 {
+    struct V {
+        __m128 v;
+        friend V operator+(V a, V b) { return {_mm_add_ps(a.v, b.v)}; }
+        friend V operator-(V a, V b) { return {_mm_sub_ps(a.v, b.v)}; }
+        friend V operator*(V a, V b) { return {_mm_mul_ps(a.v, b.v)}; }
+    };
+    static constexpr std::size_t kLanes = 4;
+
+    static V splat(float f) { return {_mm_set1_ps(f)}; }
+    static V load(float const *p) { return {_mm_loadu_ps(p)}; }
+    static V load(std::int16_t const *p) {
+        auto const v = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(p));
+        // Sign-extend to 32 bits.
+        return {_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16))};
+    }
+    static V load(std::uint8_t const *p) {
+        std::int32_t bytes{};
+        std::memcpy(&bytes, p, sizeof(bytes));
+        auto const zero = _mm_setzero_si128();
+        auto const v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+        return {_mm_cvtepi32_ps(v)};
+    }
+    static void store(float *p, V v) { _mm_storeu_ps(p, v.v); }
+
+    // The bytes end up in the low 4 bytes.
+    static __m128i to_bytes(V v) {
+        auto const clamped = _mm_min_ps(_mm_max_ps(v.v, _mm_setzero_ps()), _mm_set1_ps(255.f));
+        auto const words = _mm_packs_epi32(_mm_cvtps_epi32(clamped), _mm_setzero_si128());
+        return _mm_packus_epi16(words, words);
+    }
+    static void store_bytes(std::uint8_t *p, V v) {
+        auto const bytes = _mm_cvtsi128_si32(to_bytes(v));
+        std::memcpy(p, &bytes, sizeof(bytes));
+    }
+    static void store_rgba(std::uint8_t *p, V r, V g, V b) {
+        auto const rg = _mm_unpacklo_epi8(to_bytes(r), to_bytes(g));
+        auto const ba = _mm_unpacklo_epi8(to_bytes(b), _mm_set1_epi8(static_cast<char>(255)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_unpacklo_epi16(rg, ba));
+    }
+};
+#endif
+
+#ifdef IMG_JPEG_AVX2
+struct Avx2 {
+    struct V {
+        __m256 v;
+        friend V operator+(V a, V b) { return {_mm256_add_ps(a.v, b.v)}; }
+        friend V operator-(V a, V b) { return {_mm256_sub_ps(a.v, b.v)}; }
+        friend V operator*(V a, V b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    };
+    static constexpr std::size_t kLanes = 8;
+
+    static V splat(float f) { return {_mm256_set1_ps(f)}; }
+    static V load(float const *p) { return {_mm256_loadu_ps(p)}; }
+    static V load(std::int16_t const *p) {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+        return {_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v))};
+    }
+    static V load(std::uint8_t const *p) {
+        auto const v = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(p));
+        return {_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v))};
+    }
+    static void store(float *p, V v) { _mm256_storeu_ps(p, v.v); }
+
+    // The bytes end up in the low 8 bytes.
+    static __m128i to_bytes(V v) {
+        auto const clamped = _mm256_min_ps(_mm256_max_ps(v.v, _mm256_setzero_ps()), _mm256_set1_ps(255.f));
+        auto const dwords = _mm256_cvtps_epi32(clamped);
+        auto const words = _mm_packs_epi32(_mm256_castsi256_si128(dwords), _mm256_extracti128_si256(dwords, 1));
+        return _mm_packus_epi16(words, words);
+    }
+    static void store_bytes(std::uint8_t *p, V v) { _mm_storel_epi64(reinterpret_cast<__m128i *>(p), to_bytes(v)); }
+    static void store_rgba(std::uint8_t *p, V r, V g, V b) {
+        auto const rg = _mm_unpacklo_epi8(to_bytes(r), to_bytes(g));
+        auto const ba = _mm_unpacklo_epi8(to_bytes(b), _mm_set1_epi8(static_cast<char>(255)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+};
+#endif
+
+// The AAN (Arai, Agui, Nakajima) IDCT, as in libjpeg's jidctflt.c, but w/ the
+// scaling done by make_idct_table.
+template<typename T>
+void idct_1d(std::array<typename T::V, 8> &v) {
+    // Even part.
+    auto tmp10 = v[0] + v[4];
+    auto tmp11 = v[0] - v[4];
+    auto tmp13 = v[2] + v[6];
+    auto tmp12 = (v[2] - v[6]) * T::splat(1.414213562f) - tmp13;
+
+    auto const tmp0 = tmp10 + tmp13;
+    auto const tmp3 = tmp10 - tmp13;
+    auto const tmp1 = tmp11 + tmp12;
+    auto const tmp2 = tmp11 - tmp12;
+
+    // Odd part.
+    auto const z13 = v[5] + v[3];
+    auto const z10 = v[5] - v[3];
+    auto const z11 = v[1] + v[7];
+    auto const z12 = v[1] - v[7];
+
+    auto const tmp7 = z11 + z13;
+    tmp11 = (z11 - z13) * T::splat(1.414213562f);
+
+    auto const z5 = (z10 + z12) * T::splat(1.847759065f);
+    tmp10 = z12 * T::splat(1.082392200f) - z5;
+    tmp12 = z10 * T::splat(-2.613125930f) + z5;
+
+    auto const tmp6 = tmp12 - tmp7;
+    auto const tmp5 = tmp11 - tmp6;
+    auto const tmp4 = tmp10 + tmp5;
+
+    v[0] = tmp0 + tmp7;
+    v[7] = tmp0 - tmp7;
+    v[1] = tmp1 + tmp6;
+    v[6] = tmp1 - tmp6;
+    v[2] = tmp2 + tmp5;
+    v[5] = tmp2 - tmp5;
+    v[4] = tmp3 + tmp4;
+    v[3] = tmp3 - tmp4;
+}
+
+void transpose(std::array<float, 64> &block) {
+    for (std::size_t row = 0; row < 8; ++row) {
+        for (std::size_t col = row + 1; col < 8; ++col) {
+            std::swap(block[row * 8 + col], block[col * 8 + row]);
+        }
+    }
+}
+
+// Runs the 1-D IDCT on all columns, T::kLanes columns at a time.
+template<typename T, typename In>
+void idct_columns(In const *in, float const *multipliers, std::array<float, 64> &out) {
+    for (std::size_t col = 0; col < 8; col += T::kLanes) {
+        std::array<typename T::V, 8> v{};
+        for (std::size_t row = 0; row < 8; ++row) {
+            v[row] = T::load(in + row * 8 + col);
+            if (multipliers != nullptr) {
+                v[row] = v[row] * T::load(multipliers + row * 8 + col);
+            }
+        }
+
+        idct_1d<T>(v);
+        for (std::size_t row = 0; row < 8; ++row) {
+            T::store(out.data() + row * 8 + col, v[row]);
+        }
+    }
+}
+
+template<typename T>
+void idct_impl(std::span<std::int16_t const, 64> coefficients,
+        IdctTable const &table,
+        std::uint8_t *out,
+        std::size_t stride) {
+    std::array<float, 64> columns_done{};
+    idct_columns<T>(coefficients.data(), table.data(), columns_done);
+
+    // The rows are transformed as columns of the transposed block.
+    transpose(columns_done);
+    std::array<float, 64> done{};
+    idct_columns<T, float>(columns_done.data(), nullptr, done);
+    transpose(done);
+
+    auto const level_shift = T::splat(128.f);
+    for (std::size_t row = 0; row < 8; ++row) {
+        for (std::size_t col = 0; col < 8; col += T::kLanes) {
+            T::store_bytes(out + row * stride + col, T::load(done.data() + row * 8 + col) + level_shift);
+        }
+    }
+}
+
+// Returns how many pixels were converted, which is a multiple of T::kLanes.
+template<typename T>
+std::size_t ycbcr_to_rgba_impl(std::span<std::uint8_t const> y,
+        std::span<std::uint8_t const> cb,
+        std::span<std::uint8_t const> cr,
+        std::uint8_t *rgba) {
+    auto const offset = T::splat(128.f);
+    auto const count = y.size() / T::kLanes * T::kLanes;
+    for (std::size_t i = 0; i < count; i += T::kLanes) {
+        auto const luma = T::load(y.data() + i);
+        auto const blue = T::load(cb.data() + i) - offset;
+        auto const red = T::load(cr.data() + i) - offset;
+        T::store_rgba(rgba + i * 4,
+                luma + red * T::splat(1.402f),
+                luma - blue * T::splat(0.344136f) - red * T::splat(0.714136f),
+                luma + blue * T::splat(1.772f));
+    }
+    return count;
+}
+
+} // namespace
+
+std::span<Kernels const> available_kernels() {
+    return kAvailableKernels;
+}
+
+IdctTable make_idct_table(std::array<std::uint16_t, 64> const &quant) {
+    static auto const kScaleFactors = [] {
+        std::array<double, 8> factors{1.};
+        for (std::size_t k = 1; k < factors.size(); ++k) {
+            factors[k] = std::cos(static_cast<double>(k) * std::numbers::pi / 16.) * std::numbers::sqrt2;
+        }
+        return factors;
+    }();
+
+    IdctTable table{};
+    for (std::size_t row = 0; row < 8; ++row) {
+        for (std::size_t col = 0; col < 8; ++col) {
+            auto const i = row * 8 + col;
+            table[i] = static_cast<float>(quant[i] * kScaleFactors[row] * kScaleFactors[col] / 8.);
+        }
+    }
+    return table;
+}
+
+void idct_scaled(std::span<std::int16_t const, 64> coefficients,
+        std::array<std::uint16_t, 64> const &quant,
+        std::size_t size,
+        std::uint8_t *out,
+        std::size_t stride) {
+    assert(size == 1 || size == 2 || size == 4);
+    if (size == 1) {
+        auto const dc = std::lrint(coefficients[0] * quant[0] / 8.f + 128.f);
+        *out = static_cast<std::uint8_t>(std::clamp(dc, 0l, 255l));
+        return;
+    }
+
+    // cos((2x + 1)uπ / 2N) * C(u) / 2 for every size, w/ C(0) being 1/√2 and
+    // C(u) 1 otherwise.
+    static auto const kCosines = [] {
+        std::array<std::array<float, 16>, 5> cosines{};
+        for (std::size_t n : {2, 4}) {
+            for (std::size_t x = 0; x < n; ++x) {
+                for (std::size_t u = 0; u < n; ++u) {
+                    auto const c = u == 0 ? 1. / std::numbers::sqrt2 : 1.;
+                    auto const angle =
+                            static_cast<double>((2 * x + 1) * u) * std::numbers::pi / static_cast<double>(2 * n);
+                    cosines[n][x * n + u] = static_cast<float>(c / 2. * std::cos(angle));
+                }
+            }
+        }
+        return cosines;
+    }();
+
+    auto const &cosines = kCosines[size];
+    std::array<float, 16> dequantized{};
+    for (std::size_t v = 0; v < size; ++v) {
+        for (std::size_t u = 0; u < size; ++u) {
+            dequantized[v * size + u] = static_cast<float>(coefficients[v * 8 + u] * quant[v * 8 + u]);
+        }
+    }
+
+    // Rows, then columns.
+    std::array<float, 16> rows{};
+    for (std::size_t v = 0; v < size; ++v) {
+        for (std::size_t x = 0; x < size; ++x) {
+            float sum = 0.f;
+            for (std::size_t u = 0; u < size; ++u) {
+                sum += dequantized[v * size + u] * cosines[x * size + u];
+            }
+            rows[v * size + x] = sum;
+        }
+    }
+
+    for (std::size_t y = 0; y < size; ++y) {
+        for (std::size_t x = 0; x < size; ++x) {
+            float sum = 128.f;
+            for (std::size_t v = 0; v < size; ++v) {
+                sum += rows[v * size + x] * cosines[y * size + v];
+            }
+            out[y * stride + x] = static_cast<std::uint8_t>(std::clamp(std::lrint(sum), 0l, 255l));
+        }
+    }
+}
+
+void idct(Kernels kernels,
+        std::span<std::int16_t const, 64> coefficients,
+        IdctTable const &table,
+        std::uint8_t *out,
+        std::size_t stride) {
+    switch (kernels) {
+#ifdef IMG_JPEG_AVX2
+        case Kernels::Avx2:
+            idct_impl<Avx2>(coefficients, table, out, stride);
+            return;
+#endif
+#ifdef IMG_JPEG_SSE2
+        case Kernels::Sse2:
+            idct_impl<Sse2>(coefficients, table, out, stride);
+            return;
+#endif
+        default:
+            assert(kernels == Kernels::Scalar);
+            idct_impl<Scalar>(coefficients, table, out, stride);
+            return;
+    }
+}
+
+void ycbcr_to_rgba(Kernels kernels,
+        std::span<std::uint8_t const> y,
+        std::span<std::uint8_t const> cb,
+        std::span<std::uint8_t const> cr,
+        std::uint8_t *rgba) {
+    assert(y.size() == cb.size() && y.size() == cr.size());
+    std::size_t done = 0;
+    switch (kernels) {
+#ifdef IMG_JPEG_AVX2
+        case Kernels::Avx2:
+            done = ycbcr_to_rgba_impl<Avx2>(y, cb, cr, rgba);
+            break;
+#endif
+#ifdef IMG_JPEG_SSE2
+        case Kernels::Sse2:
+            done = ycbcr_to_rgba_impl<Sse2>(y, cb, cr, rgba);
+            break;
+#endif
+        default:
+            assert(kernels == Kernels::Scalar);
+            break;
+    }
+
+    ycbcr_to_rgba_impl<Scalar>(y.subspan(done), cb.subspan(done), cr.subspan(done), rgba + done * 4);
+}
+
+} // namespace img::jpeg
@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef IMG_JPEG_KERNELS_H_
+#define IMG_JPEG_KERNELS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace img::jpeg {
+
+// The vectorized kernels do exactly the same floating point operations in the
+// same order as the scalar ones, so they all produce identical output.
+enum class Kernels : std::uint8_t {
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+// All kernels compiled in, w/ the fastest last.
+std::span<Kernels const> available_kernels();
+
+inline Kernels best_kernels() {
+    return available_kernels().back();
+}
+
+// Dequantization, the IDCT's scale factors, and its final division by 8 are
+// all folded into a single table of multipliers.
+using IdctTable = std::array<float, 64>;
+IdctTable make_idct_table(std::array<std::uint16_t, 64> const &quant);
+
+// Transforms a block of coefficients into 8x8 level-shifted samples written
+// `stride` bytes apart. Both the coefficients and the quantization table are in
+// natural (row-major) order.
+void idct(Kernels, std::span<std::int16_t const, 64>, IdctTable const &, std::uint8_t *out, std::size_t stride);
+
+// Like idct, but only uses the lowest frequencies to produce a size x size
+// block, for decoding images scaled down by 8 / size. Size has to be 1, 2, or 4.
+void idct_scaled(std::span<std::int16_t const, 64>,
+        std::array<std::uint16_t, 64> const &quant,
+        std::size_t size,
+        std::uint8_t *out,
+        std::size_t stride);
+
+// Converts full-resolution rows of JFIF YCbCr samples into RGBA.
+void ycbcr_to_rgba(Kernels,
+        std::span<std::uint8_t const> y,
+        std::span<std::uint8_t const> cb,
+        std::span<std::uint8_t const> cr,
+        std::uint8_t *rgba);
+
+} // namespace img::jpeg
+
+#endif
@@ -0,0 +1,257 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "img/jpeg_kernels.h"
+
+#include "etest/etest2.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <numbers>
+#include <span>
+#include <vector>
+
+namespace {
+
+std::array<std::uint16_t, 64> flat_quant(std::uint16_t q) {
+    std::array<std::uint16_t, 64> quant{};
+    quant.fill(q);
+    return quant;
+}
+
+// A straightforward implementation of the IDCT from the spec.
+std::array<std::uint8_t, 64> reference_idct(std::array<std::int16_t, 64> const &coefficients) {
+    std::array<std::uint8_t, 64> out{};
+    auto c = [](int u) {
+        return u == 0 ? 1. / std::numbers::sqrt2 : 1.;
+    };
+
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            double sum = 0;
+            for (int v = 0; v < 8; ++v) {
+                for (int u = 0; u < 8; ++u) {
+                    sum += c(u) * c(v) * coefficients[static_cast<std::size_t>(v * 8 + u)]
+                            * std::cos((2 * x + 1) * u * std::numbers::pi / 16)
+                            * std::cos((2 * y + 1) * v * std::numbers::pi / 16);
+                }
+            }
+            auto const sample = std::lround(sum / 4 + 128);
+            out[static_cast<std::size_t>(y * 8 + x)] = static_cast<std::uint8_t>(std::clamp(sample, 0l, 255l));
+        }
+    }
+
+    return out;
+}
+
+std::array<std::int16_t, 64> pseudo_random_block(unsigned seed) {
+    std::array<std::int16_t, 64> block{};
+    for (std::size_t i = 0; i < block.size(); ++i) {
+        seed = seed * 1103515245 + 12345;
+        // Keep the higher frequencies smaller, like in real images.
+        auto const range = 512 / (1 + static_cast<int>(i / 8 + i % 8));
+        block[i] = static_cast<std::int16_t>(static_cast<int>((seed >> 16) % static_cast<unsigned>(range * 2)) - range);
+    }
+    return block;
+}
+
+std::array<std::uint8_t, 64> run_idct(img::jpeg::Kernels kernels,
+        std::array<std::int16_t, 64> const &coefficients,
+        img::jpeg::IdctTable const &table) {
+    std::array<std::uint8_t, 64> out{};
+    img::jpeg::idct(kernels, coefficients, table, out.data(), 8);
+    return out;
+}
+
+} // namespace
+
+int main() {
+    etest::Suite s;
+
+    s.add_test("scalar kernels are always available", [](etest::IActions &a) {
+        a.require(!img::jpeg::available_kernels().empty());
+        a.expect_eq(img::jpeg::available_kernels().front(), img::jpeg::Kernels::Scalar);
+    });
+
+    s.add_test("idct, dc only", [](etest::IActions &a) {
+        auto const table = img::jpeg::make_idct_table(flat_quant(2));
+        std::array<std::int16_t, 64> block{};
+        block[0] = 40; // 40 * 2 / 8 = 10 above the level shift.
+
+        for (auto kernels : img::jpeg::available_kernels()) {
+            auto const out = run_idct(kernels, block, table);
+            std::array<std::uint8_t, 64> expected{};
+            expected.fill(138);
+            a.expect_eq(out, expected);
+        }
+    });
+
+    s.add_test("idct, clamping", [](etest::IActions &a) {
+        auto const table = img::jpeg::make_idct_table(flat_quant(1));
+        std::array<std::int16_t, 64> bright{};
+        bright[0] = 2000;
+        std::array<std::int16_t, 64> dark{};
+        dark[0] = -2000;
+
+        for (auto kernels : img::jpeg::available_kernels()) {
+            std::array<std::uint8_t, 64> expected{};
+            expected.fill(255);
+            a.expect_eq(run_idct(kernels, bright, table), expected);
+            expected.fill(0);
+            a.expect_eq(run_idct(kernels, dark, table), expected);
+        }
+    });
+
+    s.add_test("idct, matches the reference", [](etest::IActions &a) {
+        auto const table = img::jpeg::make_idct_table(flat_quant(1));
+        for (unsigned seed = 0; seed < 100; ++seed) {
+            auto const block = pseudo_random_block(seed);
+            auto const expected = reference_idct(block);
+            auto const out = run_idct(img::jpeg::Kernels::Scalar, block, table);
+            for (std::size_t i = 0; i < out.size(); ++i) {
+                a.expect(std::abs(out[i] - expected[i]) <= 1);
+            }
+        }
+    });
+
+    s.add_test("idct, dequantization", [](etest::IActions &a) {
+        auto const table = img::jpeg::make_idct_table(flat_quant(3));
+        auto const identity = img::jpeg::make_idct_table(flat_quant(1));
+        auto block = pseudo_random_block(1234);
+        for (auto &c : block) {
+            c = static_cast<std::int16_t>(c / 3);
+        }
+
+        auto dequantized = block;
+        for (auto &c : dequantized) {
+            c = static_cast<std::int16_t>(c * 3);
+        }
+
+        a.expect_eq(run_idct(img::jpeg::Kernels::Scalar, block, table),
+                run_idct(img::jpeg::Kernels::Scalar, dequantized, identity));
+    });
+
+    s.add_test("idct, all kernels agree", [](etest::IActions &a) {
+        std::array<std::uint16_t, 64> quant{};
+        for (std::size_t i = 0; i < quant.size(); ++i) {
+            quant[i] = static_cast<std::uint16_t>(1 + i % 7);
+        }
+        auto const table = img::jpeg::make_idct_table(quant);
+
+        for (unsigned seed = 0; seed < 100; ++seed) {
+            auto const block = pseudo_random_block(seed);
+            auto const expected = run_idct(img::jpeg::Kernels::Scalar, block, table);
+            for (auto kernels : img::jpeg::available_kernels()) {
+                a.expect_eq(run_idct(kernels, block, table), expected);
+            }
+        }
+    });
+
+    s.add_test("idct, stride", [](etest::IActions &a) {
+        auto const table = img::jpeg::make_idct_table(flat_quant(1));
+        auto const block = pseudo_random_block(5);
+        auto const expected = run_idct(img::jpeg::Kernels::Scalar, block, table);
+
+        for (auto kernels : img::jpeg::available_kernels()) {
+            std::vector<std::uint8_t> out(8 * 20, 0xAB);
+            img::jpeg::idct(kernels, block, table, out.data() + 3, 20);
+            for (std::size_t y = 0; y < 8; ++y) {
+                for (std::size_t x = 0; x < 20; ++x) {
+                    auto const sample = out[y * 20 + x];
+                    if (x < 3 || x >= 11) {
+                        a.expect_eq(sample, 0xAB);
+                    } else {
+                        a.expect_eq(sample, expected[y * 8 + x - 3]);
+                    }
+                }
+            }
+        }
+    });
+
+    s.add_test("ycbcr to rgba", [](etest::IActions &a) {
+        // Gray, white, black, red, green, blue.
+        std::vector<std::uint8_t> const y{128, 255, 0, 76, 150, 29};
+        std::vector<std::uint8_t> const cb{128, 128, 128, 85, 44, 255};
+        std::vector<std::uint8_t> const cr{128, 128, 128, 255, 21, 107};
+        std::vector<std::uint8_t> const expected{
+                128, 128, 128, 255, //
+                255, 255, 255, 255, //
+                0, 0, 0, 255, //
+                254, 0, 0, 255, //
+                0, 255, 1, 255, //
+                0, 0, 254, 255, //
+        };
+
+        for (auto kernels : img::jpeg::available_kernels()) {
+            std::vector<std::uint8_t> rgba(y.size() * 4);
+            img::jpeg::ycbcr_to_rgba(kernels, y, cb, cr, rgba.data());
+            a.expect_eq(rgba, expected);
+        }
+    });
+
+    s.add_test("idct_scaled, dc only", [](etest::IActions &a) {
+        std::array<std::int16_t, 64> block{};
+        block[0] = 40;
+
+        for (std::size_t size : {1, 2, 4}) {
+            std::array<std::uint8_t, 16> out{};
+            img::jpeg::idct_scaled(block, flat_quant(2), size, out.data(), size);
+            a.expect(std::all_of(out.begin(), out.begin() + size * size, [](auto sample) { return sample == 138; }));
+        }
+    });
+
+    s.add_test("idct_scaled, smooth blocks match the full idct", [](etest::IActions &a) {
+        for (unsigned seed = 0; seed < 100; ++seed) {
+            // Only the lowest frequencies, and small enough not to clamp, so
+            // the only difference from box filtering is the sampling points.
+            auto block = pseudo_random_block(seed);
+            for (std::size_t i = 0; i < block.size(); ++i) {
+                block[i] = i / 8 < 2 && i % 8 < 2 ? static_cast<std::int16_t>(block[i] / 2) : std::int16_t{0};
+            }
+
+            auto const full = reference_idct(block);
+            std::array<std::uint8_t, 16> out{};
+            img::jpeg::idct_scaled(block, flat_quant(1), 4, out.data(), 4);
+            for (std::size_t y = 0; y < 4; ++y) {
+                for (std::size_t x = 0; x < 4; ++x) {
+                    auto const i = y * 2 * 8 + x * 2;
+                    auto const average = (full[i] + full[i + 1] + full[i + 8] + full[i + 9]) / 4.;
+                    a.expect(std::abs(out[y * 4 + x] - average) <= 3.);
+                }
+            }
+        }
+    });
+
+    s.add_test("ycbcr to rgba, all kernels agree", [](etest::IActions &a) {
+        // Enough pixels for the vectorized loops and their scalar tails.
+        std::vector<std::uint8_t> y;
+        std::vector<std::uint8_t> cb;
+        std::vector<std::uint8_t> cr;
+        for (unsigned i = 0; i < 1000; ++i) {
+            y.push_back(static_cast<std::uint8_t>(i * 7));
+            cb.push_back(static_cast<std::uint8_t>(i * 13 + 5));
+            cr.push_back(static_cast<std::uint8_t>(i * 31 + 100));
+        }
+
+        std::vector<std::uint8_t> expected(y.size() * 4);
+        img::jpeg::ycbcr_to_rgba(img::jpeg::Kernels::Scalar, y, cb, cr, expected.data());
+        for (auto kernels : img::jpeg::available_kernels()) {
+            for (std::size_t size : {std::size_t{1}, std::size_t{7}, std::size_t{17}, y.size()}) {
+                std::vector<std::uint8_t> rgba(size * 4);
+                img::jpeg::ycbcr_to_rgba(kernels,
+                        std::span{y}.first(size),
+                        std::span{cb}.first(size),
+                        std::span{cr}.first(size),
+                        rgba.data());
+                a.expect(std::equal(rgba.begin(), rgba.end(), expected.begin()));
+            }
+        }
+    });
+
+    return s.run();
+}
@@ -4,14 +4,76 @@
 
 #include "img/jpeg.h"
 
+#include "img/scale.h"
+
 #include "etest/etest2.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
 #include <optional>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <utility>
 
 using namespace std::literals;
 
+namespace {
+// 35x21 images of a gradient going from black to red horizontally, black to
+// green vertically, and w/ a constant 128 blue, encoded by libjpeg at quality 95.
+#include "img/gradient_420.h"
+#include "img/gradient_420_progressive.h"
+#include "img/gradient_420_restart.h"
+#include "img/gradient_422.h"
+#include "img/gradient_gray.h"
+
+std::span<std::byte const> as_span(unsigned char const *data, unsigned len) {
+    return std::as_bytes(std::span{data, len});
+}
+
+// The largest difference in any channel between the decoded image and the
+// gradient it was encoded from.
+int max_error(img::Jpeg const &jpeg, bool gray) {
+    int error = 0;
+    for (std::uint32_t y = 0; y < jpeg.height; ++y) {
+        for (std::uint32_t x = 0; x < jpeg.width; ++x) {
+            int r = static_cast<int>(x * 255 / (jpeg.width - 1));
+            int g = static_cast<int>(y * 255 / (jpeg.height - 1));
+            int b = 128;
+            if (gray) {
+                r = g = b = (r + g + b) / 3;
+            }
+
+            auto const *px = jpeg.bytes.data() + (y * jpeg.width + x) * 4;
+            error = std::max({error, std::abs(px[0] - r), std::abs(px[1] - g), std::abs(px[2] - b)});
+            if (px[3] != 0xFF) {
+                return 255;
+            }
+        }
+    }
+    return error;
+}
+
+// The largest difference in any channel between a scaled decode and the full
+// decode scaled down after the fact.
+int max_error_vs_downscaled(img::Jpeg const &scaled, img::Jpeg const &full) {
+    img::Downscaler downscaler{{full.width, full.height}, {scaled.width, scaled.height}};
+    auto const row_size = std::size_t{full.width} * 4;
+    for (std::uint32_t y = 0; y < full.height; ++y) {
+        downscaler.add_row(std::span{full.bytes}.subspan(y * row_size, row_size));
+    }
+
+    auto const expected = downscaler.take();
+    int error = 0;
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        error = std::max(error, std::abs(expected[i] - scaled.bytes[i]));
+    }
+    return error;
+}
+} // namespace
+
 int main() {
     etest::Suite s;
 
@@ -135,5 +197,178 @@ int main() {
         a.expect_eq(jpeg, img::Jpeg{.width = 1, .height = 1, .bytes = {0xFF, 0x11, 0x22, 0xFF}});
     });
 
+    s.add_test("baseline, 4:2:0", [](etest::IActions &a) {
+        auto jpeg = img::Jpeg::from(as_span(img_gradient_420_jpg, img_gradient_420_jpg_len));
+        a.require(jpeg.has_value());
+        a.expect_eq(jpeg->width, 35u);
+        a.expect_eq(jpeg->height, 21u);
+        a.expect_eq(jpeg->bytes.size(), std::size_t{35 * 21 * 4});
+        a.expect(max_error(*jpeg, false) <= 8);
+    });
+
+    s.add_test("baseline, 4:2:2", [](etest::IActions &a) {
+        auto jpeg = img::Jpeg::from(as_span(img_gradient_422_jpg, img_gradient_422_jpg_len));
+        a.require(jpeg.has_value());
+        a.expect_eq(jpeg->width, 35u);
+        a.expect_eq(jpeg->height, 21u);
+        a.expect(max_error(*jpeg, false) <= 8);
+    });
+
+    s.add_test("progressive, grayscale", [](etest::IActions &a) {
+        auto jpeg = img::Jpeg::from(as_span(img_gradient_gray_jpg, img_gradient_gray_jpg_len));
+        a.require(jpeg.has_value());
+        a.expect_eq(jpeg->width, 35u);
+        a.expect_eq(jpeg->height, 21u);
+        a.expect(max_error(*jpeg, true) <= 2);
+    });
+
+    // The progressive image and the one w/ restart markers have the same
+    // quantized coefficients as the baseline one, so they should decode to
+    // exactly the same thing.
+    s.add_test("progressive, 4:2:0", [](etest::IActions &a) {
+        auto baseline = img::Jpeg::from(as_span(img_gradient_420_jpg, img_gradient_420_jpg_len));
+        auto progressive =
+                img::Jpeg::from(as_span(img_gradient_420_progressive_jpg, img_gradient_420_progressive_jpg_len));
+        a.require(baseline.has_value());
+        a.expect_eq(progressive, baseline);
+    });
+
+    s.add_test("restart interval", [](etest::IActions &a) {
+        auto baseline = img::Jpeg::from(as_span(img_gradient_420_jpg, img_gradient_420_jpg_len));
+        auto restart = img::Jpeg::from(as_span(img_gradient_420_restart_jpg, img_gradient_420_restart_jpg_len));
+        a.require(baseline.has_value());
+        a.expect_eq(restart, baseline);
+    });
+
+    s.add_test("istream", [](etest::IActions &a) {
+        std::string_view const bytes{reinterpret_cast<char const *>(img_gradient_420_jpg), img_gradient_420_jpg_len};
+        a.expect_eq(img::Jpeg::from(std::istringstream{std::string{bytes}}),
+                img::Jpeg::from(as_span(img_gradient_420_jpg, img_gradient_420_jpg_len)));
+    });
+
+    s.add_test("scaled, keeps the aspect ratio", [](etest::IActions &a) {
+        auto const bytes = as_span(img_gradient_420_jpg, img_gradient_420_jpg_len);
+        auto const full = img::Jpeg::from(bytes);
+        a.require(full.has_value());
+
+        // Around 1/2, 1/4, and 1/8 of the size, mostly done in the IDCT.
+        for (auto [width, height] : {std::pair{18u, 10u}, std::pair{9u, 5u}, std::pair{5u, 3u}}) {
+            auto jpeg = img::Jpeg::from(bytes, {width, width});
+            a.require(jpeg.has_value());
+            a.expect_eq(jpeg->width, width);
+            a.expect_eq(jpeg->height, height);
+            a.require_eq(jpeg->bytes.size(), std::size_t{width} * height * 4);
+            // Going through the IDCT moves the edges of what each output pixel
+            // covers by a pixel or so, which shows in a gradient this steep.
+            a.expect(max_error_vs_downscaled(*jpeg, *full) <= 24);
+        }
+    });
+
+    s.add_test("scaled, w/ a downscaler for the rest", [](etest::IActions &a) {
+        auto const bytes = as_span(img_gradient_422_jpg, img_gradient_422_jpg_len);
+        auto const full = img::Jpeg::from(bytes);
+        auto jpeg = img::Jpeg::from(bytes, {30, 30});
+        a.require(full.has_value());
+        a.require(jpeg.has_value());
+        a.expect_eq(jpeg->width, 30u);
+        a.expect_eq(jpeg->height, 18u);
+        a.expect(max_error_vs_downscaled(*jpeg, *full) <= 24);
+
+        jpeg = img::Jpeg::from(as_span(img_gradient_gray_jpg, img_gradient_gray_jpg_len), {1, 1});
+        a.require(jpeg.has_value());
+        a.expect_eq(jpeg->width, 1u);
+        a.expect_eq(jpeg->height, 1u);
+    });
+
+    s.add_test("scaled, progressive and restart intervals", [](etest::IActions &a) {
+        for (img::ImageSize size : {img::ImageSize{18, 11}, img::ImageSize{7, 7}}) {
+            auto baseline = img::Jpeg::from(as_span(img_gradient_420_jpg, img_gradient_420_jpg_len), size);
+            auto progressive = img::Jpeg::from(
+                    as_span(img_gradient_420_progressive_jpg, img_gradient_420_progressive_jpg_len), size);
+            auto restart =
+                    img::Jpeg::from(as_span(img_gradient_420_restart_jpg, img_gradient_420_restart_jpg_len), size);
+            a.require(baseline.has_value());
+            a.expect_eq(progressive, baseline);
+            a.expect_eq(restart, baseline);
+        }
+    });
+
+    s.add_test("scaled, already small enough", [](etest::IActions &a) {
+        auto const bytes = as_span(img_gradient_420_jpg, img_gradient_420_jpg_len);
+        a.expect_eq(img::Jpeg::from(bytes, {35, 21}), img::Jpeg::from(bytes));
+        a.expect_eq(img::Jpeg::from(bytes, {100, 100}), img::Jpeg::from(bytes));
+    });
+
+    s.add_test("truncated", [](etest::IActions &a) {
+        // Losing the end of the entropy-coded data still gives an image, but
+        // losing the headers doesn't.
+        auto const full = as_span(img_gradient_420_jpg, img_gradient_420_jpg_len);
+        auto jpeg = img::Jpeg::from(full.first(full.size() - 200));
+        a.require(jpeg.has_value());
+        a.expect_eq(jpeg->width, 35u);
+        a.expect_eq(jpeg->bytes.size(), std::size_t{35 * 21 * 4});
+
+        a.expect_eq(img::Jpeg::from(full.first(100)), std::nullopt);
+        a.expect_eq(img::Jpeg::from(full.first(1)), std::nullopt);
+    });
+
+    s.add_test("not a jpeg", [](etest::IActions &a) {
+        a.expect_eq(img::Jpeg::from(std::istringstream{"\xAB\xCD"}), std::nullopt);
+        a.expect_eq(img::Jpeg::from(std::istringstream{"\xFF\xD8\xFF\xD9"}), std::nullopt);
+    });
+
+    s.add_test("unsupported frame types", [](etest::IActions &a) {
+        // A JPEG w/ its SOF0 marker replaced by SOF9, arithmetic coding.
+        std::string bytes{reinterpret_cast<char const *>(img_gradient_420_jpg), img_gradient_420_jpg_len};
+        auto sof = bytes.find("\xFF\xC0");
+        a.require(sof != std::string::npos);
+        bytes[sof + 1] = '\xC9';
+        a.expect_eq(img::Jpeg::from(std::istringstream{bytes}), std::nullopt);
+    });
+
+    s.add_test("decoder, progressive byte by byte", [](etest::IActions &a) {
+        auto const data = as_span(img_gradient_420_progressive_jpg, img_gradient_420_progressive_jpg_len);
+        img::JpegDecoder decoder;
+        std::size_t scans = 0;
+        for (auto const &byte : data) {
+            a.require(decoder.feed(std::span{&byte, 1}));
+            a.expect(decoder.scans_decoded() >= scans);
+            if (decoder.scans_decoded() == 0) {
+                a.expect_eq(decoder.image(), std::nullopt);
+            } else if (decoder.scans_decoded() != scans) {
+                // Every scan gives a complete, if blurry, image.
+                auto image = decoder.image();
+                a.require(image.has_value());
+                a.expect_eq(image->bytes.size(), std::size_t{35 * 21 * 4});
+            }
+            scans = decoder.scans_decoded();
+        }
+
+        a.expect(decoder.done());
+        a.expect(scans > 1);
+        a.expect_eq(decoder.image(), img::Jpeg::from(data));
+    });
+
+    s.add_test("decoder, baseline in chunks", [](etest::IActions &a) {
+        auto const data = as_span(img_gradient_420_restart_jpg, img_gradient_420_restart_jpg_len);
+        img::JpegDecoder decoder;
+        for (std::size_t i = 0; i < data.size(); i += 7) {
+            a.require(decoder.feed(data.subspan(i, std::min(std::size_t{7}, data.size() - i))));
+            a.expect_eq(decoder.done(), i + 7 >= data.size());
+        }
+
+        a.expect_eq(decoder.scans_decoded(), std::size_t{1});
+        a.expect_eq(decoder.image(), img::Jpeg::from(data));
+    });
+
+    s.add_test("decoder, not a jpeg", [](etest::IActions &a) {
+        img::JpegDecoder decoder;
+        auto const bytes = std::as_bytes(std::span{"\xFF"sv});
+        a.expect(decoder.feed(bytes));
+        a.expect(!decoder.feed(bytes));
+        a.expect(!decoder.feed(bytes));
+        a.expect_eq(decoder.image(), std::nullopt);
+    });
+
     return s.run();
 }
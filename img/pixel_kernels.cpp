@@ -0,0 +1,484 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "img/pixel_kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Unlike the JPEG kernels, these are compiled for their instruction sets no
+// matter what the rest of the code targets, and picked at runtime.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define IMG_PIXELS_X86
+#define IMG_PIXELS_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#endif
+
+namespace img::pixels {
+namespace {
+
+// Enough steps for every sRGB byte to survive a round-trip through linear.
+constexpr std::size_t kLinearSteps = 4096;
+
+// 256 entries for colors followed by 256 for alpha, so that all of a pixel's
+// channels can be looked up w/ the same table.
+std::array<float, 512> const &srgb_to_linear_table() {
+    static auto const kTable = [] {
+        std::array<float, 512> table{};
+        for (std::size_t i = 0; i < 256; ++i) {
+            auto const c = static_cast<double>(i) / 255.;
+            auto const linear = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+            table[i] = static_cast<float>(linear);
+            table[256 + i] = static_cast<float>(c);
+        }
+        return table;
+    }();
+    return kTable;
+}
+
+// Colors are looked up by their value times kLinearSteps - 1, and alphas by
+// their value times 255 after that. Entries are 32-bit for gathering.
+std::array<std::int32_t, kLinearSteps + 256> const &linear_to_srgb_table() {
+    static auto const kTable = [] {
+        std::array<std::int32_t, kLinearSteps + 256> table{};
+        for (std::size_t i = 0; i < kLinearSteps; ++i) {
+            auto const linear = static_cast<double>(i) / (kLinearSteps - 1);
+            auto const c = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1 / 2.4) - 0.055;
+            table[i] = static_cast<std::int32_t>(std::lround(c * 255.));
+        }
+        for (std::size_t i = 0; i < 256; ++i) {
+            table[kLinearSteps + i] = static_cast<std::int32_t>(i);
+        }
+        return table;
+    }();
+    return kTable;
+}
+
+// The scalar kernels, which also handle whatever the SIMD ones leave over.
+
+void rgb_to_rgba_scalar(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    for (std::size_t i = 0; i < pixels; ++i) {
+        out[i * 4] = in[i * 3];
+        out[i * 4 + 1] = in[i * 3 + 1];
+        out[i * 4 + 2] = in[i * 3 + 2];
+        out[i * 4 + 3] = 255;
+    }
+}
+
+void swap_red_blue_scalar(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    for (std::size_t i = 0; i < pixels * 4; i += 4) {
+        auto const r = in[i];
+        auto const b = in[i + 2];
+        out[i] = b;
+        out[i + 1] = in[i + 1];
+        out[i + 2] = r;
+        out[i + 3] = in[i + 3];
+    }
+}
+
+// round(v / 255) for v in [0, 255 * 255].
+constexpr std::uint8_t div255(unsigned v) {
+    v += 128;
+    return static_cast<std::uint8_t>((v + (v >> 8)) >> 8);
+}
+
+void premultiply_scalar(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    for (std::size_t i = 0; i < pixels * 4; i += 4) {
+        unsigned const a = in[i + 3];
+        out[i] = div255(in[i] * a);
+        out[i + 1] = div255(in[i + 1] * a);
+        out[i + 2] = div255(in[i + 2] * a);
+        out[i + 3] = static_cast<std::uint8_t>(a);
+    }
+}
+
+void unpremultiply_scalar(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    for (std::size_t i = 0; i < pixels * 4; i += 4) {
+        unsigned const a = in[i + 3];
+        for (std::size_t c = 0; c < 3; ++c) {
+            out[i + c] = a == 0 ? 0 : static_cast<std::uint8_t>(std::min(255u, (in[i + c] * 255u + a / 2) / a));
+        }
+        out[i + 3] = static_cast<std::uint8_t>(a);
+    }
+}
+
+void srgb_to_linear_scalar(std::uint8_t const *in, std::size_t pixels, float *out) {
+    auto const &table = srgb_to_linear_table();
+    for (std::size_t i = 0; i < pixels * 4; i += 4) {
+        out[i] = table[in[i]];
+        out[i + 1] = table[in[i + 1]];
+        out[i + 2] = table[in[i + 2]];
+        out[i + 3] = table[256 + in[i + 3]];
+    }
+}
+
+// Written so that NaN becomes 0 like w/ SSE's max.
+std::size_t linear_to_srgb_index(float v, float steps) {
+    v = v > 0.f ? std::min(v, 1.f) : 0.f;
+    return static_cast<std::size_t>(std::lrint(v * steps));
+}
+
+void linear_to_srgb_scalar(float const *in, std::size_t pixels, std::uint8_t *out) {
+    auto const &table = linear_to_srgb_table();
+    constexpr auto kSteps = static_cast<float>(kLinearSteps - 1);
+    for (std::size_t i = 0; i < pixels * 4; i += 4) {
+        out[i] = static_cast<std::uint8_t>(table[linear_to_srgb_index(in[i], kSteps)]);
+        out[i + 1] = static_cast<std::uint8_t>(table[linear_to_srgb_index(in[i + 1], kSteps)]);
+        out[i + 2] = static_cast<std::uint8_t>(table[linear_to_srgb_index(in[i + 2], kSteps)]);
+        out[i + 3] = static_cast<std::uint8_t>(table[kLinearSteps + linear_to_srgb_index(in[i + 3], 255.f)]);
+    }
+}
+
+// The SIMD kernels return how many pixels they converted.
+
+#ifdef IMG_PIXELS_X86
+IMG_PIXELS_TARGET("ssse3")
+std::size_t rgb_to_rgba_ssse3(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    auto const shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    auto const alpha = _mm_set1_epi32(static_cast<int>(0xFF00'0000u));
+    std::size_t i = 0;
+    // 16 bytes are read for every 4 pixels, so some are left at the end.
+    for (; i + 6 <= pixels; i += 4) {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha));
+    }
+    return i;
+}
+
+IMG_PIXELS_TARGET("ssse3")
+std::size_t swap_red_blue_ssse3(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    auto const shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    std::size_t i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4), _mm_shuffle_epi8(v, shuffle));
+    }
+    return i;
+}
+
+// Premultiplies 2 pixels w/ 16 bits per channel.
+IMG_PIXELS_TARGET("ssse3")
+__m128i premultiply_words_ssse3(__m128i px) {
+    auto alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, 0xFF), 0xFF);
+    // Multiplying the alpha by 255 leaves it as it is after the division.
+    alpha = _mm_or_si128(alpha, _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255));
+    auto const v = _mm_add_epi16(_mm_mullo_epi16(px, alpha), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+}
+
+IMG_PIXELS_TARGET("ssse3")
+std::size_t premultiply_ssse3(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    auto const zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i * 4));
+        auto const lo = premultiply_words_ssse3(_mm_unpacklo_epi8(v, zero));
+        auto const hi = premultiply_words_ssse3(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+// Unpremultiplies 1 pixel w/ 32 bits per channel. The division is done in
+// floating point, where every value involved is exact, and truncating the
+// quotient gives the same result as the scalar integer division. Transparent
+// pixels divide by 0, which ends up as 0 after packing.
+IMG_PIXELS_TARGET("ssse3")
+__m128i unpremultiply_dwords_ssse3(__m128i px) {
+    auto const alpha = _mm_shuffle_epi32(px, 0xFF);
+    auto const n = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(px), _mm_set1_ps(255.f)),
+            _mm_cvtepi32_ps(_mm_srli_epi32(alpha, 1)));
+    return _mm_cvttps_epi32(_mm_div_ps(n, _mm_cvtepi32_ps(alpha)));
+}
+
+IMG_PIXELS_TARGET("ssse3")
+std::size_t unpremultiply_ssse3(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    auto const zero = _mm_setzero_si128();
+    auto const alpha_mask = _mm_set1_epi32(static_cast<int>(0xFF00'0000u));
+    std::size_t i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i * 4));
+        auto const lo = _mm_unpacklo_epi8(v, zero);
+        auto const hi = _mm_unpackhi_epi8(v, zero);
+        auto const lo_words = _mm_packs_epi32(unpremultiply_dwords_ssse3(_mm_unpacklo_epi16(lo, zero)),
+                unpremultiply_dwords_ssse3(_mm_unpackhi_epi16(lo, zero)));
+        auto const hi_words = _mm_packs_epi32(unpremultiply_dwords_ssse3(_mm_unpacklo_epi16(hi, zero)),
+                unpremultiply_dwords_ssse3(_mm_unpackhi_epi16(hi, zero)));
+        auto const colors = _mm_andnot_si128(alpha_mask, _mm_packus_epi16(lo_words, hi_words));
+        _mm_storeu_si128(
+                reinterpret_cast<__m128i *>(out + i * 4), _mm_or_si128(colors, _mm_and_si128(v, alpha_mask)));
+    }
+    return i;
+}
+
+IMG_PIXELS_TARGET("avx2")
+std::size_t rgb_to_rgba_avx2(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    auto const shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, //
+            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    auto const alpha = _mm256_set1_epi32(static_cast<int>(0xFF00'0000u));
+    std::size_t i = 0;
+    // 28 bytes are read for every 8 pixels' 24.
+    for (; i + 10 <= pixels; i += 8) {
+        auto const *p = in + i * 3;
+        auto const v = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p))),
+                _mm_loadu_si128(reinterpret_cast<__m128i const *>(p + 12)),
+                1);
+        _mm256_storeu_si256(
+                reinterpret_cast<__m256i *>(out + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alpha));
+    }
+    return i;
+}
+
+IMG_PIXELS_TARGET("avx2")
+std::size_t swap_red_blue_avx2(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    auto const shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, //
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    std::size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 4), _mm256_shuffle_epi8(v, shuffle));
+    }
+    return i;
+}
+
+IMG_PIXELS_TARGET("avx2")
+__m256i premultiply_words_avx2(__m256i px) {
+    auto alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(px, 0xFF), 0xFF);
+    alpha = _mm256_or_si256(alpha, _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255));
+    auto const v = _mm256_add_epi16(_mm256_mullo_epi16(px, alpha), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)), 8);
+}
+
+IMG_PIXELS_TARGET("avx2")
+std::size_t premultiply_avx2(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    auto const zero = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + i * 4));
+        // Unpacking and packing both work within 128-bit lanes, so the pixels
+        // stay in order.
+        auto const lo = premultiply_words_avx2(_mm256_unpacklo_epi8(v, zero));
+        auto const hi = premultiply_words_avx2(_mm256_unpackhi_epi8(v, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 4), _mm256_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+// Packs 8 pixels, 2 per vector, w/ 32 bits per channel into bytes.
+IMG_PIXELS_TARGET("avx2")
+__m256i pack_dwords_avx2(__m256i a, __m256i b, __m256i c, __m256i d) {
+    // Packing works within 128-bit lanes, which leaves the even pixels in the
+    // low lane and the odd ones in the high lane.
+    auto const bytes = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+    return _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+IMG_PIXELS_TARGET("avx2")
+__m256i unpremultiply_dwords_avx2(std::uint8_t const *in) {
+    auto const px = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(in)));
+    auto const alpha = _mm256_shuffle_epi32(px, 0xFF);
+    auto const n = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(px), _mm256_set1_ps(255.f)),
+            _mm256_cvtepi32_ps(_mm256_srli_epi32(alpha, 1)));
+    return _mm256_cvttps_epi32(_mm256_div_ps(n, _mm256_cvtepi32_ps(alpha)));
+}
+
+IMG_PIXELS_TARGET("avx2")
+std::size_t unpremultiply_avx2(std::uint8_t const *in, std::size_t pixels, std::uint8_t *out) {
+    auto const alpha_mask = _mm256_set1_epi32(static_cast<int>(0xFF00'0000u));
+    std::size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        auto const *p = in + i * 4;
+        auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+        auto const colors = pack_dwords_avx2(unpremultiply_dwords_avx2(p),
+                unpremultiply_dwords_avx2(p + 8),
+                unpremultiply_dwords_avx2(p + 16),
+                unpremultiply_dwords_avx2(p + 24));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 4), _mm256_blendv_epi8(colors, v, alpha_mask));
+    }
+    return i;
+}
+
+IMG_PIXELS_TARGET("avx2")
+std::size_t srgb_to_linear_avx2(std::uint8_t const *in, std::size_t pixels, float *out) {
+    auto const *table = srgb_to_linear_table().data();
+    auto const alpha_offset = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+    std::size_t i = 0;
+    for (; i + 2 <= pixels; i += 2) {
+        auto const px = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(in + i * 4)));
+        _mm256_storeu_ps(out + i * 4, _mm256_i32gather_ps(table, _mm256_add_epi32(px, alpha_offset), 4));
+    }
+    return i;
+}
+
+IMG_PIXELS_TARGET("avx2")
+__m256i linear_to_srgb_dwords_avx2(float const *in, std::int32_t const *table) {
+    constexpr auto kSteps = static_cast<float>(kLinearSteps - 1);
+    auto const steps = _mm256_setr_ps(kSteps, kSteps, kSteps, 255.f, kSteps, kSteps, kSteps, 255.f);
+    auto const alpha_offset = _mm256_setr_epi32(0, 0, 0, kLinearSteps, 0, 0, 0, kLinearSteps);
+    auto const v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in), _mm256_setzero_ps()), _mm256_set1_ps(1.f));
+    auto const index = _mm256_add_epi32(_mm256_cvtps_epi32(_mm256_mul_ps(v, steps)), alpha_offset);
+    return _mm256_i32gather_epi32(table, index, 4);
+}
+
+IMG_PIXELS_TARGET("avx2")
+std::size_t linear_to_srgb_avx2(float const *in, std::size_t pixels, std::uint8_t *out) {
+    auto const *table = linear_to_srgb_table().data();
+    std::size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        auto const *p = in + i * 4;
+        auto const bytes = pack_dwords_avx2(linear_to_srgb_dwords_avx2(p, table),
+                linear_to_srgb_dwords_avx2(p + 8, table),
+                linear_to_srgb_dwords_avx2(p + 16, table),
+                linear_to_srgb_dwords_avx2(p + 24, table));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 4), bytes);
+    }
+    return i;
+}
+#endif
+
+} // namespace
+
+std::span<Kernels const> available_kernels() {
+    static auto const kAvailable = [] {
+        std::vector<Kernels> kernels{Kernels::Scalar};
+#ifdef IMG_PIXELS_X86
+        if (__builtin_cpu_supports("ssse3")) {
+            kernels.push_back(Kernels::Ssse3);
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            kernels.push_back(Kernels::Avx2);
+        }
+#endif
+        return kernels;
+    }();
+    return kAvailable;
+}
+
+void rgb_to_rgba(Kernels kernels, std::span<std::uint8_t const> rgb, std::uint8_t *rgba) {
+    assert(rgb.size() % 3 == 0);
+    auto const pixels = rgb.size() / 3;
+    std::size_t done = 0;
+    switch (kernels) {
+#ifdef IMG_PIXELS_X86
+        case Kernels::Avx2:
+            done = rgb_to_rgba_avx2(rgb.data(), pixels, rgba);
+            break;
+        case Kernels::Ssse3:
+            done = rgb_to_rgba_ssse3(rgb.data(), pixels, rgba);
+            break;
+#endif
+        default:
+            assert(kernels == Kernels::Scalar);
+            break;
+    }
+
+    rgb_to_rgba_scalar(rgb.data() + done * 3, pixels - done, rgba + done * 4);
+}
+
+void swap_red_blue(Kernels kernels, std::span<std::uint8_t const> in, std::uint8_t *out) {
+    assert(in.size() % 4 == 0);
+    auto const pixels = in.size() / 4;
+    std::size_t done = 0;
+    switch (kernels) {
+#ifdef IMG_PIXELS_X86
+        case Kernels::Avx2:
+            done = swap_red_blue_avx2(in.data(), pixels, out);
+            break;
+        case Kernels::Ssse3:
+            done = swap_red_blue_ssse3(in.data(), pixels, out);
+            break;
+#endif
+        default:
+            assert(kernels == Kernels::Scalar);
+            break;
+    }
+
+    swap_red_blue_scalar(in.data() + done * 4, pixels - done, out + done * 4);
+}
+
+void premultiply(Kernels kernels, std::span<std::uint8_t const> rgba, std::uint8_t *out) {
+    assert(rgba.size() % 4 == 0);
+    auto const pixels = rgba.size() / 4;
+    std::size_t done = 0;
+    switch (kernels) {
+#ifdef IMG_PIXELS_X86
+        case Kernels::Avx2:
+            done = premultiply_avx2(rgba.data(), pixels, out);
+            break;
+        case Kernels::Ssse3:
+            done = premultiply_ssse3(rgba.data(), pixels, out);
+            break;
+#endif
+        default:
+            assert(kernels == Kernels::Scalar);
+            break;
+    }
+
+    premultiply_scalar(rgba.data() + done * 4, pixels - done, out + done * 4);
+}
+
+void unpremultiply(Kernels kernels, std::span<std::uint8_t const> rgba, std::uint8_t *out) {
+    assert(rgba.size() % 4 == 0);
+    auto const pixels = rgba.size() / 4;
+    std::size_t done = 0;
+    switch (kernels) {
+#ifdef IMG_PIXELS_X86
+        case Kernels::Avx2:
+            done = unpremultiply_avx2(rgba.data(), pixels, out);
+            break;
+        case Kernels::Ssse3:
+            done = unpremultiply_ssse3(rgba.data(), pixels, out);
+            break;
+#endif
+        default:
+            assert(kernels == Kernels::Scalar);
+            break;
+    }
+
+    unpremultiply_scalar(rgba.data() + done * 4, pixels - done, out + done * 4);
+}
+
+// There's no gather before AVX2, so SSSE3 uses the scalar lookups.
+void srgb_to_linear(Kernels kernels, std::span<std::uint8_t const> rgba, float *out) {
+    assert(rgba.size() % 4 == 0);
+    auto const pixels = rgba.size() / 4;
+    std::size_t done = 0;
+    switch (kernels) {
+#ifdef IMG_PIXELS_X86
+        case Kernels::Avx2:
+            done = srgb_to_linear_avx2(rgba.data(), pixels, out);
+            break;
+#endif
+        default:
+            break;
+    }
+
+    srgb_to_linear_scalar(rgba.data() + done * 4, pixels - done, out + done * 4);
+}
+
+void linear_to_srgb(Kernels kernels, std::span<float const> rgba, std::uint8_t *out) {
+    assert(rgba.size() % 4 == 0);
+    auto const pixels = rgba.size() / 4;
+    std::size_t done = 0;
+    switch (kernels) {
+#ifdef IMG_PIXELS_X86
+        case Kernels::Avx2:
+            done = linear_to_srgb_avx2(rgba.data(), pixels, out);
+            break;
+#endif
+        default:
+            break;
+    }
+
+    linear_to_srgb_scalar(rgba.data() + done * 4, pixels - done, out + done * 4);
+}
+
+} // namespace img::pixels
@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef IMG_PIXEL_KERNELS_H_
+#define IMG_PIXEL_KERNELS_H_
+
+#include <cstdint>
+#include <span>
+
+namespace img::pixels {
+
+// Conversions between the pixel formats images are decoded to and the ones
+// canvases and blending want. Every kernel produces exactly the same output as
+// the scalar one, so which one is used only affects the speed.
+enum class Kernels : std::uint8_t {
+    Scalar,
+    Ssse3,
+    Avx2,
+};
+
+// The kernels the CPU we're running on supports, w/ the fastest last. Calling
+// a kernel w/ anything else isn't allowed.
+std::span<Kernels const> available_kernels();
+
+inline Kernels best_kernels() {
+    return available_kernels().back();
+}
+
+// The outputs can't overlap the inputs, except that swap_red_blue, premultiply,
+// and unpremultiply can work in place.
+
+// 3 bytes per pixel to 4, w/ the alpha being 255.
+void rgb_to_rgba(Kernels, std::span<std::uint8_t const> rgb, std::uint8_t *rgba);
+
+// RGBA to BGRA, or the other way around.
+void swap_red_blue(Kernels, std::span<std::uint8_t const> in, std::uint8_t *out);
+
+// Multiplies the colors by their alpha, rounding to nearest.
+void premultiply(Kernels, std::span<std::uint8_t const> rgba, std::uint8_t *out);
+
+// Divides the colors by their alpha, rounding to nearest. Fully transparent
+// pixels become transparent black. This undoes premultiply for every pixel
+// that could have been produced by it.
+void unpremultiply(Kernels, std::span<std::uint8_t const> rgba, std::uint8_t *out);
+
+// sRGB-encoded RGBA to linear floats in [0, 1]. Alpha is always linear, so it's
+// just scaled.
+void srgb_to_linear(Kernels, std::span<std::uint8_t const> rgba, float *out);
+
+// Linear RGBA to sRGB-encoded bytes, clamping values outside of [0, 1]. The
+// colors go through a lookup table that's precise enough for every byte to
+// survive a round-trip through srgb_to_linear.
+void linear_to_srgb(Kernels, std::span<float const> rgba, std::uint8_t *out);
+
+inline void rgb_to_rgba(std::span<std::uint8_t const> rgb, std::uint8_t *rgba) {
+    rgb_to_rgba(best_kernels(), rgb, rgba);
+}
+
+inline void swap_red_blue(std::span<std::uint8_t const> in, std::uint8_t *out) {
+    swap_red_blue(best_kernels(), in, out);
+}
+
+inline void premultiply(std::span<std::uint8_t const> rgba, std::uint8_t *out) {
+    premultiply(best_kernels(), rgba, out);
+}
+
+inline void unpremultiply(std::span<std::uint8_t const> rgba, std::uint8_t *out) {
+    unpremultiply(best_kernels(), rgba, out);
+}
+
+inline void srgb_to_linear(std::span<std::uint8_t const> rgba, float *out) {
+    srgb_to_linear(best_kernels(), rgba, out);
+}
+
+inline void linear_to_srgb(std::span<float const> rgba, std::uint8_t *out) {
+    linear_to_srgb(best_kernels(), rgba, out);
+}
+
+} // namespace img::pixels
+
+#endif
@@ -0,0 +1,76 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "img/pixel_kernels.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+template<typename F>
+double gb_per_s(std::size_t bytes, int iterations, F &&f) {
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        f();
+    }
+    std::chrono::duration<double> const duration = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(bytes) * iterations / duration.count() / 1'000'000'000.;
+}
+
+char const *name(img::pixels::Kernels kernels) {
+    switch (kernels) {
+        case img::pixels::Kernels::Scalar:
+            return "scalar";
+        case img::pixels::Kernels::Ssse3:
+            return "ssse3";
+        case img::pixels::Kernels::Avx2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+// Measures the throughput of every pixel kernel, in GB of output per second.
+int main(int argc, char **argv) {
+    int const iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    // About a 1080p frame's worth of pixels.
+    constexpr std::size_t kPixels = 1920 * 1080;
+    std::vector<std::uint8_t> rgba(kPixels * 4);
+    std::uint32_t noise = 1;
+    for (auto &b : rgba) {
+        noise = noise * 1664525 + 1013904223;
+        b = static_cast<std::uint8_t>(noise >> 24);
+    }
+
+    std::vector<std::uint8_t> const rgb(rgba.begin(), rgba.begin() + kPixels * 3);
+    std::vector<std::uint8_t> out(kPixels * 4);
+    std::vector<float> linear(kPixels * 4);
+    img::pixels::srgb_to_linear(img::pixels::Kernels::Scalar, rgba, linear.data());
+
+    for (auto kernels : img::pixels::available_kernels()) {
+        using namespace img::pixels;
+        std::cout << name(kernels) << "\n";
+        std::cout << "  rgb to rgba: "
+                  << gb_per_s(out.size(), iterations, [&] { rgb_to_rgba(kernels, rgb, out.data()); }) << " GB/s\n";
+        std::cout << "  swap red and blue: "
+                  << gb_per_s(out.size(), iterations, [&] { swap_red_blue(kernels, rgba, out.data()); }) << " GB/s\n";
+        std::cout << "  premultiply: "
+                  << gb_per_s(out.size(), iterations, [&] { premultiply(kernels, rgba, out.data()); }) << " GB/s\n";
+        std::cout << "  unpremultiply: "
+                  << gb_per_s(out.size(), iterations, [&] { unpremultiply(kernels, rgba, out.data()); }) << " GB/s\n";
+        std::cout << "  srgb to linear: " << gb_per_s(linear.size() * sizeof(float), iterations, [&] {
+            srgb_to_linear(kernels, rgba, linear.data());
+        }) << " GB/s\n";
+        std::cout << "  linear to srgb: "
+                  << gb_per_s(out.size(), iterations, [&] { linear_to_srgb(kernels, linear, out.data()); })
+                  << " GB/s\n";
+    }
+}
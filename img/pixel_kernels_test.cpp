@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "img/pixel_kernels.h"
+
+#include "etest/etest2.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+using img::pixels::Kernels;
+
+namespace {
+
+// Every combination of color and alpha, w/ the colors differing between the
+// channels.
+std::vector<std::uint8_t> all_colors_and_alphas() {
+    std::vector<std::uint8_t> rgba;
+    for (unsigned a = 0; a < 256; ++a) {
+        for (unsigned c = 0; c < 256; ++c) {
+            rgba.insert(rgba.end(),
+                    {static_cast<std::uint8_t>(c),
+                            static_cast<std::uint8_t>(255 - c),
+                            static_cast<std::uint8_t>(c ^ 0x5A),
+                            static_cast<std::uint8_t>(a)});
+        }
+    }
+    return rgba;
+}
+
+std::vector<std::uint8_t> noise(std::size_t size) {
+    std::vector<std::uint8_t> bytes(size);
+    std::uint32_t state = 1;
+    for (auto &b : bytes) {
+        state = state * 1664525 + 1013904223;
+        b = static_cast<std::uint8_t>(state >> 24);
+    }
+    return bytes;
+}
+
+// The SIMD kernels handle a different number of pixels at a time, and leave
+// the rest to the scalar ones, so every kernel is run on every length up to a
+// few of their widths.
+template<typename In, typename Out, typename F>
+void expect_all_kernels_agree(etest::IActions &a,
+        std::vector<In> const &in,
+        std::size_t in_channels,
+        std::size_t out_channels,
+        F const &kernel) {
+    auto const pixels = in.size() / in_channels;
+    std::vector<Out> expected(pixels * out_channels);
+    kernel(Kernels::Scalar, std::span{in}, expected.data());
+
+    for (auto kernels : img::pixels::available_kernels()) {
+        std::vector<Out> out(pixels * out_channels);
+        kernel(kernels, std::span{in}, out.data());
+        a.expect(out == expected);
+
+        for (std::size_t length = 0; length < 40 && length <= pixels; ++length) {
+            std::vector<Out> partial(length * out_channels);
+            kernel(kernels, std::span{in}.first(length * in_channels), partial.data());
+            a.expect(std::equal(partial.begin(), partial.end(), expected.begin()));
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    etest::Suite s;
+
+    s.add_test("scalar kernels are always available", [](etest::IActions &a) {
+        a.require(!img::pixels::available_kernels().empty());
+        a.expect_eq(img::pixels::available_kernels().front(), Kernels::Scalar);
+    });
+
+    s.add_test("rgb_to_rgba", [](etest::IActions &a) {
+        std::vector<std::uint8_t> const rgb{1, 2, 3, 4, 5, 6};
+        std::vector<std::uint8_t> rgba(8);
+        img::pixels::rgb_to_rgba(rgb, rgba.data());
+        a.expect_eq(rgba, std::vector<std::uint8_t>{1, 2, 3, 255, 4, 5, 6, 255});
+
+        expect_all_kernels_agree<std::uint8_t, std::uint8_t>(a, noise(3 * 1000), 3, 4, [](auto k, auto in, auto *out) {
+            img::pixels::rgb_to_rgba(k, in, out); //
+        });
+    });
+
+    s.add_test("swap_red_blue", [](etest::IActions &a) {
+        std::vector<std::uint8_t> rgba{1, 2, 3, 4, 5, 6, 7, 8};
+        img::pixels::swap_red_blue(rgba, rgba.data());
+        a.expect_eq(rgba, std::vector<std::uint8_t>{3, 2, 1, 4, 7, 6, 5, 8});
+
+        expect_all_kernels_agree<std::uint8_t, std::uint8_t>(a, noise(4 * 1000), 4, 4, [](auto k, auto in, auto *out) {
+            img::pixels::swap_red_blue(k, in, out); //
+        });
+    });
+
+    s.add_test("premultiply, rounds to nearest", [](etest::IActions &a) {
+        auto const rgba = all_colors_and_alphas();
+        std::vector<std::uint8_t> out(rgba.size());
+        img::pixels::premultiply(Kernels::Scalar, rgba, out.data());
+        for (std::size_t i = 0; i < rgba.size(); ++i) {
+            auto const alpha = rgba[i / 4 * 4 + 3];
+            auto const expected = i % 4 == 3 ? alpha : std::lround(rgba[i] * alpha / 255.);
+            a.expect_eq(out[i], expected);
+        }
+    });
+
+    s.add_test("premultiply, all kernels agree", [](etest::IActions &a) {
+        expect_all_kernels_agree<std::uint8_t, std::uint8_t>(
+                a, all_colors_and_alphas(), 4, 4, [](auto k, auto in, auto *out) {
+                    img::pixels::premultiply(k, in, out); //
+                });
+    });
+
+    s.add_test("unpremultiply, undoes premultiply", [](etest::IActions &a) {
+        // Every premultiplied color is at most its alpha.
+        std::vector<std::uint8_t> premultiplied;
+        for (unsigned alpha = 0; alpha < 256; ++alpha) {
+            for (unsigned c = 0; c <= alpha; ++c) {
+                auto const color = static_cast<std::uint8_t>(c);
+                premultiplied.insert(premultiplied.end(), {color, color, color, static_cast<std::uint8_t>(alpha)});
+            }
+        }
+
+        for (auto kernels : img::pixels::available_kernels()) {
+            auto rgba = premultiplied;
+            img::pixels::unpremultiply(kernels, rgba, rgba.data());
+            img::pixels::premultiply(kernels, rgba, rgba.data());
+            a.expect(rgba == premultiplied);
+        }
+    });
+
+    s.add_test("unpremultiply, transparent and opaque", [](etest::IActions &a) {
+        std::vector<std::uint8_t> rgba{10, 20, 30, 0, 10, 20, 30, 255, 255, 128, 0, 128};
+        img::pixels::unpremultiply(rgba, rgba.data());
+        a.expect_eq(rgba, std::vector<std::uint8_t>{0, 0, 0, 0, 10, 20, 30, 255, 255, 255, 0, 128});
+    });
+
+    s.add_test("unpremultiply, all kernels agree", [](etest::IActions &a) {
+        expect_all_kernels_agree<std::uint8_t, std::uint8_t>(
+                a, all_colors_and_alphas(), 4, 4, [](auto k, auto in, auto *out) {
+                    img::pixels::unpremultiply(k, in, out); //
+                });
+    });
+
+    s.add_test("srgb_to_linear", [](etest::IActions &a) {
+        std::vector<std::uint8_t> const rgba{0, 128, 255, 128};
+        std::vector<float> linear(4);
+        img::pixels::srgb_to_linear(rgba, linear.data());
+        a.expect_eq(linear[0], 0.f);
+        a.expect(std::abs(linear[1] - 0.2158605f) < 0.000001f);
+        a.expect_eq(linear[2], 1.f);
+        a.expect_eq(linear[3], 128 / 255.f);
+
+        expect_all_kernels_agree<std::uint8_t, float>(a, all_colors_and_alphas(), 4, 4, [](auto k, auto in, auto *out) {
+            img::pixels::srgb_to_linear(k, in, out); //
+        });
+    });
+
+    s.add_test("linear_to_srgb, round-trip", [](etest::IActions &a) {
+        auto const rgba = all_colors_and_alphas();
+        for (auto kernels : img::pixels::available_kernels()) {
+            std::vector<float> linear(rgba.size());
+            img::pixels::srgb_to_linear(kernels, rgba, linear.data());
+            std::vector<std::uint8_t> out(rgba.size());
+            img::pixels::linear_to_srgb(kernels, linear, out.data());
+            a.expect(out == rgba);
+        }
+    });
+
+    s.add_test("linear_to_srgb, clamps", [](etest::IActions &a) {
+        auto const nan = std::numeric_limits<float>::quiet_NaN();
+        std::vector<float> linear;
+        for (int i = 0; i < 20; ++i) {
+            linear.insert(linear.end(), {-1.f, 2.f, nan, 100.f});
+        }
+
+        for (auto kernels : img::pixels::available_kernels()) {
+            std::vector<std::uint8_t> out(linear.size());
+            img::pixels::linear_to_srgb(kernels, linear, out.data());
+            for (std::size_t i = 0; i < out.size(); i += 4) {
+                a.expect_eq(out[i], 0);
+                a.expect_eq(out[i + 1], 255);
+                a.expect_eq(out[i + 2], 0);
+                a.expect_eq(out[i + 3], 255);
+            }
+        }
+    });
+
+    s.add_test("linear_to_srgb, all kernels agree", [](etest::IActions &a) {
+        std::vector<float> linear;
+        for (int i = -100; i < 5000; ++i) {
+            linear.push_back(static_cast<float>(i) / 4096.f);
+        }
+
+        expect_all_kernels_agree<float, std::uint8_t>(a, linear, 4, 4, [](auto k, auto in, auto *out) {
+            img::pixels::linear_to_srgb(k, in, out); //
+        });
+    });
+
+    return s.run();
+}
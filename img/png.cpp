@@ -1,14 +1,20 @@
-// SPDX-FileCopyrightText: 2022-2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2022-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "img/png.h"
 
+#include "img/scale.h"
+
 #include <array>
 #include <csetjmp>
 #include <cstdint>
+#include <cstddef>
 #include <istream>
+#include <memory>
 #include <optional>
+#include <ostream>
+#include <span>
 #include <utility>
 #include <vector>
 
@@ -29,9 +35,28 @@ void read_png_bytes(png_structp png, png_bytep data, png_size_t length) {
     }
 }
 
-} // namespace
+void write_png_bytes(png_structp png, png_bytep data, png_size_t length) {
+    auto *os = reinterpret_cast<std::ostream *>(png_get_io_ptr(png));
+    if (!os->write(reinterpret_cast<char const *>(data), static_cast<std::streamsize>(length))) {
+        png_error(png, "failure while writing png data");
+    }
+}
 
-std::optional<Png> Png::from(std::istream &is) {
+void flush_png(png_structp png) {
+    auto *os = reinterpret_cast<std::ostream *>(png_get_io_ptr(png));
+    os->flush();
+}
+
+// Everything allocated while libpng may longjmp out of decode() lives in here,
+// behind a pointer that's set up before setjmp, so that the error path still
+// frees it.
+struct DecodeBuffers {
+    std::vector<unsigned char> row;
+    std::vector<unsigned char> bytes;
+    std::optional<Downscaler> downscaler;
+};
+
+std::optional<Png> decode(std::istream &is, std::optional<ImageSize> max_size) {
     std::array<char, kSignatureSize> signature{};
     is.read(signature.data(), signature.size());
     if (!is || png_sig_cmp(reinterpret_cast<png_const_bytep>(signature.data()), 0, signature.size()) != 0) {
@@ -49,6 +74,8 @@ std::optional<Png> Png::from(std::istream &is) {
         return std::nullopt;
     }
 
+    auto const buffers = std::make_unique<DecodeBuffers>();
+
 #ifdef _MSC_VER
     // C4611: interaction between '_setjmp' and C++ object destruction is non-portable.
     // See: https://learn.microsoft.com/en-us/cpp/cpp/using-setjmp-longjmp?view=msvc-170
@@ -67,28 +94,213 @@ std::optional<Png> Png::from(std::istream &is) {
 
     png_set_expand(png);
     png_set_add_alpha(png, 0xff, PNG_FILLER_AFTER);
+    auto const passes = png_set_interlace_handling(png);
 
     png_read_update_info(png, info);
 
     auto height = png_get_image_height(png, info);
     auto width = png_get_image_width(png, info);
     auto bytes_per_row = png_get_rowbytes(png, info);
-    std::vector<unsigned char> bytes;
-    bytes.resize(bytes_per_row * height);
+    auto const output_size = max_size ? fit_within({width, height}, *max_size) : ImageSize{width, height};
 
-    for (std::uint32_t row = 0; row < height; ++row) {
-        png_read_row(png, bytes.data() + row * bytes_per_row, nullptr);
+    auto &[row_buffer, bytes, downscaler] = *buffers;
+    if (output_size != ImageSize{width, height}) {
+        downscaler.emplace(ImageSize{width, height}, output_size);
+    }
+
+    if (downscaler && passes == 1) {
+        // Every row is handed off to the downscaler as soon as it's read, so
+        // the full-size image is never kept around.
+        row_buffer.resize(bytes_per_row);
+        for (std::uint32_t y = 0; y < height; ++y) {
+            png_read_row(png, row_buffer.data(), nullptr);
+            downscaler->add_row(row_buffer);
+        }
+    } else {
+        bytes.resize(bytes_per_row * height);
+
+        // Interlaced images are read one pass at a time, each pass filling in
+        // more of every row.
+        for (int pass = 0; pass < passes; ++pass) {
+            for (std::uint32_t row = 0; row < height; ++row) {
+                png_read_row(png, bytes.data() + row * bytes_per_row, nullptr);
+            }
+        }
+
+        if (downscaler) {
+            for (std::uint32_t row = 0; row < height; ++row) {
+                downscaler->add_row(std::span{bytes}.subspan(row * bytes_per_row, bytes_per_row));
+            }
+        }
     }
 
-    Png ret{
-            .width = width,
-            .height = height,
-            .bytes = std::move(bytes),
-    };
+    Png ret = downscaler ? Png{.width = output_size.width, .height = output_size.height, .bytes = downscaler->take()}
+                         : Png{.width = width, .height = height, .bytes = std::move(bytes)};
 
     png_destroy_read_struct(&png, &info, nullptr);
 
     return ret;
 }
 
+} // namespace
+
+struct PngDecoder::Impl {
+    png_structp png{png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr)};
+    png_infop info{png != nullptr ? png_create_info_struct(png) : nullptr};
+
+    std::optional<ImageSize> size;
+    std::size_t bytes_per_row{};
+    int last_pass{};
+    std::uint32_t rows_decoded{};
+    std::vector<unsigned char> pixels;
+    bool done{false};
+    bool failed{info == nullptr};
+
+    Impl() {
+        if (!failed) {
+            png_set_progressive_read_fn(png, this, on_info, on_row, on_end);
+        }
+    }
+
+    ~Impl() { png_destroy_read_struct(&png, &info, nullptr); }
+
+    Impl(Impl const &) = delete;
+    Impl &operator=(Impl const &) = delete;
+
+    // These are called from inside png_process_data, so the same rules as for
+    // read_png_bytes apply.
+    static void on_info(png_structp png, png_infop info) {
+        auto &self = *static_cast<Impl *>(png_get_progressive_ptr(png));
+        png_set_expand(png);
+        png_set_add_alpha(png, 0xff, PNG_FILLER_AFTER);
+        self.last_pass = png_set_interlace_handling(png) - 1;
+        png_read_update_info(png, info);
+
+        auto const height = png_get_image_height(png, info);
+        self.size = ImageSize{png_get_image_width(png, info), height};
+        self.bytes_per_row = png_get_rowbytes(png, info);
+        self.pixels.resize(self.bytes_per_row * height);
+    }
+
+    static void on_row(png_structp png, png_bytep new_row, png_uint_32 row, int pass) {
+        auto &self = *static_cast<Impl *>(png_get_progressive_ptr(png));
+        // For interlaced images, this merges in the pixels from this pass.
+        png_progressive_combine_row(png, self.pixels.data() + row * self.bytes_per_row, new_row);
+        if (pass == self.last_pass) {
+            self.rows_decoded = row + 1;
+        }
+    }
+
+    static void on_end(png_structp png, png_infop) {
+        auto &self = *static_cast<Impl *>(png_get_progressive_ptr(png));
+        // The last pass of a 1-row interlaced image doesn't have any rows.
+        self.rows_decoded = self.size->height;
+        self.done = true;
+    }
+};
+
+PngDecoder::PngDecoder() : impl_{std::make_unique<Impl>()} {}
+PngDecoder::~PngDecoder() = default;
+
+PngDecoder::PngDecoder(PngDecoder &&) noexcept = default;
+PngDecoder &PngDecoder::operator=(PngDecoder &&) noexcept = default;
+
+bool PngDecoder::feed(std::span<std::byte const> data) {
+    auto &d = *impl_;
+    if (d.failed) {
+        return false;
+    }
+
+    if (d.done || data.empty()) {
+        return true;
+    }
+
+    // NOLINTNEXTLINE(cert-err52-cpp): libpng offers us this or aborting.
+    if (setjmp(png_jmpbuf(d.png))) {
+        d.failed = true;
+        return false;
+    }
+
+    // libpng doesn't modify the data, it just doesn't have a const overload.
+    png_process_data(d.png, d.info, reinterpret_cast<png_bytep>(const_cast<std::byte *>(data.data())), data.size());
+    return true;
+}
+
+std::optional<ImageSize> PngDecoder::size() const {
+    return impl_->size;
+}
+
+std::span<unsigned char const> PngDecoder::pixels() const {
+    return impl_->pixels;
+}
+
+std::uint32_t PngDecoder::rows_decoded() const {
+    return impl_->rows_decoded;
+}
+
+bool PngDecoder::done() const {
+    return impl_->done;
+}
+
+std::optional<Png> PngDecoder::take() {
+    if (!impl_->done) {
+        return std::nullopt;
+    }
+
+    return Png{.width = impl_->size->width, .height = impl_->size->height, .bytes = std::move(impl_->pixels)};
+}
+
+std::optional<Png> Png::from(std::istream &is) {
+    return decode(is, std::nullopt);
+}
+
+std::optional<Png> Png::from(std::istream &is, ImageSize max_size) {
+    return decode(is, max_size);
+}
+
+bool Png::write(std::ostream &os, std::uint32_t width, std::uint32_t height, std::span<unsigned char const> rgba) {
+    auto const bytes_per_row = std::size_t{width} * 4;
+    if (width == 0 || height == 0 || rgba.size() != bytes_per_row * height) {
+        return false;
+    }
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (png == nullptr) {
+        return false;
+    }
+
+    png_infop info = png_create_info_struct(png);
+    if (info == nullptr) {
+        png_destroy_write_struct(&png, nullptr);
+        return false;
+    }
+
+    // NOLINTNEXTLINE(cert-err52-cpp): libpng offers us this or aborting.
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        return false;
+    }
+
+    png_set_write_fn(png, reinterpret_cast<void *>(&os), write_png_bytes, flush_png);
+    png_set_IHDR(png,
+            info,
+            width,
+            height,
+            8,
+            PNG_COLOR_TYPE_RGBA,
+            PNG_INTERLACE_NONE,
+            PNG_COMPRESSION_TYPE_DEFAULT,
+            PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+
+    for (std::uint32_t row = 0; row < height; ++row) {
+        png_write_row(png, rgba.data() + row * bytes_per_row);
+    }
+
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+
+    return true;
+}
+
 } // namespace img
@@ -1,13 +1,17 @@
-// SPDX-FileCopyrightText: 2022 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2022-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
 #ifndef IMG_PNG_H_
 #define IMG_PNG_H_
 
+#include "img/scale.h"
+
 #include <cstdint>
 #include <iosfwd>
+#include <memory>
 #include <optional>
+#include <span>
 #include <vector>
 
 namespace img {
@@ -17,6 +21,17 @@ public:
     static std::optional<Png> from(std::istream &&is) { return from(is); }
     static std::optional<Png> from(std::istream &is);
 
+    // Decodes the image scaled down to fit in max_size. Only a row of the
+    // full-size image is kept in memory at a time, unless it's interlaced.
+    static std::optional<Png> from(std::istream &&is, ImageSize max_size) { return from(is, max_size); }
+    static std::optional<Png> from(std::istream &, ImageSize max_size);
+
+    // Encodes 8-bit RGBA pixel data as a PNG. Returns false if the data
+    // doesn't match the dimensions or if writing to the stream fails.
+    [[nodiscard]] static bool write(
+            std::ostream &, std::uint32_t width, std::uint32_t height, std::span<unsigned char const> rgba);
+    [[nodiscard]] bool write(std::ostream &os) const { return write(os, width, height, bytes); }
+
     std::uint32_t width{};
     std::uint32_t height{};
     std::vector<unsigned char> bytes{};
@@ -24,6 +39,35 @@ public:
     [[nodiscard]] bool operator==(Png const &) const = default;
 };
 
+// Decodes a PNG as its data comes in, so that the rows decoded so far can be
+// shown while the rest of it is still being downloaded. Interlaced images are
+// filled in a pass at a time, so no row is done until the last pass.
+class PngDecoder {
+public:
+    PngDecoder();
+    ~PngDecoder();
+
+    PngDecoder(PngDecoder &&) noexcept;
+    PngDecoder &operator=(PngDecoder &&) noexcept;
+
+    // Returns false if the data is broken, after which nothing more is decoded.
+    bool feed(std::span<std::byte const>);
+
+    // Known once the header has been fed.
+    [[nodiscard]] std::optional<ImageSize> size() const;
+    // The whole image, w/ the pixels not decoded yet transparent.
+    [[nodiscard]] std::span<unsigned char const> pixels() const;
+    [[nodiscard]] std::uint32_t rows_decoded() const;
+    [[nodiscard]] bool done() const;
+
+    // The decoded image, or nothing if it isn't done yet.
+    [[nodiscard]] std::optional<Png> take();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
 } // namespace img
 
 #endif
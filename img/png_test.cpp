@@ -1,25 +1,80 @@
-// SPDX-FileCopyrightText: 2022-2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2022-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "img/png.h"
 
+#include "img/scale.h"
+
 #include "etest/etest.h"
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <span>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+using etest::expect;
 using etest::expect_eq;
 
 namespace {
+#include "img/interlaced_png.h"
 #include "img/tiny_png.h"
 std::string_view const png_bytes(reinterpret_cast<char const *>(img_tiny_png), img_tiny_png_len);
+std::string_view const interlaced_png_bytes(
+        reinterpret_cast<char const *>(img_interlaced_png), img_interlaced_png_len);
+
+std::vector<unsigned char> make_gradient(std::uint32_t width, std::uint32_t height) {
+    std::vector<unsigned char> rgba;
+    for (std::uint32_t y = 0; y < height; ++y) {
+        for (std::uint32_t x = 0; x < width; ++x) {
+            rgba.insert(rgba.end(),
+                    {static_cast<unsigned char>(x * 255 / width),
+                            static_cast<unsigned char>(y * 255 / height),
+                            100,
+                            static_cast<unsigned char>(x % 2 == 0 ? 255 : 0)});
+        }
+    }
+    return rgba;
+}
+
+std::vector<unsigned char> downscale(img::ImageSize from, img::ImageSize to, std::span<unsigned char const> rgba) {
+    img::Downscaler downscaler{from, to};
+    for (std::uint32_t y = 0; y < from.height; ++y) {
+        downscaler.add_row(rgba.subspan(std::size_t{y} * from.width * 4, std::size_t{from.width} * 4));
+    }
+    return downscaler.take();
+}
+
+// Feeds the data a byte at a time, checking that the decoded rows never change
+// once they're reported as done.
+std::optional<img::Png> decode_byte_by_byte(std::string_view data) {
+    img::PngDecoder decoder;
+    std::uint32_t rows_decoded = 0;
+    std::vector<unsigned char> decoded_rows;
+    for (auto c : std::as_bytes(std::span{data})) {
+        if (!decoder.feed(std::span{&c, 1})) {
+            return std::nullopt;
+        }
+
+        expect(decoder.rows_decoded() >= rows_decoded);
+        rows_decoded = decoder.rows_decoded();
+        if (rows_decoded > 0) {
+            auto const row_bytes = decoder.pixels().size() / decoder.size()->height;
+            auto const done = decoder.pixels().first(rows_decoded * row_bytes);
+            expect(std::ranges::equal(done.first(decoded_rows.size()), decoded_rows));
+            decoded_rows.assign(done.begin(), done.end());
+        }
+    }
+
+    return decoder.take();
+}
 } // namespace
 
 int main() {
@@ -52,5 +107,114 @@ int main() {
         expect_eq(img::Png::from(std::stringstream(std::move(truncated_bytes))), std::nullopt);
     });
 
+    etest::test("write, round-trip", [] {
+        img::Png const original{
+                .width = 3,
+                .height = 2,
+                .bytes{
+                        0xff, 0, 0, 0xff, 0, 0xff, 0, 0x80, 0, 0, 0xff, 0, //
+                        1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+                },
+        };
+
+        std::stringstream ss;
+        expect(original.write(ss));
+        expect_eq(img::Png::from(ss), original);
+    });
+
+    etest::test("write, mismatched dimensions", [] {
+        std::stringstream ss;
+        std::array<unsigned char, 8> const rgba{};
+        expect(!img::Png::write(ss, 1, 1, rgba));
+        expect(!img::Png::write(ss, 0, 0, {}));
+        expect(ss.str().empty());
+    });
+
+    etest::test("interlaced", [] {
+        std::vector<unsigned char> expected;
+        for (int y = 0; y < 10; ++y) {
+            for (int x = 0; x < 10; ++x) {
+                expected.insert(expected.end(),
+                        {static_cast<unsigned char>(x * 25), static_cast<unsigned char>(y * 25), 100, 0xff});
+            }
+        }
+
+        auto png = img::Png::from(std::stringstream(std::string{interlaced_png_bytes}));
+        expect_eq(png, img::Png{.width = 10, .height = 10, .bytes = expected});
+
+        png = img::Png::from(std::stringstream(std::string{interlaced_png_bytes}), {4, 4});
+        expect_eq(png, img::Png{.width = 4, .height = 4, .bytes = downscale({10, 10}, {4, 4}, expected)});
+    });
+
+    etest::test("scaled, matches downscaling the full image", [] {
+        auto const rgba = make_gradient(64, 30);
+        std::stringstream ss;
+        expect(img::Png::write(ss, 64, 30, rgba));
+
+        auto png = img::Png::from(ss, {16, 16});
+        expect_eq(png, img::Png{.width = 16, .height = 7, .bytes = downscale({64, 30}, {16, 7}, rgba)});
+    });
+
+    etest::test("scaled, already small enough", [] {
+        auto const rgba = make_gradient(5, 3);
+        std::stringstream ss;
+        expect(img::Png::write(ss, 5, 3, rgba));
+        expect_eq(img::Png::from(ss, {5, 5}), img::Png{.width = 5, .height = 3, .bytes = rgba});
+    });
+
+    etest::test("scaled, truncated", [] {
+        auto const rgba = make_gradient(64, 30);
+        std::stringstream ss;
+        expect(img::Png::write(ss, 64, 30, rgba));
+        auto const bytes = ss.str();
+        expect_eq(img::Png::from(std::stringstream(bytes.substr(0, bytes.size() / 2)), {16, 16}), std::nullopt);
+
+        auto const interlaced = std::string{interlaced_png_bytes};
+        expect_eq(img::Png::from(std::stringstream(interlaced.substr(0, interlaced.size() / 2)), {4, 4}),
+                std::nullopt);
+    });
+
+    etest::test("decoder, byte by byte", [] {
+        expect_eq(decode_byte_by_byte(png_bytes), img::Png::from(std::stringstream(std::string{png_bytes})));
+        expect_eq(decode_byte_by_byte(interlaced_png_bytes),
+                img::Png::from(std::stringstream(std::string{interlaced_png_bytes})));
+
+        auto const rgba = make_gradient(64, 30);
+        std::stringstream ss;
+        expect(img::Png::write(ss, 64, 30, rgba));
+        expect_eq(decode_byte_by_byte(ss.str()), img::Png{.width = 64, .height = 30, .bytes = rgba});
+    });
+
+    etest::test("decoder, partial data", [] {
+        img::PngDecoder decoder;
+        expect(decoder.feed(std::as_bytes(std::span{png_bytes.substr(0, 30)})));
+        expect_eq(decoder.size(), std::nullopt);
+        expect(decoder.pixels().empty());
+
+        // The header is handled once the image data starts.
+        auto const rest = png_bytes.substr(30);
+        auto const half = rest.size() / 2;
+        expect(decoder.feed(std::as_bytes(std::span{rest.substr(0, half)})));
+        expect_eq(decoder.size(), img::ImageSize{256, 256});
+        expect_eq(decoder.pixels().size(), std::size_t{256} * 256 * 4);
+        expect(!decoder.done());
+        expect_eq(decoder.take(), std::nullopt);
+
+        expect(decoder.feed(std::as_bytes(std::span{rest.substr(half)})));
+        expect(decoder.done());
+        expect_eq(decoder.rows_decoded(), 256u);
+        expect_eq(decoder.take(), img::Png::from(std::stringstream(std::string{png_bytes})));
+    });
+
+    etest::test("decoder, invalid signature", [] {
+        auto invalid_signature_bytes = std::string{png_bytes};
+        invalid_signature_bytes[7] = 'b';
+
+        img::PngDecoder decoder;
+        expect(!decoder.feed(std::as_bytes(std::span{invalid_signature_bytes})));
+        expect(!decoder.feed(std::as_bytes(std::span{png_bytes})));
+        expect_eq(decoder.take(), std::nullopt);
+    });
+
     return etest::run_all_tests();
 }
@@ -1,17 +1,27 @@
-// SPDX-FileCopyrightText: 2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2023-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "img/qoi.h"
 
+#include "img/scale.h"
+
 #include <tl/expected.hpp>
 
+#include <algorithm>
 #include <array>
 #include <bit>
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <istream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -28,21 +38,194 @@ constexpr std::uint8_t kQoiOpDiff = 0b0100'0000;
 constexpr std::uint8_t kQoiOpLuma = 0b1000'0000;
 constexpr std::uint8_t kQoiOpRun = 0b1100'0000;
 
+constexpr std::string_view kMagic = "qoif";
+constexpr std::size_t kHeaderSize = 14;
+
+// The byte stream's end is marked with 7 0x00 bytes followed by a single
+// 0x01 byte.
+constexpr std::array<std::uint8_t, 8> kEndMarker{0, 0, 0, 0, 0, 0, 0, 1};
+
+// Runs of 63 and 64 would collide w/ the QOI_OP_RGB and QOI_OP_RGBA tags.
+constexpr int kMaxRunLength = 62;
+
+// We don't support images larger than 400 million pixels (~1.5GiB).
+// This matches the implementation at https://github.com/phoboslab/qoi
+constexpr std::size_t kMaxPixelCount{400'000'000};
+
 struct Px {
     std::uint8_t r{};
     std::uint8_t g{};
     std::uint8_t b{};
     std::uint8_t a{};
+    [[nodiscard]] bool operator==(Px const &) const = default;
 };
 
 std::size_t seen_pixels_index(Px const &px) {
     return (std::size_t{px.r} * 3 + std::size_t{px.g} * 5 + std::size_t{px.b} * 7 + std::size_t{px.a} * 11) % 64;
 }
 
-} // namespace
+std::uint32_t read_be32(std::uint8_t const *data) {
+    std::uint32_t v{};
+    std::memcpy(&v, data, sizeof(v));
+    static_assert((std::endian::native == std::endian::big) || (std::endian::native == std::endian::little),
+            "Mixed endian is unsupported right now");
+    if constexpr (std::endian::native != std::endian::big) {
+        v = std::byteswap(v);
+    }
+    return v;
+}
+
+std::uint8_t *write_be32(std::uint8_t *out, std::uint32_t v) {
+    if constexpr (std::endian::native != std::endian::big) {
+        v = std::byteswap(v);
+    }
+    std::memcpy(out, &v, sizeof(v));
+    return out + sizeof(v);
+}
+
+// Where decoding stopped when running out of data, so that it can pick up from
+// there once there's more of it.
+struct PixelState {
+    Px previous_pixel{0, 0, 0, 255};
+    std::array<Px, 64> seen_pixels{};
+    // Runs can continue onto the next row, but runs past the end of the image
+    // are cut short.
+    std::size_t run_length{};
+    // The row being decoded, and how many bytes of it are done.
+    std::uint32_t y{};
+    std::size_t row_offset{};
+    // How much of the data has been used.
+    std::size_t pos{};
+};
+
+// Returns AbruptEof w/ the state updated to where the data ran out, never in
+// the middle of a chunk. next_row(y) is called again for the row being decoded
+// when resuming.
+template<typename RowFn>
+tl::expected<void, QoiError> decode_pixels(std::span<std::byte const> data,
+        std::uint32_t width,
+        std::uint32_t height,
+        PixelState &state,
+        RowFn &&next_row) {
+    auto const *in = reinterpret_cast<std::uint8_t const *>(data.data());
+    auto const size = data.size();
+    std::size_t pos = state.pos;
+
+    // Copied so that the loop works on locals.
+    auto previous_pixel = state.previous_pixel;
+    auto seen_pixels = state.seen_pixels;
+    auto run_length = state.run_length;
+    auto y = state.y;
+    unsigned char *row = nullptr;
+    unsigned char *out = nullptr;
+    auto const suspend = [&](std::size_t resume_at) {
+        state = PixelState{
+                .previous_pixel = previous_pixel,
+                .seen_pixels = seen_pixels,
+                .run_length = run_length,
+                .y = y,
+                .row_offset = static_cast<std::size_t>(out - row),
+                .pos = resume_at,
+        };
+        return tl::unexpected{QoiError::AbruptEof};
+    };
+
+    for (; y < height; ++y) {
+        row = next_row(y);
+        out = row + std::exchange(state.row_offset, 0);
+        auto *const out_end = row + std::size_t{width} * 4;
+        while (out != out_end) {
+            if (run_length > 0) {
+                auto const n = std::min(run_length, static_cast<std::size_t>(out_end - out) / 4);
+                for (auto const *const run_end = out + n * 4; out != run_end; out += 4) {
+                    std::memcpy(out, &previous_pixel, 4);
+                }
+                run_length -= n;
+                continue;
+            }
+
+            if (pos == size) {
+                return suspend(pos);
+            }
+
+            auto const chunk_start = pos;
+            auto const chunk = in[pos++];
+            auto const short_tag = chunk & 0b1100'0000;
+            auto const short_value = chunk & 0b0011'1111;
+
+            if (chunk == kQoiOpRgb) {
+                if (size - pos < 3) {
+                    return suspend(chunk_start);
+                }
+
+                previous_pixel.r = in[pos];
+                previous_pixel.g = in[pos + 1];
+                previous_pixel.b = in[pos + 2];
+                pos += 3;
+            } else if (chunk == kQoiOpRgba) {
+                if (size - pos < 4) {
+                    return suspend(chunk_start);
+                }
+
+                std::memcpy(&previous_pixel, in + pos, 4);
+                pos += 4;
+            } else if (short_tag == kQoiOpIndex) {
+                previous_pixel = seen_pixels[short_value];
+            } else if (short_tag == kQoiOpDiff) {
+                // Stored with a bias of 2.
+                auto const db = (short_value & 0b11) - 2;
+                auto const dg = ((short_value >> 2) & 0b11) - 2;
+                auto const dr = ((short_value >> 4) & 0b11) - 2;
+                previous_pixel.b = static_cast<std::uint8_t>(previous_pixel.b + db);
+                previous_pixel.g = static_cast<std::uint8_t>(previous_pixel.g + dg);
+                previous_pixel.r = static_cast<std::uint8_t>(previous_pixel.r + dr);
+            } else if (short_tag == kQoiOpLuma) {
+                if (pos == size) {
+                    return suspend(chunk_start);
+                }
+
+                auto const extra_data = in[pos++];
+                static constexpr auto kGreenBias = -32;
+                static constexpr auto kRedBlueBias = -8;
+                auto const diff_green = short_value + kGreenBias;
+                auto const diff_blue = (extra_data & 0b1111) + diff_green + kRedBlueBias;
+                auto const diff_red = ((extra_data >> 4) & 0b1111) + diff_green + kRedBlueBias;
+                previous_pixel.b = static_cast<std::uint8_t>(previous_pixel.b + diff_blue);
+                previous_pixel.g = static_cast<std::uint8_t>(previous_pixel.g + diff_green);
+                previous_pixel.r = static_cast<std::uint8_t>(previous_pixel.r + diff_red);
+            } else if (short_tag == kQoiOpRun) {
+                // Stored with a bias of -1.
+                run_length = static_cast<std::size_t>(short_value) + 1;
+                continue;
+            }
+
+            std::memcpy(out, &previous_pixel, 4);
+            out += 4;
+            seen_pixels[seen_pixels_index(previous_pixel)] = previous_pixel;
+        }
+    }
+
+    if (size - pos < kEndMarker.size()) {
+        row = out = nullptr;
+        return suspend(pos);
+    }
+
+    if (std::memcmp(in + pos, kEndMarker.data(), kEndMarker.size()) != 0) {
+        return tl::unexpected{QoiError::InvalidEndMarker};
+    }
+
+    state.y = height;
+    state.pos = pos + kEndMarker.size();
+    return {};
+}
+
+struct Header {
+    std::uint32_t width{};
+    std::uint32_t height{};
+};
 
 // https://qoiformat.org/qoi-specification.pdf
-tl::expected<Qoi, QoiError> Qoi::from(std::istream &is) {
+tl::expected<Header, QoiError> parse_header(std::span<std::byte const> data) {
     // A QOI file consists of a 14-byte header, followed by any number of
     // data "chunks" and an 8-byte end marker.
     //
@@ -53,142 +236,296 @@ tl::expected<Qoi, QoiError> Qoi::from(std::istream &is) {
     //     uint8_t channels; // 3 = RGB, 4 = RGBA
     //     uint8_t colorspace; // 0 = sRGB with linear alpha, 1 = all channels linear
     // };
+    auto const *in = reinterpret_cast<std::uint8_t const *>(data.data());
+    auto const size = data.size();
 
-    std::string magic{};
-    magic.resize(4);
-
-    if (!is.read(magic.data(), magic.size())) {
+    if (size < kMagic.size()) {
         return tl::unexpected{QoiError::AbruptEof};
     }
 
-    if (magic != "qoif") {
+    if (std::memcmp(in, kMagic.data(), kMagic.size()) != 0) {
         return tl::unexpected{QoiError::InvalidMagic};
     }
 
-    std::uint32_t width{};
-    if (!is.read(reinterpret_cast<char *>(&width), sizeof(width))) {
+    if (size < 8) {
         return tl::unexpected{QoiError::AbruptEof};
     }
+    auto const width = read_be32(in + 4);
 
-    std::uint32_t height{};
-    if (!is.read(reinterpret_cast<char *>(&height), sizeof(height))) {
+    if (size < 12) {
         return tl::unexpected{QoiError::AbruptEof};
     }
+    auto const height = read_be32(in + 8);
 
-    static_assert((std::endian::native == std::endian::big) || (std::endian::native == std::endian::little),
-            "Mixed endian is unsupported right now");
-    if constexpr (std::endian::native != std::endian::big) {
-        width = std::byteswap(width);
-        height = std::byteswap(height);
-    }
-
-    // We don't support images larger than 400 million pixels (~1.5GiB).
-    // This matches the implementation at https://github.com/phoboslab/qoi
-    static constexpr std::size_t kMaxPixelCount{400'000'000};
     if ((width > 0) && (height > kMaxPixelCount / width)) {
         return tl::unexpected{QoiError::ImageTooLarge};
     }
 
-    std::uint8_t channels{};
-    if (!is.read(reinterpret_cast<char *>(&channels), sizeof(channels))) {
+    if (size < 13) {
         return tl::unexpected{QoiError::AbruptEof};
     }
 
-    if (channels != 3 && channels != 4) {
+    if (auto const channels = in[12]; channels != 3 && channels != 4) {
         return tl::unexpected{QoiError::InvalidChannels};
     }
 
-    std::uint8_t colorspace{};
-    if (!is.read(reinterpret_cast<char *>(&colorspace), sizeof(colorspace))) {
+    if (size < kHeaderSize) {
         return tl::unexpected{QoiError::AbruptEof};
     }
 
-    if (colorspace != 0 && colorspace != 1) {
+    if (auto const colorspace = in[13]; colorspace != 0 && colorspace != 1) {
         return tl::unexpected{QoiError::InvalidColorspace};
     }
 
-    std::vector<unsigned char> pixels{};
-    auto const bytes_needed = std::size_t{width} * height * 4;
-    pixels.reserve(bytes_needed);
+    return Header{.width = width, .height = height};
+}
 
-    Px previous_pixel{0, 0, 0, 255};
-    std::array<Px, 64> seen_pixels{};
-    while (pixels.size() != bytes_needed) {
-        std::uint8_t chunk{};
-        if (!is.read(reinterpret_cast<char *>(&chunk), sizeof(chunk))) {
-            return tl::unexpected{QoiError::AbruptEof};
+tl::expected<Qoi, QoiError> decode(std::span<std::byte const> data, std::optional<ImageSize> max_size) {
+    auto header = parse_header(data);
+    if (!header) {
+        return tl::unexpected{header.error()};
+    }
+
+    auto const [width, height] = *header;
+    auto const row_size = std::size_t{width} * 4;
+    auto const output_size = max_size ? fit_within({width, height}, *max_size) : ImageSize{width, height};
+    if (output_size == ImageSize{width, height}) {
+        // The output is written in place, so this is the only allocation made.
+        std::vector<unsigned char> pixels(row_size * height);
+        PixelState state{};
+        auto result = decode_pixels(data.subspan(kHeaderSize), width, height, state, [&](std::uint32_t y) {
+            return pixels.data() + y * row_size; //
+        });
+        if (!result) {
+            return tl::unexpected{result.error()};
         }
 
-        auto const short_tag = chunk & 0b1100'0000;
-        auto const short_value = chunk & 0b0011'1111;
+        return Qoi{.width = width, .height = height, .bytes = std::move(pixels)};
+    }
 
-        if (chunk == kQoiOpRgb) {
-            if (!is.read(reinterpret_cast<char *>(&previous_pixel), 3)) {
-                return tl::unexpected{QoiError::AbruptEof};
-            }
-        } else if (chunk == kQoiOpRgba) {
-            if (!is.read(reinterpret_cast<char *>(&previous_pixel), 4)) {
-                return tl::unexpected{QoiError::AbruptEof};
-            }
-        } else if (short_tag == kQoiOpIndex) {
-            previous_pixel = seen_pixels[short_value];
-        } else if (short_tag == kQoiOpDiff) {
-            // Stored with a bias of 2.
-            auto const db = (short_value & 0b11) - 2;
-            auto const dg = ((short_value >> 2) & 0b11) - 2;
-            auto const dr = ((short_value >> 4) & 0b11) - 2;
-            previous_pixel.b = static_cast<std::uint8_t>(previous_pixel.b + db);
-            previous_pixel.g = static_cast<std::uint8_t>(previous_pixel.g + dg);
-            previous_pixel.r = static_cast<std::uint8_t>(previous_pixel.r + dr);
-        } else if (short_tag == kQoiOpLuma) {
-            std::uint8_t extra_data{};
-            if (!is.read(reinterpret_cast<char *>(&extra_data), sizeof(extra_data))) {
-                return tl::unexpected{QoiError::AbruptEof};
-            }
+    // Only a single row of the full-size image is kept around, and every row
+    // is handed off to the downscaler before the next one is decoded.
+    std::vector<unsigned char> row(row_size);
+    Downscaler downscaler{{width, height}, output_size};
+    PixelState state{};
+    auto result = decode_pixels(data.subspan(kHeaderSize), width, height, state, [&](std::uint32_t y) {
+        if (y > 0) {
+            downscaler.add_row(row);
+        }
+        return row.data();
+    });
+    if (!result) {
+        return tl::unexpected{result.error()};
+    }
 
-            static constexpr auto kGreenBias = -32;
-            static constexpr auto kRedBlueBias = -8;
-            auto const diff_green = short_value + kGreenBias;
-            auto const diff_blue = (extra_data & 0b1111) + diff_green + kRedBlueBias;
-            auto const diff_red = ((extra_data >> 4) & 0b1111) + diff_green + kRedBlueBias;
-            previous_pixel.b = static_cast<std::uint8_t>(previous_pixel.b + diff_blue);
-            previous_pixel.g = static_cast<std::uint8_t>(previous_pixel.g + diff_green);
-            previous_pixel.r = static_cast<std::uint8_t>(previous_pixel.r + diff_red);
-        } else if (short_tag == kQoiOpRun) {
-            // Stored with a bias of -1.
-            auto const run_length = short_value + 1;
-            for (int i = 0; i < run_length; ++i) {
-                pixels.push_back(previous_pixel.r);
-                pixels.push_back(previous_pixel.g);
-                pixels.push_back(previous_pixel.b);
-                pixels.push_back(previous_pixel.a);
+    if (height > 0) {
+        downscaler.add_row(row);
+    }
+
+    return Qoi{.width = output_size.width, .height = output_size.height, .bytes = downscaler.take()};
+}
+
+} // namespace
+
+tl::expected<Qoi, QoiError> Qoi::from(std::istream &is) {
+    std::ostringstream ss;
+    ss << is.rdbuf();
+    auto const data = std::move(ss).str();
+    return from(std::as_bytes(std::span{data}));
+}
+
+tl::expected<Qoi, QoiError> Qoi::from(std::istream &is, ImageSize max_size) {
+    std::ostringstream ss;
+    ss << is.rdbuf();
+    auto const data = std::move(ss).str();
+    return from(std::as_bytes(std::span{data}), max_size);
+}
+
+tl::expected<Qoi, QoiError> Qoi::from(std::span<std::byte const> data) {
+    return decode(data, std::nullopt);
+}
+
+tl::expected<Qoi, QoiError> Qoi::from(std::span<std::byte const> data, ImageSize max_size) {
+    return decode(data, max_size);
+}
+
+struct QoiDecoder::Impl {
+    // Whatever's left of the data fed so far, i.e. the start of a chunk that
+    // hasn't been fed in full yet.
+    std::vector<std::byte> data;
+    std::optional<Header> header;
+    PixelState state;
+    std::vector<unsigned char> pixels;
+    bool done{false};
+    std::optional<QoiError> error;
+};
+
+QoiDecoder::QoiDecoder() : impl_{std::make_unique<Impl>()} {}
+QoiDecoder::~QoiDecoder() = default;
+QoiDecoder::QoiDecoder(QoiDecoder &&) noexcept = default;
+QoiDecoder &QoiDecoder::operator=(QoiDecoder &&) noexcept = default;
+
+tl::expected<void, QoiError> QoiDecoder::feed(std::span<std::byte const> data) {
+    auto &d = *impl_;
+    if (d.error) {
+        return tl::unexpected{*d.error};
+    }
+
+    // Anything after the end marker is ignored.
+    if (d.done) {
+        return {};
+    }
+
+    d.data.insert(d.data.end(), data.begin(), data.end());
+    if (!d.header) {
+        auto header = parse_header(d.data);
+        if (!header) {
+            if (header.error() == QoiError::AbruptEof) {
+                return {};
             }
-            continue;
+
+            d.error = header.error();
+            return tl::unexpected{*d.error};
         }
 
-        pixels.push_back(previous_pixel.r);
-        pixels.push_back(previous_pixel.g);
-        pixels.push_back(previous_pixel.b);
-        pixels.push_back(previous_pixel.a);
-        seen_pixels[seen_pixels_index(previous_pixel)] = previous_pixel;
+        d.header = *header;
+        d.pixels.resize(std::size_t{header->width} * header->height * 4);
+        d.state.pos = kHeaderSize;
+    }
+
+    auto const row_size = std::size_t{d.header->width} * 4;
+    auto result = decode_pixels(d.data, d.header->width, d.header->height, d.state, [&](std::uint32_t y) {
+        return d.pixels.data() + y * row_size; //
+    });
+
+    if (result) {
+        d.done = true;
+        d.data = {};
+        return {};
     }
 
-    // The byte stream's end is marked with 7 0x00 bytes followed by a single
-    // 0x01 byte.
-    std::array<std::uint8_t, 8> footer{};
-    if (!is.read(reinterpret_cast<char *>(footer.data()), footer.size())) {
+    if (result.error() == QoiError::AbruptEof) {
+        d.data.erase(d.data.begin(), d.data.begin() + static_cast<std::ptrdiff_t>(d.state.pos));
+        d.state.pos = 0;
+        return {};
+    }
+
+    d.error = result.error();
+    return tl::unexpected{*d.error};
+}
+
+std::optional<ImageSize> QoiDecoder::size() const {
+    if (!impl_->header) {
+        return std::nullopt;
+    }
+
+    return ImageSize{impl_->header->width, impl_->header->height};
+}
+
+std::span<unsigned char const> QoiDecoder::pixels() const {
+    return impl_->pixels;
+}
+
+std::uint32_t QoiDecoder::rows_decoded() const {
+    return impl_->state.y;
+}
+
+bool QoiDecoder::done() const {
+    return impl_->done;
+}
+
+tl::expected<Qoi, QoiError> QoiDecoder::take() {
+    auto &d = *impl_;
+    if (d.error) {
+        return tl::unexpected{*d.error};
+    }
+
+    if (!d.done) {
         return tl::unexpected{QoiError::AbruptEof};
     }
 
-    if (footer != decltype(footer){0, 0, 0, 0, 0, 0, 0, 1}) {
-        return tl::unexpected{QoiError::InvalidEndMarker};
+    return Qoi{.width = d.header->width, .height = d.header->height, .bytes = std::move(d.pixels)};
+}
+
+std::vector<std::byte> Qoi::encode(std::uint32_t width, std::uint32_t height, std::span<unsigned char const> rgba) {
+    auto const pixel_count = std::size_t{width} * height;
+    assert(pixel_count <= kMaxPixelCount);
+    assert(rgba.size() == pixel_count * 4);
+
+    // No pixel takes more than 5 bytes to encode, so the output is sized for
+    // the worst case up front and shrunk to fit at the end.
+    std::vector<std::byte> encoded(kHeaderSize + pixel_count * 5 + kEndMarker.size());
+    auto *const begin = reinterpret_cast<std::uint8_t *>(encoded.data());
+    auto *out = begin;
+
+    out = std::ranges::copy(kMagic, out).out;
+    out = write_be32(out, width);
+    out = write_be32(out, height);
+    *out++ = 4; // channels
+    *out++ = 0; // colorspace
+
+    Px previous_pixel{0, 0, 0, 255};
+    std::array<Px, 64> seen_pixels{};
+    int run_length = 0;
+    for (std::size_t i = 0; i < pixel_count; ++i) {
+        Px px{};
+        std::memcpy(&px, rgba.data() + i * 4, 4);
+
+        if (px == previous_pixel) {
+            ++run_length;
+            if (run_length == kMaxRunLength || i == pixel_count - 1) {
+                *out++ = static_cast<std::uint8_t>(kQoiOpRun | (run_length - 1));
+                run_length = 0;
+            }
+            continue;
+        }
+
+        if (run_length > 0) {
+            *out++ = static_cast<std::uint8_t>(kQoiOpRun | (run_length - 1));
+            run_length = 0;
+        }
+
+        auto const index = seen_pixels_index(px);
+        if (seen_pixels[index] == px) {
+            *out++ = static_cast<std::uint8_t>(kQoiOpIndex | index);
+            previous_pixel = px;
+            continue;
+        }
+
+        seen_pixels[index] = px;
+        if (px.a != previous_pixel.a) {
+            *out++ = kQoiOpRgba;
+            std::memcpy(out, &px, 4);
+            out += 4;
+            previous_pixel = px;
+            continue;
+        }
+
+        // Differences wrap around, e.g. 255 + 1 is 0.
+        auto const dr = static_cast<std::int8_t>(px.r - previous_pixel.r);
+        auto const dg = static_cast<std::int8_t>(px.g - previous_pixel.g);
+        auto const db = static_cast<std::int8_t>(px.b - previous_pixel.b);
+        auto const dr_dg = dr - dg;
+        auto const db_dg = db - dg;
+
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+            *out++ = static_cast<std::uint8_t>(kQoiOpDiff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+        } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+            *out++ = static_cast<std::uint8_t>(kQoiOpLuma | (dg + 32));
+            *out++ = static_cast<std::uint8_t>(((dr_dg + 8) << 4) | (db_dg + 8));
+        } else {
+            *out++ = kQoiOpRgb;
+            *out++ = px.r;
+            *out++ = px.g;
+            *out++ = px.b;
+        }
+
+        previous_pixel = px;
     }
 
-    return Qoi{
-            .width = width,
-            .height = height,
-            .bytes = std::move(pixels),
-    };
+    out = std::ranges::copy(kEndMarker, out).out;
+    encoded.resize(static_cast<std::size_t>(out - begin));
+    return encoded;
 }
 
 } // namespace img
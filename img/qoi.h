@@ -5,10 +5,16 @@
 #ifndef IMG_QOI_H_
 #define IMG_QOI_H_
 
+#include "img/scale.h"
+
 #include <tl/expected.hpp>
 
+#include <cstddef>
 #include <cstdint>
 #include <iosfwd>
+#include <memory>
+#include <optional>
+#include <span>
 #include <vector>
 
 namespace img {
@@ -28,6 +34,17 @@ class Qoi {
 public:
     static tl::expected<Qoi, QoiError> from(std::istream &&is) { return from(is); }
     static tl::expected<Qoi, QoiError> from(std::istream &is);
+    static tl::expected<Qoi, QoiError> from(std::span<std::byte const>);
+
+    // Decodes the image scaled down to fit in max_size, w/o ever keeping more
+    // than a row of the full-size image in memory.
+    static tl::expected<Qoi, QoiError> from(std::istream &&is, ImageSize max_size) { return from(is, max_size); }
+    static tl::expected<Qoi, QoiError> from(std::istream &, ImageSize max_size);
+    static tl::expected<Qoi, QoiError> from(std::span<std::byte const>, ImageSize max_size);
+
+    // Encodes RGBA pixel data, w/ 4 bytes per pixel, as a 4-channel sRGB image.
+    static std::vector<std::byte> encode(
+            std::uint32_t width, std::uint32_t height, std::span<unsigned char const> rgba);
 
     std::uint32_t width{};
     std::uint32_t height{};
@@ -36,6 +53,35 @@ public:
     [[nodiscard]] bool operator==(Qoi const &) const = default;
 };
 
+// Decodes a QOI image as its data comes in, so that the rows decoded so far
+// can be shown while the rest of it is still being downloaded.
+class QoiDecoder {
+public:
+    QoiDecoder();
+    ~QoiDecoder();
+
+    QoiDecoder(QoiDecoder &&) noexcept;
+    QoiDecoder &operator=(QoiDecoder &&) noexcept;
+
+    // Running out of data isn't an error, but anything else is, and nothing
+    // more is decoded after one.
+    tl::expected<void, QoiError> feed(std::span<std::byte const>);
+
+    // Known once the header has been fed.
+    [[nodiscard]] std::optional<ImageSize> size() const;
+    // The whole image, w/ the pixels not decoded yet transparent.
+    [[nodiscard]] std::span<unsigned char const> pixels() const;
+    [[nodiscard]] std::uint32_t rows_decoded() const;
+    [[nodiscard]] bool done() const;
+
+    // The decoded image, or AbruptEof if it isn't done yet.
+    [[nodiscard]] tl::expected<Qoi, QoiError> take();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
 } // namespace img
 
 #endif
@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "img/qoi.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Something photo-ish, w/ smooth gradients, and something UI-ish, w/ long runs
+// of the same color.
+std::vector<unsigned char> make_image(std::uint32_t width, std::uint32_t height, bool flat) {
+    std::vector<unsigned char> pixels;
+    pixels.reserve(std::size_t{width} * height * 4);
+    std::uint32_t noise = 1;
+    for (std::uint32_t y = 0; y < height; ++y) {
+        for (std::uint32_t x = 0; x < width; ++x) {
+            noise = noise * 1664525 + 1013904223;
+            if (flat) {
+                auto const c = static_cast<unsigned char>((x / 64 + y / 32) % 2 == 0 ? 240 : 30);
+                pixels.insert(pixels.end(), {c, c, c, 255});
+            } else {
+                pixels.insert(pixels.end(),
+                        {static_cast<unsigned char>(x + (noise >> 30)),
+                                static_cast<unsigned char>(y + (noise >> 29)),
+                                static_cast<unsigned char>((x + y) / 2),
+                                255});
+            }
+        }
+    }
+    return pixels;
+}
+
+template<typename F>
+double mb_per_s(std::size_t bytes, int iterations, F &&f) {
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        f();
+    }
+    std::chrono::duration<double> const duration = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(bytes) * iterations / duration.count() / 1'000'000.;
+}
+
+} // namespace
+
+// Measures QOI encoding and decoding throughput in MB of RGBA pixel data per
+// second.
+int main(int argc, char **argv) {
+    int const iterations = argc > 1 ? std::atoi(argv[1]) : 20;
+    constexpr std::uint32_t kWidth = 1920;
+    constexpr std::uint32_t kHeight = 1080;
+
+    for (bool flat : {false, true}) {
+        auto const pixels = make_image(kWidth, kHeight, flat);
+        auto const encoded = img::Qoi::encode(kWidth, kHeight, pixels);
+        std::string const encoded_str{reinterpret_cast<char const *>(encoded.data()), encoded.size()};
+
+        bool ok = true;
+        auto const encode = mb_per_s(pixels.size(), iterations, [&] {
+            ok &= !img::Qoi::encode(kWidth, kHeight, pixels).empty(); //
+        });
+        auto const decode = mb_per_s(pixels.size(), iterations, [&] {
+            ok &= img::Qoi::from(std::span{encoded}).has_value(); //
+        });
+        auto const decode_stream = mb_per_s(pixels.size(), iterations, [&] {
+            ok &= img::Qoi::from(std::istringstream{encoded_str}).has_value(); //
+        });
+
+        if (!ok) {
+            std::cerr << "Round-tripping failed\n";
+            return 1;
+        }
+
+        std::cout << (flat ? "flat" : "photo") << " " << kWidth << "x" << kHeight << ", " << encoded.size()
+                  << " bytes encoded\n";
+        std::cout << "  encode: " << encode << " MB/s\n";
+        std::cout << "  decode: " << decode << " MB/s\n";
+        std::cout << "  decode (istream): " << decode_stream << " MB/s\n";
+    }
+}
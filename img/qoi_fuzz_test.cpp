@@ -1,4 +1,4 @@
-// SPDX-FileCopyrightText: 2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2023-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
@@ -6,14 +6,12 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <sstream>
-#include <string>
+#include <span>
 #include <tuple>
 
 extern "C" int LLVMFuzzerTestOneInput(std::uint8_t const *data, std::size_t size);
 
 extern "C" int LLVMFuzzerTestOneInput(std::uint8_t const *data, std::size_t size) {
-    std::ignore = img::Qoi::from( //
-            std::stringstream{std::string{reinterpret_cast<char const *>(data), size}});
+    std::ignore = img::Qoi::from(std::span{reinterpret_cast<std::byte const *>(data), size});
     return 0;
 }
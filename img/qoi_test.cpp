@@ -1,22 +1,77 @@
-// SPDX-FileCopyrightText: 2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2023-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "img/qoi.h"
 
+#include "img/scale.h"
+
 #include "etest/etest.h"
 
 #include <tl/expected.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <vector>
 
+using etest::expect;
 using etest::expect_eq;
 using img::Qoi;
 using img::QoiError;
 
 using namespace std::literals;
 
+namespace {
+
+std::span<std::byte const> as_bytes(std::string_view s) {
+    return std::as_bytes(std::span{s});
+}
+
+std::vector<unsigned char> make_pixels(std::size_t count, std::uint32_t seed) {
+    std::vector<unsigned char> pixels;
+    pixels.reserve(count * 4);
+    for (std::size_t i = 0; i < count; ++i) {
+        // A mix of runs, small and large differences, and alpha changes.
+        seed = seed * 1664525 + 1013904223;
+        auto const x = static_cast<unsigned char>(i);
+        switch (seed >> 29) {
+            case 0:
+            case 1:
+                if (!pixels.empty()) {
+                    pixels.insert(pixels.end(), pixels.end() - 4, pixels.end());
+                    continue;
+                }
+                break;
+            case 2:
+                pixels.insert(pixels.end(), {x, static_cast<unsigned char>(x + 1), x, 255});
+                continue;
+            case 3:
+                pixels.insert(pixels.end(),
+                        {static_cast<unsigned char>(x + 9), static_cast<unsigned char>(x + 20), x, 255});
+                continue;
+            case 4:
+                pixels.insert(pixels.end(), {0, 0, 0, static_cast<unsigned char>(seed >> 8)});
+                continue;
+            default:
+                break;
+        }
+
+        pixels.insert(pixels.end(),
+                {static_cast<unsigned char>(seed >> 8),
+                        static_cast<unsigned char>(seed >> 16),
+                        static_cast<unsigned char>(seed >> 24),
+                        255});
+    }
+    return pixels;
+}
+
+} // namespace
+
 int main() {
     etest::test("abrupt eof before magic", [] {
         expect_eq(Qoi::from(std::stringstream{"qoi"s}), tl::unexpected{QoiError::AbruptEof}); //
@@ -121,5 +176,174 @@ int main() {
                 Qoi{.width = 1, .height = 2, .bytes{1, 2, 3, 255, 6, 5, 4, 255}});
     });
 
+    etest::test("span, it works", [] {
+        expect_eq(Qoi::from(as_bytes("qoif\0\0\0\1\0\0\0\2\3\1\xfe\1\2\3\xfe\6\5\4\0\0\0\0\0\0\0\1"sv)),
+                Qoi{.width = 1, .height = 2, .bytes{1, 2, 3, 255, 6, 5, 4, 255}});
+    });
+
+    etest::test("span, abrupt eof", [] {
+        auto const qoi = "qoif\0\0\0\1\0\0\0\2\3\1\xfe\1\2\3\xfe\6\5\4\0\0\0\0\0\0\0\1"sv;
+        for (std::size_t i = 0; i < qoi.size(); ++i) {
+            expect_eq(Qoi::from(as_bytes(qoi.substr(0, i))), tl::unexpected{QoiError::AbruptEof});
+        }
+    });
+
+    etest::test("span, runs past the end of the image are cut short", [] {
+        expect_eq(Qoi::from(as_bytes("qoif\0\0\0\2\0\0\0\1\3\1\xc5\0\0\0\0\0\0\0\1"sv)),
+                Qoi{.width = 2, .height = 1, .bytes{0, 0, 0, 255, 0, 0, 0, 255}});
+    });
+
+    etest::test("encode, 0x0 image", [] {
+        auto encoded = Qoi::encode(0, 0, {});
+        expect_eq(encoded.size(), std::size_t{14 + 8});
+        expect_eq(Qoi::from(encoded), Qoi{});
+    });
+
+    etest::test("encode, ops", [] {
+        std::vector<unsigned char> const pixels{
+                0, 0, 0, 255, // QOI_OP_RUN (matches the initial previous pixel)
+                0, 0, 0, 255, // QOI_OP_RUN
+                1, 255, 0, 255, // QOI_OP_DIFF
+                18, 10, 8, 255, // QOI_OP_LUMA
+                200, 10, 8, 255, // QOI_OP_RGB
+                200, 10, 8, 100, // QOI_OP_RGBA
+                1, 255, 0, 255, // QOI_OP_INDEX
+        };
+
+        auto encoded = Qoi::encode(7, 1, pixels);
+        std::vector<std::uint8_t> ops;
+        for (auto b : std::span{encoded}.subspan(14, encoded.size() - 14 - 8)) {
+            ops.push_back(static_cast<std::uint8_t>(b));
+        }
+
+        expect_eq(ops,
+                std::vector<std::uint8_t>{
+                        0xc1,
+                        0x40 | (3 << 4) | (1 << 2) | 2,
+                        0x80 | (11 + 32),
+                        ((6 + 8) << 4) | (-3 + 8),
+                        0xfe,
+                        200,
+                        10,
+                        8,
+                        0xff,
+                        200,
+                        10,
+                        8,
+                        100,
+                        static_cast<std::uint8_t>((1 * 3 + 255 * 5 + 0 * 7 + 255 * 11) % 64),
+                });
+        expect_eq(Qoi::from(encoded), Qoi{.width = 7, .height = 1, .bytes = pixels});
+    });
+
+    etest::test("encode, long runs are split", [] {
+        std::vector<unsigned char> pixels;
+        for (int i = 0; i < 130; ++i) {
+            pixels.insert(pixels.end(), {5, 5, 5, 5});
+        }
+
+        auto encoded = Qoi::encode(13, 10, pixels);
+        // RGBA, then runs of 62, 62, and 5.
+        expect_eq(encoded.size(), std::size_t{14 + 5 + 3 + 8});
+        expect_eq(Qoi::from(encoded), Qoi{.width = 13, .height = 10, .bytes = pixels});
+    });
+
+    etest::test("encode, round trip", [] {
+        for (std::uint32_t seed = 0; seed < 10; ++seed) {
+            auto const pixels = make_pixels(64 * 48, seed);
+            expect_eq(Qoi::from(Qoi::encode(64, 48, pixels)), Qoi{.width = 64, .height = 48, .bytes = pixels});
+        }
+    });
+
+    etest::test("scaled, matches downscaling the full image", [] {
+        auto const pixels = make_pixels(64 * 48, 3);
+        auto const encoded = Qoi::encode(64, 48, pixels);
+        img::Downscaler downscaler{{64, 48}, {16, 12}};
+        for (std::size_t y = 0; y < 48; ++y) {
+            downscaler.add_row(std::span{pixels}.subspan(y * 64 * 4, 64 * 4));
+        }
+
+        expect_eq(Qoi::from(encoded, {16, 16}), Qoi{.width = 16, .height = 12, .bytes = downscaler.take()});
+    });
+
+    etest::test("scaled, already small enough", [] {
+        auto const pixels = make_pixels(7 * 5, 4);
+        expect_eq(Qoi::from(Qoi::encode(7, 5, pixels), {100, 100}), Qoi{.width = 7, .height = 5, .bytes = pixels});
+    });
+
+    etest::test("scaled, runs across rows", [] {
+        // 3 rows of 2 pixels, all covered by a single run.
+        expect_eq(Qoi::from(as_bytes("qoif\0\0\0\2\0\0\0\3\3\1\xc5\0\0\0\0\0\0\0\1"sv), {1, 1}),
+                Qoi{.width = 1, .height = 1, .bytes{0, 0, 0, 255}});
+    });
+
+    etest::test("scaled, abrupt eof", [] {
+        auto const qoi = "qoif\0\0\0\2\0\0\0\2\3\1\xfe\1\2\3\xfe\6\5\4\xc1\0\0\0\0\0\0\0\1"s;
+        for (std::size_t i = 14; i < qoi.size(); ++i) {
+            expect_eq(Qoi::from(as_bytes(qoi.substr(0, i)), {1, 1}), tl::unexpected{QoiError::AbruptEof});
+        }
+    });
+
+    etest::test("decoder, byte by byte", [] {
+        auto const pixels = make_pixels(64 * 48, 5);
+        auto const encoded = Qoi::encode(64, 48, pixels);
+
+        img::QoiDecoder decoder;
+        std::uint32_t rows = 0;
+        for (std::size_t i = 0; i < encoded.size(); ++i) {
+            expect(decoder.feed(std::span{encoded}.subspan(i, 1)).has_value());
+            expect_eq(decoder.size().has_value(), i + 1 >= 14);
+            expect(decoder.rows_decoded() >= rows);
+            rows = decoder.rows_decoded();
+
+            // The rows decoded so far are already in place.
+            auto const decoded_bytes = std::size_t{rows} * 64 * 4;
+            if (i % 97 == 0 && decoded_bytes > 0) {
+                auto const expected = std::span{pixels}.first(decoded_bytes);
+                expect(std::ranges::equal(decoder.pixels().first(decoded_bytes), expected));
+            }
+
+            expect_eq(decoder.done(), i == encoded.size() - 1);
+        }
+
+        expect_eq(rows, std::uint32_t{48});
+        expect_eq(decoder.take(), Qoi{.width = 64, .height = 48, .bytes = pixels});
+    });
+
+    etest::test("decoder, chunks", [] {
+        auto const pixels = make_pixels(31 * 17, 6);
+        auto const encoded = Qoi::encode(31, 17, pixels);
+        for (std::size_t chunk_size : {2, 3, 5, 7, 64}) {
+            img::QoiDecoder decoder;
+            for (std::size_t i = 0; i < encoded.size(); i += chunk_size) {
+                auto const chunk = std::span{encoded}.subspan(i, std::min(chunk_size, encoded.size() - i));
+                expect(decoder.feed(chunk).has_value());
+            }
+            expect_eq(decoder.take(), Qoi{.width = 31, .height = 17, .bytes = pixels});
+        }
+    });
+
+    etest::test("decoder, not done", [] {
+        img::QoiDecoder decoder;
+        expect_eq(decoder.take(), tl::unexpected{QoiError::AbruptEof});
+        expect(decoder.feed(as_bytes("qoif\0\0\0\1\0\0\0\1\3\1\xfe\1\2\3"sv)).has_value());
+        expect_eq(decoder.rows_decoded(), std::uint32_t{1});
+        expect(!decoder.done());
+        expect_eq(decoder.take(), tl::unexpected{QoiError::AbruptEof});
+    });
+
+    etest::test("decoder, errors", [] {
+        img::QoiDecoder decoder;
+        expect(decoder.feed(as_bytes("qo"sv)).has_value());
+        expect_eq(decoder.feed(as_bytes("ib"sv)), tl::unexpected{QoiError::InvalidMagic});
+        // Nothing more is decoded after an error.
+        expect_eq(decoder.feed(as_bytes("qoif"sv)), tl::unexpected{QoiError::InvalidMagic});
+        expect_eq(decoder.take(), tl::unexpected{QoiError::InvalidMagic});
+
+        img::QoiDecoder footer;
+        expect_eq(footer.feed(as_bytes("qoif\0\0\0\1\0\0\0\1\3\1\xfe\1\2\3\0\0\0\0\0\0\0\2"sv)),
+                tl::unexpected{QoiError::InvalidEndMarker});
+    });
+
     return etest::run_all_tests();
 }
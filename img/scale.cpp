@@ -0,0 +1,102 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "img/scale.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+namespace img {
+namespace {
+
+// Which of `to` output pixels the input pixel at `i` of `from` ends up in.
+std::uint32_t map(std::uint32_t i, std::uint32_t from, std::uint32_t to) {
+    return static_cast<std::uint32_t>(std::uint64_t{i} * to / from);
+}
+
+} // namespace
+
+ImageSize fit_within(ImageSize image, ImageSize box) {
+    if (image.width <= box.width && image.height <= box.height) {
+        return image;
+    }
+
+    // Scale by whichever dimension is the most constrained.
+    ImageSize fitted{};
+    if (std::uint64_t{image.width} * box.height > std::uint64_t{image.height} * box.width) {
+        fitted.width = box.width;
+        fitted.height = static_cast<std::uint32_t>(std::uint64_t{image.height} * box.width / image.width);
+    } else {
+        fitted.height = box.height;
+        fitted.width = static_cast<std::uint32_t>(std::uint64_t{image.width} * box.height / image.height);
+    }
+
+    fitted.width = std::max(fitted.width, std::uint32_t{1});
+    fitted.height = std::max(fitted.height, std::uint32_t{1});
+    return fitted;
+}
+
+Downscaler::Downscaler(ImageSize from, ImageSize to)
+    : from_{from}, to_{to}, column_counts_(to.width), sums_(std::size_t{to.width} * 4) {
+    assert(to.width <= from.width && to.height <= from.height);
+    assert(to.width > 0 || from.width == 0);
+    assert(to.height > 0 || from.height == 0);
+
+    columns_.reserve(from.width);
+    for (std::uint32_t x = 0; x < from.width; ++x) {
+        columns_.push_back(map(x, from.width, to.width));
+        ++column_counts_[columns_.back()];
+    }
+
+    out_.reserve(std::size_t{to.width} * to.height * 4);
+}
+
+void Downscaler::add_row(std::span<unsigned char const> rgba) {
+    assert(rgba.size() == std::size_t{from_.width} * 4);
+    assert(row_ < from_.height);
+
+    for (std::uint32_t x = 0; x < from_.width; ++x) {
+        auto const *px = rgba.data() + std::size_t{x} * 4;
+        auto *sum = sums_.data() + std::size_t{columns_[x]} * 4;
+        std::uint64_t const a = px[3];
+        sum[0] += px[0] * a;
+        sum[1] += px[1] * a;
+        sum[2] += px[2] * a;
+        sum[3] += a;
+    }
+
+    ++rows_in_sums_;
+    ++row_;
+    if (row_ == from_.height || map(row_, from_.height, to_.height) != map(row_ - 1, from_.height, to_.height)) {
+        flush_row();
+    }
+}
+
+void Downscaler::flush_row() {
+    for (std::uint32_t x = 0; x < to_.width; ++x) {
+        auto *sum = sums_.data() + std::size_t{x} * 4;
+        auto const count = std::uint64_t{column_counts_[x]} * rows_in_sums_;
+        auto const alpha = sum[3];
+        if (alpha == 0) {
+            out_.insert(out_.end(), {0, 0, 0, 0});
+        } else {
+            out_.insert(out_.end(),
+                    {
+                            static_cast<unsigned char>((sum[0] + alpha / 2) / alpha),
+                            static_cast<unsigned char>((sum[1] + alpha / 2) / alpha),
+                            static_cast<unsigned char>((sum[2] + alpha / 2) / alpha),
+                            static_cast<unsigned char>((alpha + count / 2) / count),
+                    });
+        }
+    }
+
+    std::ranges::fill(sums_, std::uint64_t{0});
+    rows_in_sums_ = 0;
+}
+
+} // namespace img
@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef IMG_SCALE_H_
+#define IMG_SCALE_H_
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace img {
+
+struct ImageSize {
+    std::uint32_t width{};
+    std::uint32_t height{};
+
+    [[nodiscard]] bool operator==(ImageSize const &) const = default;
+};
+
+// The largest size w/ the same aspect ratio as `image` that fits in `box`.
+// Images are never scaled up, and never scaled down to nothing.
+ImageSize fit_within(ImageSize image, ImageSize box);
+
+// Scales RGBA images down a row at a time, so that decoders don't have to keep
+// the full-size image around. Every output pixel is the average of the input
+// pixels mapping to it, weighted by their alpha so that the colors of
+// transparent pixels don't bleed into their neighbours.
+class Downscaler {
+public:
+    Downscaler(ImageSize from, ImageSize to);
+
+    // Rows have to be added in order, and there have to be from.height of them.
+    void add_row(std::span<unsigned char const> rgba);
+
+    [[nodiscard]] ImageSize size() const { return to_; }
+    [[nodiscard]] std::vector<unsigned char> take() { return std::move(out_); }
+
+private:
+    void flush_row();
+
+    ImageSize from_{};
+    ImageSize to_{};
+    std::vector<std::uint32_t> columns_;
+    std::vector<std::uint32_t> column_counts_;
+    std::vector<std::uint64_t> sums_;
+    std::uint32_t row_{};
+    std::uint32_t rows_in_sums_{};
+    std::vector<unsigned char> out_;
+};
+
+} // namespace img
+
+#endif
@@ -0,0 +1,141 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "img/jpeg.h"
+#include "img/png.h"
+#include "img/qoi.h"
+#include "img/scale.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+constexpr std::uint32_t kWidth = 2400;
+constexpr std::uint32_t kHeight = 1600;
+constexpr int kGallerySize = 16;
+constexpr img::ImageSize kThumbnailSize{300, 300};
+
+std::vector<unsigned char> make_image(std::uint32_t width, std::uint32_t height) {
+    std::vector<unsigned char> pixels;
+    pixels.reserve(std::size_t{width} * height * 4);
+    std::uint32_t noise = 1;
+    for (std::uint32_t y = 0; y < height; ++y) {
+        for (std::uint32_t x = 0; x < width; ++x) {
+            noise = noise * 1664525 + 1013904223;
+            pixels.insert(pixels.end(),
+                    {static_cast<unsigned char>(x / 8 + (noise >> 30)),
+                            static_cast<unsigned char>(y / 8 + (noise >> 29)),
+                            static_cast<unsigned char>((x + y) / 16),
+                            255});
+        }
+    }
+    return pixels;
+}
+
+// In MB, or 0 where it can't be measured.
+double peak_rss() {
+#ifndef _WIN32
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<double>(usage.ru_maxrss) / 1'000'000.;
+#else
+    return static_cast<double>(usage.ru_maxrss) / 1'000.;
+#endif
+#else
+    return 0.;
+#endif
+}
+
+} // namespace
+
+// Decodes a gallery page's worth of large images, either at full size or as
+// thumbnails, and reports the time taken and the peak RSS. The peak can only
+// ever go up, so each mode needs its own run.
+int main(int argc, char **argv) {
+    if (argc < 2 || (argv[1] != std::string_view{"full"} && argv[1] != std::string_view{"thumbnail"})) {
+        std::cerr << "Usage: " << argv[0] << " <full|thumbnail> [JPEGs to add to the gallery...]\n";
+        return 1;
+    }
+
+    bool const thumbnails = argv[1] == std::string_view{"thumbnail"};
+
+    std::string png;
+    std::vector<std::byte> qoi;
+    {
+        auto const pixels = make_image(kWidth, kHeight);
+        std::ostringstream ss;
+        if (!img::Png::write(ss, kWidth, kHeight, pixels)) {
+            std::cerr << "Unable to encode PNG\n";
+            return 1;
+        }
+        png = std::move(ss).str();
+        qoi = img::Qoi::encode(kWidth, kHeight, pixels);
+    }
+
+    std::vector<std::string> jpegs;
+    for (int i = 2; i < argc; ++i) {
+        std::ifstream file{argv[i], std::ios::binary};
+        std::stringstream ss;
+        ss << file.rdbuf();
+        jpegs.push_back(std::move(ss).str());
+    }
+
+    auto const rss_before = peak_rss();
+    auto const start = std::chrono::steady_clock::now();
+
+    // Everything is kept around, like it would be when displaying the page.
+    std::vector<std::vector<unsigned char>> gallery;
+    std::size_t decoded_bytes = 0;
+    auto const keep = [&](auto image) {
+        if (!image) {
+            return false;
+        }
+
+        decoded_bytes += image->bytes.size();
+        gallery.push_back(std::move(image->bytes));
+        return true;
+    };
+
+    bool ok = true;
+    for (int i = 0; i < kGallerySize; ++i) {
+        if (thumbnails) {
+            ok &= keep(img::Png::from(std::istringstream{png}, kThumbnailSize));
+            ok &= keep(img::Qoi::from(std::span{qoi}, kThumbnailSize));
+            for (auto const &jpeg : jpegs) {
+                ok &= keep(img::Jpeg::from(std::as_bytes(std::span{jpeg}), kThumbnailSize));
+            }
+        } else {
+            ok &= keep(img::Png::from(std::istringstream{png}));
+            ok &= keep(img::Qoi::from(std::span{qoi}));
+            for (auto const &jpeg : jpegs) {
+                ok &= keep(img::Jpeg::from(std::as_bytes(std::span{jpeg})));
+            }
+        }
+    }
+
+    std::chrono::duration<double> const duration = std::chrono::steady_clock::now() - start;
+    if (!ok) {
+        std::cerr << "Decoding failed\n";
+        return 1;
+    }
+
+    std::cout << gallery.size() << " images decoded " << (thumbnails ? "as thumbnails" : "at full size") << " in "
+              << duration.count() << "s\n";
+    std::cout << "  decoded pixel data: " << static_cast<double>(decoded_bytes) / 1'000'000. << " MB\n";
+    std::cout << "  peak RSS: " << rss_before << " MB before decoding, " << peak_rss() << " MB after\n";
+}
@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "img/scale.h"
+
+#include "etest/etest2.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using img::Downscaler;
+using img::ImageSize;
+
+namespace {
+
+std::vector<unsigned char> downscale(ImageSize from, ImageSize to, std::vector<unsigned char> const &rgba) {
+    Downscaler downscaler{from, to};
+    auto const row_size = std::size_t{from.width} * 4;
+    for (std::uint32_t y = 0; y < from.height; ++y) {
+        downscaler.add_row(std::span{rgba}.subspan(y * row_size, row_size));
+    }
+    return downscaler.take();
+}
+
+} // namespace
+
+int main() {
+    etest::Suite s;
+
+    s.add_test("fit_within, already fits", [](etest::IActions &a) {
+        a.expect_eq(img::fit_within({10, 20}, {10, 20}), ImageSize{10, 20});
+        a.expect_eq(img::fit_within({10, 20}, {100, 100}), ImageSize{10, 20});
+    });
+
+    s.add_test("fit_within, keeps the aspect ratio", [](etest::IActions &a) {
+        a.expect_eq(img::fit_within({3000, 2000}, {300, 300}), ImageSize{300, 200});
+        a.expect_eq(img::fit_within({2000, 3000}, {300, 300}), ImageSize{200, 300});
+        a.expect_eq(img::fit_within({3000, 2000}, {3000, 100}), ImageSize{150, 100});
+    });
+
+    s.add_test("fit_within, never scales down to nothing", [](etest::IActions &a) {
+        a.expect_eq(img::fit_within({1000, 1}, {10, 10}), ImageSize{10, 1});
+        a.expect_eq(img::fit_within({1, 1000}, {10, 10}), ImageSize{1, 10});
+        a.expect_eq(img::fit_within({10, 10}, {0, 0}), ImageSize{1, 1});
+    });
+
+    s.add_test("downscaler, same size", [](etest::IActions &a) {
+        std::vector<unsigned char> const rgba{1, 2, 3, 4, 5, 6, 7, 8};
+        a.expect_eq(downscale({1, 2}, {1, 2}, rgba), rgba);
+    });
+
+    s.add_test("downscaler, averages", [](etest::IActions &a) {
+        std::vector<unsigned char> const rgba{
+                0, 10, 100, 255, 10, 20, 200, 255, 7, 7, 7, 255, //
+                20, 30, 100, 255, 30, 40, 200, 255, 9, 9, 9, 255, //
+        };
+
+        // The 2x2 block and the 1x2 column that's left over.
+        a.expect_eq(downscale({3, 2}, {2, 1}, rgba),
+                std::vector<unsigned char>{15, 25, 150, 255, 8, 8, 8, 255});
+        a.expect_eq(downscale({3, 2}, {1, 1}, rgba), std::vector<unsigned char>{13, 19, 103, 255});
+    });
+
+    s.add_test("downscaler, transparent pixels don't affect the color", [](etest::IActions &a) {
+        std::vector<unsigned char> const rgba{
+                200, 100, 50, 255, 0, 0, 0, 0, //
+                0, 0, 0, 0, 100, 50, 0, 255, //
+        };
+        a.expect_eq(downscale({2, 2}, {1, 1}, rgba), std::vector<unsigned char>{150, 75, 25, 128});
+
+        std::vector<unsigned char> const invisible{1, 2, 3, 0, 4, 5, 6, 0};
+        a.expect_eq(downscale({2, 1}, {1, 1}, invisible), std::vector<unsigned char>{0, 0, 0, 0});
+    });
+
+    s.add_test("downscaler, many rows per output row", [](etest::IActions &a) {
+        std::vector<unsigned char> rgba;
+        for (int y = 0; y < 100; ++y) {
+            auto const c = static_cast<unsigned char>(y < 50 ? 0 : 200);
+            rgba.insert(rgba.end(), {c, c, c, 255});
+        }
+
+        a.expect_eq(downscale({1, 100}, {1, 2}, rgba), std::vector<unsigned char>{0, 0, 0, 255, 200, 200, 200, 255});
+    });
+
+    return s.run();
+}
@@ -6,6 +6,7 @@
 #include "layout/layout.h"
 
 #include "layout/layout_box.h"
+#include "layout/line_breaker.h"
 
 #include "css/property_id.h"
 #include "dom/dom.h"
@@ -20,8 +21,11 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdlib>
+#include <functional>
 #include <iterator>
 #include <list>
 #include <memory>
@@ -30,6 +34,8 @@
 #include <span>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -41,13 +47,40 @@ namespace {
 
 class Layouter {
 public:
-    Layouter(style::ResolutionInfo context, type::IType const &type) : resolution_context_{context}, type_{type} {}
+    Layouter(style::ResolutionInfo context,
+            type::IType const &type,
+            std::function<std::optional<IntrinsicSize>(dom::Element const &)> intrinsic_size)
+        : resolution_context_{context}, type_{type}, intrinsic_size_{std::move(intrinsic_size)} {}
 
     void layout(LayoutBox &, geom::Rect const &bounds) const;
 
+    // Lays out all anonymous blocks whose width only depends on the width of
+    // their block ancestors ahead of time, spread over several threads. Their
+    // position isn't known until their preceding siblings have been laid out,
+    // so they're laid out at the origin and moved into place by layout().
+    void layout_anonymous_blocks_ahead(LayoutBox &, int width, unsigned threads);
+
 private:
+    struct AnonymousBlock {
+        LayoutBox *box{};
+        int width{};
+        std::size_t cost{};
+        // The block as it was before being laid out, in case it ends up
+        // being laid out w/ a different width after all.
+        LayoutBox unlaid{};
+    };
+
     style::ResolutionInfo resolution_context_;
     type::IType const &type_;
+    std::function<std::optional<IntrinsicSize>(dom::Element const &)> intrinsic_size_;
+    // Anonymous block -> what it was laid out ahead of time with.
+    std::unordered_map<LayoutBox const *, AnonymousBlock> laid_out_ahead_;
+
+    void collect_anonymous_blocks(LayoutBox &, geom::Rect const &bounds, std::vector<AnonymousBlock> &) const;
+
+    // The size of the content of replaced elements, or nullopt for everything
+    // else.
+    std::optional<IntrinsicSize> intrinsic_size(LayoutBox const &) const;
 
     void layout_inline(LayoutBox &, geom::Rect const &bounds) const;
     void layout_block(LayoutBox &, geom::Rect const &bounds) const;
@@ -71,7 +104,7 @@ bool last_node_was_anonymous(LayoutBox const &box) {
 
 // https://www.w3.org/TR/CSS2/visuren.html#box-gen
 // NOLINTNEXTLINE(misc-no-recursion)
-std::optional<LayoutBox> create_tree(style::StyledNode const &node) {
+std::optional<LayoutBox> create_tree(style::StyledNode const &node, LayoutOptions const &opts) {
     if (auto const *text = std::get_if<dom::Text>(&node.node)) {
         return LayoutBox{.node = &node, .layout_text = std::string_view{text->text}};
     }
@@ -83,6 +116,11 @@ std::optional<LayoutBox> create_tree(style::StyledNode const &node) {
     }
 
     if (auto const &element = std::get<dom::Element>(node.node); element.name == "img"sv) {
+        // Loaded images are replaced elements w/o any children of their own.
+        if (opts.intrinsic_size && opts.intrinsic_size(element)) {
+            return LayoutBox{.node = &node};
+        }
+
         if (auto alt = element.attributes.find("alt"sv); alt != element.attributes.end()) {
             return LayoutBox{.node = &node, .layout_text = std::string_view{alt->second}};
         }
@@ -91,7 +129,7 @@ std::optional<LayoutBox> create_tree(style::StyledNode const &node) {
     LayoutBox box{&node};
 
     for (auto const &child : node.children) {
-        auto child_box = create_tree(child);
+        auto child_box = create_tree(child, opts);
         if (!child_box) {
             continue;
         }
@@ -266,6 +304,23 @@ void apply_text_transforms(LayoutBox &box) {
     }
 }
 
+// NOLINTNEXTLINE(misc-no-recursion)
+void translate(LayoutBox &box, int dx, int dy) {
+    box.dimensions.content = box.dimensions.content.translated(dx, dy);
+    for (auto &child : box.children) {
+        translate(child, dx, dy);
+    }
+}
+
+// NOLINTNEXTLINE(misc-no-recursion)
+std::size_t text_size(LayoutBox const &box) {
+    auto size = box.text().transform([](std::string_view text) { return text.size(); }).value_or(0);
+    for (auto const &child : box.children) {
+        size += text_size(child);
+    }
+    return size;
+}
+
 void calculate_position(LayoutBox &box, geom::Rect const &parent) {
     auto const &d = box.dimensions;
     box.dimensions.content.x = parent.x + d.padding.left + d.border.left + d.margin.left;
@@ -276,6 +331,18 @@ void calculate_position(LayoutBox &box, geom::Rect const &parent) {
 // NOLINTNEXTLINE(misc-no-recursion)
 void Layouter::layout(LayoutBox &box, geom::Rect const &bounds) const {
     if (box.is_anonymous_block()) {
+        if (auto it = laid_out_ahead_.find(&box); it != laid_out_ahead_.end()) {
+            if (it->second.width == bounds.width) {
+                // This is exactly where layout_anonymous_block would have put it.
+                translate(box, bounds.x, bounds.y + bounds.height);
+                return;
+            }
+
+            // The width guessed ahead of time was wrong, so the line breaks
+            // are as well. Start over from the block as it was.
+            box = it->second.unlaid;
+        }
+
         layout_anonymous_block(box, bounds);
         return;
     }
@@ -291,6 +358,70 @@ void Layouter::layout(LayoutBox &box, geom::Rect const &bounds) const {
     layout_block(box, bounds);
 }
 
+void Layouter::layout_anonymous_blocks_ahead(LayoutBox &root, int width, unsigned threads) {
+    std::vector<AnonymousBlock> blocks;
+    collect_anonymous_blocks(root, {0, 0, width, 0}, blocks);
+    if (blocks.size() < 2) {
+        return;
+    }
+
+    // Starting w/ the most expensive blocks keeps a single large block from
+    // being picked up last and leaving the other threads idle.
+    std::ranges::stable_sort(blocks, std::ranges::greater{}, &AnonymousBlock::cost);
+
+    std::atomic<std::size_t> next_block{0};
+    auto work = [&] {
+        for (auto i = next_block.fetch_add(1); i < blocks.size(); i = next_block.fetch_add(1)) {
+            blocks[i].unlaid = *blocks[i].box;
+            layout_anonymous_block(*blocks[i].box, {0, 0, blocks[i].width, 0});
+        }
+    };
+
+    {
+        auto const helpers = std::clamp(blocks.size(), std::size_t{1}, std::size_t{threads}) - 1;
+        std::vector<std::jthread> workers;
+        workers.reserve(helpers);
+        for (std::size_t i = 0; i < helpers; ++i) {
+            workers.emplace_back(work);
+        }
+
+        work();
+    }
+
+    for (auto &block : blocks) {
+        laid_out_ahead_.emplace(block.box, std::move(block));
+    }
+}
+
+// The width of a block box only depends on its containing block's width, so
+// the width available to an anonymous block is known before anything's been
+// laid out as long as all its ancestors are blocks.
+// NOLINTNEXTLINE(misc-no-recursion)
+void Layouter::collect_anonymous_blocks(
+        LayoutBox &box, geom::Rect const &bounds, std::vector<AnonymousBlock> &out) const {
+    assert(box.node);
+    if (box.get_property<css::PropertyId::Display>() == style::Display::inline_flow()) {
+        return;
+    }
+
+    // The dimensions are calculated for real when the box is laid out.
+    auto const dimensions = box.dimensions;
+    auto font_size = box.get_property<css::PropertyId::FontSize>();
+    calculate_padding(box, font_size);
+    calculate_border(box, font_size);
+    calculate_width_and_margin(box, bounds, font_size);
+    geom::Rect const content{0, 0, box.dimensions.content.width, 0};
+    box.dimensions = dimensions;
+
+    for (auto &child : box.children) {
+        if (child.is_anonymous_block()) {
+            out.push_back({.box = &child, .width = content.width, .cost = text_size(child)});
+        } else {
+            collect_anonymous_blocks(child, content, out);
+        }
+    }
+}
+
 type::Weight to_type(std::optional<style::FontWeight> const &weight) {
     if (!weight || weight->value < style::FontWeight::kBold) {
         return type::Weight::Normal;
@@ -316,6 +447,8 @@ void Layouter::layout_inline(LayoutBox &box, geom::Rect const &bounds) const {
             spdlog::warn("No font found for font-families: {}", fmt::join(font_families, ", "));
             box.dimensions.content.width = type::NaiveFont{}.measure(*text, type::Px{font_size}, weight).width;
         }
+    } else if (auto size = intrinsic_size(box)) {
+        box.dimensions.content.width = size->width;
     }
 
     if (box.node->parent != nullptr) {
@@ -368,61 +501,77 @@ void Layouter::layout_anonymous_block(LayoutBox &box, geom::Rect const &bounds)
     auto weight =
             to_type(!box.children.empty() ? box.children[0].get_property<css::PropertyId::FontWeight>() : std::nullopt);
 
-    for (std::size_t i = 0; i < box.children.size(); ++i) {
-        auto *child = &box.children[i];
-        layout(*child, box.dimensions.content.translated(last_child_end, current_line * font_size.v));
+    auto grow_to_fit = [&box, &current_line, &last_child_end](LayoutBox const &child) {
+        box.dimensions.content.height =
+                std::max(box.dimensions.content.height, child.dimensions.margin_box().height * (current_line + 1));
+        box.dimensions.content.width =
+                std::max({box.dimensions.content.width, last_child_end, child.dimensions.content.width});
+    };
+
+    // Wrapped text adds children, so we build a new list of children rather
+    // than inserting into the middle of the current one.
+    std::vector<LayoutBox> children;
+    children.reserve(box.children.size());
+    for (auto &unlaid_child : box.children) {
+        auto &child = children.emplace_back(std::move(unlaid_child));
+        layout(child, box.dimensions.content.translated(last_child_end, current_line * font_size.v));
 
         // TODO(robinlinden): This needs to get along better with whitespace
         // collapsing. A <br> followed by a whitespace will be lead to a leading
         // space on the new line.
-        if (auto const *ele = std::get_if<dom::Element>(&child->node->node); ele != nullptr && ele->name == "br"sv) {
+        if (auto const *ele = std::get_if<dom::Element>(&child.node->node); ele != nullptr && ele->name == "br"sv) {
             current_line += 1;
             last_child_end = 0;
             continue;
         }
 
         // TODO(robinlinden): Handle cases where the text isn't a direct child of the anonymous block.
-        if (last_child_end + child->dimensions.margin_box().width > bounds.width) {
-            auto maybe_text = child->text();
-            if (maybe_text.has_value()) {
-                std::string_view text = *maybe_text;
-
-                std::size_t best_split_point = std::string_view::npos;
-                for (auto split_point = text.find(' '); split_point != std::string_view::npos;
-                        split_point = text.find(' ', split_point + 1)) {
-                    if (last_child_end + font->measure(text.substr(0, split_point), font_size, weight).width
-                            > bounds.width) {
-                        break;
-                    }
-
-                    best_split_point = split_point;
-                }
+        auto maybe_text = child.text();
+        if (last_child_end + child.dimensions.margin_box().width <= bounds.width || !maybe_text.has_value()) {
+            last_child_end += child.dimensions.margin_box().width;
+            grow_to_fit(child);
+            continue;
+        }
 
-                if (best_split_point != std::string_view::npos) {
-                    child->dimensions.content.width =
-                            font->measure(text.substr(0, best_split_point), font_size, weight).width;
-                    auto bonus_child = *child;
-                    bonus_child.layout_text = std::string{text.substr(best_split_point + 1)};
-                    box.children.insert(box.children.begin() + i + 1, std::move(bonus_child));
-                    current_line += 1;
-                    last_child_end = 0;
-
-                    // Adding a child may have had to relocate the container content.
-                    child = &box.children[i];
-                    child->layout_text = std::string{text.substr(0, best_split_point)};
-                } else {
-                    child->dimensions.content.width = font->measure(text, font_size, weight).width;
-                    last_child_end += child->dimensions.margin_box().width;
-                }
+        auto lines = break_lines(*maybe_text, *font, font_size, weight, bounds.width - last_child_end, bounds.width);
+        child.dimensions.content.width = lines[0].width;
+        if (lines.size() == 1) {
+            last_child_end += child.dimensions.margin_box().width;
+            grow_to_fit(child);
+            continue;
+        }
+
+        // Text that's a view into the DOM can stay that way, but text we own
+        // has to be copied into every line.
+        auto text = std::move(child.layout_text);
+        auto line_text = [&text](LineFragment const &line) -> decltype(LayoutBox::layout_text) {
+            if (auto const *view = std::get_if<std::string_view>(&text)) {
+                return line.text_in(*view);
             }
-        } else {
-            last_child_end += child->dimensions.margin_box().width;
+            return std::string{line.text_in(std::get<std::string>(text))};
+        };
+
+        child.layout_text = line_text(lines[0]);
+        auto const first_line_offset = last_child_end;
+        last_child_end = 0;
+        grow_to_fit(child);
+
+        // The following lines are laid out like the first one, but starting
+        // at the beginning of the line.
+        LayoutBox const first_line = child;
+        for (std::size_t line = 1; line < lines.size(); ++line) {
+            current_line += 1;
+            auto line_child = first_line;
+            line_child.layout_text = line_text(lines[line]);
+            line_child.dimensions.content.x -= first_line_offset;
+            line_child.dimensions.content.y += static_cast<int>(line) * font_size.v;
+            line_child.dimensions.content.width = lines[line].width;
+            last_child_end = line == lines.size() - 1 ? line_child.dimensions.margin_box().width : 0;
+            grow_to_fit(children.emplace_back(std::move(line_child)));
         }
-        box.dimensions.content.height =
-                std::max(box.dimensions.content.height, child->dimensions.margin_box().height * (current_line + 1));
-        box.dimensions.content.width =
-                std::max({box.dimensions.content.width, last_child_end, child->dimensions.content.width});
     }
+
+    box.children = std::move(children);
 }
 
 void Layouter::calculate_left_and_right_margin(LayoutBox &box,
@@ -469,6 +618,12 @@ void Layouter::calculate_width_and_margin(LayoutBox &box, geom::Rect const &pare
         resolved_width = width.try_resolve(font_size, resolution_context_, parent.width);
     }
 
+    // Replaced elements w/o a width use their content's width instead of
+    // filling their containing block.
+    if (auto size = intrinsic_size(box); !resolved_width && size) {
+        resolved_width = size->width;
+    }
+
     if (resolved_width) {
         box.dimensions.content.width = *resolved_width;
         calculate_left_and_right_margin(box, parent, margin_left, margin_right, font_size);
@@ -511,6 +666,8 @@ void Layouter::calculate_height(LayoutBox &box, int const font_size) const {
     if (auto text = box.text()) {
         int lines = static_cast<int>(std::ranges::count(*text, '\n')) + 1;
         content.height = lines * font_size;
+    } else if (auto size = intrinsic_size(box)) {
+        content.height = size->height;
     }
 
     if (auto height = box.get_property<css::PropertyId::Height>(); !height.is_auto()) {
@@ -556,6 +713,19 @@ void Layouter::calculate_border(LayoutBox &box, int const font_size) const {
     }
 }
 
+std::optional<IntrinsicSize> Layouter::intrinsic_size(LayoutBox const &box) const {
+    if (!intrinsic_size_ || box.is_anonymous_block()) {
+        return std::nullopt;
+    }
+
+    auto const *element = std::get_if<dom::Element>(&box.node->node);
+    if (element == nullptr || element->name != "img"sv) {
+        return std::nullopt;
+    }
+
+    return intrinsic_size_(*element);
+}
+
 std::optional<std::shared_ptr<type::IFont const>> Layouter::find_font(
         std::span<std::string_view const> font_families) const {
     for (auto const &family : font_families) {
@@ -568,8 +738,9 @@ std::optional<std::shared_ptr<type::IFont const>> Layouter::find_font(
 
 } // namespace
 
-std::optional<LayoutBox> create_layout(style::StyledNode const &node, int width, type::IType const &type) {
-    auto tree = create_tree(node);
+std::optional<LayoutBox> create_layout(
+        style::StyledNode const &node, int width, type::IType const &type, LayoutOptions opts) {
+    auto tree = create_tree(node, opts);
     if (!tree) {
         return {};
     }
@@ -584,7 +755,13 @@ std::optional<LayoutBox> create_layout(style::StyledNode const &node, int width,
             .viewport_width = width,
     };
 
-    Layouter{resolution_context, type}.layout(*tree, {0, 0, width, 0});
+    Layouter layouter{resolution_context, type, opts.intrinsic_size};
+    auto const threads = opts.threads != 0 ? opts.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    if (threads > 1) {
+        layouter.layout_anonymous_blocks_ahead(*tree, width, threads);
+    }
+
+    layouter.layout(*tree, {0, 0, width, 0});
     return tree;
 }
 
@@ -1,4 +1,4 @@
-// SPDX-FileCopyrightText: 2021-2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2021-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
@@ -7,15 +7,37 @@
 
 #include "layout/layout_box.h"
 
+#include "dom/dom.h"
 #include "style/styled_node.h"
 #include "type/naive.h"
 #include "type/type.h"
 
+#include <functional>
 #include <optional>
 
 namespace layout {
 
-std::optional<LayoutBox> create_layout(style::StyledNode const &, int width, type::IType const & = type::NaiveType{});
+// The natural size of replaced content, like the image shown by an <img>.
+struct IntrinsicSize {
+    int width{};
+    int height{};
+    [[nodiscard]] bool operator==(IntrinsicSize const &) const = default;
+};
+
+struct LayoutOptions {
+    // Anonymous blocks are measured and broken into lines on this many
+    // threads. Using more than 1 requires the IType and its fonts to be safe to
+    // use from several threads at once. 0 means one thread per hardware thread.
+    unsigned threads{1};
+
+    // The size of the content of an <img>, if it has loaded. Images w/o a size
+    // are laid out as their alt text. This has to be safe to call from several
+    // threads at once if more than 1 thread is used.
+    std::function<std::optional<IntrinsicSize>(dom::Element const &)> intrinsic_size{};
+};
+
+std::optional<LayoutBox> create_layout(
+        style::StyledNode const &, int width, type::IType const & = type::NaiveType{}, LayoutOptions = {});
 
 } // namespace layout
 
@@ -0,0 +1,102 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "layout/layout.h"
+
+#include "css/property_id.h"
+#include "dom/dom.h"
+#include "style/styled_node.h"
+#include "type/naive.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::string make_text(std::size_t words) {
+    std::string text;
+    text.reserve(words * 6);
+    for (std::size_t i = 0; i < words; ++i) {
+        text += i % 3 == 0 ? "lorem " : i % 3 == 1 ? "ipsum " : "dolor ";
+    }
+    return text;
+}
+
+// Lays out a single, very long paragraph to measure how line breaking scales
+// with the length of the text.
+void long_paragraph(std::size_t words) {
+    dom::Node dom = dom::Element{.name{"p"}, .children{dom::Text{make_text(words)}}};
+    style::StyledNode style{
+            .node{dom},
+            .properties{{css::PropertyId::Display, "block"}, {css::PropertyId::FontSize, "10px"}},
+            .children{style::StyledNode{.node{std::get<dom::Element>(dom).children[0]}}},
+    };
+    style.children[0].parent = &style;
+
+    for (int width : {200, 800, 3200}) {
+        auto start = std::chrono::steady_clock::now();
+        auto layout = layout::create_layout(style, width, type::NaiveType{});
+        auto duration = std::chrono::steady_clock::now() - start;
+        auto lines = layout.has_value() && !layout->children.empty() ? layout->children[0].children.size() : 0;
+        std::cout << words << " words, width " << width << ": " << lines << " lines in "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(duration).count() << "us\n";
+    }
+}
+
+// Lays out a long article made up of many paragraphs to measure how layout
+// scales w/ the number of threads used.
+void long_article(std::size_t paragraphs, std::size_t words) {
+    dom::Element article{.name{"article"}};
+    for (std::size_t i = 0; i < paragraphs; ++i) {
+        // Vary the paragraph lengths a bit to make it less trivial to split
+        // the work evenly.
+        article.children.emplace_back(dom::Element{.name{"p"}, .children{dom::Text{make_text(words + i % 7 * 10)}}});
+    }
+    dom::Node dom = std::move(article);
+
+    style::StyledNode style{
+            .node{dom},
+            .properties{{css::PropertyId::Display, "block"}, {css::PropertyId::FontSize, "10px"}},
+    };
+    for (auto const &p : std::get<dom::Element>(dom).children) {
+        style.children.push_back(style::StyledNode{
+                .node{p},
+                .properties{{css::PropertyId::Display, "block"}},
+                .children{style::StyledNode{.node{std::get<dom::Element>(p).children[0]}}},
+        });
+    }
+    for (auto &p : style.children) {
+        p.parent = &style;
+        p.children[0].parent = &p;
+    }
+
+    long serial_us{};
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        auto start = std::chrono::steady_clock::now();
+        auto layout = layout::create_layout(style, 800, type::NaiveType{}, {.threads = threads});
+        auto duration = std::chrono::steady_clock::now() - start;
+        auto us = static_cast<long>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+        if (threads == 1) {
+            serial_us = us;
+        }
+
+        std::cout << paragraphs << " paragraphs of ~" << words << " words, " << threads << " threads: " << us
+                  << "us (" << static_cast<double>(serial_us) / static_cast<double>(us) << "x)\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::size_t const words = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100'000;
+    std::size_t const paragraphs = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2'000;
+
+    long_paragraph(words);
+    long_article(paragraphs, 200);
+}
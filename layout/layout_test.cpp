@@ -12,6 +12,7 @@
 #include "etest/etest.h"
 #include "geom/geom.h"
 #include "style/styled_node.h"
+#include "type/naive.h"
 #include "type/type.h"
 #include "util/string.h"
 
@@ -655,6 +656,70 @@ void img_tests() {
         expect_eq(expected_layout, layout_root);
         expect_eq(expected_layout.children.at(0).text(), "hello");
     });
+
+    etest::test("img, loaded", [] {
+        dom::Node dom = dom::Element{"body", {}, {dom::Element{"img", {{"alt", "hello"}}}, dom::Text{"hi"}}};
+        auto const &body = std::get<dom::Element>(dom);
+        auto style = style::StyledNode{
+                .node = dom,
+                .properties{
+                        {css::PropertyId::Display, "block"},
+                        {css::PropertyId::FontSize, "10px"},
+                },
+                .children{
+                        {body.children.at(0), {{css::PropertyId::Display, "inline"}}},
+                        {body.children.at(1), {{css::PropertyId::Display, "inline"}}},
+                },
+        };
+        set_up_parent_ptrs(style);
+
+        auto const intrinsic_size = [&](dom::Element const &element) -> std::optional<layout::IntrinsicSize> {
+            expect_eq(&element, &std::get<dom::Element>(body.children.at(0)));
+            return layout::IntrinsicSize{20, 30};
+        };
+
+        // The image replaces the alt text, and the text after it ends up next to it.
+        auto layout_root = layout::create_layout(style, 100, type::NaiveType{}, {.intrinsic_size = intrinsic_size});
+        require(layout_root.has_value());
+        auto const &anonymous_block = layout_root->children.at(0);
+        require_eq(anonymous_block.children.size(), std::size_t{2});
+        auto const &img = anonymous_block.children[0];
+        expect_eq(img.text(), std::nullopt);
+        expect(img.children.empty());
+        expect_eq(img.dimensions.content, geom::Rect{0, 0, 20, 30});
+        expect_eq(anonymous_block.children[1].dimensions.content.x, 20);
+        expect_eq(layout_root->dimensions.content.height, 30);
+    });
+
+    etest::test("img, loaded, block", [] {
+        dom::Node dom = dom::Element{"body", {}, {dom::Element{"img"}}};
+        auto const &body = std::get<dom::Element>(dom);
+        auto style = style::StyledNode{
+                .node = dom,
+                .properties{
+                        {css::PropertyId::Display, "block"},
+                        {css::PropertyId::FontSize, "10px"},
+                },
+                .children{
+                        {body.children.at(0),
+                                {
+                                        {css::PropertyId::Display, "block"},
+                                        {css::PropertyId::MarginLeft, "auto"},
+                                        {css::PropertyId::MarginRight, "auto"},
+                                }},
+                },
+        };
+        set_up_parent_ptrs(style);
+
+        // Replaced elements keep their own width rather than filling their
+        // containing block.
+        auto layout_root = layout::create_layout(style, 100, type::NaiveType{}, {.intrinsic_size = [](auto const &) {
+            return std::optional{layout::IntrinsicSize{20, 30}};
+        }});
+        require(layout_root.has_value());
+        expect_eq(layout_root->children.at(0).dimensions.content, geom::Rect{40, 0, 20, 30});
+        expect_eq(layout_root->dimensions.content.height, 30);
+    });
 }
 
 } // namespace
@@ -1719,8 +1784,6 @@ int main() {
         };
         set_up_parent_ptrs(style);
 
-        // TODO(robinlinden): It should be possible for the text here to be
-        // views into the dom text.
         layout::LayoutBox expected{
                 .node = &style,
                 // 2 lines, where the widest one is 5 characters.
@@ -1732,12 +1795,12 @@ int main() {
                                 layout::LayoutBox{
                                         .node = &style.children[0],
                                         .dimensions{{0, 0, 10, 10}},
-                                        .layout_text = "hi"s,
+                                        .layout_text = "hi"sv,
                                 },
                                 layout::LayoutBox{
                                         .node = &style.children[0],
                                         .dimensions{{0, 10, 25, 10}},
-                                        .layout_text = "hello"s,
+                                        .layout_text = "hello"sv,
                                 },
                         },
                 }},
@@ -1766,12 +1829,12 @@ int main() {
                                 layout::LayoutBox{
                                         .node = &style.children[0],
                                         .dimensions{{0, 0, 25, 10}},
-                                        .layout_text = "oh no"s,
+                                        .layout_text = "oh no"sv,
                                 },
                                 layout::LayoutBox{
                                         .node = &style.children[0],
                                         .dimensions{{0, 10, 20, 10}},
-                                        .layout_text = "!! !"s,
+                                        .layout_text = "!! !"sv,
                                 },
                         },
                 }},
@@ -1940,6 +2003,81 @@ int main() {
         expect_eq(layout.children.at(0).dimensions.border_box().width, 100);
     });
 
+    etest::test("parallel layout matches serial layout", [] {
+        auto text = [](std::string_view words) { return dom::Text{std::string{words}}; };
+        dom::Node dom = dom::Element{"html",
+                {},
+                {
+                        dom::Element{"p", {}, {text("hello world this is a paragraph that will need a few lines")}},
+                        dom::Element{"div",
+                                {},
+                                {
+                                        dom::Element{"p", {}, {text("nested paragraph w/ some more text in it")}},
+                                        text("text directly in a div next to a block"),
+                                }},
+                        dom::Element{"p",
+                                {},
+                                {
+                                        text("a paragraph w/"),
+                                        dom::Element{"span", {}, {text("a span and")}},
+                                        dom::Element{"br"},
+                                        text("a line break"),
+                                }},
+                        dom::Element{"p", {}, {text("short")}},
+                }};
+
+        auto const &html = std::get<dom::Element>(dom);
+        auto const &div = std::get<dom::Element>(html.children[1]);
+        auto const &p3 = std::get<dom::Element>(html.children[2]);
+        auto block = [](dom::Node const &node, std::vector<style::StyledNode> children) {
+            return style::StyledNode{
+                    .node{node},
+                    .properties{{css::PropertyId::Display, "block"}, {css::PropertyId::PaddingLeft, "3px"}},
+                    .children{std::move(children)},
+            };
+        };
+        auto first_child = [](dom::Node const &node) -> dom::Node const & {
+            return std::get<dom::Element>(node).children[0];
+        };
+        auto inline_node = [](dom::Node const &node, std::vector<style::StyledNode> children = {}) {
+            return style::StyledNode{
+                    .node{node},
+                    .properties{{css::PropertyId::Display, "inline"}},
+                    .children{std::move(children)},
+            };
+        };
+
+        style::StyledNode style{
+                .node{dom},
+                .properties{{css::PropertyId::Display, "block"}, {css::PropertyId::FontSize, "10px"}},
+                .children{
+                        block(html.children[0], {{.node{first_child(html.children[0])}}}),
+                        block(html.children[1],
+                                {
+                                        block(div.children[0], {{.node{first_child(div.children[0])}}}),
+                                        {.node{div.children[1]}},
+                                }),
+                        block(html.children[2],
+                                {
+                                        {.node{p3.children[0]}},
+                                        inline_node(p3.children[1], {{.node{first_child(p3.children[1])}}}),
+                                        inline_node(p3.children[2]),
+                                        {.node{p3.children[3]}},
+                                }),
+                        block(html.children[3], {{.node{first_child(html.children[3])}}}),
+                },
+        };
+        set_up_parent_ptrs(style);
+
+        for (int width : {30, 100, 250, 1000}) {
+            auto serial = layout::create_layout(style, width, type::NaiveType{}, {.threads = 1});
+            auto parallel = layout::create_layout(style, width, type::NaiveType{}, {.threads = 4});
+            require(serial.has_value());
+            expect_eq(serial, parallel);
+            expect(serial->children.at(1).children.at(1).is_anonymous_block());
+        }
+    });
+
     whitespace_collapsing_tests();
     text_transform_tests();
     img_tests();
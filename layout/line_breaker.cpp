@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "layout/line_breaker.h"
+
+#include "type/type.h"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace layout {
+
+std::vector<LineFragment> break_lines(std::string_view text,
+        type::IFont const &font,
+        type::Px const font_size,
+        type::Weight const weight,
+        int const first_line_width,
+        int const line_width) {
+    int const space_width = font.measure(" ", font_size, weight).width;
+
+    std::vector<LineFragment> lines;
+    LineFragment current{};
+    bool line_is_empty = true;
+    int available = first_line_width;
+
+    for (std::size_t word_start = 0;;) {
+        auto word_end = text.find(' ', word_start);
+        if (word_end == std::string_view::npos) {
+            word_end = text.size();
+        }
+
+        int const word_width = font.measure(text.substr(word_start, word_end - word_start), font_size, weight).width;
+        int const width_with_word = line_is_empty ? word_width : current.width + space_width + word_width;
+        if (!line_is_empty && width_with_word > available) {
+            // The space we're breaking on belongs to neither line.
+            current.length = word_start - 1 - current.offset;
+            lines.push_back(current);
+            current = LineFragment{.offset = word_start, .width = word_width};
+            available = line_width;
+        } else {
+            current.width = width_with_word;
+        }
+        line_is_empty = false;
+
+        if (word_end == text.size()) {
+            break;
+        }
+
+        word_start = word_end + 1;
+    }
+
+    current.length = text.size() - current.offset;
+    lines.push_back(current);
+    return lines;
+}
+
+} // namespace layout
@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef LAYOUT_LINE_BREAKER_H_
+#define LAYOUT_LINE_BREAKER_H_
+
+#include "type/type.h"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace layout {
+
+// A line of text, as an offset into the text it was broken from so that
+// callers can decide if they want views into the original text or copies.
+struct LineFragment {
+    std::size_t offset{};
+    std::size_t length{};
+    int width{};
+    [[nodiscard]] bool operator==(LineFragment const &) const = default;
+
+    [[nodiscard]] constexpr std::string_view text_in(std::string_view text) const {
+        return text.substr(offset, length);
+    }
+};
+
+// Greedily breaks the text on spaces so that each line fits in the available
+// width. Every word is measured once, and the line widths are accumulated from
+// those advances, so this is linear in the length of the text. A line always
+// contains at least one word, even if that word doesn't fit.
+std::vector<LineFragment> break_lines(std::string_view text,
+        type::IFont const &,
+        type::Px font_size,
+        type::Weight,
+        int first_line_width,
+        int line_width);
+
+} // namespace layout
+
+#endif
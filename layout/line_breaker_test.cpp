@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "layout/line_breaker.h"
+
+#include "etest/etest2.h"
+#include "type/naive.h"
+#include "type/type.h"
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+constexpr auto kFontSize = type::Px{10};
+constexpr auto kWeight = type::Weight::Normal;
+
+} // namespace
+
+int main() {
+    etest::Suite s{"layout/line_breaker"};
+
+    s.add_test("everything fits", [](etest::IActions &a) {
+        auto lines = layout::break_lines("hello world"sv, type::NaiveFont{}, kFontSize, kWeight, 100, 100);
+        a.expect_eq(lines, std::vector{layout::LineFragment{0, 11, 55}});
+    });
+
+    s.add_test("greedy breaking", [](etest::IActions &a) {
+        auto text = "oh no !! !"sv;
+        auto lines = layout::break_lines(text, type::NaiveFont{}, kFontSize, kWeight, 30, 30);
+        a.expect_eq(lines,
+                std::vector{
+                        layout::LineFragment{0, 5, 25},
+                        layout::LineFragment{6, 4, 20},
+                });
+        a.expect_eq(lines[0].text_in(text), "oh no"sv);
+        a.expect_eq(lines[1].text_in(text), "!! !"sv);
+    });
+
+    s.add_test("shorter first line", [](etest::IActions &a) {
+        auto text = "aa bb cc dd"sv;
+        auto lines = layout::break_lines(text, type::NaiveFont{}, kFontSize, kWeight, 10, 40);
+        a.expect_eq(lines,
+                std::vector{
+                        layout::LineFragment{0, 2, 10},
+                        layout::LineFragment{3, 8, 40},
+                });
+    });
+
+    s.add_test("words that don't fit get their own line", [](etest::IActions &a) {
+        auto text = "a verylongword b"sv;
+        auto lines = layout::break_lines(text, type::NaiveFont{}, kFontSize, kWeight, 20, 20);
+        a.expect_eq(lines,
+                std::vector{
+                        layout::LineFragment{0, 1, 5},
+                        layout::LineFragment{2, 12, 60},
+                        layout::LineFragment{15, 1, 5},
+                });
+    });
+
+    s.add_test("no split point", [](etest::IActions &a) {
+        auto lines = layout::break_lines("hello"sv, type::NaiveFont{}, kFontSize, kWeight, 10, 10);
+        a.expect_eq(lines, std::vector{layout::LineFragment{0, 5, 25}});
+    });
+
+    s.add_test("every word is measured once", [](etest::IActions &a) {
+        struct CountingFont : public type::IFont {
+            type::Size measure(std::string_view text, type::Px font_size, type::Weight) const override {
+                measured_chars += static_cast<int>(text.size());
+                return {static_cast<int>(text.size()) * font_size.v / 2, font_size.v};
+            }
+            mutable int measured_chars{};
+        };
+
+        CountingFont font;
+        auto text = "the quick brown fox jumps over the lazy dog"sv;
+        auto lines = layout::break_lines(text, font, kFontSize, kWeight, 50, 50);
+        a.expect(lines.size() > 1);
+        // The words, plus the single space measured to get its advance.
+        auto spaces = static_cast<int>(std::ranges::count(text, ' '));
+        a.expect_eq(font.measured_chars, static_cast<int>(text.size()) - spaces + 1);
+    });
+
+    return s.run();
+}
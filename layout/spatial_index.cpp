@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "layout/spatial_index.h"
+
+#include "layout/layout_box.h"
+
+#include "geom/geom.h"
+#include "geom/rtree.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace layout {
+namespace {
+
+// NOLINTNEXTLINE(misc-no-recursion)
+void flatten(LayoutBox const &box,
+        std::uint32_t parent,
+        std::vector<LayoutBox const *> &boxes,
+        std::vector<std::uint32_t> &parents) {
+    auto const idx = static_cast<std::uint32_t>(boxes.size());
+    boxes.push_back(&box);
+    parents.push_back(parent);
+    for (auto const &child : box.children) {
+        flatten(child, idx, boxes, parents);
+    }
+}
+
+// Mirrors box_at_position, but only looking at the boxes containing the
+// position. As they're in tree order, a box's children come after it.
+// NOLINTNEXTLINE(misc-no-recursion)
+LayoutBox const *resolve(std::span<std::size_t const> containing,
+        std::size_t candidate,
+        std::span<LayoutBox const *const> boxes,
+        std::span<std::uint32_t const> parents) {
+    auto const box_idx = containing[candidate];
+    for (auto child = candidate + 1; child < containing.size(); ++child) {
+        if (parents[containing[child]] != box_idx) {
+            continue;
+        }
+
+        if (auto const *maybe = resolve(containing, child, boxes, parents)) {
+            return maybe;
+        }
+    }
+
+    if (boxes[box_idx]->is_anonymous_block()) {
+        return nullptr;
+    }
+
+    return boxes[box_idx];
+}
+
+} // namespace
+
+SpatialIndex::SpatialIndex(LayoutBox const &root) {
+    flatten(root, 0, boxes_, parents_);
+
+    std::vector<geom::Rect> border_boxes;
+    border_boxes.reserve(boxes_.size());
+    for (auto const *box : boxes_) {
+        border_boxes.push_back(box->dimensions.border_box());
+    }
+    tree_ = geom::RTree{border_boxes};
+}
+
+std::vector<LayoutBox const *> SpatialIndex::boxes_in(geom::Rect const &rect) const {
+    std::vector<LayoutBox const *> result;
+    for (auto idx : tree_.query(rect)) {
+        result.push_back(boxes_[idx]);
+    }
+    return result;
+}
+
+LayoutBox const *SpatialIndex::box_at(geom::Position p) const {
+    auto containing = tree_.query(p);
+    // Nothing outside of the root box is reachable.
+    if (containing.empty() || containing[0] != 0) {
+        return nullptr;
+    }
+
+    return resolve(containing, 0, boxes_, parents_);
+}
+
+} // namespace layout
@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef LAYOUT_SPATIAL_INDEX_H_
+#define LAYOUT_SPATIAL_INDEX_H_
+
+#include "layout/layout_box.h"
+
+#include "geom/geom.h"
+#include "geom/rtree.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace layout {
+
+// An index over the border boxes of a layout tree, letting lookups skip the
+// parts of the tree that are nowhere near what's being looked for. The index
+// holds pointers into the layout, so it has to be rebuilt if the layout changes.
+class SpatialIndex {
+public:
+    SpatialIndex() = default;
+    explicit SpatialIndex(LayoutBox const &);
+
+    // The boxes intersecting the rect, in tree order.
+    [[nodiscard]] std::vector<LayoutBox const *> boxes_in(geom::Rect const &) const;
+
+    // Finds the same box as box_at_position would.
+    [[nodiscard]] LayoutBox const *box_at(geom::Position) const;
+
+private:
+    // All boxes and the indices of their parents, in tree order.
+    std::vector<LayoutBox const *> boxes_;
+    std::vector<std::uint32_t> parents_;
+    geom::RTree tree_;
+};
+
+} // namespace layout
+
+#endif
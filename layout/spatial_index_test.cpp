@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "layout/spatial_index.h"
+
+#include "layout/layout.h"
+#include "layout/layout_box.h"
+
+#include "css/property_id.h"
+#include "dom/dom.h"
+#include "etest/etest2.h"
+#include "geom/geom.h"
+#include "style/styled_node.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+int main() {
+    etest::Suite s{"layout/spatial_index"};
+
+    s.add_test("box_at matches box_at_position", [](etest::IActions &a) {
+        dom::Node dom = dom::Element{"dummy"};
+        style::StyledNode style{dom, {{css::PropertyId::Display, "block"}}};
+        std::vector<layout::LayoutBox> children{
+                {nullptr, {{30, 30, 5, 5}}, {}},
+                {&style, {{45, 45, 5, 5}}, {}},
+        };
+
+        auto layout = layout::LayoutBox{
+                .node = &style,
+                .dimensions = {{0, 0, 100, 100}},
+                .children{
+                        {&style, {{25, 25, 50, 50}}, {std::move(children)}},
+                        // Outside of its parent, so unreachable.
+                        {&style, {{200, 200, 5, 5}}, {}},
+                },
+        };
+
+        layout::SpatialIndex index{layout};
+        for (int y = -5; y < 210; y += 3) {
+            for (int x = -5; x < 210; x += 3) {
+                a.expect(index.box_at({x, y}) == box_at_position(layout, {x, y}));
+            }
+        }
+
+        a.expect(index.box_at({-1, -1}) == nullptr);
+        a.expect(index.box_at({100, 100}) == &layout);
+        a.expect(index.box_at({31, 31}) == &layout.children[0]);
+        a.expect(index.box_at({47, 47}) == &layout.children[0].children[1]);
+        a.expect(index.box_at({202, 202}) == nullptr);
+    });
+
+    s.add_test("boxes_in", [](etest::IActions &a) {
+        dom::Node dom = dom::Element{"dummy"};
+        style::StyledNode style{dom, {{css::PropertyId::Display, "block"}}};
+        auto layout = layout::LayoutBox{
+                .node = &style,
+                .dimensions = {{0, 0, 100, 300}},
+                .children{
+                        {&style, {{0, 0, 100, 100}}, {}},
+                        {&style, {{0, 100, 100, 100}}, {}},
+                        {&style, {{0, 200, 100, 100}}, {}},
+                },
+        };
+
+        layout::SpatialIndex index{layout};
+        a.expect_eq(index.boxes_in({0, 150, 10, 10}), std::vector<layout::LayoutBox const *>{&layout, &layout.children[1]});
+        a.expect_eq(index.boxes_in({0, 50, 10, 100}),
+                std::vector<layout::LayoutBox const *>{&layout, &layout.children[0], &layout.children[1]});
+        a.expect(index.boxes_in({200, 0, 10, 10}).empty());
+    });
+
+    s.add_test("long document", [](etest::IActions &a) {
+        dom::Node dom = dom::Element{"dummy"};
+        style::StyledNode style{dom, {{css::PropertyId::Display, "block"}}};
+        auto layout = layout::LayoutBox{.node = &style, .dimensions = {{0, 0, 100, 100'000}}};
+        for (int i = 0; i < 10'000; ++i) {
+            layout.children.push_back({&style, {{0, i * 10, 100, 10}}, {}});
+        }
+
+        layout::SpatialIndex index{layout};
+        a.expect(index.box_at({50, 55'555}) == box_at_position(layout, {50, 55'555}));
+        a.expect_eq(index.boxes_in({0, 50'001, 100, 18}).size(), std::size_t{3});
+    });
+
+    return s.run();
+}
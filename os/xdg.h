@@ -1,16 +1,21 @@
-// SPDX-FileCopyrightText: 2021-2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2021-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
 #ifndef OS_XDG_H_
 #define OS_XDG_H_
 
+#include <optional>
 #include <string>
 #include <vector>
 
 // TODO(robinlinden): We should probably create a more fully-featured top-level xdg library.
 namespace os {
 std::vector<std::string> font_paths();
+
+// Where to put files that are only kept around to speed things up, if there's
+// anywhere.
+std::optional<std::string> cache_path();
 } // namespace os
 
 #endif
@@ -1,10 +1,11 @@
-// SPDX-FileCopyrightText: 2021-2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2021-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include "os/xdg.h"
 
 #include <cstdlib>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -36,6 +37,19 @@ std::vector<std::string> font_paths() {
     return paths;
 }
 
+std::optional<std::string> cache_path() {
+    if (char const *xdg_cache_home = std::getenv("XDG_CACHE_HOME")) {
+        return xdg_cache_home;
+    }
+
+    // $HOME/.cache is the default XDG_CACHE_HOME.
+    if (char const *home = std::getenv("HOME")) {
+        return home + "/.cache"s;
+    }
+
+    return std::nullopt;
+}
+
 // NOLINTEND(concurrency-mt-unsafe)
 
 } // namespace os
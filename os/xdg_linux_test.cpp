@@ -1,4 +1,4 @@
-// SPDX-FileCopyrightText: 2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2023-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 
 #include <algorithm>
+#include <optional>
 
 // NOLINTBEGIN(concurrency-mt-unsafe): No threads here.
 
@@ -27,6 +28,7 @@ int main() {
     // Ensure that the system's environment doesn't affect the test result.
     unsetenv("HOME");
     unsetenv("XDG_DATA_HOME");
+    unsetenv("XDG_CACHE_HOME");
 
     etest::Suite s{"os::xdg/linux"};
 
@@ -60,6 +62,19 @@ int main() {
         unsetenv("XDG_DATA_HOME");
     });
 
+    s.add_test("cache_path", [](etest::IActions &a) {
+        a.expect_eq(os::cache_path(), std::nullopt);
+
+        setenv("HOME", "/home", kOnlyIfUnset);
+        a.expect_eq(os::cache_path(), "/home/.cache");
+
+        setenv("XDG_CACHE_HOME", "/xdg_cache_home", kOnlyIfUnset);
+        a.expect_eq(os::cache_path(), "/xdg_cache_home");
+
+        unsetenv("XDG_CACHE_HOME");
+        unsetenv("HOME");
+    });
+
     return s.run();
 }
 
@@ -5,6 +5,7 @@
 #include "os/xdg.h"
 
 #include <cstdlib>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -27,6 +28,14 @@ std::vector<std::string> font_paths() {
     return paths;
 }
 
+std::optional<std::string> cache_path() {
+    if (char const *home = std::getenv("HOME"); home != nullptr) {
+        return home + "/Library/Caches"s;
+    }
+
+    return std::nullopt;
+}
+
 // NOLINTEND(concurrency-mt-unsafe)
 
 } // namespace os
@@ -14,6 +14,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <utility>
 
 namespace protocol {
@@ -23,16 +24,24 @@ class InMemoryCache : public IProtocolHandler {
 public:
     explicit InMemoryCache(std::unique_ptr<IProtocolHandler> handler) : handler_{std::move(handler)} {}
 
+    // Safe to call from several threads at once if the wrapped handler is.
     [[nodiscard]] tl::expected<Response, Error> handle(uri::Uri const &uri) override {
-        if (auto it = cache_.find(uri); it != cend(cache_)) {
-            return it->second;
+        {
+            std::scoped_lock lock{mutex_};
+            if (auto it = cache_.find(uri); it != cend(cache_)) {
+                return it->second;
+            }
         }
 
-        return cache_[uri] = handler_->handle(uri);
+        // Not holding the lock while loading, so that loads run in parallel.
+        auto response = handler_->handle(uri);
+        std::scoped_lock lock{mutex_};
+        return cache_.insert_or_assign(uri, std::move(response)).first->second;
     }
 
 private:
     std::unique_ptr<IProtocolHandler> handler_;
+    std::mutex mutex_;
     std::map<uri::Uri, tl::expected<Response, Error>> cache_;
 };
 
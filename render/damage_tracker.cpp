@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "render/damage_tracker.h"
+
+#include "geom/geom.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+namespace render {
+namespace {
+
+// Damage is coalesced into a single rect past this point, as repainting a bit
+// too much is cheaper than tracking lots of tiny rects.
+constexpr std::size_t kMaxDamagedAreas = 16;
+
+} // namespace
+
+void DamageTracker::resize(geom::Rect surface) {
+    surface_ = surface;
+    invalidate_all();
+}
+
+void DamageTracker::invalidate(geom::Rect const &area) {
+    auto rect = area.intersected(surface_);
+    if (rect.empty()) {
+        return;
+    }
+
+    // Merge with anything this overlaps, compacting the remaining rects in the
+    // same pass. The merged rect may grow to overlap rects that were already
+    // passed, so we go again until it stops growing.
+    for (bool grew = true; grew;) {
+        grew = false;
+        std::size_t kept = 0;
+        for (auto const &damaged : damage_) {
+            if (damaged.intersected(rect).empty()) {
+                damage_[kept++] = damaged;
+                continue;
+            }
+
+            auto merged = rect.united(damaged);
+            grew = grew || merged != rect;
+            rect = merged;
+        }
+
+        damage_.resize(kept);
+    }
+
+    damage_.push_back(rect);
+}
+
+void DamageTracker::invalidate_all() {
+    scroll_dy_ = 0;
+    damage_.clear();
+    if (!surface_.empty()) {
+        damage_.push_back(surface_);
+    }
+}
+
+void DamageTracker::scroll(int dy) {
+    // Nothing to reuse if everything is repainted anyway.
+    if (dy == 0 || (damage_.size() == 1 && damage_[0] == surface_)) {
+        return;
+    }
+
+    if (std::abs(scroll_dy_ + dy) >= surface_.height) {
+        invalidate_all();
+        return;
+    }
+
+    // Existing damage moves along with the content.
+    auto old_damage = std::exchange(damage_, {});
+    for (auto const &rect : old_damage) {
+        invalidate(rect.translated(0, dy));
+    }
+
+    scroll_dy_ += dy;
+    if (dy > 0) {
+        invalidate({surface_.x, surface_.y, surface_.width, dy});
+    } else {
+        invalidate({surface_.x, surface_.bottom() + dy, surface_.width, -dy});
+    }
+}
+
+Repaint DamageTracker::take() {
+    Repaint repaint{.scroll_dy = std::exchange(scroll_dy_, 0), .areas = std::exchange(damage_, {})};
+    if (repaint.areas.size() > kMaxDamagedAreas) {
+        geom::Rect everything{};
+        for (auto const &rect : repaint.areas) {
+            everything = everything.united(rect);
+        }
+        repaint.areas = {everything};
+    }
+
+    return repaint;
+}
+
+} // namespace render
@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef RENDER_DAMAGE_TRACKER_H_
+#define RENDER_DAMAGE_TRACKER_H_
+
+#include "geom/geom.h"
+
+#include <vector>
+
+namespace render {
+
+struct Repaint {
+    // How far the surface's current content has to be moved vertically before
+    // repainting, e.g. after scrolling.
+    int scroll_dy{};
+    std::vector<geom::Rect> areas{};
+
+    [[nodiscard]] bool empty() const { return scroll_dy == 0 && areas.empty(); }
+    [[nodiscard]] bool operator==(Repaint const &) const = default;
+};
+
+// Keeps track of the parts of a retained surface that have to be repainted
+// before it's presented again. Everything is in surface coordinates.
+class DamageTracker {
+public:
+    DamageTracker() = default;
+    explicit DamageTracker(geom::Rect surface) : surface_{surface} {}
+
+    // Resizing the surface invalidates all of it.
+    void resize(geom::Rect surface);
+    void invalidate(geom::Rect const &);
+    void invalidate_all();
+
+    // The content of the surface moved by dy pixels. What's still visible
+    // will be reused and the newly exposed strip is invalidated.
+    void scroll(int dy);
+
+    [[nodiscard]] bool has_damage() const { return scroll_dy_ != 0 || !damage_.empty(); }
+
+    // Returns what has to be done to bring the surface up to date, and forgets
+    // about it.
+    [[nodiscard]] Repaint take();
+
+private:
+    geom::Rect surface_{};
+    int scroll_dy_{};
+    std::vector<geom::Rect> damage_;
+};
+
+} // namespace render
+
+#endif
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "render/damage_tracker.h"
+
+#include "etest/etest2.h"
+#include "geom/geom.h"
+
+#include <vector>
+
+namespace {
+constexpr auto kSurface = geom::Rect{0, 0, 100, 50};
+} // namespace
+
+int main() {
+    etest::Suite s{"render/damage_tracker"};
+
+    s.add_test("no damage", [](etest::IActions &a) {
+        render::DamageTracker damage{kSurface};
+        a.expect(!damage.has_damage());
+        a.expect(damage.take().empty());
+    });
+
+    s.add_test("resizing damages everything", [](etest::IActions &a) {
+        render::DamageTracker damage;
+        damage.resize(kSurface);
+        a.expect(damage.has_damage());
+        a.expect_eq(damage.take(), render::Repaint{.areas{kSurface}});
+        a.expect(!damage.has_damage());
+    });
+
+    s.add_test("damage is clipped and merged", [](etest::IActions &a) {
+        render::DamageTracker damage{kSurface};
+        damage.invalidate({-10, -10, 20, 20});
+        damage.invalidate({50, 10, 10, 10});
+        damage.invalidate({200, 10, 10, 10});
+        damage.invalidate({5, 5, 10, 10});
+        a.expect_eq(damage.take(),
+                render::Repaint{.areas{
+                        geom::Rect{50, 10, 10, 10},
+                        geom::Rect{0, 0, 15, 15},
+                }});
+    });
+
+    s.add_test("merging may pull in damage that didn't overlap before", [](etest::IActions &a) {
+        render::DamageTracker damage{kSurface};
+        damage.invalidate({4, 24, 1, 1});
+        damage.invalidate({20, 20, 5, 5});
+        damage.invalidate({50, 40, 5, 5});
+        // Overlaps the 2nd rect, and the union of the two overlaps the 1st.
+        damage.invalidate({3, 22, 20, 1});
+        a.expect_eq(damage.take(),
+                render::Repaint{.areas{
+                        geom::Rect{50, 40, 5, 5},
+                        geom::Rect{3, 20, 22, 5},
+                }});
+    });
+
+    s.add_test("lots of damage is coalesced", [](etest::IActions &a) {
+        render::DamageTracker damage{kSurface};
+        for (int i = 0; i < 20; ++i) {
+            damage.invalidate({i * 5, i * 2, 1, 1});
+        }
+        a.expect_eq(damage.take(), render::Repaint{.areas{geom::Rect{0, 0, 96, 39}}});
+    });
+
+    s.add_test("scrolling exposes a strip", [](etest::IActions &a) {
+        render::DamageTracker damage{kSurface};
+        damage.scroll(-5);
+        a.expect_eq(damage.take(), render::Repaint{.scroll_dy = -5, .areas{geom::Rect{0, 45, 100, 5}}});
+
+        damage.scroll(10);
+        a.expect_eq(damage.take(), render::Repaint{.scroll_dy = 10, .areas{geom::Rect{0, 0, 100, 10}}});
+    });
+
+    s.add_test("scrolling moves existing damage", [](etest::IActions &a) {
+        render::DamageTracker damage{kSurface};
+        damage.invalidate({10, 20, 5, 5});
+        damage.scroll(3);
+        damage.scroll(-10);
+        a.expect_eq(damage.take(),
+                render::Repaint{
+                        .scroll_dy = -7,
+                        .areas{geom::Rect{10, 13, 5, 5}, geom::Rect{0, 40, 100, 10}},
+                });
+    });
+
+    s.add_test("scrolling more than a screen damages everything", [](etest::IActions &a) {
+        render::DamageTracker damage{kSurface};
+        damage.scroll(30);
+        damage.scroll(20);
+        a.expect_eq(damage.take(), render::Repaint{.areas{kSurface}});
+    });
+
+    s.add_test("scrolling is pointless if everything is damaged", [](etest::IActions &a) {
+        render::DamageTracker damage{kSurface};
+        damage.invalidate_all();
+        damage.scroll(5);
+        a.expect_eq(damage.take(), render::Repaint{.areas{kSurface}});
+    });
+
+    return s.run();
+}
@@ -0,0 +1,340 @@
+// SPDX-FileCopyrightText: 2021-2024 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2022 Mikael Larsson <c.mikael.larsson@gmail.com>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "render/display_list.h"
+
+#include "render/damage_tracker.h"
+
+#include "css/property_id.h"
+#include "dom/xpath.h"
+#include "geom/geom.h"
+#include "geom/rtree.h"
+#include "gfx/color.h"
+#include "gfx/font.h"
+#include "gfx/icanvas.h"
+#include "layout/layout_box.h"
+#include "style/styled_node.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace render {
+namespace {
+
+bool has_any_border(geom::EdgeSize const &border) {
+    return border != geom::EdgeSize{};
+}
+
+constexpr bool is_fully_transparent(gfx::Color const &c) {
+    return c.a == 0;
+}
+
+gfx::FontStyle to_gfx(style::FontStyle style,
+        std::optional<style::FontWeight> weight,
+        std::vector<style::TextDecorationLine> const &decorations) {
+    gfx::FontStyle gfx;
+    if (style == style::FontStyle::Italic || style == style::FontStyle::Oblique) {
+        gfx.italic = true;
+    }
+
+    if (weight && weight->value >= style::FontWeight::kBold) {
+        gfx.bold = true;
+    }
+
+    for (auto const &decoration : decorations) {
+        switch (decoration) {
+            case style::TextDecorationLine::None:
+                break;
+            case style::TextDecorationLine::Underline:
+                gfx.underlined = true;
+                break;
+            case style::TextDecorationLine::LineThrough:
+                gfx.strikethrough = true;
+                break;
+            default:
+                spdlog::warn("Unhandled text decoration line '{}'", std::to_underlying(decoration));
+                break;
+        }
+    }
+
+    return gfx;
+}
+
+class DisplayListBuilder {
+public:
+    explicit DisplayListBuilder(ImageLookup const &images) : images_{images} {}
+
+    // NOLINTNEXTLINE(misc-no-recursion)
+    void add(layout::LayoutBox const &layout) {
+        if (should_render(layout)) {
+            if (auto text = layout.text()) {
+                add_text(layout, *text);
+            } else {
+                add_element(layout);
+                add_image(layout);
+            }
+        }
+
+        for (auto const &child : layout.children) {
+            add(child);
+        }
+    }
+
+    DisplayList take() { return std::move(list_); }
+
+private:
+    ImageLookup const &images_;
+    DisplayList list_;
+
+    static bool should_render(layout::LayoutBox const &layout) {
+        if (layout.is_anonymous_block()) {
+            return false;
+        }
+
+        return layout.get_property<css::PropertyId::Display>().has_value();
+    }
+
+    void add_text(layout::LayoutBox const &layout, std::string_view text) {
+        auto font_families = layout.get_property<css::PropertyId::FontFamily>();
+        auto [font_offset, font_count] = intern_fonts(font_families);
+        auto style = to_gfx(layout.get_property<css::PropertyId::FontStyle>(),
+                layout.get_property<css::PropertyId::FontWeight>(),
+                layout.get_property<css::PropertyId::TextDecorationLine>());
+        auto const font_size = layout.get_property<css::PropertyId::FontSize>();
+        // Glyphs aren't confined to the layout box: descenders, italics, and
+        // overhanging glyphs paint outside of it. Half an em in every direction
+        // covers the ink of any reasonable font.
+        auto const overflow = (font_size + 1) / 2;
+        list_.ops.push_back(PaintOp{
+                .bounds = layout.dimensions.border_box().expanded({overflow, overflow, overflow, overflow}),
+                .op = DrawTextOp{
+                        .position = layout.dimensions.content.position(),
+                        .text = text,
+                        .font_offset = font_offset,
+                        .font_count = font_count,
+                        .font_size = font_size,
+                        .style = style,
+                        .color = layout.get_property<css::PropertyId::Color>(),
+                },
+        });
+    }
+
+    void add_element(layout::LayoutBox const &layout) {
+        auto background_color = layout.get_property<css::PropertyId::BackgroundColor>();
+        auto const &border_size = layout.dimensions.border;
+        if (!has_any_border(border_size) && is_fully_transparent(background_color)) {
+            return;
+        }
+
+        gfx::Corners corners{};
+        auto top_left = layout.get_property<css::PropertyId::BorderTopLeftRadius>();
+        corners.top_left = {top_left.first, top_left.second};
+        auto top_right = layout.get_property<css::PropertyId::BorderTopRightRadius>();
+        corners.top_right = {top_right.first, top_right.second};
+        auto bottom_left = layout.get_property<css::PropertyId::BorderBottomLeftRadius>();
+        corners.bottom_left = {bottom_left.first, bottom_left.second};
+        auto bottom_right = layout.get_property<css::PropertyId::BorderBottomRightRadius>();
+        corners.bottom_right = {bottom_right.first, bottom_right.second};
+
+        gfx::Borders borders{};
+        if (has_any_border(border_size)) {
+            borders.left.color = layout.get_property<css::PropertyId::BorderLeftColor>();
+            borders.left.size = border_size.left;
+            borders.right.color = layout.get_property<css::PropertyId::BorderRightColor>();
+            borders.right.size = border_size.right;
+            borders.top.color = layout.get_property<css::PropertyId::BorderTopColor>();
+            borders.top.size = border_size.top;
+            borders.bottom.color = layout.get_property<css::PropertyId::BorderBottomColor>();
+            borders.bottom.size = border_size.bottom;
+        }
+
+        list_.ops.push_back(PaintOp{
+                .bounds = layout.dimensions.border_box(),
+                .op = DrawRectOp{layout.dimensions.padding_box(), background_color, borders, corners},
+        });
+    }
+
+    void add_image(layout::LayoutBox const &layout) {
+        auto const *element = std::get_if<dom::Element>(&layout.node->node);
+        if (!images_ || element == nullptr || element->name != "img") {
+            return;
+        }
+
+        auto const &content = layout.dimensions.content;
+        auto image = images_(*element);
+        if (!image || image->width != content.width || image->height != content.height) {
+            return;
+        }
+
+        list_.ops.push_back(PaintOp{
+                .bounds = content,
+                .op = DrawImageOp{.rect = content, .rgba = image->rgba, .image_id = image->id},
+        });
+    }
+
+    // Neighbouring text tends to share font families, so we only store them
+    // again if they changed since the last text.
+    std::pair<std::uint32_t, std::uint32_t> intern_fonts(std::vector<std::string_view> const &families) {
+        if (last_fonts_) {
+            auto [offset, count] = *last_fonts_;
+            auto last = std::span{list_.fonts}.subspan(offset, count);
+            if (std::ranges::equal(last, families, {}, &gfx::Font::font)) {
+                return *last_fonts_;
+            }
+        }
+
+        auto offset = static_cast<std::uint32_t>(list_.fonts.size());
+        for (auto family : families) {
+            list_.fonts.push_back(gfx::Font{family});
+        }
+
+        last_fonts_ = std::pair{offset, static_cast<std::uint32_t>(families.size())};
+        return *last_fonts_;
+    }
+
+    std::optional<std::pair<std::uint32_t, std::uint32_t>> last_fonts_;
+};
+
+std::optional<gfx::Color> background_of(std::string_view xpath, layout::LayoutBox const &l) {
+    auto d = dom::nodes_by_xpath(l, xpath);
+    if (d.empty()) {
+        return std::nullopt;
+    }
+
+    return d[0]->get_property<css::PropertyId::BackgroundColor>();
+}
+
+bool is_same_op(DisplayList const &a_list, PaintOp const &a, DisplayList const &b_list, PaintOp const &b) {
+    if (a.bounds != b.bounds || a.op.index() != b.op.index()) {
+        return false;
+    }
+
+    if (auto const *a_rect = std::get_if<DrawRectOp>(&a.op)) {
+        return *a_rect == std::get<DrawRectOp>(b.op);
+    }
+
+    // Decoded images don't change, so the same image means the same pixels.
+    // The address of the pixels alone isn't enough, as a freed image's memory
+    // may be reused for a new one.
+    if (auto const *a_image = std::get_if<DrawImageOp>(&a.op)) {
+        auto const &b_image = std::get<DrawImageOp>(b.op);
+        return a_image->rect == b_image.rect && a_image->image_id == b_image.image_id
+                && a_image->rgba.data() == b_image.rgba.data() && a_image->rgba.size() == b_image.rgba.size();
+    }
+
+    auto const &a_text = std::get<DrawTextOp>(a.op);
+    auto const &b_text = std::get<DrawTextOp>(b.op);
+    return a_text.position == b_text.position && a_text.text == b_text.text && a_text.font_size == b_text.font_size
+            && a_text.style == b_text.style && a_text.color == b_text.color
+            && std::ranges::equal(
+                    a_list.fonts_for(a_text), b_list.fonts_for(b_text), {}, &gfx::Font::font, &gfx::Font::font);
+}
+
+} // namespace
+
+DisplayList build_display_list(layout::LayoutBox const &layout, ImageLookup const &images) {
+    DisplayListBuilder builder{images};
+    builder.add(layout);
+    auto list = builder.take();
+
+    std::vector<geom::Rect> bounds;
+    bounds.reserve(list.ops.size());
+    std::ranges::transform(list.ops, std::back_inserter(bounds), &PaintOp::bounds);
+    list.index = geom::RTree{bounds};
+
+    // https://www.w3.org/TR/css-backgrounds-3/#special-backgrounds
+    // If html or body has a background set, use that as the canvas background.
+    if (auto html_bg = background_of("/html", layout);
+            html_bg && html_bg != gfx::Color::from_css_name("transparent")) {
+        list.background = *html_bg;
+    } else if (auto body_bg = background_of("/html/body", layout);
+               body_bg && body_bg != gfx::Color::from_css_name("transparent")) {
+        list.background = *body_bg;
+    }
+
+    return list;
+}
+
+void replay(gfx::ICanvas &painter, DisplayList const &list, std::optional<geom::Rect> const &clip) {
+    painter.clear(list.background);
+    if (!clip) {
+        for (auto const &op : list.ops) {
+            paint(painter, list, op);
+        }
+        return;
+    }
+
+    for (auto idx : list.index.query(*clip)) {
+        paint(painter, list, list.ops[idx]);
+    }
+}
+
+void repaint(gfx::ICanvas &painter, DisplayList const &list, geom::Rect const &area) {
+    painter.fill_rect(area, list.background);
+    for (auto idx : list.index.query(area)) {
+        paint(painter, list, list.ops[idx]);
+    }
+}
+
+void paint(gfx::ICanvas &painter, DisplayList const &list, PaintOp const &op) {
+    if (auto const *rect = std::get_if<DrawRectOp>(&op.op)) {
+        painter.draw_rect(rect->rect, rect->color, rect->borders, rect->corners);
+        return;
+    }
+
+    if (auto const *image = std::get_if<DrawImageOp>(&op.op)) {
+        painter.draw_pixels(image->rect, image->rgba);
+        return;
+    }
+
+    auto const &text = std::get<DrawTextOp>(op.op);
+    painter.draw_text(text.position,
+            text.text,
+            list.fonts_for(text),
+            gfx::FontSize{.px = text.font_size},
+            text.style,
+            text.color);
+}
+
+std::vector<geom::Rect> damaged_areas(DisplayList const &a, DisplayList const &b, geom::Rect const &viewport) {
+    if (a.background != b.background) {
+        return {viewport};
+    }
+
+    // Changes tend to be local, so only the ops between the common prefix and
+    // suffix of the lists have to be compared.
+    auto const shortest = std::min(a.ops.size(), b.ops.size());
+    std::size_t prefix = 0;
+    while (prefix < shortest && is_same_op(a, a.ops[prefix], b, b.ops[prefix])) {
+        ++prefix;
+    }
+
+    std::size_t suffix = 0;
+    while (suffix < shortest - prefix
+            && is_same_op(a, a.ops[a.ops.size() - 1 - suffix], b, b.ops[b.ops.size() - 1 - suffix])) {
+        ++suffix;
+    }
+
+    DamageTracker damage{viewport};
+    for (auto const *list : {&a, &b}) {
+        for (std::size_t i = prefix; i < list->ops.size() - suffix; ++i) {
+            damage.invalidate(list->ops[i].bounds);
+        }
+    }
+
+    return damage.take().areas;
+}
+
+} // namespace render
@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef RENDER_DISPLAY_LIST_H_
+#define RENDER_DISPLAY_LIST_H_
+
+#include "dom/dom.h"
+#include "geom/geom.h"
+#include "geom/rtree.h"
+#include "gfx/color.h"
+#include "gfx/font.h"
+#include "gfx/icanvas.h"
+#include "layout/layout_box.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace render {
+
+struct DrawRectOp {
+    geom::Rect rect{};
+    gfx::Color color{};
+    gfx::Borders borders{};
+    gfx::Corners corners{};
+    [[nodiscard]] bool operator==(DrawRectOp const &) const = default;
+};
+
+struct DrawTextOp {
+    geom::Position position{};
+    std::string_view text{};
+    // The font families to pick from, stored in DisplayList::fonts.
+    std::uint32_t font_offset{};
+    std::uint32_t font_count{};
+    int font_size{};
+    gfx::FontStyle style{};
+    gfx::Color color{};
+};
+
+struct DrawImageOp {
+    geom::Rect rect{};
+    // RGBA pixels, exactly covering the rect.
+    std::span<std::uint8_t const> rgba{};
+    // See ImagePixels::id.
+    std::uint64_t image_id{};
+};
+
+struct PaintOp {
+    // The area the op may paint to, used for culling and damage tracking.
+    geom::Rect bounds{};
+    std::variant<DrawRectOp, DrawTextOp, DrawImageOp> op{};
+};
+
+// Everything needed to paint a layout, with all properties resolved. Text and
+// font families are views into the layout and style trees, and images are views
+// into whatever ImageLookup handed out, so the display list may not outlive
+// either of them.
+struct DisplayList {
+    gfx::Color background{255, 255, 255};
+    std::vector<PaintOp> ops{};
+    std::vector<gfx::Font> fonts{};
+    // The bounds of the ops, for finding the ones inside of a clip rect.
+    geom::RTree index{};
+
+    [[nodiscard]] std::span<gfx::Font const> fonts_for(DrawTextOp const &op) const {
+        return std::span{fonts}.subspan(op.font_offset, op.font_count);
+    }
+};
+
+// The decoded image shown by an <img>. Images that don't have the same size as
+// the content box of their <img> aren't painted.
+struct ImagePixels {
+    int width{};
+    int height{};
+    std::span<std::uint8_t const> rgba{};
+    // Identifies the decoded image for telling whether two frames show the same
+    // one. Unlike the address of the pixels, it isn't reused once the image is
+    // freed.
+    std::uint64_t id{};
+};
+
+using ImageLookup = std::function<std::optional<ImagePixels>(dom::Element const &)>;
+
+DisplayList build_display_list(layout::LayoutBox const &, ImageLookup const & = {});
+
+void replay(gfx::ICanvas &, DisplayList const &, std::optional<geom::Rect> const &clip = std::nullopt);
+
+// Paints the area without clearing the rest of the canvas. Ops overlapping the
+// edges of the area are painted in full, so the canvas has to clip to the area.
+void repaint(gfx::ICanvas &, DisplayList const &, geom::Rect const &area);
+
+// Paints a single op from the display list, without clearing the canvas first.
+void paint(gfx::ICanvas &, DisplayList const &, PaintOp const &);
+
+// The areas that have to be repainted when going from painting one display list
+// to painting the other. A changed background damages the entire viewport.
+std::vector<geom::Rect> damaged_areas(DisplayList const &, DisplayList const &, geom::Rect const &viewport);
+
+} // namespace render
+
+#endif
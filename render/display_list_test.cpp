@@ -0,0 +1,243 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "render/display_list.h"
+
+#include "css/property_id.h"
+#include "dom/dom.h"
+#include "etest/etest2.h"
+#include "geom/geom.h"
+#include "gfx/canvas_command_saver.h"
+#include "gfx/color.h"
+#include "layout/layout_box.h"
+#include "style/styled_node.h"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+using CanvasCommands = std::vector<gfx::CanvasCommand>;
+
+namespace {
+
+constexpr auto kViewport = geom::Rect{0, 0, 100, 100};
+
+struct TwoBlocks {
+    dom::Node dom = dom::Element{"div", {}, {dom::Element{"p"}, dom::Element{"p"}}};
+    style::StyledNode styled{
+            .node = dom,
+            .properties = {{css::PropertyId::Display, "block"}},
+            .children{
+                    style::StyledNode{
+                            .node = std::get<dom::Element>(dom).children[0],
+                            .properties = {{css::PropertyId::Display, "block"},
+                                    {css::PropertyId::BackgroundColor, "#010203"}},
+                    },
+                    style::StyledNode{
+                            .node = std::get<dom::Element>(dom).children[1],
+                            .properties = {{css::PropertyId::Display, "block"},
+                                    {css::PropertyId::BackgroundColor, "#040506"}},
+                    },
+            },
+    };
+    layout::LayoutBox layout{
+            .node = &styled,
+            .dimensions = {{0, 0, 100, 20}},
+            .children{
+                    layout::LayoutBox{.node = &styled.children[0], .dimensions = {{0, 0, 100, 10}}},
+                    layout::LayoutBox{.node = &styled.children[1], .dimensions = {{0, 10, 100, 10}}},
+            },
+    };
+};
+
+} // namespace
+
+int main() {
+    etest::Suite s{"render/display_list"};
+
+    s.add_test("properties are resolved up front", [](etest::IActions &a) {
+        TwoBlocks blocks;
+        auto list = render::build_display_list(blocks.layout);
+
+        a.expect_eq(list.background, gfx::Color{0xFF, 0xFF, 0xFF});
+        a.require_eq(list.ops.size(), std::size_t{2});
+        a.expect_eq(list.ops[0].bounds, geom::Rect{0, 0, 100, 10});
+        a.expect_eq(std::get<render::DrawRectOp>(list.ops[0].op),
+                render::DrawRectOp{.rect{0, 0, 100, 10}, .color{0x01, 0x02, 0x03}});
+        a.expect_eq(std::get<render::DrawRectOp>(list.ops[1].op),
+                render::DrawRectOp{.rect{0, 10, 100, 10}, .color{0x04, 0x05, 0x06}});
+
+        // The properties are only read when building the display list.
+        blocks.styled.children[0].properties = {{css::PropertyId::Display, "block"}};
+        gfx::CanvasCommandSaver saver;
+        render::replay(saver, list);
+        a.expect_eq(saver.take_commands(),
+                CanvasCommands{
+                        gfx::ClearCmd{{0xFF, 0xFF, 0xFF}},
+                        gfx::DrawRectCmd{{0, 0, 100, 10}, {0x01, 0x02, 0x03}},
+                        gfx::DrawRectCmd{{0, 10, 100, 10}, {0x04, 0x05, 0x06}},
+                });
+    });
+
+    s.add_test("text shares font families", [](etest::IActions &a) {
+        dom::Node dom = dom::Element{"span", {}, {dom::Text{"hello"}, dom::Text{"world"}}};
+        auto const &children = std::get<dom::Element>(dom).children;
+        style::StyledNode styled{
+                .node = dom,
+                .properties = {{css::PropertyId::Display, "inline"}, {css::PropertyId::FontFamily, "a, b"}},
+                .children{
+                        style::StyledNode{.node = children[0]},
+                        style::StyledNode{.node = children[1]},
+                },
+        };
+        for (auto &child : styled.children) {
+            child.parent = &styled;
+        }
+
+        layout::LayoutBox layout{
+                .node = &styled,
+                .children{
+                        layout::LayoutBox{.node = &styled.children[0], .layout_text = "hello"sv},
+                        layout::LayoutBox{.node = &styled.children[1], .layout_text = "world"sv},
+                },
+        };
+
+        auto list = render::build_display_list(layout);
+        a.require_eq(list.ops.size(), std::size_t{2});
+        a.expect_eq(list.fonts.size(), std::size_t{2});
+
+        gfx::CanvasCommandSaver saver;
+        render::replay(saver, list);
+        a.expect_eq(saver.take_commands(),
+                CanvasCommands{
+                        gfx::ClearCmd{{0xFF, 0xFF, 0xFF}},
+                        gfx::DrawTextWithFontOptionsCmd{{0, 0}, "hello", {"a", "b"}, 16, {}, {}},
+                        gfx::DrawTextWithFontOptionsCmd{{0, 0}, "world", {"a", "b"}, 16, {}, {}},
+                });
+    });
+
+    s.add_test("text bounds include overflowing glyphs", [](etest::IActions &a) {
+        dom::Node dom = dom::Element{"span", {}, {dom::Text{"hello"}}};
+        style::StyledNode styled{
+                .node = dom,
+                .properties = {{css::PropertyId::Display, "inline"}},
+                .children{style::StyledNode{.node = std::get<dom::Element>(dom).children[0]}},
+        };
+        styled.children[0].parent = &styled;
+
+        layout::LayoutBox layout{
+                .node = &styled,
+                .children{
+                        layout::LayoutBox{
+                                .node = &styled.children[0],
+                                .dimensions = {{10, 20, 50, 16}},
+                                .layout_text = "hello"sv,
+                        },
+                },
+        };
+
+        auto list = render::build_display_list(layout);
+        a.require_eq(list.ops.size(), std::size_t{1});
+        a.expect_eq(list.ops[0].bounds, geom::Rect{2, 12, 66, 32});
+        a.expect_eq(list.index.query({0, 40, 10, 10}), std::vector<std::size_t>{0});
+    });
+
+    s.add_test("images", [](etest::IActions &a) {
+        dom::Node dom = dom::Element{"img", {{"src", "a.png"}}};
+        style::StyledNode styled{.node = dom, .properties = {{css::PropertyId::Display, "inline"}}};
+        layout::LayoutBox layout{.node = &styled, .dimensions = {{10, 20, 2, 1}}};
+        layout.dimensions.padding = {1, 1, 1, 1};
+
+        std::vector<std::uint8_t> const pixels{1, 2, 3, 4, 5, 6, 7, 8};
+        auto lookup = [&](dom::Element const &element) -> std::optional<render::ImagePixels> {
+            if (element.attributes.at("src") != "a.png") {
+                return std::nullopt;
+            }
+            return render::ImagePixels{2, 1, pixels};
+        };
+
+        auto list = render::build_display_list(layout, lookup);
+        a.require_eq(list.ops.size(), std::size_t{1});
+        a.expect_eq(list.ops[0].bounds, geom::Rect{10, 20, 2, 1});
+
+        gfx::CanvasCommandSaver saver;
+        render::replay(saver, list);
+        a.expect_eq(saver.take_commands(),
+                CanvasCommands{
+                        gfx::ClearCmd{{0xFF, 0xFF, 0xFF}},
+                        gfx::DrawPixelsCmd{{10, 20, 2, 1}, pixels},
+                });
+
+        // Images are only drawn at the size they were laid out at.
+        layout.dimensions.content.width = 3;
+        a.expect(render::build_display_list(layout, lookup).ops.empty());
+        a.expect(render::build_display_list(layout).ops.empty());
+    });
+
+    s.add_test("replay with culling", [](etest::IActions &a) {
+        TwoBlocks blocks;
+        auto list = render::build_display_list(blocks.layout);
+
+        gfx::CanvasCommandSaver saver;
+        render::replay(saver, list, geom::Rect{0, 15, 10, 10});
+        a.expect_eq(saver.take_commands(),
+                CanvasCommands{
+                        gfx::ClearCmd{{0xFF, 0xFF, 0xFF}},
+                        gfx::DrawRectCmd{{0, 10, 100, 10}, {0x04, 0x05, 0x06}},
+                });
+    });
+
+    s.add_test("damage, nothing changed", [](etest::IActions &a) {
+        TwoBlocks blocks;
+        auto before = render::build_display_list(blocks.layout);
+        auto after = render::build_display_list(blocks.layout);
+        a.expect(render::damaged_areas(before, after, kViewport).empty());
+    });
+
+    s.add_test("damage, changed color", [](etest::IActions &a) {
+        TwoBlocks blocks;
+        auto before = render::build_display_list(blocks.layout);
+        blocks.styled.children[1].properties[1].second = "#070809";
+        auto after = render::build_display_list(blocks.layout);
+        a.expect_eq(render::damaged_areas(before, after, kViewport), std::vector{geom::Rect{0, 10, 100, 10}});
+    });
+
+    s.add_test("damage, moved box", [](etest::IActions &a) {
+        TwoBlocks blocks;
+        auto before = render::build_display_list(blocks.layout);
+        blocks.layout.children[0].dimensions.content = {50, 50, 10, 10};
+        auto after = render::build_display_list(blocks.layout);
+        a.expect_eq(render::damaged_areas(before, after, kViewport),
+                std::vector{geom::Rect{0, 0, 100, 10}, geom::Rect{50, 50, 10, 10}});
+    });
+
+    s.add_test("damage, removed box", [](etest::IActions &a) {
+        TwoBlocks blocks;
+        auto before = render::build_display_list(blocks.layout);
+        blocks.layout.children.erase(blocks.layout.children.begin());
+        auto after = render::build_display_list(blocks.layout);
+        a.expect_eq(render::damaged_areas(before, after, kViewport), std::vector{geom::Rect{0, 0, 100, 10}});
+    });
+
+    s.add_test("damage, outside of the viewport", [](etest::IActions &a) {
+        TwoBlocks blocks;
+        auto before = render::build_display_list(blocks.layout);
+        blocks.styled.children[1].properties[1].second = "#070809";
+        auto after = render::build_display_list(blocks.layout);
+        a.expect(render::damaged_areas(before, after, {0, 0, 100, 5}).empty());
+    });
+
+    s.add_test("damage, changed background", [](etest::IActions &a) {
+        TwoBlocks blocks;
+        auto before = render::build_display_list(blocks.layout);
+        auto after = before;
+        after.background = gfx::Color{};
+        a.expect_eq(render::damaged_areas(before, after, kViewport), std::vector{kViewport});
+    });
+
+    return s.run();
+}
@@ -5,6 +5,8 @@
 #ifndef RENDER_RENDER_H_
 #define RENDER_RENDER_H_
 
+#include "render/display_list.h"
+
 #include "geom/geom.h"
 #include "gfx/icanvas.h"
 #include "layout/layout_box.h"
@@ -13,7 +15,10 @@
 
 namespace render {
 
-void render_layout(gfx::ICanvas &, layout::LayoutBox const &, std::optional<geom::Rect> const &clip = std::nullopt);
+void render_layout(gfx::ICanvas &,
+        layout::LayoutBox const &,
+        std::optional<geom::Rect> const &clip = std::nullopt,
+        ImageLookup const & = {});
 
 namespace debug {
 void render_layout_depth(gfx::ICanvas &, layout::LayoutBox const &);
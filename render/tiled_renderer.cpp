@@ -0,0 +1,160 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "render/tiled_renderer.h"
+
+#include "render/display_list.h"
+
+#include "geom/geom.h"
+#include "gfx/color.h"
+#include "gfx/font.h"
+#include "gfx/glyph_atlas.h"
+#include "gfx/icanvas.h"
+#include "gfx/iglyph_rasterizer.h"
+#include "gfx/software_canvas.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace render {
+namespace {
+
+class Hasher {
+public:
+    Hasher &add(std::uint64_t v) {
+        hash_ ^= v + 0x9e37'79b9'7f4a'7c15 + (hash_ << 6) + (hash_ >> 2);
+        return *this;
+    }
+
+    Hasher &add(int v) { return add(static_cast<std::uint64_t>(static_cast<std::uint32_t>(v))); }
+    Hasher &add(bool v) { return add(std::uint64_t{v}); }
+    Hasher &add(std::string_view v) { return add(std::uint64_t{std::hash<std::string_view>{}(v)}); }
+    Hasher &add(gfx::Color c) { return add(std::uint64_t{c.as_rgba_u32()}); }
+    Hasher &add(geom::Rect const &r) { return add(r.x).add(r.y).add(r.width).add(r.height); }
+    Hasher &add(gfx::BorderProperties const &b) { return add(b.color).add(b.size); }
+    Hasher &add(gfx::Radii const &r) { return add(r.horizontal).add(r.vertical); }
+
+    [[nodiscard]] std::uint64_t value() const { return hash_; }
+
+private:
+    std::uint64_t hash_{};
+};
+
+std::uint64_t hash(DisplayList const &list, PaintOp const &op) {
+    Hasher h;
+    h.add(op.bounds).add(std::uint64_t{op.op.index()});
+    if (auto const *rect = std::get_if<DrawRectOp>(&op.op)) {
+        h.add(rect->rect).add(rect->color);
+        h.add(rect->borders.left).add(rect->borders.right).add(rect->borders.top).add(rect->borders.bottom);
+        h.add(rect->corners.top_left).add(rect->corners.top_right);
+        h.add(rect->corners.bottom_left).add(rect->corners.bottom_right);
+        return h.value();
+    }
+
+    // Decoded images are immutable, so their pixels are identified by the
+    // image's id. The address is reused once an image is freed, so it's not
+    // enough on its own.
+    if (auto const *image = std::get_if<DrawImageOp>(&op.op)) {
+        h.add(image->rect).add(image->image_id);
+        h.add(std::uint64_t{reinterpret_cast<std::uintptr_t>(image->rgba.data())});
+        return h.add(std::uint64_t{image->rgba.size()}).value();
+    }
+
+    auto const &text = std::get<DrawTextOp>(op.op);
+    h.add(text.position.x).add(text.position.y).add(text.text).add(text.font_size).add(text.color);
+    h.add(text.style.bold).add(text.style.italic).add(text.style.strikethrough).add(text.style.underlined);
+    for (auto const &font : list.fonts_for(text)) {
+        h.add(font.font);
+    }
+
+    return h.value();
+}
+
+} // namespace
+
+TiledRenderer::TiledRenderer(gfx::IGlyphRasterizer const *glyphs, TiledRendererOptions opts)
+    : glyphs_{glyphs}, tile_size_{std::max(opts.tile_size, 1)},
+      threads_{opts.threads != 0 ? opts.threads : std::max(std::thread::hardware_concurrency(), 1u)} {}
+
+TiledFrameStats TiledRenderer::render(DisplayList const &list, gfx::SoftwareCanvas &canvas) {
+    if (canvas.width() != width_ || canvas.height() != height_) {
+        reset_tiles(canvas.width(), canvas.height());
+    }
+
+    std::vector<std::uint64_t> op_hashes;
+    op_hashes.reserve(list.ops.size());
+    for (auto const &op : list.ops) {
+        op_hashes.push_back(hash(list, op));
+    }
+
+    std::atomic<std::size_t> next_tile{0};
+    std::atomic<std::size_t> painted{0};
+    auto work = [&] {
+        for (auto i = next_tile.fetch_add(1); i < tiles_.size(); i = next_tile.fetch_add(1)) {
+            auto &tile = tiles_[i];
+            auto const ops = list.index.query(tile.area);
+
+            Hasher h;
+            h.add(list.background);
+            for (auto idx : ops) {
+                h.add(op_hashes[idx]);
+            }
+
+            if (!tile.painted || tile.fingerprint != h.value()) {
+                tile.canvas.clear(list.background);
+                for (auto idx : ops) {
+                    paint(tile.canvas, list, list.ops[idx]);
+                }
+
+                tile.fingerprint = h.value();
+                tile.painted = true;
+                painted.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // Tiles don't overlap, so they can be copied into the canvas concurrently.
+            canvas.blit(tile.canvas, tile.area.position());
+        }
+    };
+
+    {
+        auto const helpers = std::clamp(tiles_.size(), std::size_t{1}, std::size_t{threads_}) - 1;
+        std::vector<std::jthread> workers;
+        workers.reserve(helpers);
+        for (std::size_t i = 0; i < helpers; ++i) {
+            workers.emplace_back(work);
+        }
+
+        work();
+    }
+
+    return {.tiles_painted = painted.load(), .tiles_reused = tiles_.size() - painted.load()};
+}
+
+void TiledRenderer::reset_tiles(int width, int height) {
+    width_ = width;
+    height_ = height;
+    tiles_.clear();
+    // A tile only needs the glyphs of the text in it, so there's no point in
+    // giving each tile a full-size glyph atlas.
+    gfx::GlyphAtlasOptions const atlas_opts{.page_size = std::max(tile_size_, 256)};
+    for (int y = 0; y < height; y += tile_size_) {
+        for (int x = 0; x < width; x += tile_size_) {
+            auto &tile = tiles_.emplace_back(Tile{
+                    .area{x, y, std::min(tile_size_, width - x), std::min(tile_size_, height - y)},
+                    .canvas = gfx::SoftwareCanvas{glyphs_, atlas_opts},
+            });
+            tile.canvas.set_viewport_size(tile.area.width, tile.area.height);
+            tile.canvas.add_translation(-x, -y);
+        }
+    }
+}
+
+} // namespace render
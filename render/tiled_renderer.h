@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef RENDER_TILED_RENDERER_H_
+#define RENDER_TILED_RENDERER_H_
+
+#include "render/display_list.h"
+
+#include "geom/geom.h"
+#include "gfx/iglyph_rasterizer.h"
+#include "gfx/software_canvas.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace render {
+
+struct TiledRendererOptions {
+    int tile_size{256};
+    // 0 means one thread per hardware thread.
+    unsigned threads{0};
+};
+
+struct TiledFrameStats {
+    std::size_t tiles_painted{};
+    std::size_t tiles_reused{};
+    [[nodiscard]] bool operator==(TiledFrameStats const &) const = default;
+};
+
+// Paints display lists into a software canvas by splitting the canvas into
+// fixed-size tiles that are rasterized in parallel. A tile is only repainted if
+// the paint ops touching it changed since the last frame.
+class TiledRenderer {
+public:
+    explicit TiledRenderer(gfx::IGlyphRasterizer const *glyphs = nullptr, TiledRendererOptions = {});
+
+    // Paints the display list into the canvas, which also decides the size of
+    // the area to paint. Unchanged tiles are copied from the last frame.
+    TiledFrameStats render(DisplayList const &, gfx::SoftwareCanvas &);
+
+private:
+    struct Tile {
+        geom::Rect area{};
+        gfx::SoftwareCanvas canvas;
+        // A hash of the background and the ops touching the tile when it was
+        // last painted.
+        std::uint64_t fingerprint{};
+        bool painted{false};
+    };
+
+    void reset_tiles(int width, int height);
+
+    gfx::IGlyphRasterizer const *glyphs_{nullptr};
+    int tile_size_{};
+    unsigned threads_{};
+    int width_{};
+    int height_{};
+    std::vector<Tile> tiles_;
+};
+
+} // namespace render
+
+#endif
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "render/tiled_renderer.h"
+
+#include "render/display_list.h"
+
+#include "geom/geom.h"
+#include "geom/rtree.h"
+#include "gfx/color.h"
+#include "gfx/font.h"
+#include "gfx/freetype_glyph_rasterizer.h"
+#include "gfx/icanvas.h"
+#include "gfx/software_canvas.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kWidth = 1280;
+constexpr std::string_view kText = "The quick brown fox jumps over the lazy dog, again and again and again.";
+
+// A long document: one bordered box per paragraph with a few lines of text in it.
+render::DisplayList make_page(int height) {
+    render::DisplayList list;
+    list.fonts.push_back(gfx::Font{"dejavusans"});
+
+    gfx::Borders const borders{
+            .left{{0x80, 0x80, 0x80}, 1},
+            .right{{0x80, 0x80, 0x80}, 1},
+            .top{{0x80, 0x80, 0x80}, 1},
+            .bottom{{0x80, 0x80, 0x80}, 1},
+    };
+    gfx::Corners const corners{{6, 6}, {6, 6}, {6, 6}, {6, 6}};
+
+    for (int y = 10; y + 100 < height; y += 110) {
+        geom::Rect box{20, y, kWidth - 40, 100};
+        list.ops.push_back(render::PaintOp{
+                .bounds = box.expanded({1, 1, 1, 1}),
+                .op = render::DrawRectOp{box, {0xF4, 0xF4, 0xFA}, borders, corners},
+        });
+
+        for (int line = 0; line < 4; ++line) {
+            geom::Position p{30, y + 10 + line * 20};
+            list.ops.push_back(render::PaintOp{
+                    .bounds{p.x, p.y, kWidth - 60, 20},
+                    .op = render::DrawTextOp{
+                            .position = p,
+                            .text = kText,
+                            .font_offset = 0,
+                            .font_count = 1,
+                            .font_size = 16,
+                            .color = {0x20, 0x20, 0x20},
+                    },
+            });
+        }
+    }
+
+    std::vector<geom::Rect> bounds;
+    bounds.reserve(list.ops.size());
+    for (auto const &op : list.ops) {
+        bounds.push_back(op.bounds);
+    }
+    list.index = geom::RTree{bounds};
+    return list;
+}
+
+long long ms_since(std::chrono::steady_clock::time_point start) {
+    auto duration = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+}
+
+} // namespace
+
+// Paints a full-page screenshot of a long document w/ different thread counts.
+int main(int argc, char **argv) {
+    int const height = argc > 1 ? std::atoi(argv[1]) : 16'384;
+    auto const list = make_page(height);
+    gfx::FreeTypeGlyphRasterizer glyphs;
+
+    auto const max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned threads = 1; threads <= max_threads * 2; threads *= 2) {
+        render::TiledRenderer renderer{&glyphs, {.threads = threads}};
+        gfx::SoftwareCanvas canvas;
+        canvas.set_viewport_size(kWidth, height);
+
+        // The first frame also fills the tiles' glyph caches.
+        renderer.render(list, canvas);
+
+        auto start = std::chrono::steady_clock::now();
+        auto modified = list;
+        modified.background = {0xFF, 0xFF, 0xFE};
+        renderer.render(modified, canvas);
+        auto const repaint_ms = ms_since(start);
+
+        start = std::chrono::steady_clock::now();
+        auto stats = renderer.render(modified, canvas);
+        auto const cached_ms = ms_since(start);
+
+        std::cout << threads << " thread(s): " << kWidth << "x" << height << " repainted in " << repaint_ms
+                  << "ms, unchanged frame (" << stats.tiles_reused << " tiles reused) in " << cached_ms << "ms\n";
+    }
+}
@@ -0,0 +1,163 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "render/tiled_renderer.h"
+
+#include "render/display_list.h"
+
+#include "etest/etest2.h"
+#include "geom/geom.h"
+#include "geom/rtree.h"
+#include "gfx/color.h"
+#include "gfx/icanvas.h"
+#include "gfx/software_canvas.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr int kWidth = 100;
+constexpr int kHeight = 70;
+
+render::DisplayList make_list(std::vector<render::PaintOp> ops, gfx::Color background = {0xFF, 0xFF, 0xFF}) {
+    render::DisplayList list{.background = background, .ops = std::move(ops)};
+    std::vector<geom::Rect> bounds;
+    for (auto const &op : list.ops) {
+        bounds.push_back(op.bounds);
+    }
+    list.index = geom::RTree{bounds};
+    return list;
+}
+
+render::PaintOp rect_op(geom::Rect rect, gfx::Color color, gfx::Borders borders = {}) {
+    auto bounds = rect.expanded({borders.left.size, borders.right.size, borders.top.size, borders.bottom.size});
+    return render::PaintOp{.bounds = bounds, .op = render::DrawRectOp{rect, color, borders, {}}};
+}
+
+render::DisplayList make_page() {
+    gfx::Borders borders{
+            .left{{0xFF, 0, 0}, 2},
+            .right{{0, 0xFF, 0}, 3},
+            .top{{0, 0, 0xFF}, 1},
+            .bottom{{0, 0, 0}, 4},
+    };
+    return make_list({
+            rect_op({5, 5, 90, 20}, {0x10, 0x20, 0x30}),
+            rect_op({10, 30, 50, 30}, {0xAA, 0xBB, 0xCC, 0x80}, borders),
+            rect_op({40, 0, 10, 70}, {0, 0x80, 0, 0x40}),
+    });
+}
+
+gfx::SoftwareCanvas make_canvas() {
+    gfx::SoftwareCanvas canvas;
+    canvas.set_viewport_size(kWidth, kHeight);
+    return canvas;
+}
+
+gfx::SoftwareCanvas replayed(render::DisplayList const &list) {
+    auto canvas = make_canvas();
+    render::replay(canvas, list);
+    return canvas;
+}
+
+bool same_pixels(gfx::SoftwareCanvas const &a, gfx::SoftwareCanvas const &b) {
+    return std::ranges::equal(a.pixels(), b.pixels());
+}
+
+} // namespace
+
+int main() {
+    etest::Suite s{"render/tiled_renderer"};
+
+    s.add_test("matches painting everything at once", [](etest::IActions &a) {
+        auto list = make_page();
+        for (unsigned threads : {1u, 3u, 8u}) {
+            render::TiledRenderer renderer{nullptr, {.tile_size = 16, .threads = threads}};
+            auto canvas = make_canvas();
+            auto stats = renderer.render(list, canvas);
+            // 7 * 5 tiles of at most 16x16 pixels.
+            a.expect_eq(stats, render::TiledFrameStats{.tiles_painted = 35});
+            a.expect(same_pixels(canvas, replayed(list)));
+        }
+    });
+
+    s.add_test("unchanged tiles are reused", [](etest::IActions &a) {
+        render::TiledRenderer renderer{nullptr, {.tile_size = 32, .threads = 2}};
+        auto canvas = make_canvas();
+        renderer.render(make_page(), canvas);
+
+        // The results are copied even into a canvas that wasn't drawn to before.
+        auto other_canvas = make_canvas();
+        a.expect_eq(renderer.render(make_page(), other_canvas), render::TiledFrameStats{.tiles_reused = 12});
+        a.expect(same_pixels(other_canvas, replayed(make_page())));
+    });
+
+    s.add_test("only tiles touched by changes are repainted", [](etest::IActions &a) {
+        render::TiledRenderer renderer{nullptr, {.tile_size = 32, .threads = 2}};
+        auto canvas = make_canvas();
+        renderer.render(make_page(), canvas);
+
+        auto changed = make_page();
+        std::get<render::DrawRectOp>(changed.ops[0].op).color = {0xFF, 0, 0};
+        // The first rect is in the first 3 of the 4 tiles in the top row.
+        a.expect_eq(renderer.render(changed, canvas), render::TiledFrameStats{.tiles_painted = 3, .tiles_reused = 9});
+        a.expect(same_pixels(canvas, replayed(changed)));
+
+        auto moved = changed;
+        moved.ops[2].bounds = moved.ops[2].bounds.translated(30, 0);
+        std::get<render::DrawRectOp>(moved.ops[2].op).rect = moved.ops[2].bounds;
+        moved.index = make_list(moved.ops).index;
+        // The third rect moves from the second column of tiles to the third.
+        a.expect_eq(renderer.render(moved, canvas), render::TiledFrameStats{.tiles_painted = 6, .tiles_reused = 6});
+        a.expect(same_pixels(canvas, replayed(moved)));
+    });
+
+    s.add_test("images are told apart by id, not address", [](etest::IActions &a) {
+        render::TiledRenderer renderer{nullptr, {.tile_size = 32, .threads = 2}};
+        auto canvas = make_canvas();
+
+        // A new image w/ the same size may be decoded into a freed image's memory.
+        std::vector<std::uint8_t> pixels(std::size_t{4} * 4 * 4, 0xFF);
+        auto image_page = [&](std::uint64_t id) {
+            return make_list({render::PaintOp{
+                    .bounds{0, 0, 4, 4},
+                    .op = render::DrawImageOp{.rect{0, 0, 4, 4}, .rgba = pixels, .image_id = id},
+            }});
+        };
+        renderer.render(image_page(1), canvas);
+
+        std::ranges::fill(pixels, std::uint8_t{0x80});
+        a.expect_eq(renderer.render(image_page(2), canvas),
+                render::TiledFrameStats{.tiles_painted = 1, .tiles_reused = 11});
+        a.expect(same_pixels(canvas, replayed(image_page(2))));
+    });
+
+    s.add_test("background changes repaint everything", [](etest::IActions &a) {
+        render::TiledRenderer renderer{nullptr, {.tile_size = 32, .threads = 2}};
+        auto canvas = make_canvas();
+        renderer.render(make_page(), canvas);
+
+        auto list = make_list({}, {0, 0, 0});
+        a.expect_eq(renderer.render(list, canvas), render::TiledFrameStats{.tiles_painted = 12});
+        a.expect_eq(canvas.pixel_at(99, 69), gfx::Color{0, 0, 0});
+    });
+
+    s.add_test("resizing repaints everything", [](etest::IActions &a) {
+        render::TiledRenderer renderer{nullptr, {.tile_size = 32, .threads = 2}};
+        auto canvas = make_canvas();
+        renderer.render(make_page(), canvas);
+
+        canvas.set_viewport_size(20, 20);
+        a.expect_eq(renderer.render(make_page(), canvas), render::TiledFrameStats{.tiles_painted = 1});
+
+        canvas.set_viewport_size(0, 0);
+        a.expect_eq(renderer.render(make_page(), canvas), render::TiledFrameStats{});
+    });
+
+    return s.run();
+}
@@ -0,0 +1,535 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "type/font_index.h"
+
+#include "os/xdg.h"
+#include "unicode/util.h"
+#include "util/string.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace type {
+namespace {
+
+constexpr std::string_view kCacheHeader = "hastur-font-index 1";
+
+// Guards against broken or malicious fonts making us read a lot of data.
+constexpr std::size_t kMaxFacesPerCollection = 256;
+constexpr std::size_t kMaxNameTableSize = std::size_t{1024} * 1024;
+
+constexpr std::uint32_t kTrueTypeVersion = 0x0001'0000;
+constexpr std::uint32_t kOtto = 0x4F54'544F;
+constexpr std::uint32_t kTrue = 0x7472'7565;
+
+// Font directories also contain things like fonts.dir, fonts.scale, and .uuid
+// files, which shouldn't be found as fonts.
+constexpr auto kFontExtensions = std::to_array<std::string_view>({
+        ".bdf",
+        ".bdf.gz",
+        ".dfont",
+        ".otc",
+        ".otf",
+        ".pcf",
+        ".pcf.gz",
+        ".pfa",
+        ".pfb",
+        ".ttc",
+        ".ttf",
+        ".woff",
+        ".woff2",
+});
+
+bool has_font_extension(fs::path const &path) {
+    auto const name = util::lowercased(path.filename().string());
+    return std::ranges::any_of(kFontExtensions, [&](std::string_view ext) { return name.ends_with(ext); });
+}
+
+// Callers check that there's enough data.
+std::uint16_t u16(std::string_view data, std::size_t at) {
+    auto const hi = static_cast<unsigned char>(data[at]);
+    auto const lo = static_cast<unsigned char>(data[at + 1]);
+    return static_cast<std::uint16_t>(hi << 8 | lo);
+}
+
+std::uint32_t u32(std::string_view data, std::size_t at) {
+    return static_cast<std::uint32_t>(u16(data, at)) << 16 | u16(data, at + 2);
+}
+
+std::optional<std::string> read_at(std::ifstream &file, std::uint64_t offset, std::size_t size) {
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(offset));
+    std::string data(size, '\0');
+    if (!file.read(data.data(), static_cast<std::streamsize>(size))) {
+        return std::nullopt;
+    }
+
+    return data;
+}
+
+std::string from_utf16be(std::string_view bytes) {
+    std::string out;
+    for (std::size_t i = 0; i + 1 < bytes.size(); i += 2) {
+        std::uint32_t code_point = u16(bytes, i);
+        if (code_point >= 0xD800 && code_point < 0xDC00 && i + 3 < bytes.size()) {
+            auto const low = u16(bytes, i + 2);
+            if (low >= 0xDC00 && low < 0xE000) {
+                code_point = 0x1'0000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            }
+        }
+
+        out += unicode::to_utf8(code_point);
+    }
+
+    return out;
+}
+
+struct Names {
+    std::string family;
+    std::string style;
+};
+
+// https://learn.microsoft.com/en-us/typography/opentype/spec/name
+std::optional<Names> parse_name_table(std::string_view table) {
+    if (table.size() < 6) {
+        return std::nullopt;
+    }
+
+    // The typographic family and subfamily names are preferred over the
+    // legacy ones, as they don't split families up by weight, and English
+    // names on Windows are preferred over anything else.
+    struct Candidate {
+        int rank{INT_MAX};
+        std::string value;
+    };
+    Candidate family;
+    Candidate style;
+
+    auto const count = u16(table, 2);
+    auto const storage = std::size_t{u16(table, 4)};
+    for (std::size_t i = 0; i < count && 6 + i * 12 + 12 <= table.size(); ++i) {
+        auto const record = 6 + i * 12;
+        auto const platform = u16(table, record);
+        auto const encoding = u16(table, record + 2);
+        auto const language = u16(table, record + 4);
+        auto const name_id = u16(table, record + 6);
+        auto const length = std::size_t{u16(table, record + 8)};
+        auto const offset = std::size_t{u16(table, record + 10)};
+
+        Candidate *candidate = nullptr;
+        int rank = 0;
+        switch (name_id) {
+            case 16:
+                candidate = &family;
+                break;
+            case 1:
+                candidate = &family;
+                rank = 8;
+                break;
+            case 17:
+                candidate = &style;
+                break;
+            case 2:
+                candidate = &style;
+                rank = 8;
+                break;
+            default:
+                continue;
+        }
+
+        bool const mac_roman = platform == 1 && encoding == 0;
+        if (platform == 3 && (encoding == 0 || encoding == 1 || encoding == 10)) {
+            rank += language == 0x409 ? 0 : 1;
+        } else if (platform == 0) {
+            rank += 2;
+        } else if (mac_roman) {
+            rank += language == 0 ? 3 : 4;
+        } else {
+            continue;
+        }
+
+        if (rank >= candidate->rank || storage + offset + length > table.size()) {
+            continue;
+        }
+
+        auto const bytes = table.substr(storage + offset, length);
+        std::string value;
+        if (mac_roman) {
+            // Mac Roman matches Latin-1 for everything that shows up in names.
+            for (auto c : bytes) {
+                value += unicode::to_utf8(static_cast<unsigned char>(c));
+            }
+        } else {
+            value = from_utf16be(bytes);
+        }
+
+        *candidate = Candidate{rank, std::move(value)};
+    }
+
+    if (family.value.empty()) {
+        return std::nullopt;
+    }
+
+    return Names{std::move(family.value), std::move(style.value)};
+}
+
+// https://learn.microsoft.com/en-us/typography/opentype/spec/otff#table-directory
+std::optional<Names> read_face_names(std::ifstream &file, std::uint64_t offset) {
+    auto const header = read_at(file, offset, 12);
+    if (!header) {
+        return std::nullopt;
+    }
+
+    auto const table_count = std::size_t{u16(*header, 4)};
+    auto const records = read_at(file, offset + 12, table_count * 16);
+    if (!records) {
+        return std::nullopt;
+    }
+
+    for (std::size_t i = 0; i < table_count; ++i) {
+        auto const record = std::string_view{*records}.substr(i * 16, 16);
+        if (!record.starts_with("name")) {
+            continue;
+        }
+
+        // Offsets are from the start of the file, also in collections.
+        auto const length = std::size_t{u32(record, 12)};
+        if (length > kMaxNameTableSize) {
+            return std::nullopt;
+        }
+
+        auto const table = read_at(file, u32(record, 8), length);
+        if (!table) {
+            return std::nullopt;
+        }
+
+        return parse_name_table(*table);
+    }
+
+    return std::nullopt;
+}
+
+// https://learn.microsoft.com/en-us/typography/opentype/spec/otff#font-collections
+std::vector<FontFace> read_faces(fs::path const &path) {
+    std::ifstream file{path, std::ios::binary};
+    auto const header = read_at(file, 0, 12);
+    std::vector<std::uint32_t> offsets;
+    if (header && header->starts_with("ttcf")) {
+        auto const count = std::min(std::size_t{u32(*header, 8)}, kMaxFacesPerCollection);
+        if (auto const table = read_at(file, 12, count * 4)) {
+            for (std::size_t i = 0; i < count; ++i) {
+                offsets.push_back(u32(*table, i * 4));
+            }
+        }
+    } else if (header) {
+        auto const version = u32(*header, 0);
+        if (version == kTrueTypeVersion || version == kOtto || version == kTrue) {
+            offsets.push_back(0);
+        }
+    }
+
+    std::vector<FontFace> faces;
+    for (std::uint32_t i = 0; i < offsets.size(); ++i) {
+        if (auto names = read_face_names(file, offsets[i])) {
+            faces.push_back(FontFace{
+                    .path = path.string(),
+                    .index = i,
+                    .family = std::move(names->family),
+                    .style = std::move(names->style),
+            });
+        }
+    }
+
+    // Anything we couldn't read can still be found by its file name, as the
+    // libraries actually loading the fonts may know what to do w/ it.
+    if (faces.empty()) {
+        faces.push_back(FontFace{.path = path.string()});
+    }
+
+    return faces;
+}
+
+struct IndexedFile {
+    std::uintmax_t size{};
+    std::int64_t modified{};
+    std::vector<FontFace> faces;
+};
+
+// One face per line, w/ tab-separated fields.
+std::unordered_map<std::string, IndexedFile> read_cache(fs::path const &cache_file) {
+    std::ifstream file{cache_file};
+    std::string line;
+    if (!std::getline(file, line) || line != kCacheHeader) {
+        return {};
+    }
+
+    auto const parse_int = [](std::string_view s, auto &out) {
+        return std::from_chars(s.data(), s.data() + s.size(), out).ec == std::errc{};
+    };
+
+    std::unordered_map<std::string, IndexedFile> files;
+    while (std::getline(file, line)) {
+        auto const fields = util::split(line, "\t");
+        IndexedFile indexed;
+        FontFace face;
+        if (fields.size() != 6 || !parse_int(fields[0], indexed.size) || !parse_int(fields[1], indexed.modified)
+                || !parse_int(fields[2], face.index)) {
+            return {};
+        }
+
+        face.family = fields[3];
+        face.style = fields[4];
+        face.path = fields[5];
+        auto &entry = files.try_emplace(face.path, std::move(indexed)).first->second;
+        entry.faces.push_back(std::move(face));
+    }
+
+    return files;
+}
+
+void write_cache(fs::path const &cache_file, std::map<std::string, IndexedFile> const &files) {
+    std::error_code ec;
+    fs::create_directories(cache_file.parent_path(), ec);
+
+    // Written next to the cache and moved into place, so that a process
+    // reading the cache never sees half of it.
+    auto tmp = cache_file;
+    tmp += ".tmp";
+    {
+        std::ofstream file{tmp, std::ios::trunc};
+        file << kCacheHeader << '\n';
+        for (auto const &[path, indexed] : files) {
+            for (auto const &face : indexed.faces) {
+                auto const bad_char = [](char c) { return c == '\t' || c == '\n' || c == '\r'; };
+                if (std::ranges::any_of(face.path, bad_char) || std::ranges::any_of(face.family, bad_char)
+                        || std::ranges::any_of(face.style, bad_char)) {
+                    continue;
+                }
+
+                file << indexed.size << '\t' << indexed.modified << '\t' << face.index << '\t' << face.family << '\t'
+                     << face.style << '\t' << face.path << '\n';
+            }
+        }
+
+        if (!file) {
+            fs::remove(tmp, ec);
+            return;
+        }
+    }
+
+    fs::rename(tmp, cache_file, ec);
+}
+
+// Lower is better.
+std::size_t style_rank(FontFace const &face) {
+    auto const style = util::lowercased(face.style);
+    if (style == "regular" || style == "book" || style == "normal" || style == "roman") {
+        return 0;
+    }
+
+    return 1 + style.size();
+}
+
+struct GenericFamily {
+    std::string_view name;
+    std::span<std::string_view const> preferred;
+    // Picks a family from its lowercased name if none of the preferred ones
+    // are installed. If nothing fits, any family will do.
+    bool (*fits)(std::string_view family);
+};
+
+constexpr auto kPreferredSansSerif = std::to_array<std::string_view>({
+        "liberation sans",
+        "dejavu sans",
+        "arial",
+        "helvetica",
+        "noto sans",
+});
+
+constexpr auto kPreferredSerif = std::to_array<std::string_view>({
+        "liberation serif",
+        "dejavu serif",
+        "times new roman",
+        "times",
+        "noto serif",
+});
+
+constexpr auto kPreferredMonospace = std::to_array<std::string_view>({
+        "liberation mono",
+        "dejavu sans mono",
+        "consolas",
+        "courier new",
+        "menlo",
+        "noto sans mono",
+});
+
+// sans-serif comes first, as the others fall back to it.
+constexpr auto kGenericFamilies = std::to_array<GenericFamily>({
+        {"sans-serif",
+                kPreferredSansSerif,
+                [](std::string_view f) { return f.contains("sans") && !f.contains("mono"); }},
+        {"serif", kPreferredSerif, [](std::string_view f) { return f.contains("serif") && !f.contains("sans"); }},
+        {"monospace", kPreferredMonospace, [](std::string_view f) { return f.contains("mono"); }},
+});
+
+} // namespace
+
+FontIndex::FontIndex(std::vector<FontFace> faces) : faces_{std::move(faces)} {
+    // Families go first so that they aren't shadowed by file names.
+    for (std::size_t i = 0; i < faces_.size(); ++i) {
+        auto const &face = faces_[i];
+        if (face.family.empty()) {
+            continue;
+        }
+
+        auto [it, inserted] = by_name_.try_emplace(util::lowercased(face.family), i);
+        if (!inserted && style_rank(face) < style_rank(faces_[it->second])) {
+            it->second = i;
+        }
+    }
+
+    for (std::size_t i = 0; i < faces_.size(); ++i) {
+        fs::path const path{faces_[i].path};
+        by_name_.try_emplace(util::lowercased(path.filename().string()), i);
+        by_name_.try_emplace(util::lowercased(path.stem().string()), i);
+    }
+
+    // The alphabetically first family that fits, so that the result doesn't
+    // depend on where the fonts are.
+    auto const first_family = [this](auto const &fits) -> std::optional<std::size_t> {
+        std::optional<std::string> found;
+        for (auto const &face : faces_) {
+            auto family = util::lowercased(face.family);
+            if (!family.empty() && fits(family) && (!found || family < *found)) {
+                found = std::move(family);
+            }
+        }
+
+        if (!found) {
+            return std::nullopt;
+        }
+
+        return by_name_.at(*found);
+    };
+
+    std::optional<std::size_t> sans_serif;
+    for (auto const &generic : kGenericFamilies) {
+        std::optional<std::size_t> found;
+        for (auto family : generic.preferred) {
+            if (auto it = by_name_.find(std::string{family}); it != by_name_.end()) {
+                found = it->second;
+                break;
+            }
+        }
+
+        if (!found) {
+            found = first_family(generic.fits);
+        }
+
+        if (!found) {
+            found = sans_serif ? sans_serif : first_family([](std::string_view) { return true; });
+        }
+
+        if (generic.name == "sans-serif") {
+            sans_serif = found;
+        }
+
+        if (found) {
+            by_name_.insert_or_assign(std::string{generic.name}, *found);
+        }
+    }
+}
+
+FontIndex FontIndex::scan(std::span<std::string const> directories, std::optional<fs::path> const &cache_file) {
+    auto cached = cache_file ? read_cache(*cache_file) : std::unordered_map<std::string, IndexedFile>{};
+    bool changed = false;
+
+    // Sorted, so that the index doesn't depend on the order the file system
+    // lists files in.
+    std::map<std::string, IndexedFile> files;
+    for (auto const &directory : directories) {
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(directory, fs::directory_options::skip_permission_denied, ec);
+                !ec && it != fs::recursive_directory_iterator();
+                it.increment(ec)) {
+            std::error_code entry_ec;
+            if (!it->is_regular_file(entry_ec) || !has_font_extension(it->path())
+                    || files.contains(it->path().string())) {
+                continue;
+            }
+
+            auto const size = it->file_size(entry_ec);
+            auto const modified = static_cast<std::int64_t>(it->last_write_time(entry_ec).time_since_epoch().count());
+            if (entry_ec) {
+                continue;
+            }
+
+            auto path = it->path().string();
+            if (auto c = cached.find(path); c != cached.end() && c->second.size == size
+                    && c->second.modified == modified) {
+                files.emplace(std::move(path), std::move(c->second));
+                cached.erase(c);
+                continue;
+            }
+
+            changed = true;
+            files.emplace(std::move(path), IndexedFile{size, modified, read_faces(it->path())});
+        }
+    }
+
+    // Anything left in the cache has been removed since it was written.
+    if (cache_file && (changed || !cached.empty())) {
+        write_cache(*cache_file, files);
+    }
+
+    std::vector<FontFace> faces;
+    for (auto &[path, indexed] : files) {
+        std::ranges::move(indexed.faces, std::back_inserter(faces));
+    }
+
+    return FontIndex{std::move(faces)};
+}
+
+FontIndex const &FontIndex::system() {
+    static FontIndex const kIndex = [] {
+        std::optional<fs::path> cache_file;
+        if (auto cache = os::cache_path()) {
+            cache_file = fs::path{*cache} / "hastur" / "font_index";
+        }
+
+        return scan(os::font_paths(), cache_file);
+    }();
+    return kIndex;
+}
+
+FontFace const *FontIndex::find(std::string_view name) const {
+    if (auto it = by_name_.find(util::lowercased(std::string{name})); it != by_name_.end()) {
+        return &faces_[it->second];
+    }
+
+    return nullptr;
+}
+
+} // namespace type
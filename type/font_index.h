@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef TYPE_FONT_INDEX_H_
+#define TYPE_FONT_INDEX_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace type {
+
+struct FontFace {
+    std::string path;
+    // Which of the faces in a font collection this is.
+    std::uint32_t index{};
+    // Empty for files we couldn't read the names from, which are only found by
+    // their file names.
+    std::string family;
+    std::string style;
+    [[nodiscard]] bool operator==(FontFace const &) const = default;
+};
+
+// An index of the fonts in some directories, for looking fonts up w/o going
+// through the file system every time.
+class FontIndex {
+public:
+    // Scans the directories for fonts. If there's a cache file, fonts that
+    // haven't changed since it was written are taken from it instead of being
+    // read again, and it's updated if anything has changed.
+    static FontIndex scan(std::span<std::string const> directories,
+            std::optional<std::filesystem::path> const &cache_file = std::nullopt);
+
+    // The system's fonts, scanned the first time this is called, and cached
+    // between runs in the user's cache directory.
+    static FontIndex const &system();
+
+    // Finds a font by its family name, file name, file name w/o extension, or
+    // by the generic families serif, sans-serif, and monospace, ignoring case.
+    // Family names find the family's regular face if there is one. Generic
+    // families always find the same font for the same set of fonts.
+    FontFace const *find(std::string_view name) const;
+
+    std::span<FontFace const> faces() const { return faces_; }
+
+private:
+    explicit FontIndex(std::vector<FontFace>);
+
+    std::vector<FontFace> faces_;
+    std::unordered_map<std::string, std::size_t> by_name_;
+};
+
+} // namespace type
+
+#endif
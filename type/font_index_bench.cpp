@@ -0,0 +1,69 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "type/font_index.h"
+
+#include "os/xdg.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+template<typename F>
+double time_ms(F &&f) {
+    auto const start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::milli> const duration = std::chrono::steady_clock::now() - start;
+    return duration.count();
+}
+
+} // namespace
+
+// Measures building the index of the system's fonts w/ and w/o a cache, and
+// looking fonts up in it.
+int main(int argc, char **argv) {
+    int const iterations = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+
+    auto const directories = os::font_paths();
+    auto const cache = fs::temp_directory_path() / "hastur-font-index-bench";
+    std::error_code ec;
+    fs::remove(cache, ec);
+
+    std::size_t faces{};
+    auto const cold = time_ms([&] { faces = type::FontIndex::scan(directories, cache).faces().size(); });
+    auto const cached = time_ms([&] { type::FontIndex::scan(directories, cache); });
+    auto const uncached = time_ms([&] { type::FontIndex::scan(directories); });
+    fs::remove(cache, ec);
+
+    std::cout << faces << " faces\n";
+    std::cout << "scan w/o cache: " << uncached << " ms\n";
+    std::cout << "scan writing cache: " << cold << " ms\n";
+    std::cout << "scan w/ cache: " << cached << " ms\n";
+
+    auto const index = type::FontIndex::scan(directories);
+    static constexpr auto kNames = std::to_array<std::string_view>({
+            "sans-serif",
+            "DejaVu Sans",
+            "LiberationMono-Regular.ttf",
+            "monospace",
+            "this font does not exist",
+    });
+
+    std::size_t found{};
+    auto const lookups = time_ms([&] {
+        for (int i = 0; i < iterations; ++i) {
+            found += index.find(kNames[static_cast<std::size_t>(i) % kNames.size()]) != nullptr ? 1 : 0;
+        }
+    });
+    std::cout << "lookup: " << lookups * 1'000'000. / iterations << " ns (" << found << " found)\n";
+}
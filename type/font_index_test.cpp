@@ -0,0 +1,251 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "type/font_index.h"
+
+#include "etest/etest2.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+using type::FontFace;
+using type::FontIndex;
+
+namespace {
+
+class TmpDir {
+public:
+    TmpDir() : path_{fs::temp_directory_path() / ("hastur-font-index-test." + std::to_string(std::random_device{}()))} {
+        fs::create_directories(path_);
+    }
+
+    ~TmpDir() {
+        std::error_code ec;
+        fs::remove_all(path_, ec);
+    }
+
+    TmpDir(TmpDir const &) = delete;
+    TmpDir &operator=(TmpDir const &) = delete;
+
+    fs::path const &path() const { return path_; }
+
+    std::string write(std::string const &name, std::string const &data) const {
+        auto const path = path_ / name;
+        fs::create_directories(path.parent_path());
+        std::ofstream{path, std::ios::binary} << data;
+        return path.string();
+    }
+
+private:
+    fs::path path_;
+};
+
+void append_u16(std::string &out, std::uint16_t v) {
+    out += static_cast<char>(v >> 8);
+    out += static_cast<char>(v & 0xFF);
+}
+
+void append_u32(std::string &out, std::uint32_t v) {
+    append_u16(out, static_cast<std::uint16_t>(v >> 16));
+    append_u16(out, static_cast<std::uint16_t>(v & 0xFFFF));
+}
+
+// A 'name' table w/ English names for Windows, which is all the index reads.
+std::string name_table(std::vector<std::pair<std::uint16_t, std::string>> const &names) {
+    std::string records;
+    std::string storage;
+    for (auto const &[id, value] : names) {
+        append_u16(records, 3);
+        append_u16(records, 1);
+        append_u16(records, 0x409);
+        append_u16(records, id);
+        append_u16(records, static_cast<std::uint16_t>(value.size() * 2));
+        append_u16(records, static_cast<std::uint16_t>(storage.size()));
+        for (char c : value) {
+            append_u16(storage, static_cast<unsigned char>(c));
+        }
+    }
+
+    std::string table;
+    append_u16(table, 0);
+    append_u16(table, static_cast<std::uint16_t>(names.size()));
+    append_u16(table, static_cast<std::uint16_t>(6 + records.size()));
+    return table + records + storage;
+}
+
+// A font w/ only a name table, placed at offset in its file.
+std::string face(std::vector<std::pair<std::uint16_t, std::string>> const &names, std::size_t offset = 0) {
+    auto const table = name_table(names);
+    std::string out;
+    append_u32(out, 0x0001'0000);
+    append_u16(out, 1);
+    append_u16(out, 16);
+    append_u16(out, 0);
+    append_u16(out, 0);
+    out += "name";
+    append_u32(out, 0);
+    append_u32(out, static_cast<std::uint32_t>(offset + 12 + 16));
+    append_u32(out, static_cast<std::uint32_t>(table.size()));
+    return out + table;
+}
+
+std::string face(std::string const &family, std::string const &style, std::size_t offset = 0) {
+    return face({{1, family}, {2, style}}, offset);
+}
+
+std::string collection(std::string const &family_a, std::string const &family_b) {
+    std::string out = "ttcf";
+    append_u32(out, 0x0001'0000);
+    append_u32(out, 2);
+    auto const first = face(family_a, "Regular", 20);
+    append_u32(out, 20);
+    append_u32(out, static_cast<std::uint32_t>(20 + first.size()));
+    return out + first + face(family_b, "Regular", 20 + first.size());
+}
+
+FontIndex scan(TmpDir const &dir) {
+    auto const dirs = std::vector{dir.path().string()};
+    return FontIndex::scan(dirs);
+}
+
+} // namespace
+
+int main() {
+    etest::Suite s{"type/font_index"};
+
+    s.add_test("families are found ignoring case", [](etest::IActions &a) {
+        TmpDir dir;
+        auto const path = dir.write("a.ttf", face("Hastur Sans", "Regular"));
+
+        auto const index = scan(dir);
+        a.require(index.find("hAsTuR sAnS") != nullptr);
+        a.expect_eq(*index.find("hastur sans"), FontFace{path, 0, "Hastur Sans", "Regular"});
+        a.expect_eq(index.find("hastur"), nullptr);
+    });
+
+    s.add_test("typographic names are preferred", [](etest::IActions &a) {
+        TmpDir dir;
+        dir.write("a.otf", face({{1, "Hastur Light"}, {2, "Regular"}, {16, "Hastur"}, {17, "Light"}}));
+
+        auto const index = scan(dir);
+        a.require(index.find("hastur") != nullptr);
+        a.expect_eq(index.find("hastur")->style, "Light");
+    });
+
+    s.add_test("the regular face of a family is preferred", [](etest::IActions &a) {
+        TmpDir dir;
+        dir.write("a.ttf", face("Hastur", "Bold Italic"));
+        dir.write("b.ttf", face("Hastur", "Bold"));
+        dir.write("c.ttf", face("Hastur", "Regular"));
+
+        auto const index = scan(dir);
+        a.require(index.find("hastur") != nullptr);
+        a.expect_eq(index.find("hastur")->style, "Regular");
+        a.expect_eq(index.faces().size(), std::size_t{3});
+    });
+
+    s.add_test("file names", [](etest::IActions &a) {
+        TmpDir dir;
+        auto const path = dir.write("sub/Hastur-Bold.ttf", face("Hastur", "Bold"));
+        auto const unreadable = dir.write("Broken.ttf", "not a font");
+        dir.write("fonts.dir", "1\nHastur-Bold.ttf -misc-hastur-bold-r-normal--0-0-0-0-p-0-iso10646-1\n");
+        dir.write("sub/.uuid", "8f4b35f0-0000-0000-0000-000000000000");
+
+        auto const index = scan(dir);
+        a.require(index.find("hastur-bold.ttf") != nullptr);
+        a.expect_eq(index.find("HASTUR-BOLD.TTF")->path, path);
+        a.expect_eq(index.find("Hastur-Bold")->path, path);
+        a.require(index.find("broken.ttf") != nullptr);
+        a.expect_eq(*index.find("broken"), FontFace{.path = unreadable});
+
+        // Non-font files in font directories aren't indexed.
+        a.expect_eq(index.faces().size(), std::size_t{2});
+        a.expect_eq(index.find("fonts.dir"), nullptr);
+        a.expect_eq(index.find(".uuid"), nullptr);
+    });
+
+    s.add_test("collections", [](etest::IActions &a) {
+        TmpDir dir;
+        auto const path = dir.write("a.ttc", collection("Hastur Sans", "Hastur Serif"));
+
+        auto const index = scan(dir);
+        a.expect_eq(index.faces().size(), std::size_t{2});
+        a.expect_eq(index.find("hastur sans"), &index.faces()[0]);
+        a.require(index.find("hastur serif") != nullptr);
+        a.expect_eq(*index.find("hastur serif"), FontFace{path, 1, "Hastur Serif", "Regular"});
+    });
+
+    s.add_test("generic families", [](etest::IActions &a) {
+        TmpDir dir;
+        dir.write("a.ttf", face("Zz Sans", "Regular"));
+        dir.write("b.ttf", face("Aa Sans", "Regular"));
+        dir.write("c.ttf", face("Aa Sans Mono", "Regular"));
+        dir.write("d.ttf", face("Aa Serif", "Regular"));
+
+        auto const index = scan(dir);
+        a.require(index.find("sans-serif") != nullptr);
+        a.expect_eq(index.find("sans-serif")->family, "Aa Sans");
+        a.require(index.find("serif") != nullptr);
+        a.expect_eq(index.find("serif")->family, "Aa Serif");
+        a.require(index.find("monospace") != nullptr);
+        a.expect_eq(index.find("monospace")->family, "Aa Sans Mono");
+
+        // Well-known fonts are preferred over anything else.
+        dir.write("e.ttf", face("DejaVu Sans", "Book"));
+        a.expect_eq(scan(dir).find("sans-serif")->family, "DejaVu Sans");
+    });
+
+    s.add_test("generic families fall back to sans-serif", [](etest::IActions &a) {
+        TmpDir dir;
+        dir.write("a.ttf", face("Hastur", "Regular"));
+
+        auto const index = scan(dir);
+        a.expect_eq(index.find("sans-serif"), index.find("hastur"));
+        a.expect_eq(index.find("serif"), index.find("hastur"));
+        a.expect_eq(index.find("monospace"), index.find("hastur"));
+    });
+
+    s.add_test("no fonts", [](etest::IActions &a) {
+        TmpDir dir;
+        auto const index = scan(dir);
+        a.expect(index.faces().empty());
+        a.expect_eq(index.find("sans-serif"), nullptr);
+    });
+
+    s.add_test("cache", [](etest::IActions &a) {
+        TmpDir dir;
+        auto const path = dir.write("fonts/a.ttf", face("Hastur", "Regular"));
+        auto const dirs = std::vector{(dir.path() / "fonts").string()};
+        auto const cache = dir.path() / "cache" / "font_index";
+
+        auto const index = FontIndex::scan(dirs, cache);
+        a.require(fs::exists(cache));
+        a.expect_eq(FontIndex::scan(dirs, cache).faces()[0], index.faces()[0]);
+
+        // Unchanged files are taken from the cache w/o being read.
+        auto const size = fs::file_size(path);
+        auto const modified = fs::last_write_time(path).time_since_epoch().count();
+        auto const entry = std::to_string(size) + '\t' + std::to_string(modified) + "\t0\tCached\tBold\t" + path;
+        std::ofstream{cache} << "hastur-font-index 1\n" << entry << '\n';
+        a.expect_eq(FontIndex::scan(dirs, cache).faces()[0], FontFace{path, 0, "Cached", "Bold"});
+
+        // Changed ones aren't.
+        std::ofstream{cache} << "hastur-font-index 1\n" << std::to_string(size + 1) << entry.substr(entry.find('\t'));
+        a.expect_eq(FontIndex::scan(dirs, cache).faces()[0], index.faces()[0]);
+
+        // And broken caches are ignored.
+        std::ofstream{cache} << "hastur-font-index 1\nnonsense\n";
+        a.expect_eq(FontIndex::scan(dirs, cache).faces()[0], index.faces()[0]);
+    });
+
+    return s.run();
+}
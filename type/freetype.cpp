@@ -0,0 +1,233 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "type/freetype.h"
+
+#include "type/font_index.h"
+#include "type/type.h"
+
+#include "unicode/util.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_SYNTHESIS_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace type {
+namespace {
+
+// Creating and destroying faces isn't safe to do from several threads at once
+// w/ the same library, so that's guarded by the library's mutex. The library
+// is shared w/ the fonts, as they may outlive the type they came from.
+struct Library {
+    Library() {
+        if (FT_Init_FreeType(&library) != 0) {
+            library = nullptr;
+        }
+    }
+
+    ~Library() {
+        if (library != nullptr) {
+            FT_Done_FreeType(library);
+        }
+    }
+
+    Library(Library const &) = delete;
+    Library &operator=(Library const &) = delete;
+
+    FT_Library library{nullptr};
+    std::mutex mtx;
+};
+
+struct Glyph {
+    FT_UInt index{};
+    int advance{};
+};
+
+// Everything measured so far for one size and weight. Latin-1 is looked up
+// in a flat table, as that's what most text is made of.
+struct Metrics {
+    int height{};
+    std::array<std::optional<Glyph>, 256> latin1{};
+    std::unordered_map<char32_t, Glyph> others;
+    std::unordered_map<std::uint64_t, int> kerning;
+};
+
+// The length of the UTF-8 sequence starting w/ this byte. Invalid bytes are
+// treated as a sequence of their own.
+std::size_t utf8_sequence_length(unsigned char lead) {
+    if (lead >= 0xF0) {
+        return 4;
+    }
+    if (lead >= 0xE0) {
+        return 3;
+    }
+    if (lead >= 0xC0) {
+        return 2;
+    }
+    return 1;
+}
+
+} // namespace
+
+struct FreeTypeFont::Impl {
+    Impl(std::shared_ptr<Library> lib, FT_Face f) : library{std::move(lib)}, face{f} {}
+
+    ~Impl() {
+        std::scoped_lock lock{library->mtx};
+        FT_Done_Face(face);
+    }
+
+    Impl(Impl const &) = delete;
+    Impl &operator=(Impl const &) = delete;
+
+    Metrics &metrics_for(Px font_size, Weight weight) {
+        auto [it, inserted] = metrics.try_emplace(std::pair{font_size.v, weight});
+        if (inserted) {
+            set_size(font_size);
+            auto const &size_metrics = face->size->metrics;
+            it->second.height = static_cast<int>((size_metrics.ascender - size_metrics.descender) >> 6);
+        }
+
+        return it->second;
+    }
+
+    Glyph const &glyph(Metrics &m, char32_t codepoint, Px font_size, Weight weight) {
+        if (codepoint < m.latin1.size()) {
+            auto &cached = m.latin1[codepoint];
+            if (!cached) {
+                cached = load_glyph(codepoint, font_size, weight);
+            }
+            return *cached;
+        }
+
+        if (auto it = m.others.find(codepoint); it != m.others.end()) {
+            return it->second;
+        }
+
+        return m.others.emplace(codepoint, load_glyph(codepoint, font_size, weight)).first->second;
+    }
+
+    int kerning(Metrics &m, FT_UInt left, FT_UInt right, Px font_size) {
+        if (!FT_HAS_KERNING(face) || left == 0 || right == 0) {
+            return 0;
+        }
+
+        auto const key = std::uint64_t{left} << 32 | right;
+        if (auto it = m.kerning.find(key); it != m.kerning.end()) {
+            return it->second;
+        }
+
+        set_size(font_size);
+        FT_Vector delta{};
+        if (FT_Get_Kerning(face, left, right, FT_KERNING_DEFAULT, &delta) != 0) {
+            delta.x = 0;
+        }
+
+        return m.kerning.emplace(key, static_cast<int>(delta.x >> 6)).first->second;
+    }
+
+    // The advance is measured like the FreeType glyph rasterizer renders it,
+    // w/ bold being synthesized, so that measured text matches drawn text.
+    Glyph load_glyph(char32_t codepoint, Px font_size, Weight weight) {
+        set_size(font_size);
+        auto const index = FT_Get_Char_Index(face, codepoint);
+        if (FT_Load_Glyph(face, index, FT_LOAD_DEFAULT) != 0) {
+            return Glyph{.index = index};
+        }
+
+        if (weight == Weight::Bold) {
+            FT_GlyphSlot_Embolden(face->glyph);
+        }
+
+        return Glyph{.index = index, .advance = static_cast<int>(face->glyph->advance.x >> 6)};
+    }
+
+    void set_size(Px font_size) {
+        if (current_size != font_size.v) {
+            FT_Set_Pixel_Sizes(face, 0, static_cast<FT_UInt>(std::max(font_size.v, 1)));
+            current_size = font_size.v;
+        }
+    }
+
+    std::shared_ptr<Library> library;
+    FT_Face face{nullptr};
+    int current_size{-1};
+
+    std::mutex mtx;
+    std::map<std::pair<int, Weight>, Metrics> metrics;
+};
+
+FreeTypeFont::FreeTypeFont(std::unique_ptr<Impl> impl) : impl_{std::move(impl)} {}
+FreeTypeFont::~FreeTypeFont() = default;
+
+Size FreeTypeFont::measure(std::string_view text, Px font_size, Weight weight) const {
+    std::scoped_lock lock{impl_->mtx};
+    auto &metrics = impl_->metrics_for(font_size, weight);
+
+    int width = 0;
+    FT_UInt previous = 0;
+    for (std::size_t i = 0; i < text.size();) {
+        char32_t codepoint = static_cast<unsigned char>(text[i]);
+        if (codepoint < 0x80) {
+            ++i;
+        } else {
+            auto const length = std::min(utf8_sequence_length(static_cast<unsigned char>(text[i])), text.size() - i);
+            codepoint = unicode::utf8_to_utf32(text.substr(i, length));
+            i += length;
+        }
+
+        auto const &glyph = impl_->glyph(metrics, codepoint, font_size, weight);
+        width += impl_->kerning(metrics, previous, glyph.index, font_size) + glyph.advance;
+        previous = glyph.index;
+    }
+
+    return Size{width, metrics.height};
+}
+
+struct FreeTypeType::Impl {
+    std::shared_ptr<Library> library{std::make_shared<Library>()};
+
+    // Fonts that couldn't be found are cached as std::nullopt.
+    std::mutex mtx;
+    std::map<std::string, std::optional<std::shared_ptr<FreeTypeFont const>>, std::less<>> fonts;
+};
+
+FreeTypeType::FreeTypeType() : impl_{std::make_unique<Impl>()} {}
+FreeTypeType::~FreeTypeType() = default;
+
+std::optional<std::shared_ptr<IFont const>> FreeTypeType::font(std::string_view name) const {
+    std::scoped_lock lock{impl_->mtx};
+    if (auto it = impl_->fonts.find(name); it != impl_->fonts.end()) {
+        return it->second;
+    }
+
+    auto const &library = impl_->library;
+    std::optional<std::shared_ptr<FreeTypeFont const>> font;
+    if (auto const *found = FontIndex::system().find(name); found != nullptr && library->library != nullptr) {
+        std::unique_lock library_lock{library->mtx};
+        FT_Face face = nullptr;
+        if (FT_New_Face(library->library, found->path.c_str(), found->index, &face) == 0) {
+            library_lock.unlock();
+            font = std::make_shared<FreeTypeFont const>(std::make_unique<FreeTypeFont::Impl>(library, face));
+        }
+    }
+
+    return impl_->fonts.emplace(std::string{name}, std::move(font)).first->second;
+}
+
+} // namespace type
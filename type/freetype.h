@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef TYPE_FREETYPE_H_
+#define TYPE_FREETYPE_H_
+
+#include "type/type.h"
+
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace type {
+
+// Measures text w/ FreeType, so it works w/o a window or SFML. Glyph advances
+// and kerning are looked up once per font, size, and weight, and cached, so
+// measuring text that's been seen before is a table walk. Both classes are
+// safe to use from several threads at once.
+class FreeTypeFont final : public IFont {
+public:
+    struct Impl;
+    explicit FreeTypeFont(std::unique_ptr<Impl>);
+    ~FreeTypeFont() override;
+
+    FreeTypeFont(FreeTypeFont const &) = delete;
+    FreeTypeFont &operator=(FreeTypeFont const &) = delete;
+
+    // Text is as wide as the sum of its glyphs' advances and the kerning
+    // between them, and as tall as the font's ascender to its descender.
+    Size measure(std::string_view text, Px font_size, Weight) const override;
+
+private:
+    std::unique_ptr<Impl> impl_;
+};
+
+// Looks fonts up in the system's font index, like SfmlType.
+class FreeTypeType final : public IType {
+public:
+    FreeTypeType();
+    ~FreeTypeType() override;
+
+    FreeTypeType(FreeTypeType const &) = delete;
+    FreeTypeType &operator=(FreeTypeType const &) = delete;
+
+    std::optional<std::shared_ptr<IFont const>> font(std::string_view name) const override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace type
+
+#endif
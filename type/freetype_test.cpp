@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "type/freetype.h"
+
+#include "type/type.h"
+
+#include "etest/etest2.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using type::Px;
+using type::Weight;
+
+namespace {
+
+// Whether the system has any fonts at all depends on where the tests run, so
+// the tests needing one don't check anything if this one can't be found.
+constexpr auto kFont = "DejaVuSans.ttf";
+
+} // namespace
+
+int main() {
+    etest::Suite s{"type/freetype"};
+
+    s.add_test("missing fonts are cached", [](etest::IActions &a) {
+        type::FreeTypeType type;
+        a.expect(!type.font("this font doesn't exist.ttf").has_value());
+        a.expect(!type.font("this font doesn't exist.ttf").has_value());
+    });
+
+    s.add_test("fonts are cached", [](etest::IActions &a) {
+        type::FreeTypeType type;
+        auto font = type.font(kFont);
+        if (!font) {
+            return;
+        }
+
+        a.expect_eq(font->get(), type.font(kFont)->get());
+    });
+
+    s.add_test("measure", [](etest::IActions &a) {
+        type::FreeTypeType type;
+        auto font = type.font(kFont);
+        if (!font) {
+            return;
+        }
+
+        auto const &f = **font;
+        auto const a10 = f.measure("a", Px{10}, Weight::Normal);
+        a.expect(a10.width > 0);
+        a.expect(a10.height >= 10);
+        a.expect_eq(f.measure("", Px{10}, Weight::Normal), type::Size{0, a10.height});
+
+        // Measuring the same thing again comes from the cache, and agrees.
+        a.expect_eq(f.measure("a", Px{10}, Weight::Normal), a10);
+        a.expect_eq(f.measure("aaa", Px{10}, Weight::Normal).width, a10.width * 3);
+
+        // Larger and bolder text is wider.
+        auto const hello = f.measure("hello", Px{10}, Weight::Normal);
+        a.expect(f.measure("hello", Px{40}, Weight::Normal).width > hello.width);
+        a.expect(f.measure("hello", Px{40}, Weight::Normal).height > hello.height);
+        a.expect(f.measure("hello", Px{10}, Weight::Bold).width >= hello.width);
+
+        // Non-breaking spaces are as wide as spaces.
+        auto const nbsp = std::string{"a\xc2\xa0"} + "b";
+        a.expect_eq(f.measure(nbsp, Px{16}, Weight::Normal), f.measure("a b", Px{16}, Weight::Normal));
+
+        // Non-Latin-1 text and broken UTF-8 are measured too.
+        a.expect(f.measure("\xe2\x82\xac", Px{16}, Weight::Normal).width > 0);
+        a.expect(f.measure("\xe2\x82", Px{16}, Weight::Normal).width >= 0);
+    });
+
+    s.add_test("kerning", [](etest::IActions &a) {
+        type::FreeTypeType type;
+        auto font = type.font(kFont);
+        if (!font) {
+            return;
+        }
+
+        // Kerning only applies between glyphs, so a pair can be narrower than
+        // its glyphs measured one by one.
+        auto const &f = **font;
+        auto const a_width = f.measure("A", Px{32}, Weight::Normal).width;
+        auto const v_width = f.measure("V", Px{32}, Weight::Normal).width;
+        a.expect(f.measure("AV", Px{32}, Weight::Normal).width <= a_width + v_width);
+    });
+
+    s.add_test("threads", [](etest::IActions &a) {
+        type::FreeTypeType type;
+        auto font = type.font(kFont);
+        if (!font) {
+            return;
+        }
+
+        auto const expected = (*font)->measure("The quick brown fox", Px{12}, Weight::Normal);
+        std::vector<type::Size> sizes(4);
+        {
+            std::vector<std::jthread> threads;
+            for (std::size_t i = 0; i < sizes.size(); ++i) {
+                threads.emplace_back([&, i] {
+                    for (int size = 8; size < 24; ++size) {
+                        static_cast<void>(type.font(kFont).value()->measure("jumps over", Px{size}, Weight::Bold));
+                    }
+                    sizes[i] = type.font(kFont).value()->measure("The quick brown fox", Px{12}, Weight::Normal);
+                });
+            }
+        }
+
+        for (auto const &size : sizes) {
+            a.expect_eq(size, expected);
+        }
+    });
+
+    return s.run();
+}
@@ -0,0 +1,166 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "util/crc32.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define UTIL_CRC32_X86
+#define UTIL_CRC32_TARGET __attribute__((target("pclmul,sse2")))
+#include <immintrin.h>
+#endif
+
+namespace util {
+namespace {
+
+// Table n holds the CRC of a byte followed by n zero bytes, which lets us look
+// up 16 bytes at a time, all independent of each other.
+// See: https://create.stephan-brumme.com/crc32/#slicing-by-16-overview
+constexpr auto kSlicingTables = [] {
+    std::array<std::array<std::uint32_t, 256>, 16> t{};
+    t[0] = detail::kCrc32Table;
+    for (std::size_t i = 0; i < 256; ++i) {
+        for (std::size_t n = 1; n < t.size(); ++n) {
+            auto const prev = t[n - 1][i];
+            t[n][i] = (prev >> 8) ^ t[0][prev & 0xFF];
+        }
+    }
+    return t;
+}();
+
+// The CRC register w/o the pre- and post-inversions crc32_extend deals with.
+std::uint32_t bytewise(std::uint32_t crc, std::byte const *data, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = detail::kCrc32Table[(crc ^ static_cast<std::uint8_t>(data[i])) & 0xFF] ^ crc >> 8;
+    }
+    return crc;
+}
+
+std::uint32_t load_le32(std::byte const *data) {
+    std::uint32_t v{};
+    std::memcpy(&v, data, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big) {
+        v = std::byteswap(v);
+    }
+    return v;
+}
+
+std::uint32_t slicing16(std::uint32_t crc, std::byte const *data, std::size_t size) {
+    auto const &t = kSlicingTables;
+    for (; size >= 16; size -= 16, data += 16) {
+        auto const a = load_le32(data) ^ crc;
+        auto const b = load_le32(data + 4);
+        auto const c = load_le32(data + 8);
+        auto const d = load_le32(data + 12);
+        crc = t[15][a & 0xFF] ^ t[14][(a >> 8) & 0xFF] ^ t[13][(a >> 16) & 0xFF] ^ t[12][a >> 24] //
+                ^ t[11][b & 0xFF] ^ t[10][(b >> 8) & 0xFF] ^ t[9][(b >> 16) & 0xFF] ^ t[8][b >> 24] //
+                ^ t[7][c & 0xFF] ^ t[6][(c >> 8) & 0xFF] ^ t[5][(c >> 16) & 0xFF] ^ t[4][c >> 24] //
+                ^ t[3][d & 0xFF] ^ t[2][(d >> 8) & 0xFF] ^ t[1][(d >> 16) & 0xFF] ^ t[0][d >> 24];
+    }
+    return bytewise(crc, data, size);
+}
+
+#ifdef UTIL_CRC32_X86
+UTIL_CRC32_TARGET __m128i load(std::byte const *p) {
+    return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+}
+
+// Multiplies the high and low halves of x by the constants in k and adds both
+// products to next.
+UTIL_CRC32_TARGET __m128i fold(__m128i x, __m128i k, __m128i next) {
+    auto const lo = _mm_clmulepi64_si128(x, k, 0x00);
+    auto const hi = _mm_clmulepi64_si128(x, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+}
+
+// Folds 64 bytes at a time into 4 128-bit accumulators w/ carry-less
+// multiplication, and then reduces those down to 32 bits, as described in
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+// by Gopal et al. The constants are x^n mod P for the bit-reflected polynomial.
+UTIL_CRC32_TARGET std::uint32_t pclmul(std::uint32_t crc, std::byte const *data, std::size_t size) {
+    if (size < 64) {
+        return slicing16(crc, data, size);
+    }
+
+    auto x1 = _mm_xor_si128(load(data), _mm_cvtsi32_si128(static_cast<int>(crc)));
+    auto x2 = load(data + 16);
+    auto x3 = load(data + 32);
+    auto x4 = load(data + 48);
+    data += 64;
+    size -= 64;
+
+    auto const k1k2 = _mm_set_epi64x(0x1'c6e4'1596, 0x1'5444'2bd4);
+    for (; size >= 64; size -= 64, data += 64) {
+        x1 = fold(x1, k1k2, load(data));
+        x2 = fold(x2, k1k2, load(data + 16));
+        x3 = fold(x3, k1k2, load(data + 32));
+        x4 = fold(x4, k1k2, load(data + 48));
+    }
+
+    auto const k3k4 = _mm_set_epi64x(0x0'ccaa'009e, 0x1'7519'97d0);
+    x1 = fold(x1, k3k4, x2);
+    x1 = fold(x1, k3k4, x3);
+    x1 = fold(x1, k3k4, x4);
+    for (; size >= 16; size -= 16, data += 16) {
+        x1 = fold(x1, k3k4, load(data));
+    }
+
+    // 128 bits to 64.
+    auto const mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), _mm_clmulepi64_si128(x1, k3k4, 0x10));
+    auto const k5 = _mm_set_epi64x(0, 0x1'63cd'6124);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5, 0x00), _mm_srli_si128(x1, 4));
+
+    // Barrett reduction to 32 bits.
+    auto const poly = _mm_set_epi64x(0x1'f701'1641, 0x1'db71'0641);
+    auto r = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+    r = _mm_clmulepi64_si128(_mm_and_si128(r, mask32), poly, 0x00);
+    x1 = _mm_xor_si128(x1, r);
+    crc = static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(x1, 4)));
+
+    return slicing16(crc, data, size);
+}
+#endif
+
+} // namespace
+
+std::span<Crc32Kernels const> available_crc32_kernels() {
+    static auto const kAvailable = [] {
+        std::vector<Crc32Kernels> kernels{Crc32Kernels::Bytewise, Crc32Kernels::Slicing16};
+#ifdef UTIL_CRC32_X86
+        if (__builtin_cpu_supports("pclmul")) {
+            kernels.push_back(Crc32Kernels::Pclmul);
+        }
+#endif
+        return kernels;
+    }();
+    return kAvailable;
+}
+
+std::uint32_t crc32_extend(Crc32Kernels kernels, std::uint32_t crc, std::span<std::byte const> data) {
+    crc ^= 0xFFFF'FFFF;
+    switch (kernels) {
+#ifdef UTIL_CRC32_X86
+        case Crc32Kernels::Pclmul:
+            crc = pclmul(crc, data.data(), data.size());
+            break;
+#endif
+        case Crc32Kernels::Slicing16:
+            crc = slicing16(crc, data.data(), data.size());
+            break;
+        default:
+            crc = bytewise(crc, data.data(), data.size());
+            break;
+    }
+    return crc ^ 0xFFFF'FFFF;
+}
+
+} // namespace util
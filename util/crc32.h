@@ -1,4 +1,4 @@
-// SPDX-FileCopyrightText: 2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2023-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
@@ -12,34 +12,91 @@
 
 namespace util {
 
-// https://www.w3.org/TR/2022/WD-png-3-20221025/#5CRC-algorithm
-template<typename T, std::size_t U = std::dynamic_extent>
-requires(sizeof(T) == 1)
-constexpr std::uint32_t crc32(std::span<T const, U> data) {
-    constexpr auto kCrcTable = [] {
-        std::array<std::uint32_t, 256> t{};
-        constexpr std::uint32_t kPolynomial = 0xEDB8'8320;
+// The ways of calculating a CRC at runtime. They all produce the same CRCs, so
+// which one is used only affects the speed.
+enum class Crc32Kernels : std::uint8_t {
+    Bytewise,
+    Slicing16,
+    Pclmul,
+};
+
+// The kernels the CPU we're running on supports, w/ the fastest last. Calling
+// crc32_extend w/ anything else isn't allowed.
+std::span<Crc32Kernels const> available_crc32_kernels();
+
+inline Crc32Kernels best_crc32_kernels() {
+    return available_crc32_kernels().back();
+}
 
-        for (std::uint32_t i = 0; i < t.size(); ++i) {
-            std::uint32_t val = i;
+// Continues the CRC of some earlier data w/ more data, so that
+// crc32_extend(crc32(a), b) == crc32(a + b). The CRC of no data is 0.
+std::uint32_t crc32_extend(Crc32Kernels, std::uint32_t crc, std::span<std::byte const> data);
 
-            for (std::uint32_t j = 0; j < 8; ++j) {
-                val = val & 1 ? kPolynomial ^ (val >> 1) : val >> 1;
-            }
+inline std::uint32_t crc32_extend(std::uint32_t crc, std::span<std::byte const> data) {
+    return crc32_extend(best_crc32_kernels(), crc, data);
+}
+
+namespace detail {
+
+inline constexpr std::uint32_t kCrc32Polynomial = 0xEDB8'8320;
+
+inline constexpr auto kCrc32Table = [] {
+    std::array<std::uint32_t, 256> t{};
 
-            t[i] = val;
+    for (std::uint32_t i = 0; i < t.size(); ++i) {
+        std::uint32_t val = i;
+
+        for (std::uint32_t j = 0; j < 8; ++j) {
+            val = val & 1 ? kCrc32Polynomial ^ (val >> 1) : val >> 1;
         }
 
-        return t;
-    }();
+        t[i] = val;
+    }
+
+    return t;
+}();
 
-    std::uint32_t crc{0xFFFF'FFFF};
+template<typename T, std::size_t U>
+constexpr std::uint32_t crc32_extend_bytewise(std::uint32_t crc, std::span<T const, U> data) {
+    crc ^= 0xFFFF'FFFF;
     for (auto byte : data) {
-        crc = kCrcTable[(crc ^ byte) & 0xFF] ^ crc >> 8;
+        crc = kCrc32Table[(crc ^ static_cast<std::uint8_t>(byte)) & 0xFF] ^ crc >> 8;
     }
     return crc ^ 0xFFFF'FFFF;
 }
 
+} // namespace detail
+
+// https://www.w3.org/TR/2022/WD-png-3-20221025/#5CRC-algorithm
+template<typename T, std::size_t U = std::dynamic_extent>
+requires(sizeof(T) == 1)
+constexpr std::uint32_t crc32(std::span<T const, U> data) {
+    if consteval {
+        return detail::crc32_extend_bytewise(0, data);
+    } else {
+        return crc32_extend(0, std::as_bytes(data));
+    }
+}
+
+// For data that arrives in chunks, like a PNG chunk split across reads.
+class Crc32 {
+public:
+    template<typename T, std::size_t U = std::dynamic_extent>
+    requires(sizeof(T) == 1)
+    constexpr void update(std::span<T const, U> data) {
+        if consteval {
+            crc_ = detail::crc32_extend_bytewise(crc_, data);
+        } else {
+            crc_ = crc32_extend(crc_, std::as_bytes(data));
+        }
+    }
+
+    constexpr std::uint32_t value() const { return crc_; }
+
+private:
+    std::uint32_t crc_{};
+};
+
 } // namespace util
 
 #endif
@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "util/crc32.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <span>
+#include <vector>
+
+namespace {
+
+char const *name(util::Crc32Kernels kernels) {
+    switch (kernels) {
+        case util::Crc32Kernels::Bytewise:
+            return "bytewise";
+        case util::Crc32Kernels::Slicing16:
+            return "slicing-by-16";
+        case util::Crc32Kernels::Pclmul:
+            return "pclmul";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+// Measures the throughput of every CRC-32 kernel, in GB per second.
+int main(int argc, char **argv) {
+    int const iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    constexpr std::size_t kSize = 8 * 1024 * 1024;
+    std::vector<std::byte> data(kSize);
+    std::uint32_t noise = 1;
+    for (auto &b : data) {
+        noise = noise * 1664525 + 1013904223;
+        b = static_cast<std::byte>(noise >> 24);
+    }
+
+    for (auto kernels : util::available_crc32_kernels()) {
+        std::uint32_t crc{};
+        auto const start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            crc = util::crc32_extend(kernels, crc, data);
+        }
+        std::chrono::duration<double> const duration = std::chrono::steady_clock::now() - start;
+        auto const gb_per_s = static_cast<double>(kSize) * iterations / duration.count() / 1'000'000'000.;
+        std::cout << name(kernels) << ": " << gb_per_s << " GB/s (crc " << std::hex << crc << std::dec << ")\n";
+    }
+}
@@ -1,4 +1,4 @@
-// SPDX-FileCopyrightText: 2023 Robin Lindén <dev@robinlinden.eu>
+// SPDX-FileCopyrightText: 2023-2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
@@ -6,11 +6,30 @@
 
 #include "etest/etest.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <span>
 #include <string_view>
+#include <vector>
 
 using namespace std::literals;
+using etest::expect;
 using etest::expect_eq;
+using util::Crc32Kernels;
+
+namespace {
+
+std::vector<std::byte> noise(std::size_t size) {
+    std::vector<std::byte> bytes(size);
+    std::uint32_t state = 1;
+    for (auto &b : bytes) {
+        state = state * 1664525 + 1013904223;
+        b = static_cast<std::byte>(state >> 24);
+    }
+    return bytes;
+}
+
+} // namespace
 
 int main() {
     etest::test("no data", [] { expect_eq(util::crc32(std::span{""sv}), 0u); });
@@ -21,5 +40,65 @@ int main() {
         expect_eq(util::crc32(std::span{data}), 0x414fa339u);
     });
 
+    etest::test("constant evaluation", [] {
+        static_assert(util::crc32(std::span{"123456789"sv}) == 0xcbf43926u);
+        static_assert([] {
+            util::Crc32 crc;
+            crc.update(std::span{"12345"sv});
+            crc.update(std::span{"6789"sv});
+            return crc.value();
+        }() == 0xcbf43926u);
+    });
+
+    etest::test("bytewise kernels are always available", [] {
+        auto kernels = util::available_crc32_kernels();
+        etest::require(!kernels.empty());
+        expect_eq(kernels.front(), Crc32Kernels::Bytewise);
+    });
+
+    etest::test("all kernels agree", [] {
+        // The faster kernels handle 16 or 64 bytes at a time and leave the rest
+        // to the slower ones, so every length and alignment up to a few of
+        // those is checked.
+        auto const data = noise(1000);
+        for (auto kernels : util::available_crc32_kernels()) {
+            for (std::size_t offset = 0; offset < 16; ++offset) {
+                for (std::size_t length = 0; offset + length <= 300; ++length) {
+                    auto const chunk = std::span{data}.subspan(offset, length);
+                    expect_eq(util::crc32_extend(kernels, 0, chunk),
+                            util::crc32_extend(Crc32Kernels::Bytewise, 0, chunk));
+                }
+            }
+
+            expect_eq(util::crc32_extend(kernels, 0, data), util::crc32_extend(Crc32Kernels::Bytewise, 0, data));
+        }
+    });
+
+    etest::test("extend", [] {
+        auto const data = noise(500);
+        auto const expected = util::crc32(std::span{data});
+        for (auto kernels : util::available_crc32_kernels()) {
+            for (std::size_t split = 0; split <= data.size(); split += 7) {
+                auto const first = util::crc32_extend(kernels, 0, std::span{data}.first(split));
+                expect_eq(util::crc32_extend(kernels, first, std::span{data}.subspan(split)), expected);
+            }
+        }
+    });
+
+    etest::test("streaming", [] {
+        auto const data = noise(10'000);
+        util::Crc32 crc;
+        expect_eq(crc.value(), 0u);
+
+        std::size_t pos = 0;
+        for (std::size_t chunk = 1; pos < data.size(); chunk = chunk * 3 + 1) {
+            auto const size = std::min(chunk, data.size() - pos);
+            crc.update(std::span{data}.subspan(pos, size));
+            pos += size;
+        }
+
+        expect_eq(crc.value(), util::crc32(std::span{data}));
+    });
+
     return etest::run_all_tests();
 }
@@ -321,6 +321,14 @@ constexpr std::string percent_decode_unreserved(std::string_view input) {
     return output;
 }
 
+// Resizes the string w/o initializing any new characters, for when they're
+// about to be overwritten anyway, like when decompressing into it.
+constexpr void resize_uninitialized(std::string &s, std::size_t size) {
+    // Some versions of libstdc++ pass the new capacity rather than the
+    // requested size to the operation, so the size is returned explicitly.
+    s.resize_and_overwrite(size, [size](char *, std::size_t) { return size; });
+}
+
 } // namespace util
 
 #endif
@@ -9,6 +9,7 @@
 
 #include <array>
 #include <climits>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <limits>
@@ -338,5 +339,22 @@ int main() {
         expect_eq(percent_decode_unreserved(foo6), "%7F");
     });
 
+    etest::test("resize_uninitialized", [] {
+        std::string str{"hello"};
+        resize_uninitialized(str, 100);
+        expect_eq(str.size(), std::size_t{100});
+        expect(str.starts_with("hello"));
+
+        str.replace(5, 95, 95, '!');
+        resize_uninitialized(str, 6);
+        expect_eq(str, "hello!");
+
+        // Growing past the capacity.
+        auto const size = str.capacity() + 10;
+        resize_uninitialized(str, size);
+        expect_eq(str.size(), size);
+        expect(str.starts_with("hello!"));
+    });
+
     return etest::run_all_tests();
 }
@@ -13,15 +13,21 @@
 #include <tl/expected.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iomanip>
+#include <ios>
 #include <iostream>
 #include <istream>
+#include <iterator>
 #include <optional>
-#include <sstream>
+#include <span>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -36,21 +42,56 @@ constexpr std::size_t kMaxSequenceSize = UINT16_MAX;
 constexpr int kMagicSize = 4;
 constexpr int kVersionSize = 4;
 
-template<typename T>
-std::optional<std::vector<T>> parse_vector(std::istream &);
-template<typename T>
-std::optional<std::vector<T>> parse_vector(std::istream &&);
+// Reads from a span w/ the parts of std::istream's interface the parser needs,
+// but w/o a stream's per-read overhead, and w/o copying anything when asked for
+// a span of what's left.
+class Reader {
+public:
+    explicit Reader(std::span<std::byte const> bytes) : bytes_{bytes} {}
+
+    Reader &read(char *out, std::size_t n) {
+        if (failed_ || n > bytes_.size() - pos_) {
+            failed_ = true;
+            return *this;
+        }
+
+        std::memcpy(out, bytes_.data() + pos_, n);
+        pos_ += n;
+        return *this;
+    }
+
+    std::optional<std::span<std::byte const>> take(std::size_t n) {
+        if (failed_ || n > bytes_.size() - pos_) {
+            failed_ = true;
+            return std::nullopt;
+        }
+
+        auto taken = bytes_.subspan(pos_, n);
+        pos_ += n;
+        return taken;
+    }
+
+    std::size_t tellg() const { return pos_; }
+    bool at_end() const { return pos_ == bytes_.size(); }
+    explicit operator bool() const { return !failed_; }
+
+private:
+    std::span<std::byte const> bytes_;
+    std::size_t pos_{};
+    bool failed_{};
+};
+
+std::optional<std::vector<instructions::Instruction>> parse_instructions(Reader &);
 
 template<typename T>
-std::optional<T> parse(std::istream &) = delete;
+std::optional<std::vector<T>> parse_vector(Reader &);
+
 template<typename T>
-std::optional<T> parse(std::istream &&is) {
-    return parse<T>(is);
-}
+std::optional<T> parse(Reader &) = delete;
 
 // https://webassembly.github.io/spec/core/binary/values.html#names
 template<>
-std::optional<std::string> parse(std::istream &is) {
+std::optional<std::string> parse(Reader &is) {
     auto length = Leb128<std::uint32_t>::decode_from(is);
     if (!length || *length > kMaxSequenceSize) {
         return std::nullopt;
@@ -67,13 +108,13 @@ std::optional<std::string> parse(std::istream &is) {
 }
 
 template<>
-std::optional<std::uint32_t> parse(std::istream &is) {
+std::optional<std::uint32_t> parse(Reader &is) {
     auto v = Leb128<std::uint32_t>::decode_from(is);
     return v ? std::optional{*v} : std::nullopt;
 }
 
 template<>
-std::optional<std::byte> parse(std::istream &is) {
+std::optional<std::byte> parse(Reader &is) {
     std::byte b{};
     if (!is.read(reinterpret_cast<char *>(&b), sizeof(b))) {
         return std::nullopt;
@@ -83,7 +124,7 @@ std::optional<std::byte> parse(std::istream &is) {
 
 // https://webassembly.github.io/spec/core/binary/types.html
 template<>
-std::optional<ValueType> parse(std::istream &is) {
+std::optional<ValueType> parse(Reader &is) {
     std::uint8_t byte{};
     if (!is.read(reinterpret_cast<char *>(&byte), sizeof(byte))) {
         return std::nullopt;
@@ -110,7 +151,7 @@ std::optional<ValueType> parse(std::istream &is) {
 }
 
 template<>
-std::optional<Limits> parse(std::istream &is) {
+std::optional<Limits> parse(Reader &is) {
     std::uint8_t has_max{};
     if (!is.read(reinterpret_cast<char *>(&has_max), sizeof(has_max)) || has_max > 1) {
         return std::nullopt;
@@ -134,7 +175,7 @@ std::optional<Limits> parse(std::istream &is) {
 }
 
 template<>
-std::optional<GlobalType> parse(std::istream &is) {
+std::optional<GlobalType> parse(Reader &is) {
     auto valtype = parse<ValueType>(is);
     if (!valtype) {
         return std::nullopt;
@@ -152,13 +193,13 @@ std::optional<GlobalType> parse(std::istream &is) {
 }
 
 template<>
-std::optional<Global> parse(std::istream &is) {
+std::optional<Global> parse(Reader &is) {
     auto type = parse<GlobalType>(is);
     if (!type) {
         return std::nullopt;
     }
 
-    auto init = ByteCodeParser::parse_instructions(is);
+    auto init = parse_instructions(is);
     if (!init) {
         return std::nullopt;
     }
@@ -171,7 +212,7 @@ std::optional<Global> parse(std::istream &is) {
 
 // https://webassembly.github.io/spec/core/binary/types.html#function-types
 template<>
-std::optional<FunctionType> parse(std::istream &is) {
+std::optional<FunctionType> parse(Reader &is) {
     std::uint8_t magic{};
     if (!is.read(reinterpret_cast<char *>(&magic), sizeof(magic)) || magic != 0x60) {
         return std::nullopt;
@@ -194,7 +235,7 @@ std::optional<FunctionType> parse(std::istream &is) {
 }
 
 template<>
-std::optional<TableType> parse(std::istream &is) {
+std::optional<TableType> parse(Reader &is) {
     auto element_type = parse<ValueType>(is);
     if (!element_type || (element_type != ValueType::FunctionReference && element_type != ValueType::ExternReference)) {
         return std::nullopt;
@@ -210,7 +251,7 @@ std::optional<TableType> parse(std::istream &is) {
 
 // https://webassembly.github.io/spec/core/binary/modules.html#binary-exportsec
 template<>
-std::optional<Export> parse(std::istream &is) {
+std::optional<Export> parse(Reader &is) {
     auto name = parse<std::string>(is);
     if (!name) {
         return std::nullopt;
@@ -235,7 +276,7 @@ std::optional<Export> parse(std::istream &is) {
 
 // https://webassembly.github.io/spec/core/binary/modules.html#binary-codesec
 template<>
-std::optional<CodeEntry::Local> parse(std::istream &is) {
+std::optional<CodeEntry::Local> parse(Reader &is) {
     auto count = Leb128<std::uint32_t>::decode_from(is);
     if (!count) {
         return std::nullopt;
@@ -254,7 +295,7 @@ std::optional<CodeEntry::Local> parse(std::istream &is) {
 
 // https://webassembly.github.io/spec/core/binary/modules.html#binary-codesec
 template<>
-std::optional<CodeEntry> parse(std::istream &is) {
+std::optional<CodeEntry> parse(Reader &is) {
     auto size = Leb128<std::uint32_t>::decode_from(is);
     if (!size) {
         return std::nullopt;
@@ -265,7 +306,7 @@ std::optional<CodeEntry> parse(std::istream &is) {
         return std::nullopt;
     }
 
-    auto instructions = ByteCodeParser::parse_instructions(is);
+    auto instructions = parse_instructions(is);
     if (!instructions) {
         return std::nullopt;
     }
@@ -278,7 +319,7 @@ std::optional<CodeEntry> parse(std::istream &is) {
 
 // https://webassembly.github.io/spec/core/binary/modules.html#binary-codesec
 template<>
-std::optional<DataSection::Data> parse(std::istream &is) {
+std::optional<DataSection::Data> parse(Reader &is) {
     auto type = Leb128<std::uint32_t>::decode_from(is);
     if (!type) {
         return std::nullopt;
@@ -301,7 +342,7 @@ std::optional<DataSection::Data> parse(std::istream &is) {
 
 // https://webassembly.github.io/spec/core/binary/modules.html#binary-import
 template<>
-std::optional<Import> parse(std::istream &is) {
+std::optional<Import> parse(Reader &is) {
     auto module = parse<std::string>(is);
     if (!module) {
         return std::nullopt;
@@ -347,7 +388,7 @@ std::optional<Import> parse(std::istream &is) {
 }
 
 template<>
-std::optional<instructions::BlockType> parse(std::istream &is) {
+std::optional<instructions::BlockType> parse(Reader &is) {
     using namespace instructions;
     std::uint8_t type{};
     if (!is.read(reinterpret_cast<char *>(&type), sizeof(type))) {
@@ -359,8 +400,9 @@ std::optional<instructions::BlockType> parse(std::istream &is) {
         return BlockType{{BlockType::Empty{}}};
     }
 
-    std::stringstream ss{std::string{static_cast<char>(type)}};
-    auto value_type = parse<ValueType>(ss);
+    std::array const type_bytes{std::byte{type}};
+    Reader value_type_reader{type_bytes};
+    auto value_type = parse<ValueType>(value_type_reader);
     if (value_type) {
         return BlockType{{*std::move(value_type)}};
     }
@@ -370,7 +412,7 @@ std::optional<instructions::BlockType> parse(std::istream &is) {
 }
 
 template<>
-std::optional<instructions::MemArg> parse(std::istream &is) {
+std::optional<instructions::MemArg> parse(Reader &is) {
     using namespace instructions;
     auto a = wasm::Leb128<std::uint32_t>::decode_from(is);
     if (!a) {
@@ -387,7 +429,7 @@ std::optional<instructions::MemArg> parse(std::istream &is) {
 
 // https://webassembly.github.io/spec/core/binary/conventions.html#vectors
 template<typename T>
-std::optional<std::vector<T>> parse_vector(std::istream &is) {
+std::optional<std::vector<T>> parse_vector(Reader &is) {
     auto item_count = Leb128<std::uint32_t>::decode_from(is);
     if (!item_count || *item_count > kMaxSequenceSize) {
         return std::nullopt;
@@ -407,12 +449,7 @@ std::optional<std::vector<T>> parse_vector(std::istream &is) {
     return items;
 }
 
-template<typename T>
-std::optional<std::vector<T>> parse_vector(std::istream &&is) {
-    return parse_vector<T>(is);
-}
-
-std::optional<TypeSection> parse_type_section(std::istream &is) {
+std::optional<TypeSection> parse_type_section(Reader &is) {
     if (auto maybe_types = parse_vector<FunctionType>(is)) {
         return TypeSection{.types = *std::move(maybe_types)};
     }
@@ -420,7 +457,7 @@ std::optional<TypeSection> parse_type_section(std::istream &is) {
     return std::nullopt;
 }
 
-std::optional<ImportSection> parse_import_section(std::istream &is) {
+std::optional<ImportSection> parse_import_section(Reader &is) {
     if (auto maybe_imports = parse_vector<Import>(is)) {
         return ImportSection{.imports = *std::move(maybe_imports)};
     }
@@ -428,7 +465,7 @@ std::optional<ImportSection> parse_import_section(std::istream &is) {
     return std::nullopt;
 }
 
-std::optional<FunctionSection> parse_function_section(std::istream &is) {
+std::optional<FunctionSection> parse_function_section(Reader &is) {
     if (auto maybe_type_indices = parse_vector<TypeIdx>(is)) {
         return FunctionSection{.type_indices = *std::move(maybe_type_indices)};
     }
@@ -436,7 +473,7 @@ std::optional<FunctionSection> parse_function_section(std::istream &is) {
     return std::nullopt;
 }
 
-std::optional<TableSection> parse_table_section(std::istream &is) {
+std::optional<TableSection> parse_table_section(Reader &is) {
     if (auto maybe_tables = parse_vector<TableType>(is)) {
         return TableSection{*std::move(maybe_tables)};
     }
@@ -444,7 +481,7 @@ std::optional<TableSection> parse_table_section(std::istream &is) {
     return std::nullopt;
 }
 
-std::optional<MemorySection> parse_memory_section(std::istream &is) {
+std::optional<MemorySection> parse_memory_section(Reader &is) {
     if (auto maybe_memories = parse_vector<MemType>(is)) {
         return MemorySection{*std::move(maybe_memories)};
     }
@@ -452,7 +489,7 @@ std::optional<MemorySection> parse_memory_section(std::istream &is) {
     return std::nullopt;
 }
 
-std::optional<GlobalSection> parse_global_section(std::istream &is) {
+std::optional<GlobalSection> parse_global_section(Reader &is) {
     if (auto maybe_globals = parse_vector<Global>(is)) {
         return GlobalSection{*std::move(maybe_globals)};
     }
@@ -460,7 +497,7 @@ std::optional<GlobalSection> parse_global_section(std::istream &is) {
     return std::nullopt;
 }
 
-std::optional<ExportSection> parse_export_section(std::istream &is) {
+std::optional<ExportSection> parse_export_section(Reader &is) {
     if (auto maybe_exports = parse_vector<Export>(is)) {
         return ExportSection{.exports = std::move(maybe_exports).value()};
     }
@@ -468,7 +505,7 @@ std::optional<ExportSection> parse_export_section(std::istream &is) {
     return std::nullopt;
 }
 
-std::optional<StartSection> parse_start_section(std::istream &is) {
+std::optional<StartSection> parse_start_section(Reader &is) {
     if (auto maybe_start = parse<FuncIdx>(is)) {
         return StartSection{.start = *maybe_start};
     }
@@ -476,7 +513,7 @@ std::optional<StartSection> parse_start_section(std::istream &is) {
     return std::nullopt;
 }
 
-std::optional<CodeSection> parse_code_section(std::istream &is) {
+std::optional<CodeSection> parse_code_section(Reader &is) {
     if (auto code_entries = parse_vector<CodeEntry>(is)) {
         return CodeSection{.entries = *std::move(code_entries)};
     }
@@ -484,7 +521,7 @@ std::optional<CodeSection> parse_code_section(std::istream &is) {
     return std::nullopt;
 }
 
-std::optional<DataSection> parse_data_section(std::istream &is) {
+std::optional<DataSection> parse_data_section(Reader &is) {
     if (auto data_entries = parse_vector<DataSection::Data>(is)) {
         return DataSection{.data = *std::move(data_entries)};
     }
@@ -492,177 +529,8 @@ std::optional<DataSection> parse_data_section(std::istream &is) {
     return std::nullopt;
 }
 
-} // namespace
-
-tl::expected<Module, ModuleParseError> ByteCodeParser::parse_module(std::istream &is) {
-    // https://webassembly.github.io/spec/core/binary/modules.html#sections
-    enum class SectionId : std::uint8_t {
-        Custom = 0,
-        Type = 1,
-        Import = 2,
-        Function = 3,
-        Table = 4,
-        Memory = 5,
-        Global = 6,
-        Export = 7,
-        Start = 8,
-        Element = 9,
-        Code = 10,
-        Data = 11,
-        DataCount = 12,
-    };
-
-    std::string buf;
-
-    // https://webassembly.github.io/spec/core/binary/modules.html#binary-magic
-    buf.resize(kMagicSize);
-    is.read(buf.data(), buf.size());
-    if (!is || buf != "\0asm"sv) {
-        return tl::unexpected{ModuleParseError::InvalidMagic};
-    }
-
-    // https://webassembly.github.io/spec/core/binary/modules.html#binary-version
-    buf.resize(kVersionSize);
-    is.read(buf.data(), buf.size());
-    if (!is || buf != "\1\0\0\0"sv) {
-        return tl::unexpected{ModuleParseError::UnsupportedVersion};
-    }
-
-    Module module;
-
-    // https://webassembly.github.io/spec/core/binary/modules.html#sections
-    while (true) {
-        std::uint8_t id_byte{};
-        is.read(reinterpret_cast<char *>(&id_byte), sizeof(id_byte));
-        if (!is) {
-            // We've read 0 or more complete modules, so we're done.
-            break;
-        }
-
-        if (id_byte < static_cast<int>(SectionId::Custom) || id_byte > static_cast<int>(SectionId::DataCount)) {
-            return tl::unexpected{ModuleParseError::InvalidSectionId};
-        }
-
-        auto size = Leb128<std::uint32_t>::decode_from(is);
-        if (!size) {
-            if (size.error() == Leb128ParseError::UnexpectedEof) {
-                return tl::unexpected{ModuleParseError::UnexpectedEof};
-            }
-            return tl::unexpected{ModuleParseError::InvalidSize};
-        }
-
-        auto id = static_cast<SectionId>(id_byte);
-        switch (id) {
-            case SectionId::Custom: {
-                auto before = static_cast<std::int64_t>(is.tellg());
-                auto name = parse<std::string>(is);
-                if (!name) {
-                    return tl::unexpected{ModuleParseError::InvalidCustomSection};
-                }
-
-                auto consumed_by_name = static_cast<int64_t>(is.tellg()) - before;
-                auto remaining_size = static_cast<int64_t>(*size) - consumed_by_name;
-                if (remaining_size < 0 || remaining_size > std::int64_t{kMaxSequenceSize}) {
-                    return tl::unexpected{ModuleParseError::InvalidCustomSection};
-                }
-
-                std::vector<std::uint8_t> data;
-                data.resize(remaining_size);
-                if (!is.read(reinterpret_cast<char *>(data.data()), data.size())) {
-                    return tl::unexpected{ModuleParseError::InvalidCustomSection};
-                }
-
-                module.custom_sections.push_back(CustomSection{
-                        .name = *std::move(name),
-                        .data = std::move(data),
-                });
-                break;
-            }
-            case SectionId::Type:
-                module.type_section = parse_type_section(is);
-                if (!module.type_section) {
-                    return tl::unexpected{ModuleParseError::InvalidTypeSection};
-                }
-                break;
-            case SectionId::Import:
-                module.import_section = parse_import_section(is);
-                if (!module.import_section) {
-                    return tl::unexpected{ModuleParseError::InvalidImportSection};
-                }
-                break;
-            case SectionId::Function:
-                module.function_section = parse_function_section(is);
-                if (!module.function_section) {
-                    return tl::unexpected{ModuleParseError::InvalidFunctionSection};
-                }
-                break;
-            case SectionId::Table:
-                module.table_section = parse_table_section(is);
-                if (!module.table_section) {
-                    return tl::unexpected{ModuleParseError::InvalidTableSection};
-                }
-                break;
-            case SectionId::Memory:
-                module.memory_section = parse_memory_section(is);
-                if (!module.memory_section) {
-                    return tl::unexpected{ModuleParseError::InvalidMemorySection};
-                }
-                break;
-            case SectionId::Global:
-                module.global_section = parse_global_section(is);
-                if (!module.global_section) {
-                    return tl::unexpected{ModuleParseError::InvalidGlobalSection};
-                }
-                break;
-            case SectionId::Export:
-                module.export_section = parse_export_section(is);
-                if (!module.export_section) {
-                    return tl::unexpected{ModuleParseError::InvalidExportSection};
-                }
-                break;
-            case SectionId::Start:
-                module.start_section = parse_start_section(is);
-                if (!module.start_section) {
-                    return tl::unexpected{ModuleParseError::InvalidStartSection};
-                }
-                break;
-            case SectionId::Code:
-                module.code_section = parse_code_section(is);
-                if (!module.code_section) {
-                    return tl::unexpected{ModuleParseError::InvalidCodeSection};
-                }
-                break;
-            case SectionId::Data:
-                module.data_section = parse_data_section(is);
-                if (!module.data_section) {
-                    return tl::unexpected{ModuleParseError::InvalidDataSection};
-                }
-                break;
-            case SectionId::DataCount: {
-                auto count = Leb128<std::uint32_t>::decode_from(is);
-                if (!count) {
-                    return tl::unexpected{ModuleParseError::InvalidDataCountSection};
-                }
-
-                module.data_count_section = DataCountSection{
-                        .count = *count,
-                };
-                break;
-            }
-            default:
-                std::cerr << "Unhandled section: " << static_cast<int>(id) << '\n';
-                // Uncomment if you want to skip past unhandled sections for e.g. debugging.
-                // is.seekg(*size, std::ios::cur);
-                // break;
-                return tl::unexpected{ModuleParseError::UnhandledSection};
-        }
-    }
-
-    return module;
-}
-
 // NOLINTNEXTLINE(misc-no-recursion)
-std::optional<std::vector<instructions::Instruction>> ByteCodeParser::parse_instructions(std::istream &is) {
+std::optional<std::vector<instructions::Instruction>> parse_instructions(Reader &is) {
     using namespace instructions;
     std::vector<Instruction> instructions{};
 
@@ -720,6 +588,14 @@ std::optional<std::vector<instructions::Instruction>> ByteCodeParser::parse_inst
             case Return::kOpcode:
                 instructions.emplace_back(Return{});
                 break;
+            case Call::kOpcode: {
+                auto value = wasm::Leb128<std::uint32_t>::decode_from(is);
+                if (!value) {
+                    return std::nullopt;
+                }
+                instructions.emplace_back(Call{*value});
+                break;
+            }
             case End::kOpcode:
                 return instructions;
             case I32Const::kOpcode: {
@@ -874,6 +750,15 @@ std::optional<std::vector<instructions::Instruction>> ByteCodeParser::parse_inst
                 instructions.emplace_back(I32Load{*std::move(arg)});
                 break;
             }
+            case I32Store::kOpcode: {
+                auto arg = parse<MemArg>(is);
+                if (!arg) {
+                    return std::nullopt;
+                }
+
+                instructions.emplace_back(I32Store{*std::move(arg)});
+                break;
+            }
             default:
                 std::cerr << "Unhandled opcode 0x" << std::setw(2) << std::setfill('0') << std::hex << +opcode << '\n';
                 return std::nullopt;
@@ -881,4 +766,442 @@ std::optional<std::vector<instructions::Instruction>> ByteCodeParser::parse_inst
     }
 }
 
+// https://webassembly.github.io/spec/core/binary/modules.html#sections
+enum class SectionId : std::uint8_t {
+    Custom = 0,
+    Type = 1,
+    Import = 2,
+    Function = 3,
+    Table = 4,
+    Memory = 5,
+    Global = 6,
+    Export = 7,
+    Start = 8,
+    Element = 9,
+    Code = 10,
+    Data = 11,
+    DataCount = 12,
+};
+
+// https://webassembly.github.io/spec/core/binary/modules.html#binary-magic
+// https://webassembly.github.io/spec/core/binary/modules.html#binary-version
+std::optional<ModuleParseError> parse_header(Reader &is) {
+    std::string buf;
+    buf.resize(kMagicSize);
+    is.read(buf.data(), buf.size());
+    if (!is || buf != "\0asm"sv) {
+        return ModuleParseError::InvalidMagic;
+    }
+
+    buf.resize(kVersionSize);
+    is.read(buf.data(), buf.size());
+    if (!is || buf != "\1\0\0\0"sv) {
+        return ModuleParseError::UnsupportedVersion;
+    }
+
+    return std::nullopt;
+}
+
+tl::expected<SectionId, ModuleParseError> parse_section_id(Reader &is) {
+    std::uint8_t id_byte{};
+    is.read(reinterpret_cast<char *>(&id_byte), sizeof(id_byte));
+    if (id_byte < static_cast<int>(SectionId::Custom) || id_byte > static_cast<int>(SectionId::DataCount)) {
+        return tl::unexpected{ModuleParseError::InvalidSectionId};
+    }
+
+    return static_cast<SectionId>(id_byte);
+}
+
+tl::expected<std::uint32_t, ModuleParseError> parse_section_size(Reader &is) {
+    auto size = Leb128<std::uint32_t>::decode_from(is);
+    if (!size) {
+        if (size.error() == Leb128ParseError::UnexpectedEof) {
+            return tl::unexpected{ModuleParseError::UnexpectedEof};
+        }
+        return tl::unexpected{ModuleParseError::InvalidSize};
+    }
+
+    return *size;
+}
+
+// Parses the sections that are decoded the same way by both the eager and the
+// lazy parser.
+std::optional<ModuleParseError> parse_section(SectionId id, Reader &is, Module &module) {
+    switch (id) {
+        case SectionId::Type:
+            module.type_section = parse_type_section(is);
+            if (!module.type_section) {
+                return ModuleParseError::InvalidTypeSection;
+            }
+            break;
+        case SectionId::Import:
+            module.import_section = parse_import_section(is);
+            if (!module.import_section) {
+                return ModuleParseError::InvalidImportSection;
+            }
+            break;
+        case SectionId::Function:
+            module.function_section = parse_function_section(is);
+            if (!module.function_section) {
+                return ModuleParseError::InvalidFunctionSection;
+            }
+            break;
+        case SectionId::Table:
+            module.table_section = parse_table_section(is);
+            if (!module.table_section) {
+                return ModuleParseError::InvalidTableSection;
+            }
+            break;
+        case SectionId::Memory:
+            module.memory_section = parse_memory_section(is);
+            if (!module.memory_section) {
+                return ModuleParseError::InvalidMemorySection;
+            }
+            break;
+        case SectionId::Global:
+            module.global_section = parse_global_section(is);
+            if (!module.global_section) {
+                return ModuleParseError::InvalidGlobalSection;
+            }
+            break;
+        case SectionId::Export:
+            module.export_section = parse_export_section(is);
+            if (!module.export_section) {
+                return ModuleParseError::InvalidExportSection;
+            }
+            break;
+        case SectionId::Start:
+            module.start_section = parse_start_section(is);
+            if (!module.start_section) {
+                return ModuleParseError::InvalidStartSection;
+            }
+            break;
+        case SectionId::Code:
+            module.code_section = parse_code_section(is);
+            if (!module.code_section) {
+                return ModuleParseError::InvalidCodeSection;
+            }
+            break;
+        case SectionId::Data:
+            module.data_section = parse_data_section(is);
+            if (!module.data_section) {
+                return ModuleParseError::InvalidDataSection;
+            }
+            break;
+        case SectionId::DataCount: {
+            auto count = Leb128<std::uint32_t>::decode_from(is);
+            if (!count) {
+                return ModuleParseError::InvalidDataCountSection;
+            }
+
+            module.data_count_section = DataCountSection{
+                    .count = *count,
+            };
+            break;
+        }
+        default:
+            std::cerr << "Unhandled section: " << static_cast<int>(id) << '\n';
+            return ModuleParseError::UnhandledSection;
+    }
+
+    return std::nullopt;
+}
+
+constexpr ModuleParseError section_error(SectionId id) {
+    switch (id) {
+        case SectionId::Custom:
+            return ModuleParseError::InvalidCustomSection;
+        case SectionId::Type:
+            return ModuleParseError::InvalidTypeSection;
+        case SectionId::Import:
+            return ModuleParseError::InvalidImportSection;
+        case SectionId::Function:
+            return ModuleParseError::InvalidFunctionSection;
+        case SectionId::Table:
+            return ModuleParseError::InvalidTableSection;
+        case SectionId::Memory:
+            return ModuleParseError::InvalidMemorySection;
+        case SectionId::Global:
+            return ModuleParseError::InvalidGlobalSection;
+        case SectionId::Export:
+            return ModuleParseError::InvalidExportSection;
+        case SectionId::Start:
+            return ModuleParseError::InvalidStartSection;
+        case SectionId::Code:
+            return ModuleParseError::InvalidCodeSection;
+        case SectionId::Data:
+            return ModuleParseError::InvalidDataSection;
+        case SectionId::DataCount:
+            return ModuleParseError::InvalidDataCountSection;
+        case SectionId::Element:
+            break;
+    }
+    return ModuleParseError::UnhandledSection;
+}
+
+// https://webassembly.github.io/spec/core/binary/values.html#names
+// Like parse<std::string>, but pointing into the module.
+std::optional<std::string_view> parse_name_view(Reader &is) {
+    auto length = Leb128<std::uint32_t>::decode_from(is);
+    if (!length) {
+        return std::nullopt;
+    }
+
+    auto bytes = is.take(*length);
+    if (!bytes || std::ranges::any_of(*bytes, [](std::byte b) { return b > std::byte{0x7f}; })) {
+        return std::nullopt;
+    }
+
+    return std::string_view{reinterpret_cast<char const *>(bytes->data()), bytes->size()};
+}
+
+// Splits the code section into function bodies w/o decoding them.
+std::optional<std::vector<std::span<std::byte const>>> parse_function_bodies(Reader &is) {
+    auto count = Leb128<std::uint32_t>::decode_from(is);
+    if (!count) {
+        return std::nullopt;
+    }
+
+    std::vector<std::span<std::byte const>> bodies;
+    for (std::uint32_t i = 0; i < *count; ++i) {
+        auto size = Leb128<std::uint32_t>::decode_from(is);
+        if (!size) {
+            return std::nullopt;
+        }
+
+        auto body = is.take(*size);
+        if (!body) {
+            return std::nullopt;
+        }
+
+        bodies.push_back(*body);
+    }
+
+    return bodies;
+}
+
+} // namespace
+
+tl::expected<Module, ModuleParseError> ByteCodeParser::parse_module(std::istream &is) {
+    std::string const bytes{std::istreambuf_iterator<char>{is}, {}};
+    return parse_module(std::as_bytes(std::span{bytes}));
+}
+
+tl::expected<Module, ModuleParseError> ByteCodeParser::parse_module(std::span<std::byte const> bytes) {
+    Reader is{bytes};
+    if (auto error = parse_header(is)) {
+        return tl::unexpected{*error};
+    }
+
+    Module module;
+
+    // https://webassembly.github.io/spec/core/binary/modules.html#sections
+    while (!is.at_end()) {
+        auto id = parse_section_id(is);
+        if (!id) {
+            return tl::unexpected{id.error()};
+        }
+
+        auto size = parse_section_size(is);
+        if (!size) {
+            return tl::unexpected{size.error()};
+        }
+
+        if (*id != SectionId::Custom) {
+            if (auto error = parse_section(*id, is, module)) {
+                return tl::unexpected{*error};
+            }
+            continue;
+        }
+
+        auto before = static_cast<std::int64_t>(is.tellg());
+        auto name = parse<std::string>(is);
+        if (!name) {
+            return tl::unexpected{ModuleParseError::InvalidCustomSection};
+        }
+
+        auto consumed_by_name = static_cast<int64_t>(is.tellg()) - before;
+        auto remaining_size = static_cast<int64_t>(*size) - consumed_by_name;
+        if (remaining_size < 0 || remaining_size > std::int64_t{kMaxSequenceSize}) {
+            return tl::unexpected{ModuleParseError::InvalidCustomSection};
+        }
+
+        std::vector<std::uint8_t> data;
+        data.resize(remaining_size);
+        if (!is.read(reinterpret_cast<char *>(data.data()), data.size())) {
+            return tl::unexpected{ModuleParseError::InvalidCustomSection};
+        }
+
+        module.custom_sections.push_back(CustomSection{
+                .name = *std::move(name),
+                .data = std::move(data),
+        });
+    }
+
+    return module;
+}
+
+tl::expected<LazyModule, ModuleParseError> ByteCodeParser::parse_module_lazily(std::span<std::byte const> bytes) {
+    Reader is{bytes};
+    if (auto error = parse_header(is)) {
+        return tl::unexpected{*error};
+    }
+
+    LazyModule lazy;
+    while (!is.at_end()) {
+        auto id = parse_section_id(is);
+        if (!id) {
+            return tl::unexpected{id.error()};
+        }
+
+        auto size = parse_section_size(is);
+        if (!size) {
+            return tl::unexpected{size.error()};
+        }
+
+        auto content = is.take(*size);
+        if (!content) {
+            return tl::unexpected{ModuleParseError::UnexpectedEof};
+        }
+
+        Reader section{*content};
+        switch (*id) {
+            case SectionId::Custom: {
+                auto name = parse_name_view(section);
+                if (!name) {
+                    return tl::unexpected{ModuleParseError::InvalidCustomSection};
+                }
+
+                lazy.custom_sections.push_back(LazyModule::CustomSection{
+                        .name = *name,
+                        .data = content->subspan(section.tellg()),
+                });
+                continue;
+            }
+            case SectionId::Code: {
+                auto bodies = parse_function_bodies(section);
+                if (!bodies || !section.at_end()) {
+                    return tl::unexpected{ModuleParseError::InvalidCodeSection};
+                }
+
+                lazy.module.code_section = CodeSection{};
+                lazy.function_bodies = *std::move(bodies);
+                continue;
+            }
+            case SectionId::Data:
+                lazy.data_section = *content;
+                continue;
+            default:
+                break;
+        }
+
+        if (auto error = parse_section(*id, section, lazy.module)) {
+            return tl::unexpected{*error};
+        }
+
+        if (!section.at_end()) {
+            return tl::unexpected{section_error(*id)};
+        }
+    }
+
+    return lazy;
+}
+
+std::optional<std::vector<instructions::Instruction>> ByteCodeParser::parse_instructions(std::istream &is) {
+    // Parse from a copy of what's left, and then skip past what was used.
+    auto const start = is.tellg();
+    std::string const bytes{std::istreambuf_iterator<char>{is}, {}};
+    Reader reader{std::as_bytes(std::span{bytes})};
+    auto instructions = wasm::parse_instructions(reader);
+
+    is.clear();
+    if (start != std::istream::pos_type{-1}) {
+        is.seekg(start + static_cast<std::streamoff>(reader.tellg()));
+    }
+
+    if (!instructions) {
+        is.setstate(std::ios::failbit);
+    }
+
+    return instructions;
+}
+
+tl::expected<CodeEntry, ModuleParseError> LazyModule::decode_function(std::size_t idx) const {
+    if (idx >= function_bodies.size()) {
+        return tl::unexpected{ModuleParseError::InvalidCodeSection};
+    }
+
+    Reader is{function_bodies[idx]};
+    auto locals = parse_vector<CodeEntry::Local>(is);
+    if (!locals) {
+        return tl::unexpected{ModuleParseError::InvalidCodeSection};
+    }
+
+    auto code = wasm::parse_instructions(is);
+    if (!code || !is.at_end()) {
+        return tl::unexpected{ModuleParseError::InvalidCodeSection};
+    }
+
+    return CodeEntry{
+            .code = *std::move(code),
+            .locals = *std::move(locals),
+    };
+}
+
+tl::expected<Module, ModuleParseError> LazyModule::decode(unsigned threads) const {
+    auto decoded = module;
+    for (auto const &custom : custom_sections) {
+        auto const *data = reinterpret_cast<std::uint8_t const *>(custom.data.data());
+        decoded.custom_sections.push_back(wasm::CustomSection{
+                .name = std::string{custom.name},
+                .data = {data, data + custom.data.size()},
+        });
+    }
+
+    if (decoded.code_section) {
+        // Bodies are decoded independently, so threads just grab the next one
+        // that hasn't been decoded yet.
+        auto &entries = decoded.code_section->entries;
+        entries.resize(function_bodies.size());
+        std::atomic<std::size_t> next{0};
+        std::atomic<bool> failed{false};
+        auto work = [&] {
+            for (auto i = next.fetch_add(1); i < entries.size() && !failed; i = next.fetch_add(1)) {
+                auto entry = decode_function(i);
+                if (!entry) {
+                    failed = true;
+                    return;
+                }
+
+                entries[i] = *std::move(entry);
+            }
+        };
+
+        {
+            auto const helpers = std::clamp(entries.size(), std::size_t{1}, std::size_t{std::max(threads, 1U)}) - 1;
+            std::vector<std::jthread> workers;
+            workers.reserve(helpers);
+            for (std::size_t i = 0; i < helpers; ++i) {
+                workers.emplace_back(work);
+            }
+
+            work();
+        }
+
+        if (failed) {
+            return tl::unexpected{ModuleParseError::InvalidCodeSection};
+        }
+    }
+
+    if (data_section) {
+        Reader is{*data_section};
+        decoded.data_section = parse_data_section(is);
+        if (!decoded.data_section || !is.at_end()) {
+            return tl::unexpected{ModuleParseError::InvalidDataSection};
+        }
+    }
+
+    return decoded;
+}
+
 } // namespace wasm
@@ -7,9 +7,11 @@
 
 #include <tl/expected.hpp>
 
+#include <cstddef>
 #include <cstdint>
 #include <iosfwd>
 #include <optional>
+#include <span>
 #include <string_view>
 #include <vector>
 
@@ -78,10 +80,40 @@ constexpr std::string_view to_string(ModuleParseError e) {
     return "Unknown error";
 }
 
+// A module w/ its sections parsed, except for the ones that make up most of
+// a large module, which are kept as spans into the parsed bytes until they're
+// decoded. The bytes must outlive it.
+struct LazyModule {
+    struct CustomSection {
+        std::string_view name;
+        std::span<std::byte const> data;
+    };
+
+    // Everything but the custom sections, the code section's entries, and the
+    // data section.
+    Module module;
+    std::vector<CustomSection> custom_sections;
+    // The locals and code of each function, in code section order.
+    std::vector<std::span<std::byte const>> function_bodies;
+    std::optional<std::span<std::byte const>> data_section;
+
+    tl::expected<CodeEntry, ModuleParseError> decode_function(std::size_t idx) const;
+
+    // Decodes everything into a Module, spreading the function bodies over up
+    // to `threads` threads.
+    tl::expected<Module, ModuleParseError> decode(unsigned threads = 1) const;
+};
+
 class ByteCodeParser {
 public:
     static tl::expected<Module, ModuleParseError> parse_module(std::istream &);
     static tl::expected<Module, ModuleParseError> parse_module(std::istream &&is) { return parse_module(is); }
+    static tl::expected<Module, ModuleParseError> parse_module(std::span<std::byte const>);
+
+    // Only records where the function bodies are, leaving them to be decoded
+    // on demand. Unlike parse_module, section and function body sizes are
+    // checked against their contents.
+    static tl::expected<LazyModule, ModuleParseError> parse_module_lazily(std::span<std::byte const>);
 
     // TODO(robinlinden): Make private.
     static std::optional<std::vector<instructions::Instruction>> parse_instructions(std::istream &);
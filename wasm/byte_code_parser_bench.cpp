@@ -0,0 +1,179 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "wasm/byte_code_parser.h"
+
+#include "wasm/wasm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// The parser caps vectors at 65535 entries.
+constexpr std::uint32_t kFunctions = 60'000;
+constexpr std::uint32_t kStatementsPerFunction = 16;
+
+void append_leb128(std::string &out, std::uint32_t v) {
+    do {
+        auto byte = static_cast<char>(v & 0x7f);
+        v >>= 7;
+        out += v != 0 ? static_cast<char>(byte | 0x80) : byte;
+    } while (v != 0);
+}
+
+void append_section(std::string &out, std::uint8_t id, std::string const &content) {
+    out += static_cast<char>(id);
+    append_leb128(out, static_cast<std::uint32_t>(content.size()));
+    out += content;
+}
+
+// A module w/ lots of (i32) -> () functions doing local.0 += k a few times.
+std::string make_module() {
+    std::string module{"\0asm\1\0\0\0", 8};
+    append_section(module, 1, std::string{"\1\x60\1\x7f\0", 5});
+
+    std::string functions;
+    append_leb128(functions, kFunctions);
+    functions.append(kFunctions, '\0');
+    append_section(module, 3, functions);
+
+    std::string code;
+    append_leb128(code, kFunctions);
+    for (std::uint32_t i = 0; i < kFunctions; ++i) {
+        std::string body{"\1\1\x7f"};
+        for (std::uint32_t j = 0; j < kStatementsPerFunction; ++j) {
+            // local.get 0, i32.const i * j, i32.add, local.set 0
+            body += "\x20";
+            body += '\0';
+            body += "\x41";
+            append_leb128(body, (i * j) & 0x3f);
+            body += "\x6a\x21";
+            body += '\0';
+        }
+        body += "\x0b";
+        append_leb128(code, static_cast<std::uint32_t>(body.size()));
+        code += body;
+    }
+    append_section(module, 10, code);
+    return module;
+}
+
+// In MB, or 0 where it can't be measured.
+double peak_rss() {
+#ifndef _WIN32
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<double>(usage.ru_maxrss) / 1'000'000.;
+#else
+    return static_cast<double>(usage.ru_maxrss) / 1'000.;
+#endif
+#else
+    return 0.;
+#endif
+}
+
+template<typename F>
+double time_ms(F &&f) {
+    auto const start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::milli> const duration = std::chrono::steady_clock::now() - start;
+    return duration.count();
+}
+
+std::size_t function_count(wasm::Module const &module) {
+    return module.code_section ? module.code_section->entries.size() : 0;
+}
+
+[[noreturn]] void fail(wasm::ModuleParseError e) {
+    std::cerr << "Parsing failed: " << wasm::to_string(e) << '\n';
+    std::exit(1);
+}
+
+} // namespace
+
+// Parses a large module, either a generated one or the one in the given file,
+// in one of a few ways, and reports the time taken and the peak RSS. The peak
+// can only ever go up, so each mode needs its own run.
+int main(int argc, char **argv) {
+    std::string_view const mode = argc > 1 ? argv[1] : "";
+    if (mode != "stream" && mode != "span" && mode != "lazy" && mode != "decode") {
+        std::cerr << "Usage: " << argv[0] << " <stream|span|lazy|decode> [module.wasm]\n";
+        return 1;
+    }
+
+    std::string module;
+    if (argc > 2) {
+        std::ifstream fs{argv[2], std::ios::binary};
+        if (!fs) {
+            std::cerr << "Unable to open " << argv[2] << '\n';
+            return 1;
+        }
+        module.assign(std::istreambuf_iterator<char>{fs}, {});
+    } else {
+        module = make_module();
+    }
+
+    auto const bytes = std::as_bytes(std::span{module});
+    std::cout << "Module: " << bytes.size() / 1'000 << " kB, peak RSS before parsing: " << peak_rss() << " MB\n";
+
+    std::size_t functions{};
+    double ms{};
+    if (mode == "stream") {
+        std::istringstream is{module};
+        ms = time_ms([&] {
+            auto parsed = wasm::ByteCodeParser::parse_module(is);
+            if (!parsed) {
+                fail(parsed.error());
+            }
+            functions = function_count(*parsed);
+        });
+    } else if (mode == "span") {
+        ms = time_ms([&] {
+            auto parsed = wasm::ByteCodeParser::parse_module(bytes);
+            if (!parsed) {
+                fail(parsed.error());
+            }
+            functions = function_count(*parsed);
+        });
+    } else if (mode == "lazy") {
+        ms = time_ms([&] {
+            auto parsed = wasm::ByteCodeParser::parse_module_lazily(bytes);
+            if (!parsed) {
+                fail(parsed.error());
+            }
+            functions = parsed->function_bodies.size();
+        });
+    } else {
+        auto const threads = std::max(std::thread::hardware_concurrency(), 1U);
+        std::cout << "Decoding w/ " << threads << " threads\n";
+        ms = time_ms([&] {
+            auto parsed = wasm::ByteCodeParser::parse_module_lazily(bytes).and_then(
+                    [&](wasm::LazyModule const &lazy) { return lazy.decode(threads); });
+            if (!parsed) {
+                fail(parsed.error());
+            }
+            functions = function_count(*parsed);
+        });
+    }
+
+    std::cout << mode << ": " << functions << " functions in " << ms << " ms, peak RSS: " << peak_rss() << " MB\n";
+}
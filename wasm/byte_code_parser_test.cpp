@@ -17,6 +17,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <optional>
+#include <span>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -714,6 +716,81 @@ void data_count_tests() {
     });
 }
 
+void lazy_tests() {
+    using wasm::ModuleParseError;
+
+    // Types: () -> i32, functions: 2, custom: "hi", code: 2 bodies, data: 1 passive.
+    static constexpr auto kModule =
+            "\0asm\1\0\0\0"
+            "\1\5\1\x60\0\1\x7f"
+            "\3\3\2\0\0"
+            "\0\6\2hi\1\2\3"
+            "\x0a\x0b\2\4\0\x41\x2a\x0b\4\1\1\x7f\x0b"
+            "\x0b\5\1\1\2\7\x08"sv;
+    static auto const kBytes = std::as_bytes(std::span{kModule});
+
+    etest::test("lazy, decodes like the eager parser", [] {
+        auto eager = ByteCodeParser::parse_module(std::stringstream{std::string{kModule}}).value();
+        expect_eq(ByteCodeParser::parse_module(kBytes), eager);
+
+        auto lazy = ByteCodeParser::parse_module_lazily(kBytes).value();
+        expect_eq(lazy.module.code_section, wasm::CodeSection{});
+        expect_eq(lazy.module.custom_sections, std::vector<wasm::CustomSection>{});
+        expect_eq(lazy.module.data_section, std::nullopt);
+        expect_eq(lazy.decode(), eager);
+        expect_eq(lazy.decode(4), eager);
+    });
+
+    etest::test("lazy, sections point into the module", [] {
+        auto lazy = ByteCodeParser::parse_module_lazily(kBytes).value();
+        expect_eq(lazy.custom_sections.size(), std::size_t{1});
+        expect_eq(lazy.custom_sections[0].name, "hi"sv);
+        expect_eq(lazy.custom_sections[0].name.data(), kModule.data() + 23);
+        expect_eq(lazy.custom_sections[0].data.data(), kBytes.data() + 25);
+        expect_eq(lazy.custom_sections[0].data.size(), std::size_t{3});
+
+        expect_eq(lazy.function_bodies.size(), std::size_t{2});
+        expect_eq(lazy.function_bodies[0].data(), kBytes.data() + 32);
+        expect_eq(lazy.function_bodies[1].data(), kBytes.data() + 37);
+        expect_eq(lazy.decode_function(1),
+                tl::expected<wasm::CodeEntry, ModuleParseError>{wasm::CodeEntry{
+                        .locals{{1, wasm::ValueType::Int32}},
+                }});
+        expect_eq(lazy.decode_function(2),
+                tl::expected<wasm::CodeEntry, ModuleParseError>{tl::unexpected{ModuleParseError::InvalidCodeSection}});
+    });
+
+    etest::test("lazy, bad function bodies are found when decoding", [] {
+        auto bytes = make_module_bytes(SectionId::Code, {2, 2, 0, 0x0b, 2, 0, 0xff}).str();
+        auto lazy = ByteCodeParser::parse_module_lazily(std::as_bytes(std::span{bytes})).value();
+        expect_eq(lazy.decode_function(0), tl::expected<wasm::CodeEntry, ModuleParseError>{wasm::CodeEntry{}});
+        expect_eq(lazy.decode_function(1),
+                tl::expected<wasm::CodeEntry, ModuleParseError>{tl::unexpected{ModuleParseError::InvalidCodeSection}});
+        expect_eq(lazy.decode(), tl::unexpected{ModuleParseError::InvalidCodeSection});
+        expect_eq(lazy.decode(2), tl::unexpected{ModuleParseError::InvalidCodeSection});
+    });
+
+    etest::test("lazy, sizes are checked", [] {
+        auto parse = [](std::string const &bytes) {
+            return ByteCodeParser::parse_module_lazily(std::as_bytes(std::span{bytes})).error();
+        };
+
+        // Function body larger than the section.
+        expect_eq(parse(make_module_bytes(SectionId::Code, {1, 5, 0, 0x0b}).str()),
+                ModuleParseError::InvalidCodeSection);
+        // Data after the last function body.
+        expect_eq(parse(make_module_bytes(SectionId::Code, {1, 2, 0, 0x0b, 0}).str()),
+                ModuleParseError::InvalidCodeSection);
+        // Data after the types.
+        expect_eq(parse(make_module_bytes(SectionId::Type, {0, 0}).str()), ModuleParseError::InvalidTypeSection);
+        // Section larger than the module.
+        expect_eq(parse("\0asm\1\0\0\0\1\5\0"s), ModuleParseError::UnexpectedEof);
+        expect_eq(parse("\0asm\1\0\0\0\1"s), ModuleParseError::UnexpectedEof);
+        expect_eq(parse("\0asm\2\0\0\0"s), ModuleParseError::UnsupportedVersion);
+        expect_eq(parse(make_module_bytes(SectionId::Element, {}).str()), ModuleParseError::UnhandledSection);
+    });
+}
+
 } // namespace
 
 int main() {
@@ -770,6 +847,7 @@ int main() {
     code_section_tests();
     data_tests();
     data_count_tests();
+    lazy_tests();
 
     return etest::run_all_tests();
 }
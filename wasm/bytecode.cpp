@@ -0,0 +1,286 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "wasm/bytecode.h"
+
+#include "wasm/instructions.h"
+#include "wasm/types.h"
+#include "wasm/wasm.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace wasm::bytecode {
+namespace {
+
+using namespace instructions;
+
+struct SimpleOp {
+    OpCode code{};
+    std::uint32_t pops{};
+};
+
+#define WASM_UNARY_OP(name) \
+    constexpr SimpleOp simple_op(name const &) { return {OpCode::name, 1}; }
+#define WASM_BINARY_OP(name) \
+    constexpr SimpleOp simple_op(name const &) { return {OpCode::name, 2}; }
+WASM_UNARY_OPS(WASM_UNARY_OP)
+WASM_BINARY_OPS(WASM_BINARY_OP)
+#undef WASM_UNARY_OP
+#undef WASM_BINARY_OP
+
+// Lowers a validated function body into ops, keeping track of how many values
+// are on the stack so that branches know how far to unwind it. Anything
+// following an unconditional branch in a block is unreachable and skipped.
+class Lowerer {
+public:
+    Lowerer(Module const &m, std::span<FunctionType const *const> function_types, std::size_t imports, Function &f)
+        : module_{m}, function_types_{function_types}, imports_{imports}, f_{f}, height_{f.locals} {}
+
+    bool lower(std::vector<Instruction> const &body) {
+        auto const results = static_cast<std::uint32_t>(f_.type.results.size());
+        labels_.push_back(Label{.height = f_.locals, .arity = results});
+        if (!lower_sequence(body)) {
+            return false;
+        }
+
+        if (!unreachable_ && height_ < f_.locals + results) {
+            return false;
+        }
+
+        f_.code.push_back(Op{.code = OpCode::Return, .a = results});
+        f_.frame_size = max_height_;
+        return true;
+    }
+
+    bool operator()(Block const &block) { return lower_block(block.type, block.instructions, false); }
+    bool operator()(Loop const &loop) { return lower_block(loop.type, loop.instructions, true); }
+
+    bool operator()(Branch const &br) {
+        unreachable_ = true;
+        return branch(br.label_idx, false);
+    }
+
+    bool operator()(BranchIf const &br) { return pop(1) && branch(br.label_idx, true); }
+
+    bool operator()(Return const &) {
+        unreachable_ = true;
+        return branch(static_cast<std::uint32_t>(labels_.size() - 1), false);
+    }
+
+    bool operator()(Call const &call) {
+        if (call.function_idx >= function_types_.size()) {
+            return false;
+        }
+
+        auto const &type = *function_types_[call.function_idx];
+        auto const params = static_cast<std::uint32_t>(type.parameters.size());
+        auto const results = static_cast<std::uint32_t>(type.results.size());
+        if (!pop(params)) {
+            return false;
+        }
+
+        if (call.function_idx < imports_) {
+            f_.code.push_back(Op{.code = OpCode::CallHost, .a = call.function_idx, .b = params, .c = results});
+        } else {
+            auto const idx = static_cast<std::uint32_t>(call.function_idx - imports_);
+            f_.code.push_back(Op{.code = OpCode::Call, .a = idx, .b = params, .c = results});
+        }
+
+        push(results);
+        return true;
+    }
+
+    bool operator()(End const &) { return false; }
+
+    bool operator()(I32Const const &c) {
+        f_.code.push_back(Op{.code = OpCode::I32Const, .a = static_cast<std::uint32_t>(c.value)});
+        push(1);
+        return true;
+    }
+
+    bool operator()(LocalGet const &l) {
+        f_.code.push_back(Op{.code = OpCode::LocalGet, .a = l.idx});
+        push(1);
+        return l.idx < f_.locals;
+    }
+
+    bool operator()(LocalSet const &l) {
+        f_.code.push_back(Op{.code = OpCode::LocalSet, .a = l.idx});
+        return l.idx < f_.locals && pop(1);
+    }
+
+    bool operator()(LocalTee const &l) {
+        f_.code.push_back(Op{.code = OpCode::LocalTee, .a = l.idx});
+        return l.idx < f_.locals && pop(1) && push(1);
+    }
+
+    bool operator()(I32Load const &load) {
+        f_.code.push_back(Op{.code = OpCode::I32Load, .a = load.arg.offset});
+        return pop(1) && push(1);
+    }
+
+    bool operator()(I32Store const &store) {
+        f_.code.push_back(Op{.code = OpCode::I32Store, .a = store.arg.offset});
+        return pop(2);
+    }
+
+    // The value's bits are already what they should be.
+    bool operator()(I32ReinterpretF32 const &) { return pop(1) && push(1); }
+
+    template<typename T>
+    requires std::is_empty_v<T>
+    bool operator()(T const &t) {
+        auto const [code, pops] = simple_op(t);
+        f_.code.push_back(Op{.code = code});
+        return pop(pops) && push(1);
+    }
+
+private:
+    struct Label {
+        // The stack height, not counting the block's parameters, when entering
+        // the block.
+        std::uint32_t height{};
+        // The number of values branches to this label carry.
+        std::uint32_t arity{};
+        std::optional<std::size_t> loop_start;
+        // Branches to fill in the target of once the block's end is known.
+        std::vector<std::size_t> fixups;
+    };
+
+    // NOLINTNEXTLINE(misc-no-recursion)
+    bool lower_sequence(std::vector<Instruction> const &instructions) {
+        for (auto const &instruction : instructions) {
+            if (!std::visit(*this, instruction)) {
+                return false;
+            }
+
+            if (unreachable_) {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    // NOLINTNEXTLINE(misc-no-recursion)
+    bool lower_block(BlockType const &type, std::vector<Instruction> const &instructions, bool is_loop) {
+        std::uint32_t params = 0;
+        std::uint32_t results = 0;
+        if (std::holds_alternative<ValueType>(type.value)) {
+            results = 1;
+        } else if (auto const *idx = std::get_if<TypeIdx>(&type.value)) {
+            auto const &block_type = module_.type_section->types.at(*idx);
+            params = static_cast<std::uint32_t>(block_type.parameters.size());
+            results = static_cast<std::uint32_t>(block_type.results.size());
+        }
+
+        if (!pop(params)) {
+            return false;
+        }
+
+        labels_.push_back(Label{
+                .height = height_,
+                .arity = is_loop ? params : results,
+                .loop_start = is_loop ? std::optional{f_.code.size()} : std::nullopt,
+        });
+        push(params);
+
+        if (!lower_sequence(instructions)) {
+            return false;
+        }
+
+        auto label = std::move(labels_.back());
+        labels_.pop_back();
+        if (!unreachable_ && height_ != label.height + results) {
+            return false;
+        }
+
+        unreachable_ = false;
+        height_ = label.height;
+        push(results);
+
+        for (auto fixup : label.fixups) {
+            f_.code[fixup].a = static_cast<std::uint32_t>(f_.code.size() - fixup);
+        }
+
+        return true;
+    }
+
+    bool branch(std::uint32_t label_idx, bool conditional) {
+        if (label_idx >= labels_.size()) {
+            return false;
+        }
+
+        auto &label = labels_[labels_.size() - 1 - label_idx];
+        if (height_ < label.height + label.arity) {
+            return false;
+        }
+
+        // Branching out of the function is a return.
+        if (label_idx == labels_.size() - 1) {
+            f_.code.push_back(Op{.code = conditional ? OpCode::ReturnIf : OpCode::Return, .a = label.arity});
+            return true;
+        }
+
+        Op op{.b = label.height, .c = label.arity};
+        if (height_ == label.height + label.arity) {
+            op.code = conditional ? OpCode::JumpIf : OpCode::Jump;
+        } else {
+            op.code = conditional ? OpCode::BranchIf : OpCode::Branch;
+        }
+
+        if (label.loop_start) {
+            op.a = static_cast<std::uint32_t>(*label.loop_start - f_.code.size());
+        } else {
+            label.fixups.push_back(f_.code.size());
+        }
+
+        f_.code.push_back(op);
+        return true;
+    }
+
+    bool pop(std::uint32_t n) {
+        if (height_ < labels_.back().height + n) {
+            return false;
+        }
+
+        height_ -= n;
+        return true;
+    }
+
+    bool push(std::uint32_t n) {
+        height_ += n;
+        max_height_ = std::max(max_height_, height_);
+        return true;
+    }
+
+    Module const &module_;
+    std::span<FunctionType const *const> function_types_;
+    std::size_t imports_{};
+    Function &f_;
+    std::vector<Label> labels_;
+    std::uint32_t height_{};
+    std::uint32_t max_height_{height_};
+    bool unreachable_{false};
+};
+
+} // namespace
+
+bool lower(Module const &m,
+        std::span<FunctionType const *const> function_types,
+        std::size_t imports,
+        std::vector<Instruction> const &body,
+        Function &f) {
+    return Lowerer{m, function_types, imports, f}.lower(body);
+}
+
+} // namespace wasm::bytecode
@@ -0,0 +1,129 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef WASM_BYTECODE_H_
+#define WASM_BYTECODE_H_
+
+#include "wasm/instructions.h"
+#include "wasm/types.h"
+#include "wasm/wasm.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// The flat form function bodies are lowered into before being interpreted or
+// compiled to machine code. Stack slots are counted from a function's first
+// local, w/ the operand stack starting right after the locals.
+namespace wasm::bytecode {
+
+// Ops w/o immediates, popping their operands and pushing one i32.
+// Ops w/o immediates, popping their operands and pushing one i32.
+#define WASM_UNARY_OPS(X) \
+    X(I32EqualZero) \
+    X(I32CountLeadingZeros) \
+    X(I32CountTrailingZeros) \
+    X(I32PopulationCount) \
+    X(I32WrapI64) \
+    X(I32TruncateF32Signed) \
+    X(I32TruncateF32Unsigned) \
+    X(I32TruncateF64Signed) \
+    X(I32TruncateF64Unsigned) \
+    X(I32Extend8Signed) \
+    X(I32Extend16Signed)
+
+#define WASM_BINARY_OPS(X) \
+    X(I32Equal) \
+    X(I32NotEqual) \
+    X(I32LessThanSigned) \
+    X(I32LessThanUnsigned) \
+    X(I32GreaterThanSigned) \
+    X(I32GreaterThanUnsigned) \
+    X(I32LessThanEqualSigned) \
+    X(I32LessThanEqualUnsigned) \
+    X(I32GreaterThanEqualSigned) \
+    X(I32GreaterThanEqualUnsigned) \
+    X(I32Add) \
+    X(I32Subtract) \
+    X(I32Multiply) \
+    X(I32DivideSigned) \
+    X(I32DivideUnsigned) \
+    X(I32RemainderSigned) \
+    X(I32RemainderUnsigned) \
+    X(I32And) \
+    X(I32Or) \
+    X(I32ExclusiveOr) \
+    X(I32ShiftLeft) \
+    X(I32ShiftRightSigned) \
+    X(I32ShiftRightUnsigned) \
+    X(I32RotateLeft) \
+    X(I32RotateRight)
+
+// Ops w/ immediates, or that don't map to a single instruction. Blocks and
+// loops turn into jump targets, and branches into jumps if they don't need to
+// drop any values from the stack.
+#define WASM_CONTROL_OPS(X) \
+    X(Jump) \
+    X(JumpIf) \
+    X(Branch) \
+    X(BranchIf) \
+    X(Return) \
+    X(ReturnIf) \
+    X(Call) \
+    X(CallHost) \
+    X(CallCompiled) \
+    X(I32Const) \
+    X(LocalGet) \
+    X(LocalSet) \
+    X(LocalTee) \
+    X(I32Load) \
+    X(I32Store)
+
+#define WASM_ALL_OPS(X) WASM_CONTROL_OPS(X) WASM_UNARY_OPS(X) WASM_BINARY_OPS(X)
+
+enum class OpCode : std::uint8_t {
+#define WASM_OP_ENUMERATOR(name) name,
+    WASM_ALL_OPS(WASM_OP_ENUMERATOR)
+#undef WASM_OP_ENUMERATOR
+};
+
+// What the immediates mean depends on the op:
+// * Jumps: a is the offset to the target from the jump.
+// * Branches: a is the offset, b the stack height (counted from the first
+//   local) to unwind to, and c the number of values carried along.
+// * Returns: a is the number of results.
+// * Calls: a is the index into the instance's functions or host functions, b
+//   the number of parameters, and c the number of results. CallCompiled is
+//   never emitted by lowering, but used by the instance for calls into
+//   compiled code.
+// * Constants, locals, and memory: a is the value, local index, or offset.
+struct Op {
+    OpCode code{};
+    std::uint32_t a{};
+    std::uint32_t b{};
+    std::uint32_t c{};
+};
+
+struct Function {
+    FunctionType type;
+    std::uint32_t locals{};
+    // The locals and the deepest the operand stack gets.
+    std::uint32_t frame_size{};
+    std::vector<Op> code;
+};
+
+// Lowers a validated function body into f.code. f.type and f.locals, which
+// includes the parameters, must already be set. function_types covers the
+// imported functions followed by the module's own, and calls to the first
+// `imports` of them become CallHost ops.
+bool lower(Module const &,
+        std::span<FunctionType const *const> function_types,
+        std::size_t imports,
+        std::vector<instructions::Instruction> const &body,
+        Function &f);
+
+} // namespace wasm::bytecode
+
+#endif
@@ -0,0 +1,319 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "wasm/interpreter.h"
+
+#include "wasm/instructions.h"
+#include "wasm/types.h"
+#include "wasm/wasm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace wasm;
+using namespace wasm::instructions;
+
+namespace {
+
+template<typename F>
+double time_ms(F &&f) {
+    auto const start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::milli> const duration = std::chrono::steady_clock::now() - start;
+    return duration.count();
+}
+
+Module make_module(FunctionType type, std::vector<Instruction> code, std::uint32_t locals, std::uint32_t pages = 0) {
+    Module m{};
+    m.type_section = TypeSection{.types = {std::move(type)}};
+    m.function_section = FunctionSection{.type_indices = {0}};
+    m.code_section = CodeSection{.entries = {CodeEntry{
+            .code = std::move(code),
+            .locals = {{.count = locals, .type = ValueType::Int32}},
+    }}};
+    m.export_section = ExportSection{.exports = {Export{.name = "run", .type = Export::Type::Function, .index = 0}}};
+    if (pages > 0) {
+        m.memory_section = MemorySection{.memories = {MemType{.min = pages}}};
+    }
+    return m;
+}
+
+// fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2)
+Module fib_module() {
+    return make_module(FunctionType{.parameters = {ValueType::Int32}, .results = {ValueType::Int32}},
+            {
+                    Block{.instructions = {LocalGet{0},
+                                  I32Const{2},
+                                  I32GreaterThanEqualSigned{},
+                                  BranchIf{0},
+                                  LocalGet{0},
+                                  Return{}}},
+                    LocalGet{0},
+                    I32Const{1},
+                    I32Subtract{},
+                    Call{0},
+                    LocalGet{0},
+                    I32Const{2},
+                    I32Subtract{},
+                    Call{0},
+                    I32Add{},
+            },
+            0);
+}
+
+int fib(int n) {
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+// Counts the primes below n, using one i32 in memory per number.
+// Locals: 0 = n, 1 = i, 2 = j, 3 = count.
+Module sieve_module(std::uint32_t pages) {
+    constexpr MemArg kArg{.align = 2};
+
+    // for (j = i + i; j < n; j += i) composite[j] = 1;
+    std::vector<Instruction> mark_multiples{
+            LocalGet{1},
+            LocalGet{1},
+            I32Add{},
+            LocalSet{2},
+            Block{.instructions = {Loop{.instructions = {
+                                           LocalGet{2},
+                                           LocalGet{0},
+                                           I32GreaterThanEqualSigned{},
+                                           BranchIf{1},
+                                           LocalGet{2},
+                                           I32Const{2},
+                                           I32ShiftLeft{},
+                                           I32Const{1},
+                                           I32Store{.arg = kArg},
+                                           LocalGet{2},
+                                           LocalGet{1},
+                                           I32Add{},
+                                           LocalSet{2},
+                                           Branch{0},
+                                   }}}},
+    };
+
+    // if (!composite[i]) { ++count; mark_multiples(); }
+    std::vector<Instruction> visit{
+            LocalGet{1},
+            I32Const{2},
+            I32ShiftLeft{},
+            I32Load{.arg = kArg},
+            BranchIf{0},
+            LocalGet{3},
+            I32Const{1},
+            I32Add{},
+            LocalSet{3},
+    };
+    std::ranges::move(mark_multiples, std::back_inserter(visit));
+
+    // for (i = 2; i < n; ++i) visit();
+    return make_module(FunctionType{.parameters = {ValueType::Int32}, .results = {ValueType::Int32}},
+            {
+                    I32Const{2},
+                    LocalSet{1},
+                    Block{.instructions = {Loop{.instructions = {
+                                                   LocalGet{1},
+                                                   LocalGet{0},
+                                                   I32GreaterThanEqualSigned{},
+                                                   BranchIf{1},
+                                                   Block{.instructions = std::move(visit)},
+                                                   LocalGet{1},
+                                                   I32Const{1},
+                                                   I32Add{},
+                                                   LocalSet{1},
+                                                   Branch{0},
+                                           }}}},
+                    LocalGet{3},
+            },
+            3,
+            pages);
+}
+
+int sieve(std::vector<std::int32_t> &composite) {
+    auto const n = static_cast<int>(composite.size());
+    int count = 0;
+    for (int i = 2; i < n; ++i) {
+        if (composite[static_cast<std::size_t>(i)] != 0) {
+            continue;
+        }
+
+        ++count;
+        for (int j = i + i; j < n; j += i) {
+            composite[static_cast<std::size_t>(j)] = 1;
+        }
+    }
+    return count;
+}
+
+// C = A * B for n x n matrices of i32s, stored one after the other in memory.
+// Locals: 0 = n, 1 = i, 2 = j, 3 = k, 4 = sum.
+Module matmul_module(std::uint32_t n, std::uint32_t pages) {
+    auto const size = n * n * 4;
+    auto const a = MemArg{.align = 2, .offset = 0};
+    auto const b = MemArg{.align = 2, .offset = size};
+    auto const c = MemArg{.align = 2, .offset = 2 * size};
+
+    // (row * n + col) * 4
+    auto const index = [](std::uint32_t row, std::uint32_t col) -> std::vector<Instruction> {
+        return {LocalGet{row}, LocalGet{0}, I32Multiply{}, LocalGet{col}, I32Add{}, I32Const{2}, I32ShiftLeft{}};
+    };
+    auto const concat = [](std::vector<std::vector<Instruction>> parts) {
+        std::vector<Instruction> out;
+        for (auto &part : parts) {
+            std::ranges::move(part, std::back_inserter(out));
+        }
+        return out;
+    };
+    // Loops over local `counter` in [0, n), running `body` each iteration.
+    auto const for_loop = [&](std::uint32_t counter, std::vector<Instruction> body) -> std::vector<Instruction> {
+        std::vector<Instruction> check{LocalGet{counter}, LocalGet{0}, I32GreaterThanEqualSigned{}, BranchIf{1}};
+        std::vector<Instruction> step{LocalGet{counter}, I32Const{1}, I32Add{}, LocalSet{counter}, Branch{0}};
+        auto loop = concat({std::move(check), std::move(body), std::move(step)});
+        return {I32Const{0}, LocalSet{counter}, Block{.instructions = {Loop{.instructions = std::move(loop)}}}};
+    };
+
+    auto inner = concat({
+            {LocalGet{4}},
+            index(1, 3),
+            {I32Load{.arg = a}},
+            index(3, 2),
+            {I32Load{.arg = b}, I32Multiply{}, I32Add{}, LocalSet{4}},
+    });
+    auto middle = concat({
+            {I32Const{0}, LocalSet{4}},
+            for_loop(3, std::move(inner)),
+            index(1, 2),
+            {LocalGet{4}, I32Store{.arg = c}},
+    });
+
+    auto body = for_loop(1, for_loop(2, std::move(middle)));
+    return make_module(FunctionType{.parameters = {ValueType::Int32}}, std::move(body), 4, pages);
+}
+
+void matmul(std::span<std::int32_t const> a,
+        std::span<std::int32_t const> b,
+        std::span<std::int32_t> c,
+        std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            std::uint32_t sum = 0;
+            for (std::size_t k = 0; k < n; ++k) {
+                sum += static_cast<std::uint32_t>(a[i * n + k]) * static_cast<std::uint32_t>(b[k * n + j]);
+            }
+            c[i * n + j] = static_cast<std::int32_t>(sum);
+        }
+    }
+}
+
+Instance instantiate(Module const &m, Engine engine) {
+    auto instance = Instance::create(m, {}, engine);
+    if (!instance) {
+        std::cerr << "Unable to instantiate module: " << to_string(instance.error()) << '\n';
+        std::exit(1);
+    }
+    return *std::move(instance);
+}
+
+std::int32_t call(Instance &instance, std::int32_t arg) {
+    auto result = instance.call("run", std::vector<Value>{arg});
+    if (!result) {
+        std::cerr << "Trapped: " << to_string(result.error()) << '\n';
+        std::exit(1);
+    }
+    return result->empty() ? 0 : std::get<std::int32_t>(result->front());
+}
+
+struct Timings {
+    double interpreted{};
+    double jit{};
+    double native{};
+};
+
+void report(std::string_view name, Timings const &t, bool matches) {
+    std::cout << name << ": " << t.interpreted << " ms interpreted (" << t.interpreted / t.native << "x), " << t.jit
+              << " ms jit (" << t.jit / t.native << "x), " << t.native << " ms native"
+              << (matches ? "" : " MISMATCH") << '\n';
+}
+
+} // namespace
+
+// Runs a few small kernels in the interpreter, the jit, and natively, comparing
+// the time taken and the results.
+int main(int argc, char **argv) {
+    int const fib_n = argc > 1 ? std::atoi(argv[1]) : 30;
+    int const sieve_n = argc > 2 ? std::atoi(argv[2]) : 4'000'000;
+    int const matmul_n = argc > 3 ? std::atoi(argv[3]) : 128;
+
+    {
+        auto interpreter = instantiate(fib_module(), Engine::Interpreter);
+        auto jit = instantiate(fib_module(), Engine::Jit);
+        std::int32_t interpreted{};
+        std::int32_t compiled{};
+        int native{};
+        Timings t;
+        t.interpreted = time_ms([&] { interpreted = call(interpreter, fib_n); });
+        t.jit = time_ms([&] { compiled = call(jit, fib_n); });
+        t.native = time_ms([&] { native = fib(fib_n); });
+        report("fib(" + std::to_string(fib_n) + ")", t, interpreted == native && compiled == native);
+    }
+
+    {
+        auto const pages = static_cast<std::uint32_t>(sieve_n) * 4 / (64 * 1024) + 1;
+        auto interpreter = instantiate(sieve_module(pages), Engine::Interpreter);
+        auto jit = instantiate(sieve_module(pages), Engine::Jit);
+        std::vector<std::int32_t> composite(static_cast<std::size_t>(sieve_n));
+        std::int32_t interpreted{};
+        std::int32_t compiled{};
+        int native{};
+        Timings t;
+        t.interpreted = time_ms([&] { interpreted = call(interpreter, sieve_n); });
+        t.jit = time_ms([&] { compiled = call(jit, sieve_n); });
+        t.native = time_ms([&] { native = sieve(composite); });
+        report("sieve(" + std::to_string(sieve_n) + ")", t, interpreted == native && compiled == native);
+    }
+
+    {
+        auto const n = static_cast<std::size_t>(matmul_n);
+        auto const pages = static_cast<std::uint32_t>(3 * n * n * 4 / (64 * 1024) + 1);
+        auto interpreter = instantiate(matmul_module(static_cast<std::uint32_t>(n), pages), Engine::Interpreter);
+        auto jit = instantiate(matmul_module(static_cast<std::uint32_t>(n), pages), Engine::Jit);
+
+        std::vector<std::int32_t> matrices(3 * n * n);
+        for (std::size_t i = 0; i < 2 * n * n; ++i) {
+            matrices[i] = static_cast<std::int32_t>(i % 7) - 3;
+        }
+        // The host is assumed to be little-endian, like wasm.
+        std::memcpy(interpreter.memory().data(), matrices.data(), 2 * n * n * 4);
+        std::memcpy(jit.memory().data(), matrices.data(), 2 * n * n * 4);
+
+        Timings t;
+        t.interpreted = time_ms([&] { call(interpreter, matmul_n); });
+        t.jit = time_ms([&] { call(jit, matmul_n); });
+        t.native = time_ms([&] {
+            matmul(std::span{matrices}.first(n * n),
+                    std::span{matrices}.subspan(n * n, n * n),
+                    std::span{matrices}.subspan(2 * n * n),
+                    n);
+        });
+        auto const matches = [&](Instance &instance) {
+            auto const result = instance.memory().subspan(2 * n * n * 4, n * n * 4);
+            return std::memcmp(result.data(), matrices.data() + 2 * n * n, result.size()) == 0;
+        };
+        report("matmul(" + std::to_string(matmul_n) + ")", t, matches(interpreter) && matches(jit));
+    }
+}
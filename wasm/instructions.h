@@ -36,6 +36,7 @@ struct Loop;
 struct Branch;
 struct BranchIf;
 struct Return;
+struct Call;
 struct End;
 
 // Numeric instructions
@@ -85,12 +86,14 @@ struct LocalTee;
 
 // Memory instructions
 struct I32Load;
+struct I32Store;
 
 using Instruction = std::variant<Block,
         Loop,
         Branch,
         BranchIf,
         Return,
+        Call,
         End,
         I32Const,
         I32EqualZero,
@@ -133,7 +136,8 @@ using Instruction = std::variant<Block,
         LocalGet,
         LocalSet,
         LocalTee,
-        I32Load>;
+        I32Load,
+        I32Store>;
 
 // https://webassembly.github.io/spec/core/binary/instructions.html#control-instructions
 struct Block {
@@ -172,6 +176,13 @@ struct Return {
     [[nodiscard]] bool operator==(Return const &) const = default;
 };
 
+struct Call {
+    static constexpr std::uint8_t kOpcode = 0x10;
+    static constexpr std::string_view kMnemonic = "call";
+    FuncIdx function_idx{};
+    [[nodiscard]] bool operator==(Call const &) const = default;
+};
+
 struct End {
     static constexpr std::uint8_t kOpcode = 0x0b;
     static constexpr std::string_view kMnemonic = "end";
@@ -438,6 +449,13 @@ struct I32Load {
     [[nodiscard]] bool operator==(I32Load const &) const = default;
 };
 
+struct I32Store {
+    static constexpr std::uint8_t kOpcode = 0x36;
+    static constexpr std::string_view kMnemonic = "i32.store";
+    MemArg arg{};
+    [[nodiscard]] bool operator==(I32Store const &) const = default;
+};
+
 } // namespace wasm::instructions
 
 #endif
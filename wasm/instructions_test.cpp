@@ -81,6 +81,16 @@ int main() {
         a.expect_eq(parse("\x0d\x80\x0b"), std::nullopt);
     });
 
+    s.add_test("call", [](etest::IActions &a) {
+        // Valid function index.
+        a.expect_eq(parse("\x10\x09\x0b"), InsnVec{Call{.function_idx = 0x09}});
+
+        // Unexpected eof.
+        a.expect_eq(parse("\x10"), std::nullopt);
+        // Invalid function index.
+        a.expect_eq(parse("\x10\x80\x0b"), std::nullopt);
+    });
+
     s.add_test("i32_const", [](etest::IActions &a) {
         // Valid value.
         a.expect_eq(parse("\x41\x20\x0b"), InsnVec{I32Const{.value = 0x20}});
@@ -275,6 +285,18 @@ int main() {
         a.expect_eq(parse("\x28\x0a\x80\x0b"), std::nullopt);
     });
 
+    s.add_test("i32_store", [](etest::IActions &a) {
+        // Valid memarg.
+        a.expect_eq(parse("\x36\x02\x0c\x0b"), InsnVec{I32Store{MemArg{.align = 0x02, .offset = 0x0c}}});
+
+        // Unexpected eof.
+        a.expect_eq(parse("\x36"), std::nullopt);
+        a.expect_eq(parse("\x36\x02"), std::nullopt);
+        // Invalid memarg.
+        a.expect_eq(parse("\x36\x80\x0a\x0b"), std::nullopt);
+        a.expect_eq(parse("\x36\x0a\x80\x0b"), std::nullopt);
+    });
+
     s.add_test("unhandled opcode", [](etest::IActions &a) {
         a.expect_eq(parse("\xff"), std::nullopt); //
     });
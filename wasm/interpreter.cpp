@@ -0,0 +1,724 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "wasm/interpreter.h"
+
+#include "wasm/bytecode.h"
+#include "wasm/jit.h"
+#include "wasm/types.h"
+#include "wasm/validation.h"
+#include "wasm/wasm.h"
+
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Threaded dispatch jumps straight from one op's handler to the next through
+// a table of label addresses, which is a GNU extension.
+#if defined(__GNUC__)
+#define WASM_INTERPRETER_THREADED
+#endif
+
+namespace wasm {
+namespace {
+
+using bytecode::Function;
+using bytecode::Op;
+using bytecode::OpCode;
+
+constexpr std::uint64_t kPageSize = 64 * 1024;
+// Everything below is made up, but generous enough for anything we'd run.
+constexpr std::uint32_t kMaxPages = 16 * 1024;
+constexpr std::uint64_t kMaxLocals = 50'000;
+constexpr std::size_t kStackSlots = std::size_t{512} * 1024;
+constexpr std::size_t kMaxCallDepth = std::size_t{16} * 1024;
+// How much of the native stack compiled code may use.
+constexpr std::uintptr_t kNativeStackSize = std::uintptr_t{512} * 1024;
+
+struct Host {
+    FunctionType type;
+    std::function<std::vector<Value>(std::span<Value const>, std::span<std::byte>)> function;
+};
+
+bool is_supported(ValueType type) {
+    switch (type) {
+        case ValueType::Int32:
+        case ValueType::Int64:
+        case ValueType::Float32:
+        case ValueType::Float64:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool is_supported(FunctionType const &type) {
+    return std::ranges::all_of(type.parameters, [](auto t) { return is_supported(t); })
+            && std::ranges::all_of(type.results, [](auto t) { return is_supported(t); });
+}
+
+// Values are stored zero-extended in 64-bit slots, w/ floats as their bits.
+std::uint64_t to_slot(Value const &value) {
+    if (auto const *i32 = std::get_if<std::int32_t>(&value)) {
+        return static_cast<std::uint32_t>(*i32);
+    }
+    if (auto const *i64 = std::get_if<std::int64_t>(&value)) {
+        return static_cast<std::uint64_t>(*i64);
+    }
+    if (auto const *f32 = std::get_if<float>(&value)) {
+        return std::bit_cast<std::uint32_t>(*f32);
+    }
+    return std::bit_cast<std::uint64_t>(std::get<double>(value));
+}
+
+Value from_slot(ValueType type, std::uint64_t slot) {
+    switch (type) {
+        case ValueType::Int64:
+            return static_cast<std::int64_t>(slot);
+        case ValueType::Float32:
+            return std::bit_cast<float>(static_cast<std::uint32_t>(slot));
+        case ValueType::Float64:
+            return std::bit_cast<double>(slot);
+        default:
+            return static_cast<std::int32_t>(static_cast<std::uint32_t>(slot));
+    }
+}
+
+bool has_type(Value const &value, ValueType type) {
+    switch (type) {
+        case ValueType::Int32:
+            return std::holds_alternative<std::int32_t>(value);
+        case ValueType::Int64:
+            return std::holds_alternative<std::int64_t>(value);
+        case ValueType::Float32:
+            return std::holds_alternative<float>(value);
+        case ValueType::Float64:
+            return std::holds_alternative<double>(value);
+        default:
+            return false;
+    }
+}
+
+bool has_types(std::span<Value const> values, std::span<ValueType const> types) {
+    return values.size() == types.size()
+            && std::ranges::equal(values, types, [](auto const &v, auto t) { return has_type(v, t); });
+}
+
+// Truncates towards zero, trapping if the result doesn't fit. The bounds are
+// the closest values outside of the integer's range.
+template<typename Int, typename Float>
+tl::expected<std::uint32_t, Trap> truncate(Float f, Float below, Float above) {
+    if (std::isnan(f)) {
+        return tl::unexpected{Trap::InvalidConversionToInteger};
+    }
+
+    if (!(f > below && f < above)) {
+        return tl::unexpected{Trap::IntegerOverflow};
+    }
+
+    return static_cast<std::uint32_t>(static_cast<Int>(f));
+}
+
+// Wasm memory is little-endian.
+std::uint32_t load_u32(std::byte const *p) {
+    std::uint32_t v{};
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big) {
+        v = std::byteswap(v);
+    }
+    return v;
+}
+
+void store_u32(std::byte *p, std::uint32_t v) {
+    if constexpr (std::endian::native == std::endian::big) {
+        v = std::byteswap(v);
+    }
+    std::memcpy(p, &v, sizeof(v));
+}
+
+struct CallFrame {
+    Op const *return_pc{};
+    std::uint64_t *fp{};
+};
+
+} // namespace
+
+struct Instance::Impl {
+    std::vector<Host> hosts;
+    std::vector<Function> functions;
+    std::map<std::string, FuncIdx, std::less<>> exports;
+    std::vector<std::byte> memory;
+
+    std::unique_ptr<std::uint64_t[]> stack{std::make_unique_for_overwrite<std::uint64_t[]>(kStackSlots)};
+    std::vector<CallFrame> frames;
+
+    std::optional<jit::Code> jit;
+    jit::Context jit_context;
+
+    tl::expected<void, Trap> call_host(Host const &, std::uint64_t *args);
+    tl::expected<void, Trap> run(Function const &, std::uint64_t *fp);
+    tl::expected<void, Trap> call_compiled(std::uint32_t idx, std::uint64_t *fp);
+
+    static std::uint32_t call_host_thunk(jit::Context *, std::uint32_t idx, std::uint64_t *fp);
+    static std::uint32_t call_interpreted_thunk(jit::Context *, std::uint32_t idx, std::uint64_t *fp);
+};
+
+tl::expected<void, Trap> Instance::Impl::call_compiled(std::uint32_t idx, std::uint64_t *fp) {
+    if (auto const trap = jit->call(jit_context, idx, fp); trap != 0) {
+        return tl::unexpected{static_cast<Trap>(trap - 1)};
+    }
+
+    return {};
+}
+
+std::uint32_t Instance::Impl::call_host_thunk(jit::Context *ctx, std::uint32_t idx, std::uint64_t *fp) {
+    auto &impl = *static_cast<Impl *>(ctx->instance);
+    auto const result = impl.call_host(impl.hosts[idx], fp);
+    return result ? 0 : static_cast<std::uint32_t>(result.error()) + 1;
+}
+
+std::uint32_t Instance::Impl::call_interpreted_thunk(jit::Context *ctx, std::uint32_t idx, std::uint64_t *fp) {
+    auto &impl = *static_cast<Impl *>(ctx->instance);
+    auto const result = impl.run(impl.functions[idx], fp);
+    return result ? 0 : static_cast<std::uint32_t>(result.error()) + 1;
+}
+
+tl::expected<void, Trap> Instance::Impl::call_host(Host const &host, std::uint64_t *args) {
+    std::vector<Value> values;
+    values.reserve(host.type.parameters.size());
+    for (std::size_t i = 0; i < host.type.parameters.size(); ++i) {
+        values.push_back(from_slot(host.type.parameters[i], args[i]));
+    }
+
+    auto const results = host.function(values, memory);
+    if (!has_types(results, host.type.results)) {
+        return tl::unexpected{Trap::HostResultMismatch};
+    }
+
+    std::ranges::transform(results, args, to_slot);
+    return {};
+}
+
+// The function's arguments are expected to be in the first slots of its
+// frame, and its results are left there. Compiled code calling interpreted
+// functions makes this reentrant, so only the frames pushed by this call are
+// popped.
+tl::expected<void, Trap> Instance::Impl::run(Function const &entry, std::uint64_t *fp) {
+    auto *const stack_end = stack.get() + kStackSlots;
+    if (fp + entry.frame_size > stack_end) {
+        return tl::unexpected{Trap::CallStackExhausted};
+    }
+
+    std::fill(fp + entry.type.parameters.size(), fp + entry.locals, std::uint64_t{0});
+    std::uint64_t *sp = fp + entry.locals;
+    Op const *pc = entry.code.data();
+    std::byte *const mem = memory.data();
+    std::uint64_t const mem_size = memory.size();
+    auto const base_frame = frames.size();
+
+    auto const u32 = [](std::uint64_t slot) {
+        return static_cast<std::uint32_t>(slot);
+    };
+    auto const s32 = [](std::uint64_t slot) {
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(slot));
+    };
+    auto const f32 = [](std::uint64_t slot) {
+        return std::bit_cast<float>(static_cast<std::uint32_t>(slot));
+    };
+    auto const offset = [](std::uint32_t a) {
+        return static_cast<std::ptrdiff_t>(static_cast<std::int32_t>(a));
+    };
+
+#ifdef WASM_INTERPRETER_THREADED
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+    static void *const kHandlers[] = {
+#define WASM_OP_HANDLER(name) &&op_##name,
+            WASM_ALL_OPS(WASM_OP_HANDLER)
+#undef WASM_OP_HANDLER
+    };
+#define WASM_CASE(name) op_##name:
+#define WASM_DISPATCH() goto *kHandlers[static_cast<std::size_t>(pc->code)]
+    WASM_DISPATCH();
+#else
+#define WASM_CASE(name) case OpCode::name:
+#define WASM_DISPATCH() continue
+    for (;;) {
+        switch (pc->code) {
+#endif
+
+    WASM_CASE(Jump) {
+        pc += offset(pc->a);
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(JumpIf) {
+        pc += u32(*--sp) != 0 ? offset(pc->a) : 1;
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(Branch) {
+        auto *const dst = fp + pc->b;
+        sp = std::copy(sp - pc->c, sp, dst);
+        pc += offset(pc->a);
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(BranchIf) {
+        if (u32(*--sp) == 0) {
+            ++pc;
+            WASM_DISPATCH();
+        }
+
+        auto *const dst = fp + pc->b;
+        sp = std::copy(sp - pc->c, sp, dst);
+        pc += offset(pc->a);
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(ReturnIf) {
+        if (u32(*--sp) == 0) {
+            ++pc;
+            WASM_DISPATCH();
+        }
+
+        goto op_return;
+    }
+
+    WASM_CASE(Return) {
+    op_return:
+        std::copy(sp - pc->a, sp, fp);
+        if (frames.size() == base_frame) {
+            return {};
+        }
+
+        sp = fp + pc->a;
+        pc = frames.back().return_pc;
+        fp = frames.back().fp;
+        frames.pop_back();
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(Call) {
+        auto const &callee = functions[pc->a];
+        auto *const callee_fp = sp - pc->b;
+        if (callee_fp + callee.frame_size > stack_end || frames.size() >= kMaxCallDepth) {
+            return tl::unexpected{Trap::CallStackExhausted};
+        }
+
+        frames.push_back(CallFrame{pc + 1, fp});
+        fp = callee_fp;
+        sp = std::fill_n(sp, callee.locals - pc->b, std::uint64_t{0});
+        pc = callee.code.data();
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(CallHost) {
+        auto const &host = hosts[pc->a];
+        sp -= host.type.parameters.size();
+        if (sp + host.type.results.size() > stack_end) {
+            return tl::unexpected{Trap::CallStackExhausted};
+        }
+
+        if (auto result = call_host(host, sp); !result) {
+            return result;
+        }
+
+        sp += host.type.results.size();
+        ++pc;
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(CallCompiled) {
+        auto *const callee_fp = sp - pc->b;
+        if (auto result = call_compiled(pc->a, callee_fp); !result) {
+            return result;
+        }
+
+        sp = callee_fp + pc->c;
+        ++pc;
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(I32Const) {
+        *sp++ = pc->a;
+        ++pc;
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(LocalGet) {
+        *sp++ = fp[pc->a];
+        ++pc;
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(LocalSet) {
+        fp[pc->a] = *--sp;
+        ++pc;
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(LocalTee) {
+        fp[pc->a] = sp[-1];
+        ++pc;
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(I32Load) {
+        auto const address = std::uint64_t{u32(sp[-1])} + pc->a;
+        if (address + 4 > mem_size) {
+            return tl::unexpected{Trap::MemoryOutOfBounds};
+        }
+
+        sp[-1] = load_u32(mem + address);
+        ++pc;
+        WASM_DISPATCH();
+    }
+
+    WASM_CASE(I32Store) {
+        auto const value = u32(*--sp);
+        auto const address = std::uint64_t{u32(*--sp)} + pc->a;
+        if (address + 4 > mem_size) {
+            return tl::unexpected{Trap::MemoryOutOfBounds};
+        }
+
+        store_u32(mem + address, value);
+        ++pc;
+        WASM_DISPATCH();
+    }
+
+#define WASM_UNARY(name, expr) \
+    WASM_CASE(name) { \
+        auto const v = sp[-1]; \
+        sp[-1] = static_cast<std::uint32_t>(expr); \
+        ++pc; \
+        WASM_DISPATCH(); \
+    }
+
+#define WASM_TRUNCATE(name, Int, f, below, above) \
+    WASM_CASE(name) { \
+        auto const v = sp[-1]; \
+        auto const result = truncate<Int>(f, below, above); \
+        if (!result) { \
+            return tl::unexpected{result.error()}; \
+        } \
+        sp[-1] = *result; \
+        ++pc; \
+        WASM_DISPATCH(); \
+    }
+
+#define WASM_BINARY(name, expr) \
+    WASM_CASE(name) { \
+        auto const rhs = *--sp; \
+        auto const lhs = sp[-1]; \
+        sp[-1] = static_cast<std::uint32_t>(expr); \
+        ++pc; \
+        WASM_DISPATCH(); \
+    }
+
+#define WASM_DIVISION(name, expr) \
+    WASM_CASE(name) { \
+        auto const rhs = *--sp; \
+        auto const lhs = sp[-1]; \
+        if (u32(rhs) == 0) { \
+            return tl::unexpected{Trap::IntegerDivideByZero}; \
+        } \
+        sp[-1] = static_cast<std::uint32_t>(expr); \
+        ++pc; \
+        WASM_DISPATCH(); \
+    }
+
+    WASM_UNARY(I32EqualZero, u32(v) == 0)
+    WASM_UNARY(I32CountLeadingZeros, std::countl_zero(u32(v)))
+    WASM_UNARY(I32CountTrailingZeros, std::countr_zero(u32(v)))
+    WASM_UNARY(I32PopulationCount, std::popcount(u32(v)))
+    WASM_UNARY(I32WrapI64, v)
+    WASM_UNARY(I32Extend8Signed, static_cast<std::int8_t>(v))
+    WASM_UNARY(I32Extend16Signed, static_cast<std::int16_t>(v))
+    WASM_TRUNCATE(I32TruncateF32Signed, std::int32_t, f32(v), -2147483904.F, 2147483648.F)
+    WASM_TRUNCATE(I32TruncateF32Unsigned, std::uint32_t, f32(v), -1.F, 4294967296.F)
+    WASM_TRUNCATE(I32TruncateF64Signed, std::int32_t, std::bit_cast<double>(v), -2147483649., 2147483648.)
+    WASM_TRUNCATE(I32TruncateF64Unsigned, std::uint32_t, std::bit_cast<double>(v), -1., 4294967296.)
+
+    WASM_BINARY(I32Equal, u32(lhs) == u32(rhs))
+    WASM_BINARY(I32NotEqual, u32(lhs) != u32(rhs))
+    WASM_BINARY(I32LessThanSigned, s32(lhs) < s32(rhs))
+    WASM_BINARY(I32LessThanUnsigned, u32(lhs) < u32(rhs))
+    WASM_BINARY(I32GreaterThanSigned, s32(lhs) > s32(rhs))
+    WASM_BINARY(I32GreaterThanUnsigned, u32(lhs) > u32(rhs))
+    WASM_BINARY(I32LessThanEqualSigned, s32(lhs) <= s32(rhs))
+    WASM_BINARY(I32LessThanEqualUnsigned, u32(lhs) <= u32(rhs))
+    WASM_BINARY(I32GreaterThanEqualSigned, s32(lhs) >= s32(rhs))
+    WASM_BINARY(I32GreaterThanEqualUnsigned, u32(lhs) >= u32(rhs))
+    WASM_BINARY(I32Add, u32(lhs) + u32(rhs))
+    WASM_BINARY(I32Subtract, u32(lhs) - u32(rhs))
+    WASM_BINARY(I32Multiply, u32(lhs) * u32(rhs))
+    WASM_BINARY(I32And, u32(lhs) & u32(rhs))
+    WASM_BINARY(I32Or, u32(lhs) | u32(rhs))
+    WASM_BINARY(I32ExclusiveOr, u32(lhs) ^ u32(rhs))
+    WASM_BINARY(I32ShiftLeft, u32(lhs) << (u32(rhs) & 31))
+    WASM_BINARY(I32ShiftRightSigned, s32(lhs) >> (u32(rhs) & 31))
+    WASM_BINARY(I32ShiftRightUnsigned, u32(lhs) >> (u32(rhs) & 31))
+    WASM_BINARY(I32RotateLeft, std::rotl(u32(lhs), static_cast<int>(u32(rhs) & 31)))
+    WASM_BINARY(I32RotateRight, std::rotr(u32(lhs), static_cast<int>(u32(rhs) & 31)))
+    WASM_DIVISION(I32DivideUnsigned, u32(lhs) / u32(rhs))
+    WASM_DIVISION(I32RemainderUnsigned, u32(lhs) % u32(rhs))
+    // INT_MIN % -1 overflows in C++, but is 0 in wasm.
+    WASM_DIVISION(I32RemainderSigned, s32(rhs) == -1 ? 0 : s32(lhs) % s32(rhs))
+
+    WASM_CASE(I32DivideSigned) {
+        auto const rhs = s32(*--sp);
+        auto const lhs = s32(sp[-1]);
+        if (rhs == 0) {
+            return tl::unexpected{Trap::IntegerDivideByZero};
+        }
+
+        if (lhs == std::numeric_limits<std::int32_t>::min() && rhs == -1) {
+            return tl::unexpected{Trap::IntegerOverflow};
+        }
+
+        sp[-1] = static_cast<std::uint32_t>(lhs / rhs);
+        ++pc;
+        WASM_DISPATCH();
+    }
+
+#undef WASM_UNARY
+#undef WASM_TRUNCATE
+#undef WASM_BINARY
+#undef WASM_DIVISION
+#undef WASM_CASE
+#undef WASM_DISPATCH
+#ifdef WASM_INTERPRETER_THREADED
+#pragma GCC diagnostic pop
+#else
+        }
+    }
+#endif
+}
+
+Instance::Instance(std::unique_ptr<Impl> impl) : impl_{std::move(impl)} {}
+Instance::Instance(Instance &&) noexcept = default;
+Instance &Instance::operator=(Instance &&) noexcept = default;
+Instance::~Instance() = default;
+
+tl::expected<Instance, InstantiationError> Instance::create(
+        Module const &m, std::vector<HostFunction> imports, Engine engine) {
+    if (!validation::validate(m).has_value()) {
+        return tl::unexpected{InstantiationError::InvalidModule};
+    }
+
+    auto impl = std::make_unique<Impl>();
+    auto const type_of = [&m](TypeIdx idx) -> FunctionType const * {
+        if (!m.type_section || idx >= m.type_section->types.size()) {
+            return nullptr;
+        }
+
+        return &m.type_section->types[idx];
+    };
+
+    std::vector<FunctionType const *> function_types;
+    if (m.import_section) {
+        for (auto const &import : m.import_section->imports) {
+            auto const *type_idx = std::get_if<TypeIdx>(&import.description);
+            if (type_idx == nullptr) {
+                return tl::unexpected{InstantiationError::ImportUnsupported};
+            }
+
+            auto host = std::ranges::find_if(
+                    imports, [&](auto const &h) { return h.module == import.module && h.name == import.name; });
+            if (host == imports.end()) {
+                return tl::unexpected{InstantiationError::ImportUndefined};
+            }
+
+            auto const *type = type_of(*type_idx);
+            if (type == nullptr) {
+                return tl::unexpected{InstantiationError::InvalidModule};
+            }
+
+            function_types.push_back(type);
+            impl->hosts.push_back(Host{*type, std::move(host->function)});
+        }
+    }
+
+    auto const imported = function_types.size();
+    if (m.function_section) {
+        for (auto type_idx : m.function_section->type_indices) {
+            function_types.push_back(type_of(type_idx));
+        }
+    }
+
+    auto const defined = function_types.size() - imported;
+    auto const code_entries = m.code_section ? m.code_section->entries.size() : 0;
+    if (std::ranges::find(function_types, nullptr) != function_types.end() || code_entries != defined) {
+        return tl::unexpected{InstantiationError::InvalidModule};
+    }
+
+    if (!std::ranges::all_of(function_types, [](auto const *t) { return is_supported(*t); })) {
+        return tl::unexpected{InstantiationError::UnsupportedValueType};
+    }
+
+    if (m.memory_section && !m.memory_section->memories.empty()) {
+        auto const pages = m.memory_section->memories[0].min;
+        if (pages > kMaxPages) {
+            return tl::unexpected{InstantiationError::MemoryTooLarge};
+        }
+
+        impl->memory.resize(pages * kPageSize);
+    }
+
+    for (std::size_t i = imported; i < function_types.size(); ++i) {
+        auto const &entry = m.code_section->entries[i - imported];
+        std::uint64_t locals = function_types[i]->parameters.size();
+        for (auto const &local : entry.locals) {
+            if (!is_supported(local.type)) {
+                return tl::unexpected{InstantiationError::UnsupportedValueType};
+            }
+
+            locals += local.count;
+        }
+
+        if (locals > kMaxLocals) {
+            return tl::unexpected{InstantiationError::TooManyLocals};
+        }
+
+        auto &f = impl->functions.emplace_back(Function{
+                .type = *function_types[i],
+                .locals = static_cast<std::uint32_t>(locals),
+        });
+        if (!bytecode::lower(m, function_types, imported, entry.code, f)) {
+            return tl::unexpected{InstantiationError::InvalidModule};
+        }
+    }
+
+    if (engine == Engine::Jit) {
+        impl->jit = jit::Code::compile(impl->functions,
+                {.call_host = &Impl::call_host_thunk, .call_interpreted = &Impl::call_interpreted_thunk});
+    }
+
+    // Interpreted functions call compiled ones directly rather than
+    // interpreting them.
+    if (impl->jit) {
+        for (std::uint32_t i = 0; i < impl->functions.size(); ++i) {
+            if (impl->jit->is_compiled(i)) {
+                continue;
+            }
+
+            for (auto &op : impl->functions[i].code) {
+                if (op.code == OpCode::Call && impl->jit->is_compiled(op.a)) {
+                    op.code = OpCode::CallCompiled;
+                }
+            }
+        }
+    }
+
+    if (m.export_section) {
+        for (auto const &e : m.export_section->exports) {
+            if (e.type == Export::Type::Function) {
+                impl->exports.emplace(e.name, e.index);
+            }
+        }
+    }
+
+    Instance instance{std::move(impl)};
+    if (m.start_section && !instance.call(m.start_section->start).has_value()) {
+        return tl::unexpected{InstantiationError::StartFunctionTrapped};
+    }
+
+    return instance;
+}
+
+tl::expected<std::vector<Value>, Trap> Instance::call(FuncIdx idx, std::span<Value const> args) {
+    auto &impl = *impl_;
+    if (idx >= impl.hosts.size() + impl.functions.size()) {
+        return tl::unexpected{Trap::FunctionUndefined};
+    }
+
+    auto const is_host = idx < impl.hosts.size();
+    auto const &type = is_host ? impl.hosts[idx].type : impl.functions[idx - impl.hosts.size()].type;
+    if (!has_types(args, type.parameters)) {
+        return tl::unexpected{Trap::ArgumentMismatch};
+    }
+
+    auto *const fp = impl.stack.get();
+    std::ranges::transform(args, fp, to_slot);
+    impl.frames.clear();
+
+    // Set up for compiled code each call, since the instance may have moved.
+    if (impl.jit) {
+        int native_stack_top{};
+        impl.jit_context = jit::Context{
+                .native_stack_limit = reinterpret_cast<std::uintptr_t>(&native_stack_top) - kNativeStackSize,
+                .value_stack_end = impl.stack.get() + kStackSlots,
+                .memory = impl.memory.data(),
+                .memory_size = impl.memory.size(),
+                .instance = &impl,
+        };
+    }
+
+    auto const function_idx = static_cast<std::uint32_t>(idx - impl.hosts.size());
+    tl::expected<void, Trap> result;
+    if (is_host) {
+        result = impl.call_host(impl.hosts[idx], fp);
+    } else if (is_compiled(idx)) {
+        result = impl.call_compiled(function_idx, fp);
+    } else {
+        result = impl.run(impl.functions[function_idx], fp);
+    }
+
+    if (!result) {
+        return tl::unexpected{result.error()};
+    }
+
+    std::vector<Value> results;
+    results.reserve(type.results.size());
+    for (std::size_t i = 0; i < type.results.size(); ++i) {
+        results.push_back(from_slot(type.results[i], fp[i]));
+    }
+
+    return results;
+}
+
+tl::expected<std::vector<Value>, Trap> Instance::call(std::string_view export_name, std::span<Value const> args) {
+    auto idx = exported_function(export_name);
+    if (!idx) {
+        return tl::unexpected{Trap::FunctionUndefined};
+    }
+
+    return call(*idx, args);
+}
+
+std::optional<FuncIdx> Instance::exported_function(std::string_view name) const {
+    if (auto it = impl_->exports.find(name); it != impl_->exports.end()) {
+        return it->second;
+    }
+
+    return std::nullopt;
+}
+
+bool Instance::is_compiled(FuncIdx idx) const {
+    return idx >= impl_->hosts.size() && impl_->jit
+            && impl_->jit->is_compiled(static_cast<std::uint32_t>(idx - impl_->hosts.size()));
+}
+
+std::span<std::byte> Instance::memory() {
+    return impl_->memory;
+}
+
+} // namespace wasm
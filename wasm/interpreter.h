@@ -0,0 +1,137 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef WASM_INTERPRETER_H_
+#define WASM_INTERPRETER_H_
+
+#include "wasm/types.h"
+#include "wasm/wasm.h"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace wasm {
+
+// https://webassembly.github.io/spec/core/exec/runtime.html#values
+using Value = std::variant<std::int32_t, std::int64_t, float, double>;
+
+enum class InstantiationError : std::uint8_t {
+    ImportUndefined,
+    ImportUnsupported,
+    InvalidModule,
+    MemoryTooLarge,
+    StartFunctionTrapped,
+    TooManyLocals,
+    UnsupportedValueType,
+};
+
+constexpr std::string_view to_string(InstantiationError e) {
+    switch (e) {
+        case InstantiationError::ImportUndefined:
+            return "Imported function not provided by the host";
+        case InstantiationError::ImportUnsupported:
+            return "Only function imports are supported";
+        case InstantiationError::InvalidModule:
+            return "Module failed validation";
+        case InstantiationError::MemoryTooLarge:
+            return "Memory larger than the interpreter supports";
+        case InstantiationError::StartFunctionTrapped:
+            return "Start function trapped";
+        case InstantiationError::TooManyLocals:
+            return "Function has more locals than the interpreter supports";
+        case InstantiationError::UnsupportedValueType:
+            return "Function uses vector or reference types";
+    }
+    return "Unknown error";
+}
+
+// https://webassembly.github.io/spec/core/intro/overview.html#trap
+// Also covers calls into the instance that couldn't be made.
+enum class Trap : std::uint8_t {
+    ArgumentMismatch,
+    CallStackExhausted,
+    FunctionUndefined,
+    HostResultMismatch,
+    IntegerDivideByZero,
+    IntegerOverflow,
+    InvalidConversionToInteger,
+    MemoryOutOfBounds,
+};
+
+constexpr std::string_view to_string(Trap e) {
+    switch (e) {
+        case Trap::ArgumentMismatch:
+            return "Arguments don't match the function's parameters";
+        case Trap::CallStackExhausted:
+            return "Call stack exhausted";
+        case Trap::FunctionUndefined:
+            return "No such function";
+        case Trap::HostResultMismatch:
+            return "Host function results don't match its type";
+        case Trap::IntegerDivideByZero:
+            return "Integer divide by zero";
+        case Trap::IntegerOverflow:
+            return "Integer overflow";
+        case Trap::InvalidConversionToInteger:
+            return "Invalid conversion to integer";
+        case Trap::MemoryOutOfBounds:
+            return "Out of bounds memory access";
+    }
+    return "Unknown error";
+}
+
+// A function provided by the embedder for a module to import. It gets the
+// arguments and the instance's memory, which is empty if it has none.
+struct HostFunction {
+    std::string module;
+    std::string name;
+    std::function<std::vector<Value>(std::span<Value const> args, std::span<std::byte> memory)> function;
+};
+
+enum class Engine : std::uint8_t {
+    Interpreter,
+    // Compiles what it can to native code, interpreting the rest. The same as
+    // Interpreter on platforms the compiler doesn't support.
+    Jit,
+};
+
+// An instantiated module. Function bodies are lowered into a flat bytecode w/
+// branch targets and stack heights resolved up front, and run by a threaded
+// interpreter or compiled from there. Instances aren't safe to call from
+// several threads at once.
+class Instance {
+public:
+    static tl::expected<Instance, InstantiationError> create(
+            Module const &, std::vector<HostFunction> imports = {}, Engine = Engine::Interpreter);
+
+    Instance(Instance &&) noexcept;
+    Instance &operator=(Instance &&) noexcept;
+    ~Instance();
+
+    tl::expected<std::vector<Value>, Trap> call(FuncIdx, std::span<Value const> args = {});
+    tl::expected<std::vector<Value>, Trap> call(std::string_view export_name, std::span<Value const> args = {});
+
+    std::optional<FuncIdx> exported_function(std::string_view name) const;
+    bool is_compiled(FuncIdx) const;
+    std::span<std::byte> memory();
+
+private:
+    struct Impl;
+    explicit Instance(std::unique_ptr<Impl>);
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace wasm
+
+#endif
@@ -0,0 +1,293 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "wasm/interpreter.h"
+
+#include "wasm/instructions.h"
+#include "wasm/types.h"
+#include "wasm/wasm.h"
+
+#include "etest/etest2.h"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace wasm;
+using namespace wasm::instructions;
+
+namespace {
+
+// A module w/ a single exported function "f" of the given type.
+Module make_module(FunctionType type, std::vector<Instruction> code, std::vector<CodeEntry::Local> locals = {}) {
+    Module m{};
+    m.type_section = TypeSection{.types = {std::move(type)}};
+    m.function_section = FunctionSection{.type_indices = {0}};
+    m.code_section = CodeSection{.entries = {CodeEntry{.code = std::move(code), .locals = std::move(locals)}}};
+    m.export_section = ExportSection{.exports = {Export{.name = "f", .type = Export::Type::Function, .index = 0}}};
+    return m;
+}
+
+tl::expected<std::vector<Value>, Trap> run(Module const &m, std::vector<Value> const &args = {}) {
+    auto instance = Instance::create(m);
+    if (!instance) {
+        return tl::unexpected{Trap::FunctionUndefined};
+    }
+
+    return instance->call("f", args);
+}
+
+constexpr auto kInt32Min = std::numeric_limits<std::int32_t>::min();
+
+FunctionType const kI32ToI32{.parameters = {ValueType::Int32}, .results = {ValueType::Int32}};
+FunctionType const kI32I32ToI32{.parameters = {ValueType::Int32, ValueType::Int32}, .results = {ValueType::Int32}};
+
+} // namespace
+
+int main() {
+    etest::Suite s{"wasm::interpreter"};
+
+    s.add_test("arithmetic", [](etest::IActions &a) {
+        auto m = make_module(FunctionType{.results = {ValueType::Int32}},
+                {I32Const{6}, I32Const{7}, I32Multiply{}, I32Const{2}, I32Subtract{}, I32CountTrailingZeros{}});
+        a.expect_eq(run(m), std::vector<Value>{3});
+
+        m.code_section->entries[0].code = {I32Const{-7}, I32Const{2}, I32DivideSigned{}};
+        a.expect_eq(run(m), std::vector<Value>{-3});
+
+        m.code_section->entries[0].code = {I32Const{-7}, I32Const{2}, I32DivideUnsigned{}};
+        a.expect_eq(run(m), std::vector<Value>{0x7fff'fffc});
+
+        m.code_section->entries[0].code = {I32Const{1}, I32Const{33}, I32ShiftLeft{}};
+        a.expect_eq(run(m), std::vector<Value>{2});
+
+        m.code_section->entries[0].code = {I32Const{0x80}, I32Extend8Signed{}};
+        a.expect_eq(run(m), std::vector<Value>{-128});
+
+        m.code_section->entries[0].code = {I32Const{-1}, I32Const{1}, I32LessThanUnsigned{}};
+        a.expect_eq(run(m), std::vector<Value>{0});
+
+        m.code_section->entries[0].code = {I32Const{-1}, I32Const{1}, I32LessThanSigned{}};
+        a.expect_eq(run(m), std::vector<Value>{1});
+    });
+
+    s.add_test("division traps", [](etest::IActions &a) {
+        auto m = make_module(
+                FunctionType{.results = {ValueType::Int32}}, {I32Const{1}, I32Const{0}, I32DivideSigned{}});
+        a.expect_eq(run(m), tl::unexpected{Trap::IntegerDivideByZero});
+
+        m.code_section->entries[0].code = {I32Const{1}, I32Const{0}, I32RemainderUnsigned{}};
+        a.expect_eq(run(m), tl::unexpected{Trap::IntegerDivideByZero});
+
+        m.code_section->entries[0].code = {I32Const{kInt32Min}, I32Const{-1}, I32DivideSigned{}};
+        a.expect_eq(run(m), tl::unexpected{Trap::IntegerOverflow});
+
+        m.code_section->entries[0].code = {I32Const{kInt32Min}, I32Const{-1}, I32RemainderSigned{}};
+        a.expect_eq(run(m), std::vector<Value>{0});
+    });
+
+    s.add_test("params and locals", [](etest::IActions &a) {
+        // (x, y) -> { tmp = x - y; return tmp * tmp; }
+        auto m = make_module(kI32I32ToI32,
+                {LocalGet{0}, LocalGet{1}, I32Subtract{}, LocalTee{2}, LocalGet{2}, I32Multiply{}},
+                {{.count = 1, .type = ValueType::Int32}});
+        a.expect_eq(run(m, {3, 8}), std::vector<Value>{25});
+
+        // Locals start out zeroed.
+        m.code_section->entries[0].code = {LocalGet{2}, LocalGet{0}, LocalSet{2}, LocalGet{2}, I32Add{}};
+        a.expect_eq(run(m, {3, 8}), std::vector<Value>{3});
+    });
+
+    s.add_test("blocks and branches", [](etest::IActions &a) {
+        // Branching out of a block discards whatever is above the block's
+        // results on the stack.
+        auto m = make_module(kI32ToI32,
+                {Block{.type = {ValueType::Int32},
+                         .instructions = {I32Const{10}, I32Const{20}, LocalGet{0}, BranchIf{0}, I32Add{}}},
+                        I32Const{1},
+                        I32Add{}});
+        a.expect_eq(run(m, {1}), std::vector<Value>{21});
+        a.expect_eq(run(m, {0}), std::vector<Value>{31});
+
+        // Branching out of the function returns.
+        m.code_section->entries[0].code = {I32Const{5}, LocalGet{0}, BranchIf{0}, I32Const{6}, I32Add{}};
+        a.expect_eq(run(m, {1}), std::vector<Value>{5});
+        a.expect_eq(run(m, {0}), std::vector<Value>{11});
+
+        m.code_section->entries[0].code = {Block{.instructions = {I32Const{1}, Return{}}}, I32Const{2}};
+        a.expect_eq(run(m, {0}), std::vector<Value>{1});
+    });
+
+    s.add_test("loop", [](etest::IActions &a) {
+        // Sums the numbers [1, n].
+        auto m = make_module(kI32ToI32,
+                {Loop{.instructions = {LocalGet{1},
+                              LocalGet{0},
+                              I32Add{},
+                              LocalSet{1},
+                              LocalGet{0},
+                              I32Const{1},
+                              I32Subtract{},
+                              LocalTee{0},
+                              BranchIf{0}}},
+                        LocalGet{1}},
+                {{.count = 1, .type = ValueType::Int32}});
+        a.expect_eq(run(m, {100}), std::vector<Value>{5050});
+    });
+
+    s.add_test("recursive calls", [](etest::IActions &a) {
+        auto m = make_module(kI32ToI32,
+                {Block{.instructions = {LocalGet{0},
+                               I32Const{2},
+                               I32GreaterThanEqualSigned{},
+                               BranchIf{0},
+                               LocalGet{0},
+                               Return{}}},
+                        LocalGet{0},
+                        I32Const{1},
+                        I32Subtract{},
+                        Call{0},
+                        LocalGet{0},
+                        I32Const{2},
+                        I32Subtract{},
+                        Call{0},
+                        I32Add{}});
+        a.expect_eq(run(m, {20}), std::vector<Value>{6765});
+    });
+
+    s.add_test("call stack exhaustion", [](etest::IActions &a) {
+        auto m = make_module(FunctionType{}, {Call{0}});
+        auto instance = Instance::create(m);
+        a.require(instance.has_value());
+        a.expect_eq(instance->call("f"), tl::unexpected{Trap::CallStackExhausted});
+
+        // The instance is still usable afterwards.
+        a.expect_eq(instance->call("f"), tl::unexpected{Trap::CallStackExhausted});
+    });
+
+    s.add_test("host functions", [](etest::IActions &a) {
+        auto m = make_module(kI32ToI32, {LocalGet{0}, Call{0}, I32Const{1}, I32Add{}});
+        m.function_section->type_indices = {0};
+        m.import_section = ImportSection{
+                .imports = {Import{.module = "env", .name = "twice", .description = TypeIdx{0}}}};
+        // The module's own function comes after the import.
+        m.export_section->exports[0].index = 1;
+
+        std::vector<Value> seen;
+        auto twice = [&](std::span<Value const> args, std::span<std::byte>) -> std::vector<Value> {
+            seen.assign(args.begin(), args.end());
+            return {std::get<std::int32_t>(args[0]) * 2};
+        };
+
+        auto instance = Instance::create(m, {HostFunction{"env", "twice", twice}});
+        a.require(instance.has_value());
+        a.expect_eq(instance->call("f", std::vector<Value>{21}), std::vector<Value>{43});
+        a.expect_eq(seen, std::vector<Value>{21});
+
+        // Host functions can be called directly too.
+        a.expect_eq(instance->call(0, std::vector<Value>{4}), std::vector<Value>{8});
+
+        auto bad = [](std::span<Value const>, std::span<std::byte>) -> std::vector<Value> { return {1.F}; };
+        instance = Instance::create(m, {HostFunction{"env", "twice", bad}});
+        a.require(instance.has_value());
+        a.expect_eq(instance->call("f", std::vector<Value>{21}), tl::unexpected{Trap::HostResultMismatch});
+
+        a.expect_eq(Instance::create(m).error(), InstantiationError::ImportUndefined);
+        a.expect_eq(Instance::create(m, {HostFunction{"env", "thrice", twice}}).error(),
+                InstantiationError::ImportUndefined);
+    });
+
+    s.add_test("memory", [](etest::IActions &a) {
+        // Stores the argument at address 8 and reads it back w/ an offset.
+        auto m = make_module(kI32ToI32,
+                {I32Const{8},
+                        LocalGet{0},
+                        I32Store{.arg = {.align = 2}},
+                        I32Const{4},
+                        I32Load{.arg = {.align = 2, .offset = 4}}});
+        m.memory_section = MemorySection{.memories = {MemType{.min = 1}}};
+
+        auto instance = Instance::create(m);
+        a.require(instance.has_value());
+        a.expect_eq(instance->call("f", std::vector<Value>{0x1234'5678}), std::vector<Value>{0x1234'5678});
+        a.expect_eq(instance->memory().size(), std::size_t{64 * 1024});
+        a.expect_eq(instance->memory()[8], std::byte{0x78});
+        a.expect_eq(instance->memory()[11], std::byte{0x12});
+
+        m.code_section->entries[0].code = {LocalGet{0}, I32Load{.arg = {.align = 2}}};
+        instance = Instance::create(m);
+        a.require(instance.has_value());
+        a.expect_eq(instance->call("f", std::vector<Value>{64 * 1024 - 4}), std::vector<Value>{0});
+        a.expect_eq(instance->call("f", std::vector<Value>{64 * 1024 - 3}), tl::unexpected{Trap::MemoryOutOfBounds});
+        a.expect_eq(instance->call("f", std::vector<Value>{-1}), tl::unexpected{Trap::MemoryOutOfBounds});
+
+        m.memory_section->memories[0].min = 100'000;
+        a.expect_eq(Instance::create(m).error(), InstantiationError::MemoryTooLarge);
+    });
+
+    s.add_test("truncation", [](etest::IActions &a) {
+        auto m = make_module(FunctionType{.parameters = {ValueType::Float32}, .results = {ValueType::Int32}},
+                {LocalGet{0}, I32TruncateF32Signed{}});
+        auto instance = Instance::create(m);
+        a.require(instance.has_value());
+        a.expect_eq(instance->call("f", std::vector<Value>{-3.9F}), std::vector<Value>{-3});
+        a.expect_eq(instance->call("f", std::vector<Value>{-2147483648.F}), std::vector<Value>{kInt32Min});
+        a.expect_eq(instance->call("f", std::vector<Value>{2147483648.F}), tl::unexpected{Trap::IntegerOverflow});
+        a.expect_eq(instance->call("f", std::vector<Value>{std::numeric_limits<float>::quiet_NaN()}),
+                tl::unexpected{Trap::InvalidConversionToInteger});
+
+        m.type_section->types[0].parameters = {ValueType::Float64};
+        m.code_section->entries[0].code = {LocalGet{0}, I32TruncateF64Unsigned{}};
+        instance = Instance::create(m);
+        a.require(instance.has_value());
+        a.expect_eq(instance->call("f", std::vector<Value>{4294967295.9}), std::vector<Value>{-1});
+        a.expect_eq(instance->call("f", std::vector<Value>{-0.9}), std::vector<Value>{0});
+        a.expect_eq(instance->call("f", std::vector<Value>{-1.0}), tl::unexpected{Trap::IntegerOverflow});
+    });
+
+    s.add_test("calling", [](etest::IActions &a) {
+        auto instance = Instance::create(make_module(kI32ToI32, {LocalGet{0}}));
+        a.require(instance.has_value());
+        a.expect_eq(instance->exported_function("f"), FuncIdx{0});
+        a.expect_eq(instance->exported_function("g"), std::nullopt);
+        a.expect_eq(instance->call(0, std::vector<Value>{5}), std::vector<Value>{5});
+        a.expect_eq(instance->call("g", std::vector<Value>{5}), tl::unexpected{Trap::FunctionUndefined});
+        a.expect_eq(instance->call(1, std::vector<Value>{5}), tl::unexpected{Trap::FunctionUndefined});
+        a.expect_eq(instance->call("f"), tl::unexpected{Trap::ArgumentMismatch});
+        a.expect_eq(instance->call("f", std::vector<Value>{5.0}), tl::unexpected{Trap::ArgumentMismatch});
+    });
+
+    s.add_test("invalid modules", [](etest::IActions &a) {
+        auto m = make_module(kI32ToI32, {I32Add{}});
+        a.expect_eq(Instance::create(m).error(), InstantiationError::InvalidModule);
+
+        m = make_module(kI32ToI32, {LocalGet{0}}, {{.count = 100'000, .type = ValueType::Int32}});
+        a.expect_eq(Instance::create(m).error(), InstantiationError::TooManyLocals);
+
+        m = make_module(kI32ToI32, {LocalGet{0}}, {{.count = 1, .type = ValueType::Vector128}});
+        a.expect_eq(Instance::create(m).error(), InstantiationError::UnsupportedValueType);
+    });
+
+    s.add_test("start function", [](etest::IActions &a) {
+        auto m = make_module(FunctionType{}, {I32Const{0}, I32Const{1}, I32Store{.arg = {.align = 2}}});
+        m.memory_section = MemorySection{.memories = {MemType{.min = 1}}};
+        m.start_section = StartSection{.start = 0};
+        auto instance = Instance::create(m);
+        a.require(instance.has_value());
+        a.expect_eq(instance->memory()[0], std::byte{1});
+
+        m.code_section->entries[0].code = {I32Const{1}, I32Const{0}, I32DivideUnsigned{}, LocalSet{0}};
+        m.code_section->entries[0].locals = {{.count = 1, .type = ValueType::Int32}};
+        a.expect_eq(Instance::create(m).error(), InstantiationError::StartFunctionTrapped);
+    });
+
+    return s.run();
+}
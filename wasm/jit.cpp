@@ -0,0 +1,772 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "wasm/jit.h"
+
+#include "wasm/bytecode.h"
+#include "wasm/interpreter.h"
+
+#include "azm/amd64/assembler.h"
+#include "os/memory.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace wasm::jit {
+namespace {
+
+using namespace azm::amd64;
+using bytecode::Function;
+using bytecode::Op;
+using bytecode::OpCode;
+
+#if (defined(__x86_64__) || defined(__amd64__)) && !defined(_WIN32)
+constexpr bool kSupportedPlatform = true;
+#else
+constexpr bool kSupportedPlatform = false;
+#endif
+
+// Registers pinned for the duration of compiled code. All callee-saved.
+constexpr Reg64 kFp = Reg64::Rbx;
+constexpr Reg64 kMemory = Reg64::R12;
+constexpr Reg64 kMemorySize = Reg64::R13;
+constexpr Reg64 kContext = Reg64::R14;
+
+// Registers the top of the value stack is cached in. EAX, ECX, and EDX are
+// left as scratch registers since division and shifts need them.
+constexpr auto kCacheRegisters =
+        std::to_array({Reg32::Esi, Reg32::Edi, Reg32::R8d, Reg32::R9d, Reg32::R10d, Reg32::R11d});
+
+constexpr std::uint32_t trap_code(Trap trap) {
+    return static_cast<std::uint32_t>(trap) + 1;
+}
+
+Mem slot(std::uint32_t idx) {
+    return Mem{.base = kFp, .disp = static_cast<std::int32_t>(idx * sizeof(std::uint64_t))};
+}
+
+Mem context(std::size_t offset) {
+    return Mem{.base = kContext, .disp = static_cast<std::int32_t>(offset)};
+}
+
+std::optional<Condition> comparison(OpCode code) {
+    switch (code) {
+        case OpCode::I32Equal:
+            return Condition::Equal;
+        case OpCode::I32NotEqual:
+            return Condition::NotEqual;
+        case OpCode::I32LessThanSigned:
+            return Condition::Less;
+        case OpCode::I32LessThanUnsigned:
+            return Condition::Below;
+        case OpCode::I32GreaterThanSigned:
+            return Condition::Greater;
+        case OpCode::I32GreaterThanUnsigned:
+            return Condition::Above;
+        case OpCode::I32LessThanEqualSigned:
+            return Condition::LessOrEqual;
+        case OpCode::I32LessThanEqualUnsigned:
+            return Condition::BelowOrEqual;
+        case OpCode::I32GreaterThanEqualSigned:
+            return Condition::GreaterOrEqual;
+        case OpCode::I32GreaterThanEqualUnsigned:
+            return Condition::AboveOrEqual;
+        default:
+            return std::nullopt;
+    }
+}
+
+bool is_conditional_branch(OpCode code) {
+    return code == OpCode::JumpIf || code == OpCode::BranchIf || code == OpCode::ReturnIf;
+}
+
+bool is_supported(Function const &f) {
+    constexpr auto kMaxDisplacement = static_cast<std::uint64_t>(std::numeric_limits<std::int32_t>::max());
+    if (std::uint64_t{f.frame_size} * sizeof(std::uint64_t) > kMaxDisplacement) {
+        return false;
+    }
+
+    return std::ranges::all_of(f.code, [&](Op const &op) {
+        switch (op.code) {
+            case OpCode::I32CountLeadingZeros:
+            case OpCode::I32CountTrailingZeros:
+            case OpCode::I32PopulationCount:
+            case OpCode::I32TruncateF32Signed:
+            case OpCode::I32TruncateF32Unsigned:
+            case OpCode::I32TruncateF64Signed:
+            case OpCode::I32TruncateF64Unsigned:
+                return false;
+            case OpCode::I32Load:
+            case OpCode::I32Store:
+                return std::uint64_t{op.a} + 4 <= kMaxDisplacement;
+            default:
+                return true;
+        }
+    });
+}
+
+// Code shared by all functions.
+struct Stubs {
+    // Pops the trampoline's frame and returns EAX.
+    Label exit{Label::unlinked()};
+    // Unwinds the native stack to the trampoline and returns the trap in EAX.
+    Label trap{Label::unlinked()};
+    Label call_stack_exhausted{Label::unlinked()};
+    Label integer_divide_by_zero{Label::unlinked()};
+    Label integer_overflow{Label::unlinked()};
+    Label memory_out_of_bounds{Label::unlinked()};
+};
+
+// Compiles one function in a single pass over its ops, keeping the top of the
+// value stack in registers where possible. The registers are written back to
+// the stack before anything that may branch or call, so the stack is always
+// in memory at labels and function boundaries.
+class FunctionCompiler {
+public:
+    FunctionCompiler(Assembler &assembler,
+            Stubs &stubs,
+            std::vector<Label> &entries,
+            std::span<bool const> compiled,
+            Thunks thunks,
+            Function const &f)
+        : a_{assembler}, stubs_{stubs}, entries_{entries}, compiled_{compiled}, thunks_{thunks}, f_{f},
+          labels_(f.code.size()), label_heights_(f.code.size()), height_{f.locals} {}
+
+    void compile(std::uint32_t idx) {
+        std::vector<bool> is_target(f_.code.size());
+        for (std::size_t i = 0; i < f_.code.size(); ++i) {
+            if (auto target = branch_target(i)) {
+                is_target[*target] = true;
+            }
+        }
+
+        a_.link(entries_[idx]);
+        prologue();
+
+        for (std::size_t i = 0; i < f_.code.size(); ++i) {
+            locked_ = 0;
+            if (is_target[i]) {
+                bind(i);
+            }
+
+            if (!live_) {
+                continue;
+            }
+
+            auto const &op = f_.code[i];
+            auto const next_is_fusable = i + 1 < f_.code.size() && !is_target[i + 1]
+                    && is_conditional_branch(f_.code[i + 1].code);
+            if (next_is_fusable && (comparison(op.code) || op.code == OpCode::I32EqualZero)) {
+                compare(op.code, true);
+                branch(i + 1, condition_);
+                ++i;
+                continue;
+            }
+
+            emit(i);
+        }
+    }
+
+private:
+    struct Entry {
+        // Constants aren't materialized until they need to be.
+        std::optional<Reg32> reg;
+        std::uint32_t value{};
+    };
+
+    std::optional<std::size_t> branch_target(std::size_t i) const {
+        switch (f_.code[i].code) {
+            case OpCode::Jump:
+            case OpCode::JumpIf:
+            case OpCode::Branch:
+            case OpCode::BranchIf:
+                return static_cast<std::size_t>(
+                        static_cast<std::ptrdiff_t>(i) + static_cast<std::int32_t>(f_.code[i].a));
+            default:
+                return std::nullopt;
+        }
+    }
+
+    void prologue() {
+        a_.cmp(Reg64::Rsp, context(offsetof(Context, native_stack_limit)));
+        a_.jcc(Condition::Below, stubs_.call_stack_exhausted);
+        a_.lea(Reg64::Rax, slot(f_.frame_size));
+        a_.cmp(Reg64::Rax, context(offsetof(Context, value_stack_end)));
+        a_.jcc(Condition::Above, stubs_.call_stack_exhausted);
+
+        // Zero the locals that aren't parameters.
+        auto const params = static_cast<std::uint32_t>(f_.type.parameters.size());
+        auto const locals = f_.locals - params;
+        if (locals == 0) {
+            return;
+        }
+
+        a_.xor_(Reg32::Eax, Reg32::Eax);
+        if (locals <= 8) {
+            for (std::uint32_t i = params; i < f_.locals; ++i) {
+                a_.mov(slot(i), Reg64::Rax);
+            }
+            return;
+        }
+
+        a_.lea(Reg64::Rdi, slot(params));
+        a_.mov(Reg32::Ecx, Imm32{locals});
+        a_.rep_stosq();
+    }
+
+    // Control flow can only reach labels w/ the whole stack in memory.
+    void bind(std::size_t i) {
+        if (live_) {
+            flush();
+            label_heights_[i] = height_;
+        } else if (label_heights_[i].has_value()) {
+            live_ = true;
+            height_ = *label_heights_[i];
+        }
+
+        if (labels_[i].has_value()) {
+            a_.link(*labels_[i]);
+        } else {
+            labels_[i] = a_.label();
+        }
+    }
+
+    Label &label(std::size_t target, std::uint32_t height) {
+        label_heights_[target] = height;
+        if (!labels_[target].has_value()) {
+            labels_[target] = Label::unlinked();
+        }
+        return *labels_[target];
+    }
+
+    void emit(std::size_t i) {
+        auto const &op = f_.code[i];
+        switch (op.code) {
+            case OpCode::Jump:
+                flush();
+                a_.jmp(label(*branch_target(i), height_));
+                live_ = false;
+                return;
+            case OpCode::Branch:
+                flush();
+                copy(height_ - op.c, op.b, op.c);
+                a_.jmp(label(*branch_target(i), op.b + op.c));
+                live_ = false;
+                return;
+            case OpCode::Return:
+                flush();
+                copy(height_ - op.a, 0, op.a);
+                a_.ret();
+                live_ = false;
+                return;
+            case OpCode::JumpIf:
+            case OpCode::BranchIf:
+            case OpCode::ReturnIf: {
+                auto const reg = pop_reg();
+                flush();
+                a_.test(reg, reg);
+                branch(i, Condition::NotEqual);
+                return;
+            }
+            case OpCode::Call:
+            case OpCode::CallCompiled:
+                if (op.a < compiled_.size() && compiled_[op.a]) {
+                    call(op);
+                } else {
+                    call_thunk(thunks_.call_interpreted, op);
+                }
+                return;
+            case OpCode::CallHost:
+                call_thunk(thunks_.call_host, op);
+                return;
+            case OpCode::I32Const:
+                push(Entry{.value = op.a});
+                return;
+            case OpCode::LocalGet: {
+                auto const reg = alloc();
+                a_.mov(full_width(reg), slot(op.a));
+                push(reg);
+                return;
+            }
+            case OpCode::LocalSet:
+                store(slot(op.a), pop());
+                return;
+            case OpCode::LocalTee: {
+                auto const entry = pop();
+                store(slot(op.a), entry);
+                push(entry);
+                return;
+            }
+            case OpCode::I32Load: {
+                auto const address = pop();
+                bounds_check(address, op.a);
+                auto const reg = address.reg.value_or(alloc());
+                a_.mov(reg, Mem{.base = kMemory, .index = Reg64::Rax, .disp = -4});
+                push(reg);
+                return;
+            }
+            case OpCode::I32Store: {
+                auto const value = pop();
+                bounds_check(pop(), op.a);
+                Mem const dst{.base = kMemory, .index = Reg64::Rax, .disp = -4};
+                if (value.reg) {
+                    a_.mov(dst, *value.reg);
+                } else {
+                    a_.mov(dst, Imm32{value.value});
+                }
+                return;
+            }
+            case OpCode::I32EqualZero:
+            case OpCode::I32Equal:
+            case OpCode::I32NotEqual:
+            case OpCode::I32LessThanSigned:
+            case OpCode::I32LessThanUnsigned:
+            case OpCode::I32GreaterThanSigned:
+            case OpCode::I32GreaterThanUnsigned:
+            case OpCode::I32LessThanEqualSigned:
+            case OpCode::I32LessThanEqualUnsigned:
+            case OpCode::I32GreaterThanEqualSigned:
+            case OpCode::I32GreaterThanEqualUnsigned: {
+                auto const reg = compare(op.code, false);
+                a_.setcc(condition_, low_byte(reg));
+                a_.movzx(reg, low_byte(reg));
+                push(reg);
+                return;
+            }
+            case OpCode::I32WrapI64: {
+                auto const reg = pop_reg();
+                a_.mov(reg, reg);
+                push(reg);
+                return;
+            }
+            case OpCode::I32Extend8Signed: {
+                auto const reg = pop_reg();
+                a_.movsx(reg, low_byte(reg));
+                push(reg);
+                return;
+            }
+            case OpCode::I32Extend16Signed: {
+                auto const reg = pop_reg();
+                a_.movsx(reg, low_word(reg));
+                push(reg);
+                return;
+            }
+            case OpCode::I32Add:
+                return arithmetic(&Assembler::add, &Assembler::add);
+            case OpCode::I32Subtract:
+                return arithmetic(&Assembler::sub, &Assembler::sub);
+            case OpCode::I32And:
+                return arithmetic(&Assembler::and_, &Assembler::and_);
+            case OpCode::I32Or:
+                return arithmetic(&Assembler::or_, &Assembler::or_);
+            case OpCode::I32ExclusiveOr:
+                return arithmetic(&Assembler::xor_, &Assembler::xor_);
+            case OpCode::I32Multiply: {
+                auto const rhs = pop_reg();
+                auto const lhs = pop_reg();
+                a_.imul(lhs, rhs);
+                push(lhs);
+                return;
+            }
+            case OpCode::I32ShiftLeft:
+                return shift(&Assembler::shl, &Assembler::shl);
+            case OpCode::I32ShiftRightSigned:
+                return shift(&Assembler::sar, &Assembler::sar);
+            case OpCode::I32ShiftRightUnsigned:
+                return shift(&Assembler::shr, &Assembler::shr);
+            case OpCode::I32RotateLeft:
+                return shift(&Assembler::rol, &Assembler::rol);
+            case OpCode::I32RotateRight:
+                return shift(&Assembler::ror, &Assembler::ror);
+            case OpCode::I32DivideSigned:
+            case OpCode::I32DivideUnsigned:
+            case OpCode::I32RemainderSigned:
+            case OpCode::I32RemainderUnsigned:
+                return divide(op.code);
+            case OpCode::I32CountLeadingZeros:
+            case OpCode::I32CountTrailingZeros:
+            case OpCode::I32PopulationCount:
+            case OpCode::I32TruncateF32Signed:
+            case OpCode::I32TruncateF32Unsigned:
+            case OpCode::I32TruncateF64Signed:
+            case OpCode::I32TruncateF64Unsigned:
+                // Rejected by is_supported.
+                a_.ud2();
+                return;
+        }
+    }
+
+    // Emits the conditional branch at i, taken if the flags match condition.
+    // The stack must have been flushed.
+    void branch(std::size_t i, Condition condition) {
+        auto const &op = f_.code[i];
+        if (op.code == OpCode::JumpIf) {
+            a_.jcc(condition, label(*branch_target(i), height_));
+            return;
+        }
+
+        auto skip = Label::unlinked();
+        a_.jcc(negate(condition), skip);
+        if (op.code == OpCode::BranchIf) {
+            copy(height_ - op.c, op.b, op.c);
+            a_.jmp(label(*branch_target(i), op.b + op.c));
+        } else {
+            copy(height_ - op.a, 0, op.a);
+            a_.ret();
+        }
+        a_.link(skip);
+    }
+
+    // Compares the operands of a comparison, setting condition_ to the
+    // condition that's true if the comparison is. Branching on the result
+    // requires the rest of the stack to be flushed first, as that would
+    // clobber the flags.
+    Reg32 compare(OpCode code, bool for_branch) {
+        if (code == OpCode::I32EqualZero) {
+            auto const reg = pop_reg();
+            if (for_branch) {
+                flush();
+            }
+            a_.test(reg, reg);
+            condition_ = Condition::Equal;
+            return reg;
+        }
+
+        auto const rhs = pop();
+        auto const lhs = pop_reg();
+        if (for_branch) {
+            flush();
+        }
+        if (rhs.reg) {
+            a_.cmp(lhs, *rhs.reg);
+        } else {
+            a_.cmp(lhs, Imm32{rhs.value});
+        }
+        condition_ = comparison(code).value();
+        return lhs;
+    }
+
+    void arithmetic(void (Assembler::*reg_op)(Reg32, Reg32), void (Assembler::*imm_op)(Reg32, Imm32)) {
+        auto const rhs = pop();
+        auto const lhs = pop_reg();
+        if (rhs.reg) {
+            (a_.*reg_op)(lhs, *rhs.reg);
+        } else {
+            (a_.*imm_op)(lhs, Imm32{rhs.value});
+        }
+        push(lhs);
+    }
+
+    void shift(void (Assembler::*cl_op)(Reg32), void (Assembler::*imm_op)(Reg32, Imm8)) {
+        auto const rhs = pop();
+        auto const lhs = pop_reg();
+        if (rhs.reg) {
+            a_.mov(Reg32::Ecx, *rhs.reg);
+            (a_.*cl_op)(lhs);
+        } else {
+            (a_.*imm_op)(lhs, Imm8{static_cast<std::uint8_t>(rhs.value & 31)});
+        }
+        push(lhs);
+    }
+
+    void divide(OpCode code) {
+        auto const rhs = pop_reg();
+        auto const lhs = pop_reg();
+        a_.mov(Reg32::Eax, lhs);
+        a_.test(rhs, rhs);
+        a_.jcc(Condition::Equal, stubs_.integer_divide_by_zero);
+
+        auto done = Label::unlinked();
+        switch (code) {
+            case OpCode::I32DivideSigned: {
+                // INT_MIN / -1 doesn't fit in an i32.
+                auto divide = Label::unlinked();
+                a_.cmp(rhs, Imm32{0xffff'ffff});
+                a_.jcc(Condition::NotEqual, divide);
+                a_.cmp(Reg32::Eax, Imm32{0x8000'0000});
+                a_.jcc(Condition::Equal, stubs_.integer_overflow);
+                a_.link(divide);
+                a_.cdq();
+                a_.idiv(rhs);
+                break;
+            }
+            case OpCode::I32RemainderSigned: {
+                // INT_MIN % -1 faults, but x % -1 is always 0.
+                auto divide = Label::unlinked();
+                a_.cmp(rhs, Imm32{0xffff'ffff});
+                a_.jcc(Condition::NotEqual, divide);
+                a_.xor_(Reg32::Edx, Reg32::Edx);
+                a_.jmp(done);
+                a_.link(divide);
+                a_.cdq();
+                a_.idiv(rhs);
+                break;
+            }
+            default:
+                a_.xor_(Reg32::Edx, Reg32::Edx);
+                a_.div(rhs);
+                break;
+        }
+
+        a_.link(done);
+        auto const is_remainder = code == OpCode::I32RemainderSigned || code == OpCode::I32RemainderUnsigned;
+        a_.mov(lhs, is_remainder ? Reg32::Edx : Reg32::Eax);
+        push(lhs);
+    }
+
+    // Leaves address + offset + 4 in RAX, trapping if that's past the end of
+    // the memory.
+    void bounds_check(Entry const &address, std::uint32_t offset) {
+        if (address.reg) {
+            a_.mov(Reg32::Eax, *address.reg);
+        } else {
+            a_.mov(Reg32::Eax, Imm32{address.value});
+        }
+        a_.add(Reg64::Rax, Imm32{offset + 4});
+        a_.cmp(Reg64::Rax, kMemorySize);
+        a_.jcc(Condition::Above, stubs_.memory_out_of_bounds);
+    }
+
+    void call(Op const &op) {
+        flush();
+        a_.push(kFp);
+        a_.lea(kFp, slot(height_ - op.b));
+        a_.call(entries_[op.a]);
+        a_.pop(kFp);
+        height_ = height_ - op.b + op.c;
+    }
+
+    void call_thunk(Thunk thunk, Op const &op) {
+        flush();
+        a_.mov(Reg64::Rdi, kContext);
+        a_.mov(Reg32::Esi, Imm32{op.a});
+        a_.lea(Reg64::Rdx, slot(height_ - op.b));
+        a_.mov(Reg64::Rax, Imm64{std::bit_cast<std::uint64_t>(thunk)});
+        // Compiled functions are entered w/ RSP 8 bytes off from the 16-byte
+        // alignment the ABI requires at calls.
+        a_.sub(Reg64::Rsp, Imm32{8});
+        a_.call(Reg64::Rax);
+        a_.add(Reg64::Rsp, Imm32{8});
+        a_.test(Reg32::Eax, Reg32::Eax);
+        a_.jcc(Condition::NotEqual, stubs_.trap);
+        height_ = height_ - op.b + op.c;
+    }
+
+    // Copies n slots, which must not be cached.
+    void copy(std::uint32_t from, std::uint32_t to, std::uint32_t n) {
+        if (from == to) {
+            return;
+        }
+
+        for (std::uint32_t i = 0; i < n; ++i) {
+            a_.mov(Reg64::Rax, slot(from + i));
+            a_.mov(slot(to + i), Reg64::Rax);
+        }
+    }
+
+    // Stores a whole slot's worth of the entry, unlike stores to memory.
+    void store(Mem const &dst, Entry const &entry) {
+        if (entry.reg) {
+            a_.mov(dst, full_width(*entry.reg));
+        } else {
+            a_.mov(dst, Imm32{entry.value});
+        }
+    }
+
+    void push(Reg32 reg) { push(Entry{.reg = reg}); }
+
+    void push(Entry entry) {
+        cache_.push_back(entry);
+        ++height_;
+    }
+
+    Entry pop() {
+        if (cache_.empty()) {
+            auto const reg = alloc();
+            a_.mov(full_width(reg), slot(height_ - 1));
+            cache_.push_back(Entry{.reg = reg});
+        }
+
+        auto const entry = cache_.back();
+        cache_.pop_back();
+        --height_;
+        if (entry.reg) {
+            lock(*entry.reg);
+        }
+        return entry;
+    }
+
+    Reg32 pop_reg() {
+        auto entry = pop();
+        if (entry.reg) {
+            return *entry.reg;
+        }
+
+        auto const reg = alloc();
+        a_.mov(reg, Imm32{entry.value});
+        return reg;
+    }
+
+    void lock(Reg32 reg) { locked_ |= 1U << *register_index(reg); }
+
+    // Returns a register that isn't holding a value, spilling the bottom of
+    // the cache until one is free. The register stays reserved until the
+    // next op.
+    Reg32 alloc() {
+        while (true) {
+            auto used = locked_;
+            for (auto const &entry : cache_) {
+                if (entry.reg) {
+                    used |= 1U << *register_index(*entry.reg);
+                }
+            }
+
+            for (auto reg : kCacheRegisters) {
+                if ((used & (1U << *register_index(reg))) == 0) {
+                    lock(reg);
+                    return reg;
+                }
+            }
+
+            flush_one();
+        }
+    }
+
+    void flush_one() {
+        auto const position = height_ - static_cast<std::uint32_t>(cache_.size());
+        auto const entry = cache_.front();
+        cache_.erase(cache_.begin());
+        if (entry.reg) {
+            a_.mov(slot(position), full_width(*entry.reg));
+        } else {
+            // The upper half of slots holding i32s is never read.
+            a_.mov(slot(position), Imm32{entry.value});
+        }
+    }
+
+    void flush() {
+        while (!cache_.empty()) {
+            flush_one();
+        }
+    }
+
+    Assembler &a_;
+    Stubs &stubs_;
+    std::vector<Label> &entries_;
+    std::span<bool const> compiled_;
+    Thunks thunks_;
+    Function const &f_;
+
+    std::vector<std::optional<Label>> labels_;
+    std::vector<std::optional<std::uint32_t>> label_heights_;
+    std::vector<Entry> cache_;
+    std::uint32_t height_{};
+    std::uint32_t locked_{};
+    Condition condition_{};
+    bool live_{true};
+};
+
+// Entered w/ RDI = the context, RSI = the frame, and RDX = the function.
+void trampoline(Assembler &a, Stubs &stubs) {
+    for (auto reg : {Reg64::Rbp, Reg64::Rbx, Reg64::R12, Reg64::R13, Reg64::R14, Reg64::R15}) {
+        a.push(reg);
+    }
+
+    // Keep the saved RSP of any outer call into compiled code around, which
+    // also keeps the stack 16-byte aligned.
+    auto const saved_rsp = offsetof(Context, saved_rsp);
+    a.push(Mem{.base = Reg64::Rdi, .disp = static_cast<std::int32_t>(saved_rsp)});
+    a.mov(Mem{.base = Reg64::Rdi, .disp = static_cast<std::int32_t>(saved_rsp)}, Reg64::Rsp);
+
+    a.mov(kContext, Reg64::Rdi);
+    a.mov(kFp, Reg64::Rsi);
+    a.mov(kMemory, context(offsetof(Context, memory)));
+    a.mov(kMemorySize, context(offsetof(Context, memory_size)));
+    a.call(Reg64::Rdx);
+    a.xor_(Reg32::Eax, Reg32::Eax);
+
+    a.link(stubs.exit);
+    a.pop(context(saved_rsp));
+    for (auto reg : {Reg64::R15, Reg64::R14, Reg64::R13, Reg64::R12, Reg64::Rbx, Reg64::Rbp}) {
+        a.pop(reg);
+    }
+    a.ret();
+}
+
+void trap_stubs(Assembler &a, Stubs &stubs) {
+    for (auto [label, trap] : {
+                 std::pair{&stubs.call_stack_exhausted, Trap::CallStackExhausted},
+                 std::pair{&stubs.integer_divide_by_zero, Trap::IntegerDivideByZero},
+                 std::pair{&stubs.integer_overflow, Trap::IntegerOverflow},
+                 std::pair{&stubs.memory_out_of_bounds, Trap::MemoryOutOfBounds},
+         }) {
+        a.link(*label);
+        a.mov(Reg32::Eax, Imm32{trap_code(trap)});
+        a.jmp(stubs.trap);
+    }
+
+    a.link(stubs.trap);
+    a.mov(Reg64::Rsp, context(offsetof(Context, saved_rsp)));
+    a.jmp(stubs.exit);
+}
+
+} // namespace
+
+std::optional<Code> Code::compile(std::span<Function const> functions, Thunks thunks) {
+    if (!kSupportedPlatform) {
+        return std::nullopt;
+    }
+
+    // Which functions are compiled has to be known up front for calls. Not a
+    // std::vector<bool> since that can't be viewed as a span.
+    auto const compiled = std::make_unique<bool[]>(functions.size());
+    std::ranges::transform(functions, compiled.get(), is_supported);
+    if (std::none_of(compiled.get(), compiled.get() + functions.size(), std::identity{})) {
+        return std::nullopt;
+    }
+
+    Assembler assembler;
+    Stubs stubs;
+    trampoline(assembler, stubs);
+
+    std::vector<Label> labels(functions.size(), Label::unlinked());
+    std::vector<std::optional<std::size_t>> entries(functions.size());
+    for (std::uint32_t i = 0; i < functions.size(); ++i) {
+        if (compiled[i]) {
+            entries[i] = assembler.size();
+            FunctionCompiler{assembler, stubs, labels, {compiled.get(), functions.size()}, thunks, functions[i]}
+                    .compile(i);
+        }
+    }
+
+    trap_stubs(assembler, stubs);
+
+    // The code is written before it's made executable, and never written
+    // again.
+    auto memory = os::ExecutableMemory::allocate_containing(assembler.take_assembled());
+    if (!memory) {
+        return std::nullopt;
+    }
+
+    return Code{*std::move(memory), std::move(entries)};
+}
+
+std::uint32_t Code::call(Context &ctx, std::uint32_t idx, std::uint64_t *fp) {
+    using Trampoline = std::uint32_t (*)(Context *, std::uint64_t *, void const *);
+    auto *const code = static_cast<std::uint8_t *>(memory_.ptr());
+    auto const trampoline = reinterpret_cast<Trampoline>(code);
+    return trampoline(&ctx, fp, code + entries_[idx].value());
+}
+
+} // namespace wasm::jit
@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#ifndef WASM_JIT_H_
+#define WASM_JIT_H_
+
+#include "wasm/bytecode.h"
+
+#include "os/memory.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+// A single-pass baseline compiler from lowered functions to amd64 machine
+// code, sharing the interpreter's value stack layout so that compiled and
+// interpreted functions can call each other. Only SysV amd64 is supported.
+namespace wasm::jit {
+
+// The instance state the compiled code needs. Its layout is known to the
+// generated code.
+struct Context {
+    // Where to unwind the native stack to on traps.
+    void *saved_rsp{};
+    // Calls trap if the native stack pointer goes below this.
+    std::uintptr_t native_stack_limit{};
+    std::uint64_t const *value_stack_end{};
+    std::byte *memory{};
+    std::uint64_t memory_size{};
+    void *instance{};
+};
+
+// Called by compiled code for calls it can't make directly. fp points to the
+// callee's arguments, which are replaced by its results. Returns 0 on success
+// and the trap + 1 otherwise.
+using Thunk = std::uint32_t (*)(Context *, std::uint32_t idx, std::uint64_t *fp);
+
+struct Thunks {
+    Thunk call_host{};
+    Thunk call_interpreted{};
+};
+
+class Code {
+public:
+    // Compiles the functions it supports, leaving the rest to the
+    // interpreter. Returns nothing if no function could be compiled.
+    static std::optional<Code> compile(std::span<bytecode::Function const>, Thunks);
+
+    bool is_compiled(std::uint32_t idx) const { return idx < entries_.size() && entries_[idx].has_value(); }
+
+    // Runs a compiled function w/ its arguments at fp, leaving its results
+    // there. Returns 0 on success and the trap + 1 otherwise.
+    std::uint32_t call(Context &, std::uint32_t idx, std::uint64_t *fp);
+
+private:
+    Code(os::ExecutableMemory memory, std::vector<std::optional<std::size_t>> entries)
+        : memory_{std::move(memory)}, entries_{std::move(entries)} {}
+
+    os::ExecutableMemory memory_;
+    // The offset of each compiled function into memory_. The trampoline
+    // entering compiled code from C++ is at offset 0.
+    std::vector<std::optional<std::size_t>> entries_;
+};
+
+} // namespace wasm::jit
+
+#endif
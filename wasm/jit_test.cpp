@@ -0,0 +1,376 @@
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
+//
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "wasm/interpreter.h"
+
+#include "wasm/instructions.h"
+#include "wasm/types.h"
+#include "wasm/wasm.h"
+
+#include "etest/etest2.h"
+
+#include <tl/expected.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace wasm;
+using namespace wasm::instructions;
+
+namespace {
+
+#if (defined(__x86_64__) || defined(__amd64__)) && !defined(_WIN32)
+constexpr bool kJitSupported = true;
+#else
+constexpr bool kJitSupported = false;
+#endif
+
+FunctionType const kI32ToI32{.parameters = {ValueType::Int32}, .results = {ValueType::Int32}};
+FunctionType const kI32I32ToI32{.parameters = {ValueType::Int32, ValueType::Int32}, .results = {ValueType::Int32}};
+
+constexpr auto kInt32Min = std::numeric_limits<std::int32_t>::min();
+
+// A module w/ one function per body, all of the given type and w/ 2 extra
+// i32 locals. The first function is exported as "f".
+Module make_module(FunctionType type, std::vector<std::vector<Instruction>> bodies, std::uint32_t pages = 1) {
+    Module m{};
+    m.type_section = TypeSection{.types = {std::move(type)}};
+    m.function_section = FunctionSection{};
+    m.code_section = CodeSection{};
+    for (auto &body : bodies) {
+        m.function_section->type_indices.push_back(0);
+        m.code_section->entries.push_back(
+                CodeEntry{.code = std::move(body), .locals = {{.count = 2, .type = ValueType::Int32}}});
+    }
+    m.export_section = ExportSection{.exports = {Export{.name = "f", .type = Export::Type::Function, .index = 0}}};
+    m.memory_section = MemorySection{.memories = {MemType{.min = pages}}};
+    return m;
+}
+
+struct Instances {
+    Instance interpreted;
+    Instance compiled;
+};
+
+Instances instantiate(etest::IActions &a, Module const &m, std::vector<HostFunction> const &imports = {}) {
+    auto interpreted = Instance::create(m, imports, Engine::Interpreter);
+    auto compiled = Instance::create(m, imports, Engine::Jit);
+    a.require(interpreted.has_value());
+    a.require(compiled.has_value());
+    return {*std::move(interpreted), *std::move(compiled)};
+}
+
+// Calls "f" w/ each set of arguments in both engines, expecting the same
+// results, traps, and memory contents.
+void expect_same(etest::IActions &a, Instances &instances, std::span<std::vector<Value> const> arg_sets) {
+    for (auto const &args : arg_sets) {
+        a.expect_eq(instances.compiled.call("f", args), instances.interpreted.call("f", args));
+        a.expect(std::ranges::equal(instances.compiled.memory(), instances.interpreted.memory()));
+    }
+}
+
+// Generates random, valid i32 expressions over 2 params and 2 locals.
+class ExpressionGenerator {
+public:
+    explicit ExpressionGenerator(std::uint32_t seed) : rng_{seed} {}
+
+    // Code leaving a single i32 on the stack.
+    std::vector<Instruction> expression(int depth) {
+        std::vector<Instruction> out;
+        expression(out, depth);
+        return out;
+    }
+
+private:
+    void expression(std::vector<Instruction> &out, int depth) {
+        auto const choice = depth <= 0 ? pick(2) : pick(9);
+        switch (choice) {
+            case 0:
+                out.emplace_back(I32Const{kConstants[pick(kConstants.size())]});
+                return;
+            case 1:
+                out.emplace_back(LocalGet{static_cast<std::uint32_t>(pick(4))});
+                return;
+            case 2:
+                expression(out, depth - 1);
+                out.push_back(kUnary[pick(kUnary.size())]);
+                return;
+            case 3:
+            case 4:
+                expression(out, depth - 1);
+                expression(out, depth - 1);
+                out.push_back(kBinary[pick(kBinary.size())]);
+                return;
+            case 5:
+                expression(out, depth - 1);
+                out.emplace_back(LocalTee{static_cast<std::uint32_t>(pick(4))});
+                return;
+            case 6: {
+                // A block w/ a conditional branch out of it, sometimes w/ an
+                // extra value on the stack that the branch drops.
+                std::vector<Instruction> block;
+                expression(block, depth - 1);
+                auto const extra = pick(2) == 0;
+                if (extra) {
+                    expression(block, depth - 1);
+                }
+                expression(block, depth - 1);
+                block.emplace_back(BranchIf{0});
+                if (extra) {
+                    block.push_back(kBinary[pick(kBinary.size())]);
+                }
+                out.emplace_back(Block{.type = {ValueType::Int32}, .instructions = std::move(block)});
+                return;
+            }
+            case 7:
+                // Store, then load something nearby, keeping the addresses
+                // in bounds.
+                address(out, depth - 1);
+                expression(out, depth - 1);
+                out.emplace_back(I32Store{.arg = {.align = 2, .offset = static_cast<std::uint32_t>(pick(8))}});
+                address(out, depth - 1);
+                out.emplace_back(I32Load{.arg = {.align = 2, .offset = static_cast<std::uint32_t>(pick(8))}});
+                return;
+            default:
+                expression(out, depth - 1);
+                out.emplace_back(I32Const{0});
+                out.emplace_back(BranchIf{0});
+                return;
+        }
+    }
+
+    void address(std::vector<Instruction> &out, int depth) {
+        expression(out, depth);
+        out.emplace_back(I32Const{0xfff});
+        out.emplace_back(I32And{});
+    }
+
+    std::size_t pick(std::size_t n) { return std::uniform_int_distribution<std::size_t>{0, n - 1}(rng_); }
+
+    static constexpr auto kConstants = std::to_array<std::int32_t>({0, 1, -1, 2, 7, 31, 32, 0x80, 0x8000, kInt32Min});
+    inline static std::array<Instruction, 3> const kUnary{I32EqualZero{}, I32Extend8Signed{}, I32Extend16Signed{}};
+    inline static std::array<Instruction, 25> const kBinary{
+            I32Add{},
+            I32Subtract{},
+            I32Multiply{},
+            I32DivideSigned{},
+            I32DivideUnsigned{},
+            I32RemainderSigned{},
+            I32RemainderUnsigned{},
+            I32And{},
+            I32Or{},
+            I32ExclusiveOr{},
+            I32ShiftLeft{},
+            I32ShiftRightSigned{},
+            I32ShiftRightUnsigned{},
+            I32RotateLeft{},
+            I32RotateRight{},
+            I32Equal{},
+            I32NotEqual{},
+            I32LessThanSigned{},
+            I32LessThanUnsigned{},
+            I32GreaterThanSigned{},
+            I32GreaterThanUnsigned{},
+            I32LessThanEqualSigned{},
+            I32LessThanEqualUnsigned{},
+            I32GreaterThanEqualSigned{},
+            I32GreaterThanEqualUnsigned{},
+    };
+
+    std::mt19937 rng_;
+};
+
+// fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2), calling function `callee`.
+std::vector<Instruction> fib(std::uint32_t callee) {
+    return {
+            Block{.instructions = {LocalGet{0},
+                          I32Const{2},
+                          I32GreaterThanEqualSigned{},
+                          BranchIf{0},
+                          LocalGet{0},
+                          Return{}}},
+            LocalGet{0},
+            I32Const{1},
+            I32Subtract{},
+            Call{callee},
+            LocalGet{0},
+            I32Const{2},
+            I32Subtract{},
+            Call{callee},
+            I32Add{},
+    };
+}
+
+} // namespace
+
+int main() {
+    etest::Suite s{"wasm::jit"};
+
+    s.add_test("random expressions", [](etest::IActions &a) {
+        auto const args = std::to_array<std::vector<Value>>({
+                {0, 0},
+                {1, -1},
+                {-1, 31},
+                {kInt32Min, -1},
+                {0x1234'5678, 7},
+                {100, 33},
+        });
+
+        for (std::uint32_t seed = 0; seed < 300; ++seed) {
+            ExpressionGenerator gen{seed};
+            auto instances = instantiate(a, make_module(kI32I32ToI32, {gen.expression(6)}));
+            a.expect_eq(instances.compiled.is_compiled(0), kJitSupported);
+            expect_same(a, instances, args);
+        }
+    });
+
+    s.add_test("loops", [](etest::IActions &a) {
+        // Sums the numbers [1, n] and stores each partial sum.
+        auto m = make_module(kI32ToI32,
+                {{Loop{.instructions = {LocalGet{1},
+                                LocalGet{0},
+                                I32Add{},
+                                LocalTee{1},
+                                LocalGet{0},
+                                I32Const{2},
+                                I32ShiftLeft{},
+                                I32Store{.arg = {.align = 2}},
+                                LocalGet{0},
+                                I32Const{1},
+                                I32Subtract{},
+                                LocalTee{0},
+                                BranchIf{0}}},
+                        LocalGet{1}}});
+        auto instances = instantiate(a, m);
+        a.expect_eq(instances.compiled.is_compiled(0), kJitSupported);
+        expect_same(a, instances, std::to_array<std::vector<Value>>({{0}, {1}, {1000}}));
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{100}), std::vector<Value>{5050});
+    });
+
+    s.add_test("calls", [](etest::IActions &a) {
+        auto instances = instantiate(a, make_module(kI32ToI32, {fib(0)}));
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{20}), std::vector<Value>{6765});
+        expect_same(a, instances, std::to_array<std::vector<Value>>({{0}, {1}, {2}, {15}}));
+
+        // Many arguments, which can't all be kept in registers.
+        FunctionType const sum_type{.parameters = std::vector(8, ValueType::Int32), .results = {ValueType::Int32}};
+        std::vector<Instruction> sum;
+        std::vector<Instruction> call_sum;
+        for (std::uint32_t i = 0; i < 8; ++i) {
+            call_sum.emplace_back(LocalGet{i});
+            call_sum.emplace_back(I32Const{static_cast<std::int32_t>(i)});
+            call_sum.emplace_back(I32Add{});
+            sum.emplace_back(LocalGet{i});
+            if (i > 0) {
+                sum.emplace_back(I32Subtract{});
+            }
+        }
+        call_sum.emplace_back(Call{1});
+        call_sum.emplace_back(I32Const{3});
+        call_sum.emplace_back(I32Multiply{});
+        instances = instantiate(a, make_module(sum_type, {call_sum, sum}));
+        expect_same(a, instances, std::to_array<std::vector<Value>>({{1, 2, 3, 4, 5, 6, 7, 8}}));
+    });
+
+    s.add_test("interpreter fallback", [](etest::IActions &a) {
+        // f and h are compiled, g isn't, and they call each other.
+        auto m = make_module(kI32ToI32,
+                {
+                        {LocalGet{0}, Call{1}, I32Const{1}, I32Add{}},
+                        {LocalGet{0}, Call{2}, I32CountLeadingZeros{}},
+                        {LocalGet{0}, I32Const{3}, I32ShiftRightUnsigned{}},
+                });
+        auto instances = instantiate(a, m);
+        a.expect_eq(instances.compiled.is_compiled(0), kJitSupported);
+        a.expect_eq(instances.compiled.is_compiled(1), false);
+        a.expect_eq(instances.compiled.is_compiled(2), kJitSupported);
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{256}), std::vector<Value>{27});
+        a.expect_eq(instances.compiled.call(1, std::vector<Value>{256}), std::vector<Value>{26});
+        expect_same(a, instances, std::to_array<std::vector<Value>>({{0}, {-1}, {12345}}));
+
+        // Mutual recursion through the interpreter.
+        auto fib_interpreted = fib(0);
+        fib_interpreted.emplace_back(I32PopulationCount{});
+        instances = instantiate(a, make_module(kI32ToI32, {fib(1), fib_interpreted}));
+        a.expect_eq(instances.compiled.is_compiled(0), kJitSupported);
+        a.expect_eq(instances.compiled.is_compiled(1), false);
+        expect_same(a, instances, std::to_array<std::vector<Value>>({{0}, {5}, {12}}));
+    });
+
+    s.add_test("traps", [](etest::IActions &a) {
+        auto m = make_module(kI32I32ToI32, {{LocalGet{0}, LocalGet{1}, I32DivideSigned{}}});
+        auto instances = instantiate(a, m);
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{1, 0}), tl::unexpected{Trap::IntegerDivideByZero});
+        a.expect_eq(
+                instances.compiled.call("f", std::vector<Value>{kInt32Min, -1}), tl::unexpected{Trap::IntegerOverflow});
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{-7, 2}), std::vector<Value>{-3});
+
+        m.code_section->entries[0].code = {LocalGet{0}, LocalGet{1}, I32RemainderSigned{}};
+        instances = instantiate(a, m);
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{kInt32Min, -1}), std::vector<Value>{0});
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{1, 0}), tl::unexpected{Trap::IntegerDivideByZero});
+
+        m.code_section->entries[0].code = {LocalGet{0}, I32Load{.arg = {.align = 2, .offset = 4}}};
+        instances = instantiate(a, m);
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{64 * 1024 - 8, 0}), std::vector<Value>{0});
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{64 * 1024 - 7, 0}),
+                tl::unexpected{Trap::MemoryOutOfBounds});
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{-1, 0}), tl::unexpected{Trap::MemoryOutOfBounds});
+
+        // Traps unwind calls, and the instance is usable afterwards.
+        m = make_module(kI32ToI32, {{LocalGet{0}, Call{1}}, {I32Const{1}, LocalGet{0}, I32DivideUnsigned{}}});
+        instances = instantiate(a, m);
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{0}), tl::unexpected{Trap::IntegerDivideByZero});
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{1}), std::vector<Value>{1});
+    });
+
+    s.add_test("call stack exhaustion", [](etest::IActions &a) {
+        auto instances = instantiate(a, make_module(FunctionType{}, {{Call{0}}}));
+        a.expect_eq(instances.compiled.call("f"), tl::unexpected{Trap::CallStackExhausted});
+        a.expect_eq(instances.compiled.call("f"), tl::unexpected{Trap::CallStackExhausted});
+
+        // Through the interpreter, which has its own limits.
+        instances = instantiate(
+                a, make_module(kI32ToI32, {{LocalGet{0}, Call{1}}, {LocalGet{0}, I32CountTrailingZeros{}, Call{0}}}));
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{1}), tl::unexpected{Trap::CallStackExhausted});
+
+        // Running out of value stack rather than native stack.
+        auto m = make_module(FunctionType{}, {{Call{0}}});
+        m.code_section->entries[0].locals[0].count = 10'000;
+        instances = instantiate(a, m);
+        a.expect_eq(instances.compiled.call("f"), tl::unexpected{Trap::CallStackExhausted});
+    });
+
+    s.add_test("host functions", [](etest::IActions &a) {
+        auto m = make_module(kI32ToI32, {{LocalGet{0}, Call{0}, I32Const{1}, I32Add{}}});
+        m.import_section = ImportSection{
+                .imports = {Import{.module = "env", .name = "twice", .description = TypeIdx{0}}}};
+        m.export_section->exports[0].index = 1;
+
+        auto twice = [](std::span<Value const> args, std::span<std::byte> memory) -> std::vector<Value> {
+            memory[0] = std::byte{42};
+            return {std::get<std::int32_t>(args[0]) * 2};
+        };
+        auto instances = instantiate(a, m, {HostFunction{"env", "twice", twice}});
+        a.expect_eq(instances.compiled.is_compiled(0), false);
+        a.expect_eq(instances.compiled.is_compiled(1), kJitSupported);
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{21}), std::vector<Value>{43});
+        a.expect_eq(instances.compiled.memory()[0], std::byte{42});
+
+        auto bad = [](std::span<Value const>, std::span<std::byte>) -> std::vector<Value> { return {1.F}; };
+        instances = instantiate(a, m, {HostFunction{"env", "twice", bad}});
+        a.expect_eq(instances.compiled.call("f", std::vector<Value>{21}), tl::unexpected{Trap::HostResultMismatch});
+    });
+
+    return s.run();
+}
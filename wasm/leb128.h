@@ -31,7 +31,10 @@ struct Leb128 {};
 template<std::unsigned_integral T>
 struct Leb128<T> {
     static tl::expected<T, Leb128ParseError> decode_from(std::istream &&is) { return decode_from(is); }
-    static tl::expected<T, Leb128ParseError> decode_from(std::istream &is) {
+
+    // Stream is anything w/ a std::istream-like read.
+    template<typename Stream>
+    static tl::expected<T, Leb128ParseError> decode_from(Stream &is) {
         T result{};
         std::uint8_t shift{};
         auto const max_bytes = static_cast<int>(std::ceil(sizeof(T) * 8 / 7.f));
@@ -72,7 +75,10 @@ struct Leb128<T> {
     static constexpr std::uint8_t kSignBit = 0b0100'0000;
 
     static tl::expected<T, Leb128ParseError> decode_from(std::istream &&is) { return decode_from(is); }
-    static tl::expected<T, Leb128ParseError> decode_from(std::istream &is) {
+
+    // Stream is anything w/ a std::istream-like read.
+    template<typename Stream>
+    static tl::expected<T, Leb128ParseError> decode_from(Stream &is) {
         T result{};
         std::uint8_t shift{};
         std::uint8_t byte{};
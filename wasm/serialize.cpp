@@ -29,11 +29,13 @@ struct InstructionStringifyVisitor {
     void operator()(Branch const &t);
     void operator()(BranchIf const &t);
     void operator()(Return const &);
+    void operator()(Call const &t);
     void operator()(I32Const const &t);
     void operator()(LocalGet const &t);
     void operator()(LocalSet const &t);
     void operator()(LocalTee const &t);
     void operator()(I32Load const &t);
+    void operator()(I32Store const &t);
 
     template<typename T>
     requires std::is_empty_v<T>
@@ -94,6 +96,10 @@ void InstructionStringifyVisitor::operator()(Return const &) {
     out << Return::kMnemonic;
 }
 
+void InstructionStringifyVisitor::operator()(Call const &t) {
+    out << Call::kMnemonic << " " << std::to_string(t.function_idx);
+}
+
 void InstructionStringifyVisitor::operator()(I32Const const &t) {
     out << I32Const::kMnemonic << " " << std::to_string(t.value);
 }
@@ -126,6 +132,16 @@ void InstructionStringifyVisitor::operator()(I32Load const &t) {
     }
 }
 
+void InstructionStringifyVisitor::operator()(I32Store const &t) {
+    out << I32Store::kMnemonic;
+
+    std::string memarg = to_string(t.arg, 32);
+
+    if (!memarg.empty()) {
+        out << " " << memarg;
+    }
+}
+
 } // namespace
 
 std::string to_string(Instruction const &inst) {
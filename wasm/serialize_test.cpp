@@ -1,4 +1,5 @@
 // SPDX-FileCopyrightText: 2024 David Zero <zero-one@zer0-one.net>
+// SPDX-FileCopyrightText: 2024 Robin Lindén <dev@robinlinden.eu>
 //
 // SPDX-License-Identifier: BSD-2-Clause
 
@@ -45,6 +46,8 @@ int main() {
 
     s.add_test("branch_if", [](etest::IActions &a) { a.expect_eq(to_string(BranchIf{}), "br_if 0"); });
 
+    s.add_test("call", [](etest::IActions &a) { a.expect_eq(to_string(Call{.function_idx = 3}), "call 3"); });
+
     s.add_test("i32_const", [](etest::IActions &a) { a.expect_eq(to_string(I32Const{}), "i32.const 0"); });
 
     s.add_test("i32_eqz", [](etest::IActions &a) { a.expect_eq(to_string(I32EqualZero{}), "i32.eqz"); });
@@ -156,5 +159,10 @@ int main() {
         a.expect_eq(to_string(I32Load{64, 3}), "i32.load offset=3 align=64"); // 64-bit alignment, offset 3
     });
 
+    s.add_test("i32_store", [](etest::IActions &a) {
+        a.expect_eq(to_string(I32Store{32, 0}), "i32.store");
+        a.expect_eq(to_string(I32Store{64, 3}), "i32.store offset=3 align=64");
+    });
+
     return s.run();
 }
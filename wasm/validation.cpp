@@ -15,6 +15,7 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <string_view>
 #include <utility>
 #include <variant>
@@ -241,6 +242,57 @@ void InstValidator::mark_unreachable() {
     control_stack.back().unreachable = true;
 }
 
+// https://webassembly.github.io/spec/core/valid/modules.html#functions
+// The parameters come first in the local index space, followed by the locals.
+std::optional<ValueType> local_type(FunctionType const &func_type, CodeEntry const &func_code, std::uint32_t idx) {
+    if (idx < func_type.parameters.size()) {
+        return func_type.parameters[idx];
+    }
+
+    std::uint64_t first = func_type.parameters.size();
+    for (auto const &local : func_code.locals) {
+        if (idx < first + local.count) {
+            return local.type;
+        }
+
+        first += local.count;
+    }
+
+    return std::nullopt;
+}
+
+// https://webassembly.github.io/spec/core/syntax/modules.html#indices
+// Imported functions come first in the function index space.
+tl::expected<FunctionType const *, ValidationError> function_type(Module const &m, FuncIdx idx) {
+    std::optional<TypeIdx> type_idx;
+    if (m.import_section.has_value()) {
+        for (auto const &import : m.import_section->imports) {
+            if (auto const *t = std::get_if<TypeIdx>(&import.description)) {
+                if (idx == 0) {
+                    type_idx = *t;
+                    break;
+                }
+
+                idx -= 1;
+            }
+        }
+    }
+
+    if (!type_idx.has_value() && m.function_section.has_value() && idx < m.function_section->type_indices.size()) {
+        type_idx = m.function_section->type_indices[idx];
+    }
+
+    if (!type_idx.has_value()) {
+        return tl::unexpected{ValidationError::FuncUndefined};
+    }
+
+    if (!m.type_section.has_value() || *type_idx >= m.type_section->types.size()) {
+        return tl::unexpected{ValidationError::FuncTypeInvalid};
+    }
+
+    return &m.type_section->types[*type_idx];
+}
+
 // TODO(dzero): Serialize operand stack and control stack as part of the ValidationError to make debugging easier
 // https://webassembly.github.io/spec/core/valid/instructions.html#instruction-sequences
 tl::expected<void, ValidationError> validate_function(std::uint32_t func_idx,
@@ -258,7 +310,9 @@ tl::expected<void, ValidationError> validate_function(std::uint32_t func_idx,
 
     InstValidator v;
 
-    v.push_ctrl(Block{}, func_type.parameters, func_type.results);
+    // The parameters are locals, not operands, so the function's frame starts
+    // out w/ an empty operand stack.
+    v.push_ctrl(Block{}, {}, func_type.results);
 
     std::vector<Instruction> code = func_code.code;
 
@@ -275,7 +329,6 @@ tl::expected<void, ValidationError> validate_function(std::uint32_t func_idx,
             v.push_val(ValueType::Int32);
         }
         // cvtop
-        // TODO(dzero): figure out what to do with i32.extend8_s and i32.extend16_s
         else if (util::holds_any_of<I32WrapI64>(inst)) {
             auto maybe_val = v.pop_val_expect(ValueType::Int64);
 
@@ -301,9 +354,13 @@ tl::expected<void, ValidationError> validate_function(std::uint32_t func_idx,
 
             v.push_val(ValueType::Int32);
         }
-        // iunop + itestop
-        else if (util::holds_any_of<I32CountLeadingZeros, I32CountTrailingZeros, I32PopulationCount, I32EqualZero>(
-                         inst)) {
+        // iunop + itestop, and i32.extendN_s which despite the name are unary ops on i32s
+        else if (util::holds_any_of<I32CountLeadingZeros,
+                         I32CountTrailingZeros,
+                         I32PopulationCount,
+                         I32EqualZero,
+                         I32Extend8Signed,
+                         I32Extend16Signed>(inst)) {
             auto maybe_val = v.pop_val_expect(ValueType::Int32);
 
             if (!maybe_val.has_value()) {
@@ -354,29 +411,32 @@ tl::expected<void, ValidationError> validate_function(std::uint32_t func_idx,
         }
         // https://webassembly.github.io/spec/core/valid/instructions.html#variable-instructions
         else if (LocalGet const *lg = std::get_if<LocalGet>(&inst)) {
-            if (lg->idx >= func_code.locals.size()) {
+            auto const type = local_type(func_type, func_code, lg->idx);
+            if (!type.has_value()) {
                 return tl::unexpected{ValidationError::LocalUndefined};
             }
 
-            v.push_val(func_code.locals[lg->idx].type);
+            v.push_val(*type);
         } else if (LocalSet const *ls = std::get_if<LocalSet>(&inst)) {
-            if (ls->idx >= func_code.locals.size()) {
+            auto const type = local_type(func_type, func_code, ls->idx);
+            if (!type.has_value()) {
                 return tl::unexpected{ValidationError::LocalUndefined};
             }
 
-            if (auto pop_res = v.pop_val_expect(func_code.locals[ls->idx].type); !pop_res.has_value()) {
+            if (auto pop_res = v.pop_val_expect(*type); !pop_res.has_value()) {
                 return tl::unexpected{pop_res.error()};
             }
         } else if (LocalTee const *lt = std::get_if<LocalTee>(&inst)) {
-            if (lt->idx >= func_code.locals.size()) {
+            auto const type = local_type(func_type, func_code, lt->idx);
+            if (!type.has_value()) {
                 return tl::unexpected{ValidationError::LocalUndefined};
             }
 
-            if (auto pop_res = v.pop_val_expect(func_code.locals[lt->idx].type); !pop_res.has_value()) {
+            if (auto pop_res = v.pop_val_expect(*type); !pop_res.has_value()) {
                 return tl::unexpected{pop_res.error()};
             }
 
-            v.push_val(func_code.locals[lt->idx].type);
+            v.push_val(*type);
         }
         // https://webassembly.github.io/spec/core/valid/instructions.html#memory-instructions
         else if (I32Load const *i32l = std::get_if<I32Load>(&inst)) {
@@ -399,6 +459,25 @@ tl::expected<void, ValidationError> validate_function(std::uint32_t func_idx,
             }
 
             v.push_val(ValueType::Int32);
+        } else if (I32Store const *i32s = std::get_if<I32Store>(&inst)) {
+            if (!m.memory_section.has_value()) {
+                return tl::unexpected{ValidationError::MemorySectionUndefined};
+            }
+
+            if (m.memory_section->memories.empty()) {
+                return tl::unexpected{ValidationError::MemoryEmpty};
+            }
+
+            if (i32s->arg.align > (32 / 8)) {
+                return tl::unexpected{ValidationError::MemoryBadAlignment};
+            }
+
+            // The value to store, and then the address to store it at.
+            for (int operand = 0; operand < 2; ++operand) {
+                if (auto maybe_val = v.pop_val_expect(ValueType::Int32); !maybe_val.has_value()) {
+                    return tl::unexpected{maybe_val.error()};
+                }
+            }
         }
         // https://webassembly.github.io/spec/core/valid/instructions.html#control-instructions
         else if (Block const *block = std::get_if<Block>(&inst)) {
@@ -424,6 +503,10 @@ tl::expected<void, ValidationError> validate_function(std::uint32_t func_idx,
 
             // The case of an empty block type is handled implicitly by leaving the vectors empty
 
+            if (auto maybe_vals = v.pop_vals(params); !maybe_vals.has_value()) {
+                return tl::unexpected{maybe_vals.error()};
+            }
+
             v.push_ctrl(Block{}, std::move(params), std::move(results));
         } else if (Loop const *loop = std::get_if<Loop>(&inst)) {
             if (!is_valid(loop->type, m)) {
@@ -448,6 +531,10 @@ tl::expected<void, ValidationError> validate_function(std::uint32_t func_idx,
 
             // The case of an empty block type is handled implicitly by leaving the vectors empty
 
+            if (auto maybe_vals = v.pop_vals(params); !maybe_vals.has_value()) {
+                return tl::unexpected{maybe_vals.error()};
+            }
+
             v.push_ctrl(Loop{}, std::move(params), std::move(results));
         } else if (std::holds_alternative<End>(inst)) {
             tl::expected<ControlFrame, ValidationError> maybe_frame = v.pop_ctrl();
@@ -489,6 +576,17 @@ tl::expected<void, ValidationError> validate_function(std::uint32_t func_idx,
             }
 
             v.push_vals(v.label_types(v.control_stack[v.control_stack.size() - (branch_if->label_idx + 1)]));
+        } else if (Call const *call = std::get_if<Call>(&inst)) {
+            auto const callee = function_type(m, call->function_idx);
+            if (!callee.has_value()) {
+                return tl::unexpected{callee.error()};
+            }
+
+            if (auto maybe_vals = v.pop_vals((*callee)->parameters); !maybe_vals.has_value()) {
+                return tl::unexpected{maybe_vals.error()};
+            }
+
+            v.push_vals((*callee)->results);
         } else if (std::holds_alternative<Return>(inst)) {
             tl::expected maybe_vals = v.pop_vals(v.label_types(v.control_stack[0]));
 
@@ -557,6 +655,8 @@ std::string_view to_string(ValidationError err) {
             return "Attempted to pop from the control stack, but the control stack is empty";
         case ValidationError::FuncTypeInvalid:
             return "Function section references a non-existent type";
+        case ValidationError::FuncUndefined:
+            return "Attempted to call a function which isn't defined or imported";
         case ValidationError::FunctionSectionUndefined:
             return "A function section is required, but was not defined";
         case ValidationError::FuncUndefinedCode:
@@ -19,6 +19,7 @@ enum class ValidationError : std::uint8_t {
     CodeSectionUndefined,
     ControlStackEmpty,
     FuncTypeInvalid,
+    FuncUndefined,
     FunctionSectionUndefined,
     FuncUndefinedCode,
     LabelInvalid,
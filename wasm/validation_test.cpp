@@ -36,6 +36,12 @@ int main() {
         a.expect(validate(m).has_value());
     });
 
+    s.add_test("Function: sign extension", [=](etest::IActions &a) mutable {
+        m.code_section->entries[0].code = {I32Const{0x80}, I32Extend8Signed{}, I32Extend16Signed{}};
+
+        a.expect(validate(m).has_value());
+    });
+
     s.add_test("Function: invalid trivial sequence", [=](etest::IActions &a) mutable {
         m.code_section->entries[0].code = {I32Const{42}, I32Add{}};
 
@@ -212,6 +218,79 @@ int main() {
         a.expect_eq(validate(m), tl::unexpected{ValidationError::ValueStackUnderflow});
     });
 
+    s.add_test("Function: store, valid", [=](etest::IActions &a) mutable {
+        m.code_section->entries[0].code = {I32Const{0}, I32Const{42}, I32Store{}, I32Const{0}};
+        m.memory_section = MemorySection{.memories = {MemType{.min = 1}}};
+
+        a.expect(validate(m).has_value());
+    });
+
+    s.add_test("Function: store, missing arg", [=](etest::IActions &a) mutable {
+        m.code_section->entries[0].code = {I32Const{42}, I32Store{}, I32Const{0}};
+        m.memory_section = MemorySection{.memories = {MemType{.min = 1}}};
+
+        a.expect_eq(validate(m), tl::unexpected{ValidationError::ValueStackUnderflow});
+    });
+
+    s.add_test("Function: store, no memory section defined", [=](etest::IActions &a) mutable {
+        m.code_section->entries[0].code = {I32Const{0}, I32Const{42}, I32Store{}, I32Const{0}};
+
+        a.expect_eq(validate(m), tl::unexpected{ValidationError::MemorySectionUndefined});
+    });
+
+    s.add_test("Function: parameters are locals", [=](etest::IActions &a) mutable {
+        m.type_section->types[0].parameters = {ValueType::Int32, ValueType::Int64};
+        m.code_section->entries[0].locals = {{.count = 2, .type = ValueType::Int32}};
+
+        m.code_section->entries[0].code = {LocalGet{.idx = 0}};
+        a.expect(validate(m).has_value());
+
+        m.code_section->entries[0].code = {LocalGet{.idx = 1}};
+        a.expect_eq(validate(m), tl::unexpected{ValidationError::ValueStackUnexpected});
+
+        m.code_section->entries[0].code = {LocalGet{.idx = 3}};
+        a.expect(validate(m).has_value());
+
+        m.code_section->entries[0].code = {LocalGet{.idx = 4}};
+        a.expect_eq(validate(m), tl::unexpected{ValidationError::LocalUndefined});
+    });
+
+    s.add_test("Function: parameters aren't operands", [=](etest::IActions &a) mutable {
+        m.type_section->types[0].parameters = {ValueType::Int32};
+        m.code_section->entries[0].code = {I32Const{1}, I32Add{}};
+
+        a.expect_eq(validate(m), tl::unexpected{ValidationError::ValueStackUnderflow});
+    });
+
+    s.add_test("Function: call, valid", [=](etest::IActions &a) mutable {
+        m.type_section->types.push_back(FunctionType{.parameters = {ValueType::Int32}, .results = {ValueType::Int32}});
+        m.import_section = ImportSection{.imports = {Import{.module = "env", .name = "f", .description = TypeIdx{1}}}};
+
+        // Calls the imported function and then the function itself.
+        m.code_section->entries[0].code = {I32Const{42}, Call{.function_idx = 0}, Call{.function_idx = 1}, I32Add{}};
+        a.expect(validate(m).has_value());
+    });
+
+    s.add_test("Function: call, missing arg", [=](etest::IActions &a) mutable {
+        m.type_section->types.push_back(FunctionType{.parameters = {ValueType::Int32}, .results = {ValueType::Int32}});
+        m.import_section = ImportSection{.imports = {Import{.module = "env", .name = "f", .description = TypeIdx{1}}}};
+
+        m.code_section->entries[0].code = {Call{.function_idx = 0}};
+        a.expect_eq(validate(m), tl::unexpected{ValidationError::ValueStackUnderflow});
+    });
+
+    s.add_test("Function: call, undefined function", [=](etest::IActions &a) mutable {
+        m.code_section->entries[0].code = {Call{.function_idx = 1}};
+        a.expect_eq(validate(m), tl::unexpected{ValidationError::FuncUndefined});
+    });
+
+    s.add_test("Function: call, import w/ invalid type", [=](etest::IActions &a) mutable {
+        m.import_section = ImportSection{.imports = {Import{.module = "env", .name = "f", .description = TypeIdx{5}}}};
+
+        m.code_section->entries[0].code = {Call{.function_idx = 0}};
+        a.expect_eq(validate(m), tl::unexpected{ValidationError::FuncTypeInvalid});
+    });
+
     s.add_test("to_string(ValidationError): Every error has a message", [](etest::IActions &a) {
         // This test will fail if we add new first or last errors, but that's fine.
         static constexpr auto kFirstError = ValidationError::BlockTypeInvalid;